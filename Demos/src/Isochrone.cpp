@@ -0,0 +1,248 @@
+/*
+  Isochrone - a demo program for libosmscout
+  Copyright (C) 2017  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+
+#include <osmscout/Database.h>
+#include <osmscout/routing/IsochroneService.h>
+
+/*
+  Calculates everything reachable within the given number of minutes from the
+  given start location, for example:
+
+  All within 15 minutes by car from "In den Hüchten" Dortmund:
+    --car <map directory> 51.5717798 7.4587852 15
+*/
+
+static void GetCarSpeedTable(std::map<std::string,double>& map)
+{
+  map["highway_motorway"]=110.0;
+  map["highway_motorway_trunk"]=100.0;
+  map["highway_motorway_primary"]=70.0;
+  map["highway_motorway_link"]=60.0;
+  map["highway_motorway_junction"]=60.0;
+  map["highway_trunk"]=100.0;
+  map["highway_trunk_link"]=60.0;
+  map["highway_primary"]=70.0;
+  map["highway_primary_link"]=60.0;
+  map["highway_secondary"]=60.0;
+  map["highway_secondary_link"]=50.0;
+  map["highway_tertiary_link"]=55.0;
+  map["highway_tertiary"]=55.0;
+  map["highway_unclassified"]=50.0;
+  map["highway_road"]=50.0;
+  map["highway_residential"]=40.0;
+  map["highway_roundabout"]=40.0;
+  map["highway_living_street"]=10.0;
+  map["highway_service"]=30.0;
+}
+
+int main(int argc, char* argv[])
+{
+  osmscout::Vehicle vehicle=osmscout::vehicleCar;
+  size_t            maxNodes=osmscout::IsochroneParameter::DEFAULT_MAX_NODES;
+  bool              polygon=false;
+  double            cellSize=0.1;
+  bool              argumentError=false;
+  double            startLat;
+  double            startLon;
+  double            minutes;
+
+  int currentArg=1;
+  while (currentArg<argc) {
+    if (strcmp(argv[currentArg],"--foot")==0) {
+      vehicle=osmscout::vehicleFoot;
+      currentArg++;
+    }
+    else if (strcmp(argv[currentArg],"--bicycle")==0) {
+      vehicle=osmscout::vehicleBicycle;
+      currentArg++;
+    }
+    else if (strcmp(argv[currentArg],"--car")==0) {
+      vehicle=osmscout::vehicleCar;
+      currentArg++;
+    }
+    else if (strcmp(argv[currentArg],"--maxNodes")==0) {
+      currentArg++;
+
+      if (currentArg>=argc ||
+          sscanf(argv[currentArg],"%zu",&maxNodes)!=1) {
+        argumentError=true;
+        break;
+      }
+
+      currentArg++;
+    }
+    else if (strcmp(argv[currentArg],"--polygon")==0) {
+      polygon=true;
+      currentArg++;
+    }
+    else if (strcmp(argv[currentArg],"--cellSize")==0) {
+      currentArg++;
+
+      if (currentArg>=argc ||
+          sscanf(argv[currentArg],"%lf",&cellSize)!=1) {
+        argumentError=true;
+        break;
+      }
+
+      currentArg++;
+    }
+    else {
+      break;
+    }
+  }
+
+  if (argumentError ||
+      argc-currentArg!=4) {
+    std::cout << "Isochrone" << std::endl;
+    std::cout << "  [--foot | --bicycle | --car]" << std::endl;
+    std::cout << "  [--maxNodes <count, 0 for no limit>]" << std::endl;
+    std::cout << "  [--polygon]" << std::endl;
+    std::cout << "  [--cellSize <km>]" << std::endl;
+    std::cout << "  <map directory>" << std::endl;
+    std::cout << "  <start lat> <start lon>" << std::endl;
+    std::cout << "  <minutes>" << std::endl;
+    return 1;
+  }
+
+  std::string mapDirectory=argv[currentArg];
+  currentArg++;
+
+  if (sscanf(argv[currentArg],"%lf",&startLat)!=1) {
+    std::cerr << "lat is not numeric!" << std::endl;
+    return 1;
+  }
+  currentArg++;
+
+  if (sscanf(argv[currentArg],"%lf",&startLon)!=1) {
+    std::cerr << "lon is not numeric!" << std::endl;
+    return 1;
+  }
+  currentArg++;
+
+  if (sscanf(argv[currentArg],"%lf",&minutes)!=1) {
+    std::cerr << "minutes is not numeric!" << std::endl;
+    return 1;
+  }
+  currentArg++;
+
+  osmscout::DatabaseParameter databaseParameter;
+  osmscout::DatabaseRef       database=std::make_shared<osmscout::Database>(databaseParameter);
+
+  if (!database->Open(mapDirectory.c_str())) {
+    std::cerr << "Cannot open database" << std::endl;
+
+    return 1;
+  }
+
+  osmscout::RouterParameter routerParameter;
+
+  routerParameter.SetDebugPerformance(true);
+
+  osmscout::IsochroneServiceRef service=std::make_shared<osmscout::IsochroneService>(database,
+                                                                                     routerParameter,
+                                                                                     osmscout::RoutingService::DEFAULT_FILENAME_BASE);
+
+  if (!service->Open()) {
+    std::cerr << "Cannot open routing database" << std::endl;
+
+    return 1;
+  }
+
+  osmscout::TypeConfigRef                typeConfig=database->GetTypeConfig();
+  osmscout::FastestPathRoutingProfileRef routingProfile=std::make_shared<osmscout::FastestPathRoutingProfile>(typeConfig);
+  std::map<std::string,double>           carSpeedTable;
+
+  switch (vehicle) {
+  case osmscout::vehicleFoot:
+    routingProfile->ParametrizeForFoot(*typeConfig,
+                                       5.0);
+    break;
+  case osmscout::vehicleBicycle:
+    routingProfile->ParametrizeForBicycle(*typeConfig,
+                                          20.0);
+    break;
+  case osmscout::vehicleCar:
+    GetCarSpeedTable(carSpeedTable);
+    routingProfile->ParametrizeForCar(*typeConfig,
+                                      carSpeedTable,
+                                      160.0);
+    break;
+  }
+
+  double                  radius=1000.0;
+  osmscout::RoutePosition start=service->GetClosestRoutableNode(osmscout::GeoCoord(startLat,startLon),
+                                                                *routingProfile,
+                                                                radius);
+
+  if (!start.IsValid()) {
+    std::cerr << "Error while searching for routing node near start location!" << std::endl;
+    return 1;
+  }
+
+  osmscout::IsochroneParameter parameter;
+
+  parameter.SetMaxNodes(maxNodes);
+  parameter.SetPolygon(polygon);
+  parameter.SetPolygonCellSize(cellSize);
+
+  // The costs of the fastest path profile are in hours
+  osmscout::IsochroneResult result=service->CalculateIsochrone(*routingProfile,
+                                                               start,
+                                                               minutes/60.0,
+                                                               parameter);
+
+  if (!result.Success()) {
+    std::cerr << "No route node reachable!" << std::endl;
+    return 1;
+  }
+
+  double maxDistance=0.0;
+
+  for (const auto& node : result.GetNodes()) {
+    maxDistance=std::max(maxDistance,node.distance);
+  }
+
+  std::cout << "Route nodes reached: " << result.GetNodes().size();
+
+  if (!result.IsComplete()) {
+    std::cout << " (limit reached)";
+  }
+
+  std::cout << std::endl;
+  std::cout << "Maximum distance: " << std::fixed << std::setprecision(2) << maxDistance << " km" << std::endl;
+
+  if (polygon) {
+    std::cout << "Polygon:" << std::endl;
+
+    for (const auto& coord : result.GetPolygon()) {
+      std::cout << std::setprecision(6) << coord.GetLat() << " " << coord.GetLon() << std::endl;
+    }
+  }
+
+  service->Close();
+
+  return 0;
+}
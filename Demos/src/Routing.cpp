@@ -27,6 +27,7 @@
 
 #include <osmscout/Database.h>
 #include <osmscout/routing/SimpleRoutingService.h>
+#include <osmscout/routing/CHRoutingService.h>
 #include <osmscout/routing/RoutePostprocessor.h>
 #include <osmscout/routing/DBFileOffset.h>
 
@@ -513,6 +514,13 @@ int main(int argc, char* argv[])
   osmscout::Vehicle                         vehicle=osmscout::vehicleCar;
   std::string                               mapDirectory;
   bool                                      outputGPX=false;
+  bool                                      useContractionHierarchy=false;
+  bool                                      bidirectional=false;
+  bool                                      inMemoryGraph=false;
+  bool                                      landmarks=false;
+  bool                                      segmentIndex=false;
+  bool                                      targetTree=false;
+  osmscout::RoutingParameter::OpenListType  openListType=osmscout::RoutingParameter::openListDAryHeap;
   bool                                      argumentError=false;
 
   double                                    startLat;
@@ -550,6 +558,52 @@ int main(int argc, char* argv[])
       outputGPX=true;
       currentArg++;
     }
+    else if (strcmp(argv[currentArg],"--ch")==0) {
+      useContractionHierarchy=true;
+      currentArg++;
+    }
+    else if (strcmp(argv[currentArg],"--bidirectional")==0) {
+      bidirectional=true;
+      currentArg++;
+    }
+    else if (strcmp(argv[currentArg],"--inMemoryGraph")==0) {
+      inMemoryGraph=true;
+      currentArg++;
+    }
+    else if (strcmp(argv[currentArg],"--landmarks")==0) {
+      landmarks=true;
+      currentArg++;
+    }
+    else if (strcmp(argv[currentArg],"--segmentIndex")==0) {
+      segmentIndex=true;
+      currentArg++;
+    }
+    else if (strcmp(argv[currentArg],"--targetTree")==0) {
+      targetTree=true;
+      currentArg++;
+    }
+    else if (strcmp(argv[currentArg],"--openList")==0) {
+      currentArg++;
+
+      if (currentArg>=argc) {
+        argumentError=true;
+      }
+      else if (strcmp(argv[currentArg],"set")==0) {
+        openListType=osmscout::RoutingParameter::openListSet;
+        currentArg++;
+      }
+      else if (strcmp(argv[currentArg],"dary")==0) {
+        openListType=osmscout::RoutingParameter::openListDAryHeap;
+        currentArg++;
+      }
+      else if (strcmp(argv[currentArg],"radix")==0) {
+        openListType=osmscout::RoutingParameter::openListRadixHeap;
+        currentArg++;
+      }
+      else {
+        argumentError=true;
+      }
+    }
     else {
       // No more "special" arguments
       break;
@@ -562,6 +616,13 @@ int main(int argc, char* argv[])
     std::cout << "  [--router <router filename base>]" << std::endl;
     std::cout << "  [--foot | --bicycle | --car]" << std::endl;
     std::cout << "  [--gpx]" << std::endl;
+    std::cout << "  [--ch]" << std::endl;
+    std::cout << "  [--bidirectional]" << std::endl;
+    std::cout << "  [--inMemoryGraph]" << std::endl;
+    std::cout << "  [--landmarks]" << std::endl;
+    std::cout << "  [--segmentIndex]" << std::endl;
+    std::cout << "  [--targetTree]" << std::endl;
+    std::cout << "  [--openList set|dary|radix]" << std::endl;
     std::cout << "  <map directory>" << std::endl;
     std::cout << "  <start lat> <start lon>" << std::endl;
     std::cout << "  <target lat> <target lon>" << std::endl;
@@ -611,10 +672,23 @@ int main(int argc, char* argv[])
     routerParameter.SetDebugPerformance(true);
   }
 
-  osmscout::SimpleRoutingServiceRef router=std::make_shared<osmscout::SimpleRoutingService>(
-                                                    database,
-                                                    routerParameter,
-                                                    routerFilenamebase);
+  routerParameter.SetInMemoryGraph(inMemoryGraph);
+  routerParameter.SetLandmarks(landmarks);
+  routerParameter.SetSegmentIndex(segmentIndex);
+
+  osmscout::SimpleRoutingServiceRef router;
+
+  if (useContractionHierarchy) {
+    router=std::make_shared<osmscout::CHRoutingService>(database,
+                                                        routerParameter,
+                                                        routerFilenamebase,
+                                                        vehicle);
+  }
+  else {
+    router=std::make_shared<osmscout::SimpleRoutingService>(database,
+                                                            routerParameter,
+                                                            routerFilenamebase);
+  }
 
   if (!router->Open()) {
     std::cerr << "Cannot open routing database" << std::endl;
@@ -628,6 +702,8 @@ int main(int argc, char* argv[])
   osmscout::RoutingParameter          parameter;
 
   parameter.SetProgress(std::make_shared<ConsoleRoutingProgress>());
+  parameter.SetBidirectional(bidirectional);
+  parameter.SetOpenListType(openListType);
 
   switch (vehicle) {
   case osmscout::vehicleFoot:
@@ -674,10 +750,30 @@ int main(int argc, char* argv[])
     std::cerr << "Cannot find start node for target location!" << std::endl;
   }
 
-  osmscout::RoutingResult result=router->CalculateRoute(*routingProfile,
-                                                        start,
-                                                        target,
-                                                        parameter);
+  osmscout::RoutingResult result;
+
+  if (targetTree) {
+    // Calculate the routes of all positions near the start to the target and look up the route of the start
+    double                                        maxDistance=osmscout::GetSphericalDistance(osmscout::GeoCoord(startLat,startLon),
+                                                                                             osmscout::GeoCoord(targetLat,targetLon));
+    osmscout::SimpleRoutingService::TargetTreeRef tree=router->CalculateTargetTree(*routingProfile,
+                                                                                   target,
+                                                                                   maxDistance,
+                                                                                   parameter);
+
+    if (tree) {
+      result=router->Reroute(*routingProfile,
+                             start,
+                             *tree,
+                             parameter);
+    }
+  }
+  else {
+    result=router->CalculateRoute(*routingProfile,
+                                  start,
+                                  target,
+                                  parameter);
+  }
 
   if (!result.Success()) {
     std::cerr << "There was an error while calculating the route!" << std::endl;
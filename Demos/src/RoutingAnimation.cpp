@@ -166,7 +166,6 @@ public:
                                     osmscout::RoutingService::RNodeRef &current,
                                     osmscout::RouteNodeRef &/*currentRouteNode*/,
                                     osmscout::RoutingService::OpenList &openList,
-                                    osmscout::RoutingService::OpenMap &/*openMap*/,
                                     const osmscout::RoutingService::ClosedSet &closedSet,
                                     const ClosedSet &closedRestrictedSet)
   {
@@ -246,7 +245,11 @@ public:
     pen.setColor(yellow);
     painter.setBrush(QBrush(yellow));
 
-    for (const auto &open:openList){
+    std::vector<osmscout::RoutingService::RNodeRef> openNodes;
+
+    openList.GetNodes(openNodes);
+
+    for (const auto &open:openNodes){
       drawDot(painter,projection,open->node->GetCoord());
       if (open->prev.IsValid()){
         if (!GetRouteNodeByOffset(open->prev,n1)){
@@ -17,16 +17,19 @@
   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 */
 
+#include <cstring>
 #include <iostream>
 #include <iomanip>
 #include <limits>
+#include <memory>
+#include <vector>
 
 #include <osmscout/Database.h>
 #include <osmscout/MapService.h>
+#include <osmscout/MetaTileRenderer.h>
 
 #include <osmscout/MapPainterAgg.h>
 
-#include <osmscout/util/StopClock.h>
 #include <osmscout/util/Tiling.h>
 
 /*
@@ -34,6 +37,10 @@
   level directory), drawing the "Ruhrgebiet":
 
   src/Tiler ../maps/nordrhein-westfalen ../stylesheets/standard.oss 51.2 6.5 51.7 8 10 13
+
+  Tiles are drawn in blocks of 4x4 tiles (meta tiles) using one thread per
+  core by default, the optional last two parameters change this, e.g. append
+  "8 2" for meta tiles of 8x8 tiles drawn by two threads.
 */
 
 static const unsigned int tileWidth=256;
@@ -63,117 +70,82 @@ bool write_ppm(const agg::rendering_buffer& buffer,
   return false;
 }
 
-void MergeTilesToMapData(const std::list<osmscout::TileRef>& centerTiles,
-                         const osmscout::MapService::TypeDefinition& ringTypeDefinition,
-                         const std::list<osmscout::TileRef>& ringTiles,
-                         osmscout::MapData& data)
+/**
+ * Draws a meta tile into its own buffer and copies every tile from there
+ * into the buffer of the full map. Tiles of different meta tiles do not overlap,
+ * so the full map buffer can be shared by all workers without locking.
+ */
+class AggCanvas : public osmscout::MetaTileCanvas
 {
-  std::unordered_map<osmscout::FileOffset,osmscout::NodeRef> nodeMap(10000);
-  std::unordered_map<osmscout::FileOffset,osmscout::WayRef>  wayMap(10000);
-  std::unordered_map<osmscout::FileOffset,osmscout::AreaRef> areaMap(10000);
-  std::unordered_map<osmscout::FileOffset,osmscout::WayRef>  optimizedWayMap(10000);
-  std::unordered_map<osmscout::FileOffset,osmscout::AreaRef> optimizedAreaMap(10000);
-
-  osmscout::StopClock uniqueTime;
-
-  for (auto tile : centerTiles) {
-    tile->GetNodeData().CopyData([&nodeMap](const osmscout::NodeRef& node) {
-      nodeMap[node->GetFileOffset()]=node;
-    });
-
-    //---
-
-    tile->GetOptimizedWayData().CopyData([&optimizedWayMap](const osmscout::WayRef& way) {
-      optimizedWayMap[way->GetFileOffset()]=way;
-    });
-
-    tile->GetWayData().CopyData([&wayMap](const osmscout::WayRef& way) {
-      wayMap[way->GetFileOffset()]=way;
-    });
-
-    //---
-
-    tile->GetOptimizedAreaData().CopyData([&optimizedAreaMap](const osmscout::AreaRef& area) {
-      optimizedAreaMap[area->GetFileOffset()]=area;
-    });
-
-    tile->GetAreaData().CopyData([&areaMap](const osmscout::AreaRef& area) {
-      areaMap[area->GetFileOffset()]=area;
-    });
-  }
-
-  for (auto tile : ringTiles) {
-    tile->GetNodeData().CopyData([&ringTypeDefinition,&nodeMap](const osmscout::NodeRef& node) {
-      if (ringTypeDefinition.nodeTypes.IsSet(node->GetType())) {
-        nodeMap[node->GetFileOffset()]=node;
-      }
-    });
-
-    //---
-
-    tile->GetOptimizedWayData().CopyData([&ringTypeDefinition,&optimizedWayMap](const osmscout::WayRef& way) {
-      if (ringTypeDefinition.optimizedWayTypes.IsSet(way->GetType())) {
-        optimizedWayMap[way->GetFileOffset()]=way;
-      }
-    });
-
-    tile->GetWayData().CopyData([&ringTypeDefinition,&wayMap](const osmscout::WayRef& way) {
-      if (ringTypeDefinition.wayTypes.IsSet(way->GetType())) {
-        wayMap[way->GetFileOffset()]=way;
-      }
-    });
-
-    //---
-
-    tile->GetOptimizedAreaData().CopyData([&ringTypeDefinition,&optimizedAreaMap](const osmscout::AreaRef& area) {
-      if (ringTypeDefinition.optimizedAreaTypes.IsSet(area->GetType())) {
-        optimizedAreaMap[area->GetFileOffset()]=area;
-      }
-    });
-
-    tile->GetAreaData().CopyData([&ringTypeDefinition,&areaMap](const osmscout::AreaRef& area) {
-      if (ringTypeDefinition.areaTypes.IsSet(area->GetType())) {
-        areaMap[area->GetFileOffset()]=area;
-      }
-    });
+private:
+  osmscout::MapPainterAgg    painter;
+  std::vector<unsigned char> metaBuffer;
+  agg::rendering_buffer      metaRBuf;
+  unsigned char*             mapBuffer;
+  size_t                     mapWidth;
+  uint32_t                   xTileStart;
+  uint32_t                   yTileStart;
+
+public:
+  AggCanvas(const osmscout::StyleConfigRef& styleConfig,
+            unsigned char* mapBuffer,
+            size_t mapWidth,
+            uint32_t xTileStart,
+            uint32_t yTileStart)
+  : painter(styleConfig),
+    mapBuffer(mapBuffer),
+    mapWidth(mapWidth),
+    xTileStart(xTileStart),
+    yTileStart(yTileStart)
+  {
+    // no code
   }
 
-  uniqueTime.Stop();
-
-  //std::cout << "Make data unique time: " << uniqueTime.ResultString() << std::endl;
+  bool DrawMetaTile(const osmscout::Projection& projection,
+                    const osmscout::MapParameter& parameter,
+                    const osmscout::MapData& data) override
+  {
+    metaBuffer.assign(projection.GetWidth()*projection.GetHeight()*3,0);
 
-  osmscout::StopClock copyTime;
+    metaRBuf.attach(metaBuffer.data(),
+                    (unsigned int)projection.GetWidth(),
+                    (unsigned int)projection.GetHeight(),
+                    (int)projection.GetWidth()*3);
 
-  data.nodes.reserve(nodeMap.size());
-  data.ways.reserve(wayMap.size()+optimizedWayMap.size());
-  data.areas.reserve(areaMap.size()+optimizedAreaMap.size());
-
-  for (const auto& nodeEntry : nodeMap) {
-    data.nodes.push_back(nodeEntry.second);
-  }
-
-  for (const auto& wayEntry : wayMap) {
-    data.ways.push_back(wayEntry.second);
-  }
+    agg::pixfmt_rgb24 pf(metaRBuf);
 
-  for (const auto& wayEntry : optimizedWayMap) {
-    data.ways.push_back(wayEntry.second);
+    return painter.DrawMap(projection,
+                           parameter,
+                           data,
+                           &pf);
   }
 
-  for (const auto& areaEntry : areaMap) {
-    data.areas.push_back(areaEntry.second);
-  }
+  bool StoreTile(const osmscout::OSMTileId& tile,
+                 const osmscout::Magnification& magnification,
+                 size_t x,
+                 size_t y,
+                 size_t width,
+                 size_t height) override
+  {
+    size_t mapX=(tile.GetX()-xTileStart)*width;
+    size_t mapY=(tile.GetY()-yTileStart)*height;
+
+    for (size_t row=0; row<height; row++) {
+      memcpy(mapBuffer+((mapY+row)*mapWidth+mapX)*3,
+             metaRBuf.row_ptr((int)(y+row))+x*3,
+             width*3);
+    }
 
-  for (const auto& areaEntry : optimizedAreaMap) {
-    data.areas.push_back(areaEntry.second);
-  }
+    agg::rendering_buffer tileRBuf(mapBuffer+(mapY*mapWidth+mapX)*3,
+                                   (unsigned int)width,
+                                   (unsigned int)height,
+                                   (int)mapWidth*3);
 
-  copyTime.Stop();
+    std::string output=osmscout::NumberToString(magnification.GetLevel())+"_"+osmscout::NumberToString(tile.GetX())+"_"+osmscout::NumberToString(tile.GetY())+".ppm";
 
-  if (copyTime.GetMilliseconds()>20) {
-    osmscout::log.Warn() << "Copying data from tile to MapData took " << copyTime.ResultString();
+    return write_ppm(tileRBuf,output.c_str());
   }
-}
+};
 
 int main(int argc, char* argv[])
 {
@@ -182,13 +154,15 @@ int main(int argc, char* argv[])
   double       latTop,latBottom,lonLeft,lonRight;
   unsigned int startLevel;
   unsigned int endLevel;
+  size_t       metaTileSize=4;
+  size_t       threadCount=0;
 
-  if (argc!=9) {
-    std::cerr << "DrawMap ";
+  if (argc<9 || argc>11) {
+    std::cerr << "Tiler ";
     std::cerr << "<map directory> <style-file> ";
     std::cerr << "<lat_top> <lon_left> <lat_bottom> <lon_right> ";
-    std::cerr << "<start_zoom>" << std::endl;
-    std::cerr << "<end_zoom>" << std::endl;
+    std::cerr << "<start_zoom> <end_zoom> ";
+    std::cerr << "[<meta tile size> [<thread count>]]" << std::endl;
     return 1;
   }
 
@@ -225,6 +199,18 @@ int main(int argc, char* argv[])
     return 1;
   }
 
+  if (argc>9 &&
+      (sscanf(argv[9],"%zu",&metaTileSize)!=1 || metaTileSize==0)) {
+    std::cerr << "meta tile size is not a positive number!" << std::endl;
+    return 1;
+  }
+
+  if (argc>10 &&
+      sscanf(argv[10],"%zu",&threadCount)!=1) {
+    std::cerr << "thread count is not numeric!" << std::endl;
+    return 1;
+  }
+
   osmscout::DatabaseParameter databaseParameter;
   osmscout::DatabaseRef       database=std::make_shared<osmscout::Database>(databaseParameter);
   osmscout::MapServiceRef     mapService=std::make_shared<osmscout::MapService>(database);
@@ -241,7 +227,6 @@ int main(int argc, char* argv[])
     std::cerr << "Cannot open style" << std::endl;
   }
 
-  osmscout::TileProjection      projection;
   osmscout::MapParameter        drawParameter;
   osmscout::AreaSearchParameter searchParameter;
 
@@ -258,184 +243,66 @@ int main(int argc, char* argv[])
   searchParameter.SetUseLowZoomOptimization(true);
   searchParameter.SetMaximumAreaLevel(3);
 
-  osmscout::MapPainterAgg painter(styleConfig);
+  osmscout::MetaTileRenderer renderer(mapService,
+                                      styleConfig);
+
+  renderer.SetMapParameter(drawParameter);
+  renderer.SetAreaSearchParameter(searchParameter);
+  renderer.SetTileSize(tileWidth,tileHeight);
+  renderer.SetDPI(DPI);
+  renderer.SetRingSize(tileRingSize);
+  renderer.SetMetaTileSize(metaTileSize);
+  renderer.SetThreadCount(threadCount);
 
   for (size_t level=std::min(startLevel,endLevel);
        level<=std::max(startLevel,endLevel);
        level++) {
     osmscout::Magnification magnification;
 
-    magnification.SetLevel(level);
-
-    osmscout::OSMTileId     tileA(osmscout::OSMTileId::GetOSMTile(osmscout::GeoCoord(latBottom,lonLeft),
-                                                                  magnification));
-    osmscout::OSMTileId     tileB(osmscout::OSMTileId::GetOSMTile(osmscout::GeoCoord(latTop,lonRight),
-                                                                  magnification));
-    uint32_t                xTileStart=std::min(tileA.GetX(),tileB.GetX());
-    uint32_t                xTileEnd=std::max(tileA.GetX(),tileB.GetX());
-    uint32_t                xTileCount=xTileEnd-xTileStart+1;
-    uint32_t                yTileStart=std::min(tileA.GetY(),tileB.GetY());
-    uint32_t                yTileEnd=std::max(tileA.GetY(),tileB.GetY());
-    uint32_t                yTileCount=yTileEnd-yTileStart+1;
-
-    std::cout << "Drawing zoom " << level << ", " << (xTileCount)*(yTileCount) << " tiles [" << xTileStart << "," << yTileStart << " - " <<  xTileEnd << "," << yTileEnd << "]" << std::endl;
-
-    unsigned long bitmapSize=tileWidth*tileHeight*3*xTileCount*yTileCount;
-    unsigned char *buffer=new unsigned char[bitmapSize];
-
-
-    memset(buffer,0,bitmapSize);
-
-    agg::rendering_buffer rbuf(buffer,
-                               tileWidth*xTileCount,
-                               tileHeight*yTileCount,
-                               tileWidth*xTileCount*3);
-
-    double minTime=std::numeric_limits<double>::max();
-    double maxTime=0.0;
-    double totalTime=0.0;
-
-    osmscout::MapService::TypeDefinition typeDefinition;
-
-    for (auto type : database->GetTypeConfig()->GetTypes()) {
-      bool hasLabel=false;
-
-      if (type->CanBeNode()) {
-        if (styleConfig->HasNodeTextStyles(type,
-                                           magnification)) {
-          typeDefinition.nodeTypes.Set(type);
-          hasLabel=true;
-        }
-      }
-
-      if (type->CanBeArea()) {
-        if (styleConfig->HasAreaTextStyles(type,
-                                           magnification)) {
-          if (type->GetOptimizeLowZoom() && searchParameter.GetUseLowZoomOptimization()) {
-            typeDefinition.optimizedAreaTypes.Set(type);
-          }
-          else {
-            typeDefinition.areaTypes.Set(type);
-          }
-
-          hasLabel=true;
-        }
-      }
-
-      if (hasLabel) {
-        std::cout << "TYPE " << type->GetName() << " might have labels" << std::endl;
-      }
-    }
-
-    for (uint32_t y=yTileStart; y<=yTileEnd; y++) {
-      for (uint32_t x=xTileStart; x<=xTileEnd; x++) {
-        agg::pixfmt_rgb24   pf(rbuf);
-        osmscout::StopClock timer;
-        osmscout::GeoBox    boundingBox;
-        osmscout::MapData   data;
-
-        projection.Set(osmscout::OSMTileId(x,y),
-                       magnification,
-                       DPI,
-                       tileWidth,
-                       tileHeight);
-
-        projection.GetDimensions(boundingBox);
-
-        std::cout << "Drawing tile " << level << "." << y << "." << x << " " << boundingBox.GetDisplayText() << std::endl;
-
-
-        std::list<osmscout::TileRef> centerTiles;
-
-        mapService->LookupTiles(magnification,
-                                boundingBox,
-                                centerTiles);
-
-        mapService->LoadMissingTileData(searchParameter,
-                                        *styleConfig,
-                                        centerTiles);
-
-        std::map<osmscout::TileId, osmscout::TileRef> ringTileMap;
-
-        for (uint32_t ringY=y-tileRingSize; ringY<=y+tileRingSize; ringY++) {
-          for (uint32_t ringX=x-tileRingSize; ringX<=x+tileRingSize; ringX++) {
-            if (ringX==x && ringY==y) {
-              continue;
-            }
-
-            osmscout::GeoBox boundingBox(osmscout::OSMTileId(ringX,ringY).GetBoundingBox(magnification));
-
-
-            std::list<osmscout::TileRef> tiles;
-
-            mapService->LookupTiles(magnification,
-                                    boundingBox,
-                                    tiles);
-
-            for (const auto& tile : tiles) {
-              ringTileMap[tile->GetId()]=tile;
-            }
-          }
-        }
-
-        std::list<osmscout::TileRef> ringTiles;
-
-        for (const auto& tileEntry : ringTileMap) {
-          ringTiles.push_back(tileEntry.second);
-        }
-
-        mapService->LoadMissingTileData(searchParameter,
-                                        magnification,
-                                        typeDefinition,
-                                        ringTiles);
-
-        MergeTilesToMapData(centerTiles,
-                            typeDefinition,
-                            ringTiles,
-                            data);
-
-        size_t bufferOffset=xTileCount*tileWidth*3*(y-yTileStart)*tileHeight+
-                            (x-xTileStart)*tileWidth*3;
-
-        rbuf.attach(buffer+bufferOffset,
-                    tileWidth,tileHeight,
-                    tileWidth*xTileCount*3);
-
-        painter.DrawMap(projection,
-                        drawParameter,
-                        data,
-                        &pf);
-
-        timer.Stop();
-
-        double time=timer.GetMilliseconds();
-
-        minTime=std::min(minTime,time);
-        maxTime=std::max(maxTime,time);
-        totalTime+=time;
-
-        std::string output=osmscout::NumberToString(level)+"_"+osmscout::NumberToString(x)+"_"+osmscout::NumberToString(y)+".ppm";
-
-        write_ppm(rbuf,output.c_str());
-      }
+    magnification.SetLevel((uint32_t)level);
+
+    osmscout::OSMTileIdBox  tileBox(osmscout::OSMTileId::GetOSMTile(osmscout::GeoCoord(latBottom,lonLeft),
+                                                                    magnification),
+                                    osmscout::OSMTileId::GetOSMTile(osmscout::GeoCoord(latTop,lonRight),
+                                                                    magnification));
+    uint32_t                xTileCount=tileBox.GetWidth();
+    uint32_t                yTileCount=tileBox.GetHeight();
+
+    std::cout << "Drawing zoom " << level << ", " << tileBox.GetCount() << " tiles " << tileBox.GetDisplayText() << std::endl;
+
+    size_t                     mapWidth=tileWidth*xTileCount;
+    std::vector<unsigned char> buffer(mapWidth*tileHeight*yTileCount*3,0);
+
+    osmscout::MetaTileRenderer::LevelStatistics statistics;
+
+    if (!renderer.RenderLevel(magnification,
+                              tileBox,
+                              [&]() {
+                                return std::make_shared<AggCanvas>(styleConfig,
+                                                                   buffer.data(),
+                                                                   mapWidth,
+                                                                   tileBox.GetMinX(),
+                                                                   tileBox.GetMinY());
+                              },
+                              statistics)) {
+      std::cerr << "Error while drawing zoom " << level << std::endl;
     }
 
-    rbuf.attach(buffer,
-                tileWidth*xTileCount,
-                tileHeight*yTileCount,
-                tileWidth*xTileCount*3);
+    agg::rendering_buffer rbuf(buffer.data(),
+                               (unsigned int)mapWidth,
+                               tileHeight*yTileCount,
+                               (int)mapWidth*3);
 
     std::string output=osmscout::NumberToString(level)+"_full_map.ppm";
 
     write_ppm(rbuf,output.c_str());
 
-    delete[] buffer;
-
-    std::cout << "=> Time: ";
-    std::cout << "total: " << totalTime << " msec ";
-    std::cout << "min: " << minTime << " msec ";
-    std::cout << "avg: " << totalTime/(xTileCount*yTileCount) << " msec ";
-    std::cout << "max: " << maxTime << " msec" << std::endl;
+    std::cout << "=> Zoom " << statistics.level << ": ";
+    std::cout << statistics.tileCount << " tiles in " << statistics.metaTileCount << " meta tiles, ";
+    std::cout << "data: " << statistics.dataTime << " sec ";
+    std::cout << "draw: " << statistics.drawTime << " sec ";
+    std::cout << "total: " << statistics.totalTime << " sec ";
+    std::cout << "=> " << statistics.GetTilesPerSecond() << " tiles/sec" << std::endl;
   }
 
   database->Close();
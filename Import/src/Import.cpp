@@ -26,6 +26,7 @@
 #include <string>
 #include <vector>
 
+#include <osmscout/util/BlockCompressedFile.h>
 #include <osmscout/util/CmdLineParsing.h>
 #include <osmscout/util/File.h>
 #include <osmscout/util/String.h>
@@ -82,6 +83,9 @@ void DumpHelp(osmscout::ImportParameter& parameter)
   std::cout << std::endl;
 
   std::cout << " --numericIndexPageSize <number>      size of an numeric index page in bytes (default: " << parameter.GetNumericIndexPageSize() << ")" << std::endl;
+  std::cout << " --columnarCoords true|false          store coordinates in columnar encoding (default: " << osmscout::BoolToString(parameter.GetColumnarCoords()) << ")" << std::endl;
+  std::cout << " --compressDataFiles true|false       block compress large data files (default: " << osmscout::BoolToString(parameter.GetCompressDataFiles()) << ")" << std::endl;
+  std::cout << " --compressionBlockSize <number>      size of a block of compressed data files (default: " << parameter.GetCompressionBlockSize() << ")" << std::endl;
 
   std::cout << " --rawCoordBlockSize <number>         number of raw coords resolved in block (default: " << parameter.GetRawCoordBlockSize() << ")" << std::endl;
 
@@ -106,6 +110,9 @@ void DumpHelp(osmscout::ImportParameter& parameter)
   std::cout << " --wayDataCacheSize <number>          way data cache size (default: " << parameter.GetWayDataCacheSize() << ")" << std::endl;
 
   std::cout << " --routeNodeBlockSize <number>        number of route nodes resolved in block (default: " << parameter.GetRouteNodeBlockSize() << ")" << std::endl;
+  std::cout << " --contractionHierarchies true|false  generate contraction hierarchies for routing (default: " << osmscout::BoolToString(parameter.GetContractionHierarchies()) << ")" << std::endl;
+  std::cout << " --landmarks <number>                 number of landmarks for routing, 0 for none (default: " << parameter.GetLandmarkCount() << ")" << std::endl;
+  std::cout << " --routeSegmentIndex true|false       generate index of routable way segments (default: " << osmscout::BoolToString(parameter.GetRouteSegmentIndex()) << ")" << std::endl;
   std::cout << std::endl;
   std::cout << " --langOrder <#|lang1[,#|lang2]..>    language order when parsing lang[:language] and place_name[:language] tags" << std::endl
             << "                                      # is the default language (no :language) (default: #)" << std::endl;
@@ -265,6 +272,12 @@ static void DumpParameter(const osmscout::ImportParameter& parameter,
 
   progress.Info(std::string("NumericIndexPageSize: ")+
                 osmscout::NumberToString(parameter.GetNumericIndexPageSize()));
+  progress.Info(std::string("ColumnarCoords: ")+
+                (parameter.GetColumnarCoords() ? "true" : "false"));
+  progress.Info(std::string("CompressDataFiles: ")+
+                (parameter.GetCompressDataFiles() ? "true" : "false"));
+  progress.Info(std::string("CompressionBlockSize: ")+
+                osmscout::NumberToString(parameter.GetCompressionBlockSize()));
 
   progress.Info(std::string("RawCoordBlockSize: ")+
                 osmscout::NumberToString(parameter.GetRawCoordBlockSize()));
@@ -306,6 +319,12 @@ static void DumpParameter(const osmscout::ImportParameter& parameter,
 
   progress.Info(std::string("RouteNodeBlockSize: ")+
                 osmscout::NumberToString(parameter.GetRouteNodeBlockSize()));
+  progress.Info(std::string("ContractionHierarchies: ")+
+                (parameter.GetContractionHierarchies() ? "true" : "false"));
+  progress.Info(std::string("Landmarks: ")+
+                osmscout::NumberToString(parameter.GetLandmarkCount()));
+  progress.Info(std::string("RouteSegmentIndex: ")+
+                (parameter.GetRouteSegmentIndex() ? "true" : "false"));
 
 
   progress.Info(std::string("MaxAdminLevel: ")+
@@ -552,6 +571,48 @@ int main(int argc, char* argv[])
         parameterError=true;
       }
     }
+    else if (strcmp(argv[i],"--columnarCoords")==0) {
+      bool columnarCoords;
+
+      if (osmscout::ParseBoolArgument(argc,
+                                      argv,
+                                      i,
+                                      columnarCoords)) {
+        parameter.SetColumnarCoords(columnarCoords);
+      }
+      else {
+        parameterError=true;
+      }
+    }
+    else if (strcmp(argv[i],"--compressDataFiles")==0) {
+      bool compressDataFiles;
+
+      if (osmscout::ParseBoolArgument(argc,
+                                      argv,
+                                      i,
+                                      compressDataFiles)) {
+        parameter.SetCompressDataFiles(compressDataFiles);
+      }
+      else {
+        parameterError=true;
+      }
+    }
+    else if (strcmp(argv[i],"--compressionBlockSize")==0) {
+      size_t compressionBlockSize;
+
+      if (osmscout::ParseSizeTArgument(argc,
+                                       argv,
+                                       i,
+                                       compressionBlockSize)) {
+        if (!parameter.SetCompressionBlockSize(compressionBlockSize)) {
+          std::cerr << "Compression block size must be between 1 and " << osmscout::BlockCompressedFileReader::MAX_BLOCK_SIZE << std::endl;
+          parameterError=true;
+        }
+      }
+      else {
+        parameterError=true;
+      }
+    }
     else if (strcmp(argv[i],"--rawCoordBlockSize")==0) {
       size_t rawCoordBlockSize;
 
@@ -752,6 +813,45 @@ int main(int argc, char* argv[])
         parameterError=true;
       }
     }
+    else if (strcmp(argv[i],"--contractionHierarchies")==0) {
+      bool contractionHierarchies;
+
+      if (osmscout::ParseBoolArgument(argc,
+                                      argv,
+                                      i,
+                                      contractionHierarchies)) {
+        parameter.SetContractionHierarchies(contractionHierarchies);
+      }
+      else {
+        parameterError=true;
+      }
+    }
+    else if (strcmp(argv[i],"--landmarks")==0) {
+      size_t landmarkCount;
+
+      if (osmscout::ParseSizeTArgument(argc,
+                                       argv,
+                                       i,
+                                       landmarkCount)) {
+        parameter.SetLandmarkCount(landmarkCount);
+      }
+      else {
+        parameterError=true;
+      }
+    }
+    else if (strcmp(argv[i],"--routeSegmentIndex")==0) {
+      bool routeSegmentIndex;
+
+      if (osmscout::ParseBoolArgument(argc,
+                                      argv,
+                                      i,
+                                      routeSegmentIndex)) {
+        parameter.SetRouteSegmentIndex(routeSegmentIndex);
+      }
+      else {
+        parameterError=true;
+      }
+    }
     else if (strcmp(argv[i],"--langOrder")==0) {
         std::vector<std::string> langOrder;
 
@@ -0,0 +1,312 @@
+/*
+  BlockCompressionPerformance - a test program for libosmscout
+  Copyright (C) 2017  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <osmscout/util/BlockCompressedFile.h>
+#include <osmscout/util/File.h>
+#include <osmscout/util/FileScanner.h>
+#include <osmscout/util/FileWriter.h>
+#include <osmscout/util/StopClock.h>
+#include <osmscout/util/String.h>
+
+/**
+  Measure the trade-off of block compressed data files:
+  * the size of the compressed file compared to the original file
+  * the time for reading records at random offsets from the original file
+    and from the compressed file (using different sizes of the block cache)
+  * the number of bytes read from disk, estimated for the original file by
+    the number of distinct 4 KiB pages touched, and for the compressed file
+    by the number of compressed bytes of all inflated blocks
+
+  Call with the name of an existing data file (for example ways.dat of an import),
+  the number of reads and the block size as optional parameters. If no file is given,
+  a file with synthetic way-like records is generated.
+*/
+
+static const char*  generatedFilename="blockcompression.dat";
+static const char*  compressedFilename="blockcompression.dat.z";
+static const size_t recordSize=256;
+static const size_t pageSize=4096;
+
+static bool GenerateData(const std::string& filename)
+{
+  static const char* names[]={"Main Street","High Street","Station Road","Church Lane","Park Avenue",
+                              "Mill Road","School Lane","Victoria Road","Green Lane","Manor Road"};
+
+  std::mt19937                           generator(4711);
+  std::uniform_int_distribution<size_t>  typeDistribution(1,120);
+  std::uniform_int_distribution<size_t>  nameDistribution(0,9);
+  std::uniform_int_distribution<size_t>  nodeCountDistribution(2,60);
+  std::uniform_real_distribution<double> deltaDistribution(-0.0005,0.0005);
+  osmscout::FileWriter                   writer;
+
+  try {
+    writer.Open(filename);
+
+    uint32_t recordCount=500000;
+
+    writer.Write(recordCount);
+
+    for (uint32_t r=0; r<recordCount; r++) {
+      std::vector<osmscout::Point> nodes(nodeCountDistribution(generator));
+      double                       lat=50.0+(r%1000)*0.001;
+      double                       lon=7.0+(r/1000)*0.001;
+
+      for (auto& node : nodes) {
+        lat+=deltaDistribution(generator);
+        lon+=deltaDistribution(generator);
+
+        node.Set(0,osmscout::GeoCoord(lat,lon));
+      }
+
+      writer.WriteTypeId((osmscout::TypeId)typeDistribution(generator),2);
+      writer.Write(std::string(names[nameDistribution(generator)]));
+      writer.WriteNumber((uint32_t)r);
+      writer.Write(nodes,false);
+    }
+
+    writer.Close();
+  }
+  catch (osmscout::IOException& e) {
+    std::cerr << e.GetDescription() << std::endl;
+    writer.CloseFailsafe();
+    return false;
+  }
+
+  return true;
+}
+
+static bool ReadPlain(const std::string& filename,
+                      const std::vector<osmscout::FileOffset>& offsets,
+                      bool useMmap)
+{
+  osmscout::FileScanner scanner;
+  std::vector<char>     record(recordSize);
+  std::set<size_t>      pages;
+  size_t                checksum=0;
+
+  try {
+    scanner.Open(filename,osmscout::FileScanner::LowMemRandom,useMmap);
+
+    osmscout::StopClock timer;
+
+    for (const auto offset : offsets) {
+      scanner.SetPos(offset);
+      scanner.Read(record.data(),recordSize);
+
+      checksum+=(unsigned char)record[recordSize-1];
+    }
+
+    timer.Stop();
+
+    for (const auto offset : offsets) {
+      for (size_t page=offset/pageSize; page<=(offset+recordSize-1)/pageSize; page++) {
+        pages.insert(page);
+      }
+    }
+
+    std::cout << "Plain" << (useMmap ? " (mmap)" : "") << ": " << timer << ", ";
+    std::cout << osmscout::ByteSizeToString((double)(pages.size()*pageSize)) << " read from disk (checksum " << checksum << ")" << std::endl;
+
+    scanner.Close();
+  }
+  catch (osmscout::IOException& e) {
+    std::cerr << e.GetDescription() << std::endl;
+    scanner.CloseFailsafe();
+    return false;
+  }
+
+  return true;
+}
+
+static bool ReadCompressed(const std::vector<osmscout::FileOffset>& offsets,
+                           size_t cacheSize)
+{
+  std::FILE         *file=std::fopen(compressedFilename,"rb");
+  std::vector<char> record(recordSize);
+  size_t            checksum=0;
+
+  if (file==NULL) {
+    std::cerr << "Cannot open '" << compressedFilename << "'" << std::endl;
+    return false;
+  }
+
+  try {
+    osmscout::BlockCompressedFileReader reader(compressedFilename,
+                                               file,
+                                               std::make_shared<osmscout::BlockCompressedFileCache>(cacheSize*osmscout::BlockCompressedFileReader::DEFAULT_BLOCK_SIZE));
+
+    reader.Open();
+
+    osmscout::StopClock timer;
+
+    for (const auto offset : offsets) {
+      if (reader.Read(offset,record.data(),recordSize)!=recordSize) {
+        std::cerr << "Cannot read record at offset " << offset << std::endl;
+        std::fclose(file);
+        return false;
+      }
+
+      checksum+=(unsigned char)record[recordSize-1];
+    }
+
+    timer.Stop();
+
+    std::cout << "Compressed, cache size " << cacheSize << " blocks: " << timer << ", ";
+    std::cout << reader.GetInflatedBlocks() << " blocks inflated, ";
+    std::cout << osmscout::ByteSizeToString((double)reader.GetCompressedBytesRead()) << " read from disk (checksum " << checksum << ")" << std::endl;
+  }
+  catch (osmscout::IOException& e) {
+    std::cerr << e.GetDescription() << std::endl;
+    std::fclose(file);
+    return false;
+  }
+
+  std::fclose(file);
+
+  return true;
+}
+
+static bool RunReads(const std::string& filename,
+                     const std::vector<osmscout::FileOffset>& offsets)
+{
+  if (!ReadPlain(filename,offsets,false) ||
+      !ReadPlain(filename,offsets,true)) {
+    return false;
+  }
+
+  for (size_t cacheSize : {0,16,64,256,1024}) {
+    if (!ReadCompressed(offsets,cacheSize)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+  std::string filename;
+  size_t      readCount=100000;
+  size_t      blockSize=osmscout::BlockCompressedFileReader::DEFAULT_BLOCK_SIZE;
+
+  if (!osmscout::IsBlockCompressionSupported()) {
+    std::cerr << "Library was built without support for block compressed files!" << std::endl;
+    return 1;
+  }
+
+  if (argc>1) {
+    filename=argv[1];
+  }
+
+  if (argc>2) {
+    readCount=std::strtoul(argv[2],NULL,10);
+  }
+
+  if (argc>3) {
+    blockSize=std::strtoul(argv[3],NULL,10);
+  }
+
+  if (filename.empty()) {
+    filename=generatedFilename;
+
+    std::cout << "Generating '" << filename << "'..." << std::endl;
+
+    if (!GenerateData(filename)) {
+      return 1;
+    }
+  }
+
+  osmscout::FileOffset size;
+
+  try {
+    size=osmscout::GetFileSize(filename);
+
+    if (size<recordSize) {
+      std::cerr << "File '" << filename << "' is too small!" << std::endl;
+      return 1;
+    }
+
+    osmscout::StopClock compressTimer;
+
+    osmscout::CompressFileInBlocks(filename,
+                                   compressedFilename,
+                                   blockSize);
+
+    compressTimer.Stop();
+
+    osmscout::FileOffset compressedSize=osmscout::GetFileSize(compressedFilename);
+
+    std::cout << "*** Size ***" << std::endl;
+    std::cout << "Original: " << osmscout::ByteSizeToString(size) << ", compressed: " << osmscout::ByteSizeToString(compressedSize);
+    std::cout << " (block size " << blockSize << ", ratio " << (double)size/compressedSize << ", compression took " << compressTimer << ")" << std::endl;
+  }
+  catch (osmscout::IOException& e) {
+    std::cerr << e.GetDescription() << std::endl;
+    return 1;
+  }
+
+  std::mt19937                                        generator(815);
+  std::uniform_int_distribution<osmscout::FileOffset> offsetDistribution(0,size-recordSize);
+  std::vector<osmscout::FileOffset>                   offsets;
+
+  offsets.reserve(readCount);
+
+  for (size_t i=0; i<readCount; i++) {
+    offsets.push_back(offsetDistribution(generator));
+  }
+
+  std::cout << "*** Random reads of " << readCount << " records with " << recordSize << " bytes ***" << std::endl;
+
+  if (!RunReads(filename,offsets)) {
+    return 1;
+  }
+
+  // Reads of objects close to each other, as for rendering a map area
+  std::uniform_int_distribution<osmscout::FileOffset> windowDistribution(0,std::min(size-recordSize,(osmscout::FileOffset)(4*1024*1024)));
+  osmscout::FileOffset                                windowStart=offsetDistribution(generator);
+
+  for (auto& offset : offsets) {
+    offset=std::min(windowStart+windowDistribution(generator),size-recordSize);
+  }
+
+  std::sort(offsets.begin(),offsets.end());
+
+  std::cout << "*** Sorted reads of " << readCount << " records with " << recordSize << " bytes in a 4 MiB window ***" << std::endl;
+
+  if (!RunReads(filename,offsets)) {
+    return 1;
+  }
+
+  std::remove(compressedFilename);
+
+  if (filename==generatedFilename) {
+    std::remove(generatedFilename);
+  }
+
+  return 0;
+}
@@ -0,0 +1,427 @@
+/*
+  CacheManagerClients - a test program for libosmscout
+  Copyright (C) 2017  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <osmscout/Database.h>
+
+#include <osmscout/routing/SimpleRoutingService.h>
+
+#include <osmscout/util/CacheManager.h>
+#include <osmscout/util/File.h>
+
+#include <osmscout/import/Import.h>
+
+/*
+ * Imports a synthetic grid of streets and cafes and opens it twice: once with the default
+ * caches and once with all caches registered with a cache manager with a tiny budget.
+ * Index lookups and routes must return the same results for both databases, the
+ * cache manager must stay within its budget and all memory must be given back
+ * on close.
+ */
+
+static const size_t gridSize=20;
+static const size_t queryCount=60;
+static const size_t cacheBudget=64*1024;
+
+class ErrorProgress : public osmscout::Progress
+{
+public:
+  void Error(const std::string& text) override
+  {
+    std::cerr << "Import error: " << text << std::endl;
+  }
+};
+
+static uint32_t NextRandom(uint32_t& seed)
+{
+  seed=seed*1103515245+12345;
+
+  return (seed >> 8) & 0xffffff;
+}
+
+static osmscout::Id GetNodeId(size_t row,
+                              size_t column)
+{
+  return row*gridSize+column+1;
+}
+
+static osmscout::GeoCoord GetCoord(size_t row,
+                                   size_t column)
+{
+  return osmscout::GeoCoord(51.0+row*0.002,
+                            7.0+column*0.003);
+}
+
+static bool MakeDirectory(const std::string& directory)
+{
+  if (osmscout::ExistsInFilesystem(directory)) {
+    return osmscout::IsDirectory(directory);
+  }
+
+#if defined(_WIN32)
+  return _mkdir(directory.c_str())==0;
+#else
+  return mkdir(directory.c_str(),0755)==0;
+#endif
+}
+
+static void WriteWay(std::ostream& stream,
+                     size_t id,
+                     osmscout::Id from,
+                     osmscout::Id to)
+{
+  stream << "<way id=\"" << id << "\" version=\"1\">" << std::endl;
+  stream << "<nd ref=\"" << from << "\"/>" << std::endl;
+  stream << "<nd ref=\"" << to << "\"/>" << std::endl;
+  stream << "<tag k=\"highway\" v=\"residential\"/>" << std::endl;
+  stream << "</way>" << std::endl;
+}
+
+/**
+ * Write a grid of nodes connected by streets, every third node is a cafe
+ */
+static bool WriteGrid(const std::string& filename)
+{
+  std::ofstream stream(filename.c_str());
+  size_t        wayId=1;
+
+  stream << std::fixed << std::setprecision(7);
+  stream << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>" << std::endl;
+  stream << "<osm version=\"0.6\" generator=\"CacheManagerClients\">" << std::endl;
+
+  for (size_t row=0; row<gridSize; row++) {
+    for (size_t column=0; column<gridSize; column++) {
+      osmscout::GeoCoord coord=GetCoord(row,column);
+
+      stream << "<node id=\"" << GetNodeId(row,column) << "\" lat=\"" << coord.GetLat() << "\" lon=\"" << coord.GetLon() << "\" version=\"1\"";
+
+      if (GetNodeId(row,column)%3==0) {
+        stream << ">" << std::endl;
+        stream << "<tag k=\"amenity\" v=\"cafe\"/>" << std::endl;
+        stream << "</node>" << std::endl;
+      }
+      else {
+        stream << "/>" << std::endl;
+      }
+    }
+  }
+
+  for (size_t row=0; row<gridSize; row++) {
+    for (size_t column=0; column<gridSize; column++) {
+      if (column+1<gridSize) {
+        WriteWay(stream,
+                 wayId++,
+                 GetNodeId(row,column),
+                 GetNodeId(row,column+1));
+      }
+
+      if (row+1<gridSize) {
+        WriteWay(stream,
+                 wayId++,
+                 GetNodeId(row,column),
+                 GetNodeId(row+1,column));
+      }
+    }
+  }
+
+  stream << "</osm>" << std::endl;
+
+  stream.close();
+
+  return !stream.fail();
+}
+
+static bool ImportGrid(const std::string& stylesheetDir,
+                       const std::string& databaseDir,
+                       const std::string& osmFile)
+{
+  osmscout::ImportParameter parameter;
+  ErrorProgress             progress;
+
+  parameter.SetTypefile(osmscout::AppendFileToDir(stylesheetDir,"map.ost"));
+  parameter.SetDestinationDirectory(databaseDir);
+  parameter.SetMapfiles({osmFile});
+  parameter.AddRouter(osmscout::ImportParameter::Router(osmscout::vehicleCar,
+                                                        osmscout::RoutingService::DEFAULT_FILENAME_BASE));
+
+  osmscout::Importer importer(parameter);
+
+  return importer.Import(progress);
+}
+
+static bool CheckBudget(const osmscout::CacheManager& cacheManager,
+                        const std::string& context)
+{
+  if (cacheManager.GetMemory()>cacheManager.GetMaxMemory()) {
+    std::cerr << context << ": cache manager holds " << cacheManager.GetMemory() << " bytes, more than its budget of " << cacheManager.GetMaxMemory() << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+static osmscout::GeoBox GetRandomBox(uint32_t& seed)
+{
+  size_t rowStart=NextRandom(seed)%gridSize;
+  size_t columnStart=NextRandom(seed)%gridSize;
+  size_t rowEnd=std::min(rowStart+NextRandom(seed)%6,gridSize-1);
+  size_t columnEnd=std::min(columnStart+NextRandom(seed)%6,gridSize-1);
+
+  osmscout::GeoCoord minCoord=GetCoord(rowStart,columnStart);
+  osmscout::GeoCoord maxCoord=GetCoord(rowEnd,columnEnd);
+
+  return osmscout::GeoBox(osmscout::GeoCoord(minCoord.GetLat()-0.0005,minCoord.GetLon()-0.0005),
+                          osmscout::GeoCoord(maxCoord.GetLat()+0.0005,maxCoord.GetLon()+0.0005));
+}
+
+static int CheckIndexes(const osmscout::Database& database,
+                        const osmscout::Database& managedDatabase,
+                        const osmscout::CacheManager& cacheManager)
+{
+  int                   failures=0;
+  osmscout::TypeInfoSet nodeTypes;
+  osmscout::TypeInfoSet wayTypes(database.GetTypeConfig()->GetWayTypes());
+  uint32_t              seed=4711;
+
+  nodeTypes.Set(database.GetTypeConfig()->GetTypeInfo("amenity_cafe"));
+
+  for (size_t query=0; query<queryCount; query++) {
+    osmscout::GeoBox                  boundingBox=GetRandomBox(seed);
+    std::vector<osmscout::FileOffset> nodeOffsets;
+    std::vector<osmscout::FileOffset> managedNodeOffsets;
+    std::vector<osmscout::FileOffset> wayOffsets;
+    std::vector<osmscout::FileOffset> managedWayOffsets;
+    osmscout::TypeInfoSet             loadedTypes;
+
+    if (!database.GetAreaNodeIndex()->GetOffsets(boundingBox,nodeTypes,nodeOffsets,loadedTypes) ||
+        !managedDatabase.GetAreaNodeIndex()->GetOffsets(boundingBox,nodeTypes,managedNodeOffsets,loadedTypes) ||
+        !database.GetAreaWayIndex()->GetOffsets(boundingBox,wayTypes,wayOffsets,loadedTypes) ||
+        !managedDatabase.GetAreaWayIndex()->GetOffsets(boundingBox,wayTypes,managedWayOffsets,loadedTypes)) {
+      std::cerr << "Cannot query area indexes for " << boundingBox.GetDisplayText() << std::endl;
+      failures++;
+      continue;
+    }
+
+    std::sort(nodeOffsets.begin(),nodeOffsets.end());
+    std::sort(managedNodeOffsets.begin(),managedNodeOffsets.end());
+    std::sort(wayOffsets.begin(),wayOffsets.end());
+    std::sort(managedWayOffsets.begin(),managedWayOffsets.end());
+
+    if (nodeOffsets.empty() ||
+        nodeOffsets!=managedNodeOffsets) {
+      std::cerr << "Area node index returns " << managedNodeOffsets.size() << " instead of " << nodeOffsets.size() << " node(s) for " << boundingBox.GetDisplayText() << std::endl;
+      failures++;
+    }
+
+    if (wayOffsets.empty() ||
+        wayOffsets!=managedWayOffsets) {
+      std::cerr << "Area way index returns " << managedWayOffsets.size() << " instead of " << wayOffsets.size() << " way(s) for " << boundingBox.GetDisplayText() << std::endl;
+      failures++;
+    }
+
+    if (!CheckBudget(cacheManager,"Index query")) {
+      failures++;
+    }
+  }
+
+  return failures;
+}
+
+static int CheckRoutes(const osmscout::DatabaseRef& database,
+                       const osmscout::DatabaseRef& managedDatabase,
+                       const osmscout::CacheManager& cacheManager)
+{
+  int                                 failures=0;
+  osmscout::FastestPathRoutingProfile profile(database->GetTypeConfig());
+  osmscout::RouterParameter           routerParameter;
+  osmscout::ImportParameter           importParameter;
+  osmscout::RoutingParameter          parameter;
+  uint32_t                            seed=815;
+
+  profile.ParametrizeForCar(*database->GetTypeConfig(),
+                            importParameter.GetCarSpeedTable(),
+                            importParameter.GetCarMaxSpeed());
+
+  osmscout::SimpleRoutingService router(database,
+                                        routerParameter,
+                                        osmscout::RoutingService::DEFAULT_FILENAME_BASE);
+  osmscout::SimpleRoutingService managedRouter(managedDatabase,
+                                               routerParameter,
+                                               osmscout::RoutingService::DEFAULT_FILENAME_BASE);
+
+  if (!router.Open() ||
+      !managedRouter.Open()) {
+    std::cerr << "Cannot open routing databases" << std::endl;
+    return 1;
+  }
+
+  for (size_t query=0; query<queryCount/4; query++) {
+    osmscout::GeoCoord start=GetCoord(NextRandom(seed)%gridSize,NextRandom(seed)%gridSize);
+    osmscout::GeoCoord target=GetCoord(NextRandom(seed)%gridSize,NextRandom(seed)%gridSize);
+    double             radius=100.0;
+
+    osmscout::RoutePosition startPosition=managedRouter.GetClosestRoutableNode(start,profile,radius);
+
+    radius=100.0;
+
+    osmscout::RoutePosition targetPosition=managedRouter.GetClosestRoutableNode(target,profile,radius);
+
+    if (!startPosition.IsValid() ||
+        !targetPosition.IsValid()) {
+      std::cerr << "Cannot find route position for " << start.GetDisplayText() << " or " << target.GetDisplayText() << std::endl;
+      failures++;
+      continue;
+    }
+
+    osmscout::RoutingResult result=router.CalculateRoute(profile,startPosition,targetPosition,parameter);
+    osmscout::RoutingResult managedResult=managedRouter.CalculateRoute(profile,startPosition,targetPosition,parameter);
+
+    if (result.Success()!=managedResult.Success()) {
+      std::cerr << "Route from " << start.GetDisplayText() << " to " << target.GetDisplayText() << " only found by one router" << std::endl;
+      failures++;
+    }
+    else if (result.Success()) {
+      const auto& entries=result.GetRoute().Entries();
+      const auto& managedEntries=managedResult.GetRoute().Entries();
+
+      if (entries.size()!=managedEntries.size() ||
+          !std::equal(entries.begin(),
+                      entries.end(),
+                      managedEntries.begin(),
+                      [](const osmscout::RouteData::RouteEntry& a, const osmscout::RouteData::RouteEntry& b) {
+                        return a.GetPathObject()==b.GetPathObject() &&
+                               a.GetCurrentNodeIndex()==b.GetCurrentNodeIndex() &&
+                               a.GetTargetNodeIndex()==b.GetTargetNodeIndex();
+                      })) {
+        std::cerr << "Routes from " << start.GetDisplayText() << " to " << target.GetDisplayText() << " differ" << std::endl;
+        failures++;
+      }
+    }
+
+    if (!CheckBudget(cacheManager,"Routing")) {
+      failures++;
+    }
+  }
+
+  managedRouter.Close();
+  router.Close();
+
+  return failures;
+}
+
+int main(int /*argc*/, char** /*argv*/)
+{
+  char* testsTopDirEnv=getenv("TESTS_TOP_DIR");
+
+  if (testsTopDirEnv==NULL) {
+    std::cerr << "Expected environment variable 'TESTS_TOP_DIR' not set" << std::endl;
+    // CMake-based tests would fail, if we do not exit here
+    return 1;
+  }
+
+  std::string testsTopDir=testsTopDirEnv;
+
+  if (testsTopDir.empty()) {
+    std::cerr << "Environment variable 'TESTS_TOP_DIR' is empty" << std::endl;
+    return 77;
+  }
+
+  std::string stylesheetDir=osmscout::AppendFileToDir(testsTopDir,"../stylesheets");
+
+  if (!osmscout::IsDirectory(stylesheetDir)) {
+    std::cerr << "Calculated stylesheet directory does not point to directory" << std::endl;
+    return 77;
+  }
+
+  std::string databaseDir="CacheManagerClients.db";
+  std::string osmFile=osmscout::AppendFileToDir(databaseDir,"grid.osm");
+
+  if (!MakeDirectory(databaseDir)) {
+    std::cerr << "Cannot create directory '" << databaseDir << "'" << std::endl;
+    return 1;
+  }
+
+  if (!WriteGrid(osmFile)) {
+    std::cerr << "Cannot write '" << osmFile << "'" << std::endl;
+    return 1;
+  }
+
+  if (!ImportGrid(stylesheetDir,
+                  databaseDir,
+                  osmFile)) {
+    std::cerr << "Cannot import '" << osmFile << "'" << std::endl;
+    return 1;
+  }
+
+  osmscout::CacheManagerRef   cacheManager=std::make_shared<osmscout::CacheManager>(cacheBudget);
+  osmscout::DatabaseParameter databaseParameter;
+  osmscout::DatabaseParameter managedDatabaseParameter;
+
+  managedDatabaseParameter.SetCacheManager(cacheManager);
+
+  osmscout::DatabaseRef database=std::make_shared<osmscout::Database>(databaseParameter);
+  osmscout::DatabaseRef managedDatabase=std::make_shared<osmscout::Database>(managedDatabaseParameter);
+
+  if (!database->Open(databaseDir) ||
+      !managedDatabase->Open(databaseDir)) {
+    std::cerr << "Cannot open database '" << databaseDir << "'" << std::endl;
+    return 1;
+  }
+
+  int failures=0;
+
+  failures+=CheckRoutes(database,
+                        managedDatabase,
+                        *cacheManager);
+  failures+=CheckIndexes(*database,
+                         *managedDatabase,
+                         *cacheManager);
+
+  if (cacheManager->GetMemory()==0) {
+    std::cerr << "No cache allocated memory from the cache manager" << std::endl;
+    failures++;
+  }
+
+  managedDatabase->Close();
+  database->Close();
+
+  if (cacheManager->GetMemory()!=0) {
+    std::cerr << "Cache manager still holds " << cacheManager->GetMemory() << " bytes after closing the database" << std::endl;
+    failures++;
+  }
+
+  if (failures==0) {
+    std::cout << "All lookups with managed caches return the same results" << std::endl;
+  }
+
+  return failures;
+}
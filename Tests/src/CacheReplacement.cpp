@@ -0,0 +1,243 @@
+#include <iostream>
+
+#include <osmscout/util/Cache.h>
+#include <osmscout/util/CacheManager.h>
+
+typedef osmscout::Cache<osmscout::Id,size_t> TestCache;
+
+int errors=0;
+
+static void CheckEntry(TestCache& cache,
+                       osmscout::Id key,
+                       bool expected)
+{
+  TestCache::CacheRef ref;
+
+  bool found=cache.GetEntry(key,ref);
+
+  if (found!=expected) {
+    std::cerr << "Entry " << key << (expected ? " not found in cache!" : " unexpectedly found in cache!") << std::endl;
+    errors++;
+  }
+  else if (found && ref->value!=key*10) {
+    std::cerr << "Entry " << key << " has value " << ref->value << " instead of " << key*10 << std::endl;
+    errors++;
+  }
+}
+
+static void CheckCountLimit()
+{
+  TestCache cache(4);
+
+  for (osmscout::Id i=1; i<=4; i++) {
+    cache.SetEntry(TestCache::CacheEntry(i,i*10));
+  }
+
+  // Mark 1 and 3 as referenced, so 2 is the first candidate for eviction
+  CheckEntry(cache,1,true);
+  CheckEntry(cache,3,true);
+
+  cache.SetEntry(TestCache::CacheEntry(5,50));
+
+  if (cache.GetSize()!=4) {
+    std::cerr << "Cache has size " << cache.GetSize() << " instead of 4!" << std::endl;
+    errors++;
+  }
+
+  CheckEntry(cache,1,true);
+  CheckEntry(cache,2,false);
+  CheckEntry(cache,3,true);
+  CheckEntry(cache,5,true);
+
+  if (cache.GetHits()!=5 ||
+      cache.GetMisses()!=1) {
+    std::cerr << "Cache has " << cache.GetHits() << " hits and " << cache.GetMisses() << " misses instead of 5 and 1!" << std::endl;
+    errors++;
+  }
+}
+
+static void CheckMemoryLimit()
+{
+  TestCache cache(1000,1000);
+
+  // Ten small entries...
+  for (osmscout::Id i=1; i<=10; i++) {
+    cache.SetEntry(TestCache::CacheEntry(i,i*10),10);
+  }
+
+  if (cache.GetMemory()!=100) {
+    std::cerr << "Cache uses " << cache.GetMemory() << " bytes instead of 100!" << std::endl;
+    errors++;
+  }
+
+  // ...and one large one, requiring other entries to be evicted
+  cache.SetEntry(TestCache::CacheEntry(11,110),950);
+
+  if (cache.GetMemory()>1000) {
+    std::cerr << "Cache uses " << cache.GetMemory() << " bytes, more than its limit!" << std::endl;
+    errors++;
+  }
+
+  CheckEntry(cache,11,true);
+
+  if (cache.GetSize()!=6) {
+    std::cerr << "Cache has size " << cache.GetSize() << " instead of 6!" << std::endl;
+    errors++;
+  }
+
+  // Entries larger than the complete cache are not cached at all
+  cache.SetEntry(TestCache::CacheEntry(12,120),2000);
+
+  CheckEntry(cache,12,false);
+  CheckEntry(cache,11,true);
+
+  cache.SetMaxMemory(500);
+
+  CheckEntry(cache,11,false);
+
+  if (cache.GetMemory()>500) {
+    std::cerr << "Cache uses " << cache.GetMemory() << " bytes, more than its new limit!" << std::endl;
+    errors++;
+  }
+
+  cache.Flush();
+
+  if (cache.GetSize()!=0 ||
+      cache.GetMemory()!=0) {
+    std::cerr << "Cache is not empty after flush!" << std::endl;
+    errors++;
+  }
+}
+
+static void CheckMemoryOnlyLimit()
+{
+  TestCache cache(TestCache::NO_SIZE_LIMIT,1000);
+
+  // Many small entries fit as long as their memory fits
+  for (osmscout::Id i=1; i<=100; i++) {
+    cache.SetEntry(TestCache::CacheEntry(i,i*10),10);
+  }
+
+  if (cache.GetSize()!=100 ||
+      cache.GetMemory()!=1000) {
+    std::cerr << "Cache has size " << cache.GetSize() << " and " << cache.GetMemory() << " bytes instead of 100 and 1000!" << std::endl;
+    errors++;
+  }
+
+  cache.SetEntry(TestCache::CacheEntry(101,1010),100);
+
+  if (cache.GetSize()!=91 ||
+      cache.GetMemory()>1000) {
+    std::cerr << "Cache has size " << cache.GetSize() << " and " << cache.GetMemory() << " bytes instead of 91 and 1000!" << std::endl;
+    errors++;
+  }
+
+  CheckEntry(cache,101,true);
+}
+
+/**
+ * Minimal cache manager client wrapping a cache
+ */
+class ManagedCache : public osmscout::CacheManager::Client
+{
+public:
+  osmscout::CacheManager& manager;
+  TestCache               cache;
+
+  explicit ManagedCache(osmscout::CacheManager& manager)
+  : manager(manager),
+    cache(1000)
+  {
+    manager.Register(*this);
+  }
+
+  ~ManagedCache()
+  {
+    manager.Free(cache.GetMemory());
+    manager.Unregister(*this);
+  }
+
+  void Set(osmscout::Id key)
+  {
+    size_t memoryBefore=cache.GetMemory();
+
+    cache.SetEntry(TestCache::CacheEntry(key,key*10),100);
+
+    manager.Allocate(*this,cache.GetMemory()-memoryBefore);
+  }
+
+  bool Get(osmscout::Id key)
+  {
+    TestCache::CacheRef ref;
+
+    if (!cache.GetEntry(key,ref)) {
+      return false;
+    }
+
+    manager.Touch(*this);
+
+    return true;
+  }
+
+  size_t TrimCache(size_t memory) override
+  {
+    return cache.Trim(memory);
+  }
+};
+
+static void CheckCacheManager()
+{
+  osmscout::CacheManager manager(1000);
+  ManagedCache           idle(manager);
+  ManagedCache           hot(manager);
+
+  for (osmscout::Id i=1; i<=5; i++) {
+    idle.Set(i);
+  }
+
+  for (osmscout::Id i=1; i<=5; i++) {
+    hot.Set(i);
+  }
+
+  if (manager.GetMemory()!=1000) {
+    std::cerr << "Cache manager accounts " << manager.GetMemory() << " bytes instead of 1000!" << std::endl;
+    errors++;
+  }
+
+  // Exceeding the budget should take memory from the idle cache, not from the hot one
+  hot.Set(6);
+  hot.Set(7);
+
+  if (manager.GetMemory()>1000) {
+    std::cerr << "Cache manager accounts " << manager.GetMemory() << " bytes, more than its budget!" << std::endl;
+    errors++;
+  }
+
+  if (idle.cache.GetSize()!=3 ||
+      hot.cache.GetSize()!=7) {
+    std::cerr << "Idle cache has " << idle.cache.GetSize() << " and hot cache " << hot.cache.GetSize() << " entries instead of 3 and 7!" << std::endl;
+    errors++;
+  }
+
+  for (osmscout::Id i=1; i<=7; i++) {
+    if (!hot.Get(i)) {
+      std::cerr << "Entry " << i << " not found in hot cache!" << std::endl;
+      errors++;
+    }
+  }
+}
+
+int main()
+{
+  CheckCountLimit();
+  CheckMemoryLimit();
+  CheckMemoryOnlyLimit();
+  CheckCacheManager();
+
+  if (errors!=0) {
+    return 1;
+  }
+  else {
+    return 0;
+  }
+}
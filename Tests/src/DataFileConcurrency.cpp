@@ -0,0 +1,353 @@
+/*
+  DataFileConcurrency - a test program for libosmscout
+  Copyright (C) 2017  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <atomic>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <osmscout/DataFile.h>
+#include <osmscout/TypeConfig.h>
+
+#include <osmscout/util/BlockCompressedFile.h>
+#include <osmscout/util/CacheManager.h>
+#include <osmscout/util/FileScanner.h>
+#include <osmscout/util/FileWriter.h>
+
+/**
+ * Writes a data file with objects of different size and reads them from several threads
+ * in parallel, using single and batch reads and block spans, with a small object cache,
+ * so most reads have to go to the file.
+ *
+ * The same is done for a block compressed copy of the data file, with the data file
+ * registered with a cache manager, to check the block cache shared by the scanners.
+ */
+
+static const char*    dataFilename="DataFileConcurrency.dat";
+static const char*    compressedFilename="DataFileConcurrency.dat.z";
+static const size_t   compressionBlockSize=1000;
+static const size_t   cacheManagerMemory=256*1024;
+static const uint32_t objectCount=20000;
+static const size_t   threadCount=8;
+static const size_t   iterationCount=2000;
+
+/**
+ * Simple data object: an id followed by a number of values depending on the id
+ */
+class TestData
+{
+public:
+  osmscout::FileOffset  fileOffset;
+  osmscout::FileOffset  nextFileOffset;
+  uint32_t              id;
+  std::vector<uint32_t> values;
+
+public:
+  static size_t GetValueCount(uint32_t id)
+  {
+    return id%37;
+  }
+
+  static uint32_t GetValue(uint32_t id,
+                           size_t index)
+  {
+    return id*31+(uint32_t)index;
+  }
+
+  inline osmscout::FileOffset GetFileOffset() const
+  {
+    return fileOffset;
+  }
+
+  inline osmscout::FileOffset GetNextFileOffset() const
+  {
+    return nextFileOffset;
+  }
+
+  void Read(const osmscout::TypeConfig& /*typeConfig*/,
+            osmscout::FileScanner& scanner)
+  {
+    uint32_t valueCount;
+
+    fileOffset=scanner.GetPos();
+
+    scanner.ReadNumber(id);
+    scanner.ReadNumber(valueCount);
+
+    values.resize(valueCount);
+
+    for (auto& value : values) {
+      scanner.Read(value);
+    }
+
+    nextFileOffset=scanner.GetPos();
+  }
+
+  static void Write(osmscout::FileWriter& writer,
+                    uint32_t id)
+  {
+    size_t valueCount=GetValueCount(id);
+
+    writer.WriteNumber(id);
+    writer.WriteNumber((uint32_t)valueCount);
+
+    for (size_t i=0; i<valueCount; i++) {
+      writer.Write(GetValue(id,i));
+    }
+  }
+
+  bool IsValid(uint32_t expectedId) const
+  {
+    if (id!=expectedId ||
+        values.size()!=GetValueCount(id)) {
+      return false;
+    }
+
+    for (size_t i=0; i<values.size(); i++) {
+      if (values[i]!=GetValue(id,i)) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+};
+
+typedef osmscout::DataFile<TestData> TestDataFile;
+
+static bool WriteDataFile(std::vector<osmscout::FileOffset>& offsets)
+{
+  osmscout::FileWriter writer;
+
+  try {
+    writer.Open(dataFilename);
+
+    for (uint32_t id=0; id<objectCount; id++) {
+      offsets.push_back(writer.GetPos());
+      TestData::Write(writer,
+                      id);
+    }
+
+    writer.Close();
+  }
+  catch (osmscout::IOException& e) {
+    std::cerr << e.GetDescription() << std::endl;
+    writer.CloseFailsafe();
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * Random single, batch and block span reads, counting all wrong results
+ */
+static void ReadData(const TestDataFile& dataFile,
+                     const std::vector<osmscout::FileOffset>& offsets,
+                     unsigned int seed,
+                     std::atomic<size_t>& errorCount)
+{
+  std::mt19937                            generator(seed);
+  std::uniform_int_distribution<uint32_t> idDistribution(0,objectCount-1);
+
+  for (size_t iteration=0; iteration<iterationCount; iteration++) {
+    switch (iteration%3) {
+    case 0: {
+      uint32_t                 id=idDistribution(generator);
+      TestDataFile::ValueType value;
+
+      if (!dataFile.GetByOffset(offsets[id],
+                                value) ||
+          !value->IsValid(id)) {
+        errorCount++;
+      }
+      break;
+    }
+    case 1: {
+      std::vector<uint32_t>                ids;
+      std::vector<osmscout::FileOffset>    batchOffsets;
+      std::vector<TestDataFile::ValueType> values;
+
+      for (size_t i=0; i<50; i++) {
+        ids.push_back(idDistribution(generator));
+        batchOffsets.push_back(offsets[ids.back()]);
+      }
+
+      if (!dataFile.GetByOffset(batchOffsets.begin(),
+                                batchOffsets.end(),
+                                batchOffsets.size(),
+                                values) ||
+          values.size()!=ids.size()) {
+        errorCount++;
+        break;
+      }
+
+      for (size_t i=0; i<ids.size(); i++) {
+        if (!values[i]->IsValid(ids[i])) {
+          errorCount++;
+        }
+      }
+      break;
+    }
+    default: {
+      uint32_t                             id=idDistribution(generator);
+      osmscout::DataBlockSpan              span;
+      std::vector<TestDataFile::ValueType> values;
+
+      span.startOffset=offsets[id];
+      span.count=std::min((uint32_t)20,objectCount-id);
+
+      if (!dataFile.GetByBlockSpan(span,
+                                   values) ||
+          values.size()!=span.count) {
+        errorCount++;
+        break;
+      }
+
+      for (size_t i=0; i<values.size(); i++) {
+        if (!values[i]->IsValid(id+(uint32_t)i)) {
+          errorCount++;
+        }
+      }
+    }
+    }
+  }
+}
+
+static size_t CheckConcurrentReads(const osmscout::TypeConfigRef& typeConfig,
+                                   const std::vector<osmscout::FileOffset>& offsets,
+                                   const std::string& filename,
+                                   bool memoryMapedData,
+                                   const osmscout::CacheManagerRef& cacheManager)
+{
+  TestDataFile dataFile(filename,
+                        1000);
+
+  dataFile.SetCacheManager(cacheManager);
+
+  if (!dataFile.Open(typeConfig,
+                     ".",
+                     memoryMapedData)) {
+    std::cerr << "Cannot open data file" << std::endl;
+    return 1;
+  }
+
+  std::atomic<size_t>      errorCount(0);
+  std::vector<std::thread> threads;
+
+  for (size_t t=0; t<threadCount; t++) {
+    threads.push_back(std::thread(ReadData,
+                                  std::cref(dataFile),
+                                  std::cref(offsets),
+                                  (unsigned int)t,
+                                  std::ref(errorCount)));
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  if (dataFile.GetIdleScannerCount()>TestDataFile::MAX_IDLE_SCANNERS) {
+    std::cerr << "Scanner pool holds " << dataFile.GetIdleScannerCount() << " idle scanners" << std::endl;
+    errorCount++;
+  }
+
+  if (cacheManager) {
+    // The block cache must be accounted for, too
+    if (cacheManager->GetMemory()<=dataFile.GetCacheMemory()) {
+      std::cerr << "Cache manager does not account for the block cache: " << cacheManager->GetMemory() << " bytes" << std::endl;
+      errorCount++;
+    }
+
+    if (cacheManager->GetMemory()>cacheManager->GetMaxMemory()) {
+      std::cerr << "Cache manager exceeds its budget: " << cacheManager->GetMemory() << " bytes" << std::endl;
+      errorCount++;
+    }
+  }
+
+  std::cout << "File: " << filename << ", ";
+  std::cout << "memory mapped: " << (memoryMapedData ? "true" : "false") << ", ";
+  std::cout << "cache hits: " << dataFile.GetCacheHits() << ", misses: " << dataFile.GetCacheMisses() << ", ";
+  std::cout << "errors: " << errorCount << std::endl;
+
+  if (!dataFile.Close()) {
+    errorCount++;
+  }
+
+  if (cacheManager &&
+      cacheManager->GetMemory()!=0) {
+    std::cerr << "Cache manager memory not freed on close: " << cacheManager->GetMemory() << " bytes" << std::endl;
+    errorCount++;
+  }
+
+  return errorCount;
+}
+
+int main(int /*argc*/, char** /*argv*/)
+{
+  std::vector<osmscout::FileOffset> offsets;
+
+  if (!WriteDataFile(offsets)) {
+    return 1;
+  }
+
+  osmscout::TypeConfigRef typeConfig=std::make_shared<osmscout::TypeConfig>();
+  size_t                  errorCount=0;
+
+  errorCount+=CheckConcurrentReads(typeConfig,
+                                   offsets,
+                                   dataFilename,
+                                   false,
+                                   osmscout::CacheManagerRef());
+  errorCount+=CheckConcurrentReads(typeConfig,
+                                   offsets,
+                                   dataFilename,
+                                   true,
+                                   osmscout::CacheManagerRef());
+
+  if (osmscout::IsBlockCompressionSupported()) {
+    try {
+      osmscout::CompressFileInBlocks(dataFilename,
+                                     compressedFilename,
+                                     compressionBlockSize);
+
+      errorCount+=CheckConcurrentReads(typeConfig,
+                                       offsets,
+                                       compressedFilename,
+                                       false,
+                                       std::make_shared<osmscout::CacheManager>(cacheManagerMemory));
+    }
+    catch (osmscout::IOException& e) {
+      std::cerr << e.GetDescription() << std::endl;
+      errorCount++;
+    }
+
+    std::remove(compressedFilename);
+  }
+
+  std::remove(dataFilename);
+
+  if (errorCount>0) {
+    return 1;
+  }
+  else {
+    return 0;
+  }
+}
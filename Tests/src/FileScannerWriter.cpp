@@ -2,6 +2,8 @@
 #include <iostream>
 #include <limits>
 
+#include <osmscout/util/BlockCompressedFile.h>
+#include <osmscout/util/File.h>
 #include <osmscout/util/FileScanner.h>
 #include <osmscout/util/FileWriter.h>
 
@@ -93,6 +95,7 @@ int main()
   std::vector<osmscout::Point> inCoords7;
 
   osmscout::FileOffset  finalReadFileOffset;
+  osmscout::FileOffset  coordsFileOffset;
 
   outCoords1.push_back(osmscout::Point(0,osmscout::GeoCoord(51.57231,7.46418)));
   outCoords1.push_back(osmscout::Point(0,osmscout::GeoCoord(51.57233,7.46430)));
@@ -341,6 +344,8 @@ int main()
       errors++;
     }
 
+    coordsFileOffset=scanner.GetPos();
+
     scanner.Read(inCoords1,false);
     if (!Equals(inCoords1,outCoords1)) {
       std::cerr << "Read/Write(std::vector<GeoCoord>) 1: Expected ";
@@ -453,6 +458,216 @@ int main()
       std::cout << std::endl;
       errors++;
     }
+
+    scanner.Close();
+
+    // Read(CoordBlockView), with and without memory mapped file access
+
+    for (bool useMmap : {false,true}) {
+      osmscout::FileScanner        viewScanner;
+      osmscout::CoordBlockView     view;
+      std::vector<osmscout::Point> viewCoords;
+      size_t                       idx=1;
+
+      viewScanner.Open("test.dat",osmscout::FileScanner::Normal,useMmap);
+      viewScanner.SetPos(coordsFileOffset);
+
+      for (const auto outCoords : {&outCoords1,&outCoords2,&outCoords3,&outCoords4,&outCoords5,&outCoords6,&outCoords7}) {
+        viewScanner.Read(view,false);
+        view.Decode(viewCoords);
+
+        if (!Equals(viewCoords,*outCoords)) {
+          std::cerr << "Read(CoordBlockView) " << idx << " (mmap: " << useMmap << "): Expected " << outCoords->size() << " coordinates, got " << viewCoords.size() << std::endl;
+          errors++;
+        }
+
+        idx++;
+      }
+
+      if (viewScanner.GetPos()!=finalWriteFileOffset) {
+        std::cerr << "Final file offset check for CoordBlockView: Expected " << finalWriteFileOffset << ", got " << viewScanner.GetPos() << std::endl;
+        errors++;
+      }
+
+      viewScanner.Close();
+    }
+
+    // Columnar coordinate encoding, with deltas of different sizes and node serials
+
+    std::vector<osmscout::Point> outCoords8;
+
+    for (size_t i=0; i<1000; i++) {
+      double latOffset=(i%7==0) ? 0.5 : ((i%3==0) ? 0.01 : 0.00001);
+      double lonOffset=(i%11==0) ? -0.7 : ((i%5==0) ? -0.02 : 0.00002);
+
+      outCoords8.push_back(osmscout::Point(i%13==0 ? (uint8_t)(i%200+1) : 0,
+                                           osmscout::GeoCoord(10.0+(i%2==0 ? latOffset : -latOffset),
+                                                              20.0+(i%2==0 ? lonOffset : -lonOffset))));
+    }
+
+    writer.Open("columnar.dat");
+    writer.SetColumnarCoords(true);
+
+    writer.Write(outCoords1,false);
+    writer.Write(outCoords2,false);
+    writer.Write(outCoords3,false);
+    writer.Write(outCoords4,false);
+    writer.Write(outCoords5,false);
+    writer.Write(outCoords6,false);
+    writer.Write(outCoords8,true);
+    writer.Write(outCoords7,false);
+
+    finalWriteFileOffset=writer.GetPos();
+
+    writer.Close();
+
+    for (bool useMmap : {false,true}) {
+      std::vector<osmscout::Point> inCoords;
+      size_t                       idx=1;
+
+      scanner.Open("columnar.dat",osmscout::FileScanner::Normal,useMmap);
+
+      for (const auto outCoords : {&outCoords1,&outCoords2,&outCoords3,&outCoords4,&outCoords5,&outCoords6,&outCoords8,&outCoords7}) {
+        bool readIds=outCoords==&outCoords8;
+
+        scanner.Read(inCoords,readIds);
+
+        if (!Equals(inCoords,*outCoords)) {
+          std::cerr << "Read/Write(std::vector<Point>) columnar " << idx << " (mmap: " << useMmap << "): Expected " << outCoords->size() << " coordinates, got " << inCoords.size() << std::endl;
+          errors++;
+        }
+        else if (readIds) {
+          for (size_t i=0; i<inCoords.size(); i++) {
+            if (inCoords[i].GetSerial()!=(*outCoords)[i].GetSerial()) {
+              std::cerr << "Read/Write(std::vector<Point>) columnar " << idx << " (mmap: " << useMmap << "): Serial difference at offset " << i << std::endl;
+              errors++;
+              break;
+            }
+          }
+        }
+
+        idx++;
+      }
+
+      if (scanner.GetPos()!=finalWriteFileOffset) {
+        std::cerr << "Final file offset check for columnar encoding: Expected " << finalWriteFileOffset << ", got " << scanner.GetPos() << std::endl;
+        errors++;
+      }
+
+      scanner.Close();
+
+      osmscout::CoordBlockView     view;
+      std::vector<osmscout::Point> viewCoords;
+
+      idx=1;
+
+      scanner.Open("columnar.dat",osmscout::FileScanner::Normal,useMmap);
+
+      for (const auto outCoords : {&outCoords1,&outCoords2,&outCoords3,&outCoords4,&outCoords5,&outCoords6,&outCoords8,&outCoords7}) {
+        scanner.Read(view,outCoords==&outCoords8);
+        view.Decode(viewCoords);
+
+        if (!Equals(viewCoords,*outCoords)) {
+          std::cerr << "Read(CoordBlockView) columnar " << idx << " (mmap: " << useMmap << "): Expected " << outCoords->size() << " coordinates, got " << viewCoords.size() << std::endl;
+          errors++;
+        }
+
+        idx++;
+      }
+
+      if (scanner.GetPos()!=finalWriteFileOffset) {
+        std::cerr << "Final file offset check for columnar CoordBlockView: Expected " << finalWriteFileOffset << ", got " << scanner.GetPos() << std::endl;
+        errors++;
+      }
+
+      scanner.Close();
+    }
+
+    // Block compressed file, with a small block size so that values cross block boundaries
+
+    if (osmscout::IsBlockCompressionSupported()) {
+      osmscout::FileScanner plainScanner;
+      std::vector<char>     plainData;
+      std::vector<char>     compressedData;
+      osmscout::FileOffset  plainFileSize=osmscout::GetFileSize("test.dat");
+
+      osmscout::CompressFileInBlocks("test.dat","test.dat.z",1000);
+
+      plainScanner.Open("test.dat",osmscout::FileScanner::Normal,false);
+      scanner.Open("test.dat.z",osmscout::FileScanner::Normal,true);
+
+      if (!scanner.IsBlockCompressed()) {
+        std::cerr << "Block compressed file not detected" << std::endl;
+        errors++;
+      }
+
+      for (size_t chunkSize : {1,7,999,1000,4093}) {
+        plainScanner.GotoBegin();
+        scanner.GotoBegin();
+
+        plainData.resize(chunkSize);
+        compressedData.resize(chunkSize);
+
+        for (osmscout::FileOffset pos=0; pos+chunkSize<=plainFileSize; pos+=chunkSize*31) {
+          plainScanner.SetPos(pos);
+          scanner.SetPos(pos);
+
+          plainScanner.Read(plainData.data(),chunkSize);
+          scanner.Read(compressedData.data(),chunkSize);
+
+          if (plainData!=compressedData) {
+            std::cerr << "Block compressed file: Difference in chunk of size " << chunkSize << " at offset " << pos << std::endl;
+            errors++;
+            break;
+          }
+
+          if (scanner.GetPos()!=pos+chunkSize) {
+            std::cerr << "Block compressed file: Expected position " << pos+chunkSize << ", got " << scanner.GetPos() << std::endl;
+            errors++;
+            break;
+          }
+        }
+      }
+
+      plainScanner.Close();
+
+      std::vector<osmscout::Point> inCoords;
+      size_t                       idx=1;
+
+      scanner.SetPos(coordsFileOffset);
+
+      for (const auto outCoords : {&outCoords1,&outCoords2,&outCoords3,&outCoords4,&outCoords5,&outCoords6,&outCoords7}) {
+        scanner.Read(inCoords,false);
+
+        if (!Equals(inCoords,*outCoords)) {
+          std::cerr << "Read(std::vector<Point>) from block compressed file " << idx << ": Expected " << outCoords->size() << " coordinates, got " << inCoords.size() << std::endl;
+          errors++;
+        }
+
+        idx++;
+      }
+
+      if (scanner.GetPos()!=plainFileSize ||
+          !scanner.IsEOF()) {
+        std::cerr << "Final file offset check for block compressed file: Expected " << plainFileSize << ", got " << scanner.GetPos() << std::endl;
+        errors++;
+      }
+
+      scanner.Close();
+
+      // Block sizes that cannot be stored in the file header must be rejected
+
+      for (size_t blockSize : {(size_t)0,(size_t)osmscout::BlockCompressedFileReader::MAX_BLOCK_SIZE+1}) {
+        try {
+          osmscout::CompressFileInBlocks("test.dat","test.dat.z",blockSize);
+          std::cerr << "Block compressed file: Invalid block size " << blockSize << " accepted" << std::endl;
+          errors++;
+        }
+        catch (osmscout::IOException&) {
+          // Expected
+        }
+      }
+    }
   }
   catch (osmscout::IOException& e) {
     std::cerr << e.GetDescription() << std::endl;
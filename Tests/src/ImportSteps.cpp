@@ -0,0 +1,74 @@
+/*
+  ImportSteps - a test program for libosmscout
+  Copyright (C) 2017  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <osmscout/import/Import.h>
+
+static std::string GetModuleName(const osmscout::ImportParameter& parameter,
+                                 const osmscout::ImportModuleRef& module)
+{
+  osmscout::ImportModuleDescription description;
+
+  module->GetDescription(parameter,
+                         description);
+
+  return description.GetName();
+}
+
+int main(int /*argc*/, char** /*argv*/)
+{
+  int                                    failures=0;
+  osmscout::ImportParameter              parameter;
+  std::vector<osmscout::ImportModuleRef> modules;
+
+  osmscout::Importer::GetModuleList(modules);
+
+  std::cout << "Number of import modules: " << modules.size() << std::endl;
+
+  if (modules.empty() ||
+      GetModuleName(parameter,modules.front())!="TypeDataGenerator") {
+    std::cerr << "First import module is not the type data generator" << std::endl;
+    failures++;
+  }
+
+  if (modules.empty() ||
+      GetModuleName(parameter,modules.back())!="CompressedDataGenerator") {
+    std::cerr << "Last import module is not the compressed data generator" << std::endl;
+    failures++;
+  }
+
+  if (parameter.GetStartStep()!=1 ||
+      parameter.GetEndStep()!=modules.size()) {
+    std::cerr << "Default steps " << parameter.GetStartStep() << " - " << parameter.GetEndStep();
+    std::cerr << " do not cover all " << modules.size() << " import modules" << std::endl;
+    failures++;
+  }
+
+  parameter.SetStartStep(3);
+
+  if (parameter.GetEndStep()!=modules.size()) {
+    std::cerr << "Setting the start step does not reset the end step to the last module" << std::endl;
+    failures++;
+  }
+
+  return failures;
+}
@@ -0,0 +1,360 @@
+/*
+  LabelLayouter - a test program for libosmscout
+  Copyright (C) 2017  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include <osmscout/LabelLayouter.h>
+#include <osmscout/MapParameter.h>
+
+#include <osmscout/util/Projection.h>
+
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+
+/*
+ * The canvas is 256x192 pixel, so the layouter uses a grid of 4x3 cells of 64 pixel.
+ * With 25.4 DPI one millimeter is one pixel, so labels need 3 pixel space,
+ * shields 5 pixel.
+ */
+static const size_t canvasWidth=256;
+static const size_t canvasHeight=192;
+static const double labelHeight=10.0;
+
+static const osmscout::LabelStyleRef textStyle=std::make_shared<osmscout::TextStyle>();
+static const osmscout::LabelStyleRef shieldStyle=std::make_shared<osmscout::ShieldStyle>();
+
+static void InitializeLayouter(osmscout::LabelLayouter& layouter,
+                               bool dropNotVisiblePointLabels=false)
+{
+  osmscout::MercatorProjection projection;
+  osmscout::MapParameter       parameter;
+  osmscout::Magnification      magnification;
+
+  magnification.SetLevel(10);
+
+  REQUIRE(projection.Set(osmscout::GeoCoord(0.0,0.0),
+                         magnification,
+                         25.4,
+                         canvasWidth,
+                         canvasHeight));
+
+  parameter.SetLabelSpace(3.0);
+  parameter.SetPlateLabelSpace(5.0);
+  parameter.SetSameLabelSpace(40.0);
+  parameter.SetDropNotVisiblePointLabels(dropNotVisiblePointLabels);
+
+  layouter.Initialize(projection,
+                      parameter);
+}
+
+static osmscout::LabelData CreateLabel(size_t id,
+                                       size_t priority,
+                                       double x,
+                                       double y,
+                                       double width,
+                                       const std::string& text,
+                                       const osmscout::LabelStyleRef& style=textStyle)
+{
+  osmscout::LabelData label;
+
+  label.id=id;
+  label.priority=priority;
+  label.bx1=x;
+  label.by1=y;
+  label.bx2=x+width;
+  label.by2=y+labelHeight;
+  label.x=x;
+  label.y=y;
+  label.alpha=1.0;
+  label.fontSize=1.0;
+  label.style=style;
+  label.text=text;
+
+  return label;
+}
+
+/**
+ * Place the labels in the given order and return the ids of all labels
+ * remaining in the layouter
+ */
+static std::set<size_t> PlaceLabels(osmscout::LabelLayouter& layouter,
+                                    const std::vector<osmscout::LabelData>& labels)
+{
+  osmscout::LabelDataRef labelRef;
+
+  for (const auto& label : labels) {
+    layouter.Placelabel(label,
+                        labelRef);
+  }
+
+  std::set<size_t> placed;
+
+  for (const auto& label : layouter) {
+    placed.insert(label.id);
+  }
+
+  return placed;
+}
+
+TEST_CASE("Labels without intersection are all placed") {
+  osmscout::LabelLayouter layouter;
+
+  InitializeLayouter(layouter);
+
+  std::vector<osmscout::LabelData> labels={CreateLabel(1,1,10.0,10.0,20.0,"A"),
+                                           CreateLabel(2,1,40.0,10.0,20.0,"B"),
+                                           CreateLabel(3,1,10.0,30.0,20.0,"C"),
+                                           CreateLabel(4,1,33.0,30.0,20.0,"D")};
+
+  REQUIRE(PlaceLabels(layouter,labels)==std::set<size_t>({1,2,3,4}));
+  REQUIRE(layouter.Size()==4);
+  REQUIRE(layouter.GetLabelsAdded()==4);
+}
+
+TEST_CASE("Labels closer than the label space intersect") {
+  osmscout::LabelLayouter layouter;
+
+  InitializeLayouter(layouter);
+
+  std::vector<osmscout::LabelData> labels={CreateLabel(1,1,10.0,10.0,20.0,"A"),
+                                           CreateLabel(2,2,32.0,10.0,20.0,"B"),
+                                           CreateLabel(3,2,10.0,22.0,20.0,"C")};
+
+  REQUIRE(PlaceLabels(layouter,labels)==std::set<size_t>({1}));
+}
+
+TEST_CASE("Label with higher priority wins") {
+  osmscout::LabelLayouter layouter;
+
+  osmscout::LabelData high=CreateLabel(1,1,10.0,10.0,20.0,"High");
+  osmscout::LabelData low=CreateLabel(2,5,20.0,12.0,20.0,"Low");
+
+  SECTION("Higher priority first") {
+    InitializeLayouter(layouter);
+    REQUIRE(PlaceLabels(layouter,{high,low})==std::set<size_t>({1}));
+  }
+
+  SECTION("Lower priority first") {
+    InitializeLayouter(layouter);
+    REQUIRE(PlaceLabels(layouter,{low,high})==std::set<size_t>({1}));
+  }
+}
+
+TEST_CASE("Labels with same priority and different text drop each other") {
+  osmscout::LabelLayouter layouter;
+
+  osmscout::LabelData first=CreateLabel(1,1,10.0,10.0,20.0,"First");
+  osmscout::LabelData second=CreateLabel(2,1,20.0,12.0,20.0,"Second");
+  osmscout::LabelData other=CreateLabel(3,1,100.0,10.0,20.0,"Other");
+
+  SECTION("Left label first") {
+    InitializeLayouter(layouter);
+    REQUIRE(PlaceLabels(layouter,{first,other,second})==std::set<size_t>({3}));
+  }
+
+  SECTION("Right label first") {
+    InitializeLayouter(layouter);
+    REQUIRE(PlaceLabels(layouter,{second,other,first})==std::set<size_t>({3}));
+  }
+}
+
+TEST_CASE("Labels with same priority and same text keep the left label") {
+  osmscout::LabelLayouter layouter;
+
+  osmscout::LabelData left=CreateLabel(1,1,10.0,10.0,20.0,"Name");
+  osmscout::LabelData right=CreateLabel(2,1,20.0,12.0,20.0,"Name");
+
+  SECTION("Left label first") {
+    InitializeLayouter(layouter);
+    REQUIRE(PlaceLabels(layouter,{left,right})==std::set<size_t>({1}));
+  }
+
+  SECTION("Right label first") {
+    InitializeLayouter(layouter);
+    REQUIRE(PlaceLabels(layouter,{right,left})==std::set<size_t>({1}));
+  }
+}
+
+TEST_CASE("Labels with the same id do not intersect") {
+  osmscout::LabelLayouter layouter;
+
+  InitializeLayouter(layouter);
+
+  std::vector<osmscout::LabelData> labels={CreateLabel(1,1,10.0,10.0,20.0,"Icon"),
+                                           CreateLabel(1,1,10.0,12.0,20.0,"Text")};
+
+  REQUIRE(PlaceLabels(layouter,labels).size()==1);
+  REQUIRE(layouter.Size()==2);
+}
+
+TEST_CASE("Shields use the plate label space") {
+  osmscout::LabelLayouter layouter;
+
+  SECTION("Shields closer than the plate label space") {
+    InitializeLayouter(layouter);
+
+    std::vector<osmscout::LabelData> labels={CreateLabel(1,1,10.0,10.0,20.0,"A1",shieldStyle),
+                                             CreateLabel(2,1,34.0,10.0,20.0,"A2",shieldStyle)};
+
+    REQUIRE(PlaceLabels(layouter,labels).empty());
+  }
+
+  SECTION("Shields outside of the plate label space") {
+    InitializeLayouter(layouter);
+
+    std::vector<osmscout::LabelData> labels={CreateLabel(1,1,10.0,10.0,20.0,"A1",shieldStyle),
+                                             CreateLabel(2,1,36.0,10.0,20.0,"A2",shieldStyle)};
+
+    REQUIRE(PlaceLabels(layouter,labels)==std::set<size_t>({1,2}));
+  }
+
+  SECTION("Shield and text label use the label space") {
+    InitializeLayouter(layouter);
+
+    std::vector<osmscout::LabelData> labels={CreateLabel(1,1,10.0,10.0,20.0,"A1",shieldStyle),
+                                             CreateLabel(2,1,34.0,10.0,20.0,"A2")};
+
+    REQUIRE(PlaceLabels(layouter,labels)==std::set<size_t>({1,2}));
+  }
+}
+
+TEST_CASE("Labels crossing cell borders") {
+  osmscout::LabelLayouter layouter;
+
+  SECTION("Labels in neighbouring cells intersect by label space") {
+    InitializeLayouter(layouter);
+
+    // Cell 0 and cell 1, 2 pixel apart
+    std::vector<osmscout::LabelData> labels={CreateLabel(1,1,40.0,10.0,22.0,"Left"),
+                                             CreateLabel(2,1,64.0,10.0,16.0,"Right")};
+
+    REQUIRE(PlaceLabels(layouter,labels).empty());
+  }
+
+  SECTION("Labels in vertically neighbouring cells intersect by label space") {
+    InitializeLayouter(layouter);
+
+    std::vector<osmscout::LabelData> labels={CreateLabel(1,1,10.0,52.0,20.0,"Top"),
+                                             CreateLabel(2,2,10.0,64.0,20.0,"Bottom")};
+
+    REQUIRE(PlaceLabels(layouter,labels)==std::set<size_t>({1}));
+  }
+
+  SECTION("Label covering four cells") {
+    InitializeLayouter(layouter);
+
+    std::vector<osmscout::LabelData> labels={CreateLabel(1,1,58.0,58.0,12.0,"Corner"),
+                                             CreateLabel(2,2,72.0,60.0,20.0,"Right"),
+                                             CreateLabel(3,2,50.0,70.0,10.0,"Below"),
+                                             CreateLabel(4,2,100.0,100.0,20.0,"Other")};
+
+    REQUIRE(PlaceLabels(layouter,labels)==std::set<size_t>({1,4}));
+  }
+
+  SECTION("Dropped label is removed from all cells") {
+    InitializeLayouter(layouter);
+
+    // The wide label covers all four cells of the row and is dropped by the
+    // second label, which shares two cells with it
+    std::vector<osmscout::LabelData> labels={CreateLabel(1,5,10.0,100.0,230.0,"Wide"),
+                                             CreateLabel(2,1,60.0,100.0,20.0,"High"),
+                                             CreateLabel(3,5,200.0,100.0,20.0,"Right"),
+                                             CreateLabel(4,5,10.0,100.0,20.0,"Left")};
+
+    REQUIRE(PlaceLabels(layouter,labels)==std::set<size_t>({2,3,4}));
+    REQUIRE(layouter.Size()==3);
+  }
+}
+
+TEST_CASE("Labels at the canvas edge") {
+  osmscout::LabelLayouter layouter;
+
+  SECTION("Labels beyond the left edge") {
+    InitializeLayouter(layouter);
+
+    std::vector<osmscout::LabelData> labels={CreateLabel(1,1,-40.0,10.0,20.0,"A"),
+                                             CreateLabel(2,1,-18.0,10.0,20.0,"B"),
+                                             CreateLabel(3,1,-500.0,10.0,20.0,"C")};
+
+    REQUIRE(PlaceLabels(layouter,labels)==std::set<size_t>({3}));
+  }
+
+  SECTION("Labels beyond the right and bottom edge") {
+    InitializeLayouter(layouter);
+
+    std::vector<osmscout::LabelData> labels={CreateLabel(1,1,260.0,10.0,20.0,"A"),
+                                             CreateLabel(2,1,282.0,10.0,20.0,"B"),
+                                             CreateLabel(3,2,10.0,200.0,20.0,"C"),
+                                             CreateLabel(4,1,10.0,212.0,20.0,"D"),
+                                             CreateLabel(5,1,1000.0,1000.0,20.0,"E")};
+
+    REQUIRE(PlaceLabels(layouter,labels)==std::set<size_t>({4,5}));
+  }
+
+  SECTION("Label crossing the edge") {
+    InitializeLayouter(layouter);
+
+    std::vector<osmscout::LabelData> labels={CreateLabel(1,2,230.0,10.0,18.0,"Inside"),
+                                             CreateLabel(2,1,250.0,10.0,20.0,"Edge")};
+
+    REQUIRE(PlaceLabels(layouter,labels)==std::set<size_t>({2}));
+  }
+
+  SECTION("Not visible labels are dropped") {
+    InitializeLayouter(layouter,true);
+
+    osmscout::LabelDataRef labelRef;
+
+    REQUIRE_FALSE(layouter.Placelabel(CreateLabel(1,1,-40.0,10.0,20.0,"Outside"),labelRef));
+    REQUIRE_FALSE(layouter.Placelabel(CreateLabel(2,1,10.0,192.0,20.0,"Below"),labelRef));
+    REQUIRE(layouter.Placelabel(CreateLabel(3,1,-10.0,10.0,20.0,"Partial"),labelRef));
+    REQUIRE(labelRef->id==3);
+    REQUIRE(layouter.Size()==1);
+  }
+}
+
+TEST_CASE("Initialize removes all labels") {
+  osmscout::LabelLayouter layouter;
+
+  InitializeLayouter(layouter);
+
+  REQUIRE(PlaceLabels(layouter,{CreateLabel(1,1,10.0,10.0,20.0,"A")})==std::set<size_t>({1}));
+
+  InitializeLayouter(layouter);
+
+  REQUIRE(layouter.Size()==0);
+  REQUIRE(layouter.GetLabelsAdded()==0);
+  REQUIRE(PlaceLabels(layouter,{CreateLabel(2,5,10.0,10.0,20.0,"B")})==std::set<size_t>({2}));
+}
+
+TEST_CASE("Batch placement") {
+  osmscout::LabelLayouter layouter;
+
+  InitializeLayouter(layouter);
+
+  std::vector<osmscout::LabelData> labels={CreateLabel(1,5,10.0,10.0,20.0,"Low"),
+                                           CreateLabel(2,1,20.0,10.0,20.0,"High"),
+                                           CreateLabel(3,5,25.0,12.0,20.0,"Rejected")};
+
+  REQUIRE(layouter.PlaceLabels(labels)==2);
+  REQUIRE(layouter.Size()==1);
+  REQUIRE(layouter.begin()->id==2);
+}
@@ -0,0 +1,464 @@
+/*
+  MapPainterPrepare - a test program for libosmscout
+  Copyright (C) 2017  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <cstdlib>
+#include <iostream>
+#include <list>
+#include <vector>
+
+#include <osmscout/TypeConfig.h>
+#include <osmscout/StyleConfig.h>
+
+#include <osmscout/MapPainter.h>
+
+#include <osmscout/util/File.h>
+#include <osmscout/util/Projection.h>
+
+/**
+ * Draws the same synthetic map data (ways, simple areas and areas with clipping inner
+ * rings) with one and with several preparation threads and checks that the areas and
+ * ways handed to the drawing routines, their order and their transformed coordinates
+ * are identical. The painter is drawn several times, so that the preparation worker
+ * threads are reused.
+ */
+
+static const size_t objectCount=3000;
+
+/**
+ * An area or a way handed to the drawing routines of the painter
+ */
+struct DrawnObject
+{
+  const void*                         style;       //!< Fill or line style
+  const void*                         borderStyle; //!< Border style of areas
+  const osmscout::FeatureValueBuffer* buffer;      //!< Features of the object
+  std::vector<double>                 coords;      //!< Transformed coordinates, followed by the ones of the clippings
+  double                              value;       //!< Line width of ways
+  int                                 layer;       //!< Layer of ways
+
+  bool operator==(const DrawnObject& other) const
+  {
+    return style==other.style &&
+           borderStyle==other.borderStyle &&
+           buffer==other.buffer &&
+           coords==other.coords &&
+           value==other.value &&
+           layer==other.layer;
+  }
+};
+
+/**
+ * Painter recording the areas and ways to be drawn, all other drawing routines do nothing
+ */
+class RecordingPainter : public osmscout::MapPainter
+{
+public:
+  std::vector<DrawnObject> objects;
+
+private:
+  void AddCoords(std::vector<double>& coords,
+                 size_t transStart,
+                 size_t transEnd) const
+  {
+    for (size_t i=transStart; i<=transEnd; i++) {
+      coords.push_back(coordBuffer->buffer[i].GetX());
+      coords.push_back(coordBuffer->buffer[i].GetY());
+    }
+  }
+
+protected:
+  bool HasIcon(const osmscout::StyleConfig& /*styleConfig*/,
+               const osmscout::MapParameter& /*parameter*/,
+               osmscout::IconStyle& /*style*/) override
+  {
+    return false;
+  }
+
+  double GetFontHeight(const osmscout::Projection& /*projection*/,
+                       const osmscout::MapParameter& /*parameter*/,
+                       double fontSize) override
+  {
+    return fontSize;
+  }
+
+  TextDimension GetTextDimension(const osmscout::Projection& /*projection*/,
+                                 const osmscout::MapParameter& /*parameter*/,
+                                 double /*objectWidth*/,
+                                 double fontSize,
+                                 const std::string& text) override
+  {
+    TextDimension dimension;
+
+    dimension.xOff=0.0;
+    dimension.yOff=0.0;
+    dimension.width=fontSize*text.length();
+    dimension.height=fontSize;
+
+    return dimension;
+  }
+
+  void DrawGround(const osmscout::Projection& /*projection*/,
+                  const osmscout::MapParameter& /*parameter*/,
+                  const osmscout::FillStyle& /*style*/) override
+  {
+    // no code
+  }
+
+  void DrawLabel(const osmscout::Projection& /*projection*/,
+                 const osmscout::MapParameter& /*parameter*/,
+                 const osmscout::LabelData& /*label*/) override
+  {
+    // no code
+  }
+
+  void DrawIcon(const osmscout::IconStyle* /*style*/,
+                double /*x*/, double /*y*/) override
+  {
+    // no code
+  }
+
+  void DrawSymbol(const osmscout::Projection& /*projection*/,
+                  const osmscout::MapParameter& /*parameter*/,
+                  const osmscout::Symbol& /*symbol*/,
+                  double /*x*/, double /*y*/) override
+  {
+    // no code
+  }
+
+  void DrawPath(const osmscout::Projection& /*projection*/,
+                const osmscout::MapParameter& /*parameter*/,
+                const osmscout::Color& /*color*/,
+                double /*width*/,
+                const std::vector<double>& /*dash*/,
+                osmscout::LineStyle::CapStyle /*startCap*/,
+                osmscout::LineStyle::CapStyle /*endCap*/,
+                size_t /*transStart*/, size_t /*transEnd*/) override
+  {
+    // no code
+  }
+
+  void DrawContourLabel(const osmscout::Projection& /*projection*/,
+                        const osmscout::MapParameter& /*parameter*/,
+                        const osmscout::PathTextStyle& /*style*/,
+                        const std::string& /*text*/,
+                        size_t /*transStart*/, size_t /*transEnd*/,
+                        ContourLabelHelper& /*helper*/) override
+  {
+    // no code
+  }
+
+  void DrawContourSymbol(const osmscout::Projection& /*projection*/,
+                         const osmscout::MapParameter& /*parameter*/,
+                         const osmscout::Symbol& /*symbol*/,
+                         double /*space*/,
+                         size_t /*transStart*/, size_t /*transEnd*/) override
+  {
+    // no code
+  }
+
+  void DrawArea(const osmscout::Projection& /*projection*/,
+                const osmscout::MapParameter& /*parameter*/,
+                const AreaData& area) override
+  {
+    DrawnObject object;
+
+    object.style=area.fillStyle.get();
+    object.borderStyle=area.borderStyle.get();
+    object.buffer=area.buffer;
+    object.value=0.0;
+    object.layer=0;
+
+    AddCoords(object.coords,
+              area.transStart,
+              area.transEnd);
+
+    for (const auto& clipping : area.clippings) {
+      AddCoords(object.coords,
+                clipping.transStart,
+                clipping.transEnd);
+    }
+
+    objects.push_back(object);
+  }
+
+  void DrawWay(const osmscout::StyleConfig& /*styleConfig*/,
+               const osmscout::Projection& /*projection*/,
+               const osmscout::MapParameter& /*parameter*/,
+               const WayData& data) override
+  {
+    DrawnObject object;
+
+    object.style=data.lineStyle.get();
+    object.borderStyle=nullptr;
+    object.buffer=data.buffer;
+    object.value=data.lineWidth;
+    object.layer=data.layer;
+
+    AddCoords(object.coords,
+              data.transStart,
+              data.transEnd);
+
+    objects.push_back(object);
+  }
+
+public:
+  explicit RecordingPainter(const osmscout::StyleConfigRef& styleConfig)
+  : osmscout::MapPainter(styleConfig,
+                         new osmscout::CoordBuffer())
+  {
+    // no code
+  }
+
+  bool DrawMap(const osmscout::Projection& projection,
+               const osmscout::MapParameter& parameter,
+               const osmscout::MapData& data)
+  {
+    objects.clear();
+
+    return Draw(projection,
+                parameter,
+                data);
+  }
+};
+
+static uint32_t NextRandom(uint32_t& seed)
+{
+  seed=seed*1103515245+12345;
+
+  return (seed >> 8) & 0xffffff;
+}
+
+/**
+ * Random coordinate within the given box
+ */
+static osmscout::GeoCoord GetCoord(const osmscout::GeoBox& box,
+                                   uint32_t& seed)
+{
+  return osmscout::GeoCoord(box.GetMinLat()+(NextRandom(seed)%10000)/10000.0*box.GetHeight(),
+                            box.GetMinLon()+(NextRandom(seed)%10000)/10000.0*box.GetWidth());
+}
+
+/**
+ * Ring of four nodes around the given center
+ */
+static void AddRing(osmscout::Area::Ring& ring,
+                    const osmscout::GeoCoord& center,
+                    double size)
+{
+  ring.nodes.push_back(osmscout::Point(0,osmscout::GeoCoord(center.GetLat()-size,center.GetLon()-size)));
+  ring.nodes.push_back(osmscout::Point(0,osmscout::GeoCoord(center.GetLat()-size,center.GetLon()+size)));
+  ring.nodes.push_back(osmscout::Point(0,osmscout::GeoCoord(center.GetLat()+size,center.GetLon()+size)));
+  ring.nodes.push_back(osmscout::Point(0,osmscout::GeoCoord(center.GetLat()+size,center.GetLon()-size)));
+}
+
+static bool CreateMapData(const osmscout::TypeConfig& typeConfig,
+                          const osmscout::GeoBox& box,
+                          osmscout::MapData& data)
+{
+  osmscout::TypeInfoRef wayTypes[]={typeConfig.GetTypeInfo("highway_residential"),
+                                    typeConfig.GetTypeInfo("highway_primary")};
+  osmscout::TypeInfoRef areaTypes[]={typeConfig.GetTypeInfo("landuse_grass"),
+                                     typeConfig.GetTypeInfo("landuse_residential"),
+                                     typeConfig.GetTypeInfo("building"),
+                                     typeConfig.GetTypeInfo("natural_water")};
+  uint32_t              seed=4711;
+
+  for (const auto& type : wayTypes) {
+    if (!type) {
+      return false;
+    }
+  }
+
+  for (const auto& type : areaTypes) {
+    if (!type) {
+      return false;
+    }
+  }
+
+  for (size_t i=0; i<objectCount; i++) {
+    osmscout::WayRef way=std::make_shared<osmscout::Way>();
+    size_t           nodeCount=2+NextRandom(seed)%10;
+
+    way->SetType(wayTypes[NextRandom(seed)%2]);
+
+    for (size_t n=0; n<nodeCount; n++) {
+      way->nodes.push_back(osmscout::Point(0,GetCoord(box,seed)));
+    }
+
+    data.ways.push_back(way);
+  }
+
+  for (size_t i=0; i<objectCount; i++) {
+    osmscout::AreaRef  area=std::make_shared<osmscout::Area>();
+    osmscout::GeoCoord center=GetCoord(box,seed);
+    double             size=box.GetHeight()*(1+NextRandom(seed)%20)/200;
+
+    if (i%5==0) {
+      // Multipolygon with a typeless inner ring, which is drawn as clipping
+      osmscout::Area::Ring master;
+      osmscout::Area::Ring outer;
+      osmscout::Area::Ring inner;
+
+      master.SetType(areaTypes[NextRandom(seed)%4]);
+      master.MarkAsMasterRing();
+
+      outer.SetType(typeConfig.typeInfoIgnore);
+      outer.MarkAsOuterRing();
+      AddRing(outer,center,size);
+
+      inner.SetType(typeConfig.typeInfoIgnore);
+      inner.SetRing(osmscout::Area::outerRingId+1);
+      AddRing(inner,center,size/2);
+
+      area->rings.push_back(master);
+      area->rings.push_back(outer);
+      area->rings.push_back(inner);
+    }
+    else {
+      osmscout::Area::Ring ring;
+
+      ring.SetType(areaTypes[NextRandom(seed)%4]);
+      ring.MarkAsOuterRing();
+      AddRing(ring,center,size);
+
+      area->rings.push_back(ring);
+    }
+
+    data.areas.push_back(area);
+  }
+
+  return true;
+}
+
+int main(int /*argc*/, char** /*argv*/)
+{
+  char* testsTopDirEnv=getenv("TESTS_TOP_DIR");
+
+  if (testsTopDirEnv==NULL) {
+    std::cerr << "Expected environment variable 'TESTS_TOP_DIR' not set" << std::endl;
+    // CMake-based tests would fail, if we do not exit here
+    return 1;
+  }
+
+  std::string testsTopDir=testsTopDirEnv;
+
+  if (testsTopDir.empty()) {
+    std::cerr << "Environment variable 'TESTS_TOP_DIR' is empty" << std::endl;
+    return 77;
+  }
+
+  std::string stylesheetDir=osmscout::AppendFileToDir(testsTopDir,"../stylesheets");
+
+  if (!osmscout::IsDirectory(stylesheetDir)) {
+    std::cerr << "Calculated stylesheet directory does not point to directory" << std::endl;
+    return 77;
+  }
+
+  osmscout::TypeConfigRef typeConfig=std::make_shared<osmscout::TypeConfig>();
+  std::string             ostFilepath=osmscout::AppendFileToDir(stylesheetDir,"map.ost");
+  std::string             ossFilepath=osmscout::AppendFileToDir(stylesheetDir,"standard.oss");
+
+  if (!typeConfig->LoadFromOSTFile(ostFilepath)) {
+    std::cerr << "Cannot load OST file '" << ostFilepath << "'" << std::endl;
+    return 1;
+  }
+
+  osmscout::StyleConfigRef styleConfig=std::make_shared<osmscout::StyleConfig>(typeConfig);
+
+  if (!styleConfig->Load(ossFilepath)) {
+    std::cerr << "Cannot load OSS file '" << ossFilepath << "'" << std::endl;
+    return 1;
+  }
+
+  osmscout::MercatorProjection projection;
+  osmscout::Magnification      magnification;
+
+  magnification.SetLevel(15);
+
+  if (!projection.Set(osmscout::GeoCoord(51.0,7.0),
+                      magnification,
+                      96.0,
+                      1600,
+                      1200)) {
+    std::cerr << "Cannot set projection" << std::endl;
+    return 1;
+  }
+
+  osmscout::GeoBox  boundingBox;
+  osmscout::MapData data;
+
+  projection.GetDimensions(boundingBox);
+
+  if (!CreateMapData(*typeConfig,
+                     boundingBox,
+                     data)) {
+    std::cerr << "Cannot find the types of the test data" << std::endl;
+    return 1;
+  }
+
+  osmscout::MapParameter sequentialParameter;
+  RecordingPainter       sequentialPainter(styleConfig);
+
+  sequentialParameter.SetPrepareThreadCount(1);
+
+  if (!sequentialPainter.DrawMap(projection,
+                                 sequentialParameter,
+                                 data)) {
+    std::cerr << "Cannot draw map" << std::endl;
+    return 1;
+  }
+
+  std::cout << sequentialPainter.objects.size() << " area(s) and way(s) drawn" << std::endl;
+
+  if (sequentialPainter.objects.size()<objectCount) {
+    std::cerr << "Too few objects drawn" << std::endl;
+    return 1;
+  }
+
+  size_t errorCount=0;
+
+  for (size_t threadCount : {2,4,7}) {
+    osmscout::MapParameter parameter;
+    RecordingPainter       painter(styleConfig);
+
+    parameter.SetPrepareThreadCount(threadCount);
+
+    for (size_t run=0; run<3; run++) {
+      if (!painter.DrawMap(projection,
+                           parameter,
+                           data)) {
+        std::cerr << "Cannot draw map" << std::endl;
+        return 1;
+      }
+
+      if (!(painter.objects==sequentialPainter.objects)) {
+        std::cerr << "Drawing " << run+1 << " with " << threadCount << " thread(s) differs from the sequential drawing" << std::endl;
+        errorCount++;
+      }
+    }
+  }
+
+  if (errorCount>0) {
+    return 1;
+  }
+
+  std::cout << "Prepared data of all thread counts is identical" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,553 @@
+/*
+  MetaTileRenderer - a test program for libosmscout
+  Copyright (C) 2017  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <osmscout/Database.h>
+#include <osmscout/MapService.h>
+#include <osmscout/MetaTileRenderer.h>
+
+#include <osmscout/util/File.h>
+
+#include <osmscout/import/Import.h>
+
+/*
+ * Checks the meta tiles of the MetaTileRenderer: they must be aligned to multiples
+ * of the meta tile size and clipped to the requested tile box and to the world, so
+ * that they cover every requested tile exactly once. Renders a tile box of an
+ * imported synthetic map with several thread counts to a canvas that only records
+ * the stored tiles and checks that every tile is stored exactly once, cut from the
+ * meta tile it belongs to.
+ */
+
+static const size_t tileSize=256;
+
+typedef std::pair<uint32_t,uint32_t> TilePosition;
+
+class ErrorProgress : public osmscout::Progress
+{
+public:
+  void Error(const std::string& text) override
+  {
+    std::cerr << "Import error: " << text << std::endl;
+  }
+};
+
+/**
+ * Tiles stored by all canvases of one rendering
+ */
+struct StoredTiles
+{
+  std::mutex                    mutex;
+  std::map<TilePosition,size_t> counts;       //!< Number of StoreTile() calls per tile
+  size_t                        drawCount=0;  //!< Number of DrawMetaTile() calls
+  size_t                        errorCount=0;
+};
+
+/**
+ * Canvas that does not draw anything, but checks and records the tiles stored
+ */
+class RecordingCanvas : public osmscout::MetaTileCanvas
+{
+private:
+  StoredTiles& storedTiles;
+  bool         drawn;
+  size_t       canvasWidth;
+  size_t       canvasHeight;
+
+public:
+  explicit RecordingCanvas(StoredTiles& storedTiles)
+  : storedTiles(storedTiles),
+    drawn(false),
+    canvasWidth(0),
+    canvasHeight(0)
+  {
+    // no code
+  }
+
+  bool DrawMetaTile(const osmscout::Projection& projection,
+                    const osmscout::MapParameter& /*parameter*/,
+                    const osmscout::MapData& /*data*/) override
+  {
+    std::lock_guard<std::mutex> lock(storedTiles.mutex);
+
+    drawn=true;
+    canvasWidth=projection.GetWidth();
+    canvasHeight=projection.GetHeight();
+
+    storedTiles.drawCount++;
+
+    return true;
+  }
+
+  bool StoreTile(const osmscout::OSMTileId& tile,
+                 const osmscout::Magnification& /*magnification*/,
+                 size_t x,
+                 size_t y,
+                 size_t width,
+                 size_t height) override
+  {
+    std::lock_guard<std::mutex> lock(storedTiles.mutex);
+
+    if (!drawn) {
+      std::cerr << "Tile " << tile.GetDisplayText() << " stored before drawing a meta tile" << std::endl;
+      storedTiles.errorCount++;
+    }
+
+    if (width!=tileSize ||
+        height!=tileSize ||
+        x%tileSize!=0 ||
+        y%tileSize!=0 ||
+        x+width>canvasWidth ||
+        y+height>canvasHeight) {
+      std::cerr << "Tile " << tile.GetDisplayText() << " stored from " << x << "," << y << " " << width << "x" << height;
+      std::cerr << " of a " << canvasWidth << "x" << canvasHeight << " canvas" << std::endl;
+      storedTiles.errorCount++;
+    }
+
+    storedTiles.counts[TilePosition(tile.GetX(),tile.GetY())]++;
+
+    return true;
+  }
+};
+
+static bool MakeDirectory(const std::string& directory)
+{
+  if (osmscout::ExistsInFilesystem(directory)) {
+    return osmscout::IsDirectory(directory);
+  }
+
+#if defined(_WIN32)
+  return _mkdir(directory.c_str())==0;
+#else
+  return mkdir(directory.c_str(),0755)==0;
+#endif
+}
+
+/**
+ * Write some roads, a landuse area and a place node. The islet is the node type
+ * with the highest index, the area node index expects data for it.
+ */
+static bool WriteMap(const std::string& filename)
+{
+  std::ofstream stream(filename.c_str());
+  const size_t  gridSize=4;
+
+  stream << std::fixed << std::setprecision(7);
+  stream << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>" << std::endl;
+  stream << "<osm version=\"0.6\" generator=\"MetaTileRenderer\">" << std::endl;
+
+  for (size_t row=0; row<gridSize; row++) {
+    for (size_t column=0; column<gridSize; column++) {
+      stream << "<node id=\"" << row*gridSize+column+1 << "\" lat=\"" << 51.0+row*0.01 << "\" lon=\"" << 7.0+column*0.01 << "\" version=\"1\"/>" << std::endl;
+    }
+  }
+
+  stream << "<node id=\"100\" lat=\"51.015\" lon=\"7.015\" version=\"1\">" << std::endl;
+  stream << "<tag k=\"place\" v=\"islet\"/>" << std::endl;
+  stream << "<tag k=\"name\" v=\"Islet\"/>" << std::endl;
+  stream << "</node>" << std::endl;
+
+  for (size_t row=0; row<gridSize; row++) {
+    stream << "<way id=\"" << row+1 << "\" version=\"1\">" << std::endl;
+
+    for (size_t column=0; column<gridSize; column++) {
+      stream << "<nd ref=\"" << row*gridSize+column+1 << "\"/>" << std::endl;
+    }
+
+    stream << "<tag k=\"highway\" v=\"residential\"/>" << std::endl;
+    stream << "<tag k=\"name\" v=\"Street " << row << "\"/>" << std::endl;
+    stream << "</way>" << std::endl;
+  }
+
+  stream << "<way id=\"100\" version=\"1\">" << std::endl;
+  stream << "<nd ref=\"1\"/>" << std::endl;
+  stream << "<nd ref=\"2\"/>" << std::endl;
+  stream << "<nd ref=\"6\"/>" << std::endl;
+  stream << "<nd ref=\"5\"/>" << std::endl;
+  stream << "<nd ref=\"1\"/>" << std::endl;
+  stream << "<tag k=\"landuse\" v=\"grass\"/>" << std::endl;
+  stream << "</way>" << std::endl;
+
+  stream << "</osm>" << std::endl;
+
+  stream.close();
+
+  return !stream.fail();
+}
+
+static bool ImportMap(const std::string& stylesheetDir,
+                      const std::string& databaseDir,
+                      const std::string& osmFile)
+{
+  osmscout::ImportParameter parameter;
+  ErrorProgress             progress;
+
+  parameter.SetTypefile(osmscout::AppendFileToDir(stylesheetDir,"map.ost"));
+  parameter.SetDestinationDirectory(databaseDir);
+  parameter.SetMapfiles({osmFile});
+
+  osmscout::Importer importer(parameter);
+
+  return importer.Import(progress);
+}
+
+/**
+ * Check that the meta tiles are aligned to the meta tile size, lie within the tile
+ * box and the world and cover every tile of the tile box within the world exactly once
+ */
+static size_t CheckMetaTiles(const osmscout::MetaTileRenderer& renderer,
+                             const osmscout::Magnification& magnification,
+                             const osmscout::OSMTileIdBox& tileBox,
+                             const std::vector<osmscout::OSMTileIdBox>& metaTiles)
+{
+  uint32_t                      size=(uint32_t)renderer.GetMetaTileSize();
+  uint32_t                      maxTile=(uint32_t)(magnification.GetMagnification()-1);
+  std::map<TilePosition,size_t> counts;
+  size_t                        errorCount=0;
+
+  for (const auto& metaTile : metaTiles) {
+    if (metaTile.GetMinX()/size!=metaTile.GetMaxX()/size ||
+        metaTile.GetMinY()/size!=metaTile.GetMaxY()/size) {
+      std::cerr << "Meta tile " << metaTile.GetDisplayText() << " crosses a meta tile border of size " << size << std::endl;
+      errorCount++;
+    }
+
+    if (metaTile.GetMinX()<tileBox.GetMinX() ||
+        metaTile.GetMinY()<tileBox.GetMinY() ||
+        metaTile.GetMaxX()>std::min(tileBox.GetMaxX(),maxTile) ||
+        metaTile.GetMaxY()>std::min(tileBox.GetMaxY(),maxTile)) {
+      std::cerr << "Meta tile " << metaTile.GetDisplayText() << " exceeds tile box " << tileBox.GetDisplayText();
+      std::cerr << " or level " << magnification.GetLevel() << std::endl;
+      errorCount++;
+    }
+
+    for (uint32_t y=metaTile.GetMinY(); y<=metaTile.GetMaxY(); y++) {
+      for (uint32_t x=metaTile.GetMinX(); x<=metaTile.GetMaxX(); x++) {
+        counts[TilePosition(x,y)]++;
+      }
+    }
+  }
+
+  for (uint32_t y=tileBox.GetMinY(); y<=std::min(tileBox.GetMaxY(),maxTile); y++) {
+    for (uint32_t x=tileBox.GetMinX(); x<=std::min(tileBox.GetMaxX(),maxTile); x++) {
+      auto count=counts.find(TilePosition(x,y));
+
+      if (count==counts.end() ||
+          count->second!=1) {
+        std::cerr << "Tile " << x << "," << y << " is part of " << (count==counts.end() ? 0 : count->second);
+        std::cerr << " meta tiles of " << tileBox.GetDisplayText() << ", size " << size << std::endl;
+        errorCount++;
+      }
+    }
+  }
+
+  return errorCount;
+}
+
+/**
+ * Compare the meta tiles with the expected ones and check them for consistency
+ */
+static size_t CheckMetaTiles(osmscout::MetaTileRenderer& renderer,
+                             size_t metaTileSize,
+                             uint32_t level,
+                             const osmscout::OSMTileIdBox& tileBox,
+                             const std::vector<osmscout::OSMTileIdBox>& expected)
+{
+  osmscout::Magnification magnification;
+
+  magnification.SetLevel(level);
+  renderer.SetMetaTileSize(metaTileSize);
+
+  std::vector<osmscout::OSMTileIdBox> metaTiles=renderer.GetMetaTiles(magnification,
+                                                                      tileBox);
+  size_t                              errorCount=CheckMetaTiles(renderer,
+                                                                magnification,
+                                                                tileBox,
+                                                                metaTiles);
+  bool                                equal=metaTiles.size()==expected.size();
+
+  for (size_t i=0; equal && i<metaTiles.size(); i++) {
+    equal=metaTiles[i].GetMin()==expected[i].GetMin() &&
+          metaTiles[i].GetMax()==expected[i].GetMax();
+  }
+
+  if (!equal) {
+    std::cerr << "Meta tiles of " << tileBox.GetDisplayText() << ", size " << metaTileSize << ", level " << level << ":";
+
+    for (const auto& metaTile : metaTiles) {
+      std::cerr << " " << metaTile.GetDisplayText();
+    }
+
+    std::cerr << std::endl;
+    errorCount++;
+  }
+
+  return errorCount;
+}
+
+static size_t CheckGetMetaTiles(osmscout::MetaTileRenderer& renderer)
+{
+  typedef osmscout::OSMTileId    Tile;
+  typedef osmscout::OSMTileIdBox Box;
+
+  size_t errorCount=0;
+
+  // Clipped to the tile box, aligned to multiples of 4
+  errorCount+=CheckMetaTiles(renderer,4,5,Box(Tile(5,6),Tile(13,9)),
+                             {Box(Tile(5,6),Tile(7,7)),Box(Tile(8,6),Tile(11,7)),Box(Tile(12,6),Tile(13,7)),
+                              Box(Tile(5,8),Tile(7,9)),Box(Tile(8,8),Tile(11,9)),Box(Tile(12,8),Tile(13,9))});
+
+  // A tile box within a single meta tile
+  errorCount+=CheckMetaTiles(renderer,4,5,Box(Tile(9,9),Tile(10,10)),
+                             {Box(Tile(9,9),Tile(10,10))});
+
+  // Clipped to the world (4x4 tiles at level 2), the size does not divide the world
+  errorCount+=CheckMetaTiles(renderer,3,2,Box(Tile(1,0),Tile(9,9)),
+                             {Box(Tile(1,0),Tile(2,2)),Box(Tile(3,0),Tile(3,2)),
+                              Box(Tile(1,3),Tile(2,3)),Box(Tile(3,3),Tile(3,3))});
+
+  // The whole world at level 0
+  errorCount+=CheckMetaTiles(renderer,4,0,Box(Tile(0,0),Tile(0,0)),
+                             {Box(Tile(0,0),Tile(0,0))});
+
+  // A tile box completely outside of the world
+  errorCount+=CheckMetaTiles(renderer,2,1,Box(Tile(2,2),Tile(5,5)),
+                             {});
+
+  // Meta tiles of size 1 are the tiles
+  errorCount+=CheckMetaTiles(renderer,1,3,Box(Tile(6,6),Tile(9,7)),
+                             {Box(Tile(6,6),Tile(6,6)),Box(Tile(7,6),Tile(7,6)),
+                              Box(Tile(6,7),Tile(6,7)),Box(Tile(7,7),Tile(7,7))});
+
+  // Consistency of all boxes of a range of positions and sizes
+  for (size_t metaTileSize=1; metaTileSize<=5; metaTileSize++) {
+    osmscout::Magnification magnification;
+
+    magnification.SetLevel(4);
+    renderer.SetMetaTileSize(metaTileSize);
+
+    for (uint32_t minX=0; minX<18; minX+=3) {
+      for (uint32_t minY=0; minY<18; minY+=5) {
+        for (uint32_t width=1; width<=7; width+=2) {
+          Box tileBox(Tile(minX,minY),
+                      Tile(minX+width-1,minY+width/2));
+
+          errorCount+=CheckMetaTiles(renderer,
+                                     magnification,
+                                     tileBox,
+                                     renderer.GetMetaTiles(magnification,
+                                                           tileBox));
+        }
+      }
+    }
+  }
+
+  return errorCount;
+}
+
+/**
+ * Render the tile box and check that every tile within the world is stored exactly
+ * once and that the statistics match
+ */
+static size_t CheckRenderLevel(osmscout::MetaTileRenderer& renderer,
+                               uint32_t level,
+                               const osmscout::OSMTileIdBox& tileBox)
+{
+  osmscout::Magnification                     magnification;
+  osmscout::MetaTileRenderer::LevelStatistics statistics;
+  StoredTiles                                 storedTiles;
+  size_t                                      errorCount=0;
+
+  magnification.SetLevel(level);
+
+  std::vector<osmscout::OSMTileIdBox> metaTiles=renderer.GetMetaTiles(magnification,
+                                                                      tileBox);
+
+  if (!renderer.RenderLevel(magnification,
+                            tileBox,
+                            [&storedTiles]() {
+                              return std::make_shared<RecordingCanvas>(storedTiles);
+                            },
+                            statistics)) {
+    std::cerr << "Cannot render " << tileBox.GetDisplayText() << " at level " << level << std::endl;
+    return 1;
+  }
+
+  errorCount+=storedTiles.errorCount;
+
+  uint32_t maxTile=(uint32_t)(magnification.GetMagnification()-1);
+  size_t   tileCount=0;
+
+  for (uint32_t y=tileBox.GetMinY(); y<=std::min(tileBox.GetMaxY(),maxTile); y++) {
+    for (uint32_t x=tileBox.GetMinX(); x<=std::min(tileBox.GetMaxX(),maxTile); x++) {
+      auto count=storedTiles.counts.find(TilePosition(x,y));
+
+      if (count==storedTiles.counts.end() ||
+          count->second!=1) {
+        std::cerr << "Tile " << x << "," << y << " stored " << (count==storedTiles.counts.end() ? 0 : count->second);
+        std::cerr << " times with " << renderer.GetThreadCount() << " thread(s)" << std::endl;
+        errorCount++;
+      }
+
+      tileCount++;
+    }
+  }
+
+  if (storedTiles.counts.size()!=tileCount) {
+    std::cerr << storedTiles.counts.size() << " different tiles stored, expected " << tileCount << std::endl;
+    errorCount++;
+  }
+
+  if (storedTiles.drawCount!=metaTiles.size() ||
+      statistics.metaTileCount!=metaTiles.size() ||
+      statistics.tileCount!=tileCount ||
+      statistics.level!=level) {
+    std::cerr << "Level " << statistics.level << ": " << storedTiles.drawCount << " meta tiles drawn, ";
+    std::cerr << statistics.metaTileCount << " meta tiles and " << statistics.tileCount << " tiles counted, expected ";
+    std::cerr << metaTiles.size() << " meta tiles and " << tileCount << " tiles at level " << level << std::endl;
+    errorCount++;
+  }
+
+  return errorCount;
+}
+
+int main(int /*argc*/, char** /*argv*/)
+{
+  char* testsTopDirEnv=getenv("TESTS_TOP_DIR");
+
+  if (testsTopDirEnv==NULL) {
+    std::cerr << "Expected environment variable 'TESTS_TOP_DIR' not set" << std::endl;
+    // CMake-based tests would fail, if we do not exit here
+    return 1;
+  }
+
+  std::string testsTopDir=testsTopDirEnv;
+
+  if (testsTopDir.empty()) {
+    std::cerr << "Environment variable 'TESTS_TOP_DIR' is empty" << std::endl;
+    return 77;
+  }
+
+  std::string stylesheetDir=osmscout::AppendFileToDir(testsTopDir,"../stylesheets");
+
+  if (!osmscout::IsDirectory(stylesheetDir)) {
+    std::cerr << "Calculated stylesheet directory does not point to directory" << std::endl;
+    return 77;
+  }
+
+  std::string databaseDir="MetaTileRenderer.db";
+  std::string osmFile=osmscout::AppendFileToDir(databaseDir,"map.osm");
+
+  if (!MakeDirectory(databaseDir)) {
+    std::cerr << "Cannot create directory '" << databaseDir << "'" << std::endl;
+    return 1;
+  }
+
+  if (!WriteMap(osmFile)) {
+    std::cerr << "Cannot write '" << osmFile << "'" << std::endl;
+    return 1;
+  }
+
+  if (!ImportMap(stylesheetDir,
+                 databaseDir,
+                 osmFile)) {
+    std::cerr << "Cannot import '" << osmFile << "'" << std::endl;
+    return 1;
+  }
+
+  osmscout::DatabaseParameter databaseParameter;
+  osmscout::DatabaseRef       database=std::make_shared<osmscout::Database>(databaseParameter);
+  osmscout::MapServiceRef     mapService=std::make_shared<osmscout::MapService>(database);
+
+  if (!database->Open(databaseDir)) {
+    std::cerr << "Cannot open database '" << databaseDir << "'" << std::endl;
+    return 1;
+  }
+
+  osmscout::StyleConfigRef styleConfig=std::make_shared<osmscout::StyleConfig>(database->GetTypeConfig());
+  std::string              ossFilepath=osmscout::AppendFileToDir(stylesheetDir,"standard.oss");
+
+  if (!styleConfig->Load(ossFilepath)) {
+    std::cerr << "Cannot load OSS file '" << ossFilepath << "'" << std::endl;
+    return 1;
+  }
+
+  osmscout::MetaTileRenderer renderer(mapService,
+                                      styleConfig);
+  size_t                     errorCount=0;
+
+  renderer.SetTileSize(tileSize,
+                       tileSize);
+
+  std::cout << "Checking meta tiles..." << std::endl;
+  errorCount+=CheckGetMetaTiles(renderer);
+
+  osmscout::Magnification magnification;
+
+  magnification.SetLevel(14);
+
+  // Tiles around the data, not aligned to the meta tile size
+  osmscout::OSMTileIdBox dataBox(osmscout::OSMTileId::GetOSMTile(osmscout::GeoCoord(50.99,6.99),
+                                                                 magnification),
+                                 osmscout::OSMTileId::GetOSMTile(osmscout::GeoCoord(51.04,7.04),
+                                                                 magnification));
+
+  for (size_t threadCount : {1,2,4,7}) {
+    renderer.SetThreadCount(threadCount);
+
+    for (size_t metaTileSize : {1,3,4}) {
+      renderer.SetMetaTileSize(metaTileSize);
+
+      std::cout << "Rendering with " << threadCount << " thread(s) and meta tile size " << metaTileSize << "..." << std::endl;
+
+      errorCount+=CheckRenderLevel(renderer,
+                                   14,
+                                   dataBox);
+
+      // Exceeds the world (8x8 tiles at level 3)
+      errorCount+=CheckRenderLevel(renderer,
+                                   3,
+                                   osmscout::OSMTileIdBox(osmscout::OSMTileId(2,1),
+                                                          osmscout::OSMTileId(11,10)));
+    }
+  }
+
+  if (errorCount>0) {
+    std::cerr << errorCount << " error(s)" << std::endl;
+    return 1;
+  }
+  else {
+    return 0;
+  }
+}
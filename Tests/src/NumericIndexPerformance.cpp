@@ -0,0 +1,326 @@
+/*
+  NumericIndexPerformance - a test program for libosmscout
+  Copyright (C) 2017  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <osmscout/NumericIndex.h>
+
+#include <osmscout/util/EytzingerMap.h>
+#include <osmscout/util/File.h>
+#include <osmscout/util/FileWriter.h>
+#include <osmscout/util/Progress.h>
+#include <osmscout/util/StopClock.h>
+
+#include <osmscout/import/GenNumericIndex.h>
+
+/**
+  Check performance of
+  * lookup in the flat index level (EytzingerMap) compared to binary search
+    over a sorted array as done for individual index pages
+  * NumericIndex::GetOffset() for different cache sizes
+  * NumericIndex::GetOffsets() for a sorted list of ids compared to
+    calling GetOffset() for each id
+
+  Call with the number of entries and the number of lookups as optional parameters.
+*/
+
+static const char* dataFilename="numericindex.dat";
+static const char* indexFilename="numericindex.idx";
+
+/**
+  Fake data object with an id and some payload
+  */
+struct Data
+{
+  osmscout::Id id;
+
+  void Read(const osmscout::TypeConfig& /*typeConfig*/,
+            osmscout::FileScanner& scanner)
+  {
+    uint32_t payload;
+
+    scanner.ReadNumber(id);
+    scanner.Read(payload);
+  }
+
+  osmscout::Id GetId() const
+  {
+    return id;
+  }
+};
+
+static void GenerateIds(size_t entryCount,
+                        std::vector<osmscout::Id>& ids)
+{
+  std::mt19937                          generator(4711);
+  std::uniform_int_distribution<size_t> gap(1,20);
+  osmscout::Id                          id=0;
+
+  ids.clear();
+  ids.reserve(entryCount);
+
+  for (size_t i=0; i<entryCount; i++) {
+    id+=gap(generator);
+    ids.push_back(id);
+  }
+}
+
+static void GenerateLookups(const std::vector<osmscout::Id>& ids,
+                            size_t lookupCount,
+                            std::vector<osmscout::Id>& lookups)
+{
+  std::mt19937                          generator(815);
+  std::uniform_int_distribution<size_t> index(0,ids.size()-1);
+
+  lookups.clear();
+  lookups.reserve(lookupCount);
+
+  for (size_t i=0; i<lookupCount; i++) {
+    lookups.push_back(ids[index(generator)]);
+  }
+}
+
+static bool TestKernel(const std::vector<osmscout::Id>& ids,
+                       const std::vector<osmscout::Id>& lookups)
+{
+  std::cout << "*** Lookup kernel ***" << std::endl;
+
+  std::vector<osmscout::FileOffset> offsets;
+
+  offsets.reserve(ids.size());
+  for (size_t i=0; i<ids.size(); i++) {
+    offsets.push_back(i*8);
+  }
+
+  osmscout::EytzingerMap<osmscout::Id,osmscout::FileOffset> map;
+
+  map.Assign(ids,offsets);
+
+  osmscout::FileOffset sum=0;
+
+  osmscout::StopClock binaryTimer;
+
+  for (const auto id : lookups) {
+    auto iter=std::upper_bound(ids.begin(),ids.end(),id);
+
+    if (iter==ids.begin()) {
+      return false;
+    }
+
+    sum+=offsets[iter-ids.begin()-1];
+  }
+
+  binaryTimer.Stop();
+
+  osmscout::FileOffset eytzingerSum=0;
+
+  osmscout::StopClock eytzingerTimer;
+
+  for (const auto id : lookups) {
+    osmscout::Id         floorId;
+    osmscout::FileOffset offset;
+
+    if (!map.FindFloor(id,floorId,offset) ||
+        floorId!=id) {
+      return false;
+    }
+
+    eytzingerSum+=offset;
+  }
+
+  eytzingerTimer.Stop();
+
+  if (sum!=eytzingerSum) {
+    std::cerr << "Binary search and Eytzinger lookup return different results!" << std::endl;
+    return false;
+  }
+
+  std::cout << "Binary search: " << binaryTimer << std::endl;
+  std::cout << "Eytzinger:     " << eytzingerTimer << std::endl;
+
+  return true;
+}
+
+static bool WriteData(const std::string& directory,
+                      const std::vector<osmscout::Id>& ids)
+{
+  osmscout::FileWriter writer;
+
+  try {
+    writer.Open(osmscout::AppendFileToDir(directory,dataFilename));
+
+    writer.Write((uint32_t)ids.size());
+
+    for (const auto id : ids) {
+      writer.WriteNumber(id);
+      writer.Write((uint32_t)id);
+    }
+
+    writer.Close();
+  }
+  catch (osmscout::IOException& e) {
+    std::cerr << e.GetDescription() << std::endl;
+    writer.CloseFailsafe();
+    return false;
+  }
+
+  osmscout::ImportParameter                          parameter;
+  osmscout::SilentProgress                           progress;
+  osmscout::TypeConfigRef                            typeConfig=std::make_shared<osmscout::TypeConfig>();
+  osmscout::NumericIndexGenerator<osmscout::Id,Data> generator("Generating test index",
+                                                               dataFilename,
+                                                               indexFilename);
+
+  parameter.SetDestinationDirectory(directory);
+
+  return generator.Import(typeConfig,
+                          parameter,
+                          progress);
+}
+
+static bool TestIndex(const std::string& directory,
+                      const std::vector<osmscout::Id>& lookups,
+                      unsigned long cacheSize)
+{
+  osmscout::NumericIndex<osmscout::Id> index(indexFilename,
+                                             cacheSize);
+
+  osmscout::StopClock openTimer;
+
+  if (!index.Open(directory,true)) {
+    std::cerr << "Cannot open index!" << std::endl;
+    return false;
+  }
+
+  openTimer.Stop();
+
+  osmscout::StopClock lookupTimer;
+
+  for (const auto id : lookups) {
+    osmscout::FileOffset offset;
+
+    if (!index.GetOffset(id,offset)) {
+      std::cerr << "Id " << id << " not found in index!" << std::endl;
+      return false;
+    }
+  }
+
+  lookupTimer.Stop();
+
+  std::vector<osmscout::Id>         sortedLookups(lookups);
+  std::vector<osmscout::FileOffset> singleOffsets;
+  std::vector<osmscout::FileOffset> batchOffsets;
+
+  std::sort(sortedLookups.begin(),sortedLookups.end());
+
+  singleOffsets.reserve(sortedLookups.size());
+
+  osmscout::StopClock sortedLookupTimer;
+
+  for (const auto id : sortedLookups) {
+    osmscout::FileOffset offset;
+
+    if (!index.GetOffset(id,offset)) {
+      std::cerr << "Id " << id << " not found in index!" << std::endl;
+      return false;
+    }
+
+    singleOffsets.push_back(offset);
+  }
+
+  sortedLookupTimer.Stop();
+
+  osmscout::StopClock batchLookupTimer;
+
+  if (!index.GetOffsets(sortedLookups.begin(),
+                        sortedLookups.end(),
+                        sortedLookups.size(),
+                        batchOffsets)) {
+    std::cerr << "Cannot resolve ids in batch!" << std::endl;
+    return false;
+  }
+
+  batchLookupTimer.Stop();
+
+  if (batchOffsets!=singleOffsets) {
+    std::cerr << "Batch lookup returns different offsets than single lookup!" << std::endl;
+    return false;
+  }
+
+  std::cout << "Cache size " << cacheSize << ": open " << openTimer << ", lookup " << lookupTimer;
+  std::cout << ", sorted lookup " << sortedLookupTimer << ", sorted batch lookup " << batchLookupTimer << std::endl;
+
+  index.DumpStatistics();
+
+  return index.Close();
+}
+
+int main(int argc, char* argv[])
+{
+  size_t entryCount=1000000;
+  size_t lookupCount=1000000;
+
+  if (argc>1) {
+    entryCount=std::strtoul(argv[1],NULL,10);
+  }
+
+  if (argc>2) {
+    lookupCount=std::strtoul(argv[2],NULL,10);
+  }
+
+  if (entryCount==0) {
+    std::cerr << "Entry count must be greater than zero!" << std::endl;
+    return 1;
+  }
+
+  std::vector<osmscout::Id> ids;
+  std::vector<osmscout::Id> lookups;
+
+  GenerateIds(entryCount,ids);
+  GenerateLookups(ids,lookupCount,lookups);
+
+  if (!TestKernel(ids,lookups)) {
+    return 1;
+  }
+
+  std::cout << "*** NumericIndex ***" << std::endl;
+
+  if (!WriteData(".",ids)) {
+    std::cerr << "Cannot write test data!" << std::endl;
+    return 1;
+  }
+
+  ids.clear();
+
+  for (unsigned long cacheSize : {0ul,100ul,1000ul,10000ul,1000000ul}) {
+    if (!TestIndex(".",lookups,cacheSize)) {
+      return 1;
+    }
+  }
+
+  std::remove(dataFilename);
+  std::remove(indexFilename);
+
+  return 0;
+}
@@ -0,0 +1,201 @@
+/*
+  ProjectionBatch - a test program for libosmscout
+  Copyright (C) 2017  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <osmscout/util/Projection.h>
+
+// Maximum difference (in pixel) between bulk and single point transformation
+static const double tolerance=1e-3;
+
+struct Pixel
+{
+  bool   flag;
+  double x;
+  double y;
+};
+
+/**
+ * Return points in a grid around the given center, spanning the given
+ * distance in each direction
+ */
+static std::vector<osmscout::Point> GetPoints(const osmscout::GeoCoord& center,
+                                              double distance,
+                                              size_t count)
+{
+  std::vector<osmscout::Point> points;
+
+  points.reserve(count);
+
+  for (size_t i=0; i<count; i++) {
+    double lat=center.GetLat()+distance*(2.0*((i*7919)%count)/count-1.0);
+    double lon=center.GetLon()+distance*(2.0*((i*104729)%count)/count-1.0);
+
+    points.push_back(osmscout::Point(0,osmscout::GeoCoord(lat,lon)));
+  }
+
+  return points;
+}
+
+static std::string GetKernelName(osmscout::Projection::BulkKernel kernel)
+{
+  switch (kernel) {
+  case osmscout::Projection::bulkKernelScalar:
+    return "scalar";
+  case osmscout::Projection::bulkKernelSSE2:
+    return "SSE2";
+  case osmscout::Projection::bulkKernelAVX2:
+    return "AVX2";
+  }
+
+  return "unknown";
+}
+
+/**
+ * Compare the bulk transformation with the single point transformation. The
+ * kernel selected for the CPU is checked and, if it is not the BatchTransformer
+ * based default implementation, the default implementation used on other CPUs, too.
+ */
+static bool CheckProjection(const std::string& name,
+                            const osmscout::Projection& projection,
+                            double distance)
+{
+  bool result=true;
+
+  std::cout << "Bulk transformation of " << name << " (" << GetKernelName(projection.GetBulkKernel()) << " kernel";
+  std::cout << ", fallback " << GetKernelName(projection.Projection::GetBulkKernel()) << ")... ";
+
+  for (size_t count : {0,1,3,4,7,1001}) {
+    for (bool fallback : {false,true}) {
+      if (!result) {
+        break;
+      }
+
+      std::vector<osmscout::Point> points=GetPoints(osmscout::GeoCoord(projection.GetLat(),
+                                                                       projection.GetLon()),
+                                                    distance,
+                                                    count);
+      std::vector<Pixel>           pixels(count);
+
+      if (fallback) {
+        projection.Projection::GeoToPixel(points.data(),
+                                          points.size(),
+                                          count>0 ? &pixels[0].x : NULL,
+                                          count>0 ? &pixels[0].y : NULL,
+                                          sizeof(Pixel)/sizeof(double));
+      }
+      else {
+        projection.GeoToPixel(points.data(),
+                              points.size(),
+                              count>0 ? &pixels[0].x : NULL,
+                              count>0 ? &pixels[0].y : NULL,
+                              sizeof(Pixel)/sizeof(double));
+      }
+
+      for (size_t i=0; i<count; i++) {
+        double x;
+        double y;
+
+        projection.GeoToPixel(points[i].GetCoord(),
+                              x,y);
+
+        if (std::fabs(x-pixels[i].x)>tolerance ||
+            std::fabs(y-pixels[i].y)>tolerance) {
+          std::cout << std::endl;
+          std::cout << (fallback ? "Fallback: " : "") << "Point " << i << " of " << count << " " << points[i].GetCoord().GetDisplayText() << ": ";
+          std::cout << x << "," << y << " <=> " << pixels[i].x << "," << pixels[i].y;
+          result=false;
+          break;
+        }
+      }
+    }
+  }
+
+  if (result) {
+    std::cout << "OK" << std::endl;
+  }
+  else {
+    std::cout << std::endl << "Failure" << std::endl;
+  }
+
+  return result;
+}
+
+int main(int /*argc*/, char** /*argv*/)
+{
+  int failures=0;
+
+  for (double level : {4.0, 10.0, 15.0, 20.0}) {
+    osmscout::Magnification      magnification;
+    osmscout::MercatorProjection mercator;
+    osmscout::TileProjection     tile;
+    double                       distance=180.0/pow(2.0,level);
+
+    magnification.SetLevel((uint32_t)level);
+
+    mercator.Set(osmscout::GeoCoord(51.5,7.46),
+                 magnification,
+                 96.0,
+                 800,640);
+
+    if (!CheckProjection("Mercator level "+std::to_string((int)level),
+                         mercator,
+                         distance)) {
+      failures++;
+    }
+
+    mercator.Set(osmscout::GeoCoord(-33.9,18.4),
+                 0.5,
+                 magnification,
+                 96.0,
+                 800,640);
+
+    if (!CheckProjection("rotated Mercator level "+std::to_string((int)level),
+                         mercator,
+                         distance)) {
+      failures++;
+    }
+
+    mercator.SetLinearInterpolationUsage(true);
+
+    if (!CheckProjection("interpolated Mercator level "+std::to_string((int)level),
+                         mercator,
+                         distance)) {
+      failures++;
+    }
+
+    tile.Set(osmscout::OSMTileId::GetOSMTile(osmscout::GeoCoord(51.5,7.46),
+                                             magnification),
+             magnification,
+             96.0,
+             256,256);
+
+    if (!CheckProjection("tile level "+std::to_string((int)level),
+                         tile,
+                         distance)) {
+      failures++;
+    }
+  }
+
+  return failures;
+}
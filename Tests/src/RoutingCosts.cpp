@@ -0,0 +1,1315 @@
+/*
+  RoutingCosts - a test program for libosmscout
+  Copyright (C) 2017  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <list>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <osmscout/Database.h>
+#include <osmscout/ObjectVariantDataFile.h>
+
+#include <osmscout/routing/CHRoutingService.h>
+#include <osmscout/routing/IsochroneService.h>
+#include <osmscout/routing/RouteNode.h>
+#include <osmscout/routing/SimpleRoutingService.h>
+
+#include <osmscout/util/File.h>
+#include <osmscout/util/FileScanner.h>
+#include <osmscout/util/Geometry.h>
+
+#include <osmscout/import/Import.h>
+
+/*
+ * Imports a synthetic grid of roads of different types (some of them one-way) and
+ * checks that every route calculated by the contraction hierarchy, the A* search (with
+ * all open list implementations, bidirectional, on the in memory graph and with landmarks)
+ * has the same costs as a plain Dijkstra search on the route nodes. Re-routing based on
+ * target trees (complete and bounded by their cost limit) must find the same routes and
+ * a routing matrix must hold the costs and distances of the single routes. Isochrones
+ * must reach the route nodes within their budget with the Dijkstra costs and routes
+ * calculated in parallel by CalculateRoutes() must equal the single routes. The closest
+ * routable segment found by the segment index must be the closest of all segments.
+ */
+
+static const size_t gridSize=12;
+static const size_t queryCount=40;
+static const size_t matrixSize=6;
+static const size_t isochroneCount=5;
+static const size_t batchSize=30;
+static const size_t closestSegmentCount=200;
+static const double costTolerance=1e-9;
+static const double distanceTolerance=1e-9;
+
+static const char* const roadTypes[]={"primary",
+                                      "secondary",
+                                      "tertiary",
+                                      "unclassified",
+                                      "residential"};
+
+class ErrorProgress : public osmscout::Progress
+{
+public:
+  void Error(const std::string& text) override
+  {
+    std::cerr << "Import error: " << text << std::endl;
+  }
+};
+
+/**
+ * The route nodes of the imported database
+ */
+struct RouteNodeGraph
+{
+  std::vector<osmscout::RouteNode>                nodes;
+  std::unordered_map<osmscout::FileOffset,size_t> offsetIndex;
+  std::unordered_map<osmscout::Id,size_t>         idIndex;
+  std::vector<size_t>                             gridNodes; //!< Index of the route node of each grid node
+  osmscout::ObjectVariantDataFile                 objectVariantDataFile;
+};
+
+static uint32_t NextRandom(uint32_t& seed)
+{
+  seed=seed*1103515245+12345;
+
+  return (seed >> 8) & 0xffffff;
+}
+
+static osmscout::Id GetNodeId(size_t row,
+                              size_t column)
+{
+  return row*gridSize+column+1;
+}
+
+static bool MakeDirectory(const std::string& directory)
+{
+  if (osmscout::ExistsInFilesystem(directory)) {
+    return osmscout::IsDirectory(directory);
+  }
+
+#if defined(_WIN32)
+  return _mkdir(directory.c_str())==0;
+#else
+  return mkdir(directory.c_str(),0755)==0;
+#endif
+}
+
+static void WriteWay(std::ostream& stream,
+                     size_t id,
+                     osmscout::Id from,
+                     osmscout::Id to,
+                     const std::string& type,
+                     bool oneway)
+{
+  stream << "<way id=\"" << id << "\" version=\"1\">" << std::endl;
+  stream << "<nd ref=\"" << from << "\"/>" << std::endl;
+  stream << "<nd ref=\"" << to << "\"/>" << std::endl;
+  stream << "<tag k=\"highway\" v=\"" << type << "\"/>" << std::endl;
+
+  if (oneway) {
+    stream << "<tag k=\"oneway\" v=\"yes\"/>" << std::endl;
+  }
+
+  stream << "</way>" << std::endl;
+}
+
+/**
+ * Write a grid of nodes connected by ways of random types. Vertical ways and the
+ * ways of the first and the last row are never one-way, so every node can be reached
+ * from every other node.
+ */
+static bool WriteGrid(const std::string& filename,
+                      std::vector<osmscout::GeoCoord>& coords)
+{
+  std::ofstream stream(filename.c_str());
+  uint32_t      seed=4711;
+  size_t        wayId=1;
+
+  stream << std::fixed << std::setprecision(7);
+  stream << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>" << std::endl;
+  stream << "<osm version=\"0.6\" generator=\"RoutingCosts\">" << std::endl;
+
+  coords.clear();
+
+  for (size_t row=0; row<gridSize; row++) {
+    for (size_t column=0; column<gridSize; column++) {
+      double lat=51.0+row*0.002+(NextRandom(seed)%1000)*0.0000005;
+      double lon=7.0+column*0.003+(NextRandom(seed)%1000)*0.0000005;
+
+      coords.push_back(osmscout::GeoCoord(lat,lon));
+
+      stream << "<node id=\"" << GetNodeId(row,column) << "\" lat=\"" << lat << "\" lon=\"" << lon << "\" version=\"1\"/>" << std::endl;
+    }
+  }
+
+  for (size_t row=0; row<gridSize; row++) {
+    for (size_t column=0; column<gridSize; column++) {
+      if (column+1<gridSize) {
+        bool oneway=row!=0 &&
+                    row!=gridSize-1 &&
+                    NextRandom(seed)%3==0;
+
+        // Alternate the direction of the one-way streets
+        if (row%2==0) {
+          WriteWay(stream,
+                   wayId++,
+                   GetNodeId(row,column),
+                   GetNodeId(row,column+1),
+                   roadTypes[NextRandom(seed)%5],
+                   oneway);
+        }
+        else {
+          WriteWay(stream,
+                   wayId++,
+                   GetNodeId(row,column+1),
+                   GetNodeId(row,column),
+                   roadTypes[NextRandom(seed)%5],
+                   oneway);
+        }
+      }
+
+      if (row+1<gridSize) {
+        WriteWay(stream,
+                 wayId++,
+                 GetNodeId(row,column),
+                 GetNodeId(row+1,column),
+                 roadTypes[NextRandom(seed)%5],
+                 false);
+      }
+    }
+  }
+
+  stream << "</osm>" << std::endl;
+
+  stream.close();
+
+  return !stream.fail();
+}
+
+static bool ImportGrid(const std::string& stylesheetDir,
+                       const std::string& databaseDir,
+                       const std::string& osmFile)
+{
+  osmscout::ImportParameter parameter;
+  ErrorProgress             progress;
+
+  parameter.SetTypefile(osmscout::AppendFileToDir(stylesheetDir,"map.ost"));
+  parameter.SetDestinationDirectory(databaseDir);
+  parameter.SetMapfiles({osmFile});
+  parameter.AddRouter(osmscout::ImportParameter::Router(osmscout::vehicleFoot|osmscout::vehicleCar,
+                                                        osmscout::RoutingService::DEFAULT_FILENAME_BASE));
+  parameter.SetContractionHierarchies(true);
+  parameter.SetLandmarkCount(4);
+  parameter.SetRouteSegmentIndex(true);
+
+  osmscout::Importer importer(parameter);
+
+  return importer.Import(progress);
+}
+
+static bool ParametrizeProfile(const osmscout::TypeConfig& typeConfig,
+                               osmscout::Vehicle vehicle,
+                               osmscout::FastestPathRoutingProfile& profile)
+{
+  // Same parameters as used by the importer for the contraction hierarchies
+  osmscout::ImportParameter parameter;
+
+  switch (vehicle) {
+  case osmscout::vehicleFoot:
+    profile.ParametrizeForFoot(typeConfig,
+                               parameter.GetFootSpeed());
+    return true;
+  case osmscout::vehicleBicycle:
+    profile.ParametrizeForBicycle(typeConfig,
+                                  parameter.GetBicycleSpeed());
+    return true;
+  case osmscout::vehicleCar:
+    return profile.ParametrizeForCar(typeConfig,
+                                     parameter.GetCarSpeedTable(),
+                                     parameter.GetCarMaxSpeed());
+  }
+
+  return false;
+}
+
+static bool LoadRouteGraph(const osmscout::TypeConfig& typeConfig,
+                           const std::string& databaseDir,
+                           RouteNodeGraph& graph)
+{
+  std::string           filenamebase=osmscout::RoutingService::DEFAULT_FILENAME_BASE;
+  osmscout::FileScanner scanner;
+
+  if (!graph.objectVariantDataFile.Load(typeConfig,
+                                        osmscout::AppendFileToDir(databaseDir,
+                                                                  osmscout::RoutingService::GetData2Filename(filenamebase)))) {
+    return false;
+  }
+
+  try {
+    uint32_t nodeCount;
+
+    scanner.Open(osmscout::AppendFileToDir(databaseDir,
+                                           osmscout::RoutingService::GetDataFilename(filenamebase)),
+                 osmscout::FileScanner::Sequential,
+                 true);
+
+    scanner.Read(nodeCount);
+
+    graph.nodes.resize(nodeCount);
+
+    for (size_t n=0; n<nodeCount; n++) {
+      graph.nodes[n].Read(typeConfig,
+                          scanner);
+
+      graph.offsetIndex[graph.nodes[n].GetFileOffset()]=n;
+      graph.idIndex[graph.nodes[n].GetId()]=n;
+    }
+
+    scanner.Close();
+  }
+  catch (osmscout::IOException& e) {
+    std::cerr << e.GetDescription() << std::endl;
+    scanner.CloseFailsafe();
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * Find the route node of each grid node. Route node ids are not the OSM node ids,
+ * so nodes are matched by their coordinates.
+ */
+static bool AssignGridNodes(const std::vector<osmscout::GeoCoord>& coords,
+                            RouteNodeGraph& graph)
+{
+  graph.gridNodes.clear();
+
+  for (const auto& coord : coords) {
+    size_t bestNode=graph.nodes.size();
+    double bestDistance=std::numeric_limits<double>::max();
+
+    for (size_t n=0; n<graph.nodes.size(); n++) {
+      double latDelta=graph.nodes[n].GetCoord().GetLat()-coord.GetLat();
+      double lonDelta=graph.nodes[n].GetCoord().GetLon()-coord.GetLon();
+      double distance=latDelta*latDelta+lonDelta*lonDelta;
+
+      if (distance<bestDistance) {
+        bestNode=n;
+        bestDistance=distance;
+      }
+    }
+
+    if (bestNode==graph.nodes.size() ||
+        bestDistance>1e-10) {
+      return false;
+    }
+
+    graph.gridNodes.push_back(bestNode);
+  }
+
+  return true;
+}
+
+static bool CanUsePath(const RouteNodeGraph& graph,
+                       const osmscout::RoutingProfile& profile,
+                       const osmscout::RouteNode& node,
+                       size_t pathIndex)
+{
+  return !node.paths[pathIndex].IsRestricted(profile.GetVehicle()) &&
+         profile.CanUse(node,
+                        graph.objectVariantDataFile.GetData(),
+                        pathIndex);
+}
+
+/**
+ * Plain Dijkstra search returning the costs from the given start node to every node
+ */
+static std::vector<double> CalculateCosts(const RouteNodeGraph& graph,
+                                          const osmscout::RoutingProfile& profile,
+                                          size_t start)
+{
+  typedef std::pair<double,size_t> QueueEntry;
+
+  std::priority_queue<QueueEntry,std::vector<QueueEntry>,std::greater<QueueEntry>> queue;
+  std::vector<double>                                                              costs(graph.nodes.size(),
+                                                                                         std::numeric_limits<double>::infinity());
+  std::vector<bool>                                                                settled(graph.nodes.size(),false);
+
+  costs[start]=0.0;
+  queue.push(QueueEntry(0.0,start));
+
+  while (!queue.empty()) {
+    QueueEntry entry=queue.top();
+
+    queue.pop();
+
+    if (settled[entry.second]) {
+      continue;
+    }
+
+    settled[entry.second]=true;
+
+    const osmscout::RouteNode& node=graph.nodes[entry.second];
+
+    for (size_t i=0; i<node.paths.size(); i++) {
+      if (!CanUsePath(graph,profile,node,i)) {
+        continue;
+      }
+
+      size_t target=graph.offsetIndex.at(node.paths[i].offset);
+      double cost=entry.first+profile.GetCosts(node,
+                                               graph.objectVariantDataFile.GetData(),
+                                               i);
+
+      if (cost<costs[target]) {
+        costs[target]=cost;
+        queue.push(QueueEntry(cost,target));
+      }
+    }
+  }
+
+  return costs;
+}
+
+/**
+ * A route node visited by a route and the object used to leave it
+ */
+struct RouteStep
+{
+  size_t                  node;
+  osmscout::ObjectFileRef object;
+};
+
+/**
+ * Return the route nodes visited by the given route. The route data only holds the
+ * ids of junctions, so the ids of the route nodes are taken from the ways.
+ */
+static bool GetRouteSteps(const osmscout::Database& database,
+                          const RouteNodeGraph& graph,
+                          const osmscout::RouteData& route,
+                          std::vector<RouteStep>& steps)
+{
+  osmscout::WayRef way;
+
+  steps.clear();
+
+  for (const auto& entry : route.Entries()) {
+    if (entry.GetPathObject().Invalid()) {
+      break;
+    }
+
+    if (entry.GetPathObject().GetType()!=osmscout::refWay ||
+        !database.GetWayByOffset(entry.GetPathObject().GetFileOffset(),
+                                 way)) {
+      return false;
+    }
+
+    auto node=graph.idIndex.find(way->GetId(entry.GetCurrentNodeIndex()));
+
+    if (node!=graph.idIndex.end()) {
+      steps.push_back(RouteStep{node->second,entry.GetPathObject()});
+    }
+
+    if (entry.GetTargetNodeIndex()>=way->nodes.size()) {
+      return false;
+    }
+  }
+
+  if (!way) {
+    return false;
+  }
+
+  // The last entry with a path object leads to the target
+  auto node=graph.idIndex.find(way->GetId(std::prev(route.Entries().end(),2)->GetTargetNodeIndex()));
+
+  if (node==graph.idIndex.end()) {
+    return false;
+  }
+
+  steps.push_back(RouteStep{node->second,osmscout::ObjectFileRef()});
+
+  return true;
+}
+
+/**
+ * Return the costs of the given route steps or a negative value, if the steps do not
+ * follow the paths of the route nodes
+ */
+static double GetRouteCosts(const RouteNodeGraph& graph,
+                            const osmscout::RoutingProfile& profile,
+                            const std::vector<RouteStep>& steps)
+{
+  double cost=0.0;
+
+  for (size_t s=0; s+1<steps.size(); s++) {
+    const osmscout::RouteNode& node=graph.nodes[steps[s].node];
+    osmscout::FileOffset       targetOffset=graph.nodes[steps[s+1].node].GetFileOffset();
+    double                     pathCost=std::numeric_limits<double>::infinity();
+
+    for (size_t i=0; i<node.paths.size(); i++) {
+      if (node.paths[i].offset!=targetOffset ||
+          node.objects[node.paths[i].objectIndex].object!=steps[s].object ||
+          !CanUsePath(graph,profile,node,i)) {
+        continue;
+      }
+
+      pathCost=std::min(pathCost,
+                        profile.GetCosts(node,
+                                         graph.objectVariantDataFile.GetData(),
+                                         i));
+    }
+
+    if (pathCost==std::numeric_limits<double>::infinity()) {
+      return -1.0;
+    }
+
+    cost+=pathCost;
+  }
+
+  return cost;
+}
+
+/**
+ * Check that the given route leads from the start to the target grid node along the
+ * paths of the route nodes and has the expected costs, return the number of failures
+ */
+static int CheckRoute(const osmscout::Database& database,
+                      const RouteNodeGraph& graph,
+                      const osmscout::RoutingProfile& profile,
+                      const std::string& name,
+                      const osmscout::RoutingResult& result,
+                      size_t start,
+                      size_t target,
+                      double expectedCost)
+{
+  std::vector<RouteStep> steps;
+
+  if (!result.Success()) {
+    std::cerr << name << ": No route from node " << start+1 << " to node " << target+1 << std::endl;
+    return 1;
+  }
+
+  if (!GetRouteSteps(database,
+                     graph,
+                     result.GetRoute(),
+                     steps)) {
+    std::cerr << name << ": Cannot resolve the route nodes of the route from node " << start+1;
+    std::cerr << " to node " << target+1 << std::endl;
+    return 1;
+  }
+
+  if (steps.front().node!=graph.gridNodes[start] ||
+      steps.back().node!=graph.gridNodes[target]) {
+    std::cerr << name << ": Route from node " << start+1 << " to node " << target+1;
+    std::cerr << " does not start or end at these nodes" << std::endl;
+    return 1;
+  }
+
+  double cost=GetRouteCosts(graph,
+                            profile,
+                            steps);
+
+  if (cost<0.0) {
+    std::cerr << name << ": Route from node " << start+1 << " to node " << target+1;
+    std::cerr << " does not follow the routing graph" << std::endl;
+    return 1;
+  }
+
+  if (std::abs(cost-expectedCost)>costTolerance) {
+    std::cerr << name << ": Route from node " << start+1 << " to node " << target+1;
+    std::cerr << " costs " << cost << " instead of " << expectedCost << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
+
+/**
+ * Return the distance of the given route steps, taking the cheapest path between
+ * two steps like GetRouteCosts()
+ */
+static double GetRouteDistance(const RouteNodeGraph& graph,
+                               const osmscout::RoutingProfile& profile,
+                               const std::vector<RouteStep>& steps)
+{
+  double distance=0.0;
+
+  for (size_t s=0; s+1<steps.size(); s++) {
+    const osmscout::RouteNode& node=graph.nodes[steps[s].node];
+    osmscout::FileOffset       targetOffset=graph.nodes[steps[s+1].node].GetFileOffset();
+    double                     pathCost=std::numeric_limits<double>::infinity();
+    double                     pathDistance=0.0;
+
+    for (size_t i=0; i<node.paths.size(); i++) {
+      if (node.paths[i].offset!=targetOffset ||
+          node.objects[node.paths[i].objectIndex].object!=steps[s].object ||
+          !CanUsePath(graph,profile,node,i)) {
+        continue;
+      }
+
+      double cost=profile.GetCosts(node,
+                                   graph.objectVariantDataFile.GetData(),
+                                   i);
+
+      if (cost<pathCost) {
+        pathCost=cost;
+        pathDistance=node.paths[i].distance;
+      }
+    }
+
+    distance+=pathDistance;
+  }
+
+  return distance;
+}
+
+/**
+ * Calculate a matrix between some grid nodes with one and with several threads and
+ * check that every cell holds the costs and the distance of the route calculated by
+ * CalculateRoute(), return the number of failures
+ */
+static int CheckMatrix(const osmscout::Database& database,
+                       const RouteNodeGraph& graph,
+                       const std::vector<osmscout::GeoCoord>& coords,
+                       osmscout::RoutingProfile& profile,
+                       osmscout::SimpleRoutingService& router)
+{
+  int                                  failures=0;
+  uint32_t                             seed=4242;
+  std::vector<size_t>                  sources;
+  std::vector<size_t>                  targets;
+  std::vector<osmscout::RoutePosition> sourcePositions;
+  std::vector<osmscout::RoutePosition> targetPositions;
+
+  for (size_t i=0; i<matrixSize; i++) {
+    sources.push_back(NextRandom(seed)%coords.size());
+    targets.push_back(NextRandom(seed)%coords.size());
+  }
+
+  // One cell with the same source and target
+  targets.back()=sources.front();
+
+  for (size_t i=0; i<matrixSize; i++) {
+    double radius=100.0;
+
+    sourcePositions.push_back(router.GetClosestRoutableNode(coords[sources[i]],
+                                                            profile,
+                                                            radius));
+
+    radius=100.0;
+
+    targetPositions.push_back(router.GetClosestRoutableNode(coords[targets[i]],
+                                                            profile,
+                                                            radius));
+  }
+
+  for (size_t threadCount : {1,4}) {
+    osmscout::RoutingParameter parameter;
+
+    parameter.SetThreadCount(threadCount);
+
+    osmscout::RoutingMatrixResult matrix=router.CalculateMatrix(profile,
+                                                                sourcePositions,
+                                                                targetPositions,
+                                                                parameter);
+
+    if (matrix.GetSourceCount()!=sources.size() ||
+        matrix.GetTargetCount()!=targets.size()) {
+      std::cerr << "Matrix (" << threadCount << " thread(s)): Wrong size" << std::endl;
+      failures++;
+      continue;
+    }
+
+    for (size_t source=0; source<sources.size(); source++) {
+      for (size_t target=0; target<targets.size(); target++) {
+        double expectedCost=0.0;
+        double expectedDistance=0.0;
+
+        if (sources[source]!=targets[target]) {
+          osmscout::RoutingResult result=router.CalculateRoute(profile,
+                                                               sourcePositions[source],
+                                                               targetPositions[target],
+                                                               osmscout::RoutingParameter());
+          std::vector<RouteStep>  steps;
+
+          if (!result.Success() ||
+              !GetRouteSteps(database,
+                             graph,
+                             result.GetRoute(),
+                             steps)) {
+            std::cerr << "Matrix: No route from node " << sources[source]+1 << " to node " << targets[target]+1 << std::endl;
+            failures++;
+            continue;
+          }
+
+          expectedCost=GetRouteCosts(graph,
+                                     profile,
+                                     steps);
+          expectedDistance=GetRouteDistance(graph,
+                                            profile,
+                                            steps);
+        }
+
+        if (!matrix.IsReachable(source,target) ||
+            std::abs(matrix.GetCost(source,target)-expectedCost)>costTolerance ||
+            std::abs(matrix.GetDistance(source,target)-expectedDistance)>distanceTolerance) {
+          std::cerr << "Matrix (" << threadCount << " thread(s)): Route from node " << sources[source]+1;
+          std::cerr << " to node " << targets[target]+1 << " costs " << matrix.GetCost(source,target);
+          std::cerr << " and is " << matrix.GetDistance(source,target) << " km long";
+          std::cerr << " instead of " << expectedCost << " and " << expectedDistance << " km" << std::endl;
+          failures++;
+        }
+      }
+    }
+  }
+
+  return failures;
+}
+
+/**
+ * Calculate the isochrones of some grid nodes with a budget of half of the costs
+ * to the farthest node and check that exactly the route nodes within the budget are
+ * reached with the costs of the Dijkstra search. A search limited to a few route
+ * nodes must be flagged as incomplete. Return the number of failures.
+ */
+static int CheckIsochrone(const RouteNodeGraph& graph,
+                          const std::vector<osmscout::GeoCoord>& coords,
+                          osmscout::RoutingProfile& profile,
+                          osmscout::IsochroneService& isochroneService)
+{
+  int      failures=0;
+  uint32_t seed=1234;
+
+  for (size_t query=0; query<isochroneCount; query++) {
+    size_t                  start=NextRandom(seed)%coords.size();
+    double                  radius=100.0;
+    osmscout::RoutePosition startPosition=isochroneService.GetClosestRoutableNode(coords[start],
+                                                                                  profile,
+                                                                                  radius);
+    std::vector<double>     costs=CalculateCosts(graph,
+                                                 profile,
+                                                 graph.gridNodes[start]);
+    double                  maxCost=0.0;
+
+    for (double cost : costs) {
+      if (cost!=std::numeric_limits<double>::infinity()) {
+        maxCost=std::max(maxCost,cost);
+      }
+    }
+
+    maxCost=maxCost/2;
+
+    size_t expectedCount=0;
+
+    for (double cost : costs) {
+      if (cost<=maxCost) {
+        expectedCount++;
+      }
+    }
+
+    osmscout::IsochroneParameter parameter;
+
+    parameter.SetMaxNodes(0);
+
+    osmscout::IsochroneResult result=isochroneService.CalculateIsochrone(profile,
+                                                                         startPosition,
+                                                                         maxCost,
+                                                                         parameter);
+
+    if (!result.Success() ||
+        !result.IsComplete()) {
+      std::cerr << "Isochrone: No complete result for node " << start+1 << std::endl;
+      failures++;
+      continue;
+    }
+
+    std::vector<bool> reached(graph.nodes.size(),false);
+
+    for (const auto& node : result.GetNodes()) {
+      auto index=graph.idIndex.find(node.id);
+
+      if (index==graph.idIndex.end() ||
+          reached[index->second]) {
+        std::cerr << "Isochrone: Unknown or duplicate route node " << node.id << " reached from node " << start+1 << std::endl;
+        failures++;
+        continue;
+      }
+
+      reached[index->second]=true;
+
+      if (std::abs(node.cost-costs[index->second])>costTolerance) {
+        std::cerr << "Isochrone: Route node " << node.id << " reached from node " << start+1;
+        std::cerr << " costs " << node.cost << " instead of " << costs[index->second] << std::endl;
+        failures++;
+      }
+    }
+
+    if (result.GetNodes().size()!=expectedCount) {
+      std::cerr << "Isochrone: " << result.GetNodes().size() << " route node(s) reached from node " << start+1;
+      std::cerr << " instead of " << expectedCount << std::endl;
+      failures++;
+    }
+
+    parameter.SetMaxNodes(expectedCount/2);
+
+    result=isochroneService.CalculateIsochrone(profile,
+                                               startPosition,
+                                               maxCost,
+                                               parameter);
+
+    if (result.IsComplete() ||
+        result.GetNodes().size()>expectedCount/2) {
+      std::cerr << "Isochrone: Search from node " << start+1 << " limited to " << expectedCount/2;
+      std::cerr << " route node(s) reached " << result.GetNodes().size() << " route node(s)";
+      std::cerr << " and is " << (result.IsComplete() ? "complete" : "incomplete") << std::endl;
+      failures++;
+    }
+  }
+
+  return failures;
+}
+
+struct RouterVariant
+{
+  std::string                       name;
+  osmscout::SimpleRoutingServiceRef router;
+  osmscout::RoutingParameter        parameter;
+};
+
+static void AddVariant(std::list<RouterVariant>& variants,
+                       const std::string& name,
+                       const osmscout::SimpleRoutingServiceRef& router,
+                       bool bidirectional,
+                       osmscout::RoutingParameter::OpenListType openListType)
+{
+  RouterVariant variant;
+
+  variant.name=name;
+  variant.router=router;
+  variant.parameter.SetBidirectional(bidirectional);
+  variant.parameter.SetOpenListType(openListType);
+
+  variants.push_back(variant);
+}
+
+/**
+ * Calculate a batch of routes with several threads for each router variant and check
+ * that every route equals the route calculated by CalculateRoute() on its own, return
+ * the number of failures
+ */
+static int CheckRoutes(const osmscout::Database& database,
+                       const RouteNodeGraph& graph,
+                       const std::vector<osmscout::GeoCoord>& coords,
+                       osmscout::RoutingProfile& profile,
+                       const std::list<RouterVariant>& variants)
+{
+  int                                                  failures=0;
+  uint32_t                                             seed=5678;
+  std::vector<osmscout::SimpleRoutingService::Request> requests;
+  std::vector<std::pair<size_t,size_t>>                nodes;
+
+  while (requests.size()<batchSize) {
+    size_t start=NextRandom(seed)%coords.size();
+    size_t target=NextRandom(seed)%coords.size();
+
+    if (start==target) {
+      continue;
+    }
+
+    osmscout::SimpleRoutingService::Request request;
+    double                                  radius=100.0;
+
+    request.start=variants.front().router->GetClosestRoutableNode(coords[start],
+                                                                  profile,
+                                                                  radius);
+
+    radius=100.0;
+
+    request.target=variants.front().router->GetClosestRoutableNode(coords[target],
+                                                                   profile,
+                                                                   radius);
+
+    requests.push_back(request);
+    nodes.push_back(std::make_pair(start,target));
+  }
+
+  for (const auto& variant : variants) {
+    osmscout::RoutingParameter parameter(variant.parameter);
+
+    parameter.SetThreadCount(4);
+
+    std::vector<osmscout::RoutingResult> results=variant.router->CalculateRoutes(profile,
+                                                                                 requests,
+                                                                                 parameter);
+
+    if (results.size()!=requests.size()) {
+      std::cerr << variant.name << ": " << results.size() << " route(s) calculated instead of " << requests.size() << std::endl;
+      failures++;
+      continue;
+    }
+
+    for (size_t r=0; r<requests.size(); r++) {
+      osmscout::RoutingResult result=variant.router->CalculateRoute(profile,
+                                                                    requests[r].start,
+                                                                    requests[r].target,
+                                                                    variant.parameter);
+      std::vector<RouteStep>  batchSteps;
+      std::vector<RouteStep>  steps;
+
+      if (!results[r].Success() ||
+          !result.Success() ||
+          !GetRouteSteps(database,
+                         graph,
+                         results[r].GetRoute(),
+                         batchSteps) ||
+          !GetRouteSteps(database,
+                         graph,
+                         result.GetRoute(),
+                         steps)) {
+        std::cerr << variant.name << ": No route from node " << nodes[r].first+1 << " to node " << nodes[r].second+1 << std::endl;
+        failures++;
+        continue;
+      }
+
+      bool equal=batchSteps.size()==steps.size();
+
+      for (size_t i=0; equal && i<steps.size(); i++) {
+        equal=batchSteps[i].node==steps[i].node &&
+              batchSteps[i].object==steps[i].object;
+      }
+
+      if (!equal) {
+        std::cerr << variant.name << ": Batch route from node " << nodes[r].first+1 << " to node " << nodes[r].second+1;
+        std::cerr << " differs from the single route" << std::endl;
+        failures++;
+      }
+    }
+  }
+
+  return failures;
+}
+
+/**
+ * Look up the closest routable segment of random points in and around the grid and
+ * compare it with the closest segment found by checking every segment of every
+ * routable way. A point far away from the grid must not find a segment within a
+ * small radius. Return the number of failures.
+ */
+static int CheckClosestSegment(const osmscout::Database& database,
+                               const RouteNodeGraph& graph,
+                               const std::vector<osmscout::GeoCoord>& coords,
+                               const osmscout::RoutingProfile& profile,
+                               const osmscout::SimpleRoutingService& router)
+{
+  int                                                       failures=0;
+  uint32_t                                                  seed=9876;
+  std::unordered_map<osmscout::FileOffset,osmscout::WayRef> ways;
+  osmscout::GeoBox                                          gridBox(coords.front(),coords.back());
+
+  for (const auto& node : graph.nodes) {
+    for (const auto& object : node.objects) {
+      osmscout::WayRef way;
+
+      if (object.object.GetType()!=osmscout::refWay ||
+          ways.find(object.object.GetFileOffset())!=ways.end()) {
+        continue;
+      }
+
+      if (!database.GetWayByOffset(object.object.GetFileOffset(),
+                                   way)) {
+        std::cerr << "Closest segment: Cannot load way " << object.object.GetFileOffset() << std::endl;
+        return 1;
+      }
+
+      if (profile.CanUse(*way)) {
+        ways[object.object.GetFileOffset()]=way;
+      }
+    }
+  }
+
+  for (size_t query=0; query<closestSegmentCount; query++) {
+    // Points up to a third of the grid size outside of the grid
+    double                      lat=gridBox.GetMinLat()+(NextRandom(seed)%1000)/1000.0*gridBox.GetHeight()*5/3-gridBox.GetHeight()/3;
+    double                      lon=gridBox.GetMinLon()+(NextRandom(seed)%1000)/1000.0*gridBox.GetWidth()*5/3-gridBox.GetWidth()/3;
+    osmscout::GeoCoord          coord(lat,lon);
+    double                      expectedDistance=std::numeric_limits<double>::max();
+    osmscout::RouteSegmentMatch match;
+
+    for (const auto& way : ways) {
+      for (size_t i=0; i+1<way.second->nodes.size(); i++) {
+        double r,qx,qy;
+
+        expectedDistance=std::min(expectedDistance,
+                                  osmscout::DistanceToSegment(lon,lat,
+                                                              way.second->nodes[i].GetLon(),way.second->nodes[i].GetLat(),
+                                                              way.second->nodes[i+1].GetLon(),way.second->nodes[i+1].GetLat(),
+                                                              r,qx,qy));
+      }
+    }
+
+    if (!router.GetClosestRoutableSegment(coord,
+                                          profile,
+                                          5000.0,
+                                          match)) {
+      std::cerr << "Closest segment: No segment found for " << coord.GetDisplayText() << std::endl;
+      failures++;
+      continue;
+    }
+
+    auto way=ways.find(match.object.GetFileOffset());
+
+    if (match.object.GetType()!=osmscout::refWay ||
+        way==ways.end() ||
+        match.segment+1>=way->second->nodes.size() ||
+        (match.nodeIndex!=match.segment && match.nodeIndex!=match.segment+1)) {
+      std::cerr << "Closest segment: Segment found for " << coord.GetDisplayText() << " is not a routable segment" << std::endl;
+      failures++;
+      continue;
+    }
+
+    double r,qx,qy;
+    double distance=osmscout::DistanceToSegment(lon,lat,
+                                                way->second->nodes[match.segment].GetLon(),way->second->nodes[match.segment].GetLat(),
+                                                way->second->nodes[match.segment+1].GetLon(),way->second->nodes[match.segment+1].GetLat(),
+                                                r,qx,qy);
+
+    // Several segments may share the closest node, so only the distance is compared
+    if (std::abs(match.distance-expectedDistance)>1e-12 ||
+        std::abs(distance-expectedDistance)>1e-12) {
+      std::cerr << "Closest segment: Segment found for " << coord.GetDisplayText() << " has a distance of " << match.distance;
+      std::cerr << " instead of " << expectedDistance << std::endl;
+      failures++;
+    }
+  }
+
+  osmscout::RouteSegmentMatch match;
+
+  if (router.GetClosestRoutableSegment(osmscout::GeoCoord(gridBox.GetMaxLat()+0.2,
+                                                          gridBox.GetMaxLon()+0.2),
+                                       profile,
+                                       100.0,
+                                       match)) {
+    std::cerr << "Closest segment: Segment found far away from the grid" << std::endl;
+    failures++;
+  }
+
+  return failures;
+}
+
+static int CheckVehicle(const osmscout::DatabaseRef& database,
+                        const std::string& databaseDir,
+                        const RouteNodeGraph& graph,
+                        const std::vector<osmscout::GeoCoord>& coords,
+                        osmscout::Vehicle vehicle)
+{
+  int                                 failures=0;
+  osmscout::FastestPathRoutingProfile profile(database->GetTypeConfig());
+  osmscout::RouterParameter           routerParameter;
+  osmscout::RouterParameter           inMemoryGraphParameter;
+  osmscout::RouterParameter           landmarkParameter;
+  osmscout::RouterParameter           segmentIndexParameter;
+  std::list<RouterVariant>            variants;
+
+  if (!ParametrizeProfile(*database->GetTypeConfig(),
+                          vehicle,
+                          profile)) {
+    std::cerr << "Cannot parametrize routing profile" << std::endl;
+    return 1;
+  }
+
+  // Same profile, but the cost limit only covers routes up to five times the costs
+  // of the given distance at maximum speed
+  osmscout::FastestPathRoutingProfile boundedProfile(profile);
+
+  boundedProfile.SetCostLimitDistance(0.0);
+  boundedProfile.SetCostLimitFactor(profile.GetCosts(5.0));
+
+  inMemoryGraphParameter.SetInMemoryGraph(true);
+  landmarkParameter.SetLandmarks(true);
+  segmentIndexParameter.SetSegmentIndex(true);
+
+  osmscout::SimpleRoutingServiceRef router=std::make_shared<osmscout::SimpleRoutingService>(database,
+                                                                                            routerParameter,
+                                                                                            osmscout::RoutingService::DEFAULT_FILENAME_BASE);
+  osmscout::SimpleRoutingServiceRef inMemoryGraphRouter=std::make_shared<osmscout::SimpleRoutingService>(database,
+                                                                                                         inMemoryGraphParameter,
+                                                                                                         osmscout::RoutingService::DEFAULT_FILENAME_BASE);
+  osmscout::SimpleRoutingServiceRef landmarkRouter=std::make_shared<osmscout::SimpleRoutingService>(database,
+                                                                                                    landmarkParameter,
+                                                                                                    osmscout::RoutingService::DEFAULT_FILENAME_BASE);
+  osmscout::SimpleRoutingServiceRef segmentIndexRouter=std::make_shared<osmscout::SimpleRoutingService>(database,
+                                                                                                        segmentIndexParameter,
+                                                                                                        osmscout::RoutingService::DEFAULT_FILENAME_BASE);
+  std::shared_ptr<osmscout::CHRoutingService> chRouter=std::make_shared<osmscout::CHRoutingService>(database,
+                                                                                                   routerParameter,
+                                                                                                   osmscout::RoutingService::DEFAULT_FILENAME_BASE,
+                                                                                                   vehicle);
+  osmscout::IsochroneServiceRef               isochroneService=std::make_shared<osmscout::IsochroneService>(database,
+                                                                                                          routerParameter,
+                                                                                                          osmscout::RoutingService::DEFAULT_FILENAME_BASE);
+
+  if (!router->Open() ||
+      !inMemoryGraphRouter->Open() ||
+      !landmarkRouter->Open() ||
+      !segmentIndexRouter->Open() ||
+      !chRouter->Open() ||
+      !isochroneService->Open()) {
+    std::cerr << "Cannot open routing database in '" << databaseDir << "'" << std::endl;
+    return 1;
+  }
+
+  if (!chRouter->IsHierarchyLoaded()) {
+    std::cerr << "Contraction hierarchy has not been loaded" << std::endl;
+    failures++;
+  }
+
+  AddVariant(variants,"A* (set)",router,false,osmscout::RoutingParameter::openListSet);
+  AddVariant(variants,"A* (4-ary heap)",router,false,osmscout::RoutingParameter::openListDAryHeap);
+  AddVariant(variants,"A* (radix heap)",router,false,osmscout::RoutingParameter::openListRadixHeap);
+  AddVariant(variants,"Bidirectional A* (set)",router,true,osmscout::RoutingParameter::openListSet);
+  AddVariant(variants,"Bidirectional A* (4-ary heap)",router,true,osmscout::RoutingParameter::openListDAryHeap);
+  AddVariant(variants,"Bidirectional A* (radix heap)",router,true,osmscout::RoutingParameter::openListRadixHeap);
+  AddVariant(variants,"A* (in memory graph)",inMemoryGraphRouter,false,osmscout::RoutingParameter::openListDAryHeap);
+  AddVariant(variants,"A* (landmarks)",landmarkRouter,false,osmscout::RoutingParameter::openListDAryHeap);
+  AddVariant(variants,"Bidirectional A* (landmarks)",landmarkRouter,true,osmscout::RoutingParameter::openListDAryHeap);
+  AddVariant(variants,"Contraction hierarchy",chRouter,false,osmscout::RoutingParameter::openListDAryHeap);
+
+  uint32_t seed=815;
+
+  for (size_t query=0; query<queryCount; query++) {
+    size_t start=NextRandom(seed)%coords.size();
+    size_t target=NextRandom(seed)%coords.size();
+
+    if (start==target) {
+      continue;
+    }
+
+    double                  radius=100.0;
+    osmscout::RoutePosition startPosition=router->GetClosestRoutableNode(coords[start],
+                                                                         profile,
+                                                                         radius);
+
+    radius=100.0;
+
+    osmscout::RoutePosition targetPosition=router->GetClosestRoutableNode(coords[target],
+                                                                          profile,
+                                                                          radius);
+
+    if (!startPosition.IsValid() ||
+        !targetPosition.IsValid()) {
+      std::cerr << "Cannot find route position of node " << start+1 << " or " << target+1 << std::endl;
+      failures++;
+      continue;
+    }
+
+    std::vector<double> costs=CalculateCosts(graph,
+                                             profile,
+                                             graph.gridNodes[start]);
+    double              expectedCost=costs[graph.gridNodes[target]];
+
+    for (auto& variant : variants) {
+      osmscout::RoutingResult result=variant.router->CalculateRoute(profile,
+                                                                    startPosition,
+                                                                    targetPosition,
+                                                                    variant.parameter);
+
+      failures+=CheckRoute(*database,
+                           graph,
+                           profile,
+                           variant.name,
+                           result,
+                           start,
+                           target,
+                           expectedCost);
+    }
+
+    // Re-routing with a tree covering the complete grid and with a tree covering only
+    // the routes up to five times the costs of 200 meters at maximum speed
+    for (osmscout::FastestPathRoutingProfile* rerouteProfile : {&profile,&boundedProfile}) {
+      double                                        maxDistance=rerouteProfile==&profile ? osmscout::GetSphericalDistance(coords[start],
+                                                                                                                             coords[target]) : 0.2;
+      osmscout::SimpleRoutingService::TargetTreeRef tree=router->CalculateTargetTree(*rerouteProfile,
+                                                                                     targetPosition,
+                                                                                     maxDistance,
+                                                                                     osmscout::RoutingParameter());
+
+      if (!tree) {
+        std::cerr << "Cannot calculate target tree of node " << target+1 << std::endl;
+        failures++;
+        continue;
+      }
+
+      if (rerouteProfile==&boundedProfile &&
+          tree->paths.size()>=tree->pathCount) {
+        std::cerr << "Target tree of node " << target+1 << " is not bounded by its cost limit" << std::endl;
+        failures++;
+      }
+
+      osmscout::RoutingResult result=router->Reroute(*rerouteProfile,
+                                                     startPosition,
+                                                     *tree,
+                                                     osmscout::RoutingParameter());
+
+      failures+=CheckRoute(*database,
+                           graph,
+                           profile,
+                           rerouteProfile==&profile ? "Reroute" : "Reroute (bounded tree)",
+                           result,
+                           start,
+                           target,
+                           expectedCost);
+    }
+  }
+
+  failures+=CheckRoutes(*database,
+                        graph,
+                        coords,
+                        profile,
+                        variants);
+  failures+=CheckMatrix(*database,
+                        graph,
+                        coords,
+                        profile,
+                        *router);
+
+  failures+=CheckIsochrone(graph,
+                           coords,
+                           profile,
+                           *isochroneService);
+
+  failures+=CheckClosestSegment(*database,
+                                graph,
+                                coords,
+                                profile,
+                                *segmentIndexRouter);
+
+  isochroneService->Close();
+  chRouter->Close();
+  segmentIndexRouter->Close();
+  landmarkRouter->Close();
+  inMemoryGraphRouter->Close();
+  router->Close();
+
+  return failures;
+}
+
+int main(int /*argc*/, char** /*argv*/)
+{
+  char* testsTopDirEnv=getenv("TESTS_TOP_DIR");
+
+  if (testsTopDirEnv==NULL) {
+    std::cerr << "Expected environment variable 'TESTS_TOP_DIR' not set" << std::endl;
+    // CMake-based tests would fail, if we do not exit here
+    return 1;
+  }
+
+  std::string testsTopDir=testsTopDirEnv;
+
+  if (testsTopDir.empty()) {
+    std::cerr << "Environment variable 'TESTS_TOP_DIR' is empty" << std::endl;
+    return 77;
+  }
+
+  std::string stylesheetDir=osmscout::AppendFileToDir(testsTopDir,"../stylesheets");
+
+  if (!osmscout::IsDirectory(stylesheetDir)) {
+    std::cerr << "Calculated stylesheet directory does not point to directory" << std::endl;
+    return 77;
+  }
+
+  std::string                     databaseDir="RoutingCosts.db";
+  std::string                     osmFile=osmscout::AppendFileToDir(databaseDir,"grid.osm");
+  std::vector<osmscout::GeoCoord> coords;
+
+  if (!MakeDirectory(databaseDir)) {
+    std::cerr << "Cannot create directory '" << databaseDir << "'" << std::endl;
+    return 1;
+  }
+
+  if (!WriteGrid(osmFile,
+                 coords)) {
+    std::cerr << "Cannot write '" << osmFile << "'" << std::endl;
+    return 1;
+  }
+
+  if (!ImportGrid(stylesheetDir,
+                  databaseDir,
+                  osmFile)) {
+    std::cerr << "Cannot import '" << osmFile << "'" << std::endl;
+    return 1;
+  }
+
+  osmscout::DatabaseParameter databaseParameter;
+  osmscout::DatabaseRef       database=std::make_shared<osmscout::Database>(databaseParameter);
+  RouteNodeGraph              graph;
+
+  if (!database->Open(databaseDir)) {
+    std::cerr << "Cannot open database '" << databaseDir << "'" << std::endl;
+    return 1;
+  }
+
+  if (!LoadRouteGraph(*database->GetTypeConfig(),
+                      databaseDir,
+                      graph)) {
+    std::cerr << "Cannot load route nodes from '" << databaseDir << "'" << std::endl;
+    return 1;
+  }
+
+  std::cout << graph.nodes.size() << " route node(s) loaded" << std::endl;
+
+  if (!AssignGridNodes(coords,
+                       graph)) {
+    std::cerr << "Not every grid node is a route node" << std::endl;
+    return 1;
+  }
+
+  int failures=0;
+
+  for (osmscout::Vehicle vehicle : {osmscout::vehicleFoot, osmscout::vehicleCar}) {
+    failures+=CheckVehicle(database,
+                           databaseDir,
+                           graph,
+                           coords,
+                           vehicle);
+  }
+
+  database->Close();
+
+  if (failures==0) {
+    std::cout << "All routes have the costs of the Dijkstra search" << std::endl;
+  }
+
+  return failures;
+}
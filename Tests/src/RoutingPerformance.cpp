@@ -0,0 +1,469 @@
+/*
+  RoutingPerformance - a test program for libosmscout
+  Copyright (C) 2017  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <osmscout/Database.h>
+
+#include <osmscout/routing/SimpleRoutingService.h>
+
+#include <osmscout/util/StopClock.h>
+
+/**
+  Measure the time for calculating routes with the different open list
+  implementations of the router (see RoutingParameter::SetOpenListType()).
+
+  Call with a database directory and optionally a list of queries, each query
+  given as start and target coordinate like for the Routing demo. If no query
+  is given, random queries within the bounding box of the database are
+  generated. Each query is calculated with every open list type, the route
+  nodes are already cached after the first round.
+
+  With --matrix the time for calculating all routes from every start to every
+  target one by one is compared with the time of
+  SimpleRoutingService::CalculateMatrix() instead.
+
+  With --batch the time for calculating the routes one by one is compared with
+  the time of SimpleRoutingService::CalculateRoutes() instead.
+*/
+
+struct Query
+{
+  osmscout::GeoCoord start;
+  osmscout::GeoCoord target;
+};
+
+struct OpenListDescription
+{
+  osmscout::RoutingParameter::OpenListType type;
+  const char*                              name;
+};
+
+static const OpenListDescription openListTypes[]={
+  {osmscout::RoutingParameter::openListSet,       "std::set"},
+  {osmscout::RoutingParameter::openListDAryHeap,  "4-ary heap"},
+  {osmscout::RoutingParameter::openListRadixHeap, "radix heap"}
+};
+
+static void GetCarSpeedTable(std::map<std::string,double>& map)
+{
+  map["highway_motorway"]=110.0;
+  map["highway_motorway_trunk"]=100.0;
+  map["highway_motorway_primary"]=70.0;
+  map["highway_motorway_link"]=60.0;
+  map["highway_motorway_junction"]=60.0;
+  map["highway_trunk"]=100.0;
+  map["highway_trunk_link"]=60.0;
+  map["highway_primary"]=70.0;
+  map["highway_primary_link"]=60.0;
+  map["highway_secondary"]=60.0;
+  map["highway_secondary_link"]=50.0;
+  map["highway_tertiary_link"]=55.0;
+  map["highway_tertiary"]=55.0;
+  map["highway_unclassified"]=50.0;
+  map["highway_road"]=50.0;
+  map["highway_residential"]=40.0;
+  map["highway_roundabout"]=40.0;
+  map["highway_living_street"]=10.0;
+  map["highway_service"]=30.0;
+}
+
+static int MeasureMatrix(osmscout::SimpleRoutingService& router,
+                         osmscout::RoutingProfile& routingProfile,
+                         const std::vector<std::pair<osmscout::RoutePosition,osmscout::RoutePosition>>& positions,
+                         size_t iterations)
+{
+  std::vector<osmscout::RoutePosition> sources;
+  std::vector<osmscout::RoutePosition> targets;
+  osmscout::RoutingParameter           parameter;
+  size_t                               routesFound=0;
+
+  for (const auto& position : positions) {
+    sources.push_back(position.first);
+    targets.push_back(position.second);
+  }
+
+  osmscout::StopClock routeTimer;
+
+  for (const auto& source : sources) {
+    for (const auto& target : targets) {
+      osmscout::RoutingResult result=router.CalculateRoute(routingProfile,
+                                                           source,
+                                                           target,
+                                                           parameter);
+
+      if (result.Success()) {
+        routesFound++;
+      }
+    }
+  }
+
+  routeTimer.Stop();
+
+  std::cout << std::setw(12) << std::left << "routes";
+  std::cout << " " << std::setw(10) << std::right << std::fixed << std::setprecision(3) << routeTimer.GetMilliseconds() << " ms";
+  std::cout << ", " << routesFound << " routes" << std::endl;
+
+  for (size_t threadCount : {(size_t)1,(size_t)0}) {
+    osmscout::RoutingMatrixResult result;
+    size_t                        reachable=0;
+
+    parameter.SetThreadCount(threadCount);
+
+    osmscout::StopClock timer;
+
+    for (size_t iteration=0; iteration<iterations; iteration++) {
+      result=router.CalculateMatrix(routingProfile,
+                                    sources,
+                                    targets,
+                                    parameter);
+    }
+
+    timer.Stop();
+
+    if (!result.Success()) {
+      std::cerr << "Error while calculating matrix" << std::endl;
+      return 1;
+    }
+
+    for (size_t source=0; source<result.GetSourceCount(); source++) {
+      for (size_t target=0; target<result.GetTargetCount(); target++) {
+        if (result.IsReachable(source,target)) {
+          reachable++;
+        }
+      }
+    }
+
+    std::cout << std::setw(12) << std::left << (threadCount==1 ? "matrix" : "matrix (mt)");
+    std::cout << " " << std::setw(10) << std::right << std::fixed << std::setprecision(3) << timer.GetMilliseconds()/iterations << " ms";
+    std::cout << ", " << reachable << " reachable" << std::endl;
+  }
+
+  return 0;
+}
+
+static int MeasureBatch(osmscout::SimpleRoutingService& router,
+                        osmscout::RoutingProfile& routingProfile,
+                        const std::vector<std::pair<osmscout::RoutePosition,osmscout::RoutePosition>>& positions,
+                        size_t iterations)
+{
+  std::vector<osmscout::SimpleRoutingService::Request> requests;
+  osmscout::RoutingParameter                           parameter;
+  size_t                                               routeSize=0;
+
+  for (const auto& position : positions) {
+    requests.push_back(osmscout::SimpleRoutingService::Request{position.first,
+                                                               position.second});
+  }
+
+  osmscout::StopClock routeTimer;
+
+  for (size_t iteration=0; iteration<iterations; iteration++) {
+    for (const auto& request : requests) {
+      osmscout::RoutingResult result=router.CalculateRoute(routingProfile,
+                                                           request.start,
+                                                           request.target,
+                                                           parameter);
+
+      if (result.Success()) {
+        routeSize+=result.GetRoute().Entries().size();
+      }
+    }
+  }
+
+  routeTimer.Stop();
+
+  std::cout << std::setw(12) << std::left << "routes";
+  std::cout << " " << std::setw(10) << std::right << std::fixed << std::setprecision(3) << routeTimer.GetMilliseconds()/iterations << " ms";
+  std::cout << ", " << routeSize/iterations << " route entries" << std::endl;
+
+  for (size_t threadCount : {(size_t)1,(size_t)0}) {
+    size_t batchRouteSize=0;
+
+    parameter.SetThreadCount(threadCount);
+
+    osmscout::StopClock timer;
+
+    for (size_t iteration=0; iteration<iterations; iteration++) {
+      std::vector<osmscout::RoutingResult> results=router.CalculateRoutes(routingProfile,
+                                                                          requests,
+                                                                          parameter);
+
+      for (auto& result : results) {
+        if (result.Success()) {
+          batchRouteSize+=result.GetRoute().Entries().size();
+        }
+      }
+    }
+
+    timer.Stop();
+
+    std::cout << std::setw(12) << std::left << (threadCount==1 ? "batch" : "batch (mt)");
+    std::cout << " " << std::setw(10) << std::right << std::fixed << std::setprecision(3) << timer.GetMilliseconds()/iterations << " ms";
+    std::cout << ", " << batchRouteSize/iterations << " route entries" << std::endl;
+
+    if (batchRouteSize!=routeSize) {
+      std::cerr << "Routes calculated one by one and as batch differ!" << std::endl;
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+int main(int argc, char* argv[])
+{
+  osmscout::Vehicle   vehicle=osmscout::vehicleCar;
+  size_t              iterations=3;
+  size_t              randomQueries=20;
+  bool                matrix=false;
+  bool                batch=false;
+  std::vector<Query>  queries;
+  int                 currentArg=1;
+
+  while (currentArg<argc) {
+    if (strcmp(argv[currentArg],"--foot")==0) {
+      vehicle=osmscout::vehicleFoot;
+      currentArg++;
+    }
+    else if (strcmp(argv[currentArg],"--bicycle")==0) {
+      vehicle=osmscout::vehicleBicycle;
+      currentArg++;
+    }
+    else if (strcmp(argv[currentArg],"--car")==0) {
+      vehicle=osmscout::vehicleCar;
+      currentArg++;
+    }
+    else if (strcmp(argv[currentArg],"--batch")==0) {
+      batch=true;
+      currentArg++;
+    }
+    else if (strcmp(argv[currentArg],"--matrix")==0) {
+      matrix=true;
+      currentArg++;
+    }
+    else if (strcmp(argv[currentArg],"--iterations")==0 &&
+             currentArg+1<argc &&
+             sscanf(argv[currentArg+1],"%zu",&iterations)==1) {
+      currentArg+=2;
+    }
+    else if (strcmp(argv[currentArg],"--random")==0 &&
+             currentArg+1<argc &&
+             sscanf(argv[currentArg+1],"%zu",&randomQueries)==1) {
+      currentArg+=2;
+    }
+    else {
+      break;
+    }
+  }
+
+  if (currentArg>=argc ||
+      (argc-currentArg-1)%4!=0) {
+    std::cerr << "RoutingPerformance" << std::endl;
+    std::cerr << "  [--foot | --bicycle | --car]" << std::endl;
+    std::cerr << "  [--matrix]" << std::endl;
+    std::cerr << "  [--batch]" << std::endl;
+    std::cerr << "  [--iterations <count>]" << std::endl;
+    std::cerr << "  [--random <query count>]" << std::endl;
+    std::cerr << "  <map directory>" << std::endl;
+    std::cerr << "  [<start lat> <start lon> <target lat> <target lon>]..." << std::endl;
+    return 1;
+  }
+
+  std::string mapDirectory=argv[currentArg];
+
+  currentArg++;
+
+  while (currentArg<argc) {
+    double startLat,startLon,targetLat,targetLon;
+
+    if (sscanf(argv[currentArg],"%lf",&startLat)!=1 ||
+        sscanf(argv[currentArg+1],"%lf",&startLon)!=1 ||
+        sscanf(argv[currentArg+2],"%lf",&targetLat)!=1 ||
+        sscanf(argv[currentArg+3],"%lf",&targetLon)!=1) {
+      std::cerr << "Coordinates are not numeric!" << std::endl;
+      return 1;
+    }
+
+    queries.push_back(Query{osmscout::GeoCoord(startLat,startLon),
+                            osmscout::GeoCoord(targetLat,targetLon)});
+
+    currentArg+=4;
+  }
+
+  osmscout::DatabaseParameter databaseParameter;
+  osmscout::DatabaseRef       database=std::make_shared<osmscout::Database>(databaseParameter);
+
+  if (!database->Open(mapDirectory)) {
+    std::cerr << "Cannot open database" << std::endl;
+    return 1;
+  }
+
+  if (queries.empty()) {
+    osmscout::GeoBox boundingBox;
+
+    if (!database->GetBoundingBox(boundingBox)) {
+      std::cerr << "Cannot read bounding box of database" << std::endl;
+      return 1;
+    }
+
+    std::mt19937                           generator(4711);
+    std::uniform_real_distribution<double> latDistribution(boundingBox.GetMinLat(),boundingBox.GetMaxLat());
+    std::uniform_real_distribution<double> lonDistribution(boundingBox.GetMinLon(),boundingBox.GetMaxLon());
+
+    for (size_t i=0; i<randomQueries; i++) {
+      osmscout::GeoCoord start(latDistribution(generator),lonDistribution(generator));
+      osmscout::GeoCoord target(latDistribution(generator),lonDistribution(generator));
+
+      queries.push_back(Query{start,target});
+    }
+  }
+
+  osmscout::RouterParameter         routerParameter;
+  osmscout::SimpleRoutingServiceRef router=std::make_shared<osmscout::SimpleRoutingService>(database,
+                                                                                            routerParameter,
+                                                                                            osmscout::RoutingService::DEFAULT_FILENAME_BASE);
+
+  if (!router->Open()) {
+    std::cerr << "Cannot open routing database" << std::endl;
+    return 1;
+  }
+
+  osmscout::TypeConfigRef                typeConfig=database->GetTypeConfig();
+  osmscout::FastestPathRoutingProfileRef routingProfile=std::make_shared<osmscout::FastestPathRoutingProfile>(typeConfig);
+  std::map<std::string,double>           carSpeedTable;
+
+  switch (vehicle) {
+  case osmscout::vehicleFoot:
+    routingProfile->ParametrizeForFoot(*typeConfig,
+                                       5.0);
+    break;
+  case osmscout::vehicleBicycle:
+    routingProfile->ParametrizeForBicycle(*typeConfig,
+                                          20.0);
+    break;
+  case osmscout::vehicleCar:
+    GetCarSpeedTable(carSpeedTable);
+    routingProfile->ParametrizeForCar(*typeConfig,
+                                      carSpeedTable,
+                                      160.0);
+    break;
+  }
+
+  std::vector<std::pair<osmscout::RoutePosition,osmscout::RoutePosition>> positions;
+
+  for (const auto& query : queries) {
+    double                  radius=1000.0;
+    osmscout::RoutePosition start=router->GetClosestRoutableNode(query.start,
+                                                                 *routingProfile,
+                                                                 radius);
+
+    radius=1000.0;
+
+    osmscout::RoutePosition target=router->GetClosestRoutableNode(query.target,
+                                                                  *routingProfile,
+                                                                  radius);
+
+    if (start.IsValid() &&
+        target.IsValid()) {
+      positions.push_back(std::make_pair(start,target));
+    }
+  }
+
+  if (positions.empty()) {
+    std::cerr << "No routable query" << std::endl;
+    return 1;
+  }
+
+  std::cout << "Queries: " << positions.size() << ", iterations: " << iterations << std::endl;
+
+  // Warm up the route node cache, so that all open list types see the same cache state
+  for (const auto& position : positions) {
+    osmscout::RoutingParameter parameter;
+
+    router->CalculateRoute(*routingProfile,
+                           position.first,
+                           position.second,
+                           parameter);
+  }
+
+  if (matrix) {
+    return MeasureMatrix(*router,
+                         *routingProfile,
+                         positions,
+                         iterations);
+  }
+
+  if (batch) {
+    return MeasureBatch(*router,
+                        *routingProfile,
+                        positions,
+                        iterations);
+  }
+
+  std::vector<size_t> routeSizes;
+
+  for (const auto& openListType : openListTypes) {
+    osmscout::RoutingParameter parameter;
+    size_t                     routesFound=0;
+    size_t                     routeSize=0;
+
+    parameter.SetOpenListType(openListType.type);
+
+    osmscout::StopClock timer;
+
+    for (size_t iteration=0; iteration<iterations; iteration++) {
+      for (const auto& position : positions) {
+        osmscout::RoutingResult result=router->CalculateRoute(*routingProfile,
+                                                              position.first,
+                                                              position.second,
+                                                              parameter);
+
+        if (result.Success()) {
+          routesFound++;
+          routeSize+=result.GetRoute().Entries().size();
+        }
+      }
+    }
+
+    timer.Stop();
+
+    std::cout << std::setw(12) << std::left << openListType.name;
+    std::cout << " " << std::setw(10) << std::right << std::fixed << std::setprecision(3) << timer.GetMilliseconds()/(iterations*positions.size()) << " ms/route";
+    std::cout << ", " << routesFound/iterations << " routes, " << routeSize/iterations << " route entries" << std::endl;
+
+    routeSizes.push_back(routeSize);
+  }
+
+  router->Close();
+
+  if (routeSizes[0]!=routeSizes[1]) {
+    std::cerr << "Routes calculated with std::set and 4-ary heap differ!" << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
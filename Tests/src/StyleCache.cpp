@@ -0,0 +1,586 @@
+/*
+  StyleCache - a test program for libosmscout
+  Copyright (C) 2017  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <iostream>
+#include <list>
+#include <vector>
+
+#include <cstdlib>
+
+#include <osmscout/TypeConfig.h>
+#include <osmscout/StyleConfig.h>
+
+#include <osmscout/util/File.h>
+#include <osmscout/util/Projection.h>
+
+/**
+ * Compares the styles returned by a StyleConfig with filled style caches with the styles
+ * returned by a second StyleConfig that has its caches cleared before every lookup.
+ *
+ * Every type is checked for all levels, with no features, each single feature and all
+ * features set, at different latitudes and DPI values, so that the size conditions of the
+ * style sheet evaluate differently for the same level.
+ */
+
+/*
+ * Label providers and symbols are instances of the StyleConfig, they are compared by name
+ * so that styles of different StyleConfig instances can be compared.
+ */
+static bool Equals(const osmscout::LabelProviderRef& a,
+                   const osmscout::LabelProviderRef& b)
+{
+  return (!a && !b) || (a && b && a->GetName()==b->GetName());
+}
+
+static bool Equals(const osmscout::SymbolRef& a,
+                   const osmscout::SymbolRef& b)
+{
+  return (!a && !b) || (a && b && a->GetName()==b->GetName());
+}
+
+static bool Equals(const osmscout::LineStyleRef& a,
+                   const osmscout::LineStyleRef& b)
+{
+  return (!a && !b) ||
+         (a && b &&
+          a->GetSlot()==b->GetSlot() &&
+          a->GetLineColor()==b->GetLineColor() &&
+          a->GetGapColor()==b->GetGapColor() &&
+          a->GetDisplayWidth()==b->GetDisplayWidth() &&
+          a->GetWidth()==b->GetWidth() &&
+          a->GetDisplayOffset()==b->GetDisplayOffset() &&
+          a->GetOffset()==b->GetOffset() &&
+          a->GetJoinCap()==b->GetJoinCap() &&
+          a->GetEndCap()==b->GetEndCap() &&
+          a->GetDash()==b->GetDash() &&
+          a->GetPriority()==b->GetPriority() &&
+          a->GetZIndex()==b->GetZIndex());
+}
+
+static bool Equals(const osmscout::FillStyleRef& a,
+                   const osmscout::FillStyleRef& b)
+{
+  return (!a && !b) ||
+         (a && b &&
+          a->GetFillColor()==b->GetFillColor() &&
+          a->GetPatternName()==b->GetPatternName() &&
+          a->GetPatternMinMag().GetMagnification()==b->GetPatternMinMag().GetMagnification());
+}
+
+static bool Equals(const osmscout::BorderStyleRef& a,
+                   const osmscout::BorderStyleRef& b)
+{
+  return (!a && !b) ||
+         (a && b &&
+          a->GetSlot()==b->GetSlot() &&
+          a->GetColor()==b->GetColor() &&
+          a->GetGapColor()==b->GetGapColor() &&
+          a->GetWidth()==b->GetWidth() &&
+          a->GetDash()==b->GetDash() &&
+          a->GetDisplayOffset()==b->GetDisplayOffset() &&
+          a->GetOffset()==b->GetOffset() &&
+          a->GetPriority()==b->GetPriority());
+}
+
+static bool Equals(const osmscout::TextStyleRef& a,
+                   const osmscout::TextStyleRef& b)
+{
+  return (!a && !b) ||
+         (a && b &&
+          a->GetSlot()==b->GetSlot() &&
+          Equals(a->GetLabel(),b->GetLabel()) &&
+          a->GetPriority()==b->GetPriority() &&
+          a->GetSize()==b->GetSize() &&
+          a->GetPosition()==b->GetPosition() &&
+          a->GetTextColor()==b->GetTextColor() &&
+          a->GetStyle()==b->GetStyle() &&
+          a->GetScaleAndFadeMag().GetMagnification()==b->GetScaleAndFadeMag().GetMagnification() &&
+          a->GetAutoSize()==b->GetAutoSize());
+}
+
+static bool Equals(const osmscout::IconStyleRef& a,
+                   const osmscout::IconStyleRef& b)
+{
+  return (!a && !b) ||
+         (a && b &&
+          Equals(a->GetSymbol(),b->GetSymbol()) &&
+          a->GetIconName()==b->GetIconName() &&
+          a->GetPosition()==b->GetPosition());
+}
+
+static bool Equals(const osmscout::PathTextStyleRef& a,
+                   const osmscout::PathTextStyleRef& b)
+{
+  return (!a && !b) ||
+         (a && b &&
+          Equals(a->GetLabel(),b->GetLabel()) &&
+          a->GetSize()==b->GetSize() &&
+          a->GetTextColor()==b->GetTextColor() &&
+          a->GetDisplayOffset()==b->GetDisplayOffset() &&
+          a->GetOffset()==b->GetOffset());
+}
+
+static bool Equals(const osmscout::PathSymbolStyleRef& a,
+                   const osmscout::PathSymbolStyleRef& b)
+{
+  return (!a && !b) ||
+         (a && b &&
+          Equals(a->GetSymbol(),b->GetSymbol()) &&
+          a->GetSymbolSpace()==b->GetSymbolSpace());
+}
+
+static bool Equals(const osmscout::PathShieldStyleRef& a,
+                   const osmscout::PathShieldStyleRef& b)
+{
+  return (!a && !b) ||
+         (a && b &&
+          Equals(a->GetLabel(),b->GetLabel()) &&
+          a->GetPriority()==b->GetPriority() &&
+          a->GetSize()==b->GetSize() &&
+          a->GetTextColor()==b->GetTextColor() &&
+          a->GetBgColor()==b->GetBgColor() &&
+          a->GetBorderColor()==b->GetBorderColor() &&
+          a->GetShieldSpace()==b->GetShieldSpace());
+}
+
+template<class S>
+static bool Equals(const std::vector<S>& a,
+                   const std::vector<S>& b)
+{
+  if (a.size()!=b.size()) {
+    return false;
+  }
+
+  for (size_t i=0; i<a.size(); i++) {
+    if (!Equals(a[i],b[i])) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+class StyleChecker
+{
+private:
+  const osmscout::StyleConfig& cached;
+  osmscout::StyleConfig&       uncached;
+  size_t                       checkCount;
+  size_t                       errorCount;
+
+private:
+  template<class S>
+  void Check(const std::string& method,
+             const osmscout::FeatureValueBuffer& buffer,
+             const osmscout::Projection& projection,
+             const std::string& featureSet,
+             const S& cachedStyle,
+             const S& uncachedStyle)
+  {
+    checkCount++;
+
+    if (!Equals(cachedStyle,uncachedStyle)) {
+      std::cerr << method << " " << buffer.GetType()->GetName();
+      std::cerr << " level " << projection.GetMagnification().GetLevel();
+      std::cerr << " meterInPixel " << projection.GetMeterInPixel();
+      std::cerr << " features " << featureSet;
+      std::cerr << ": cached and uncached style differ" << std::endl;
+      errorCount++;
+    }
+  }
+
+  void CheckNode(const osmscout::FeatureValueBuffer& buffer,
+                 const osmscout::Projection& projection,
+                 const std::string& featureSet)
+  {
+    std::vector<osmscout::TextStyleRef> cachedTextStyles;
+    std::vector<osmscout::TextStyleRef> uncachedTextStyles;
+
+    cached.GetNodeTextStyles(buffer,projection,cachedTextStyles);
+    uncached.ClearStyleCaches();
+    uncached.GetNodeTextStyles(buffer,projection,uncachedTextStyles);
+    Check("GetNodeTextStyles",buffer,projection,featureSet,cachedTextStyles,uncachedTextStyles);
+
+    osmscout::IconStyleRef cachedIconStyle;
+    osmscout::IconStyleRef uncachedIconStyle;
+
+    cached.GetNodeIconStyle(buffer,projection,cachedIconStyle);
+    uncached.ClearStyleCaches();
+    uncached.GetNodeIconStyle(buffer,projection,uncachedIconStyle);
+    Check("GetNodeIconStyle",buffer,projection,featureSet,cachedIconStyle,uncachedIconStyle);
+  }
+
+  void CheckWay(const osmscout::FeatureValueBuffer& buffer,
+                const osmscout::Projection& projection,
+                const std::string& featureSet)
+  {
+    std::vector<osmscout::LineStyleRef> cachedLineStyles;
+    std::vector<osmscout::LineStyleRef> uncachedLineStyles;
+
+    cached.GetWayLineStyles(buffer,projection,cachedLineStyles);
+    uncached.ClearStyleCaches();
+    uncached.GetWayLineStyles(buffer,projection,uncachedLineStyles);
+    Check("GetWayLineStyles",buffer,projection,featureSet,cachedLineStyles,uncachedLineStyles);
+
+    osmscout::PathTextStyleRef cachedPathTextStyle;
+    osmscout::PathTextStyleRef uncachedPathTextStyle;
+
+    cached.GetWayPathTextStyle(buffer,projection,cachedPathTextStyle);
+    uncached.ClearStyleCaches();
+    uncached.GetWayPathTextStyle(buffer,projection,uncachedPathTextStyle);
+    Check("GetWayPathTextStyle",buffer,projection,featureSet,cachedPathTextStyle,uncachedPathTextStyle);
+
+    osmscout::PathSymbolStyleRef cachedPathSymbolStyle;
+    osmscout::PathSymbolStyleRef uncachedPathSymbolStyle;
+
+    cached.GetWayPathSymbolStyle(buffer,projection,cachedPathSymbolStyle);
+    uncached.ClearStyleCaches();
+    uncached.GetWayPathSymbolStyle(buffer,projection,uncachedPathSymbolStyle);
+    Check("GetWayPathSymbolStyle",buffer,projection,featureSet,cachedPathSymbolStyle,uncachedPathSymbolStyle);
+
+    osmscout::PathShieldStyleRef cachedPathShieldStyle;
+    osmscout::PathShieldStyleRef uncachedPathShieldStyle;
+
+    cached.GetWayPathShieldStyle(buffer,projection,cachedPathShieldStyle);
+    uncached.ClearStyleCaches();
+    uncached.GetWayPathShieldStyle(buffer,projection,uncachedPathShieldStyle);
+    Check("GetWayPathShieldStyle",buffer,projection,featureSet,cachedPathShieldStyle,uncachedPathShieldStyle);
+  }
+
+  void CheckArea(const osmscout::FeatureValueBuffer& buffer,
+                 const osmscout::Projection& projection,
+                 const std::string& featureSet)
+  {
+    const osmscout::TypeInfoRef& type=buffer.GetType();
+
+    osmscout::FillStyleRef cachedFillStyle;
+    osmscout::FillStyleRef uncachedFillStyle;
+
+    cached.GetAreaFillStyle(type,buffer,projection,cachedFillStyle);
+    uncached.ClearStyleCaches();
+    uncached.GetAreaFillStyle(type,buffer,projection,uncachedFillStyle);
+    Check("GetAreaFillStyle",buffer,projection,featureSet,cachedFillStyle,uncachedFillStyle);
+
+    std::vector<osmscout::BorderStyleRef> cachedBorderStyles;
+    std::vector<osmscout::BorderStyleRef> uncachedBorderStyles;
+
+    cached.GetAreaBorderStyles(type,buffer,projection,cachedBorderStyles);
+    uncached.ClearStyleCaches();
+    uncached.GetAreaBorderStyles(type,buffer,projection,uncachedBorderStyles);
+    Check("GetAreaBorderStyles",buffer,projection,featureSet,cachedBorderStyles,uncachedBorderStyles);
+
+    std::vector<osmscout::TextStyleRef> cachedTextStyles;
+    std::vector<osmscout::TextStyleRef> uncachedTextStyles;
+
+    cached.GetAreaTextStyles(type,buffer,projection,cachedTextStyles);
+    uncached.ClearStyleCaches();
+    uncached.GetAreaTextStyles(type,buffer,projection,uncachedTextStyles);
+    Check("GetAreaTextStyles",buffer,projection,featureSet,cachedTextStyles,uncachedTextStyles);
+
+    osmscout::IconStyleRef cachedIconStyle;
+    osmscout::IconStyleRef uncachedIconStyle;
+
+    cached.GetAreaIconStyle(type,buffer,projection,cachedIconStyle);
+    uncached.ClearStyleCaches();
+    uncached.GetAreaIconStyle(type,buffer,projection,uncachedIconStyle);
+    Check("GetAreaIconStyle",buffer,projection,featureSet,cachedIconStyle,uncachedIconStyle);
+
+    osmscout::PathTextStyleRef cachedPathTextStyle;
+    osmscout::PathTextStyleRef uncachedPathTextStyle;
+
+    cached.GetAreaBorderTextStyle(type,buffer,projection,cachedPathTextStyle);
+    uncached.ClearStyleCaches();
+    uncached.GetAreaBorderTextStyle(type,buffer,projection,uncachedPathTextStyle);
+    Check("GetAreaBorderTextStyle",buffer,projection,featureSet,cachedPathTextStyle,uncachedPathTextStyle);
+
+    osmscout::PathSymbolStyleRef cachedPathSymbolStyle;
+    osmscout::PathSymbolStyleRef uncachedPathSymbolStyle;
+
+    cached.GetAreaBorderSymbolStyle(type,buffer,projection,cachedPathSymbolStyle);
+    uncached.ClearStyleCaches();
+    uncached.GetAreaBorderSymbolStyle(type,buffer,projection,uncachedPathSymbolStyle);
+    Check("GetAreaBorderSymbolStyle",buffer,projection,featureSet,cachedPathSymbolStyle,uncachedPathSymbolStyle);
+  }
+
+  void CheckBuffer(const osmscout::FeatureValueBuffer& buffer,
+                   const osmscout::Projection& projection,
+                   const std::string& featureSet)
+  {
+    const osmscout::TypeInfoRef& type=buffer.GetType();
+
+    if (type->CanBeNode()) {
+      CheckNode(buffer,projection,featureSet);
+    }
+
+    if (type->CanBeWay()) {
+      CheckWay(buffer,projection,featureSet);
+    }
+
+    if (type->CanBeArea()) {
+      CheckArea(buffer,projection,featureSet);
+    }
+  }
+
+public:
+  StyleChecker(const osmscout::StyleConfig& cached,
+               osmscout::StyleConfig& uncached)
+  : cached(cached),
+    uncached(uncached),
+    checkCount(0),
+    errorCount(0)
+  {
+    // no code
+  }
+
+  void CheckType(const osmscout::TypeInfoRef& type,
+                 const osmscout::Projection& projection)
+  {
+    osmscout::FeatureValueBuffer buffer;
+
+    buffer.SetType(type);
+
+    CheckBuffer(buffer,projection,"none");
+
+    for (size_t idx=0; idx<buffer.GetFeatureCount(); idx++) {
+      buffer.AllocateValue(idx);
+      CheckBuffer(buffer,projection,buffer.GetFeature(idx).GetFeature()->GetName());
+      buffer.FreeValue(idx);
+    }
+
+    for (size_t idx=0; idx<buffer.GetFeatureCount(); idx++) {
+      buffer.AllocateValue(idx);
+    }
+
+    CheckBuffer(buffer,projection,"all");
+  }
+
+  inline size_t GetCheckCount() const
+  {
+    return checkCount;
+  }
+
+  inline size_t GetErrorCount() const
+  {
+    return errorCount;
+  }
+};
+
+static size_t CheckStyleConfig(const osmscout::TypeConfigRef& typeConfig,
+                               const osmscout::StyleConfig& cached,
+                               osmscout::StyleConfig& uncached)
+{
+  const std::list<double> latitudes={0.0,45.0,60.0,75.0};
+  const std::list<double> dpis={96.0,300.0};
+
+  StyleChecker checker(cached,
+                       uncached);
+
+  // The latitude is the outer loop, so that most lookups at the second and later
+  // latitudes are answered from cache entries created for another projection
+  for (const auto latitude : latitudes) {
+    for (const auto dpi : dpis) {
+      for (uint32_t level=0; level<=20; level++) {
+        osmscout::MercatorProjection projection;
+        osmscout::Magnification      magnification;
+
+        magnification.SetLevel(level);
+
+        if (!projection.Set(osmscout::GeoCoord(latitude,7.0),
+                            magnification,
+                            dpi,
+                            800,
+                            600)) {
+          std::cerr << "Cannot set projection" << std::endl;
+          return 1;
+        }
+
+        for (const auto& type : typeConfig->GetTypes()) {
+          if (type->GetIgnore()) {
+            continue;
+          }
+
+          checker.CheckType(type,
+                            projection);
+        }
+      }
+    }
+  }
+
+  std::cout << checker.GetCheckCount() << " lookups, " << checker.GetErrorCount() << " errors" << std::endl;
+
+  return checker.GetErrorCount();
+}
+
+static osmscout::StyleCacheKey GetCacheKey(size_t type)
+{
+  osmscout::StyleCacheKey key;
+
+  key.type=type;
+  key.level=0;
+  key.features=0;
+  key.sizeConditions=0;
+  key.oneway=false;
+
+  return key;
+}
+
+/**
+ * A full cache must evict entries that were not requested recently, while entries
+ * requested between insertions stay in the cache
+ */
+static size_t CheckEviction()
+{
+  const size_t maxEntries=16;
+
+  osmscout::StyleCache<size_t> cache(maxEntries);
+  size_t                       errorCount=0;
+  size_t                       value;
+
+  for (size_t type=0; type<1000; type++) {
+    cache.Set(GetCacheKey(type),type);
+
+    // Type 0 is requested before each insertion and must never be evicted
+    if (!cache.Get(GetCacheKey(0),value) ||
+        value!=0) {
+      std::cerr << "Frequently used entry evicted after insertion of type " << type << std::endl;
+      errorCount++;
+    }
+
+    if (cache.GetSize()>maxEntries) {
+      std::cerr << "Cache holds " << cache.GetSize() << " entries, expected at most " << maxEntries << std::endl;
+      errorCount++;
+    }
+  }
+
+  // The most recently inserted entry is never evicted immediately
+  if (!cache.Get(GetCacheKey(999),value) ||
+      value!=999) {
+    std::cerr << "Last inserted entry missing" << std::endl;
+    errorCount++;
+  }
+
+  size_t cachedCount=0;
+
+  for (size_t type=0; type<1000; type++) {
+    if (cache.Get(GetCacheKey(type),value)) {
+      if (value!=type) {
+        std::cerr << "Wrong value " << value << " for type " << type << std::endl;
+        errorCount++;
+      }
+
+      cachedCount++;
+    }
+  }
+
+  if (cachedCount!=maxEntries) {
+    std::cerr << cachedCount << " cached entries, expected " << maxEntries << std::endl;
+    errorCount++;
+  }
+
+  cache.Clear();
+
+  if (cache.GetSize()!=0 ||
+      cache.Get(GetCacheKey(0),value)) {
+    std::cerr << "Cache not empty after Clear()" << std::endl;
+    errorCount++;
+  }
+
+  return errorCount;
+}
+
+int main(int /*argc*/, char** /*argv*/)
+{
+  size_t errorCount=0;
+
+  std::cout << "Checking style cache eviction..." << std::endl;
+  errorCount+=CheckEviction();
+
+  char* testsTopDirEnv=getenv("TESTS_TOP_DIR");
+
+  if (testsTopDirEnv==NULL) {
+    std::cerr << "Expected environment variable 'TESTS_TOP_DIR' not set" << std::endl;
+    // CMake-based tests would fail, if we do not exit here
+    return 1;
+  }
+
+  std::string testsTopDir=testsTopDirEnv;
+
+  if (testsTopDir.empty()) {
+    std::cerr << "Environment variable 'TESTS_TOP_DIR' is empty" << std::endl;
+    return 77;
+  }
+
+  if (!osmscout::IsDirectory(testsTopDir)) {
+    std::cerr << "Environment variable 'TESTS_TOP_DIR' does not point to directory" << std::endl;
+    return 77;
+  }
+
+  std::string stylesheetDir=osmscout::AppendFileToDir(testsTopDir,"../stylesheets");
+
+  if (!osmscout::IsDirectory(stylesheetDir)) {
+    std::cerr << "Calculated stylesheet directory does not point to directory" << std::endl;
+    return 77;
+  }
+
+  osmscout::TypeConfigRef typeConfig=std::make_shared<osmscout::TypeConfig>();
+  std::string             ostFilepath=osmscout::AppendFileToDir(stylesheetDir,"map.ost");
+  std::string             standardFilepath=osmscout::AppendFileToDir(stylesheetDir,"standard.oss");
+  std::string             winterSportsFilepath=osmscout::AppendFileToDir(stylesheetDir,"winter-sports.oss");
+
+  if (!typeConfig->LoadFromOSTFile(ostFilepath)) {
+    std::cerr << "Cannot load OST file '" << ostFilepath << "'" << std::endl;
+    return 1;
+  }
+
+  osmscout::StyleConfig cached(typeConfig);
+  osmscout::StyleConfig uncached(typeConfig);
+
+  if (!cached.Load(standardFilepath) ||
+      !uncached.Load(standardFilepath)) {
+    std::cerr << "Cannot load OSS file '" << standardFilepath << "'" << std::endl;
+    return 1;
+  }
+
+  std::cout << "Checking cached styles of '" << standardFilepath << "'..." << std::endl;
+  errorCount+=CheckStyleConfig(typeConfig,
+                               cached,
+                               uncached);
+
+  // The caches of 'cached' are filled with styles of the old style sheet now, a reload
+  // must drop them
+  osmscout::StyleConfig reloaded(typeConfig);
+
+  if (!cached.Load(winterSportsFilepath) ||
+      !reloaded.Load(winterSportsFilepath)) {
+    std::cerr << "Cannot load OSS file '" << winterSportsFilepath << "'" << std::endl;
+    return 1;
+  }
+
+  std::cout << "Checking cached styles after reload of '" << winterSportsFilepath << "'..." << std::endl;
+  errorCount+=CheckStyleConfig(typeConfig,
+                               cached,
+                               reloaded);
+
+  if (errorCount>0) {
+    return 1;
+  }
+  else {
+    return 0;
+  }
+}
@@ -0,0 +1,137 @@
+#ifndef OSMSCOUT_IMPORT_GENROUTECHDAT_H
+#define OSMSCOUT_IMPORT_GENROUTECHDAT_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2017  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <string>
+#include <vector>
+
+#include <osmscout/ObjectRef.h>
+#include <osmscout/Types.h>
+
+#include <osmscout/routing/ContractionHierarchy.h>
+#include <osmscout/routing/RoutingProfile.h>
+
+#include <osmscout/import/Import.h>
+
+#include <osmscout/system/Compiler.h>
+
+namespace osmscout {
+
+  /**
+   * Generates a contraction hierarchy for each vehicle of each router (see
+   * ImportParameter::SetContractionHierarchies()).
+   *
+   * Edge costs are calculated using a FastestPathRoutingProfile parametrized for
+   * the vehicle. Paths with access restrictions are not part of the hierarchy.
+   */
+  class RouteCHDataGenerator CLASS_FINAL : public ImportModule
+  {
+  private:
+    struct Edge
+    {
+      uint32_t      node;   //!< Index of the node at the other end of the edge
+      uint32_t      middle; //!< Index of the contracted node for shortcuts, else ContractionHierarchy::INVALID_NODE
+      double        cost;   //!< Cost of the edge
+      ObjectFileRef object; //!< Object of the path, only valid for non-shortcut edges
+    };
+
+    struct Shortcut
+    {
+      uint32_t from;
+      uint32_t to;
+      double   cost;
+    };
+
+    struct WitnessNode
+    {
+      double cost;
+      bool   settled;
+    };
+
+    /**
+     * The routing graph of one vehicle during contraction
+     */
+    struct Graph
+    {
+      std::vector<FileOffset>        nodeOffsets;    //!< File offsets of the route nodes, ascending
+      std::vector<uint8_t>           nodeFlags;      //!< Flags of the route nodes
+      std::vector<std::vector<Edge>> outEdges;       //!< Edges leaving a node
+      std::vector<std::vector<Edge>> inEdges;        //!< Edges entering a node (Edge::node is the source)
+      std::vector<bool>              contracted;     //!< Node has already been contracted
+      std::vector<uint32_t>          rank;           //!< Order of contraction
+      std::vector<WitnessNode>       witness;        //!< State of the witness search
+      std::vector<uint32_t>          witnessTouched; //!< Nodes touched by the last witness search
+    };
+
+  private:
+    bool LoadGraph(const TypeConfigRef& typeConfig,
+                   const ImportParameter& parameter,
+                   Progress& progress,
+                   const ImportParameter::Router& router,
+                   RoutingProfile& profile,
+                   Graph& graph);
+
+    void AddEdge(Graph& graph,
+                 uint32_t from,
+                 uint32_t to,
+                 uint32_t middle,
+                 double cost,
+                 const ObjectFileRef& object);
+
+    void WitnessSearch(Graph& graph,
+                       uint32_t start,
+                       uint32_t ignore,
+                       double maxCost);
+
+    void FindShortcuts(Graph& graph,
+                       uint32_t node,
+                       std::vector<Shortcut>& shortcuts);
+
+    int CalculatePriority(Graph& graph,
+                          uint32_t node,
+                          uint32_t deletedNeighbours,
+                          std::vector<Shortcut>& shortcuts);
+
+    void Contract(Graph& graph,
+                  Progress& progress);
+
+    void WriteHierarchy(const Graph& graph,
+                        const std::string& filename);
+
+    bool GenerateHierarchy(const TypeConfigRef& typeConfig,
+                           const ImportParameter& parameter,
+                           Progress& progress,
+                           const ImportParameter::Router& router,
+                           Vehicle vehicle);
+
+  public:
+    RouteCHDataGenerator();
+
+    void GetDescription(const ImportParameter& parameter,
+                        ImportModuleDescription& description) const;
+
+    bool Import(const TypeConfigRef& typeConfig,
+                const ImportParameter& parameter,
+                Progress& progress);
+  };
+}
+
+#endif
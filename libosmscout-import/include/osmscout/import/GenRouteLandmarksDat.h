@@ -0,0 +1,93 @@
+#ifndef OSMSCOUT_IMPORT_GENROUTELANDMARKSDAT_H
+#define OSMSCOUT_IMPORT_GENROUTELANDMARKSDAT_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2017  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <string>
+#include <vector>
+
+#include <osmscout/Types.h>
+
+#include <osmscout/routing/Landmarks.h>
+
+#include <osmscout/import/Import.h>
+
+#include <osmscout/system/Compiler.h>
+
+namespace osmscout {
+
+  /**
+   * Selects landmarks and generates the table of the distances of all route nodes
+   * to the landmarks for each vehicle of each router (see
+   * ImportParameter::SetLandmarkCount()).
+   *
+   * Distances are calculated on the graph of all paths usable by the vehicle,
+   * ignoring direction and access restrictions, so that the table is valid for
+   * every routing profile of the vehicle. Landmarks are selected from the largest
+   * connected part of the graph by repeatedly choosing the route node farthest
+   * away from all landmarks selected so far.
+   */
+  class RouteLandmarkDataGenerator CLASS_FINAL : public ImportModule
+  {
+  private:
+    /**
+     * The undirected graph of all paths usable by one vehicle
+     */
+    struct Graph
+    {
+      std::vector<FileOffset> nodeOffsets;   //!< File offsets of the route nodes, ascending
+      std::vector<uint32_t>   edgeStart;     //!< Index of the first edge of a node, size is node count+1
+      std::vector<uint32_t>   edgeTargets;   //!< Index of the node at the other end of the edge
+      std::vector<double>     edgeDistances; //!< Length of the edge
+    };
+
+  private:
+    bool LoadGraph(const TypeConfigRef& typeConfig,
+                   const ImportParameter& parameter,
+                   Progress& progress,
+                   const ImportParameter::Router& router,
+                   Vehicle vehicle,
+                   Graph& graph);
+
+    uint32_t GetLargestComponentNode(const Graph& graph);
+
+    void CalculateDistances(const Graph& graph,
+                            uint32_t source,
+                            std::vector<double>& distances);
+
+    bool GenerateLandmarks(const TypeConfigRef& typeConfig,
+                           const ImportParameter& parameter,
+                           Progress& progress,
+                           const ImportParameter::Router& router,
+                           Vehicle vehicle);
+
+  public:
+    RouteLandmarkDataGenerator();
+
+    void GetDescription(const ImportParameter& parameter,
+                        ImportModuleDescription& description) const;
+
+    bool Import(const TypeConfigRef& typeConfig,
+                const ImportParameter& parameter,
+                Progress& progress);
+  };
+}
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef OSMSCOUT_IMPORT_GENROUTESEGMENTIDX_H
+#define OSMSCOUT_IMPORT_GENROUTESEGMENTIDX_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2017  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/TypeFeatures.h>
+
+#include <osmscout/routing/RouteSegmentIndex.h>
+
+#include <osmscout/import/Import.h>
+
+#include <osmscout/system/Compiler.h>
+
+namespace osmscout {
+
+  /**
+   * Generates the grid index of the segments of all routable ways for each router
+   * (see ImportParameter::SetRouteSegmentIndex() and RouteSegmentIndex).
+   *
+   * A way is part of the index of a router, if it is routable by at least one
+   * vehicle of the router and has at least one node that may be a route node. The
+   * vehicles are evaluated like AbstractRoutingProfile::CanUse(const Way&) does.
+   */
+  class RouteSegmentIndexGenerator CLASS_FINAL : public ImportModule
+  {
+  private:
+    static const uint32_t CELLS_PER_DEGREE;
+
+  private:
+    uint8_t GetFlags(const AccessFeatureValueReader& accessReader,
+                     const Way& way,
+                     VehicleMask vehicleMask) const;
+
+    bool GenerateIndex(const TypeConfigRef& typeConfig,
+                       const ImportParameter& parameter,
+                       Progress& progress,
+                       const ImportParameter::Router& router);
+
+  public:
+    RouteSegmentIndexGenerator();
+
+    void GetDescription(const ImportParameter& parameter,
+                        ImportModuleDescription& description) const;
+
+    bool Import(const TypeConfigRef& typeConfig,
+                const ImportParameter& parameter,
+                Progress& progress);
+  };
+}
+
+#endif
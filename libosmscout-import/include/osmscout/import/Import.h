@@ -21,6 +21,7 @@
 */
 
 #include <list>
+#include <map>
 #include <mutex>
 #include <string>
 
@@ -120,6 +121,11 @@ namespace osmscout {
 
     size_t                       numericIndexPageSize;     //<! Size of an numeric index page in bytes
 
+    bool                         columnarCoords;           //<! Write coordinates of the final data files in columnar encoding
+
+    bool                         compressDataFiles;        //<! Replace large data files by block compressed copies
+    size_t                       compressionBlockSize;     //<! Uncompressed size of a block of compressed data files
+
     size_t                       rawCoordBlockSize;        //<! Number of raw coords loaded during import in one go
 
     bool                         rawNodeDataMemoryMaped;   //<! Use memory mapping for raw node data file access
@@ -160,6 +166,13 @@ namespace osmscout {
     TransPolygon::OptimizeMethod optimizationWayMethod;    //<! what method to use to optimize ways
 
     size_t                       routeNodeBlockSize;       //<! Number of route nodes loaded during import until ways get resolved
+    bool                         contractionHierarchies;   //<! Generate a contraction hierarchy for each router and vehicle
+    size_t                       landmarkCount;            //<! Number of routing landmarks for each router and vehicle, 0 for none
+    bool                         routeSegmentIndex;        //<! Generate an index of the segments of the routable ways for each router
+    std::map<std::string,double> carSpeedTable;            //<! Car speed per type used for the car contraction hierarchy
+    double                       footSpeed;                //<! Foot speed (km/h) used for the foot contraction hierarchy
+    double                       bicycleSpeed;             //<! Bicycle speed (km/h) used for the bicycle contraction hierarchy
+    double                       carMaxSpeed;              //<! Maximum car speed (km/h) used for the car contraction hierarchy
 
     AssumeLandStrategy           assumeLand;               //<! During sea/land detection,we either trust coastlines only or make some
                                                            //<! assumptions which tiles are sea and which are land.
@@ -199,6 +212,11 @@ namespace osmscout {
 
     size_t GetNumericIndexPageSize() const;
 
+    bool GetColumnarCoords() const;
+
+    bool GetCompressDataFiles() const;
+    size_t GetCompressionBlockSize() const;
+
     size_t GetRawCoordBlockSize() const;
 
     bool GetRawNodeDataMemoryMaped() const;
@@ -240,6 +258,13 @@ namespace osmscout {
     TransPolygon::OptimizeMethod GetOptimizationWayMethod() const;
 
     size_t GetRouteNodeBlockSize() const;
+    bool GetContractionHierarchies() const;
+    size_t GetLandmarkCount() const;
+    bool GetRouteSegmentIndex() const;
+    const std::map<std::string,double>& GetCarSpeedTable() const;
+    double GetFootSpeed() const;
+    double GetBicycleSpeed() const;
+    double GetCarMaxSpeed() const;
 
     AssumeLandStrategy GetAssumeLand() const;
 
@@ -274,6 +299,11 @@ namespace osmscout {
 
     void SetNumericIndexPageSize(size_t numericIndexPageSize);
 
+    void SetColumnarCoords(bool columnarCoords);
+
+    void SetCompressDataFiles(bool compressDataFiles);
+    bool SetCompressionBlockSize(size_t compressionBlockSize);
+
     void SetRawCoordBlockSize(size_t blockSize);
 
     void SetRawNodeDataMemoryMaped(bool memoryMaped);
@@ -316,6 +346,13 @@ namespace osmscout {
     void SetOptimizationWayMethod(TransPolygon::OptimizeMethod optimizationWayMethod);
 
     void SetRouteNodeBlockSize(size_t blockSize);
+    void SetContractionHierarchies(bool contractionHierarchies);
+    void SetLandmarkCount(size_t landmarkCount);
+    void SetRouteSegmentIndex(bool routeSegmentIndex);
+    void SetCarSpeedTable(const std::map<std::string,double>& carSpeedTable);
+    void SetFootSpeed(double footSpeed);
+    void SetBicycleSpeed(double bicycleSpeed);
+    void SetCarMaxSpeed(double carMaxSpeed);
 
     void SetAssumeLand(AssumeLandStrategy assumeLand);
 
@@ -440,7 +477,6 @@ namespace osmscout {
   private:
     bool ValidateDescription(Progress& progress);
     bool ValidateParameter(Progress& progress);
-    void GetModuleList(std::vector<ImportModuleRef>& modules);
     void DumpTypeConfigData(const TypeConfig& typeConfig,
                             Progress& progress);
     void DumpModuleDescription(const ImportModuleDescription& description,
@@ -456,6 +492,8 @@ namespace osmscout {
 
     bool Import(Progress& progress);
 
+    static void GetModuleList(std::vector<ImportModuleRef>& modules);
+
     std::list<std::string> GetProvidedFiles() const;
     std::list<std::string> GetProvidedOptionalFiles() const;
     std::list<std::string> GetProvidedDebuggingFiles() const;
@@ -210,6 +210,7 @@ namespace osmscout {
 
       dataWriter.Open(AppendFileToDir(parameter.GetDestinationDirectory(),
                                       dataFilename));
+      dataWriter.SetColumnarCoords(parameter.GetColumnarCoords());
 
       dataWriter.Write(overallDataCount);
 
@@ -422,6 +423,7 @@ namespace osmscout {
     try {
       dataWriter.Open(AppendFileToDir(parameter.GetDestinationDirectory(),
                                       dataFilename));
+      dataWriter.SetColumnarCoords(parameter.GetColumnarCoords());
 
       dataWriter.Write(overallDataCount);
 
@@ -953,6 +953,7 @@ namespace osmscout {
 
       dataWriter.Open(AppendFileToDir(parameter.GetDestinationDirectory(),
                                       AreaDataFile::AREAS_DAT));
+      dataWriter.SetColumnarCoords(parameter.GetColumnarCoords());
 
       dataWriter.Write(overallDataCount);
 
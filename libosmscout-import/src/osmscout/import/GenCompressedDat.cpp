@@ -0,0 +1,110 @@
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2017  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/import/GenCompressedDat.h>
+
+#include <osmscout/AreaDataFile.h>
+#include <osmscout/LocationIndex.h>
+#include <osmscout/WayDataFile.h>
+
+#include <osmscout/routing/RoutingService.h>
+
+#include <osmscout/util/BlockCompressedFile.h>
+#include <osmscout/util/File.h>
+#include <osmscout/util/String.h>
+
+namespace osmscout {
+
+  std::list<std::string> CompressedDataGenerator::GetFilesToCompress(const ImportParameter& parameter) const
+  {
+    std::list<std::string> files;
+
+    files.push_back(WayDataFile::WAYS_DAT);
+    files.push_back(AreaDataFile::AREAS_DAT);
+
+    for (const auto& router : parameter.GetRouter()) {
+      files.push_back(router.GetDataFilename());
+    }
+
+    files.push_back(LocationIndex::FILENAME_LOCATION_IDX);
+
+    return files;
+  }
+
+  void CompressedDataGenerator::GetDescription(const ImportParameter& parameter,
+                                               ImportModuleDescription& description) const
+  {
+    description.SetName("CompressedDataGenerator");
+    description.SetDescription("Block compress data files");
+
+    for (const auto& file : GetFilesToCompress(parameter)) {
+      description.AddRequiredFile(file);
+    }
+  }
+
+  bool CompressedDataGenerator::Import(const TypeConfigRef& /*typeConfig*/,
+                                       const ImportParameter& parameter,
+                                       Progress& progress)
+  {
+    progress.SetAction("Block compress data files");
+
+    if (!parameter.GetCompressDataFiles()) {
+      progress.Info("Compression of data files is not activated");
+      return true;
+    }
+
+    if (!IsBlockCompressionSupported()) {
+      progress.Error("Compression of data files is not supported, library was built without zlib");
+      return false;
+    }
+
+    for (const auto& file : GetFilesToCompress(parameter)) {
+      std::string filename=AppendFileToDir(parameter.GetDestinationDirectory(),
+                                           file);
+      std::string tmpFilename=filename+".tmp";
+
+      try {
+        FileOffset size=GetFileSize(filename);
+
+        progress.Info("Compressing '"+file+"'...");
+
+        CompressFileInBlocks(filename,
+                             tmpFilename,
+                             parameter.GetCompressionBlockSize());
+
+        FileOffset compressedSize=GetFileSize(tmpFilename);
+
+        if (!RemoveFile(filename) ||
+            !RenameFile(tmpFilename,filename)) {
+          progress.Error("Cannot replace '"+filename+"' by its compressed copy");
+          return false;
+        }
+
+        progress.Info("'"+file+"': "+ByteSizeToString(size)+" => "+ByteSizeToString(compressedSize));
+      }
+      catch (IOException& e) {
+        progress.Error(e.GetDescription());
+        RemoveFile(tmpFilename);
+        return false;
+      }
+    }
+
+    return true;
+  }
+}
@@ -658,6 +658,7 @@ namespace osmscout
     try {
       writer.Open(AppendFileToDir(parameter.GetDestinationDirectory(),
                                   OptimizeAreasLowZoom::FILE_AREASOPT_DAT));
+      writer.SetColumnarCoords(parameter.GetColumnarCoords());
 
       //
       // Write header
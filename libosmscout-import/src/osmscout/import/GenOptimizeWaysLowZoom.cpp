@@ -782,6 +782,7 @@ namespace osmscout
     try {
       writer.Open(AppendFileToDir(parameter.GetDestinationDirectory(),
                                   OptimizeWaysLowZoom::FILE_WAYSOPT_DAT));
+      writer.SetColumnarCoords(parameter.GetColumnarCoords());
 
       //
       // Write header
@@ -0,0 +1,607 @@
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2017  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/import/GenRouteCHDat.h>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+
+#include <osmscout/ObjectVariantDataFile.h>
+
+#include <osmscout/routing/RouteNode.h>
+
+#include <osmscout/util/File.h>
+#include <osmscout/util/FileScanner.h>
+#include <osmscout/util/FileWriter.h>
+#include <osmscout/util/StopClock.h>
+#include <osmscout/util/String.h>
+
+namespace osmscout {
+
+  /**
+   * Maximum number of nodes settled by a witness search. A shortcut is
+   * added if no witness is found within this limit, which only results in
+   * superfluous shortcuts and never in wrong routes.
+   */
+  static const size_t maxWitnessSettledNodes=500;
+
+  static const double infiniteCost=std::numeric_limits<double>::max();
+
+  RouteCHDataGenerator::RouteCHDataGenerator()
+  {
+    // no code
+  }
+
+  void RouteCHDataGenerator::GetDescription(const ImportParameter& parameter,
+                                            ImportModuleDescription& description) const
+  {
+    description.SetName("RouteCHDataGenerator");
+    description.SetDescription("Generate contraction hierarchies of the routing graph(s)");
+
+    for (const auto& router : parameter.GetRouter()) {
+      description.AddRequiredFile(router.GetDataFilename());
+      description.AddRequiredFile(router.GetVariantFilename());
+
+      if (!parameter.GetContractionHierarchies()) {
+        continue;
+      }
+
+      for (Vehicle vehicle : {vehicleFoot, vehicleBicycle, vehicleCar}) {
+        if ((router.GetVehicleMask() & vehicle)!=0) {
+          description.AddProvidedFile(ContractionHierarchy::GetFilename(router.GetFilenamebase(),
+                                                                        vehicle));
+        }
+      }
+    }
+  }
+
+  /**
+   * Add an edge between the given nodes to the graph. If there is already an edge
+   * between the nodes, the cheaper one is kept.
+   */
+  void RouteCHDataGenerator::AddEdge(Graph& graph,
+                                     uint32_t from,
+                                     uint32_t to,
+                                     uint32_t middle,
+                                     double cost,
+                                     const ObjectFileRef& object)
+  {
+    if (from==to) {
+      return;
+    }
+
+    for (auto& edge : graph.outEdges[from]) {
+      if (edge.node!=to) {
+        continue;
+      }
+
+      if (cost<edge.cost) {
+        edge.middle=middle;
+        edge.cost=cost;
+        edge.object=object;
+
+        for (auto& inEdge : graph.inEdges[to]) {
+          if (inEdge.node==from) {
+            inEdge.middle=middle;
+            inEdge.cost=cost;
+            inEdge.object=object;
+            break;
+          }
+        }
+      }
+
+      return;
+    }
+
+    graph.outEdges[from].push_back(Edge{to,middle,cost,object});
+    graph.inEdges[to].push_back(Edge{from,middle,cost,object});
+  }
+
+  bool RouteCHDataGenerator::LoadGraph(const TypeConfigRef& typeConfig,
+                                       const ImportParameter& parameter,
+                                       Progress& progress,
+                                       const ImportParameter::Router& router,
+                                       RoutingProfile& profile,
+                                       Graph& graph)
+  {
+    struct PendingEdge
+    {
+      uint32_t      from;
+      FileOffset    to;
+      double        cost;
+      ObjectFileRef object;
+    };
+
+    ObjectVariantDataFile    objectVariantDataFile;
+    FileScanner              scanner;
+    std::vector<PendingEdge> pendingEdges;
+
+    if (!objectVariantDataFile.Load(*typeConfig,
+                                    AppendFileToDir(parameter.GetDestinationDirectory(),
+                                                    router.GetVariantFilename()))) {
+      progress.Error("Cannot load '"+router.GetVariantFilename()+"'");
+      return false;
+    }
+
+    const std::vector<ObjectVariantData>& objectVariantData=objectVariantDataFile.GetData();
+
+    try {
+      uint32_t nodeCount;
+
+      scanner.Open(AppendFileToDir(parameter.GetDestinationDirectory(),
+                                   router.GetDataFilename()),
+                   FileScanner::Sequential,
+                   true);
+
+      scanner.Read(nodeCount);
+
+      graph.nodeOffsets.reserve(nodeCount);
+      graph.nodeFlags.reserve(nodeCount);
+
+      for (uint32_t n=0; n<nodeCount; n++) {
+        RouteNode routeNode;
+
+        progress.SetProgress(n,nodeCount);
+
+        routeNode.Read(*typeConfig,
+                       scanner);
+
+        graph.nodeOffsets.push_back(routeNode.GetFileOffset());
+        graph.nodeFlags.push_back(routeNode.excludes.empty() ? 0 : ContractionHierarchy::hasExcludes);
+
+        for (size_t i=0; i<routeNode.paths.size(); i++) {
+          const RouteNode::Path& path=routeNode.paths[i];
+
+          if (path.IsRestricted(profile.GetVehicle()) ||
+              !profile.CanUse(routeNode,
+                              objectVariantData,
+                              i)) {
+            continue;
+          }
+
+          pendingEdges.push_back(PendingEdge{n,
+                                             path.offset,
+                                             profile.GetCosts(routeNode,
+                                                              objectVariantData,
+                                                              i),
+                                             routeNode.objects[path.objectIndex].object});
+        }
+      }
+
+      scanner.Close();
+    }
+    catch (IOException& e) {
+      progress.Error(e.GetDescription());
+      scanner.CloseFailsafe();
+      return false;
+    }
+
+    graph.outEdges.resize(graph.nodeOffsets.size());
+    graph.inEdges.resize(graph.nodeOffsets.size());
+
+    for (const auto& pendingEdge : pendingEdges) {
+      auto target=std::lower_bound(graph.nodeOffsets.begin(),
+                                   graph.nodeOffsets.end(),
+                                   pendingEdge.to);
+
+      if (target==graph.nodeOffsets.end() ||
+          *target!=pendingEdge.to) {
+        progress.Error("Cannot resolve route node at offset "+NumberToString(pendingEdge.to));
+        return false;
+      }
+
+      AddEdge(graph,
+              pendingEdge.from,
+              (uint32_t)(target-graph.nodeOffsets.begin()),
+              ContractionHierarchy::INVALID_NODE,
+              pendingEdge.cost,
+              pendingEdge.object);
+    }
+
+    return true;
+  }
+
+  /**
+   * Dijkstra search from the given start node on the not yet contracted nodes,
+   * excluding the given node. The search stops at the given cost limit or after
+   * maxWitnessSettledNodes nodes have been settled.
+   */
+  void RouteCHDataGenerator::WitnessSearch(Graph& graph,
+                                           uint32_t start,
+                                           uint32_t ignore,
+                                           double maxCost)
+  {
+    typedef std::pair<double,uint32_t> QueueEntry;
+
+    std::priority_queue<QueueEntry,std::vector<QueueEntry>,std::greater<QueueEntry>> queue;
+    size_t                                                                           settledCount=0;
+
+    for (uint32_t node : graph.witnessTouched) {
+      graph.witness[node].cost=infiniteCost;
+      graph.witness[node].settled=false;
+    }
+
+    graph.witnessTouched.clear();
+
+    graph.witness[start].cost=0.0;
+    graph.witnessTouched.push_back(start);
+    queue.push(QueueEntry(0.0,start));
+
+    while (!queue.empty()) {
+      QueueEntry entry=queue.top();
+
+      queue.pop();
+
+      if (graph.witness[entry.second].settled) {
+        continue;
+      }
+
+      graph.witness[entry.second].settled=true;
+      settledCount++;
+
+      if (entry.first>maxCost ||
+          settledCount>maxWitnessSettledNodes) {
+        break;
+      }
+
+      for (const auto& edge : graph.outEdges[entry.second]) {
+        if (edge.node==ignore ||
+            graph.contracted[edge.node]) {
+          continue;
+        }
+
+        double cost=entry.first+edge.cost;
+
+        if (cost<graph.witness[edge.node].cost) {
+          if (graph.witness[edge.node].cost==infiniteCost) {
+            graph.witnessTouched.push_back(edge.node);
+          }
+
+          graph.witness[edge.node].cost=cost;
+          queue.push(QueueEntry(cost,edge.node));
+        }
+      }
+    }
+  }
+
+  /**
+   * Calculate the shortcuts required if the given node is contracted
+   */
+  void RouteCHDataGenerator::FindShortcuts(Graph& graph,
+                                           uint32_t node,
+                                           std::vector<Shortcut>& shortcuts)
+  {
+    shortcuts.clear();
+
+    for (const auto& inEdge : graph.inEdges[node]) {
+      if (graph.contracted[inEdge.node]) {
+        continue;
+      }
+
+      double maxCost=-1.0;
+
+      for (const auto& outEdge : graph.outEdges[node]) {
+        if (outEdge.node!=inEdge.node &&
+            !graph.contracted[outEdge.node]) {
+          maxCost=std::max(maxCost,inEdge.cost+outEdge.cost);
+        }
+      }
+
+      if (maxCost<0.0) {
+        continue;
+      }
+
+      WitnessSearch(graph,
+                    inEdge.node,
+                    node,
+                    maxCost);
+
+      for (const auto& outEdge : graph.outEdges[node]) {
+        if (outEdge.node==inEdge.node ||
+            graph.contracted[outEdge.node]) {
+          continue;
+        }
+
+        double cost=inEdge.cost+outEdge.cost;
+
+        if (graph.witness[outEdge.node].cost>cost) {
+          shortcuts.push_back(Shortcut{inEdge.node,outEdge.node,cost});
+        }
+      }
+    }
+  }
+
+  /**
+   * Priority of a node for contraction (lower is contracted first): the
+   * edge difference plus the number of already contracted neighbours, which
+   * spreads the contraction evenly over the graph.
+   */
+  int RouteCHDataGenerator::CalculatePriority(Graph& graph,
+                                              uint32_t node,
+                                              uint32_t deletedNeighbours,
+                                              std::vector<Shortcut>& shortcuts)
+  {
+    int removedEdges=0;
+
+    FindShortcuts(graph,
+                  node,
+                  shortcuts);
+
+    for (const auto& edge : graph.outEdges[node]) {
+      if (!graph.contracted[edge.node]) {
+        removedEdges++;
+      }
+    }
+
+    for (const auto& edge : graph.inEdges[node]) {
+      if (!graph.contracted[edge.node]) {
+        removedEdges++;
+      }
+    }
+
+    return (int)shortcuts.size()-removedEdges+(int)deletedNeighbours;
+  }
+
+  void RouteCHDataGenerator::Contract(Graph& graph,
+                                      Progress& progress)
+  {
+    typedef std::pair<int,uint32_t> QueueEntry;
+
+    std::priority_queue<QueueEntry,std::vector<QueueEntry>,std::greater<QueueEntry>> queue;
+    uint32_t                                                                         nodeCount=(uint32_t)graph.nodeOffsets.size();
+    std::vector<int>                                                                 priority(nodeCount);
+    std::vector<uint32_t>                                                            deletedNeighbours(nodeCount,0);
+    std::vector<Shortcut>                                                            shortcuts;
+    std::vector<uint32_t>                                                            neighbours;
+    uint32_t                                                                         currentRank=0;
+    size_t                                                                           shortcutCount=0;
+
+    graph.contracted.assign(nodeCount,false);
+    graph.rank.assign(nodeCount,0);
+    graph.witness.assign(nodeCount,WitnessNode{infiniteCost,false});
+    graph.witnessTouched.clear();
+
+    for (uint32_t n=0; n<nodeCount; n++) {
+      priority[n]=CalculatePriority(graph,
+                                    n,
+                                    0,
+                                    shortcuts);
+      queue.push(QueueEntry(priority[n],n));
+    }
+
+    while (!queue.empty()) {
+      QueueEntry entry=queue.top();
+      uint32_t   node=entry.second;
+
+      queue.pop();
+
+      if (graph.contracted[node] ||
+          entry.first!=priority[node]) {
+        continue;
+      }
+
+      // Lazy update, the priority might have increased by contraction of other nodes
+
+      int currentPriority=CalculatePriority(graph,
+                                            node,
+                                            deletedNeighbours[node],
+                                            shortcuts);
+
+      if (currentPriority>entry.first &&
+          !queue.empty() &&
+          currentPriority>queue.top().first) {
+        priority[node]=currentPriority;
+        queue.push(QueueEntry(currentPriority,node));
+        continue;
+      }
+
+      for (const auto& shortcut : shortcuts) {
+        AddEdge(graph,
+                shortcut.from,
+                shortcut.to,
+                node,
+                shortcut.cost,
+                ObjectFileRef());
+      }
+
+      shortcutCount+=shortcuts.size();
+
+      graph.contracted[node]=true;
+      graph.rank[node]=currentRank++;
+
+      progress.SetProgress(currentRank,nodeCount);
+
+      neighbours.clear();
+
+      for (const auto& edge : graph.outEdges[node]) {
+        if (!graph.contracted[edge.node]) {
+          neighbours.push_back(edge.node);
+        }
+      }
+
+      for (const auto& edge : graph.inEdges[node]) {
+        if (!graph.contracted[edge.node]) {
+          neighbours.push_back(edge.node);
+        }
+      }
+
+      std::sort(neighbours.begin(),neighbours.end());
+      neighbours.erase(std::unique(neighbours.begin(),neighbours.end()),neighbours.end());
+
+      for (uint32_t neighbour : neighbours) {
+        deletedNeighbours[neighbour]++;
+
+        priority[neighbour]=CalculatePriority(graph,
+                                              neighbour,
+                                              deletedNeighbours[neighbour],
+                                              shortcuts);
+        queue.push(QueueEntry(priority[neighbour],neighbour));
+      }
+    }
+
+    progress.Info(NumberToString(shortcutCount)+" shortcut(s) added");
+  }
+
+  /**
+   * Write the upward graphs of the contracted graph
+   *
+   * @throws IOException
+   */
+  void RouteCHDataGenerator::WriteHierarchy(const Graph& graph,
+                                            const std::string& filename)
+  {
+    ContractionHierarchy hierarchy;
+    FileWriter           writer;
+
+    for (uint32_t n=0; n<graph.nodeOffsets.size(); n++) {
+      hierarchy.AddNode(graph.nodeOffsets[n],
+                        graph.nodeFlags[n]);
+
+      for (const auto& edge : graph.outEdges[n]) {
+        if (graph.rank[edge.node]>graph.rank[n]) {
+          hierarchy.AddForwardEdge(ContractionHierarchy::Edge{edge.node,
+                                                              edge.middle,
+                                                              edge.cost,
+                                                              edge.object});
+        }
+      }
+
+      for (const auto& edge : graph.inEdges[n]) {
+        if (graph.rank[edge.node]>graph.rank[n]) {
+          hierarchy.AddBackwardEdge(ContractionHierarchy::Edge{edge.node,
+                                                               edge.middle,
+                                                               edge.cost,
+                                                               edge.object});
+        }
+      }
+
+      hierarchy.FinishNode();
+    }
+
+    try {
+      writer.Open(filename);
+
+      hierarchy.Write(writer);
+
+      writer.Close();
+    }
+    catch (IOException& e) {
+      writer.CloseFailsafe();
+      throw;
+    }
+  }
+
+  bool RouteCHDataGenerator::GenerateHierarchy(const TypeConfigRef& typeConfig,
+                                               const ImportParameter& parameter,
+                                               Progress& progress,
+                                               const ImportParameter::Router& router,
+                                               Vehicle vehicle)
+  {
+    FastestPathRoutingProfile profile(typeConfig);
+    Graph                     graph;
+    std::string               filename=ContractionHierarchy::GetFilename(router.GetFilenamebase(),
+                                                                         vehicle);
+
+    switch (vehicle) {
+    case vehicleFoot:
+      profile.ParametrizeForFoot(*typeConfig,
+                                 parameter.GetFootSpeed());
+      break;
+    case vehicleBicycle:
+      profile.ParametrizeForBicycle(*typeConfig,
+                                    parameter.GetBicycleSpeed());
+      break;
+    case vehicleCar:
+      if (!profile.ParametrizeForCar(*typeConfig,
+                                     parameter.GetCarSpeedTable(),
+                                     parameter.GetCarMaxSpeed())) {
+        progress.Warning("Car speed table does not define a speed for all car routable types");
+      }
+      break;
+    }
+
+    progress.SetAction("Loading routing graph for '"+filename+"'");
+
+    if (!LoadGraph(typeConfig,
+                   parameter,
+                   progress,
+                   router,
+                   profile,
+                   graph)) {
+      return false;
+    }
+
+    progress.Info(NumberToString(graph.nodeOffsets.size())+" route node(s) loaded");
+
+    progress.SetAction("Contracting routing graph for '"+filename+"'");
+
+    StopClock contractionTimer;
+
+    Contract(graph,
+             progress);
+
+    contractionTimer.Stop();
+
+    progress.Info("Contraction took "+contractionTimer.ResultString()+" s");
+
+    progress.SetAction("Writing '"+filename+"'");
+
+    try {
+      WriteHierarchy(graph,
+                     AppendFileToDir(parameter.GetDestinationDirectory(),
+                                     filename));
+    }
+    catch (IOException& e) {
+      progress.Error(e.GetDescription());
+      return false;
+    }
+
+    return true;
+  }
+
+  bool RouteCHDataGenerator::Import(const TypeConfigRef& typeConfig,
+                                    const ImportParameter& parameter,
+                                    Progress& progress)
+  {
+    if (!parameter.GetContractionHierarchies()) {
+      progress.Info("Generation of contraction hierarchies is disabled");
+      return true;
+    }
+
+    for (const auto& router : parameter.GetRouter()) {
+      for (Vehicle vehicle : {vehicleFoot, vehicleBicycle, vehicleCar}) {
+        if ((router.GetVehicleMask() & vehicle)==0) {
+          continue;
+        }
+
+        if (!GenerateHierarchy(typeConfig,
+                               parameter,
+                               progress,
+                               router,
+                               vehicle)) {
+          return false;
+        }
+      }
+    }
+
+    return true;
+  }
+}
@@ -1452,12 +1452,12 @@ namespace osmscout {
           exclude.source=source;
           exclude.targetIndex=0;
 
-          while (exclude.targetIndex<routeNode.paths.size() &&
-              routeNode.objects[routeNode.paths[exclude.targetIndex].objectIndex].object!=dest) {
+          while (exclude.targetIndex<routeNode.objects.size() &&
+              routeNode.objects[exclude.targetIndex].object!=dest) {
             exclude.targetIndex++;
           }
 
-          if (exclude.targetIndex<routeNode.paths.size()) {
+          if (exclude.targetIndex<routeNode.objects.size()) {
             routeNode.excludes.push_back(exclude);
           }
         }
@@ -0,0 +1,362 @@
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2017  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/import/GenRouteLandmarksDat.h>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+
+#include <osmscout/routing/RouteGraph.h>
+#include <osmscout/routing/RouteNode.h>
+
+#include <osmscout/util/File.h>
+#include <osmscout/util/FileWriter.h>
+#include <osmscout/util/StopClock.h>
+#include <osmscout/util/String.h>
+
+namespace osmscout {
+
+  static const double infiniteDistance=std::numeric_limits<double>::infinity();
+
+  RouteLandmarkDataGenerator::RouteLandmarkDataGenerator()
+  {
+    // no code
+  }
+
+  void RouteLandmarkDataGenerator::GetDescription(const ImportParameter& parameter,
+                                                  ImportModuleDescription& description) const
+  {
+    description.SetName("RouteLandmarkDataGenerator");
+    description.SetDescription("Generate routing landmarks of the routing graph(s)");
+
+    for (const auto& router : parameter.GetRouter()) {
+      description.AddRequiredFile(router.GetDataFilename());
+
+      if (parameter.GetLandmarkCount()==0) {
+        continue;
+      }
+
+      for (Vehicle vehicle : {vehicleFoot, vehicleBicycle, vehicleCar}) {
+        if ((router.GetVehicleMask() & vehicle)!=0) {
+          description.AddProvidedFile(Landmarks::GetFilename(router.GetFilenamebase(),
+                                                             vehicle));
+        }
+      }
+    }
+  }
+
+  bool RouteLandmarkDataGenerator::LoadGraph(const TypeConfigRef& typeConfig,
+                                             const ImportParameter& parameter,
+                                             Progress& progress,
+                                             const ImportParameter::Router& router,
+                                             Vehicle vehicle,
+                                             Graph& graph)
+  {
+    RouteGraph routeGraph;
+    uint8_t    usableFlag=RouteNode::usableByCar;
+
+    switch (vehicle) {
+    case vehicleFoot:
+      usableFlag=RouteNode::usableByFoot;
+      break;
+    case vehicleBicycle:
+      usableFlag=RouteNode::usableByBicycle;
+      break;
+    case vehicleCar:
+      usableFlag=RouteNode::usableByCar;
+      break;
+    }
+
+    if (!routeGraph.Load(*typeConfig,
+                         AppendFileToDir(parameter.GetDestinationDirectory(),
+                                         router.GetDataFilename()))) {
+      progress.Error("Cannot load '"+router.GetDataFilename()+"'");
+      return false;
+    }
+
+    uint32_t nodeCount=(uint32_t)routeGraph.GetNodeCount();
+
+    graph.nodeOffsets.resize(nodeCount);
+    graph.edgeStart.assign(nodeCount+1,0);
+
+    // Count the edges of each node, every path is an edge of both of its nodes
+    for (uint32_t n=0; n<nodeCount; n++) {
+      graph.nodeOffsets[n]=routeGraph.GetNodeOffset(n);
+
+      for (uint32_t path=routeGraph.GetFirstPath(n); path<routeGraph.GetLastPath(n); path++) {
+        if ((routeGraph.GetPathFlags(path) & usableFlag)==0) {
+          continue;
+        }
+
+        graph.edgeStart[n+1]++;
+        graph.edgeStart[routeGraph.GetPathTarget(path)+1]++;
+      }
+    }
+
+    for (uint32_t n=0; n<nodeCount; n++) {
+      graph.edgeStart[n+1]+=graph.edgeStart[n];
+    }
+
+    std::vector<uint32_t> edgeEnd(graph.edgeStart.begin(),
+                                  graph.edgeStart.end()-1);
+
+    graph.edgeTargets.resize(graph.edgeStart[nodeCount]);
+    graph.edgeDistances.resize(graph.edgeStart[nodeCount]);
+
+    for (uint32_t n=0; n<nodeCount; n++) {
+      progress.SetProgress(n,nodeCount);
+
+      for (uint32_t path=routeGraph.GetFirstPath(n); path<routeGraph.GetLastPath(n); path++) {
+        if ((routeGraph.GetPathFlags(path) & usableFlag)==0) {
+          continue;
+        }
+
+        uint32_t target=routeGraph.GetPathTarget(path);
+        double   distance=routeGraph.GetPathDistance(path);
+
+        graph.edgeTargets[edgeEnd[n]]=target;
+        graph.edgeDistances[edgeEnd[n]]=distance;
+        edgeEnd[n]++;
+
+        graph.edgeTargets[edgeEnd[target]]=n;
+        graph.edgeDistances[edgeEnd[target]]=distance;
+        edgeEnd[target]++;
+      }
+    }
+
+    return true;
+  }
+
+  /**
+   * Return a node of the largest connected part of the graph
+   */
+  uint32_t RouteLandmarkDataGenerator::GetLargestComponentNode(const Graph& graph)
+  {
+    uint32_t              nodeCount=(uint32_t)graph.nodeOffsets.size();
+    std::vector<bool>     visited(nodeCount,false);
+    std::vector<uint32_t> stack;
+    uint32_t              largestNode=0;
+    size_t                largestSize=0;
+
+    for (uint32_t n=0; n<nodeCount; n++) {
+      if (visited[n]) {
+        continue;
+      }
+
+      size_t size=0;
+
+      visited[n]=true;
+      stack.push_back(n);
+
+      while (!stack.empty()) {
+        uint32_t current=stack.back();
+
+        stack.pop_back();
+        size++;
+
+        for (uint32_t e=graph.edgeStart[current]; e<graph.edgeStart[current+1]; e++) {
+          uint32_t next=graph.edgeTargets[e];
+
+          if (!visited[next]) {
+            visited[next]=true;
+            stack.push_back(next);
+          }
+        }
+      }
+
+      if (size>largestSize) {
+        largestSize=size;
+        largestNode=n;
+      }
+    }
+
+    return largestNode;
+  }
+
+  /**
+   * Calculate the distance of all nodes to the given source node (Dijkstra).
+   * Nodes not connected to the source get an infinite distance.
+   */
+  void RouteLandmarkDataGenerator::CalculateDistances(const Graph& graph,
+                                                      uint32_t source,
+                                                      std::vector<double>& distances)
+  {
+    typedef std::pair<double,uint32_t> QueueEntry;
+
+    std::priority_queue<QueueEntry,std::vector<QueueEntry>,std::greater<QueueEntry>> queue;
+
+    distances.assign(graph.nodeOffsets.size(),infiniteDistance);
+
+    distances[source]=0.0;
+    queue.push(QueueEntry(0.0,source));
+
+    while (!queue.empty()) {
+      QueueEntry entry=queue.top();
+
+      queue.pop();
+
+      // Outdated entry
+      if (entry.first>distances[entry.second]) {
+        continue;
+      }
+
+      for (uint32_t e=graph.edgeStart[entry.second]; e<graph.edgeStart[entry.second+1]; e++) {
+        uint32_t next=graph.edgeTargets[e];
+        double   distance=entry.first+graph.edgeDistances[e];
+
+        if (distance<distances[next]) {
+          distances[next]=distance;
+          queue.push(QueueEntry(distance,next));
+        }
+      }
+    }
+  }
+
+  bool RouteLandmarkDataGenerator::GenerateLandmarks(const TypeConfigRef& typeConfig,
+                                                     const ImportParameter& parameter,
+                                                     Progress& progress,
+                                                     const ImportParameter::Router& router,
+                                                     Vehicle vehicle)
+  {
+    Graph       graph;
+    std::string filename=Landmarks::GetFilename(router.GetFilenamebase(),
+                                                vehicle);
+
+    progress.SetAction("Loading routing graph for '"+filename+"'");
+
+    if (!LoadGraph(typeConfig,
+                   parameter,
+                   progress,
+                   router,
+                   vehicle,
+                   graph)) {
+      return false;
+    }
+
+    progress.Info(NumberToString(graph.nodeOffsets.size())+" route node(s) loaded");
+
+    if (graph.nodeOffsets.empty()) {
+      progress.Info("Empty routing graph, skipping landmarks");
+      return true;
+    }
+
+    progress.SetAction("Selecting landmarks for '"+filename+"'");
+
+    StopClock           selectionTimer;
+    size_t              landmarkCount=std::min(parameter.GetLandmarkCount(),
+                                               graph.nodeOffsets.size());
+    Landmarks           landmarks;
+    std::vector<double> distances;
+    std::vector<double> minDistances(graph.nodeOffsets.size(),infiniteDistance);
+
+    landmarks.Initialize(graph.nodeOffsets,
+                         landmarkCount);
+
+    // The first landmark is the node farthest away from some node of the largest
+    // connected part, every following landmark the node farthest away from all
+    // landmarks selected so far
+    CalculateDistances(graph,
+                       GetLargestComponentNode(graph),
+                       minDistances);
+
+    for (size_t l=0; l<landmarkCount; l++) {
+      uint32_t landmark=0;
+      double   maxDistance=-1.0;
+
+      progress.SetProgress(l,landmarkCount);
+
+      for (uint32_t n=0; n<minDistances.size(); n++) {
+        if (minDistances[n]!=infiniteDistance &&
+            minDistances[n]>maxDistance) {
+          maxDistance=minDistances[n];
+          landmark=n;
+        }
+      }
+
+      CalculateDistances(graph,
+                         landmark,
+                         distances);
+
+      landmarks.SetLandmark(l,
+                            landmark,
+                            distances);
+
+      for (uint32_t n=0; n<minDistances.size(); n++) {
+        if (l==0 ||
+            distances[n]<minDistances[n]) {
+          minDistances[n]=distances[n];
+        }
+      }
+    }
+
+    selectionTimer.Stop();
+
+    progress.Info("Landmark selection took "+selectionTimer.ResultString()+" s");
+
+    progress.SetAction("Writing '"+filename+"'");
+
+    FileWriter writer;
+
+    try {
+      writer.Open(AppendFileToDir(parameter.GetDestinationDirectory(),
+                                  filename));
+
+      landmarks.Write(writer);
+
+      writer.Close();
+    }
+    catch (IOException& e) {
+      progress.Error(e.GetDescription());
+      writer.CloseFailsafe();
+      return false;
+    }
+
+    return true;
+  }
+
+  bool RouteLandmarkDataGenerator::Import(const TypeConfigRef& typeConfig,
+                                          const ImportParameter& parameter,
+                                          Progress& progress)
+  {
+    if (parameter.GetLandmarkCount()==0) {
+      progress.Info("Generation of routing landmarks is disabled");
+      return true;
+    }
+
+    for (const auto& router : parameter.GetRouter()) {
+      for (Vehicle vehicle : {vehicleFoot, vehicleBicycle, vehicleCar}) {
+        if ((router.GetVehicleMask() & vehicle)==0) {
+          continue;
+        }
+
+        if (!GenerateLandmarks(typeConfig,
+                               parameter,
+                               progress,
+                               router,
+                               vehicle)) {
+          return false;
+        }
+      }
+    }
+
+    return true;
+  }
+}
@@ -0,0 +1,212 @@
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2017  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/import/GenRouteSegmentIdx.h>
+
+#include <osmscout/Way.h>
+#include <osmscout/WayDataFile.h>
+
+#include <osmscout/routing/RouteNode.h>
+
+#include <osmscout/util/File.h>
+#include <osmscout/util/FileScanner.h>
+#include <osmscout/util/FileWriter.h>
+#include <osmscout/util/String.h>
+
+namespace osmscout {
+
+  // About 1.1 km in north-south direction
+  const uint32_t RouteSegmentIndexGenerator::CELLS_PER_DEGREE=100;
+
+  RouteSegmentIndexGenerator::RouteSegmentIndexGenerator()
+  {
+    // no code
+  }
+
+  void RouteSegmentIndexGenerator::GetDescription(const ImportParameter& parameter,
+                                                  ImportModuleDescription& description) const
+  {
+    description.SetName("RouteSegmentIndexGenerator");
+    description.SetDescription("Generate index of the segments of routable ways");
+
+    description.AddRequiredFile(WayDataFile::WAYS_DAT);
+
+    if (!parameter.GetRouteSegmentIndex()) {
+      return;
+    }
+
+    for (const auto& router : parameter.GetRouter()) {
+      description.AddProvidedFile(RouteSegmentIndex::GetFilename(router.GetFilenamebase()));
+    }
+  }
+
+  /**
+   * Return the RouteNode usable flags of the vehicles of the given mask that can
+   * route on the way
+   */
+  uint8_t RouteSegmentIndexGenerator::GetFlags(const AccessFeatureValueReader& accessReader,
+                                               const Way& way,
+                                               VehicleMask vehicleMask) const
+  {
+    TypeInfoRef        type=way.GetType();
+    AccessFeatureValue *accessValue=accessReader.GetValue(way.GetFeatureValueBuffer());
+    uint8_t            flags=0;
+
+    if ((vehicleMask & vehicleFoot)!=0 &&
+        type->CanRouteFoot() &&
+        (accessValue!=NULL ? accessValue->CanRouteFoot() : true)) {
+      flags|=RouteNode::usableByFoot;
+    }
+
+    if ((vehicleMask & vehicleBicycle)!=0 &&
+        type->CanRouteBicycle() &&
+        (accessValue!=NULL ? accessValue->CanRouteBicycle() : true)) {
+      flags|=RouteNode::usableByBicycle;
+    }
+
+    if ((vehicleMask & vehicleCar)!=0 &&
+        type->CanRouteCar() &&
+        (accessValue!=NULL ? accessValue->CanRouteCar() : true)) {
+      flags|=RouteNode::usableByCar;
+    }
+
+    return flags;
+  }
+
+  bool RouteSegmentIndexGenerator::GenerateIndex(const TypeConfigRef& typeConfig,
+                                                 const ImportParameter& parameter,
+                                                 Progress& progress,
+                                                 const ImportParameter::Router& router)
+  {
+    std::string              filename=RouteSegmentIndex::GetFilename(router.GetFilenamebase());
+    AccessFeatureValueReader accessReader(*typeConfig);
+    RouteSegmentIndex        index;
+    FileScanner              scanner;
+    uint32_t                 dataCount;
+
+    progress.SetAction("Scanning ways for '"+filename+"'");
+
+    index.SetCellsPerDegree(CELLS_PER_DEGREE);
+
+    try {
+      scanner.Open(AppendFileToDir(parameter.GetDestinationDirectory(),
+                                   WayDataFile::WAYS_DAT),
+                   FileScanner::Sequential,
+                   parameter.GetWayDataMemoryMaped());
+
+      scanner.Read(dataCount);
+
+      for (uint32_t d=1; d<=dataCount; d++) {
+        progress.SetProgress(d,dataCount);
+
+        Way way;
+
+        way.Read(*typeConfig,
+                 scanner);
+
+        if (way.GetType()->GetIgnore() ||
+            way.nodes.size()<2) {
+          continue;
+        }
+
+        uint8_t flags=GetFlags(accessReader,
+                               way,
+                               router.GetVehicleMask());
+
+        if (flags==0) {
+          continue;
+        }
+
+        bool hasRouteNode=false;
+
+        for (const auto& node : way.nodes) {
+          if (node.IsRelevant()) {
+            hasRouteNode=true;
+            break;
+          }
+        }
+
+        if (!hasRouteNode) {
+          continue;
+        }
+
+        index.AddWay(way.GetFileOffset(),
+                     way.GetType()->GetWayId(),
+                     flags,
+                     way.nodes);
+      }
+
+      scanner.Close();
+    }
+    catch (IOException& e) {
+      progress.Error(e.GetDescription());
+      scanner.CloseFailsafe();
+      return false;
+    }
+
+    progress.SetAction("Building grid for '"+filename+"'");
+
+    index.BuildCells();
+
+    progress.Info(NumberToString(index.GetWayCount())+" way(s), "+
+                  NumberToString(index.GetSegmentCount())+" cell segment(s)");
+
+    progress.SetAction("Writing '"+filename+"'");
+
+    FileWriter writer;
+
+    try {
+      writer.Open(AppendFileToDir(parameter.GetDestinationDirectory(),
+                                  filename));
+
+      index.Write(*typeConfig,
+                  writer);
+
+      writer.Close();
+    }
+    catch (IOException& e) {
+      progress.Error(e.GetDescription());
+      writer.CloseFailsafe();
+      return false;
+    }
+
+    return true;
+  }
+
+  bool RouteSegmentIndexGenerator::Import(const TypeConfigRef& typeConfig,
+                                          const ImportParameter& parameter,
+                                          Progress& progress)
+  {
+    if (!parameter.GetRouteSegmentIndex()) {
+      progress.Info("Generation of the route segment index is disabled");
+      return true;
+    }
+
+    for (const auto& router : parameter.GetRouter()) {
+      if (!GenerateIndex(typeConfig,
+                         parameter,
+                         progress,
+                         router)) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+}
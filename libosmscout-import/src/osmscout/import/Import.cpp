@@ -69,12 +69,18 @@
 
 // Routing
 #include <osmscout/import/GenRouteDat.h>
+#include <osmscout/import/GenRouteCHDat.h>
+#include <osmscout/import/GenRouteLandmarksDat.h>
+#include <osmscout/import/GenRouteSegmentIdx.h>
 #include <osmscout/import/GenIntersectionIndex.h>
 
 #if defined(OSMSCOUT_IMPORT_HAVE_LIB_MARISA)
 #include <osmscout/import/GenTextIndex.h>
 #endif
 
+#include <osmscout/import/GenCompressedDat.h>
+
+#include <osmscout/util/BlockCompressedFile.h>
 #include <osmscout/util/MemoryMonitor.h>
 #include <osmscout/util/Progress.h>
 #include <osmscout/util/StopClock.h>
@@ -82,11 +88,19 @@
 namespace osmscout {
 
   static const size_t defaultStartStep=1;
-#if defined(OSMSCOUT_IMPORT_HAVE_LIB_MARISA)
-  static const size_t defaultEndStep=24;
-#else
-  static const size_t defaultEndStep=23;
-#endif
+
+  /**
+   * The default end step is the last import module, so that by default
+   * all modules are executed
+   */
+  static size_t GetDefaultEndStep()
+  {
+    std::vector<ImportModuleRef> modules;
+
+    Importer::GetModuleList(modules);
+
+    return modules.size();
+  }
 
   ImportParameter::Router::Router(uint8_t vehicleMask,
                                   const std::string& filenamebase)
@@ -99,7 +113,7 @@ namespace osmscout {
   ImportParameter::ImportParameter()
    : typefile("map.ost"),
      startStep(defaultStartStep),
-     endStep(defaultEndStep),
+     endStep(GetDefaultEndStep()),
      eco(false),
      strictAreas(false),
      sortObjects(true),
@@ -107,6 +121,9 @@ namespace osmscout {
      sortTileMag(14),
      processingQueueSize(std::max((unsigned int)1,std::thread::hardware_concurrency())),
      numericIndexPageSize(1024),
+     columnarCoords(false),
+     compressDataFiles(false),
+     compressionBlockSize(BlockCompressedFileReader::DEFAULT_BLOCK_SIZE),
      rawCoordBlockSize(60000000),
      rawNodeDataMemoryMaped(false),
      rawWayIndexMemoryMaped(true),
@@ -136,6 +153,31 @@ namespace osmscout {
      optimizationCellSizeMax(255),
      optimizationWayMethod(TransPolygon::quality),
      routeNodeBlockSize(500000),
+     contractionHierarchies(false),
+     landmarkCount(0),
+     routeSegmentIndex(false),
+     carSpeedTable({{"highway_motorway",         110.0},
+                    {"highway_motorway_trunk",   100.0},
+                    {"highway_motorway_primary",  70.0},
+                    {"highway_motorway_link",     60.0},
+                    {"highway_motorway_junction", 60.0},
+                    {"highway_trunk",            100.0},
+                    {"highway_trunk_link",        60.0},
+                    {"highway_primary",           70.0},
+                    {"highway_primary_link",      60.0},
+                    {"highway_secondary",         60.0},
+                    {"highway_secondary_link",    50.0},
+                    {"highway_tertiary_link",     55.0},
+                    {"highway_tertiary",          55.0},
+                    {"highway_unclassified",      50.0},
+                    {"highway_road",              50.0},
+                    {"highway_residential",       40.0},
+                    {"highway_roundabout",        40.0},
+                    {"highway_living_street",     10.0},
+                    {"highway_service",           30.0}}),
+     footSpeed(5.0),
+     bicycleSpeed(20.0),
+     carMaxSpeed(160.0),
      assumeLand(AssumeLandStrategy::automatic),
      langOrder({"#"}),
      maxAdminLevel(10),
@@ -225,6 +267,21 @@ namespace osmscout {
     return numericIndexPageSize;
   }
 
+  bool ImportParameter::GetColumnarCoords() const
+  {
+    return columnarCoords;
+  }
+
+  bool ImportParameter::GetCompressDataFiles() const
+  {
+    return compressDataFiles;
+  }
+
+  size_t ImportParameter::GetCompressionBlockSize() const
+  {
+    return compressionBlockSize;
+  }
+
   size_t ImportParameter::GetRawCoordBlockSize() const
   {
     return rawCoordBlockSize;
@@ -370,6 +427,41 @@ namespace osmscout {
     return routeNodeBlockSize;
   }
 
+  bool ImportParameter::GetContractionHierarchies() const
+  {
+    return contractionHierarchies;
+  }
+
+  size_t ImportParameter::GetLandmarkCount() const
+  {
+    return landmarkCount;
+  }
+
+  bool ImportParameter::GetRouteSegmentIndex() const
+  {
+    return routeSegmentIndex;
+  }
+
+  const std::map<std::string,double>& ImportParameter::GetCarSpeedTable() const
+  {
+    return carSpeedTable;
+  }
+
+  double ImportParameter::GetFootSpeed() const
+  {
+    return footSpeed;
+  }
+
+  double ImportParameter::GetBicycleSpeed() const
+  {
+    return bicycleSpeed;
+  }
+
+  double ImportParameter::GetCarMaxSpeed() const
+  {
+    return carMaxSpeed;
+  }
+
   ImportParameter::AssumeLandStrategy ImportParameter::GetAssumeLand() const
   {
     return assumeLand;
@@ -423,7 +515,7 @@ namespace osmscout {
   void ImportParameter::SetStartStep(size_t startStep)
   {
     this->startStep=startStep;
-    this->endStep=defaultEndStep;
+    this->endStep=GetDefaultEndStep();
   }
 
   void ImportParameter::SetSteps(size_t startStep, size_t endStep)
@@ -477,6 +569,31 @@ namespace osmscout {
     this->numericIndexPageSize=numericIndexPageSize;
   }
 
+  void ImportParameter::SetColumnarCoords(bool columnarCoords)
+  {
+    this->columnarCoords=columnarCoords;
+  }
+
+  void ImportParameter::SetCompressDataFiles(bool compressDataFiles)
+  {
+    this->compressDataFiles=compressDataFiles;
+  }
+
+  /**
+   * Set the uncompressed size of a block of compressed data files. Returns false and keeps
+   * the current block size, if the given block size is 0 or does not fit into 32 bit.
+   */
+  bool ImportParameter::SetCompressionBlockSize(size_t compressionBlockSize)
+  {
+    if (!BlockCompressedFileReader::IsValidBlockSize(compressionBlockSize)) {
+      return false;
+    }
+
+    this->compressionBlockSize=compressionBlockSize;
+
+    return true;
+  }
+
   void ImportParameter::SetRawCoordBlockSize(size_t blockSize)
   {
     this->rawCoordBlockSize=blockSize;
@@ -624,6 +741,50 @@ namespace osmscout {
     this->routeNodeBlockSize=blockSize;
   }
 
+  void ImportParameter::SetContractionHierarchies(bool contractionHierarchies)
+  {
+    this->contractionHierarchies=contractionHierarchies;
+  }
+
+  /**
+   * Number of landmarks to select for the ALT estimate of the routing (see
+   * RouteLandmarkDataGenerator). 0 disables the generation of landmarks.
+   */
+  void ImportParameter::SetLandmarkCount(size_t landmarkCount)
+  {
+    this->landmarkCount=landmarkCount;
+  }
+
+  /**
+   * Generate a grid index of the segments of all routable ways of each router (see
+   * RouteSegmentIndexGenerator), used for finding the closest routable node
+   * without loading ways.
+   */
+  void ImportParameter::SetRouteSegmentIndex(bool routeSegmentIndex)
+  {
+    this->routeSegmentIndex=routeSegmentIndex;
+  }
+
+  void ImportParameter::SetCarSpeedTable(const std::map<std::string,double>& carSpeedTable)
+  {
+    this->carSpeedTable=carSpeedTable;
+  }
+
+  void ImportParameter::SetFootSpeed(double footSpeed)
+  {
+    this->footSpeed=footSpeed;
+  }
+
+  void ImportParameter::SetBicycleSpeed(double bicycleSpeed)
+  {
+    this->bicycleSpeed=bicycleSpeed;
+  }
+
+  void ImportParameter::SetCarMaxSpeed(double carMaxSpeed)
+  {
+    this->carMaxSpeed=carMaxSpeed;
+  }
+
   void ImportParameter::SetAssumeLand(AssumeLandStrategy assumeLand)
   {
     this->assumeLand=assumeLand;
@@ -766,13 +927,17 @@ namespace osmscout {
 
     if (parameter.IsEco() &&
         (parameter.GetStartStep()!=defaultStartStep ||
-         parameter.GetEndStep()!=defaultEndStep)) {
+         parameter.GetEndStep()<modules.size())) {
       progress.Error("If eco mode is activated you must run all import steps");
     }
 
     return true;
   }
 
+  /**
+   * Return all import modules in the order of their execution. Import step n
+   * is executed by the module with index n-1.
+   */
   void Importer::GetModuleList(std::vector<ImportModuleRef>& modules)
   {
     /* 1 */
@@ -845,7 +1010,33 @@ namespace osmscout {
 #if defined(OSMSCOUT_IMPORT_HAVE_LIB_MARISA)
     /* 24 */
     modules.push_back(std::make_shared<TextIndexGenerator>());
+
+    /* 25 */
+#else
+    /* 24 */
+#endif
+    modules.push_back(std::make_shared<RouteCHDataGenerator>());
+
+#if defined(OSMSCOUT_IMPORT_HAVE_LIB_MARISA)
+    /* 26 */
+#else
+    /* 25 */
+#endif
+    modules.push_back(std::make_shared<RouteLandmarkDataGenerator>());
+
+#if defined(OSMSCOUT_IMPORT_HAVE_LIB_MARISA)
+    /* 27 */
+#else
+    /* 26 */
+#endif
+    modules.push_back(std::make_shared<RouteSegmentIndexGenerator>());
+
+#if defined(OSMSCOUT_IMPORT_HAVE_LIB_MARISA)
+    /* 28 */
+#else
+    /* 27 */
 #endif
+    modules.push_back(std::make_shared<CompressedDataGenerator>());
   }
 
   void Importer::DumpTypeConfigData(const TypeConfig& typeConfig,
@@ -422,8 +422,10 @@ namespace osmscout {
 
     ctxt=xmlCreatePushParserCtxt(&saxParser,&parser,chars,res,NULL);
 
-    // Resolve entities, do not do any network communication
-    xmlCtxtUseOptions(ctxt,XML_PARSE_NOENT|XML_PARSE_NONET);
+    // Resolve entities, do not do any network communication. We only register the SAX1
+    // startElement/endElement callbacks, which newer libxml2 versions ignore for
+    // XML_SAX2_MAGIC handlers unless the SAX1 interface is requested explicitly.
+    xmlCtxtUseOptions(ctxt,XML_PARSE_NOENT|XML_PARSE_NONET|XML_PARSE_SAX1);
 
     while ((res=fread(chars,1,sizeof(chars),file))>0) {
       if (xmlParseChunk(ctxt,chars,res,0)!=0) {
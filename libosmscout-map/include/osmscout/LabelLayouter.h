@@ -20,8 +20,9 @@
   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
 */
 
+#include <list>
 #include <memory>
-#include <set>
+#include <vector>
 
 #include <osmscout/private/MapImportExport.h>
 
@@ -53,53 +54,44 @@ namespace osmscout {
 
   typedef std::list<LabelData>::iterator LabelDataRef;
 
-  struct OSMSCOUT_MAP_API LabelEvent
-  {
-    double       y;
-    double       x;
-    LabelDataRef label;
-
-    inline bool operator<(const LabelEvent& other) const
-    {
-      if (y!=other.y) {
-        return y<other.y;
-      }
-
-      if (x!=other.x) {
-        return x<other.x;
-      }
-
-      if (label->id!=other.label->id){
-        return label->id<other.label->id;
-      }
-
-      if (label->y!=other.label->y){
-        return label->y<other.label->y;
-      }
-
-      return label->x<other.label->x;
-    }
-  };
-
+  /**
+   * Places labels without intersections, dropping labels of lower priority.
+   *
+   * Placed labels are registered in a uniform grid of cells covering the
+   * drawing area, so a placement only has to check the labels in the cells
+   * covered by the new label instead of all labels. Labels outside of the
+   * drawing area are registered in the border cells. Label storage is recycled
+   * between frames.
+   *
+   * Labels are handled by their axis aligned bounding box, labels that are
+   * not axis aligned (like rotated contour labels) must pass the axis aligned
+   * bounding box of their rotated outline.
+   */
   class OSMSCOUT_MAP_API LabelLayouter
   {
   private:
-
+    std::list<LabelData>                   labels;
+    std::list<LabelData>                   freeLabels;  //!< Storage of dropped labels for reuse
+    std::vector<std::vector<LabelDataRef>> cells;       //!< Labels intersecting the cell
+    size_t                                 cellsHoriz;  //!< Number of cells in horizontal direction
+    size_t                                 cellsVert;   //!< Number of cells in vertical direction
+    std::vector<LabelDataRef>              candidates;  //!< Temporary list of labels during placement
+    double                                 width;
+    double                                 height;
+    double                                 labelSpace;
+    double                                 shieldLabelSpace;
+    double                                 sameLabelSpace;
+    double                                 maxSpace;
+    bool                                   dropNotVisiblePointLabels;
+    size_t                                 labelsAdded;
 
   private:
-    std::list<LabelData> labels;
-    std::set<LabelEvent> events;
-    double               width;
-    double               height;
-    double               labelSpace;
-    double               shieldLabelSpace;
-    double               sameLabelSpace;
-    double               maxSpace;
-    bool                 dropNotVisiblePointLabels;
-    size_t               labelsAdded;
+    size_t GetCellX(double x) const;
+    size_t GetCellY(double y) const;
 
-  private:
-    void DeleteEventsForLabel(const std::set<LabelEvent>::iterator& eventRef);
+    void RegisterLabel(const LabelDataRef& label);
+    void DropLabel(const LabelDataRef& label);
+    void CollectCandidates(const LabelData& label);
     bool Intersects(const LabelData& first, const LabelData& second) const;
 
   public:
@@ -112,6 +104,8 @@ namespace osmscout {
     bool Placelabel(const LabelData& label,
                     LabelDataRef& labelRef);
 
+    size_t PlaceLabels(const std::vector<LabelData>& batch);
+
     inline std::list<LabelData>::const_iterator begin() const
     {
       return labels.begin();
@@ -20,8 +20,12 @@
   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
 */
 
+#include <functional>
 #include <list>
+#include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <osmscout/private/MapImportExport.h>
 
@@ -41,6 +45,7 @@
 #include <osmscout/util/Geometry.h>
 #include <osmscout/util/Projection.h>
 #include <osmscout/util/Transformation.h>
+#include <osmscout/util/WorkQueue.h>
 
 #include <osmscout/system/Compiler.h>
 
@@ -274,6 +279,27 @@ namespace osmscout {
       }
     };
 
+  private:
+    /**
+     * Result of the preparation of a consecutive range of areas or ways. Coordinates
+     * are stored in the given transformation buffer, which is either the buffer of the
+     * painter or of one of the preparation threads.
+     */
+    struct PrepareData
+    {
+      TransBuffer               *transBuffer;   //!< Buffer holding the transformed coordinates
+      size_t                    coordStart;     //!< First coordinate of this range in the buffer
+      size_t                    coordEnd;       //!< End (exclusive) of the coordinates of this range in the buffer
+      std::vector<LineStyleRef> lineStyles;     //!< Temporary storage for StyleConfig return value
+      std::list<AreaData>       areaData;
+      std::list<WayData>        wayData;
+      std::list<WayPathData>    wayPathData;
+      size_t                    areasSegments;
+      size_t                    waysSegments;
+
+      explicit PrepareData(TransBuffer* transBuffer);
+    };
+
   protected:
     CoordBuffer                  *coordBuffer;      //!< Reference to the coordinate buffer
 
@@ -296,7 +322,10 @@ namespace osmscout {
     //@}
 
     std::vector<TextStyleRef>    textStyles;     //!< Temporary storage for StyleConfig return value
-    std::vector<LineStyleRef>    lineStyles;     //!< Temporary storage for StyleConfig return value
+
+    std::vector<std::unique_ptr<TransBuffer>> prepareTransBuffers;  //!< Transformation buffers of the preparation threads, kept to avoid reallocation
+    WorkQueue<bool>                           prepareWorkerQueue;   //!< Queue of the preparation worker threads
+    std::vector<std::thread>                  prepareWorkerThreads; //!< Preparation worker threads, started on demand and kept until destruction
 
     /**
       Statistics counter
@@ -390,6 +419,12 @@ namespace osmscout {
       Private draw algorithm implementation routines.
      */
     //@{
+    void PrepareArea(const StyleConfig& styleConfig,
+                     const Projection& projection,
+                     const MapParameter& parameter,
+                     const Area& area,
+                     PrepareData& prepareData);
+
     void PrepareAreas(const StyleConfig& styleConfig,
                       const Projection& projection,
                       const MapParameter& parameter,
@@ -400,13 +435,22 @@ namespace osmscout {
                     const MapParameter& parameter,
                     const ObjectFileRef& ref,
                     const FeatureValueBuffer& buffer,
-                    const std::vector<Point>& nodes);
+                    const std::vector<Point>& nodes,
+                    PrepareData& prepareData);
 
     void PrepareWays(const StyleConfig& styleConfig,
                      const Projection& projection,
                      const MapParameter& parameter,
                      const MapData& data);
 
+    void PrepareWorkerLoop();
+
+    void RunPrepareWorkers(const MapParameter& parameter,
+                           std::vector<PrepareData>& chunks,
+                           const std::function<void(PrepareData&,size_t)>& prepareChunk);
+
+    void MergePrepareData(PrepareData& prepareData);
+
     void RegisterPointWayLabel(const Projection& projection,
                                const MapParameter& parameter,
                                const PathShieldStyleRef& style,
@@ -81,6 +81,8 @@ namespace osmscout {
 
     bool                         showAltLanguage;           //!< if true, display alternative language (needs support by style sheet and import)
 
+    size_t                       prepareThreadCount;        //!< Number of threads for preparing areas and ways (default 1, 0 for one per CPU core)
+
     BreakerRef                   breaker;                   //!< Breaker to abort processing on external request
 
   public:
@@ -127,6 +129,8 @@ namespace osmscout {
 
     void SetShowAltLanguage(bool showAltLanguage);
 
+    void SetPrepareThreadCount(size_t threadCount);
+
     void SetBreaker(const BreakerRef& breaker);
 
 
@@ -275,6 +279,11 @@ namespace osmscout {
       return showAltLanguage;
     }
 
+    inline size_t GetPrepareThreadCount() const
+    {
+      return prepareThreadCount;
+    }
+
     bool IsAborted() const
     {
       if (breaker) {
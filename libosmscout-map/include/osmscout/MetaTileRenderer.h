@@ -0,0 +1,201 @@
+#ifndef OSMSCOUT_METATILERENDERER_H
+#define OSMSCOUT_METATILERENDERER_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2017  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <functional>
+#include <list>
+#include <memory>
+#include <vector>
+
+#include <osmscout/private/MapImportExport.h>
+
+#include <osmscout/MapParameter.h>
+#include <osmscout/MapPainter.h>
+#include <osmscout/MapService.h>
+#include <osmscout/StyleConfig.h>
+
+#include <osmscout/util/Magnification.h>
+#include <osmscout/util/Projection.h>
+#include <osmscout/util/Tiling.h>
+
+namespace osmscout {
+
+  /**
+   * \ingroup Renderer
+   *
+   * Drawing backend of the MetaTileRenderer. Every worker thread of the renderer
+   * uses its own instance, so an implementation does not need to be thread safe
+   * but must not share painters or buffers with other instances.
+   *
+   * For every meta tile DrawMetaTile() is called once, followed by one call of
+   * StoreTile() for every tile of the meta tile.
+   */
+  class OSMSCOUT_MAP_API MetaTileCanvas
+  {
+  public:
+    virtual ~MetaTileCanvas();
+
+    /**
+     * Draw the given data for the given meta tile projection. The size of the
+     * canvas is given by the width and height of the projection.
+     */
+    virtual bool DrawMetaTile(const Projection& projection,
+                              const MapParameter& parameter,
+                              const MapData& data) = 0;
+
+    /**
+     * Store the area of the last drawn meta tile at the given pixel offset
+     * and with the given size as the given tile.
+     */
+    virtual bool StoreTile(const OSMTileId& tile,
+                           const Magnification& magnification,
+                           size_t x,
+                           size_t y,
+                           size_t width,
+                           size_t height) = 0;
+  };
+
+  //! \ingroup Renderer
+  typedef std::shared_ptr<MetaTileCanvas> MetaTileCanvasRef;
+
+  /**
+   * \ingroup Renderer
+   *
+   * Renders a given area of tiles for pre-seeding tile caches. Instead of drawing
+   * every tile on its own, square blocks of metaTileSize x metaTileSize tiles
+   * (meta tiles, aligned to multiples of the meta tile size) are drawn in one pass
+   * and afterwards sliced into tiles. This way the data is loaded, the styles are
+   * resolved and the labels are placed only once for all tiles of a meta tile, and
+   * labels crossing tile borders are drawn consistently.
+   *
+   * Labels of objects in a ring of ringSize tiles around the meta tile are drawn, too,
+   * so that labels crossing the border of neighbouring meta tiles are complete.
+   * Fadings and the dropping of not visible point labels should be disabled in the
+   * MapParameter for the same reason.
+   *
+   * Meta tiles are distributed over a number of worker threads, each drawing to its
+   * own MetaTileCanvas.
+   */
+  class OSMSCOUT_MAP_API MetaTileRenderer CLASS_FINAL
+  {
+  public:
+    typedef std::function<MetaTileCanvasRef()> CanvasFactory;
+
+    /**
+     * Statistics of the rendering of one zoom level. Data loading and drawing times
+     * are summed up over all worker threads, the total time is the elapsed time.
+     */
+    class OSMSCOUT_MAP_API LevelStatistics CLASS_FINAL
+    {
+    public:
+      uint32_t           level;         //!< The zoom level
+      size_t             metaTileCount; //!< Number of rendered meta tiles
+      size_t             tileCount;     //!< Number of stored tiles
+      double             dataTime;      //!< Time in seconds spent loading data
+      double             drawTime;      //!< Time in seconds spent drawing and storing tiles
+      double             totalTime;     //!< Elapsed time in seconds
+
+    public:
+      LevelStatistics();
+
+      double GetTilesPerSecond() const;
+    };
+
+  private:
+    MapServiceRef       mapService;
+    StyleConfigRef      styleConfig;
+    MapParameter        parameter;
+    AreaSearchParameter searchParameter;
+    size_t              metaTileSize;
+    size_t              tileWidth;
+    size_t              tileHeight;
+    double              dpi;
+    size_t              ringSize;
+    size_t              threadCount;
+
+  private:
+    MapService::TypeDefinition GetLabelTypeDefinition(const Magnification& magnification) const;
+
+    bool LoadMetaTileData(const Magnification& magnification,
+                          const OSMTileIdBox& metaTile,
+                          const MapService::TypeDefinition& ringTypeDefinition,
+                          const Projection& projection,
+                          MapData& data) const;
+
+    void MergeTilesToMapData(const std::list<TileRef>& centerTiles,
+                             const MapService::TypeDefinition& ringTypeDefinition,
+                             const std::list<TileRef>& ringTiles,
+                             MapData& data) const;
+
+  public:
+    MetaTileRenderer(const MapServiceRef& mapService,
+                     const StyleConfigRef& styleConfig);
+
+    void SetMapParameter(const MapParameter& parameter);
+    void SetAreaSearchParameter(const AreaSearchParameter& searchParameter);
+    void SetMetaTileSize(size_t metaTileSize);
+    void SetTileSize(size_t tileWidth,
+                     size_t tileHeight);
+    void SetDPI(double dpi);
+    void SetRingSize(size_t ringSize);
+    void SetThreadCount(size_t threadCount);
+
+    inline size_t GetMetaTileSize() const
+    {
+      return metaTileSize;
+    }
+
+    inline size_t GetTileWidth() const
+    {
+      return tileWidth;
+    }
+
+    inline size_t GetTileHeight() const
+    {
+      return tileHeight;
+    }
+
+    inline double GetDPI() const
+    {
+      return dpi;
+    }
+
+    inline size_t GetRingSize() const
+    {
+      return ringSize;
+    }
+
+    inline size_t GetThreadCount() const
+    {
+      return threadCount;
+    }
+
+    std::vector<OSMTileIdBox> GetMetaTiles(const Magnification& magnification,
+                                           const OSMTileIdBox& tileBox) const;
+
+    bool RenderLevel(const Magnification& magnification,
+                     const OSMTileIdBox& tileBox,
+                     const CanvasFactory& canvasFactory,
+                     LevelStatistics& statistics) const;
+  };
+}
+
+#endif
@@ -20,8 +20,10 @@
   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
 */
 
+#include <algorithm>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <vector>
 
@@ -75,6 +77,9 @@ namespace osmscout {
     }
 
     bool IsOneway(const FeatureValueBuffer& buffer) const;
+
+    bool GetFeatureMask(const FeatureValueBuffer& buffer,
+                        uint64_t& featureMask) const;
   };
 
   /**
@@ -292,6 +297,11 @@ namespace osmscout {
       return oneway;
     }
 
+    inline const SizeConditionRef& GetSizeCondition() const
+    {
+      return sizeCondition;
+    }
+
     bool Matches(const StyleResolveContext& context,
                  const FeatureValueBuffer& buffer,
                  double meterInPixel,
@@ -1582,6 +1592,163 @@ namespace osmscout {
   typedef std::list<PathSymbolStyleSelector>                           PathSymbolStyleSelectorList; //! List of selectors
   typedef std::vector<std::vector<PathSymbolStyleSelectorList> >       PathSymbolStyleLookupTable;  //!Index selectors by type and level
 
+  /**
+   * \ingroup Stylesheet
+   *
+   * Key of the StyleCache. Together with the style sheet the key defines the result
+   * of the evaluation of all style criteria for an object.
+   *
+   * The projection only influences the result by the size conditions of the
+   * selectors, so instead of the projection values the key holds the result of
+   * the evaluation of the size conditions of the type. For types without size
+   * conditions the key does not depend on the projection.
+   */
+  struct OSMSCOUT_MAP_API StyleCacheKey
+  {
+    size_t   type;           //!< Index of the type
+    size_t   level;          //!< Magnification level
+    uint64_t features;       //!< Features of the object, see StyleResolveContext::GetFeatureMask()
+    uint64_t sizeConditions; //!< Bit n is set, if size condition n of the type matches the projection
+    bool     oneway;         //!< The object is oneway
+
+    inline bool operator==(const StyleCacheKey& other) const
+    {
+      return type==other.type &&
+             level==other.level &&
+             features==other.features &&
+             sizeConditions==other.sizeConditions &&
+             oneway==other.oneway;
+    }
+  };
+
+  struct OSMSCOUT_MAP_API StyleCacheKeyHasher
+  {
+    size_t operator()(const StyleCacheKey& key) const;
+  };
+
+  /**
+   * \ingroup Stylesheet
+   *
+   * Cache of resolved styles (a single style or a vector of styles). The cache
+   * can be accessed by multiple threads in parallel. If the cache is full, entries
+   * are evicted using the CLOCK algorithm: an entry is only replaced if it was not
+   * requested since the clock hand passed it the last time, so styles that are
+   * used on every rendering stay in the cache.
+   */
+  template<class V>
+  class StyleCache CLASS_FINAL
+  {
+  private:
+    struct Entry
+    {
+      StyleCacheKey key;
+      V             value;
+      bool          referenced; //!< The entry was requested since the clock hand passed it
+    };
+
+  private:
+    mutable std::mutex                                           mutex;
+    size_t                                                       maxEntries;
+    std::vector<Entry>                                           entries;
+    std::unordered_map<StyleCacheKey,size_t,StyleCacheKeyHasher> index;
+    size_t                                                       hand;
+
+  public:
+    explicit StyleCache(size_t maxEntries=10000)
+    : maxEntries(std::max(maxEntries,(size_t)1)),
+      hand(0)
+    {
+      // no code
+    }
+
+    bool Get(const StyleCacheKey& key,
+             V& value)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+
+      auto entry=index.find(key);
+
+      if (entry==index.end()) {
+        return false;
+      }
+
+      entries[entry->second].referenced=true;
+      value=entries[entry->second].value;
+
+      return true;
+    }
+
+    void Set(const StyleCacheKey& key,
+             const V& value)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+
+      auto entry=index.find(key);
+
+      if (entry!=index.end()) {
+        entries[entry->second].value=value;
+        entries[entry->second].referenced=true;
+
+        return;
+      }
+
+      if (entries.size()<maxEntries) {
+        index[key]=entries.size();
+        entries.push_back(Entry{key,value,false});
+
+        return;
+      }
+
+      while (entries[hand].referenced) {
+        entries[hand].referenced=false;
+        hand=(hand+1)%entries.size();
+      }
+
+      index.erase(entries[hand].key);
+      index[key]=hand;
+
+      entries[hand].key=key;
+      entries[hand].value=value;
+      entries[hand].referenced=false;
+
+      hand=(hand+1)%entries.size();
+    }
+
+    /**
+     * Return the cached value for the given key in value. If there is no cached
+     * value, calculate it by calling resolve(value) and store the result.
+     */
+    template<class F>
+    void Resolve(const StyleCacheKey& key,
+                 V& value,
+                 F resolve)
+    {
+      if (Get(key,value)) {
+        return;
+      }
+
+      resolve(value);
+
+      Set(key,value);
+    }
+
+    size_t GetSize() const
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+
+      return entries.size();
+    }
+
+    void Clear()
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+
+      entries.clear();
+      index.clear();
+      hand=0;
+    }
+  };
+
   /**
    * \ingroup Stylesheet
    *
@@ -1656,13 +1823,61 @@ namespace osmscout {
 
     std::vector<TypeInfoSet>                   areaTypeSets;
 
+    std::vector<std::vector<SizeConditionRef>> typeSizeConditions; //!< Distinct size conditions of all selectors of a type, by type index
+
     std::unordered_map<std::string,bool>       flags;
     std::unordered_map<std::string,StyleConstantRef> constants;
     std::list<std::string>                     errors;
 
+    // Cache of resolved styles
+    mutable StyleCache<std::vector<TextStyleRef>>   nodeTextStyleCache;
+    mutable StyleCache<IconStyleRef>                nodeIconStyleCache;
+    mutable StyleCache<std::vector<LineStyleRef>>   wayLineStyleCache;
+    mutable StyleCache<PathTextStyleRef>            wayPathTextStyleCache;
+    mutable StyleCache<PathSymbolStyleRef>          wayPathSymbolStyleCache;
+    mutable StyleCache<PathShieldStyleRef>          wayPathShieldStyleCache;
+    mutable StyleCache<FillStyleRef>                areaFillStyleCache;
+    mutable StyleCache<std::vector<BorderStyleRef>> areaBorderStyleCache;
+    mutable StyleCache<std::vector<TextStyleRef>>   areaTextStyleCache;
+    mutable StyleCache<IconStyleRef>                areaIconStyleCache;
+    mutable StyleCache<PathTextStyleRef>            areaBorderTextStyleCache;
+    mutable StyleCache<PathSymbolStyleRef>          areaBorderSymbolStyleCache;
+
   private:
     void Reset();
 
+    bool GetStyleCacheKey(const TypeInfoRef& type,
+                          const FeatureValueBuffer& buffer,
+                          const Projection& projection,
+                          StyleCacheKey& key) const;
+
+    /**
+     * Return the style of the object in value, either from the given cache or by
+     * calling resolve(value). Objects that cannot be cached are always resolved.
+     */
+    template<class V, class F>
+    void GetCachedStyle(StyleCache<V>& cache,
+                        const TypeInfoRef& type,
+                        const FeatureValueBuffer& buffer,
+                        const Projection& projection,
+                        V& value,
+                        F resolve) const
+    {
+      StyleCacheKey key;
+
+      if (GetStyleCacheKey(type,
+                           buffer,
+                           projection,
+                           key)) {
+        cache.Resolve(key,
+                      value,
+                      resolve);
+      }
+      else {
+        resolve(value);
+      }
+    }
+
     void GetAllNodeTypes(std::list<TypeId>& types);
     void GetAllWayTypes(std::list<TypeId>& types);
     void GetAllAreaTypes(std::list<TypeId>& types);
@@ -1672,6 +1887,7 @@ namespace osmscout {
     void PostprocessAreas();
     void PostprocessIconId();
     void PostprocessPatternId();
+    void PostprocessSizeConditions();
 
   public:
     StyleConfig(const TypeConfigRef& typeConfig);
@@ -1829,6 +2045,13 @@ namespace osmscout {
                                       LineStyleRef& lineStyle) const;
     //@}
 
+    /**
+     * Remove all resolved styles from the style caches. The caches are cleared
+     * automatically if the style sheet is (re)loaded, so this is only required
+     * to free memory.
+     */
+    void ClearStyleCaches();
+
     /**
      * Methods for low level debugging access to the style sheet internals
      */
@@ -19,6 +19,11 @@
 
 #include <osmscout/LabelLayouter.h>
 
+#include <algorithm>
+#include <cmath>
+
+#include <osmscout/system/Assert.h>
+
 //#define LABEL_LAYOUTER_DEBUG
 
 namespace osmscout {
@@ -43,46 +48,130 @@ namespace osmscout {
     // no code
   }
 
-  void LabelLayouter::DeleteEventsForLabel(const std::set<LabelEvent>::iterator& eventRef)
-  {
-    LabelEvent searchEventTop;
-    LabelEvent searchEventBottom;
+  /**
+   * Edge length (in pixel) of the cells of the label grid
+   */
+  static const double labelCellSize=64.0;
 
-    searchEventTop.y=eventRef->label->by1;
-    searchEventTop.x=eventRef->label->bx1;
-    searchEventTop.label=eventRef->label;
+  size_t LabelLayouter::GetCellX(double x) const
+  {
+    if (!(x>0.0)) {
+      return 0;
+    }
 
-    searchEventBottom.y=eventRef->label->by2;
-    searchEventBottom.x=eventRef->label->bx1;
-    searchEventBottom.label=eventRef->label;
+    return std::min((size_t)(x/labelCellSize),
+                    cellsHoriz-1);
+  }
 
-    std::set<LabelEvent>::iterator event;
+  size_t LabelLayouter::GetCellY(double y) const
+  {
+    if (!(y>0.0)) {
+      return 0;
+    }
 
-    event=events.find(searchEventTop);
+    return std::min((size_t)(y/labelCellSize),
+                    cellsVert-1);
+  }
 
-    assert(event!=events.end());
+  /**
+   * Add the label to all cells covered by its bounding box
+   */
+  void LabelLayouter::RegisterLabel(const LabelDataRef& label)
+  {
+    size_t cx1=GetCellX(label->bx1);
+    size_t cx2=GetCellX(label->bx2);
+    size_t cy1=GetCellY(label->by1);
+    size_t cy2=GetCellY(label->by2);
+
+    for (size_t cy=cy1; cy<=cy2; cy++) {
+      for (size_t cx=cx1; cx<=cx2; cx++) {
+        cells[cy*cellsHoriz+cx].push_back(label);
+      }
+    }
+  }
 
+  /**
+   * Remove the label from all cells covered by its bounding box and move its
+   * storage to the free list
+   */
+  void LabelLayouter::DropLabel(const LabelDataRef& label)
+  {
 #if defined(LABEL_LAYOUTER_DEBUG)
-    std::cout << "Removing event: ";
-    std::cout << event->label->text << " ";
-    std::cout << event->x << "," << event->y << " | ";
-    std::cout << event->label->bx1 << " - " << event->label->bx2 << ", "  << event->label->by1 << " - " << event->label->by2 << std::endl;
+    std::cout << "Removing label: ";
+    std::cout << label->text << " ";
+    std::cout << label->bx1 << " - " << label->bx2 << ", "  << label->by1 << " - " << label->by2 << std::endl;
 #endif
 
-    events.erase(event);
+    size_t cx1=GetCellX(label->bx1);
+    size_t cx2=GetCellX(label->bx2);
+    size_t cy1=GetCellY(label->by1);
+    size_t cy2=GetCellY(label->by2);
 
-    event=events.find(searchEventBottom);
+    for (size_t cy=cy1; cy<=cy2; cy++) {
+      for (size_t cx=cx1; cx<=cx2; cx++) {
+        std::vector<LabelDataRef>& cell=cells[cy*cellsHoriz+cx];
+        auto                       entry=std::find(cell.begin(),
+                                                   cell.end(),
+                                                   label);
 
-    assert(event!=events.end());
+        assert(entry!=cell.end());
 
-#if defined(LABEL_LAYOUTER_DEBUG)
-    std::cout << "Removing event: ";
-    std::cout << event->label->text << " ";
-    std::cout << event->x << "," << event->y << " | ";
-    std::cout << event->label->bx1 << " - " << event->label->bx2 << ", "  << event->label->by1 << " - " << event->label->by2 << std::endl;
-#endif
+        *entry=cell.back();
+        cell.pop_back();
+      }
+    }
+
+    freeLabels.splice(freeLabels.begin(),
+                      labels,
+                      label);
+  }
+
+  /**
+   * Collect all labels in the cells covered by the given label (including the
+   * maximum label space) into candidates. Every label is collected once, sorted
+   * by its upper, left edge.
+   */
+  void LabelLayouter::CollectCandidates(const LabelData& label)
+  {
+    size_t cx1=GetCellX(label.bx1-maxSpace);
+    size_t cx2=GetCellX(label.bx2+maxSpace);
+    size_t cy1=GetCellY(label.by1-maxSpace);
+    size_t cy2=GetCellY(label.by2+maxSpace);
+
+    candidates.clear();
+
+    for (size_t cy=cy1; cy<=cy2; cy++) {
+      for (size_t cx=cx1; cx<=cx2; cx++) {
+        const std::vector<LabelDataRef>& cell=cells[cy*cellsHoriz+cx];
+
+        candidates.insert(candidates.end(),
+                          cell.begin(),
+                          cell.end());
+      }
+    }
+
+    std::sort(candidates.begin(),
+              candidates.end(),
+              [](const LabelDataRef& a,
+                 const LabelDataRef& b) {
+      if (a->by1!=b->by1) {
+        return a->by1<b->by1;
+      }
+
+      if (a->bx1!=b->bx1) {
+        return a->bx1<b->bx1;
+      }
+
+      if (a->id!=b->id) {
+        return a->id<b->id;
+      }
+
+      return &*a<&*b;
+    });
 
-    events.erase(event);
+    candidates.erase(std::unique(candidates.begin(),
+                                 candidates.end()),
+                     candidates.end());
   }
 
   bool LabelLayouter::Intersects(const LabelData& first, const LabelData& second) const
@@ -164,20 +253,32 @@ namespace osmscout {
   void LabelLayouter::Initialize(const Projection& projection,
                                  const MapParameter& parameter)
   {
-    labels.clear();
-    events.clear();
+    freeLabels.splice(freeLabels.begin(),
+                      labels);
 
     width=projection.GetWidth();
     height=projection.GetHeight();
 
+    cellsHoriz=std::max((size_t)1,(size_t)ceil(width/labelCellSize));
+    cellsVert=std::max((size_t)1,(size_t)ceil(height/labelCellSize));
+
+    // Clear the cells but keep their memory for the next frame
+    cells.resize(cellsHoriz*cellsVert);
+
+    for (auto& cell : cells) {
+      cell.clear();
+    }
+
     labelSpace=projection.ConvertWidthToPixel(parameter.GetLabelSpace());
     shieldLabelSpace=projection.ConvertWidthToPixel(parameter.GetPlateLabelSpace());
     sameLabelSpace=projection.ConvertWidthToPixel(parameter.GetSameLabelSpace());
 
+    // Labels only intersect, if their bounding boxes extended by labelSpace
+    // or shieldLabelSpace intersect, sameLabelSpace only further restricts
+    // intersections (see Intersects())
     maxSpace=0.0;
     maxSpace=std::max(maxSpace,labelSpace);
     maxSpace=std::max(maxSpace,shieldLabelSpace);
-    maxSpace=std::max(maxSpace,sameLabelSpace);
 
     dropNotVisiblePointLabels=parameter.GetDropNotVisiblePointLabels();
 
@@ -189,8 +290,6 @@ namespace osmscout {
   {
     labelsAdded++;
 
-    LabelEvent searchEvent;
-
     if (dropNotVisiblePointLabels) {
       if (label.bx2<0 || label.bx1>=width) {
         return false;
@@ -201,95 +300,63 @@ namespace osmscout {
       }
     }
 
-    searchEvent.y=label.by1-maxSpace;
-    searchEvent.x=label.bx1;
-
-    std::set<LabelEvent>::iterator event=events.lower_bound(searchEvent);
-
 #if defined(LABEL_LAYOUTER_DEBUG)
     std::cout << "--- Placing: '";
     std::cout << label.text << "' ";
     std::cout << label.bx1 << " - " << label.bx2 << ", "  << label.by1 << " - " << label.by2;
     std::cout << std::endl;
-
-    for (const auto& event : events) {
-      std::cout << "Event: '";
-      std::cout << event.label->text << "' ";
-      std::cout << event.x << "," << event.y << " | ";
-      std::cout << event.label->bx1 << " - " << event.label->bx2 << ", "  << event.label->by1 << " - " << event.label->by2 << std::endl;
-    }
 #endif
 
-    while (event!=events.end() &&
-           label.by2+maxSpace>=event->y) {
-#if defined(LABEL_LAYOUTER_DEBUG)
-      std::cout << "---->: '";
-      std::cout << event->label->text << "' ";
-      std::cout << event->x << "," << event->y << " | ";
-      std::cout << event->label->bx1 << " - " << event->label->bx2 << ", "  << event->label->by1 << " - " << event->label->by2 << std::endl;
-#endif
-
-      if (Intersects(*event->label,label)) {
-        if (label.priority<event->label->priority) {
-          LabelDataRef oldLabel=event->label;
+    CollectCandidates(label);
 
+    for (const auto& candidate : candidates) {
 #if defined(LABEL_LAYOUTER_DEBUG)
-          std::cout << "DROPPING lower prio '" << event->label->text << "' " << label.priority << " vs. " << event->label->priority << std::endl;
+      std::cout << "---->: '";
+      std::cout << candidate->text << "' ";
+      std::cout << candidate->bx1 << " - " << candidate->bx2 << ", "  << candidate->by1 << " - " << candidate->by2 << std::endl;
 #endif
 
-          // Removing old label and restart inserting
-          DeleteEventsForLabel(event);
-          labels.erase(oldLabel);
-
-          // Restart the search :-/
-          event=events.lower_bound(searchEvent);
-        }
-        else if (label.priority==event->label->priority) {
-          LabelDataRef oldLabel=event->label;
+      if (!Intersects(*candidate,label)) {
+        continue;
+      }
 
-          if (event->label->text==label.text) {
-            if (label.bx1<=event->label->bx1) {
+      if (label.priority<candidate->priority) {
 #if defined(LABEL_LAYOUTER_DEBUG)
-              std::cout << "DROPPING intersecting label with same prio and text '" << event->label->text << "' " << label.priority << " vs. " << event->label->priority << std::endl;
+        std::cout << "DROPPING lower prio '" << candidate->text << "' " << label.priority << " vs. " << candidate->priority << std::endl;
 #endif
-              // Removing old label and restart inserting
-              DeleteEventsForLabel(event);
-              labels.erase(oldLabel);
-
-              // Restart the search :-/
-              event=events.lower_bound(searchEvent);
-            }
-            else {
+        DropLabel(candidate);
+      }
+      else if (label.priority==candidate->priority) {
+        if (candidate->text==label.text) {
+          if (label.bx1<=candidate->bx1) {
 #if defined(LABEL_LAYOUTER_DEBUG)
-              std::cout << "CANCEL because intersecting label with same prio and text '" << event->label->text << "' " << label.priority << " vs. " << event->label->priority << std::endl;
+            std::cout << "DROPPING intersecting label with same prio and text '" << candidate->text << "' " << label.priority << " vs. " << candidate->priority << std::endl;
 #endif
-              return false;
-            }
+            DropLabel(candidate);
           }
           else {
 #if defined(LABEL_LAYOUTER_DEBUG)
-            std::cout << "DROPPING same prio and exit '" << event->label->text << "' " << label.priority << " vs. " << event->label->priority << std::endl;
+            std::cout << "CANCEL because intersecting label with same prio and text '" << candidate->text << "' " << label.priority << " vs. " << candidate->priority << std::endl;
 #endif
-            // Drop old and new label
-            DeleteEventsForLabel(event);
-            labels.erase(oldLabel);
-
             return false;
           }
         }
         else {
 #if defined(LABEL_LAYOUTER_DEBUG)
-          std::cout << "CANCEL since higher prio '" << event->label->text << "' " << label.priority << " vs. " << event->label->priority << std::endl;
+          std::cout << "DROPPING same prio and exit '" << candidate->text << "' " << label.priority << " vs. " << candidate->priority << std::endl;
 #endif
-          // Do not insert new label
+          // Drop old and new label
+          DropLabel(candidate);
+
           return false;
         }
       }
       else {
 #if defined(LABEL_LAYOUTER_DEBUG)
-        //std::cout << "IGNORING '" << event->label->text << "'" << std::endl;
+        std::cout << "CANCEL since higher prio '" << candidate->text << "' " << label.priority << " vs. " << candidate->priority << std::endl;
 #endif
-        event++;
+        // Do not insert new label
+        return false;
       }
     }
 
@@ -297,22 +364,40 @@ namespace osmscout {
     std::cout << "INSERT" << std::endl;
 #endif
 
-    labels.push_front(label);
-    labelRef=labels.begin();
-
-    LabelEvent insertEvent;
+    if (freeLabels.empty()) {
+      labels.push_front(label);
+    }
+    else {
+      labels.splice(labels.begin(),
+                    freeLabels,
+                    freeLabels.begin());
+      labels.front()=label;
+    }
 
-    insertEvent.x=label.bx1;
-    insertEvent.label=labelRef;
+    labelRef=labels.begin();
 
-    insertEvent.y=label.by1;
+    RegisterLabel(labelRef);
 
-    events.insert(insertEvent);
+    return true;
+  }
 
-    insertEvent.y=label.by2;
+  /**
+   * Place the given labels in the given order, like calling Placelabel() for
+   * each label. Returns the number of labels placed, some of them may have been
+   * dropped again by later labels of the batch.
+   */
+  size_t LabelLayouter::PlaceLabels(const std::vector<LabelData>& batch)
+  {
+    size_t       placed=0;
+    LabelDataRef labelRef;
 
-    events.insert(insertEvent);
+    for (const auto& label : batch) {
+      if (Placelabel(label,
+                     labelRef)) {
+        placed++;
+      }
+    }
 
-    return true;
+    return placed;
   }
 }
@@ -19,6 +19,8 @@
 
 #include <osmscout/MapPainter.h>
 
+#include <atomic>
+#include <future>
 #include <limits>
 
 #include <osmscout/system/Math.h>
@@ -148,6 +150,56 @@ namespace osmscout {
     return a.position<b.position;
   }
 
+  /**
+   * Minimum number of objects prepared by one job of the parallel preparation.
+   * For less objects the overhead of starting threads is not worth it.
+   */
+  static const size_t prepareChunkMinSize=256;
+
+  /**
+   * Number of threads to use for preparing areas and ways
+   */
+  static size_t GetPrepareThreadCount(const MapParameter& parameter)
+  {
+    size_t threadCount=parameter.GetPrepareThreadCount();
+
+    if (threadCount==0) {
+      threadCount=std::max(std::thread::hardware_concurrency(),1u);
+    }
+
+    return threadCount;
+  }
+
+  /**
+   * Number of consecutive ranges (chunks) the given number of objects is split into
+   * for preparation. Every thread handles a few chunks to balance the load, since
+   * the costs of single objects differ a lot. A result of 1 means that the objects
+   * are prepared by the calling thread.
+   */
+  static size_t GetPrepareChunkCount(const MapParameter& parameter,
+                                     size_t objectCount)
+  {
+    size_t threadCount=GetPrepareThreadCount(parameter);
+
+    if (threadCount<=1) {
+      return 1;
+    }
+
+    return std::max(std::min(threadCount*4,
+                             objectCount/prepareChunkMinSize),
+                    (size_t)1);
+  }
+
+  MapPainter::PrepareData::PrepareData(TransBuffer* transBuffer)
+  : transBuffer(transBuffer),
+    coordStart(0),
+    coordEnd(0),
+    areasSegments(0),
+    waysSegments(0)
+  {
+    // no code
+  }
+
   MapPainter::ContourLabelHelper::ContourLabelHelper(const MapPainter& painter)
   : contourLabelOffset(painter.contourLabelOffset),
     contourLabelSpace(painter.contourLabelSpace)
@@ -209,6 +261,12 @@ namespace osmscout {
   MapPainter::~MapPainter()
   {
     log.Debug() << "MapPainter::~MapPainter()";
+
+    prepareWorkerQueue.Stop();
+
+    for (auto& thread : prepareWorkerThreads) {
+      thread.join();
+    }
   }
 
   void MapPainter::DumpDataStatistics(const Projection& projection,
@@ -864,6 +922,10 @@ namespace osmscout {
                                              text);
 
 
+    std::vector<LabelData> labelBoxes;
+
+    labelBoxes.reserve(gridPoints.size());
+
     for (const auto& gridPoint : gridPoints) {
       double x,y;
 
@@ -897,11 +959,10 @@ namespace osmscout {
       labelBox.style=style;
       labelBox.text=text;
 
-      LabelDataRef label;
-
-      labels.Placelabel(labelBox,
-                        label);
+      labelBoxes.push_back(labelBox);
     }
+
+    labels.PlaceLabels(labelBoxes);
   }
 
   /**
@@ -1794,164 +1855,193 @@ namespace osmscout {
     }
   }
 
-  void MapPainter::PrepareAreas(const StyleConfig& styleConfig,
-                                const Projection& projection,
-                                const MapParameter& parameter,
-                                const MapData& data)
+  void MapPainter::PrepareArea(const StyleConfig& styleConfig,
+                               const Projection& projection,
+                               const MapParameter& parameter,
+                               const Area& area,
+                               PrepareData& prepareData)
   {
-    areaData.clear();
+    std::vector<PolyData> td(area.rings.size());
 
-    //Areas
-    for (const auto& area : data.areas) {
-      std::vector<PolyData> td(area->rings.size());
+    for (size_t i=0; i<area.rings.size(); i++) {
+      // The master ring does not have any nodes, skipping...
+      if (area.rings[i].IsMasterRing()) {
+        continue;
+      }
+
+      prepareData.transBuffer->TransformArea(projection,
+                                             parameter.GetOptimizeAreaNodes(),
+                                             area.rings[i].nodes,
+                                             td[i].transStart,td[i].transEnd,
+                                             errorTolerancePixel);
+    }
+
+    size_t ringId=Area::outerRingId;
+    bool foundRing=true;
+
+    while (foundRing) {
+      foundRing=false;
 
-      for (size_t i=0; i<area->rings.size(); i++) {
-        // The master ring does not have any nodes, skipping...
-        if (area->rings[i].IsMasterRing()) {
+      for (size_t i=0; i<area.rings.size(); i++) {
+        const Area::Ring& ring=area.rings[i];
+
+        if (ring.GetRing()!=ringId) {
           continue;
         }
 
-        transBuffer.TransformArea(projection,
-                                  parameter.GetOptimizeAreaNodes(),
-                                  area->rings[i].nodes,
-                                  td[i].transStart,td[i].transEnd,
-                                  errorTolerancePixel);
-      }
+        if (!ring.IsOuterRing() &&
+            ring.GetType()->GetIgnore()) {
+          continue;
+        }
 
-      size_t ringId=Area::outerRingId;
-      bool foundRing=true;
+        TypeInfoRef                 type;
+        FillStyleRef                fillStyle;
+        std::vector<BorderStyleRef> borderStyles;
+        BorderStyleRef              borderStyle;
 
-      while (foundRing) {
-        foundRing=false;
+        if (ring.IsOuterRing()) {
+          type=area.GetType();
+        }
+        else {
+          type=ring.GetType();
+        }
 
-        for (size_t i=0; i<area->rings.size(); i++) {
-          const Area::Ring& ring=area->rings[i];
+        styleConfig.GetAreaFillStyle(type,
+                                     ring.GetFeatureValueBuffer(),
+                                     projection,
+                                     fillStyle);
 
-          if (ring.GetRing()!=ringId) {
-            continue;
-          }
+        styleConfig.GetAreaBorderStyles(type,
+                                        ring.GetFeatureValueBuffer(),
+                                        projection,
+                                        borderStyles);
 
-          if (!ring.IsOuterRing() &&
-              ring.GetType()->GetIgnore()) {
-            continue;
-          }
+        if (!fillStyle && borderStyles.empty()) {
+          continue;
+        }
 
-          TypeInfoRef                 type;
-          FillStyleRef                fillStyle;
-          std::vector<BorderStyleRef> borderStyles;
-          BorderStyleRef              borderStyle;
+        size_t borderStyleIndex=0;
 
-          if (ring.IsOuterRing()) {
-            type=area->GetType();
-          }
-          else {
-            type=ring.GetType();
-          }
+        if (!borderStyles.empty() &&
+            borderStyles.front()->GetDisplayOffset()==0.0 &&
+            borderStyles.front()->GetOffset()==0.0) {
+          borderStyle=borderStyles[borderStyleIndex];
+          borderStyleIndex++;
+        }
 
-          styleConfig.GetAreaFillStyle(type,
-                                       ring.GetFeatureValueBuffer(),
-                                       projection,
-                                       fillStyle);
+        foundRing=true;
 
-          styleConfig.GetAreaBorderStyles(type,
-                                          ring.GetFeatureValueBuffer(),
-                                          projection,
-                                          borderStyles);
+        AreaData a;
+        double   borderWidth=borderStyle ? borderStyle->GetWidth() : 0.0;
 
-          if (!fillStyle && borderStyles.empty()) {
-            continue;
-          }
+        ring.GetBoundingBox(a.boundingBox);
 
-          size_t borderStyleIndex=0;
+        if (!IsVisibleArea(projection,
+                           a.boundingBox,
+                           borderWidth/2.0)) {
+          continue;
+        }
 
-          if (!borderStyles.empty() &&
-              borderStyles.front()->GetDisplayOffset()==0.0 &&
-              borderStyles.front()->GetOffset()==0.0) {
-            borderStyle=borderStyles[borderStyleIndex];
-            borderStyleIndex++;
-          }
+        // Collect possible clippings. We only take into account inner rings of the next level
+        // that do not have a type and thus act as a clipping region. If a inner ring has a type,
+        // we currently assume that it does not have alpha and paints over its region and clipping is
+        // not required.
+        // Since we know that rings a created deep first, we only take into account direct followers
+        // in the list with ring+1.
+        size_t j=i+1;
+        while (j<area.rings.size() &&
+               area.rings[j].GetRing()==ringId+1 &&
+               area.rings[j].GetType()->GetIgnore()) {
+          a.clippings.push_back(td[j]);
+
+          j++;
+        }
+
+        a.ref=area.GetObjectFileRef();
+        a.type=type;
+        a.buffer=&ring.GetFeatureValueBuffer();
+        a.fillStyle=fillStyle;
+        a.borderStyle=borderStyle;
+        a.transStart=td[i].transStart;
+        a.transEnd=td[i].transEnd;
+
+        prepareData.areaData.push_back(a);
 
-          foundRing=true;
+        for (size_t idx=borderStyleIndex;
+             idx<borderStyles.size();
+             idx++) {
+          borderStyle=borderStyles[idx];
 
-          AreaData a;
-          double   borderWidth=borderStyle ? borderStyle->GetWidth() : 0.0;
+          double offset=0.0;
 
-          ring.GetBoundingBox(a.boundingBox);
+          size_t transStart=td[i].transStart;
+          size_t transEnd=td[i].transEnd;
+
+          if (borderStyle->GetOffset()!=0.0) {
+            offset+=GetProjectedWidth(projection,
+                                      borderStyle->GetOffset());
+          }
 
-          if (!IsVisibleArea(projection,
-                             a.boundingBox,
-                             borderWidth/2.0)) {
-            continue;
+          if (borderStyle->GetDisplayOffset()!=0.0) {
+            offset+=projection.ConvertWidthToPixel(borderStyle->GetDisplayOffset());
           }
 
-          // Collect possible clippings. We only take into account inner rings of the next level
-          // that do not have a type and thus act as a clipping region. If a inner ring has a type,
-          // we currently assume that it does not have alpha and paints over its region and clipping is
-          // not required.
-          // Since we know that rings a created deep first, we only take into account direct followers
-          // in the list with ring+1.
-          size_t j=i+1;
-          while (j<area->rings.size() &&
-                 area->rings[j].GetRing()==ringId+1 &&
-                 area->rings[j].GetType()->GetIgnore()) {
-            a.clippings.push_back(td[j]);
-
-            j++;
+          if (offset!=0.0) {
+            prepareData.transBuffer->buffer->GenerateParallelWay(transStart,
+                                                                 transEnd,
+                                                                 offset,
+                                                                 transStart,
+                                                                 transEnd);
           }
 
-          a.ref=area->GetObjectFileRef();
+          a.ref=area.GetObjectFileRef();
           a.type=type;
-          a.buffer=&ring.GetFeatureValueBuffer();
-          a.fillStyle=fillStyle;
+          a.buffer=nullptr;
+          a.fillStyle=nullptr;
           a.borderStyle=borderStyle;
-          a.transStart=td[i].transStart;
-          a.transEnd=td[i].transEnd;
+          a.transStart=transStart;
+          a.transEnd=transEnd;
 
-          areaData.push_back(a);
-
-          for (size_t idx=borderStyleIndex;
-               idx<borderStyles.size();
-               idx++) {
-            borderStyle=borderStyles[idx];
-
-            double offset=0.0;
-
-            size_t transStart=td[i].transStart;
-            size_t transEnd=td[i].transEnd;
-
-            if (borderStyle->GetOffset()!=0.0) {
-              offset+=GetProjectedWidth(projection,
-                                        borderStyle->GetOffset());
-            }
+          prepareData.areaData.push_back(a);
+        }
 
-            if (borderStyle->GetDisplayOffset()!=0.0) {
-              offset+=projection.ConvertWidthToPixel(borderStyle->GetDisplayOffset());
-            }
+        prepareData.areasSegments++;
+      }
 
-            if (offset!=0.0) {
-              coordBuffer->GenerateParallelWay(transStart,
-                                               transEnd,
-                                               offset,
-                                               transStart,
-                                               transEnd);
-            }
+      ringId++;
+    }
+  }
 
-            a.ref=area->GetObjectFileRef();
-            a.type=type;
-            a.buffer=nullptr;
-            a.fillStyle=nullptr;
-            a.borderStyle=borderStyle;
-            a.transStart=transStart;
-            a.transEnd=transEnd;
+  void MapPainter::PrepareAreas(const StyleConfig& styleConfig,
+                                const Projection& projection,
+                                const MapParameter& parameter,
+                                const MapData& data)
+  {
+    std::vector<PrepareData> chunks(GetPrepareChunkCount(parameter,
+                                                         data.areas.size()),
+                                    PrepareData(&transBuffer));
 
-            areaData.push_back(a);
-          }
+    areaData.clear();
 
-          areasSegments++;
-        }
+    RunPrepareWorkers(parameter,
+                      chunks,
+                      [&](PrepareData& prepareData, size_t chunk) {
+      size_t start=chunk*data.areas.size()/chunks.size();
+      size_t end=(chunk+1)*data.areas.size()/chunks.size();
 
-        ringId++;
+      for (size_t a=start; a<end; a++) {
+        PrepareArea(styleConfig,
+                    projection,
+                    parameter,
+                    *data.areas[a],
+                    prepareData);
       }
+    });
+
+    // Merge in object order, so that the (stable) sorting gives the same result
+    // as a sequential preparation
+    for (auto& chunk : chunks) {
+      MergePrepareData(chunk);
     }
 
     areaData.sort(AreaSorter);
@@ -1962,13 +2052,14 @@ namespace osmscout {
                               const MapParameter& parameter,
                               const ObjectFileRef& ref,
                               const FeatureValueBuffer& buffer,
-                              const std::vector<Point>& nodes)
+                              const std::vector<Point>& nodes,
+                              PrepareData& prepareData)
   {
     styleConfig.GetWayLineStyles(buffer,
                                  projection,
-                                 lineStyles);
+                                 prepareData.lineStyles);
 
-    if (lineStyles.empty()) {
+    if (prepareData.lineStyles.empty()) {
       return;
     }
 
@@ -1976,7 +2067,7 @@ namespace osmscout {
     size_t transStart=0; // Make the compiler happy
     size_t transEnd=0;   // Make the compiler happy
 
-    for (const auto& lineStyle : lineStyles) {
+    for (const auto& lineStyle : prepareData.lineStyles) {
       double       lineWidth=0.0;
       double       lineOffset=0.0;
 
@@ -2023,12 +2114,12 @@ namespace osmscout {
       }
 
       if (!transformed) {
-        transBuffer.TransformWay(projection,
-                                 parameter.GetOptimizeWayNodes(),
-                                 nodes,
-                                 transStart,
-                                 transEnd,
-                                 errorTolerancePixel);
+        prepareData.transBuffer->TransformWay(projection,
+                                              parameter.GetOptimizeWayNodes(),
+                                              nodes,
+                                              transStart,
+                                              transEnd,
+                                              errorTolerancePixel);
 
         WayPathData pathData;
 
@@ -2037,7 +2128,7 @@ namespace osmscout {
         pathData.transStart=transStart;
         pathData.transEnd=transEnd;
 
-        wayPathData.push_back(pathData);
+        prepareData.wayPathData.push_back(pathData);
 
         transformed=true;
       }
@@ -2056,18 +2147,18 @@ namespace osmscout {
       }
 
       if (lineOffset!=0.0) {
-        coordBuffer->GenerateParallelWay(transStart,transEnd,
-                                         lineOffset,
-                                         data.transStart,
-                                         data.transEnd);
+        prepareData.transBuffer->buffer->GenerateParallelWay(transStart,transEnd,
+                                                             lineOffset,
+                                                             data.transStart,
+                                                             data.transEnd);
       }
       else {
         data.transStart=transStart;
         data.transEnd=transEnd;
       }
 
-      waysSegments++;
-      wayData.push_back(data);
+      prepareData.waysSegments++;
+      prepareData.wayData.push_back(data);
     }
   }
 
@@ -2076,30 +2167,169 @@ namespace osmscout {
                                const MapParameter& parameter,
                                const MapData& data)
   {
-    wayData.clear();
-    wayPathData.clear();
+    std::vector<const Way*> ways;
+
+    ways.reserve(data.ways.size()+data.poiWays.size());
 
     for (const auto& way : data.ways) {
-      PrepareWay(styleConfig,
-                 projection,
-                 parameter,
-                 ObjectFileRef(way->GetFileOffset(),refWay),
-                 way->GetFeatureValueBuffer(),
-                 way->nodes);
+      ways.push_back(way.get());
     }
 
     for (const auto& way : data.poiWays) {
-      PrepareWay(styleConfig,
-                 projection,
-                 parameter,
-                 ObjectFileRef(way->GetFileOffset(),refWay),
-                 way->GetFeatureValueBuffer(),
-                 way->nodes);
+      ways.push_back(way.get());
+    }
+
+    std::vector<PrepareData> chunks(GetPrepareChunkCount(parameter,
+                                                         ways.size()),
+                                    PrepareData(&transBuffer));
+
+    wayData.clear();
+    wayPathData.clear();
+
+    RunPrepareWorkers(parameter,
+                      chunks,
+                      [&](PrepareData& prepareData, size_t chunk) {
+      size_t start=chunk*ways.size()/chunks.size();
+      size_t end=(chunk+1)*ways.size()/chunks.size();
+
+      for (size_t w=start; w<end; w++) {
+        PrepareWay(styleConfig,
+                   projection,
+                   parameter,
+                   ObjectFileRef(ways[w]->GetFileOffset(),refWay),
+                   ways[w]->GetFeatureValueBuffer(),
+                   ways[w]->nodes,
+                   prepareData);
+      }
+    });
+
+    // Merge in object order, so that the (stable) sorting gives the same result
+    // as a sequential preparation
+    for (auto& chunk : chunks) {
+      MergePrepareData(chunk);
     }
 
     wayData.sort();
   }
 
+  void MapPainter::PrepareWorkerLoop()
+  {
+    std::packaged_task<bool()> task;
+
+    while (prepareWorkerQueue.PopTask(task)) {
+      task();
+    }
+  }
+
+  /**
+   * Call prepareChunk for all chunks. A single chunk is prepared by the calling thread
+   * using the transformation buffer of the painter. Else the chunks are distributed
+   * over the calling thread and the worker threads of the painter, each using its own
+   * transformation buffer. The worker threads are started on first use and then
+   * reused by the following calls. The coordinates of a chunk are consecutive in the
+   * buffer of the thread that prepared it.
+   */
+  void MapPainter::RunPrepareWorkers(const MapParameter& parameter,
+                                     std::vector<PrepareData>& chunks,
+                                     const std::function<void(PrepareData&,size_t)>& prepareChunk)
+  {
+    if (chunks.size()==1) {
+      prepareChunk(chunks.front(),0);
+      return;
+    }
+
+    size_t              workerCount=std::min(GetPrepareThreadCount(parameter),
+                                             chunks.size());
+    std::atomic<size_t> nextChunk(0);
+
+    while (prepareTransBuffers.size()<workerCount) {
+      prepareTransBuffers.push_back(std::unique_ptr<TransBuffer>(new TransBuffer(new CoordBuffer())));
+    }
+
+    auto worker=[&](TransBuffer* workerBuffer) {
+      workerBuffer->Reset();
+
+      for (size_t chunk=nextChunk++; chunk<chunks.size(); chunk=nextChunk++) {
+        PrepareData& prepareData=chunks[chunk];
+
+        prepareData.transBuffer=workerBuffer;
+        prepareData.coordStart=workerBuffer->buffer->GetPointCount();
+
+        prepareChunk(prepareData,chunk);
+
+        prepareData.coordEnd=workerBuffer->buffer->GetPointCount();
+      }
+    };
+
+    while (prepareWorkerThreads.size()+1<workerCount) {
+      prepareWorkerThreads.push_back(std::thread(&MapPainter::PrepareWorkerLoop,this));
+    }
+
+    std::vector<std::future<bool>> results;
+
+    for (size_t t=1; t<workerCount; t++) {
+      TransBuffer*               workerBuffer=prepareTransBuffers[t].get();
+      std::packaged_task<bool()> task([&worker,workerBuffer]() {
+        worker(workerBuffer);
+        return true;
+      });
+
+      results.push_back(task.get_future());
+      prepareWorkerQueue.PushTask(task);
+    }
+
+    worker(prepareTransBuffers[0].get());
+
+    for (auto& result : results) {
+      result.get();
+    }
+  }
+
+  /**
+   * Move the prepared data of a chunk to the painter. Coordinates prepared by another
+   * thread are copied to the coordinate buffer of the painter and all references to
+   * them are adjusted.
+   */
+  void MapPainter::MergePrepareData(PrepareData& prepareData)
+  {
+    if (prepareData.transBuffer!=&transBuffer) {
+      const Vertex2D* coords=prepareData.transBuffer->buffer->buffer;
+      size_t          offset=coordBuffer->GetPointCount()-prepareData.coordStart;
+
+      for (size_t i=prepareData.coordStart; i<prepareData.coordEnd; i++) {
+        coordBuffer->PushCoord(coords[i].GetX(),
+                               coords[i].GetY());
+      }
+
+      for (auto& area : prepareData.areaData) {
+        area.transStart+=offset;
+        area.transEnd+=offset;
+
+        for (auto& clipping : area.clippings) {
+          clipping.transStart+=offset;
+          clipping.transEnd+=offset;
+        }
+      }
+
+      for (auto& way : prepareData.wayData) {
+        way.transStart+=offset;
+        way.transEnd+=offset;
+      }
+
+      for (auto& path : prepareData.wayPathData) {
+        path.transStart+=offset;
+        path.transEnd+=offset;
+      }
+    }
+
+    areaData.splice(areaData.end(),prepareData.areaData);
+    wayData.splice(wayData.end(),prepareData.wayData);
+    wayPathData.splice(wayPathData.end(),prepareData.wayPathData);
+
+    areasSegments+=prepareData.areasSegments;
+    waysSegments+=prepareData.waysSegments;
+  }
+
   bool MapPainter::Draw(const Projection& projection,
                         const MapParameter& parameter,
                         const MapData& data)
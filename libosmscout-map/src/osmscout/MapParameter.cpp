@@ -48,7 +48,8 @@ namespace osmscout {
     debugPerformance(false),
     warnObjectCountLimit(0),
     warnCoordCountLimit(0),
-    showAltLanguage(false)
+    showAltLanguage(false),
+    prepareThreadCount(1)
   {
     // no code
   }
@@ -193,6 +194,17 @@ namespace osmscout {
     warnCoordCountLimit=limit;
   }
 
+  /**
+   * Set the number of threads used for the preparation of areas and ways before
+   * drawing. Drawing itself is always done by the calling thread. The result of
+   * drawing does not depend on the number of threads. A value of 0 uses one
+   * thread per CPU core.
+   */
+  void MapParameter::SetPrepareThreadCount(size_t threadCount)
+  {
+    prepareThreadCount=threadCount;
+  }
+
   void MapParameter::SetBreaker(const BreakerRef& breaker)
   {
     this->breaker=breaker;
@@ -0,0 +1,507 @@
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2017  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/MetaTileRenderer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_map>
+
+#include <osmscout/util/Logger.h>
+#include <osmscout/util/StopClock.h>
+
+namespace osmscout {
+
+  MetaTileCanvas::~MetaTileCanvas()
+  {
+    // no code
+  }
+
+  MetaTileRenderer::LevelStatistics::LevelStatistics()
+  : level(0),
+    metaTileCount(0),
+    tileCount(0),
+    dataTime(0.0),
+    drawTime(0.0),
+    totalTime(0.0)
+  {
+    // no code
+  }
+
+  /**
+   * Return the number of tiles rendered per second (elapsed time)
+   */
+  double MetaTileRenderer::LevelStatistics::GetTilesPerSecond() const
+  {
+    if (totalTime<=0.0) {
+      return 0.0;
+    }
+
+    return tileCount/totalTime;
+  }
+
+  MetaTileRenderer::MetaTileRenderer(const MapServiceRef& mapService,
+                                     const StyleConfigRef& styleConfig)
+  : mapService(mapService),
+    styleConfig(styleConfig),
+    metaTileSize(4),
+    tileWidth(256),
+    tileHeight(256),
+    dpi(96.0),
+    ringSize(1),
+    threadCount(0)
+  {
+    // Fadings and skipped labels outside of the visible area would result in
+    // differences at the borders of meta tiles
+    parameter.SetDrawFadings(false);
+    parameter.SetDropNotVisiblePointLabels(false);
+  }
+
+  void MetaTileRenderer::SetMapParameter(const MapParameter& parameter)
+  {
+    this->parameter=parameter;
+  }
+
+  void MetaTileRenderer::SetAreaSearchParameter(const AreaSearchParameter& searchParameter)
+  {
+    this->searchParameter=searchParameter;
+  }
+
+  /**
+   * Set the number of tiles in each direction of a meta tile. A value of 1
+   * renders every tile on its own.
+   */
+  void MetaTileRenderer::SetMetaTileSize(size_t metaTileSize)
+  {
+    this->metaTileSize=std::max(metaTileSize,(size_t)1);
+  }
+
+  void MetaTileRenderer::SetTileSize(size_t tileWidth,
+                                     size_t tileHeight)
+  {
+    this->tileWidth=tileWidth;
+    this->tileHeight=tileHeight;
+  }
+
+  void MetaTileRenderer::SetDPI(double dpi)
+  {
+    this->dpi=dpi;
+  }
+
+  /**
+   * Set the number of tiles around a meta tile, for which labels are loaded, too.
+   */
+  void MetaTileRenderer::SetRingSize(size_t ringSize)
+  {
+    this->ringSize=ringSize;
+  }
+
+  /**
+   * Set the number of worker threads drawing meta tiles. A value of 0 uses
+   * one thread per hardware thread.
+   */
+  void MetaTileRenderer::SetThreadCount(size_t threadCount)
+  {
+    this->threadCount=threadCount;
+  }
+
+  /**
+   * Return the meta tiles covering the given tile box. Meta tiles are aligned
+   * to multiples of the meta tile size (so that the same tile is always part of
+   * the same meta tile, independent of the requested area) and clipped to the
+   * given tile box.
+   */
+  std::vector<OSMTileIdBox> MetaTileRenderer::GetMetaTiles(const Magnification& magnification,
+                                                           const OSMTileIdBox& tileBox) const
+  {
+    std::vector<OSMTileIdBox> metaTiles;
+    uint32_t                  size=(uint32_t)metaTileSize;
+    uint32_t                  maxTile=(uint32_t)(magnification.GetMagnification()-1);
+    uint32_t                  xStart=tileBox.GetMinX()/size*size;
+    uint32_t                  yStart=tileBox.GetMinY()/size*size;
+    uint32_t                  xEnd=std::min(tileBox.GetMaxX(),maxTile);
+    uint32_t                  yEnd=std::min(tileBox.GetMaxY(),maxTile);
+
+    for (uint32_t y=yStart; y<=yEnd; y+=size) {
+      for (uint32_t x=xStart; x<=xEnd; x+=size) {
+        metaTiles.push_back(OSMTileIdBox(OSMTileId(std::max(x,tileBox.GetMinX()),
+                                                   std::max(y,tileBox.GetMinY())),
+                                         OSMTileId(std::min(x+size-1,xEnd),
+                                                   std::min(y+size-1,yEnd))));
+      }
+    }
+
+    return metaTiles;
+  }
+
+  /**
+   * Return the types of nodes and areas, that might have labels at the given
+   * magnification
+   */
+  MapService::TypeDefinition MetaTileRenderer::GetLabelTypeDefinition(const Magnification& magnification) const
+  {
+    MapService::TypeDefinition typeDefinition;
+
+    for (const auto& type : styleConfig->GetTypeConfig()->GetTypes()) {
+      if (type->CanBeNode() &&
+          styleConfig->HasNodeTextStyles(type,
+                                         magnification)) {
+        typeDefinition.nodeTypes.Set(type);
+      }
+
+      if (type->CanBeArea() &&
+          styleConfig->HasAreaTextStyles(type,
+                                         magnification)) {
+        if (type->GetOptimizeLowZoom() &&
+            searchParameter.GetUseLowZoomOptimization()) {
+          typeDefinition.optimizedAreaTypes.Set(type);
+        }
+        else {
+          typeDefinition.areaTypes.Set(type);
+        }
+      }
+    }
+
+    return typeDefinition;
+  }
+
+  /**
+   * Load all data of the meta tile and the labeled objects of the ring around it
+   */
+  bool MetaTileRenderer::LoadMetaTileData(const Magnification& magnification,
+                                          const OSMTileIdBox& metaTile,
+                                          const MapService::TypeDefinition& ringTypeDefinition,
+                                          const Projection& projection,
+                                          MapData& data) const
+  {
+    std::list<TileRef> centerTiles;
+
+    mapService->LookupTiles(magnification,
+                            metaTile.GetBoundingBox(magnification),
+                            centerTiles);
+
+    if (!mapService->LoadMissingTileData(searchParameter,
+                                         *styleConfig,
+                                         centerTiles)) {
+      return false;
+    }
+
+    std::list<TileRef> ringTiles;
+
+    if (ringSize>0) {
+      uint32_t     ring=(uint32_t)ringSize;
+      uint32_t     maxTile=(uint32_t)(magnification.GetMagnification()-1);
+      OSMTileIdBox ringBox(OSMTileId(metaTile.GetMinX()-std::min(metaTile.GetMinX(),ring),
+                                     metaTile.GetMinY()-std::min(metaTile.GetMinY(),ring)),
+                           OSMTileId(std::min(metaTile.GetMaxX()+ring,maxTile),
+                                     std::min(metaTile.GetMaxY()+ring,maxTile)));
+      std::list<TileRef> tiles;
+      std::set<TileId>   centerTileIds;
+
+      mapService->LookupTiles(magnification,
+                              ringBox.GetBoundingBox(magnification),
+                              tiles);
+
+      for (const auto& tile : centerTiles) {
+        centerTileIds.insert(tile->GetId());
+      }
+
+      for (const auto& tile : tiles) {
+        if (centerTileIds.find(tile->GetId())==centerTileIds.end()) {
+          ringTiles.push_back(tile);
+        }
+      }
+
+      if (!mapService->LoadMissingTileData(searchParameter,
+                                           magnification,
+                                           ringTypeDefinition,
+                                           ringTiles)) {
+        return false;
+      }
+    }
+
+    MergeTilesToMapData(centerTiles,
+                        ringTypeDefinition,
+                        ringTiles,
+                        data);
+
+    return mapService->GetGroundTiles(projection,
+                                      data.groundTiles);
+  }
+
+  /**
+   * Append the objects of the map to the vector, ordered by file offset. The order
+   * of the objects in the data tiles depends on the order in which they were loaded
+   * (by which worker, for the center or a ring), while the drawing order of objects
+   * with the same style priority depends on the order in the MapData. Sorting makes
+   * tiles independent of the state of the cache.
+   */
+  template<class T>
+  static void CopySorted(const std::unordered_map<FileOffset,T>& objectMap,
+                         std::vector<T>& objects)
+  {
+    size_t start=objects.size();
+
+    for (const auto& entry : objectMap) {
+      objects.push_back(entry.second);
+    }
+
+    std::sort(objects.begin()+start,
+              objects.end(),
+              [](const T& a,
+                 const T& b) {
+      return a->GetFileOffset()<b->GetFileOffset();
+    });
+  }
+
+  /**
+   * Copy all objects of the center tiles and the objects of the ring tiles
+   * matching the given type definition to the MapData, removing duplicates
+   */
+  void MetaTileRenderer::MergeTilesToMapData(const std::list<TileRef>& centerTiles,
+                                             const MapService::TypeDefinition& ringTypeDefinition,
+                                             const std::list<TileRef>& ringTiles,
+                                             MapData& data) const
+  {
+    std::unordered_map<FileOffset,NodeRef> nodeMap(10000);
+    std::unordered_map<FileOffset,WayRef>  wayMap(10000);
+    std::unordered_map<FileOffset,AreaRef> areaMap(10000);
+    std::unordered_map<FileOffset,WayRef>  optimizedWayMap(10000);
+    std::unordered_map<FileOffset,AreaRef> optimizedAreaMap(10000);
+
+    for (const auto& tile : centerTiles) {
+      tile->GetNodeData().CopyData([&nodeMap](const NodeRef& node) {
+        nodeMap[node->GetFileOffset()]=node;
+      });
+
+      tile->GetOptimizedWayData().CopyData([&optimizedWayMap](const WayRef& way) {
+        optimizedWayMap[way->GetFileOffset()]=way;
+      });
+
+      tile->GetWayData().CopyData([&wayMap](const WayRef& way) {
+        wayMap[way->GetFileOffset()]=way;
+      });
+
+      tile->GetOptimizedAreaData().CopyData([&optimizedAreaMap](const AreaRef& area) {
+        optimizedAreaMap[area->GetFileOffset()]=area;
+      });
+
+      tile->GetAreaData().CopyData([&areaMap](const AreaRef& area) {
+        areaMap[area->GetFileOffset()]=area;
+      });
+    }
+
+    for (const auto& tile : ringTiles) {
+      tile->GetNodeData().CopyData([&ringTypeDefinition,&nodeMap](const NodeRef& node) {
+        if (ringTypeDefinition.nodeTypes.IsSet(node->GetType())) {
+          nodeMap[node->GetFileOffset()]=node;
+        }
+      });
+
+      tile->GetOptimizedWayData().CopyData([&ringTypeDefinition,&optimizedWayMap](const WayRef& way) {
+        if (ringTypeDefinition.optimizedWayTypes.IsSet(way->GetType())) {
+          optimizedWayMap[way->GetFileOffset()]=way;
+        }
+      });
+
+      tile->GetWayData().CopyData([&ringTypeDefinition,&wayMap](const WayRef& way) {
+        if (ringTypeDefinition.wayTypes.IsSet(way->GetType())) {
+          wayMap[way->GetFileOffset()]=way;
+        }
+      });
+
+      tile->GetOptimizedAreaData().CopyData([&ringTypeDefinition,&optimizedAreaMap](const AreaRef& area) {
+        if (ringTypeDefinition.optimizedAreaTypes.IsSet(area->GetType())) {
+          optimizedAreaMap[area->GetFileOffset()]=area;
+        }
+      });
+
+      tile->GetAreaData().CopyData([&ringTypeDefinition,&areaMap](const AreaRef& area) {
+        if (ringTypeDefinition.areaTypes.IsSet(area->GetType())) {
+          areaMap[area->GetFileOffset()]=area;
+        }
+      });
+    }
+
+    data.nodes.reserve(nodeMap.size());
+    data.ways.reserve(wayMap.size()+optimizedWayMap.size());
+    data.areas.reserve(areaMap.size()+optimizedAreaMap.size());
+
+    CopySorted(nodeMap,
+               data.nodes);
+    CopySorted(wayMap,
+               data.ways);
+    CopySorted(optimizedWayMap,
+               data.ways);
+    CopySorted(areaMap,
+               data.areas);
+    CopySorted(optimizedAreaMap,
+               data.areas);
+  }
+
+  /**
+   * Render all tiles of the given tile box at the given magnification. Every worker
+   * thread requests its own canvas from the given factory. Rendering stops at the
+   * first error.
+   *
+   * @param magnification
+   *    Magnification (zoom level) of the tiles
+   * @param tileBox
+   *    Tiles to render
+   * @param canvasFactory
+   *    Factory for the canvas of a worker thread
+   * @param statistics
+   *    Statistics of the rendering
+   * @return
+   *    False, if there was an error, else true.
+   */
+  bool MetaTileRenderer::RenderLevel(const Magnification& magnification,
+                                     const OSMTileIdBox& tileBox,
+                                     const CanvasFactory& canvasFactory,
+                                     LevelStatistics& statistics) const
+  {
+    StopClock                       totalTimer;
+    std::vector<OSMTileIdBox>       metaTiles=GetMetaTiles(magnification,
+                                                           tileBox);
+    MapService::TypeDefinition      ringTypeDefinition=GetLabelTypeDefinition(magnification);
+    size_t                          workerCount=threadCount;
+    std::atomic<size_t>             nextMetaTile(0);
+    std::atomic<bool>               success(true);
+    std::mutex                      statisticsMutex;
+
+    if (workerCount==0) {
+      workerCount=std::max(std::thread::hardware_concurrency(),1u);
+    }
+
+    workerCount=std::max(std::min(workerCount,metaTiles.size()),(size_t)1);
+
+    statistics=LevelStatistics();
+    statistics.level=magnification.GetLevel();
+
+    auto worker=[&]() {
+      MetaTileCanvasRef canvas=canvasFactory();
+      size_t            metaTileCount=0;
+      size_t            tileCount=0;
+      double            dataTime=0.0;
+      double            drawTime=0.0;
+
+      if (!canvas) {
+        log.Error() << "Cannot create canvas for meta tiles";
+        success=false;
+        return;
+      }
+
+      for (size_t i=nextMetaTile++; i<metaTiles.size() && success; i=nextMetaTile++) {
+        const OSMTileIdBox& metaTile=metaTiles[i];
+        TileProjection      projection;
+        MapData             data;
+        StopClock           dataTimer;
+
+        if (!projection.Set(metaTile,
+                            magnification,
+                            dpi,
+                            tileWidth*metaTile.GetWidth(),
+                            tileHeight*metaTile.GetHeight())) {
+          log.Error() << "Cannot set projection for meta tile " << metaTile.GetDisplayText();
+          success=false;
+          break;
+        }
+
+        if (!LoadMetaTileData(magnification,
+                              metaTile,
+                              ringTypeDefinition,
+                              projection,
+                              data)) {
+          log.Error() << "Cannot load data for meta tile " << metaTile.GetDisplayText();
+          success=false;
+          break;
+        }
+
+        dataTimer.Stop();
+        dataTime+=dataTimer.GetMilliseconds()/1000.0;
+
+        StopClock drawTimer;
+
+        if (!canvas->DrawMetaTile(projection,
+                                  parameter,
+                                  data)) {
+          log.Error() << "Cannot draw meta tile " << metaTile.GetDisplayText();
+          success=false;
+          break;
+        }
+
+        for (uint32_t y=metaTile.GetMinY(); y<=metaTile.GetMaxY() && success; y++) {
+          for (uint32_t x=metaTile.GetMinX(); x<=metaTile.GetMaxX(); x++) {
+            OSMTileId tile(x,y);
+
+            if (!canvas->StoreTile(tile,
+                                   magnification,
+                                   (x-metaTile.GetMinX())*tileWidth,
+                                   (y-metaTile.GetMinY())*tileHeight,
+                                   tileWidth,
+                                   tileHeight)) {
+              log.Error() << "Cannot store tile " << tile.GetDisplayText();
+              success=false;
+              break;
+            }
+
+            tileCount++;
+          }
+        }
+
+        if (!success) {
+          break;
+        }
+
+        drawTimer.Stop();
+        drawTime+=drawTimer.GetMilliseconds()/1000.0;
+
+        metaTileCount++;
+      }
+
+      std::lock_guard<std::mutex> guard(statisticsMutex);
+
+      statistics.metaTileCount+=metaTileCount;
+      statistics.tileCount+=tileCount;
+      statistics.dataTime+=dataTime;
+      statistics.drawTime+=drawTime;
+    };
+
+    std::vector<std::thread> threads;
+
+    for (size_t t=1; t<workerCount; t++) {
+      threads.push_back(std::thread(worker));
+    }
+
+    worker();
+
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    totalTimer.Stop();
+
+    statistics.totalTime=totalTimer.GetMilliseconds()/1000.0;
+
+    return success;
+  }
+}
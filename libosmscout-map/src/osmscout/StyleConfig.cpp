@@ -21,6 +21,8 @@
 
 #include <string.h>
 
+#include <algorithm>
+#include <functional>
 #include <set>
 
 #include <sstream>
@@ -56,6 +58,29 @@ namespace osmscout {
     }
   }
 
+  /**
+   * Return a bit mask with bit n set, if the feature of feature reader n is set
+   * for the given object. Returns false, if there are too many feature readers
+   * to fit into the mask.
+   */
+  bool StyleResolveContext::GetFeatureMask(const FeatureValueBuffer& buffer,
+                                           uint64_t& featureMask) const
+  {
+    if (featureReaders.size()>64) {
+      return false;
+    }
+
+    featureMask=0;
+
+    for (size_t index=0; index<featureReaders.size(); index++) {
+      if (featureReaders[index].IsSet(buffer)) {
+        featureMask|=((uint64_t)1) << index;
+      }
+    }
+
+    return true;
+  }
+
   size_t StyleResolveContext::GetFeatureReaderIndex(const Feature& feature)
   {
     auto entry=featureReaderMap.find(feature.GetName());
@@ -73,6 +98,18 @@ namespace osmscout {
     return index;
   }
 
+  size_t StyleCacheKeyHasher::operator()(const StyleCacheKey& key) const
+  {
+    size_t hash=std::hash<size_t>()(key.type);
+
+    hash=hash*31+std::hash<size_t>()(key.level);
+    hash=hash*31+std::hash<uint64_t>()(key.features);
+    hash=hash*31+std::hash<uint64_t>()(key.sizeConditions);
+    hash=hash*31+(key.oneway ? 1 : 0);
+
+    return hash;
+  }
+
   StyleConstant::StyleConstant()
   {
     // no code
@@ -704,9 +741,11 @@ namespace osmscout {
 
   BorderStyle::BorderStyle()
     : color(1.0,0.0,0.0,0.0),
+      gapColor(1.0,0.0,0.0,0.0),
       width(0.0),
       displayOffset(0.0),
-      offset(0.0)
+      offset(0.0),
+      priority(0)
   {
     // no code
   }
@@ -719,10 +758,16 @@ namespace osmscout {
   }
 
   BorderStyle::BorderStyle(const BorderStyle& style)
+  : slot(style.slot),
+    color(style.color),
+    gapColor(style.gapColor),
+    width(style.width),
+    dash(style.dash),
+    displayOffset(style.displayOffset),
+    offset(style.offset),
+    priority(style.priority)
   {
-    this->color=style.color;
-    this->width=style.width;
-    this->dash=style.dash;
+    // no code
   }
 
   void BorderStyle::SetColorValue(int attribute, const Color& value)
@@ -2166,8 +2211,26 @@ namespace osmscout {
     log.Debug() << "StyleConfig::~StyleConfig()";
   }
 
+  void StyleConfig::ClearStyleCaches()
+  {
+    nodeTextStyleCache.Clear();
+    nodeIconStyleCache.Clear();
+    wayLineStyleCache.Clear();
+    wayPathTextStyleCache.Clear();
+    wayPathSymbolStyleCache.Clear();
+    wayPathShieldStyleCache.Clear();
+    areaFillStyleCache.Clear();
+    areaBorderStyleCache.Clear();
+    areaTextStyleCache.Clear();
+    areaIconStyleCache.Clear();
+    areaBorderTextStyleCache.Clear();
+    areaBorderSymbolStyleCache.Clear();
+  }
+
   void StyleConfig::Reset()
   {
+    ClearStyleCaches();
+
     symbols.clear();
     emptySymbol=NULL;
 
@@ -2203,6 +2266,8 @@ namespace osmscout {
     areaBorderSymbolStyleSelectors.clear();
     areaTypeSets.clear();
 
+    typeSizeConditions.clear();
+
     constants.clear();
   }
 
@@ -2745,6 +2810,66 @@ namespace osmscout {
     }
   }
 
+  /**
+   * Add the distinct size conditions of the given selectors to the size
+   * conditions of their type
+   */
+  template <class S, class A>
+  static void CollectSizeConditions(const std::vector<std::vector<std::list<StyleSelector<S,A> > > >& styleSelectors,
+                                    std::vector<std::vector<SizeConditionRef>>& typeSizeConditions)
+  {
+    for (size_t type=0; type<styleSelectors.size() && type<typeSizeConditions.size(); type++) {
+      std::vector<SizeConditionRef>& sizeConditions=typeSizeConditions[type];
+
+      for (const auto& levelSelectors : styleSelectors[type]) {
+        for (const auto& selector : levelSelectors) {
+          const SizeConditionRef& sizeCondition=selector.criteria.GetSizeCondition();
+
+          if (sizeCondition &&
+              std::find(sizeConditions.begin(),
+                        sizeConditions.end(),
+                        sizeCondition)==sizeConditions.end()) {
+            sizeConditions.push_back(sizeCondition);
+          }
+        }
+      }
+    }
+  }
+
+  void StyleConfig::PostprocessSizeConditions()
+  {
+    typeSizeConditions.clear();
+    typeSizeConditions.resize(typeConfig->GetTypeCount());
+
+    for (const auto& selectors : nodeTextStyleSelectors) {
+      CollectSizeConditions(selectors,typeSizeConditions);
+    }
+
+    CollectSizeConditions(nodeIconStyleSelectors,typeSizeConditions);
+
+    for (const auto& selectors : wayLineStyleSelectors) {
+      CollectSizeConditions(selectors,typeSizeConditions);
+    }
+
+    CollectSizeConditions(wayPathTextStyleSelectors,typeSizeConditions);
+    CollectSizeConditions(wayPathSymbolStyleSelectors,typeSizeConditions);
+    CollectSizeConditions(wayPathShieldStyleSelectors,typeSizeConditions);
+
+    CollectSizeConditions(areaFillStyleSelectors,typeSizeConditions);
+
+    for (const auto& selectors : areaBorderStyleSelectors) {
+      CollectSizeConditions(selectors,typeSizeConditions);
+    }
+
+    for (const auto& selectors : areaTextStyleSelectors) {
+      CollectSizeConditions(selectors,typeSizeConditions);
+    }
+
+    CollectSizeConditions(areaIconStyleSelectors,typeSizeConditions);
+    CollectSizeConditions(areaBorderTextStyleSelectors,typeSizeConditions);
+    CollectSizeConditions(areaBorderSymbolStyleSelectors,typeSizeConditions);
+  }
+
   void StyleConfig::Postprocess()
   {
     PostprocessNodes();
@@ -2753,6 +2878,9 @@ namespace osmscout {
 
     PostprocessIconId();
     PostprocessPatternId();
+    PostprocessSizeConditions();
+
+    ClearStyleCaches();
   }
 
   TypeConfigRef StyleConfig::GetTypeConfig() const
@@ -2952,6 +3080,80 @@ namespace osmscout {
     }
   }
 
+  /**
+   * Resolve the style of each slot and return the visible ones
+   */
+  template <class S, class A>
+  void GetFeatureStyles(const StyleResolveContext& context,
+                        const std::vector<std::vector<std::vector<std::list<StyleSelector<S,A> > > > >& styleSelectors,
+                        const TypeInfoRef& type,
+                        const FeatureValueBuffer& buffer,
+                        const Projection& projection,
+                        std::vector<std::shared_ptr<S>>& styles)
+  {
+    std::shared_ptr<S> style;
+
+    styles.clear();
+    styles.reserve(styleSelectors.size());
+
+    for (const auto& slotSelectors : styleSelectors) {
+      GetFeatureStyle(context,
+                      slotSelectors[type->GetIndex()],
+                      buffer,
+                      projection,
+                      style);
+
+      if (style) {
+        styles.push_back(style);
+      }
+    }
+  }
+
+  /**
+   * Return the key of the given object for the style caches. The result of the
+   * evaluation of the style criteria only depends on the values of the key.
+   * Returns false, if the object cannot be cached.
+   *
+   * The projection is only part of the key by the evaluation of the size
+   * conditions of the type, so zooming and panning does not create new cache
+   * entries unless a size condition changes its result.
+   */
+  bool StyleConfig::GetStyleCacheKey(const TypeInfoRef& type,
+                                     const FeatureValueBuffer& buffer,
+                                     const Projection& projection,
+                                     StyleCacheKey& key) const
+  {
+    if (!styleResolveContext.GetFeatureMask(buffer,
+                                            key.features)) {
+      return false;
+    }
+
+    if (type->GetIndex()>=typeSizeConditions.size()) {
+      return false;
+    }
+
+    const std::vector<SizeConditionRef>& sizeConditions=typeSizeConditions[type->GetIndex()];
+
+    if (sizeConditions.size()>64) {
+      return false;
+    }
+
+    key.sizeConditions=0;
+
+    for (size_t index=0; index<sizeConditions.size(); index++) {
+      if (sizeConditions[index]->Evaluate(projection.GetMeterInPixel(),
+                                          projection.GetMeterInMM())) {
+        key.sizeConditions|=((uint64_t)1) << index;
+      }
+    }
+
+    key.type=type->GetIndex();
+    key.level=projection.GetMagnification().GetLevel();
+    key.oneway=styleResolveContext.IsOneway(buffer);
+
+    return true;
+  }
+
   bool StyleConfig::HasNodeTextStyles(const TypeInfoRef& type,
                                       const Magnification& magnification) const
   {
@@ -2974,92 +3176,110 @@ namespace osmscout {
                                       const Projection& projection,
                                       std::vector<TextStyleRef>& textStyles) const
   {
-    TextStyleRef style;
-
-    textStyles.clear();
-    textStyles.reserve(nodeTextStyleSelectors.size());
-
-    for (size_t slot=0; slot<nodeTextStyleSelectors.size(); slot++) {
-      style=NULL;
-
-      GetFeatureStyle(styleResolveContext,
-                      nodeTextStyleSelectors[slot][buffer.GetType()->GetIndex()],
-                      buffer,
-                      projection,
-                      style);
-
-      if (style) {
-        textStyles.push_back(style);
-      }
-    }
+    GetCachedStyle(nodeTextStyleCache,
+                   buffer.GetType(),
+                   buffer,
+                   projection,
+                   textStyles,
+                   [this,&buffer,&projection](std::vector<TextStyleRef>& styles) {
+                     GetFeatureStyles(styleResolveContext,
+                                      nodeTextStyleSelectors,
+                                      buffer.GetType(),
+                                      buffer,
+                                      projection,
+                                      styles);
+                   });
   }
 
   void StyleConfig::GetNodeIconStyle(const FeatureValueBuffer& buffer,
                                      const Projection& projection,
                                      IconStyleRef& iconStyle) const
   {
-    GetFeatureStyle(styleResolveContext,
-                    nodeIconStyleSelectors[buffer.GetType()->GetIndex()],
-                    buffer,
-                    projection,
-                    iconStyle);
+    GetCachedStyle(nodeIconStyleCache,
+                   buffer.GetType(),
+                   buffer,
+                   projection,
+                   iconStyle,
+                   [this,&buffer,&projection](IconStyleRef& style) {
+                     GetFeatureStyle(styleResolveContext,
+                                     nodeIconStyleSelectors[buffer.GetType()->GetIndex()],
+                                     buffer,
+                                     projection,
+                                     style);
+                   });
   }
 
   void StyleConfig::GetWayLineStyles(const FeatureValueBuffer& buffer,
                                      const Projection& projection,
                                      std::vector<LineStyleRef>& lineStyles) const
   {
-    LineStyleRef style;
-
-    lineStyles.clear();
-    lineStyles.reserve(wayLineStyleSelectors.size());
-
-    for (size_t slot=0; slot<wayLineStyleSelectors.size(); slot++) {
-      style=NULL;
-
-      GetFeatureStyle(styleResolveContext,
-                      wayLineStyleSelectors[slot][buffer.GetType()->GetIndex()],
-                      buffer,
-                      projection,
-                      style);
-
-      if (style) {
-        lineStyles.push_back(style);
-      }
-    }
+    GetCachedStyle(wayLineStyleCache,
+                   buffer.GetType(),
+                   buffer,
+                   projection,
+                   lineStyles,
+                   [this,&buffer,&projection](std::vector<LineStyleRef>& styles) {
+                     GetFeatureStyles(styleResolveContext,
+                                      wayLineStyleSelectors,
+                                      buffer.GetType(),
+                                      buffer,
+                                      projection,
+                                      styles);
+                   });
   }
 
   void StyleConfig::GetWayPathTextStyle(const FeatureValueBuffer& buffer,
                                         const Projection& projection,
                                         PathTextStyleRef& pathTextStyle) const
   {
-    GetFeatureStyle(styleResolveContext,
-                    wayPathTextStyleSelectors[buffer.GetType()->GetIndex()],
-                    buffer,
-                    projection,
-                    pathTextStyle);
+    GetCachedStyle(wayPathTextStyleCache,
+                   buffer.GetType(),
+                   buffer,
+                   projection,
+                   pathTextStyle,
+                   [this,&buffer,&projection](PathTextStyleRef& style) {
+                     GetFeatureStyle(styleResolveContext,
+                                     wayPathTextStyleSelectors[buffer.GetType()->GetIndex()],
+                                     buffer,
+                                     projection,
+                                     style);
+                   });
   }
 
   void StyleConfig::GetWayPathSymbolStyle(const FeatureValueBuffer& buffer,
                                           const Projection& projection,
                                           PathSymbolStyleRef& pathSymbolStyle) const
   {
-    GetFeatureStyle(styleResolveContext,
-                    wayPathSymbolStyleSelectors[buffer.GetType()->GetIndex()],
-                    buffer,
-                    projection,
-                    pathSymbolStyle);
+    GetCachedStyle(wayPathSymbolStyleCache,
+                   buffer.GetType(),
+                   buffer,
+                   projection,
+                   pathSymbolStyle,
+                   [this,&buffer,&projection](PathSymbolStyleRef& style) {
+                     GetFeatureStyle(styleResolveContext,
+                                     wayPathSymbolStyleSelectors[buffer.GetType()->GetIndex()],
+                                     buffer,
+                                     projection,
+                                     style);
+                   });
   }
 
   void StyleConfig::GetWayPathShieldStyle(const FeatureValueBuffer& buffer,
                                           const Projection& projection,
                                           PathShieldStyleRef& pathShieldStyle) const
   {
-    GetFeatureStyle(styleResolveContext,
-                    wayPathShieldStyleSelectors[buffer.GetType()->GetIndex()],
-                    buffer,
-                    projection,
-                    pathShieldStyle);
+    GetCachedStyle(wayPathShieldStyleCache,
+                   buffer.GetType(),
+                   buffer,
+                   projection,
+                   pathShieldStyle,
+                   [this,&buffer,&projection](PathShieldStyleRef& style) {
+                     GetFeatureStyle(styleResolveContext,
+                                     wayPathShieldStyleSelectors[buffer.GetType()->GetIndex()],
+                                     buffer,
+                                     projection,
+                                     style);
+                   });
   }
 
   void StyleConfig::GetAreaFillStyle(const TypeInfoRef& type,
@@ -3067,11 +3287,18 @@ namespace osmscout {
                                      const Projection& projection,
                                      FillStyleRef& fillStyle) const
   {
-    GetFeatureStyle(styleResolveContext,
-                    areaFillStyleSelectors[type->GetIndex()],
-                    buffer,
-                    projection,
-                    fillStyle);
+    GetCachedStyle(areaFillStyleCache,
+                   type,
+                   buffer,
+                   projection,
+                   fillStyle,
+                   [this,&buffer,&projection,&type](FillStyleRef& style) {
+                     GetFeatureStyle(styleResolveContext,
+                                     areaFillStyleSelectors[type->GetIndex()],
+                                     buffer,
+                                     projection,
+                                     style);
+                   });
   }
 
   void StyleConfig::GetAreaBorderStyles(const TypeInfoRef& type,
@@ -3079,24 +3306,19 @@ namespace osmscout {
                                         const Projection& projection,
                                         std::vector<BorderStyleRef>& borderStyles) const
   {
-    BorderStyleRef style;
-
-    borderStyles.clear();
-    borderStyles.reserve(areaBorderStyleSelectors.size());
-
-    for (size_t slot=0; slot<areaBorderStyleSelectors.size(); slot++) {
-      style=NULL;
-
-      GetFeatureStyle(styleResolveContext,
-                      areaBorderStyleSelectors[slot][type->GetIndex()],
-                      buffer,
-                      projection,
-                      style);
-
-      if (style) {
-        borderStyles.push_back(style);
-      }
-    }
+    GetCachedStyle(areaBorderStyleCache,
+                   type,
+                   buffer,
+                   projection,
+                   borderStyles,
+                   [this,&buffer,&projection,&type](std::vector<BorderStyleRef>& styles) {
+                     GetFeatureStyles(styleResolveContext,
+                                      areaBorderStyleSelectors,
+                                      type,
+                                      buffer,
+                                      projection,
+                                      styles);
+                   });
   }
 
   bool StyleConfig::HasAreaTextStyles(const TypeInfoRef& type,
@@ -3122,24 +3344,19 @@ namespace osmscout {
                                       const Projection& projection,
                                       std::vector<TextStyleRef>& textStyles) const
   {
-    TextStyleRef style;
-
-    textStyles.clear();
-    textStyles.reserve(areaTextStyleSelectors.size());
-
-    for (size_t slot=0; slot<areaTextStyleSelectors.size(); slot++) {
-      style=NULL;
-
-      GetFeatureStyle(styleResolveContext,
-                      areaTextStyleSelectors[slot][type->GetIndex()],
-                      buffer,
-                      projection,
-                      style);
-
-      if (style) {
-        textStyles.push_back(style);
-      }
-    }
+    GetCachedStyle(areaTextStyleCache,
+                   type,
+                   buffer,
+                   projection,
+                   textStyles,
+                   [this,&buffer,&projection,&type](std::vector<TextStyleRef>& styles) {
+                     GetFeatureStyles(styleResolveContext,
+                                      areaTextStyleSelectors,
+                                      type,
+                                      buffer,
+                                      projection,
+                                      styles);
+                   });
   }
 
   void StyleConfig::GetAreaIconStyle(const TypeInfoRef& type,
@@ -3147,11 +3364,18 @@ namespace osmscout {
                                      const Projection& projection,
                                      IconStyleRef& iconStyle) const
   {
-    GetFeatureStyle(styleResolveContext,
-                    areaIconStyleSelectors[type->GetIndex()],
-                    buffer,
-                    projection,
-                    iconStyle);
+    GetCachedStyle(areaIconStyleCache,
+                   type,
+                   buffer,
+                   projection,
+                   iconStyle,
+                   [this,&buffer,&projection,&type](IconStyleRef& style) {
+                     GetFeatureStyle(styleResolveContext,
+                                     areaIconStyleSelectors[type->GetIndex()],
+                                     buffer,
+                                     projection,
+                                     style);
+                   });
   }
 
   void StyleConfig::GetAreaBorderTextStyle(const TypeInfoRef& type,
@@ -3159,11 +3383,18 @@ namespace osmscout {
                                            const Projection& projection,
                                            PathTextStyleRef& pathTextStyle) const
   {
-    GetFeatureStyle(styleResolveContext,
-                    areaBorderTextStyleSelectors[type->GetIndex()],
-                    buffer,
-                    projection,
-                    pathTextStyle);
+    GetCachedStyle(areaBorderTextStyleCache,
+                   type,
+                   buffer,
+                   projection,
+                   pathTextStyle,
+                   [this,&buffer,&projection,&type](PathTextStyleRef& style) {
+                     GetFeatureStyle(styleResolveContext,
+                                     areaBorderTextStyleSelectors[type->GetIndex()],
+                                     buffer,
+                                     projection,
+                                     style);
+                   });
   }
 
   void StyleConfig::GetAreaBorderSymbolStyle(const TypeInfoRef& type,
@@ -3171,11 +3402,18 @@ namespace osmscout {
                                              const Projection& projection,
                                              PathSymbolStyleRef& pathSymbolStyle) const
   {
-    GetFeatureStyle(styleResolveContext,
-                    areaBorderSymbolStyleSelectors[type->GetIndex()],
-                    buffer,
-                    projection,
-                    pathSymbolStyle);
+    GetCachedStyle(areaBorderSymbolStyleCache,
+                   type,
+                   buffer,
+                   projection,
+                   pathSymbolStyle,
+                   [this,&buffer,&projection,&type](PathSymbolStyleRef& style) {
+                     GetFeatureStyle(styleResolveContext,
+                                     areaBorderSymbolStyleSelectors[type->GetIndex()],
+                                     buffer,
+                                     projection,
+                                     style);
+                   });
   }
 
   void StyleConfig::GetLandFillStyle(const Projection& projection,
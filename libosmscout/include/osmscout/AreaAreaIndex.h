@@ -27,6 +27,7 @@
 #include <osmscout/DataFile.h>
 
 #include <osmscout/util/Cache.h>
+#include <osmscout/util/CacheManager.h>
 #include <osmscout/util/Geometry.h>
 #include <osmscout/util/FileScanner.h>
 
@@ -45,8 +46,10 @@ namespace osmscout {
 
     Internally the index is implemented as quadtree. As a result each index entry
     has 4 children (besides entries in the lowest level).
+
+    The cache of index cells can be registered with a CacheManager.
     */
-  class OSMSCOUT_API AreaAreaIndex
+  class OSMSCOUT_API AreaAreaIndex : private CacheManager::Client
   {
   public:
     static const char* AREA_AREA_IDX;
@@ -100,10 +103,13 @@ namespace osmscout {
     FileOffset            topLevelOffset; //!< File offset of the top level index entry
 
     mutable IndexCache    indexCache;     //!< Cached map of all index entries by file offset
+    CacheManagerRef       cacheManager;   //!< Optional cache manager
 
     mutable std::mutex    lookupMutex;
 
   private:
+    size_t TrimCache(size_t memory) override;
+
     bool GetIndexCell(uint32_t level,
                       FileOffset offset,
                       IndexCell& indexCell,
@@ -128,6 +134,8 @@ namespace osmscout {
     AreaAreaIndex(size_t cacheSize);
     virtual ~AreaAreaIndex();
 
+    void SetCacheManager(const CacheManagerRef& cacheManager);
+
     void Close();
     bool Open(const std::string& path);
 
@@ -37,7 +37,8 @@ namespace osmscout {
     static const char* AREAS_IDMAP;
 
   public:
-    AreaDataFile(size_t cacheSize);
+    AreaDataFile(size_t cacheSize,
+                 size_t cacheMemory=0);
   };
 
   typedef std::shared_ptr<AreaDataFile> AreaDataFileRef;
@@ -26,6 +26,8 @@
 
 #include <osmscout/TypeConfig.h>
 
+#include <osmscout/util/Cache.h>
+#include <osmscout/util/CacheManager.h>
 #include <osmscout/util/FileScanner.h>
 
 namespace osmscout {
@@ -37,8 +39,11 @@ namespace osmscout {
     a given area.
 
     Ways can be limited by type and result count.
+
+    The object offsets of recently read index cells are cached. The cache is limited
+    by memory and can be registered with a CacheManager.
     */
-  class OSMSCOUT_API AreaNodeIndex
+  class OSMSCOUT_API AreaNodeIndex : private CacheManager::Client
   {
   public:
     static const char* AREA_NODE_IDX;
@@ -72,21 +77,39 @@ namespace osmscout {
       FileOffset GetCellOffset(size_t x, size_t y) const;
     };
 
+    typedef Cache<FileOffset,std::vector<FileOffset>> CellCache;
+
+    struct CellCacheValueSizer : public CellCache::ValueSizer
+    {
+      size_t GetSize(const std::vector<FileOffset>& value) const
+      {
+        return sizeof(value)+sizeof(FileOffset)*value.capacity();
+      }
+    };
+
   private:
     std::string           datafilename;   //!< Full path and name of the data file
     mutable FileScanner   scanner;        //!< Scanner instance for reading this file
 
     std::vector<TypeData> nodeTypeData;
 
+    mutable CellCache     cellCache;      //!< Object offsets of index cells by file offset of the cell data
+    CacheManagerRef       cacheManager;   //!< Optional cache manager
+
     mutable std::mutex    lookupMutex;
 
   private:
+    size_t TrimCache(size_t memory) override;
+
     bool GetOffsets(const TypeData& typeData,
                     const GeoBox& boundingBox,
                     std::vector<FileOffset>& offsets) const;
 
   public:
-    AreaNodeIndex();
+    explicit AreaNodeIndex(size_t cacheMemory);
+    virtual ~AreaNodeIndex();
+
+    void SetCacheManager(const CacheManagerRef& cacheManager);
 
     void Close();
     bool Open(const std::string& path);
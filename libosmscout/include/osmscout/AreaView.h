@@ -0,0 +1,153 @@
+#ifndef OSMSCOUT_AREAVIEW_H
+#define OSMSCOUT_AREAVIEW_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2017  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <vector>
+
+#include <osmscout/Area.h>
+#include <osmscout/ObjectRef.h>
+#include <osmscout/TypeConfig.h>
+
+#include <osmscout/util/CoordBlockView.h>
+#include <osmscout/util/FileScanner.h>
+
+#include <osmscout/system/Compiler.h>
+
+namespace osmscout {
+
+  /**
+   * \ingroup Database
+   *
+   * Read-only view onto an area as stored in 'areas.dat'.
+   *
+   * In contrast to Area the view does not decode the coordinates of the rings on read,
+   * but references the encoded coordinate deltas (see CoordBlockView). An AreaView instance
+   * is meant to be reused for reading a sequence of areas, in this case reading does not
+   * allocate heap memory beside the feature values and the growth of the internal ring list.
+   *
+   * Node serials are not available from the view.
+   */
+  class OSMSCOUT_API AreaView CLASS_FINAL
+  {
+  public:
+    class OSMSCOUT_API Ring
+    {
+    private:
+      FeatureValueBuffer featureValueBuffer; //!< List of features
+      uint8_t            ring;               //!< The ring hierarchy number (0...n)
+      CoordBlockView     coords;             //!< Encoded coordinates
+
+    public:
+      inline Ring()
+      : ring(0)
+      {
+        // no code
+      }
+
+      inline TypeInfoRef GetType() const
+      {
+        return featureValueBuffer.GetType();
+      }
+
+      inline const FeatureValueBuffer& GetFeatureValueBuffer() const
+      {
+        return featureValueBuffer;
+      }
+
+      inline bool IsMasterRing() const
+      {
+        return ring==Area::masterRingId;
+      }
+
+      inline bool IsOuterRing() const
+      {
+        return ring==Area::outerRingId;
+      }
+
+      inline uint8_t GetRing() const
+      {
+        return ring;
+      }
+
+      inline const CoordBlockView& GetCoords() const
+      {
+        return coords;
+      }
+
+      friend class AreaView;
+    };
+
+  private:
+    FileOffset        fileOffset;     //!< Offset into the data file of this area
+    FileOffset        nextFileOffset; //!< Offset after this area
+    size_t            ringCount;      //!< Number of valid entries in rings
+    std::vector<Ring> rings;          //!< Rings, entries are reused between reads
+
+  public:
+    inline AreaView()
+    : fileOffset(0),
+      nextFileOffset(0),
+      ringCount(0)
+    {
+      // no code
+    }
+
+    inline FileOffset GetFileOffset() const
+    {
+      return fileOffset;
+    }
+
+    inline FileOffset GetNextFileOffset() const
+    {
+      return nextFileOffset;
+    }
+
+    inline ObjectFileRef GetObjectFileRef() const
+    {
+      return ObjectFileRef(fileOffset,refArea);
+    }
+
+    inline TypeInfoRef GetType() const
+    {
+      return rings.front().GetType();
+    }
+
+    inline bool IsSimple() const
+    {
+      return ringCount==1;
+    }
+
+    inline size_t GetRingCount() const
+    {
+      return ringCount;
+    }
+
+    inline const Ring& GetRing(size_t idx) const
+    {
+      return rings[idx];
+    }
+
+    void Read(const TypeConfig& typeConfig,
+              FileScanner& scanner);
+  };
+}
+
+#endif
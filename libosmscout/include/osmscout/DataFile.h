@@ -20,6 +20,7 @@
   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
 */
 
+#include <algorithm>
 #include <memory>
 #include <mutex>
 #include <set>
@@ -28,7 +29,11 @@
 
 #include <osmscout/NumericIndex.h>
 
+#include <osmscout/system/Assert.h>
+
+#include <osmscout/util/BlockCompressedFile.h>
 #include <osmscout/util/Cache.h>
+#include <osmscout/util/CacheManager.h>
 #include <osmscout/util/FileScanner.h>
 #include <osmscout/util/Logger.h>
 
@@ -66,11 +71,32 @@ namespace osmscout {
    * Access to standard format data files.
    *
    * Allows to load data objects by offset using various standard library data structures.
+   *
+   * The data file is designed for concurrent read access: Each reading thread leases its own
+   * FileScanner from an internal pool (so no thread has to wait for another one to finish
+   * seeking and decoding) and the object cache is split into a number of shards, each
+   * secured by its own mutex, so that threads only contend if they access the same shard
+   * at the same time. The pool keeps at most MAX_IDLE_SCANNERS idle scanners, scanners
+   * returned to a full pool are closed, so after a burst of parallel reads the number of
+   * open file handles shrinks again.
+   *
+   * The object cache can be limited by the number of objects and by the memory
+   * used by the cached objects. The memory of an object is estimated as the size
+   * of the object itself plus the size of its encoded file record, so that large objects
+   * (e.g. coastlines with thousands of nodes) cost more than small ones.
+   *
+   * Additionally the data file can be registered with a CacheManager, that
+   * enforces a common memory budget for multiple data files and indexes.
+   *
+   * If the data file is block compressed, all scanners of the pool share one cache of
+   * inflated blocks, which is registered with the cache manager, too.
    */
   template <class N>
-  class DataFile
+  class DataFile : private CacheManager::Client
   {
   public:
+    static const size_t MAX_IDLE_SCANNERS=4; //!< Maximum number of idle scanners kept open in the pool
+
     typedef std::shared_ptr<N> ValueType;
     typedef Cache<FileOffset,std::shared_ptr<N>> ValueCache;
 
@@ -78,14 +104,72 @@ namespace osmscout {
     typedef typename Cache<FileOffset,ValueType>::CacheRef ValueCacheRef;
 
   private:
-    std::string         datafile;        //!< Basename part of the data file name
-    std::string         datafilename;    //!< complete filename for data file
+    /**
+     * Part of the object cache, secured by its own mutex
+     */
+    struct CacheShard
+    {
+      std::mutex mutex; //!< Mutex to secure multi-thread access to the cache shard
+      ValueCache cache; //!< The cache itself
+
+      CacheShard(size_t cacheSize,
+                 size_t cacheMemory)
+      : cache(cacheSize,
+              cacheMemory)
+      {
+        // no code
+      }
+    };
+
+    typedef std::unique_ptr<CacheShard>  CacheShardRef;
+    typedef std::unique_ptr<FileScanner> FileScannerRef;
+
+    /**
+     * Scoped lease of a FileScanner from the scanner pool. The scanner is only
+     * acquired on first access and is returned to the pool on destruction.
+     */
+    class ScannerLease
+    {
+    private:
+      const DataFile<N>& dataFile;
+      FileScannerRef     scanner;
+
+    public:
+      explicit ScannerLease(const DataFile<N>& dataFile)
+      : dataFile(dataFile)
+      {
+        // no code
+      }
+
+      ~ScannerLease()
+      {
+        if (scanner) {
+          dataFile.ReleaseScanner(std::move(scanner));
+        }
+      }
+
+      FileScanner* Get()
+      {
+        if (!scanner) {
+          scanner=dataFile.AcquireScanner();
+        }
 
-    mutable ValueCache  cache;
+        return scanner.get();
+      }
+    };
+
+  private:
+    std::string                         datafile;         //!< Basename part of the data file name
+    std::string                         datafilename;     //!< complete filename for data file
+    bool                                memoryMapedData;  //!< Use memory mapped file access
+    bool                                isOpen;           //!< true, if the data file is opened
 
-    mutable FileScanner scanner;         //!< File stream to the data file
+    std::vector<CacheShardRef>          cacheShards;      //!< The object cache, partitioned by file offset
+    CacheManagerRef                     cacheManager;     //!< Optional cache manager
 
-    mutable std::mutex  accessMutex;     //!< Mutex to secure multi-thread access
+    BlockCompressedFileCacheRef         blockCache;       //!< Inflated blocks, shared by all scanners, if the file is block compressed
+    mutable std::vector<FileScannerRef> scannerPool;      //!< Idle file streams to the data file
+    mutable std::mutex                  scannerPoolMutex; //!< Mutex to secure multi-thread access to the scanner pool
 
   protected:
     TypeConfigRef       typeConfig;
@@ -99,17 +183,53 @@ namespace osmscout {
                   FileOffset offset,
                   N& data) const;
 
+    FileScannerRef OpenScanner() const;
+    FileScannerRef AcquireScanner() const;
+    void ReleaseScanner(FileScannerRef&& scanner) const;
+
+    CacheShard& GetCacheShard(FileOffset offset) const;
+    bool GetFromCache(FileOffset offset,
+                      ValueType& value) const;
+    void StoreInCache(FileOffset offset,
+                      const ValueType& value,
+                      FileOffset recordSize) const;
+
+    void FlushCache();
+    size_t TrimCache(size_t memory) override;
+
+    void PrefetchOffsets(FileScanner& scanner,
+                         const std::vector<FileOffset>& offsets,
+                         const std::vector<size_t>& order) const;
+    bool GetByOffsets(const std::vector<FileOffset>& offsets,
+                      std::vector<ValueType>& data,
+                      size_t startIndex) const;
+
+    bool GetByBlockSpan(ScannerLease& lease,
+                        const DataBlockSpan& span,
+                        std::vector<ValueType>& data) const;
+
   public:
-    DataFile(const std::string& datafile, size_t cacheSize);
+    DataFile(const std::string& datafile,
+             size_t cacheSize,
+             size_t cacheMemory=0);
 
     virtual ~DataFile();
 
+    void SetCacheManager(const CacheManagerRef& cacheManager);
+
     bool Open(const TypeConfigRef& typeConfig,
               const std::string& path,
               bool memoryMapedData);
     virtual bool IsOpen() const;
     virtual bool Close();
 
+    size_t GetCacheSize() const;
+    size_t GetCacheMemory() const;
+    size_t GetCacheHits() const;
+    size_t GetCacheMisses() const;
+    size_t GetIdleScannerCount() const;
+    void DumpStatistics() const;
+
     bool GetByOffset(const FileOffset& offset,
                      ValueType& entry) const;
 
@@ -132,13 +252,36 @@ namespace osmscout {
     template<typename IteratorIn>
     bool GetByBlockSpans(IteratorIn begin, IteratorIn end,
                          std::vector<ValueType>& data) const;
+
+    template<typename IteratorIn, typename V, typename F>
+    bool VisitByOffset(IteratorIn begin, IteratorIn end,
+                       V& view,
+                       F visitor) const;
   };
 
   template <class N>
-  DataFile<N>::DataFile(const std::string& datafile, size_t cacheSize)
-  : datafile(datafile),cache(cacheSize)
+  DataFile<N>::DataFile(const std::string& datafile,
+                        size_t cacheSize,
+                        size_t cacheMemory)
+  : datafile(datafile),
+    memoryMapedData(false),
+    isOpen(false),
+    blockCache(std::make_shared<BlockCompressedFileCache>(BlockCompressedFileReader::DEFAULT_CACHE_MEMORY))
   {
-    // no code
+    // Every shard should still be large enough to keep the LRU semantic meaningful
+    size_t const maxShards=16;
+    size_t const minShardSize=256;
+    size_t       shardCount=std::max(std::min(cacheSize/minShardSize,
+                                              maxShards),
+                                     (size_t)1);
+    size_t shardSize=(cacheSize+shardCount-1)/shardCount;
+    size_t shardMemory=(cacheMemory+shardCount-1)/shardCount;
+
+    cacheShards.reserve(shardCount);
+
+    for (size_t i=0; i<shardCount; i++) {
+      cacheShards.push_back(CacheShardRef(new CacheShard(shardSize,shardMemory)));
+    }
   }
 
   template <class N>
@@ -147,6 +290,35 @@ namespace osmscout {
     if (IsOpen()) {
       Close();
     }
+
+    if (cacheManager) {
+      cacheManager->Unregister(*this);
+    }
+  }
+
+  /**
+   * Register the data file with the given cache manager (or unregister from the current
+   * cache manager, if an empty reference is passed). The memory of the object cache and of
+   * the block cache is then accounted for in the budget of the cache manager.
+   *
+   * Method is NOT thread-safe and must be called before the data file is opened.
+   */
+  template <class N>
+  void DataFile<N>::SetCacheManager(const CacheManagerRef& cacheManager)
+  {
+    assert(!IsOpen());
+
+    if (this->cacheManager) {
+      this->cacheManager->Unregister(*this);
+    }
+
+    this->cacheManager=cacheManager;
+
+    if (this->cacheManager) {
+      this->cacheManager->Register(*this);
+    }
+
+    blockCache->SetCacheManager(cacheManager);
   }
 
   /**
@@ -196,6 +368,308 @@ namespace osmscout {
     return true;
   }
 
+  /**
+   * Open a new FileScanner for the data file. Returns an empty reference on error.
+   *
+   * Method is thread-safe.
+   */
+  template <class N>
+  typename DataFile<N>::FileScannerRef DataFile<N>::OpenScanner() const
+  {
+    FileScannerRef scanner(new FileScanner());
+
+    scanner->SetBlockCache(blockCache);
+
+    try {
+      scanner->Open(datafilename,
+                    FileScanner::LowMemRandom,
+                    memoryMapedData);
+    }
+    catch (IOException& e) {
+      log.Error() << e.GetDescription();
+      scanner->CloseFailsafe();
+      return FileScannerRef();
+    }
+
+    return scanner;
+  }
+
+  /**
+   * Take an idle FileScanner from the pool or open a new one, if all existing scanners
+   * are currently in use by other threads. Returns an empty reference on error.
+   *
+   * Method is thread-safe.
+   */
+  template <class N>
+  typename DataFile<N>::FileScannerRef DataFile<N>::AcquireScanner() const
+  {
+    {
+      std::lock_guard<std::mutex> lock(scannerPoolMutex);
+
+      if (!scannerPool.empty()) {
+        FileScannerRef scanner=std::move(scannerPool.back());
+
+        scannerPool.pop_back();
+
+        return scanner;
+      }
+    }
+
+    return OpenScanner();
+  }
+
+  /**
+   * Return a FileScanner to the pool. Scanners in error state and scanners exceeding
+   * MAX_IDLE_SCANNERS are closed.
+   *
+   * Method is thread-safe.
+   */
+  template <class N>
+  void DataFile<N>::ReleaseScanner(FileScannerRef&& scanner) const
+  {
+    if (!scanner->HasError()) {
+      std::lock_guard<std::mutex> lock(scannerPoolMutex);
+
+      if (scannerPool.size()<MAX_IDLE_SCANNERS) {
+        scannerPool.push_back(std::move(scanner));
+        return;
+      }
+    }
+
+    scanner->CloseFailsafe();
+  }
+
+  /**
+   * Return the number of idle scanners in the pool.
+   *
+   * Method is thread-safe.
+   */
+  template <class N>
+  size_t DataFile<N>::GetIdleScannerCount() const
+  {
+    std::lock_guard<std::mutex> lock(scannerPoolMutex);
+
+    return scannerPool.size();
+  }
+
+  template <class N>
+  typename DataFile<N>::CacheShard& DataFile<N>::GetCacheShard(FileOffset offset) const
+  {
+    return *cacheShards[(offset^(offset >> 8))%cacheShards.size()];
+  }
+
+  /**
+   * Lookup the value for the given offset in the cache. Returns false, if
+   * the value is not cached.
+   *
+   * Method is thread-safe.
+   */
+  template <class N>
+  bool DataFile<N>::GetFromCache(FileOffset offset,
+                                 ValueType& value) const
+  {
+    CacheShard&                 shard=GetCacheShard(offset);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    ValueCacheRef               entryRef;
+
+    if (!shard.cache.GetEntry(offset,entryRef)) {
+      return false;
+    }
+
+    value=entryRef->value;
+
+    if (cacheManager) {
+      cacheManager->Touch(*this);
+    }
+
+    return true;
+  }
+
+  /**
+   * Store the value for the given offset in the cache. The record size is the size
+   * of the encoded value in the data file and is used to estimate the memory of the
+   * decoded value.
+   *
+   * Method is thread-safe.
+   */
+  template <class N>
+  void DataFile<N>::StoreInCache(FileOffset offset,
+                                 const ValueType& value,
+                                 FileOffset recordSize) const
+  {
+    CacheShard& shard=GetCacheShard(offset);
+    size_t      memoryBefore;
+    size_t      memoryAfter;
+
+    {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+
+      memoryBefore=shard.cache.GetMemory();
+
+      shard.cache.SetEntry(ValueCacheEntry(offset,value),
+                           sizeof(N)+(size_t)recordSize);
+
+      memoryAfter=shard.cache.GetMemory();
+    }
+
+    // Must be called without holding the shard lock, since the cache manager might trim us
+    if (cacheManager) {
+      if (memoryAfter>=memoryBefore) {
+        cacheManager->Allocate(*this,
+                               memoryAfter-memoryBefore);
+      }
+      else {
+        cacheManager->Free(memoryBefore-memoryAfter);
+      }
+    }
+  }
+
+  /**
+   * Remove all objects from the cache.
+   *
+   * Method is thread-safe.
+   */
+  template <class N>
+  void DataFile<N>::FlushCache()
+  {
+    size_t memory=0;
+
+    for (auto& shard : cacheShards) {
+      std::lock_guard<std::mutex> lock(shard->mutex);
+
+      memory+=shard->cache.GetMemory();
+      shard->cache.Flush();
+    }
+
+    if (cacheManager) {
+      cacheManager->Free(memory);
+    }
+  }
+
+  /**
+   * Evict objects from the cache until at least the given memory is freed. Called
+   * by the cache manager.
+   *
+   * Method is thread-safe.
+   */
+  template <class N>
+  size_t DataFile<N>::TrimCache(size_t memory)
+  {
+    size_t freed=0;
+
+    // Distribute eviction over all shards first, then take the rest from any shard
+    size_t shardMemory=(memory+cacheShards.size()-1)/cacheShards.size();
+
+    for (auto& shard : cacheShards) {
+      std::lock_guard<std::mutex> lock(shard->mutex);
+
+      freed+=shard->cache.Trim(std::min(shardMemory,memory-freed));
+
+      if (freed>=memory) {
+        return freed;
+      }
+    }
+
+    for (auto& shard : cacheShards) {
+      std::lock_guard<std::mutex> lock(shard->mutex);
+
+      freed+=shard->cache.Trim(memory-freed);
+
+      if (freed>=memory) {
+        break;
+      }
+    }
+
+    return freed;
+  }
+
+  /**
+   * Return the number of objects currently cached.
+   *
+   * Method is thread-safe.
+   */
+  template <class N>
+  size_t DataFile<N>::GetCacheSize() const
+  {
+    size_t size=0;
+
+    for (auto& shard : cacheShards) {
+      std::lock_guard<std::mutex> lock(shard->mutex);
+
+      size+=shard->cache.GetSize();
+    }
+
+    return size;
+  }
+
+  /**
+   * Return the estimated memory of all objects currently cached.
+   *
+   * Method is thread-safe.
+   */
+  template <class N>
+  size_t DataFile<N>::GetCacheMemory() const
+  {
+    size_t memory=0;
+
+    for (auto& shard : cacheShards) {
+      std::lock_guard<std::mutex> lock(shard->mutex);
+
+      memory+=shard->cache.GetMemory();
+    }
+
+    return memory;
+  }
+
+  /**
+   * Return the number of cache hits.
+   *
+   * Method is thread-safe.
+   */
+  template <class N>
+  size_t DataFile<N>::GetCacheHits() const
+  {
+    size_t hits=0;
+
+    for (auto& shard : cacheShards) {
+      std::lock_guard<std::mutex> lock(shard->mutex);
+
+      hits+=shard->cache.GetHits();
+    }
+
+    return hits;
+  }
+
+  /**
+   * Return the number of cache misses.
+   *
+   * Method is thread-safe.
+   */
+  template <class N>
+  size_t DataFile<N>::GetCacheMisses() const
+  {
+    size_t misses=0;
+
+    for (auto& shard : cacheShards) {
+      std::lock_guard<std::mutex> lock(shard->mutex);
+
+      misses+=shard->cache.GetMisses();
+    }
+
+    return misses;
+  }
+
+  /**
+   * Dump cache statistics to the log.
+   *
+   * Method is thread-safe.
+   */
+  template <class N>
+  void DataFile<N>::DumpStatistics() const
+  {
+    log.Info() << "Data file " << datafile << ": " << GetCacheSize() << " objects, memory " << GetCacheMemory() << ", hits " << GetCacheHits() << ", misses " << GetCacheMisses();
+  }
+
   /**
    * Open the index file.
    *
@@ -207,20 +681,19 @@ namespace osmscout {
                          bool memoryMapedData)
   {
     this->typeConfig=typeConfig;
+    this->memoryMapedData=memoryMapedData;
 
     datafilename=AppendFileToDir(path,datafile);
 
-    try {
-      scanner.Open(datafilename,
-                   FileScanner::LowMemRandom,
-                   memoryMapedData);
-    }
-    catch (IOException& e) {
-      log.Error() << e.GetDescription();
-      scanner.CloseFailsafe();
+    FileScannerRef scanner=OpenScanner();
+
+    if (!scanner) {
       return false;
     }
 
+    scannerPool.push_back(std::move(scanner));
+    isOpen=true;
+
     return true;
   }
 
@@ -232,7 +705,7 @@ namespace osmscout {
   template <class N>
   bool DataFile<N>::IsOpen() const
   {
-    return scanner.IsOpen();
+    return isOpen;
   }
 
   /**
@@ -243,19 +716,150 @@ namespace osmscout {
   template <class N>
   bool DataFile<N>::Close()
   {
+    bool result=true;
+
     typeConfig=NULL;
+    isOpen=false;
+
+    for (auto& scanner : scannerPool) {
+      try  {
+        if (scanner->IsOpen()) {
+          scanner->Close();
+        }
+      }
+      catch (IOException& e) {
+        log.Error() << e.GetDescription();
+        scanner->CloseFailsafe();
+        result=false;
+      }
+    }
+
+    scannerPool.clear();
+
+    FlushCache();
+    blockCache->Flush();
+
+    return result;
+  }
+
+  /**
+   * Hint the operating system to read ahead all file ranges covering the given offsets.
+   * Offsets that are close to each other are merged into one larger range, so that
+   * the data can be read using a few sequential reads instead of many random ones.
+   *
+   * @param scanner
+   *    Scanner to pass the hints to
+   * @param offsets
+   *    The file offsets
+   * @param order
+   *    Indexes into offsets, sorted by ascending file offset
+   */
+  template <class N>
+  void DataFile<N>::PrefetchOffsets(FileScanner& scanner,
+                                    const std::vector<FileOffset>& offsets,
+                                    const std::vector<size_t>& order) const
+  {
+    // Objects up to this distance are prefetched within the same range
+    FileOffset const maxGap=64*1024;
+    // Number of bytes we expect to be enough to hold most objects
+    FileOffset const objectSize=4*1024;
+
+    FileOffset rangeStart=offsets[order.front()];
+    FileOffset rangeEnd=rangeStart+objectSize;
+
+    for (size_t i=1; i<order.size(); i++) {
+      FileOffset offset=offsets[order[i]];
+
+      if (offset>rangeEnd+maxGap) {
+        scanner.Prefetch(rangeStart,
+                         rangeEnd-rangeStart);
 
-    try  {
-      if (scanner.IsOpen()) {
-        scanner.Close();
+        rangeStart=offset;
       }
+
+      rangeEnd=offset+objectSize;
     }
-    catch (IOException& e) {
-      log.Error() << e.GetDescription();
-      scanner.CloseFailsafe();
+
+    scanner.Prefetch(rangeStart,
+                     rangeEnd-rangeStart);
+  }
+
+  /**
+   * Read the data values for the given file offsets. The value for offsets[i]
+   * is stored at data[startIndex+i], so the result has the same order as the offsets.
+   * data must already have the required size.
+   *
+   * Values not already in the cache are read in ascending file offset order
+   * after giving the operating system read ahead hints for the affected file ranges.
+   *
+   * Method is thread-safe.
+   */
+  template <class N>
+  bool DataFile<N>::GetByOffsets(const std::vector<FileOffset>& offsets,
+                                 std::vector<ValueType>& data,
+                                 size_t startIndex) const
+  {
+    std::vector<size_t> missing;
+
+    for (size_t i=0; i<offsets.size(); i++) {
+      if (!GetFromCache(offsets[i],data[startIndex+i])) {
+        missing.push_back(i);
+      }
+    }
+
+    if (missing.empty()) {
+      return true;
+    }
+
+    std::sort(missing.begin(),
+              missing.end(),
+              [&offsets](size_t a, size_t b) {
+                return offsets[a]<offsets[b];
+              });
+
+    ScannerLease lease(*this);
+    FileScanner* scanner=lease.Get();
+
+    if (scanner==NULL) {
       return false;
     }
 
+    if (missing.size()>1) {
+      PrefetchOffsets(*scanner,
+                      offsets,
+                      missing);
+    }
+
+    ValueType  previousValue;
+    FileOffset previousOffset=0;
+
+    for (size_t idx : missing) {
+      FileOffset offset=offsets[idx];
+
+      // The same offset might be requested multiple times
+      if (previousValue &&
+          previousOffset==offset) {
+        data[startIndex+idx]=previousValue;
+        continue;
+      }
+
+      ValueType value=std::make_shared<N>();
+
+      if (!ReadData(*typeConfig,
+                    *scanner,
+                    offset,
+                    *value)) {
+        log.Error() << "Error while reading data from offset " << offset << " of file " << datafilename << "!";
+        return false;
+      }
+
+      StoreInCache(offset,value,scanner->GetPos()-offset);
+
+      data[startIndex+idx]=value;
+      previousValue=value;
+      previousOffset=offset;
+    }
+
     return true;
   }
 
@@ -264,6 +868,9 @@ namespace osmscout {
    * some container. the size parameter hints as the number of entries returned by the iterators
    * and is used to preallocate enough room in the result vector.
    *
+   * Data not already cached is read in file order to reduce the number of random seeks,
+   * but is returned in the order of the passed offsets.
+   *
    * @tparam N
    *    Object type managed by the data file
    * @tparam IteratorIn
@@ -276,7 +883,7 @@ namespace osmscout {
    *    Number of entries returnd by the begin, end itertaor pair. USed for preallocating enough space
    *    in result vector.
    * @param data
-   *    vector containing data. Data is appended.
+   *    vector containing data. Data is appended in the order of the offsets.
    * @return
    *    false if there was an error, else true
    *
@@ -287,29 +894,20 @@ namespace osmscout {
   bool DataFile<N>::GetByOffset(IteratorIn begin, IteratorIn end, size_t size,
                                 std::vector<ValueType>& data) const
   {
-    data.reserve(data.size()+size);
-    std::lock_guard<std::mutex> lock(accessMutex);
+    std::vector<FileOffset> offsets;
 
-    for (IteratorIn offsetIter=begin; offsetIter!=end; ++offsetIter) {
-      ValueCacheRef entryRef;
+    offsets.reserve(size);
+    offsets.insert(offsets.end(),begin,end);
 
-      if (cache.GetEntry(*offsetIter,entryRef)) {
-        data.push_back(entryRef->value);
-      }
-      else {
-        ValueType value=std::make_shared<N>();
+    size_t startIndex=data.size();
 
-        if (!ReadData(*typeConfig,
-                      scanner,
-                      *offsetIter,
-                      *value)) {
-          log.Error() << "Error while reading data from offset " << *offsetIter << " of file " << datafilename << "!";
-          return false;
-        }
+    data.resize(startIndex+offsets.size());
 
-        cache.SetEntry(ValueCacheEntry(*offsetIter,value));
-        data.push_back(value);
-      }
+    if (!GetByOffsets(offsets,
+                      data,
+                      startIndex)) {
+      data.resize(startIndex);
+      return false;
     }
 
     return true;
@@ -326,32 +924,26 @@ namespace osmscout {
                                 const GeoBox& boundingBox,
                                 std::vector<ValueType>& data) const
   {
-    data.reserve(data.size()+size);
-    std::lock_guard<std::mutex> lock(accessMutex);
+    std::vector<FileOffset> offsets;
+    std::vector<ValueType>  values;
 
-    for (IteratorIn offsetIter=begin; offsetIter!=end; ++offsetIter) {
-      ValueType value=std::make_shared<N>();
+    offsets.reserve(size);
+    offsets.insert(offsets.end(),begin,end);
 
-      ValueCacheRef entryRef;
-      if (cache.GetEntry(*offsetIter,entryRef)){
-        value=entryRef->value;
-      }else{
-        if (!ReadData(*typeConfig,
-                      scanner,
-                      *offsetIter,
-                      *value)) {
-          log.Error() << "Error while reading data from offset " << *offsetIter << " of file " << datafilename << "!";
-          return false;
-        }
+    values.resize(offsets.size());
 
-        cache.SetEntry(ValueCacheEntry(*offsetIter,value));
-      }
+    if (!GetByOffsets(offsets,
+                      values,
+                      0)) {
+      return false;
+    }
 
-      if (!value->Intersects(boundingBox)) {
-        continue;
-      }
+    data.reserve(data.size()+values.size());
 
-      data.push_back(value);
+    for (const auto& value : values) {
+      if (value->Intersects(boundingBox)) {
+        data.push_back(value);
+      }
     }
 
     return true;
@@ -392,84 +984,110 @@ namespace osmscout {
   bool DataFile<N>::GetByOffset(const FileOffset& offset,
                                 ValueType& entry) const
   {
-    std::lock_guard<std::mutex> lock(accessMutex);
+    if (GetFromCache(offset,entry)) {
+      return true;
+    }
 
-    ValueCacheRef entryRef;
-    if (cache.GetEntry(offset,entryRef)){
-      entry=entryRef->value;
-    }else{
-      ValueType value=std::make_shared<N>();
+    ScannerLease lease(*this);
+    FileScanner* scanner=lease.Get();
 
-      if (!ReadData(*typeConfig,
-                    scanner,
-                    offset,
-                    *value)) {
-        log.Error() << "Error while reading data from offset " << offset << " of file " << datafilename << "!";
-        // TODO: Remove broken entry from cache
-        return false;
-      }
+    if (scanner==NULL) {
+      return false;
+    }
+
+    ValueType value=std::make_shared<N>();
 
-      cache.SetEntry(ValueCacheEntry(offset,value));
-      entry=value;
+    if (!ReadData(*typeConfig,
+                  *scanner,
+                  offset,
+                  *value)) {
+      log.Error() << "Error while reading data from offset " << offset << " of file " << datafilename << "!";
+      return false;
     }
 
+    StoreInCache(offset,value,scanner->GetPos()-offset);
+    entry=value;
+
     return true;
   }
 
   /**
-   * Read data values from the given DataBlockSpan.
+   * Read data values from the given DataBlockSpan using the given scanner lease.
    *
    * Method is thread-safe.
    */
   template <class N>
-  bool DataFile<N>::GetByBlockSpan(const DataBlockSpan& span,
+  bool DataFile<N>::GetByBlockSpan(ScannerLease& lease,
+                                   const DataBlockSpan& span,
                                    std::vector<ValueType>& data) const
   {
-    if (span.count==0) {
-      return true;
-    }
-
-    std::lock_guard<std::mutex> lock(accessMutex);
-
     try {
-      bool offsetSetup=false;
+      bool       offsetSetup=false;
       FileOffset offset=span.startOffset;
 
-      data.reserve(data.size()+span.count);
-
       for (uint32_t i=1; i<=span.count; i++) {
-        ValueCacheRef entryRef;
-        if (cache.GetEntry(offset,entryRef)){
-          data.push_back(entryRef->value);
-          offset=entryRef->value->GetNextFileOffset();
+        ValueType value;
+
+        if (GetFromCache(offset,value)) {
+          data.push_back(value);
+          offset=value->GetNextFileOffset();
           offsetSetup=false;
-        }else{
-          if (!offsetSetup){
-            scanner.SetPos(offset);
-          }
+          continue;
+        }
 
-          ValueType value=std::make_shared<N>();
+        FileScanner* scanner=lease.Get();
 
-          if (!ReadData(*typeConfig,
-                        scanner,
-                        *value)) {
-            log.Error() << "Error while reading data #" << i << " starting from offset " << span.startOffset << " of file " << datafilename << "!";
-            return false;
-          }
+        if (scanner==NULL) {
+          return false;
+        }
 
-          cache.SetEntry(ValueCacheEntry(offset,value));
-          offset=value->GetNextFileOffset();
-          offsetSetup=true;
-          data.push_back(value);
+        if (!offsetSetup) {
+          scanner->SetPos(offset);
         }
-      }
 
-      return true;
+        value=std::make_shared<N>();
+
+        if (!ReadData(*typeConfig,
+                      *scanner,
+                      *value)) {
+          log.Error() << "Error while reading data #" << i << " starting from offset " << span.startOffset << " of file " << datafilename << "!";
+          return false;
+        }
+
+        StoreInCache(offset,value,scanner->GetPos()-offset);
+        offset=value->GetNextFileOffset();
+        offsetSetup=true;
+        data.push_back(value);
+      }
     }
     catch (IOException& e) {
       log.Error() << e.GetDescription();
       return false;
     }
+
+    return true;
+  }
+
+  /**
+   * Read data values from the given DataBlockSpan.
+   *
+   * Method is thread-safe.
+   */
+  template <class N>
+  bool DataFile<N>::GetByBlockSpan(const DataBlockSpan& span,
+                                   std::vector<ValueType>& data) const
+  {
+    if (span.count==0) {
+      return true;
+    }
+
+    data.reserve(data.size()+span.count);
+
+    ScannerLease lease(*this);
+
+    return GetByBlockSpan(lease,
+                          span,
+                          data);
   }
 
   /**
@@ -490,42 +1108,62 @@ namespace osmscout {
 
     data.reserve(data.size()+overallCount);
 
+    ScannerLease lease(*this);
+
+    for (IteratorIn spanIter=begin; spanIter!=end; ++spanIter) {
+      if (spanIter->count==0) {
+        continue;
+      }
+
+      if (!GetByBlockSpan(lease,
+                          *spanIter,
+                          data)) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  /**
+   * Read the objects at the given file offsets one after another into the passed
+   * view object (for example WayView or AreaView) and call the visitor for each of them.
+   *
+   * In contrast to GetByOffset() no objects are allocated and the object cache is neither
+   * consulted nor filled. The view passed to the visitor is overwritten by the next read,
+   * so the visitor must copy whatever it needs to keep.
+   *
+   * @tparam V
+   *    View type, must offer a method Read(const TypeConfig&,FileScanner&)
+   * @tparam F
+   *    Visitor, called with a const reference to the view. Returning false stops the iteration.
+   * @return
+   *    false if there was an error, else true
+   *
+   * Method is thread-safe.
+   */
+  template <class N>
+  template<typename IteratorIn, typename V, typename F>
+  bool DataFile<N>::VisitByOffset(IteratorIn begin, IteratorIn end,
+                                  V& view,
+                                  F visitor) const
+  {
+    ScannerLease lease(*this);
+    FileScanner* scanner=lease.Get();
+
+    if (scanner==NULL) {
+      return false;
+    }
+
     try {
-      std::lock_guard<std::mutex> lock(accessMutex);
-      for (IteratorIn spanIter=begin; spanIter!=end; ++spanIter) {
-        if (spanIter->count==0) {
-          continue;
-        }
+      for (IteratorIn offsetIter=begin; offsetIter!=end; ++offsetIter) {
+        scanner->SetPos(*offsetIter);
 
-        bool offsetSetup=false;
-        FileOffset offset=spanIter->startOffset;
-
-        for (uint32_t i=1; i<=spanIter->count; i++) {
-          ValueCacheRef entryRef;
-          if (cache.GetEntry(offset,entryRef)){
-            data.push_back(entryRef->value);
-            offset=entryRef->value->GetNextFileOffset();
-            offsetSetup=false;
-          }else{
-            if (!offsetSetup){
-              scanner.SetPos(offset);
-            }
-
-            ValueType value=std::make_shared<N>();
-
-            if (!ReadData(*typeConfig,
-                          scanner,
-                          *value)) {
-              log.Error() << "Error while reading data #" << i << " starting from offset " << spanIter->startOffset <<
-              " of file " << datafilename << "!";
-              return false;
-            }
-
-            cache.SetEntry(ValueCacheEntry(offset,value));
-            offset=value->GetNextFileOffset();
-            offsetSetup=true;
-            data.push_back(value);
-          }
+        view.Read(*typeConfig,
+                  *scanner);
+
+        if (!visitor(static_cast<const V&>(view))) {
+          break;
         }
       }
     }
@@ -561,7 +1199,10 @@ namespace osmscout {
     IndexedDataFile(const std::string& datafile,
                     const std::string& indexfile,
                     unsigned long indexCacheSize,
-                    unsigned long dataCacheSize);
+                    unsigned long dataCacheSize,
+                    size_t dataCacheMemory=0);
+
+    void SetCacheManager(const CacheManagerRef& cacheManager);
 
     bool Open(const TypeConfigRef& typeConfig,
               const std::string& path,
@@ -597,13 +1238,27 @@ namespace osmscout {
   IndexedDataFile<I,N>::IndexedDataFile(const std::string& datafile,
                                         const std::string& indexfile,
                                         unsigned long indexCacheSize,
-                                        unsigned long dataCacheSize)
-  : DataFile<N>(datafile,dataCacheSize),
+                                        unsigned long dataCacheSize,
+                                        size_t dataCacheMemory)
+  : DataFile<N>(datafile,dataCacheSize,dataCacheMemory),
     index(indexfile,indexCacheSize)
   {
     // no code
   }
 
+  /**
+   * Register the object cache of the data file and the page caches of the index
+   * with the given cache manager.
+   *
+   * Method is NOT thread-safe and must be called before the data file is opened.
+   */
+  template <class I, class N>
+  void IndexedDataFile<I,N>::SetCacheManager(const CacheManagerRef& cacheManager)
+  {
+    DataFile<N>::SetCacheManager(cacheManager);
+    index.SetCacheManager(cacheManager);
+  }
+
   template <class I, class N>
   bool IndexedDataFile<I,N>::Open(const TypeConfigRef& typeConfig,
                                   const std::string& path,
@@ -20,10 +20,12 @@
   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
 */
 
+#include <future>
 #include <list>
 #include <memory>
 #include <mutex>
 #include <set>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -53,7 +55,11 @@
 
 #include <osmscout/routing/Route.h>
 
+#include <osmscout/util/Breaker.h>
+#include <osmscout/util/CacheManager.h>
 #include <osmscout/util/GeoBox.h>
+#include <osmscout/util/Magnification.h>
+#include <osmscout/util/WorkQueue.h>
 
 #include <osmscout/system/Compiler.h>
 
@@ -71,17 +77,30 @@ namespace osmscout {
     instance.
 
     The following attributes are currently available:
-    * cache sizes.
+    * cache sizes (number of cached objects).
+    * cache memory (estimated memory of the cached objects in bytes, 0 for no limit).
+      The index caches are limited by the memory of the given number of index entries.
+      The area node and area way index caches are limited by the given memory, 0 disables them.
+    * an optional cache manager, to share one memory budget between the caches of
+      multiple databases.
     */
   class OSMSCOUT_API DatabaseParameter CLASS_FINAL
   {
   private:
     unsigned long areaAreaIndexCacheSize;
+    unsigned long areaNodeIndexCacheMemory;
+    unsigned long areaWayIndexCacheMemory;
 
     unsigned long nodeDataCacheSize;
     unsigned long wayDataCacheSize;
     unsigned long areaDataCacheSize;
 
+    unsigned long nodeDataCacheMemory;
+    unsigned long wayDataCacheMemory;
+    unsigned long areaDataCacheMemory;
+
+    CacheManagerRef cacheManager;
+
     bool routerDataMMap;
     bool nodesDataMMap;
     bool areasDataMMap;
@@ -90,20 +109,36 @@ namespace osmscout {
     DatabaseParameter();
 
     void SetAreaAreaIndexCacheSize(unsigned long areaAreaIndexCacheSize);
+    void SetAreaNodeIndexCacheMemory(unsigned long memory);
+    void SetAreaWayIndexCacheMemory(unsigned long memory);
     void SetNodeDataCacheSize(unsigned long  size);
     void SetWayDataCacheSize(unsigned long  size);
     void SetAreaDataCacheSize(unsigned long  size);
 
+    void SetNodeDataCacheMemory(unsigned long memory);
+    void SetWayDataCacheMemory(unsigned long memory);
+    void SetAreaDataCacheMemory(unsigned long memory);
+
+    void SetCacheManager(const CacheManagerRef& cacheManager);
+
     void SetRouterDataMMap(bool mmap);
     void SetNodesDataMMap(bool mmap);
     void SetAreasDataMMap(bool mmap);
     void SetWaysDataMMap(bool mmap);
 
     unsigned long GetAreaAreaIndexCacheSize() const;
+    unsigned long GetAreaNodeIndexCacheMemory() const;
+    unsigned long GetAreaWayIndexCacheMemory() const;
     unsigned long GetNodeDataCacheSize() const;
     unsigned long GetWayDataCacheSize() const;
     unsigned long GetAreaDataCacheSize() const;
 
+    unsigned long GetNodeDataCacheMemory() const;
+    unsigned long GetWayDataCacheMemory() const;
+    unsigned long GetAreaDataCacheMemory() const;
+
+    CacheManagerRef GetCacheManager() const;
+
     bool GetRouterDataMMap() const;
     bool GetNodesDataMMap() const;
     bool GetAreasDataMMap() const;
@@ -123,6 +158,9 @@ namespace osmscout {
    */
   class OSMSCOUT_API Database CLASS_FINAL
   {
+  private:
+    typedef std::shared_ptr<WorkQueue<bool>> PrefetchQueueRef;
+
   private:
     DatabaseParameter               parameter;                //!< Parameterization of this database object
 
@@ -164,6 +202,19 @@ namespace osmscout {
     mutable OptimizeWaysLowZoomRef  optimizeWaysLowZoom;      //!< Optimized data for low zoom situations
     mutable std::mutex              optimizeWaysMutex;        //!< Mutex to make lazy initialisation of optimized ways index thread-safe
 
+    mutable PrefetchQueueRef        prefetchQueue;            //!< Queue of pending prefetch requests
+    mutable std::thread             prefetchThread;           //!< Worker thread processing prefetch requests
+    mutable ThreadedBreaker         prefetchBreaker;          //!< Breaker to abort pending prefetch requests on close
+    mutable std::mutex              prefetchMutex;            //!< Mutex to make lazy initialisation of the prefetch worker thread-safe
+
+  private:
+    void PrefetchWorkerLoop(PrefetchQueueRef queue) const;
+    bool PrefetchData(const GeoBox& boundingBox,
+                      const Magnification& magnification,
+                      const TypeInfoSet& types,
+                      const BreakerRef& breaker) const;
+    void StopPrefetching();
+
   public:
     Database(const DatabaseParameter& parameter);
     virtual ~Database();
@@ -180,6 +231,11 @@ namespace osmscout {
       return parameter.GetRouterDataMMap();
     };
 
+    inline CacheManagerRef GetCacheManager() const
+    {
+      return parameter.GetCacheManager();
+    };
+
     BoundingBoxDataFileRef GetBoundingBoxDataFile() const;
 
     NodeDataFileRef GetNodeDataFile() const;
@@ -199,6 +255,11 @@ namespace osmscout {
 
     bool GetBoundingBox(GeoBox& boundingBox) const;
 
+    std::future<bool> Prefetch(const GeoBox& boundingBox,
+                               const Magnification& magnification,
+                               const TypeInfoSet& types,
+                               const BreakerRef& breaker=NULL) const;
+
     bool GetNodeByOffset(const FileOffset& offset,
                          NodeRef& node) const;
     bool GetNodesByOffset(const std::vector<FileOffset>& offsets,
@@ -37,7 +37,8 @@ namespace osmscout {
     static const char* NODES_IDMAP;
 
   public:
-    NodeDataFile(size_t cacheSize);
+    NodeDataFile(size_t cacheSize,
+                 size_t cacheMemory=0);
   };
 
   typedef std::shared_ptr<NodeDataFile> NodeDataFileRef;
@@ -26,6 +26,8 @@
 #include <osmscout/TypeConfig.h>
 
 #include <osmscout/util/Cache.h>
+#include <osmscout/util/CacheManager.h>
+#include <osmscout/util/EytzingerMap.h>
 #include <osmscout/util/File.h>
 #include <osmscout/util/FileScanner.h>
 #include <osmscout/util/Logger.h>
@@ -38,9 +40,19 @@ namespace osmscout {
     \ingroup Database
     Numeric index handles an index over instance of class <T> where the index criteria
     is of type <N>, where <N> has a numeric nature (usually Id).
+
+    The index file is a B-tree of fixed size pages. On opening the index, the deepest
+    index level whose page count fits into the cache is loaded completely into one contiguous
+    EytzingerMap. Lookups start directly in this flat level, the upper levels are not needed
+    at all. Index levels below the flat level are read page by page on demand and are
+    held in a page cache with the remaining cache budget.
+
+    The page caches are limited by memory. The budget of a level is the memory of the
+    number of completely filled pages assigned to it, so less filled pages leave room
+    for more pages. The page caches can be registered with a CacheManager.
     */
   template <class N>
-  class NumericIndex
+  class NumericIndex : private CacheManager::Client
   {
   private:
     /**
@@ -64,7 +76,6 @@ namespace osmscout {
 
     typedef std::shared_ptr<Page>         PageRef;
     typedef Cache<N,PageRef>              PageCache;
-    typedef std::unordered_map<N,PageRef> PageSimpleCache;
 
     /**
       Returns the size of a individual cache entry
@@ -73,39 +84,55 @@ namespace osmscout {
     {
       size_t GetSize(const PageRef& value) const
       {
-        return sizeof(value)+sizeof(Page)+sizeof(Entry)*value->entries.size();
+        return sizeof(value)+sizeof(Page)+sizeof(Entry)*value->entries.capacity();
       }
     };
 
   private:
-    std::string                         filepart;             //!< Name of the index file
-    std::string                         filename;             //!< Complete file name including directory
+    std::string                          filepart;            //!< Name of the index file
+    std::string                          filename;            //!< Complete file name including directory
 
     mutable FileScanner                  scanner;             //!< FileScanner instance for file access
 
-    unsigned long                        cacheSize;           //!< Maximum umber of index pages cached
+    unsigned long                        cacheSize;           //!< Cache budget in number of full index pages
     uint32_t                             pageSize;            //!< Size of one page as stated by the actual index file
     uint32_t                             levels;              //!< Number of index levels as stated by the actual index file
     std::vector<uint32_t>                pageCounts;          //!< Number of pages per level as stated by the actual index file
     char                                 *buffer;             //!< Temporary buffer for reading page data
 
-    PageRef                              root;                //!< Reference to the root page
-    size_t                               simpleCacheMaxLevel; //!< Maximum level for simple caching
-    mutable std::vector<PageSimpleCache> simplePageCache;     //!< Simple map to cache all entries
-    mutable std::vector<PageCache>       pageCaches;          //!< Complex cache with LRU characteristics
+    uint32_t                             flatLevel;           //!< The index level held in flatIndex
+    EytzingerMap<N,FileOffset>           flatIndex;           //!< All entries of the flat index level
+    mutable std::vector<PageCache>       pageCaches;          //!< Page caches for the index levels below the flat level
+    CacheManagerRef                      cacheManager;        //!< Optional cache manager
 
     mutable std::mutex                   accessMutex;         //!< Mutex to secure multi-thread access
 
   private:
     size_t GetPageIndex(const Page& page, N id) const;
+    void DecodePage(std::vector<Entry>& entries) const;
     void ReadPage(FileOffset offset, PageRef& page) const;
+    void LoadFlatLevel(FileOffset rootPageOffset);
+    size_t GetPageMemory() const;
     void InitializeCache();
 
+    size_t GetPageCacheMemory() const;
+    void UpdateCacheManager(size_t memoryBefore,
+                            size_t memoryAfter) const;
+    void FlushCache();
+    size_t TrimCache(size_t memory) override;
+
+    bool GetLeafPage(const N& id,
+                     PageRef& leafPage,
+                     N& limitId,
+                     bool& limited) const;
+
   public:
     NumericIndex(const std::string& filename,
                  unsigned long cacheSize);
     virtual ~NumericIndex();
 
+    void SetCacheManager(const CacheManagerRef& cacheManager);
+
     bool Open(const std::string& path,
               bool memoryMaped);
     bool Close();
@@ -130,7 +157,8 @@ namespace osmscout {
      cacheSize(cacheSize),
      pageSize(0),
      levels(0),
-     buffer(NULL)
+     buffer(NULL),
+     flatLevel(0)
   {
     // no code
   }
@@ -140,9 +168,36 @@ namespace osmscout {
   {
     Close();
 
+    if (cacheManager) {
+      cacheManager->Unregister(*this);
+    }
+
     delete [] buffer;
   }
 
+  /**
+   * Register the index with the given cache manager (or unregister from the current
+   * cache manager, if an empty reference is passed). The memory of the page caches is then
+   * accounted for in the budget of the cache manager.
+   *
+   * Method is NOT thread-safe and must be called before the index is opened.
+   */
+  template <class N>
+  void NumericIndex<N>::SetCacheManager(const CacheManagerRef& cacheManager)
+  {
+    assert(!IsOpen());
+
+    if (this->cacheManager) {
+      this->cacheManager->Unregister(*this);
+    }
+
+    this->cacheManager=cacheManager;
+
+    if (this->cacheManager) {
+      this->cacheManager->Register(*this);
+    }
+  }
+
   /**
     Binary search for index page for given id
     */
@@ -180,29 +235,16 @@ namespace osmscout {
     return size;
   }
 
+  /**
+    Decode the page currently held in buffer and append its entries
+    */
   template <class N>
-  inline void NumericIndex<N>::ReadPage(FileOffset offset, PageRef& page) const
+  inline void NumericIndex<N>::DecodePage(std::vector<Entry>& entries) const
   {
-    if (!page) {
-      page=std::make_shared<Page>();
-    }
-    else {
-      page->entries.clear();
-    }
-
-    page->entries.reserve(pageSize/4);
-
-    scanner.SetPos(offset);
-
-    scanner.Read(buffer,
-                 pageSize);
-
     size_t     currentPos=0;
     N          prevId=0;
     FileOffset prefFileOffset=0;
 
-    //std::cout << "Page: " << offset << std::endl;
-
     while (currentPos<pageSize &&
            buffer[currentPos]!=0) {
       unsigned int idBytes;
@@ -229,45 +271,230 @@ namespace osmscout {
       prevId=entry.startId;
       prefFileOffset=entry.fileOffset;
 
-      page->entries.push_back(entry);
+      entries.push_back(entry);
     }
   }
 
+  template <class N>
+  inline void NumericIndex<N>::ReadPage(FileOffset offset, PageRef& page) const
+  {
+    if (!page) {
+      page=std::make_shared<Page>();
+    }
+    else {
+      page->entries.clear();
+    }
+
+    page->entries.reserve(pageSize/4);
+
+    scanner.SetPos(offset);
+
+    scanner.Read(buffer,
+                 pageSize);
+
+    //std::cout << "Page: " << offset << std::endl;
+
+    DecodePage(page->entries);
+  }
+
+  /**
+    Load all entries of the flat index level into the flat index.
+
+    Pages of one index level are stored one after another in the index file
+    and the first entry of the first page of a level references the first page of the
+    next level. So we follow the first entries down from the root page and then read the
+    complete flat level in one sequential pass.
+    */
+  template <class N>
+  void NumericIndex<N>::LoadFlatLevel(FileOffset rootPageOffset)
+  {
+    std::vector<Entry> entries;
+    FileOffset         levelStart=rootPageOffset;
+
+    for (size_t level=0; level<flatLevel; level++) {
+      entries.clear();
+
+      scanner.SetPos(levelStart);
+      scanner.Read(buffer,
+                   pageSize);
+
+      DecodePage(entries);
+
+      if (entries.empty()) {
+        throw IOException(filename,"Cannot load index","Index page without entries");
+      }
+
+      levelStart=entries.front().fileOffset;
+    }
+
+    entries.clear();
+    entries.reserve(pageCounts[flatLevel]*(pageSize/4));
+
+    scanner.SetPos(levelStart);
+
+    for (size_t page=0; page<pageCounts[flatLevel]; page++) {
+      scanner.Read(buffer,
+                   pageSize);
+
+      DecodePage(entries);
+    }
+
+    std::vector<N>          ids;
+    std::vector<FileOffset> offsets;
+
+    ids.reserve(entries.size());
+    offsets.reserve(entries.size());
+
+    for (const auto& entry : entries) {
+      ids.push_back(entry.startId);
+      offsets.push_back(entry.fileOffset);
+    }
+
+    flatIndex.Assign(ids,
+                     offsets);
+  }
+
+  /**
+    Returns the maximum memory of a cached page. Every entry takes at least
+    two bytes in the page, so a page holds at most pageSize/2 entries.
+    */
+  template <class N>
+  size_t NumericIndex<N>::GetPageMemory() const
+  {
+    return sizeof(PageRef)+sizeof(Page)+sizeof(Entry)*(pageSize/2);
+  }
+
+  /**
+    Choose the flat level and distribute the remaining cache size over
+    the page caches of the levels below.
+    */
   template <class N>
   void NumericIndex<N>::InitializeCache()
   {
-    unsigned long currentCacheSize=cacheSize; // Available free space in cache
-    unsigned long requiredCacheSize=0;        // Space needed for caching everything
+    unsigned long requiredCacheSize=0; // Space needed for caching everything
+
+    flatLevel=0;
+    for (size_t level=1; level<pageCounts.size(); level++) {
+      if (pageCounts[level]<=cacheSize) {
+        flatLevel=(uint32_t)level;
+      }
+    }
 
-    for (const auto count : pageCounts) {
-      requiredCacheSize+=count;
+    for (size_t level=flatLevel; level<pageCounts.size(); level++) {
+      requiredCacheSize+=pageCounts[level];
     }
 
     if (requiredCacheSize>cacheSize) {
       log.Warn() << "Warning: Index " << filepart << " has cache size " << cacheSize<< ", but requires cache size " << requiredCacheSize << " to load index completely into cache!";
     }
 
-    simpleCacheMaxLevel=0;
-    for (size_t level=1; level<pageCounts.size(); level++) {
-      unsigned long resultingCacheSize; // Cache size we actually use for this level
+    unsigned long currentCacheSize=cacheSize-std::min((unsigned long)pageCounts[flatLevel],
+                                                      cacheSize); // Available free space in cache
 
-      simplePageCache.push_back(PageSimpleCache());
+    pageCaches.clear();
+    for (size_t level=0; level<pageCounts.size(); level++) {
+      if (level<=flatLevel) {
+        pageCaches.push_back(PageCache(0));
+        continue;
+      }
 
-      if (pageCounts[level]>currentCacheSize) {
-        resultingCacheSize=currentCacheSize;
-        currentCacheSize=0;
+      unsigned long resultingCacheSize=std::min((unsigned long)pageCounts[level],
+                                                currentCacheSize); // Cache size we actually use for this level
 
-        pageCaches.push_back(PageCache(resultingCacheSize));
+      currentCacheSize-=resultingCacheSize;
+
+      if (resultingCacheSize==0) {
+        pageCaches.push_back(PageCache(0));
+        continue;
       }
-      else {
-        resultingCacheSize=pageCounts[level];
-        currentCacheSize-=pageCounts[level];
 
-        simpleCacheMaxLevel=level;
+      pageCaches.push_back(PageCache(PageCache::NO_SIZE_LIMIT,
+                                     resultingCacheSize*GetPageMemory()));
+    }
+  }
 
-        pageCaches.push_back(PageCache(0));
+  /**
+   * Returns the memory of all page caches.
+   *
+   * Must be called with the access mutex locked.
+   */
+  template <class N>
+  size_t NumericIndex<N>::GetPageCacheMemory() const
+  {
+    size_t memory=0;
+
+    for (const auto& pageCache : pageCaches) {
+      memory+=pageCache.GetMemory();
+    }
+
+    return memory;
+  }
+
+  /**
+   * Report the change of the page cache memory caused by a lookup to the cache manager.
+   *
+   * Must be called without holding the access mutex, since the cache manager might trim us.
+   */
+  template <class N>
+  void NumericIndex<N>::UpdateCacheManager(size_t memoryBefore,
+                                           size_t memoryAfter) const
+  {
+    if (!cacheManager) {
+      return;
+    }
+
+    if (memoryAfter>memoryBefore) {
+      cacheManager->Allocate(*this,
+                             memoryAfter-memoryBefore);
+    }
+    else if (memoryAfter<memoryBefore) {
+      cacheManager->Free(memoryBefore-memoryAfter);
+    }
+    else {
+      cacheManager->Touch(*this);
+    }
+  }
+
+  /**
+   * Remove all pages from the page caches
+   */
+  template <class N>
+  void NumericIndex<N>::FlushCache()
+  {
+    size_t memory;
+
+    {
+      std::lock_guard<std::mutex> lock(accessMutex);
+
+      memory=GetPageCacheMemory();
+
+      for (auto& pageCache : pageCaches) {
+        pageCache.Flush();
       }
     }
+
+    if (cacheManager) {
+      cacheManager->Free(memory);
+    }
+  }
+
+  /**
+   * Evict pages until at least the given memory is freed, starting with
+   * the leaf level. Called by the cache manager.
+   *
+   * Method is thread-safe.
+   */
+  template <class N>
+  size_t NumericIndex<N>::TrimCache(size_t memory)
+  {
+    std::lock_guard<std::mutex> lock(accessMutex);
+    size_t                      freed=0;
+
+    for (size_t level=pageCaches.size(); level>0 && freed<memory; level--) {
+      freed+=pageCaches[level-1].Trim(memory-freed);
+    }
+
+    return freed;
   }
 
   template <class N>
@@ -309,9 +536,15 @@ namespace osmscout {
 
       //std::cout << "Index " << filename << ": " << entries << " entries to index, " << levels << " levels, pageSize " << pageSize << ", cache size " << cacheSize << std::endl;
 
-      ReadPage(lastLevelPageStart,root);
+      FlushCache();
+
+      flatIndex.Clear();
+      pageCaches.clear();
 
-      InitializeCache();
+      if (levels>0) {
+        InitializeCache();
+        LoadFlatLevel(lastLevelPageStart);
+      }
     }
     catch (IOException& e) {
       log.Error() << e.GetDescription();
@@ -325,6 +558,8 @@ namespace osmscout {
   template <class N>
   bool NumericIndex<N>::Close()
   {
+    FlushCache();
+
     try {
       if (scanner.IsOpen()) {
         scanner.Close();
@@ -346,96 +581,142 @@ namespace osmscout {
   }
 
   /**
-   * Return the file offset in the data file for the given object id.
+   * Descend from the flat index level to the leaf page that could contain the given id.
+   * limitId returns the start id of the following leaf page, which is the first id
+   * not covered by the returned page. If there is no following leaf page, limited is false.
    *
-   * This method is thread-safe.
+   * Must only be called if the flat level is not the leaf level and
+   * with the access mutex locked.
    */
   template <class N>
-  bool NumericIndex<N>::GetOffset(const N& id,
-                                  FileOffset& offset) const
+  bool NumericIndex<N>::GetLeafPage(const N& id,
+                                    PageRef& leafPage,
+                                    N& limitId,
+                                    bool& limited) const
   {
-    try
-    {
-      std::lock_guard<std::mutex> lock(accessMutex);
-
-      //std::cout << "Looking up " << id << " in index...." << std::endl;
+    N          startId;
+    FileOffset offset;
+
+    if (!flatIndex.FindFloor(id,
+                             startId,
+                             offset,
+                             limitId,
+                             limited)) {
+      //std::cerr << "Id " << id << " not found in flat index level" << std::endl;
+      return false;
+    }
 
-      size_t                      r=GetPageIndex(*root,id);
-      PageRef                     pageRef;
+    for (size_t level=flatLevel+1; level<levels; level++) {
+      //std::cout << "Level " << level << "/" << levels << std::endl;
+      typename PageCache::CacheRef cacheRef;
+      PageRef                      pageRef;
 
-      if (!root->IndexIsValid(r)) {
-        //std::cerr << "Id " << id << " not found in root index, " << root->entries.front().startId << "-" << root->entries.back().startId << std::endl;
-        return false;
+      if (pageCaches[level].GetEntry(startId,cacheRef)) {
+        pageRef=cacheRef->value;
       }
+      else {
+        pageRef=NULL; // Make sure, that we allocate a new page and not reuse an old one
 
-      const Entry& rootEntry=root->entries[r];
-
-      //std::cout << "Root entry index: " << r << " " << rootEntry.startId << " " << rootEntry.fileOffset << std::endl;
-
-      offset=rootEntry.fileOffset;
+        ReadPage(offset,pageRef);
 
-      N startId=rootEntry.startId;
-      for (size_t level=0; level+2<=levels; level++) {
-        //std::cout << "Level " << level << "/" << levels << std::endl;
-        if (level<=simpleCacheMaxLevel) {
-          auto cacheRef=simplePageCache[level].find(startId);
+        pageCaches[level].SetEntry(typename PageCache::CacheEntry(startId,pageRef),
+                                   NumericIndexCacheValueSizer().GetSize(pageRef));
+      }
 
-          if (cacheRef==simplePageCache[level].end()) {
-            pageRef=NULL; // Make sure, that we allocate a new page and not reuse an old one
+      if (level==levels-1) {
+        leafPage=pageRef;
 
-            ReadPage(offset,pageRef);
+        return true;
+      }
 
-            simplePageCache[level].insert(std::make_pair(startId,pageRef));
-          }
-          else {
-            pageRef=cacheRef->second;
-          }
-        }
-        else {
-          typename PageCache::CacheRef cacheRef;
+      const Page& page=*pageRef;
 
-          if (!pageCaches[level].GetEntry(startId,cacheRef)) {
-            typename PageCache::CacheEntry cacheEntry(startId);
+      size_t i=GetPageIndex(page,id);
 
-            cacheRef=pageCaches[level].SetEntry(cacheEntry);
+      if (!page.IndexIsValid(i)) {
+        //std::cerr << "Id " << id << " not found in index level " << level << "!" << std::endl;
+        return false;
+      }
 
-            ReadPage(offset,cacheRef->value);
-          }
+      const Entry& entry=page.entries[i];
 
-          pageRef=cacheRef->value;
-        }
+      //std::cout << "Sub entry index: " << i << " " << entry.startId << " " << entry.fileOffset << std::endl;
 
-        Page& page=*pageRef;
+      if (i+1<page.entries.size()) {
+        limitId=page.entries[i+1].startId;
+        limited=true;
+      }
 
-        size_t i=GetPageIndex(page,id);
+      startId=entry.startId;
+      offset=entry.fileOffset;
+    }
 
-        if (!page.IndexIsValid(i)) {
-          //std::cerr << "Id " << id << " not found in index level " << level+2 << "!" << std::endl;
-          return false;
-        }
+    return false;
+  }
 
-        const Entry& entry=page.entries[i];
+  /**
+   * Return the file offset in the data file for the given object id.
+   *
+   * This method is thread-safe.
+   */
+  template <class N>
+  bool NumericIndex<N>::GetOffset(const N& id,
+                                  FileOffset& offset) const
+  {
+    if (flatLevel+1>=levels) {
+      N startId;
 
-        //std::cout << "Sub entry index: " << i << " " << entry.startId << " " << entry.fileOffset << std::endl;
+      return flatIndex.FindFloor(id,
+                                 startId,
+                                 offset) &&
+             startId==id;
+    }
 
-        startId=entry.startId;
-        offset=entry.fileOffset;
-      }
+    std::unique_lock<std::mutex> lock(accessMutex);
+    size_t                       memoryBefore=GetPageCacheMemory();
+    bool                         found=false;
 
-      if (startId!=id) {
-        //std::cerr << "Id " << id << " not found in leaf index level (" << levels << " levels)" << std::endl;
+    try
+    {
+      PageRef page;
+      N       limitId;
+      bool    limited;
+
+      if (GetLeafPage(id,
+                      page,
+                      limitId,
+                      limited)) {
+        size_t i=GetPageIndex(*page,id);
+
+        if (page->IndexIsValid(i) &&
+            page->entries[i].startId==id) {
+          offset=page->entries[i].fileOffset;
+          found=true;
+        }
       }
-
-      return startId==id;
     }
     catch (IOException& e) {
       log.Error() << e.GetDescription();
-      return false;
     }
+
+    size_t memoryAfter=GetPageCacheMemory();
+
+    lock.unlock();
+
+    UpdateCacheManager(memoryBefore,
+                       memoryAfter);
+
+    return found;
   }
 
   /**
    * Return the file offsets in the data file for the given object ids.
+   * Ids that are not found in the index are skipped.
+   *
+   * The index is not descended for each id separately. As long as the following ids
+   * fall into the current leaf page, they are resolved from this page. If the ids are
+   * sorted, each leaf page is swept only once and each index page is read at most once.
+   * Unsorted ids are handled correctly, too, but profit less.
    *
    * This method is thread-safe.
    */
@@ -449,16 +730,85 @@ namespace osmscout {
     offsets.clear();
     offsets.reserve(size);
 
-    for (IteratorIn idIter=begin; idIter!=end; ++idIter) {
-      FileOffset offset;
+    if (flatLevel+1>=levels) {
+      for (IteratorIn idIter=begin; idIter!=end; ++idIter) {
+        N          startId;
+        FileOffset offset;
 
-      if (GetOffset(*idIter,
-                    offset)) {
-        offsets.push_back(offset);
+        if (flatIndex.FindFloor(*idIter,
+                                startId,
+                                offset) &&
+            startId==*idIter) {
+          offsets.push_back(offset);
+        }
       }
+
+      return true;
     }
 
-    return true;
+    std::unique_lock<std::mutex> lock(accessMutex);
+    size_t                       memoryBefore=GetPageCacheMemory();
+    bool                         result=true;
+
+    try
+    {
+      PageRef page;
+      N       limitId=0;
+      bool    limited=false;
+      size_t  pos=0;
+
+      for (IteratorIn idIter=begin; idIter!=end; ++idIter) {
+        const N id=*idIter;
+
+        if (page &&
+            id>=page->entries.front().startId &&
+            (!limited || id<limitId)) {
+          // The id is covered by the current leaf page
+          if (id>=page->entries[pos].startId) {
+            while (pos+1<page->entries.size() &&
+                   page->entries[pos+1].startId<=id) {
+              pos++;
+            }
+          }
+          else {
+            pos=GetPageIndex(*page,id);
+          }
+        }
+        else {
+          if (!GetLeafPage(id,
+                           page,
+                           limitId,
+                           limited)) {
+            page=NULL;
+            continue;
+          }
+
+          pos=GetPageIndex(*page,id);
+
+          if (!page->IndexIsValid(pos)) {
+            page=NULL;
+            continue;
+          }
+        }
+
+        if (page->entries[pos].startId==id) {
+          offsets.push_back(page->entries[pos].fileOffset);
+        }
+      }
+    }
+    catch (IOException& e) {
+      log.Error() << e.GetDescription();
+      result=false;
+    }
+
+    size_t memoryAfter=GetPageCacheMemory();
+
+    lock.unlock();
+
+    UpdateCacheManager(memoryBefore,
+                       memoryAfter);
+
+    return result;
   }
 
   template <class N>
@@ -466,17 +816,19 @@ namespace osmscout {
   {
     size_t memory=0;
     size_t pages=0;
+    size_t hits=0;
+    size_t misses=0;
 
-    pages+=1;
-    memory+=root->entries.size()*sizeof(Entry);
-
+    memory+=flatIndex.GetMemory();
 
     for (size_t i=0; i<pageCaches.size(); i++) {
       pages+=pageCaches[i].GetSize();
       memory+=sizeof(pageCaches[i])+pageCaches[i].GetMemory(NumericIndexCacheValueSizer());
+      hits+=pageCaches[i].GetHits();
+      misses+=pageCaches[i].GetMisses();
     }
 
-    log.Info() << "Index " << filepart << ": " << pages << " pages, memory " << memory;
+    log.Info() << "Index " << filepart << ": " << flatIndex.size() << " flat entries (level " << flatLevel << "), " << pages << " pages, memory " << memory << ", hits " << hits << ", misses " << misses;
   }
 }
 
@@ -1030,6 +1030,12 @@ namespace osmscout {
 
     void SetType(const TypeInfoRef& type);
 
+    /**
+     * Clears all feature values and sets the given type. If the type does not change
+     * the already allocated buffers are reused.
+     */
+    void Reset(const TypeInfoRef& type);
+
     inline TypeInfoRef GetType() const
     {
       return type;
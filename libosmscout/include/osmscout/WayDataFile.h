@@ -37,7 +37,8 @@ namespace osmscout {
     static const char* WAYS_IDMAP;
 
   public:
-    WayDataFile(size_t cacheSize);
+    WayDataFile(size_t cacheSize,
+                size_t cacheMemory=0);
   };
 
   typedef std::shared_ptr<WayDataFile> WayDataFileRef;
@@ -0,0 +1,97 @@
+#ifndef OSMSCOUT_WAYVIEW_H
+#define OSMSCOUT_WAYVIEW_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2017  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/ObjectRef.h>
+#include <osmscout/TypeConfig.h>
+
+#include <osmscout/util/CoordBlockView.h>
+#include <osmscout/util/FileScanner.h>
+
+#include <osmscout/system/Compiler.h>
+
+namespace osmscout {
+
+  /**
+   * \ingroup Database
+   *
+   * Read-only view onto a way as stored in 'ways.dat'.
+   *
+   * In contrast to Way the view does not decode the coordinates on read, but
+   * references the encoded coordinate deltas (see CoordBlockView). A WayView instance
+   * is meant to be reused for reading a sequence of ways, in this case reading does not
+   * allocate heap memory beside the feature values of the way.
+   *
+   * Node serials are not available from the view.
+   */
+  class OSMSCOUT_API WayView CLASS_FINAL
+  {
+  private:
+    FeatureValueBuffer featureValueBuffer; //!< List of features
+    CoordBlockView     coords;             //!< Encoded coordinates
+
+    FileOffset         fileOffset;         //!< Offset into the data file of this way
+    FileOffset         nextFileOffset;     //!< Offset after this way
+
+  public:
+    inline WayView()
+    : fileOffset(0),
+      nextFileOffset(0)
+    {
+      // no code
+    }
+
+    inline FileOffset GetFileOffset() const
+    {
+      return fileOffset;
+    }
+
+    inline FileOffset GetNextFileOffset() const
+    {
+      return nextFileOffset;
+    }
+
+    inline ObjectFileRef GetObjectFileRef() const
+    {
+      return ObjectFileRef(fileOffset,refWay);
+    }
+
+    inline TypeInfoRef GetType() const
+    {
+      return featureValueBuffer.GetType();
+    }
+
+    inline const FeatureValueBuffer& GetFeatureValueBuffer() const
+    {
+      return featureValueBuffer;
+    }
+
+    inline const CoordBlockView& GetCoords() const
+    {
+      return coords;
+    }
+
+    void Read(const TypeConfig& typeConfig,
+              FileScanner& scanner);
+  };
+}
+
+#endif
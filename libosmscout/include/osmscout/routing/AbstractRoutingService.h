@@ -24,9 +24,11 @@
 #include <functional>
 #include <list>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include <osmscout/CoreFeatures.h>
 #include <osmscout/TypeConfig.h>
@@ -34,7 +36,9 @@
 #include <osmscout/Pixel.h>
 
 #include <osmscout/routing/Route.h>
+#include <osmscout/routing/Landmarks.h>
 #include <osmscout/routing/RouteData.h>
+#include <osmscout/routing/RouteGraph.h>
 #include <osmscout/routing/RouteNode.h>
 #include <osmscout/routing/RoutingService.h>
 #include <osmscout/routing/MultiDBRoutingState.h>
@@ -50,7 +54,205 @@ namespace osmscout {
   class OSMSCOUT_API AbstractRoutingService: public RoutingService
   {
   protected:
-    bool debugPerformance;
+    typedef std::unordered_map<DBFileOffset,RNodeRef> SettledMap;
+
+    /**
+     * State of one direction of the bidirectional search
+     */
+    struct BidirectionalSearch
+    {
+      OpenListRef openList;            //!< Sorted list (smallest cost first) of nodes to check
+      ClosedSet   closedSet;           //!< Handled nodes, reached without access restriction
+      ClosedSet   closedRestrictedSet; //!< Handled nodes, reached with access restriction
+      SettledMap  settled;             //!< Final labels of the nodes in closedSet
+      SettledMap  settledRestricted;   //!< Final labels of the nodes in closedRestrictedSet
+    };
+
+    /**
+     * The best known route node, where the forward search and the backward search meet
+     */
+    struct BidirectionalMeeting
+    {
+      DBFileOffset  node;            //!< The route node where both searches meet
+      DBFileOffset  forwardPrev;     //!< Previous route node of the forward search
+      ObjectFileRef forwardObject;   //!< Object used to reach the route node from forwardPrev
+      DBFileOffset  backwardNext;    //!< Next route node of the backward search (in direction of the target)
+      ObjectFileRef backwardObject;  //!< Object used to reach backwardNext from the route node
+      bool          backwardAccess;  //!< Access state of the backward label
+      double        cost;            //!< Cost of the complete route
+    };
+
+    /**
+     * State of a route node during a search on a RouteGraph. There is at most
+     * one open label per node, but a node may be closed twice, once reached with
+     * and once reached without access restriction.
+     */
+    struct GraphSearchNode
+    {
+      double        currentCost;       //!< Cost of the open label
+      double        overallCost;       //!< Cost of the open label including the estimate
+      uint32_t      prev;              //!< Previous node of the open label
+      ObjectFileRef object;            //!< Object used to reach the node by the open label
+      bool          access;            //!< Access state of the open label
+      bool          open;              //!< The node has an open label
+      bool          closed[2];         //!< Closed with access restriction ([0]) or without ([1])
+      uint32_t      closedPrev[2];     //!< Previous node of the closed labels
+      ObjectFileRef closedObject[2];   //!< Object of the closed labels
+    };
+
+    typedef std::pair<double,uint32_t> GraphSearchEntry;
+
+    /**
+     * State of a search on a RouteGraph. The node state is kept between
+     * queries and reset using the list of touched nodes.
+     */
+    struct GraphSearch
+    {
+      std::vector<GraphSearchNode>  nodes;
+      std::vector<uint32_t>         touched;
+      std::vector<GraphSearchEntry> heap;    //!< Binary min heap of (overall cost, node), may contain outdated entries
+
+      /**
+       * Prepare for a new search on a graph with the given number of nodes
+       */
+      inline void Init(size_t nodeCount)
+      {
+        if (nodes.size()!=nodeCount) {
+          GraphSearchNode initial;
+
+          initial.open=false;
+          initial.closed[0]=false;
+          initial.closed[1]=false;
+
+          nodes.assign(nodeCount,initial);
+        }
+        else {
+          for (uint32_t node : touched) {
+            nodes[node].open=false;
+            nodes[node].closed[0]=false;
+            nodes[node].closed[1]=false;
+          }
+        }
+
+        touched.clear();
+        heap.clear();
+      }
+
+      /**
+       * Remember the node for resetting, must be called before the node gets
+       * its first label
+       */
+      inline void Touch(uint32_t node)
+      {
+        if (!nodes[node].open &&
+            !nodes[node].closed[0] &&
+            !nodes[node].closed[1]) {
+          touched.push_back(node);
+        }
+      }
+    };
+
+    /**
+     * Scratch state of a route search. The open lists, closed sets and node
+     * arrays are kept between queries and are only cleared, so that their memory
+     * is allocated once and reused. Every running query uses its own instance,
+     * taken from the scratch pool of the service by a SearchScratchLease.
+     */
+    struct SearchScratch
+    {
+      RoutingParameter::OpenListType openListType;        //!< Type of the open lists below
+      OpenListRef                    openList;            //!< Open list of the unidirectional search
+      ClosedSet                      closedSet;           //!< Closed set of the unidirectional search
+      ClosedSet                      closedRestrictedSet; //!< Restricted closed set of the unidirectional search
+      BidirectionalSearch            forward;             //!< Forward state of the bidirectional search
+      BidirectionalSearch            backward;            //!< Backward state of the bidirectional search
+      GraphSearch                    graphSearch;         //!< State of the search on the RouteGraph
+
+      SearchScratch()
+      : openListType(RoutingParameter::openListDAryHeap)
+      {
+        // no code
+      }
+
+      /**
+       * Return an empty open list of the type requested by the parameter
+       */
+      inline OpenListRef PrepareOpenList(OpenListRef& list,
+                                         const RoutingParameter& parameter)
+      {
+        if (openListType!=parameter.GetOpenListType()) {
+          openList=NULL;
+          forward.openList=NULL;
+          backward.openList=NULL;
+          openListType=parameter.GetOpenListType();
+        }
+
+        if (list) {
+          list->Clear();
+        }
+        else {
+          list=CreateOpenList(parameter);
+        }
+
+        return list;
+      }
+
+      /**
+       * Clear the closed set, making sure that it has room for the given number
+       * of nodes without rehashing
+       */
+      static inline void PrepareClosedSet(ClosedSet& closedSet,
+                                          size_t expectedSize)
+      {
+        closedSet.clear();
+
+        if (closedSet.bucket_count()<expectedSize) {
+          closedSet.reserve(expectedSize);
+        }
+      }
+    };
+
+    typedef std::unique_ptr<SearchScratch> SearchScratchRef;
+
+    /**
+     * Scoped lease of a SearchScratch from the scratch pool of the service. The
+     * scratch is returned to the pool on destruction.
+     */
+    class SearchScratchLease
+    {
+    private:
+      AbstractRoutingService& service;
+      SearchScratchRef        scratch;
+
+    public:
+      explicit SearchScratchLease(AbstractRoutingService& service)
+      : service(service),
+        scratch(service.AcquireSearchScratch())
+      {
+        // no code
+      }
+
+      ~SearchScratchLease()
+      {
+        service.ReleaseSearchScratch(std::move(scratch));
+      }
+
+      inline SearchScratch& Get()
+      {
+        return *scratch;
+      }
+    };
+
+  protected:
+    bool                          debugPerformance;
+
+  private:
+    std::vector<SearchScratchRef> scratchPool;      //!< Idle search scratch states
+    std::mutex                    scratchPoolMutex; //!< Mutex to secure multi-thread access to the scratch pool
+
+  protected:
+    SearchScratchRef AcquireSearchScratch();
+    void ReleaseSearchScratch(SearchScratchRef&& scratch);
 
   protected:
     virtual Vehicle GetVehicle(const RoutingState& state) = 0;
@@ -78,6 +280,33 @@ namespace osmscout {
                             const WayRef &way,
                             double wayLength) = 0;
 
+    virtual bool CanUse(const RoutingState& state,
+                        const DatabaseId database,
+                        const RouteGraph& graph,
+                        uint32_t path) = 0;
+
+    virtual double GetCosts(const RoutingState& state,
+                            const DatabaseId database,
+                            const RouteGraph& graph,
+                            uint32_t path) = 0;
+
+    virtual const RouteGraph* GetRouteGraph(const DatabaseId database);
+
+    virtual const RouteGraph* RequireRouteGraph(const DatabaseId database);
+
+    virtual const Landmarks* GetLandmarks(const RoutingState& state,
+                                          const DatabaseId database);
+
+    void InitializeLandmarkEstimate(const RoutingState& state,
+                                    const DatabaseId database,
+                                    const RouteNodeRef& forwardRouteNode,
+                                    const RouteNodeRef& backwardRouteNode,
+                                    LandmarkEstimate& estimate);
+
+    void ApplyLandmarkEstimate(const RoutingState& state,
+                               const LandmarkEstimate& targetEstimate,
+                               const RNodeRef& node);
+
     virtual double GetEstimateCosts(const RoutingState& state,
                                     const DatabaseId database,
                                     double targetDistance) = 0;
@@ -204,7 +433,6 @@ namespace osmscout {
                                       RNodeRef &current,
                                       RouteNodeRef &currentRouteNode,
                                       OpenList &openList,
-                                      OpenMap &openMap,
                                       const ClosedSet &closedSet,
                                       const ClosedSet &closedRestrictedSet);
 
@@ -212,7 +440,6 @@ namespace osmscout {
                            RNodeRef &current,
                            RouteNodeRef &currentRouteNode,
                            OpenList &openList,
-                           OpenMap &openMap,
                            ClosedSet &closedSet,
                            ClosedSet &closedRestrictedSet,
                            RoutingResult &result,
@@ -222,7 +449,64 @@ namespace osmscout {
                            size_t &nodesIgnoredCount,
                            double &currentMaxDistance,
                            const double &overallDistance,
-                           const double &costLimit);
+                           const double &costLimit,
+                           const LandmarkEstimate &targetEstimate,
+                           const GeoCoord *startCoord,
+                           const LandmarkEstimate &startEstimate);
+
+    virtual bool WalkPathsBackward(const RoutingState& state,
+                                   RNodeRef &current,
+                                   RouteNodeRef &currentRouteNode,
+                                   const RouteGraph& graph,
+                                   uint32_t graphNode,
+                                   BidirectionalSearch& search,
+                                   RoutingResult &result,
+                                   const RoutingParameter& parameter,
+                                   const GeoCoord &startCoord,
+                                   const GeoCoord &targetCoord,
+                                   const Vehicle &vehicle,
+                                   size_t &nodesIgnoredCount,
+                                   double &currentMaxDistance,
+                                   const double &overallDistance,
+                                   const double &costLimit,
+                                   const LandmarkEstimate &startEstimate,
+                                   const LandmarkEstimate &targetEstimate);
+
+    bool CheckBidirectionalMeeting(const DBFileOffset& offset,
+                                   const BidirectionalSearch& forward,
+                                   const BidirectionalSearch& backward,
+                                   BidirectionalMeeting& meeting,
+                                   bool& met);
+
+    void ResolveBackwardRNodeChainToList(const BidirectionalMeeting& meeting,
+                                         const ClosedSet& closedSet,
+                                         const ClosedSet &closedRestrictedSet,
+                                         std::list<VNode>& nodes);
+
+    RoutingResult CalculateRouteBidirectional(RoutingState& state,
+                                              const RoutePosition& start,
+                                              const RoutePosition& target,
+                                              const RoutingParameter& parameter,
+                                              SearchScratch& scratch);
+
+    void ResolveGraphChainToList(const RouteGraph& graph,
+                                 const GraphSearch& graphSearch,
+                                 DatabaseId database,
+                                 uint32_t finalNode,
+                                 std::list<VNode>& nodes);
+
+    RoutingResult CalculateRouteInGraph(RoutingState& state,
+                                        const RouteGraph& graph,
+                                        const RoutePosition& start,
+                                        const RoutePosition& target,
+                                        const RoutingParameter& parameter,
+                                        SearchScratch& scratch);
+
+    RoutingResult CalculateRoute(RoutingState& state,
+                                 const RoutePosition& start,
+                                 const RoutePosition& target,
+                                 const RoutingParameter& parameter,
+                                 SearchScratch& scratch);
 
     RoutingResult CalculateRoute(RoutingState& state,
                                  const RoutePosition& start,
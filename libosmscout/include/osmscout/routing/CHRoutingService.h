@@ -0,0 +1,177 @@
+#ifndef OSMSCOUT_CHROUTINGSERVICE_H
+#define OSMSCOUT_CHROUTINGSERVICE_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2017  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <osmscout/routing/ContractionHierarchy.h>
+#include <osmscout/routing/SimpleRoutingService.h>
+
+#include <osmscout/system/Compiler.h>
+
+namespace osmscout {
+
+  /**
+   * \ingroup Service
+   * \ingroup Routing
+   *
+   * Routing service answering queries using the contraction hierarchy generated
+   * by the importer for one vehicle (see ImportParameter::SetContractionHierarchies()).
+   *
+   * Queries run a bidirectional search on the upward graphs of the hierarchy,
+   * the resulting path is unpacked into route nodes and converted into RouteData
+   * exactly like a route found by SimpleRoutingService.
+   *
+   * The costs of the hierarchy are fixed at import time. The profile passed to
+   * CalculateRoute() should be parametrized the same way (FastestPathRoutingProfile,
+   * see ImportParameter::GetCarSpeedTable()), it is only used for the partial
+   * ways at the start and the target. The route is calculated by the
+   * SimpleRoutingService A* search instead if the hierarchy cannot be used for the
+   * query: a profile for a different vehicle, no path in the hierarchy (it does
+   * not contain access restricted paths) or a path violating a turn
+   * restriction.
+   */
+  class OSMSCOUT_API CHRoutingService CLASS_FINAL : public SimpleRoutingService
+  {
+  private:
+    /**
+     * State of a node in one search direction
+     */
+    struct SearchNode
+    {
+      double   cost;     //!< Cost from the start (forward) or to the target (backward)
+      uint32_t previous; //!< Previous node of the search
+      bool     settled;  //!< Node has been taken from the queue
+    };
+
+    /**
+     * Search state in one direction. Node state is kept between queries and
+     * reset using the list of touched nodes.
+     */
+    struct Search
+    {
+      std::vector<SearchNode> nodes;
+      std::vector<uint32_t>   touched;
+
+      void Init(size_t nodeCount);
+      void Reset();
+      void Touch(uint32_t node,
+                 double cost,
+                 uint32_t previous);
+    };
+
+    /**
+     * Search state of both directions, reused between queries. Every running
+     * query uses its own instance, taken from the search pool by a SearchLease.
+     */
+    struct SearchPair
+    {
+      Search forward;  //!< State of the search from the start
+      Search backward; //!< State of the search from the target
+    };
+
+    typedef std::unique_ptr<SearchPair> SearchPairRef;
+
+    /**
+     * Scoped lease of a SearchPair from the search pool. The search state is
+     * returned to the pool on destruction.
+     */
+    class SearchLease
+    {
+    private:
+      CHRoutingService& service;
+      SearchPairRef     search;
+
+    public:
+      explicit SearchLease(CHRoutingService& service)
+      : service(service),
+        search(service.AcquireSearch())
+      {
+        // no code
+      }
+
+      ~SearchLease()
+      {
+        service.ReleaseSearch(std::move(search));
+      }
+
+      inline SearchPair& Get()
+      {
+        return *search;
+      }
+    };
+
+    struct PathEntry
+    {
+      uint32_t      node;   //!< The route node reached
+      ObjectFileRef object; //!< The object used to reach the node
+    };
+
+  private:
+    std::string          filenamebase;    //!< Common base name for all router files
+    Vehicle              vehicle;         //!< Vehicle the hierarchy is built for
+    ContractionHierarchy hierarchy;       //!< The hierarchy
+    bool                 hierarchyLoaded; //!< true, if the hierarchy has been loaded
+    std::vector<SearchPairRef> searchPool;      //!< Idle search states
+    std::mutex                 searchPoolMutex; //!< Mutex to secure multi-thread access to the search pool
+
+  private:
+    SearchPairRef AcquireSearch();
+    void ReleaseSearch(SearchPairRef&& search);
+
+    bool UnpackEdge(uint32_t from,
+                    uint32_t to,
+                    std::list<PathEntry>& path) const;
+
+    bool CheckExcludes(const std::list<PathEntry>& path);
+
+  public:
+    CHRoutingService(const DatabaseRef& database,
+                     const RouterParameter& parameter,
+                     const std::string& filenamebase,
+                     Vehicle vehicle);
+
+    bool Open() override;
+    void Close() override;
+
+    inline bool IsHierarchyLoaded() const
+    {
+      return hierarchyLoaded;
+    }
+
+    RoutingResult CalculateRoute(RoutingProfile& profile,
+                                 const RoutePosition& start,
+                                 const RoutePosition& target,
+                                 const RoutingParameter& parameter) override;
+
+    using SimpleRoutingService::CalculateRoute;
+  };
+
+  //! \ingroup Service
+  //! Reference counted reference to an CHRoutingService instance
+  typedef std::shared_ptr<CHRoutingService> CHRoutingServiceRef;
+}
+
+#endif
@@ -0,0 +1,155 @@
+#ifndef OSMSCOUT_CONTRACTIONHIERARCHY_H
+#define OSMSCOUT_CONTRACTIONHIERARCHY_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2017  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <osmscout/private/CoreImportExport.h>
+
+#include <osmscout/ObjectRef.h>
+#include <osmscout/Types.h>
+
+#include <osmscout/util/FileScanner.h>
+#include <osmscout/util/FileWriter.h>
+
+#include <osmscout/system/Compiler.h>
+
+namespace osmscout {
+
+  /**
+   * \ingroup Routing
+   *
+   * A contraction hierarchy of the routing graph of one vehicle.
+   *
+   * Nodes are the route nodes of the routing graph, addressed by their index in
+   * route node file order. Every node holds the edges to nodes of higher rank,
+   * once in travel direction (for the search from the start) and once against travel
+   * direction (for the search from the target). An edge is either a path of the
+   * routing graph or a shortcut, that replaces the two edges via a contracted node
+   * of lower rank.
+   *
+   * Edge costs are fixed at import time by the routing profile used for
+   * contraction.
+   */
+  class OSMSCOUT_API ContractionHierarchy CLASS_FINAL
+  {
+  public:
+    static const uint32_t INVALID_NODE;
+
+    //! Node has turn restrictions (RouteNode::excludes)
+    static const uint8_t  hasExcludes = 1 << 0;
+
+    /**
+     * An edge of the hierarchy
+     */
+    struct OSMSCOUT_API Edge
+    {
+      uint32_t      target; //!< Index of the node at the other end of the edge
+      uint32_t      middle; //!< Index of the contracted node for shortcuts, else INVALID_NODE
+      double        cost;   //!< Cost of the edge
+      ObjectFileRef object; //!< Object used by the path, only valid for non-shortcut edges
+
+      inline bool IsShortcut() const
+      {
+        return middle!=INVALID_NODE;
+      }
+    };
+
+  private:
+    std::vector<FileOffset> nodeOffsets;         //!< File offset of the route node, ascending
+    std::vector<uint8_t>    nodeFlags;           //!< Flags of the route node
+    std::vector<uint32_t>   forwardEdgeStart;    //!< Index of the first forward edge of a node, size is node count+1
+    std::vector<Edge>       forwardEdges;        //!< Edges to higher ranked nodes in travel direction
+    std::vector<uint32_t>   backwardEdgeStart;   //!< Index of the first backward edge of a node, size is node count+1
+    std::vector<Edge>       backwardEdges;       //!< Edges from higher ranked nodes in travel direction
+
+  public:
+    ContractionHierarchy();
+
+    static std::string GetFilename(const std::string& filenamebase,
+                                   Vehicle vehicle);
+
+    void Clear();
+
+    void AddNode(FileOffset nodeOffset,
+                 uint8_t flags);
+    void AddForwardEdge(const Edge& edge);
+    void AddBackwardEdge(const Edge& edge);
+    void FinishNode();
+
+    inline size_t GetNodeCount() const
+    {
+      return nodeOffsets.size();
+    }
+
+    inline size_t GetEdgeCount() const
+    {
+      return forwardEdges.size()+backwardEdges.size();
+    }
+
+    inline FileOffset GetNodeOffset(uint32_t node) const
+    {
+      return nodeOffsets[node];
+    }
+
+    inline bool HasExcludes(uint32_t node) const
+    {
+      return (nodeFlags[node] & hasExcludes)!=0;
+    }
+
+    uint32_t GetNode(FileOffset nodeOffset) const;
+
+    inline const Edge* ForwardEdgesBegin(uint32_t node) const
+    {
+      return forwardEdges.data()+forwardEdgeStart[node];
+    }
+
+    inline const Edge* ForwardEdgesEnd(uint32_t node) const
+    {
+      return forwardEdges.data()+forwardEdgeStart[node+1];
+    }
+
+    inline const Edge* BackwardEdgesBegin(uint32_t node) const
+    {
+      return backwardEdges.data()+backwardEdgeStart[node];
+    }
+
+    inline const Edge* BackwardEdgesEnd(uint32_t node) const
+    {
+      return backwardEdges.data()+backwardEdgeStart[node+1];
+    }
+
+    const Edge* FindForwardEdge(uint32_t node,
+                                uint32_t target) const;
+    const Edge* FindBackwardEdge(uint32_t node,
+                                 uint32_t target) const;
+
+    void Read(FileScanner& scanner);
+    void Write(FileWriter& writer) const;
+  };
+
+  typedef std::shared_ptr<ContractionHierarchy> ContractionHierarchyRef;
+}
+
+#endif
@@ -0,0 +1,254 @@
+#ifndef OSMSCOUT_ISOCHRONESERVICE_H
+#define OSMSCOUT_ISOCHRONESERVICE_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2017  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <osmscout/GeoCoord.h>
+#include <osmscout/Types.h>
+
+#include <osmscout/routing/SimpleRoutingService.h>
+
+#include <osmscout/util/Breaker.h>
+
+#include <osmscout/system/Compiler.h>
+
+namespace osmscout {
+
+  /**
+   * \ingroup Routing
+   *
+   * Parameter object for isochrone calculations
+   */
+  class OSMSCOUT_API IsochroneParameter CLASS_FINAL
+  {
+  public:
+    //! Default limit for the number of route nodes reached by the search
+    static const size_t DEFAULT_MAX_NODES;
+
+  private:
+    BreakerRef breaker;
+    size_t     maxNodes;
+    bool       polygon;
+    double     polygonCellSize;
+
+  public:
+    IsochroneParameter();
+
+    void SetBreaker(const BreakerRef& breaker);
+
+    /**
+     * Maximum number of route nodes reached by the search. If the limit is
+     * reached, the search stops early and the result is incomplete (see
+     * IsochroneResult::IsComplete()).
+     *
+     * The memory used by the search is proportional to the number of reached
+     * route nodes (roughly 200 bytes per route node). Default is DEFAULT_MAX_NODES,
+     * 0 removes the limit.
+     */
+    void SetMaxNodes(size_t maxNodes);
+
+    /**
+     * If set, the outline of the reached area is calculated. Default is false.
+     */
+    void SetPolygon(bool polygon);
+
+    /**
+     * Size of the grid cells (in km) used to calculate the outline. Smaller cells
+     * result in a more detailed outline, but gaps in sparse regions. Default is 0.1.
+     */
+    void SetPolygonCellSize(double cellSize);
+
+    inline BreakerRef GetBreaker() const
+    {
+      return breaker;
+    }
+
+    inline size_t GetMaxNodes() const
+    {
+      return maxNodes;
+    }
+
+    inline bool IsPolygon() const
+    {
+      return polygon;
+    }
+
+    inline double GetPolygonCellSize() const
+    {
+      return polygonCellSize;
+    }
+  };
+
+  /**
+   * \ingroup Routing
+   *
+   * A route node reached by an isochrone calculation
+   */
+  struct OSMSCOUT_API IsochroneNode
+  {
+    Id       id;       //!< Id of the route node
+    GeoCoord coord;    //!< Coordinate of the route node
+    double   cost;     //!< Cost of the cheapest route to the route node
+    double   distance; //!< Distance (in km) of the cheapest route to the route node
+    double   duration; //!< Duration (in hours) of the cheapest route to the route node
+  };
+
+  /**
+   * \ingroup Routing
+   *
+   * Result of an isochrone calculation. This object is always returned. In case of
+   * an error it is empty.
+   */
+  class OSMSCOUT_API IsochroneResult CLASS_FINAL
+  {
+  private:
+    std::vector<IsochroneNode> nodes;
+    std::vector<GeoCoord>      polygon;
+    bool                       complete;
+
+  public:
+    IsochroneResult();
+
+    inline void SetComplete(bool complete)
+    {
+      this->complete=complete;
+    }
+
+    /**
+     * Route nodes reached, in the order of increasing costs
+     */
+    inline std::vector<IsochroneNode>& GetNodes()
+    {
+      return nodes;
+    }
+
+    inline const std::vector<IsochroneNode>& GetNodes() const
+    {
+      return nodes;
+    }
+
+    /**
+     * Outline of the reached area as a counterclockwise ring, empty if not requested
+     */
+    inline std::vector<GeoCoord>& GetPolygon()
+    {
+      return polygon;
+    }
+
+    inline const std::vector<GeoCoord>& GetPolygon() const
+    {
+      return polygon;
+    }
+
+    /**
+     * False, if the search stopped because of IsochroneParameter::GetMaxNodes().
+     * An incomplete result does not contain all route nodes reachable within the
+     * cost budget and its outline only covers the route nodes reached.
+     */
+    inline bool IsComplete() const
+    {
+      return complete;
+    }
+
+    inline bool Success() const
+    {
+      return !nodes.empty();
+    }
+  };
+
+  /**
+   * \ingroup Service
+   * \ingroup Routing
+   *
+   * Calculates all route nodes reachable from a start position within a given cost
+   * budget ("everything reachable within 15 minutes") and optionally the outline of
+   * the reached area.
+   *
+   * The calculation is a cost-bounded one-to-all Dijkstra search on the route node
+   * file following the same rules as the A* search of SimpleRoutingService. Route
+   * nodes are only read through the route node cache. For each reached route node
+   * only a compact label is kept, so memory grows with the number of reached route
+   * nodes and not with the size of the routing graph. It is limited by
+   * IsochroneParameter::SetMaxNodes().
+   */
+  class OSMSCOUT_API IsochroneService CLASS_FINAL : public SimpleRoutingService
+  {
+  private:
+    /**
+     * Open label of a route node
+     */
+    struct Label
+    {
+      double        cost;
+      double        distance;
+      double        duration;
+      FileOffset    prev;   //!< Previous route node
+      ObjectFileRef object; //!< Object used to reach the route node
+      bool          access; //!< Access state of the label
+      size_t        parent; //!< Index of the previous route node in the result
+    };
+
+    /**
+     * A route node already reached
+     */
+    struct ClosedNode
+    {
+      size_t  index; //!< Index of the route node in the result
+      uint8_t state; //!< Bit 0: closed with access restriction, bit 1: closed without
+    };
+
+    /**
+     * Segment of the search tree, used to calculate the outline
+     */
+    typedef std::pair<GeoCoord,GeoCoord> Segment;
+
+  private:
+    void CalculatePolygon(const std::vector<Segment>& segments,
+                          double cellSize,
+                          std::vector<GeoCoord>& polygon) const;
+
+  public:
+    IsochroneService(const DatabaseRef& database,
+                     const RouterParameter& parameter,
+                     const std::string& filenamebase);
+
+    /**
+     * Calculate the route nodes reachable from the given start position with costs
+     * not exceeding maxCost (in the units of the profile).
+     *
+     * If the number of reached route nodes hits IsochroneParameter::GetMaxNodes(),
+     * the search stops and the returned result is incomplete. Check
+     * IsochroneResult::IsComplete() before using the result as the reachable area.
+     */
+    IsochroneResult CalculateIsochrone(const RoutingProfile& profile,
+                                       const RoutePosition& start,
+                                       double maxCost,
+                                       const IsochroneParameter& parameter);
+  };
+
+  typedef std::shared_ptr<IsochroneService> IsochroneServiceRef;
+}
+
+#endif
@@ -0,0 +1,196 @@
+#ifndef OSMSCOUT_LANDMARKS_H
+#define OSMSCOUT_LANDMARKS_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2017  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <osmscout/private/CoreImportExport.h>
+
+#include <osmscout/Types.h>
+
+#include <osmscout/util/FileScanner.h>
+#include <osmscout/util/FileWriter.h>
+
+#include <osmscout/system/Compiler.h>
+
+namespace osmscout {
+
+  /**
+   * \ingroup Routing
+   *
+   * Distances between all route nodes of the routing graph of one vehicle and a
+   * small set of selected route nodes, the landmarks.
+   *
+   * Distances are the lengths of the shortest paths on the graph of all paths
+   * usable by the vehicle, ignoring the direction of travel and access
+   * restrictions. Because of the triangle inequality the difference of the distances
+   * of two route nodes to a landmark is a lower bound of the length of any route
+   * between them. Converted to costs by the routing profile this is a lower bound
+   * of the costs just like the spherical distance, so it works with any profile
+   * without recalculation.
+   *
+   * Nodes are the route nodes of the routing graph, addressed by their index in
+   * route node file order, like in the RouteGraph.
+   */
+  class OSMSCOUT_API Landmarks CLASS_FINAL
+  {
+  public:
+    static const uint32_t INVALID_NODE;
+    static const uint32_t UNREACHABLE; //!< Distance of route nodes not connected to the landmark
+
+  private:
+    std::vector<FileOffset> nodeOffsets;     //!< File offset of the route node, ascending
+    std::vector<FileOffset> landmarkOffsets; //!< File offset of the landmarks
+    std::vector<uint32_t>   distances;       //!< Distance (in cm, rounded down) of node n to landmark l at n*landmark count+l
+
+  public:
+    Landmarks();
+
+    static std::string GetFilename(const std::string& filenamebase,
+                                   Vehicle vehicle);
+
+    void Clear();
+
+    void Initialize(const std::vector<FileOffset>& nodeOffsets,
+                    size_t landmarkCount);
+
+    void SetLandmark(size_t landmark,
+                     uint32_t node,
+                     const std::vector<double>& nodeDistances);
+
+    inline bool IsLoaded() const
+    {
+      return !landmarkOffsets.empty();
+    }
+
+    inline size_t GetNodeCount() const
+    {
+      return nodeOffsets.size();
+    }
+
+    inline size_t GetLandmarkCount() const
+    {
+      return landmarkOffsets.size();
+    }
+
+    inline FileOffset GetLandmarkOffset(size_t landmark) const
+    {
+      return landmarkOffsets[landmark];
+    }
+
+    uint32_t GetNode(FileOffset nodeOffset) const;
+
+    /**
+     * Return a lower bound (in km) of the length of any route between the given nodes
+     */
+    inline double GetDistanceLowerBound(uint32_t from,
+                                        uint32_t to) const
+    {
+      const size_t    landmarkCount=landmarkOffsets.size();
+      const uint32_t* fromDistances=distances.data()+from*landmarkCount;
+      const uint32_t* toDistances=distances.data()+to*landmarkCount;
+      uint32_t        bound=0;
+
+      for (size_t l=0; l<landmarkCount; l++) {
+        if (fromDistances[l]==UNREACHABLE ||
+            toDistances[l]==UNREACHABLE) {
+          continue;
+        }
+
+        uint32_t difference=fromDistances[l]>toDistances[l] ? fromDistances[l]-toDistances[l] : toDistances[l]-fromDistances[l];
+
+        if (difference>bound) {
+          bound=difference;
+        }
+      }
+
+      // Both distances are rounded down, so the difference may be up to 1 cm too large
+      return bound>1 ? (bound-1)/100000.0 : 0.0;
+    }
+
+    void Read(FileScanner& scanner);
+    void Write(FileWriter& writer) const;
+  };
+
+  typedef std::shared_ptr<Landmarks> LandmarksRef;
+
+  /**
+   * \ingroup Routing
+   *
+   * Estimate of the distance from route nodes to one end of a route, the start or
+   * the target. The end is reached via one of at most two route nodes, so the
+   * landmark lower bound is the minimum of the lower bounds to these route nodes.
+   * Without landmarks the given spherical distance is returned unchanged.
+   */
+  class OSMSCOUT_API LandmarkEstimate CLASS_FINAL
+  {
+  private:
+    const Landmarks* landmarks;
+    uint32_t         ends[2];  //!< Nodes next to the end of the route
+    size_t           endCount; //!< Number of valid entries in ends
+
+  public:
+    LandmarkEstimate();
+
+    void Initialize(const Landmarks* landmarks);
+    void AddEnd(FileOffset nodeOffset);
+
+    inline bool IsActive() const
+    {
+      return landmarks!=NULL &&
+             endCount>0;
+    }
+
+    inline const Landmarks* GetLandmarks() const
+    {
+      return landmarks;
+    }
+
+    /**
+     * Return the maximum of the given spherical distance and the landmark lower
+     * bound of the distance from the given node to the end of the route
+     */
+    inline double GetNodeDistance(uint32_t node,
+                                  double sphericalDistance) const
+    {
+      if (!IsActive()) {
+        return sphericalDistance;
+      }
+
+      double bound=landmarks->GetDistanceLowerBound(node,ends[0]);
+
+      if (endCount>1) {
+        bound=std::min(bound,landmarks->GetDistanceLowerBound(node,ends[1]));
+      }
+
+      return std::max(sphericalDistance,bound);
+    }
+
+    double GetDistance(FileOffset nodeOffset,
+                       double sphericalDistance) const;
+  };
+}
+
+#endif
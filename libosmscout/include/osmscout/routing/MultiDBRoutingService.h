@@ -97,6 +97,13 @@ namespace osmscout {
                             const WayRef &way,
                             double wayLength);
 
+    virtual double GetCosts(const MultiDBRoutingState& state,
+                            const DatabaseId database,
+                            const RouteGraph& graph,
+                            uint32_t path);
+
+    virtual const RouteGraph* RequireRouteGraph(const DatabaseId database);
+
     virtual double GetEstimateCosts(const MultiDBRoutingState& state,
                                     const DatabaseId database,
                                     double targetDistance);
@@ -156,6 +163,11 @@ namespace osmscout {
                         const RouteNode& routeNode,
                         size_t pathIndex);
 
+    virtual bool CanUse(const MultiDBRoutingState& state,
+                        const DatabaseId database,
+                        const RouteGraph& graph,
+                        uint32_t path);
+
   public:
     MultiDBRoutingService(const RouterParameter& parameter,
                           const std::vector<DatabaseRef> &databases);
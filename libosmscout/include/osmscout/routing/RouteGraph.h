@@ -0,0 +1,215 @@
+#ifndef OSMSCOUT_ROUTEGRAPH_H
+#define OSMSCOUT_ROUTEGRAPH_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2017  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <osmscout/private/CoreImportExport.h>
+
+#include <osmscout/GeoCoord.h>
+#include <osmscout/ObjectRef.h>
+#include <osmscout/TypeConfig.h>
+#include <osmscout/Types.h>
+
+#include <osmscout/routing/RouteNode.h>
+
+#include <osmscout/system/Compiler.h>
+
+namespace osmscout {
+
+  /**
+   * \ingroup Routing
+   *
+   * The complete routing graph of one database ('route.dat') held in memory in
+   * compressed sparse row format.
+   *
+   * Nodes are addressed by a dense index in route node file order. The paths,
+   * objects and excludes of all nodes are stored in flat arrays, the paths of node
+   * n are the entries [GetFirstPath(n),GetFirstPath(n+1)). A path holds the index of
+   * its target node, its distance, the index of its object, the object variant index
+   * and the flags of RouteNode::Path.
+   *
+   * Additionally the graph holds the reverse adjacency: the source node of every path and
+   * the paths ending at node n, [GetFirstIncomingPath(n),GetLastIncomingPath(n)). Since
+   * 'route.dat' only holds the paths that can be used, this allows searches to walk the
+   * graph against path direction (e.g. the backward search of a bidirectional search).
+   *
+   * The graph is loaded once and requires much more memory than the cached access to
+   * the route node file, but allows routing without any file access or memory allocation
+   * per visited route node.
+   */
+  class OSMSCOUT_API RouteGraph CLASS_FINAL
+  {
+  public:
+    static const uint32_t INVALID_NODE;
+
+  private:
+    std::vector<FileOffset>    nodeOffsets;    //!< File offset of the route node, ascending
+    std::vector<GeoCoord>      nodeCoords;     //!< Coordinate of the route node
+    std::vector<uint32_t>      pathStart;      //!< Index of the first path of a node, size is node count+1
+    std::vector<uint32_t>      pathSources;    //!< Index of the source node of the path
+    std::vector<uint32_t>      pathTargets;    //!< Index of the target node of the path
+    std::vector<double>        pathDistances;  //!< Distance of the path
+    std::vector<uint32_t>      pathObjects;    //!< Index of the object of the path in objects
+    std::vector<uint16_t>      pathVariants;   //!< Object variant index of the object of the path
+    std::vector<uint8_t>       pathFlags;      //!< Flags of the path (see RouteNode)
+    std::vector<ObjectFileRef> objects;        //!< Objects crossing the route nodes
+    std::vector<uint32_t>      excludeStart;   //!< Index of the first exclude of a node, size is node count+1
+    std::vector<ObjectFileRef> excludeSources; //!< Source object of the exclude
+    std::vector<uint32_t>      excludeTargets; //!< Index of the target object of the exclude in objects
+    std::vector<uint32_t>      incomingStart;  //!< Index of the first incoming path of a node in incomingPaths, size is node count+1
+    std::vector<uint32_t>      incomingPaths;  //!< All paths, grouped by their target node
+
+  public:
+    RouteGraph();
+
+    void Clear();
+
+    bool Load(const TypeConfig& typeConfig,
+              const std::string& filename);
+
+    inline bool IsLoaded() const
+    {
+      return !nodeOffsets.empty();
+    }
+
+    inline size_t GetNodeCount() const
+    {
+      return nodeOffsets.size();
+    }
+
+    inline size_t GetPathCount() const
+    {
+      return pathTargets.size();
+    }
+
+    uint32_t GetNode(FileOffset nodeOffset) const;
+
+    inline FileOffset GetNodeOffset(uint32_t node) const
+    {
+      return nodeOffsets[node];
+    }
+
+    inline const GeoCoord& GetNodeCoord(uint32_t node) const
+    {
+      return nodeCoords[node];
+    }
+
+    inline uint32_t GetFirstPath(uint32_t node) const
+    {
+      return pathStart[node];
+    }
+
+    inline uint32_t GetLastPath(uint32_t node) const
+    {
+      return pathStart[node+1];
+    }
+
+    inline uint32_t GetFirstIncomingPath(uint32_t node) const
+    {
+      return incomingStart[node];
+    }
+
+    inline uint32_t GetLastIncomingPath(uint32_t node) const
+    {
+      return incomingStart[node+1];
+    }
+
+    /**
+     * Return the path with the given index in the list of incoming paths, see
+     * GetFirstIncomingPath() and GetLastIncomingPath()
+     */
+    inline uint32_t GetIncomingPath(uint32_t index) const
+    {
+      return incomingPaths[index];
+    }
+
+    inline uint32_t GetPathSource(uint32_t path) const
+    {
+      return pathSources[path];
+    }
+
+    inline uint32_t GetPathTarget(uint32_t path) const
+    {
+      return pathTargets[path];
+    }
+
+    inline double GetPathDistance(uint32_t path) const
+    {
+      return pathDistances[path];
+    }
+
+    inline uint16_t GetPathVariant(uint32_t path) const
+    {
+      return pathVariants[path];
+    }
+
+    inline uint8_t GetPathFlags(uint32_t path) const
+    {
+      return pathFlags[path];
+    }
+
+    inline const ObjectFileRef& GetPathObject(uint32_t path) const
+    {
+      return objects[pathObjects[path]];
+    }
+
+    inline bool IsPathRestricted(uint32_t path,
+                                 Vehicle vehicle) const
+    {
+      switch (vehicle) {
+      case vehicleFoot:
+        return (pathFlags[path] & RouteNode::restrictedForFoot) != 0;
+      case vehicleBicycle:
+        return (pathFlags[path] & RouteNode::restrictedForBicycle) != 0;
+      case vehicleCar:
+        return (pathFlags[path] & RouteNode::restrictedForCar) != 0;
+      }
+
+      return false;
+    }
+
+    /**
+     * Return true, if it is not allowed to turn from the source object into the
+     * object of the given path at the given node.
+     */
+    inline bool IsExcluded(uint32_t node,
+                           const ObjectFileRef& source,
+                           uint32_t path) const
+    {
+      for (uint32_t e=excludeStart[node]; e<excludeStart[node+1]; e++) {
+        if (excludeTargets[e]==pathObjects[path] &&
+            excludeSources[e]==source) {
+          return true;
+        }
+      }
+
+      return false;
+    }
+  };
+
+  typedef std::shared_ptr<RouteGraph> RouteGraphRef;
+}
+
+#endif
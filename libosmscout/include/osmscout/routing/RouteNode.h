@@ -80,13 +80,13 @@ namespace osmscout {
 
     /**
      * \ingroup Routing
-     * Exclude regarding use of paths. You cannot use the path with the index "targetPath" if you come
-     * from the source object.
+     * Exclude regarding use of paths. You cannot use the paths of the object with the index
+     * "targetIndex" if you come from the source object.
      */
     struct OSMSCOUT_API Exclude
     {
       ObjectFileRef source;      //!< The source object
-      uint32_t      targetIndex; //!< The index of the target path
+      uint32_t      targetIndex; //!< The index of the target object
     };
 
     /**
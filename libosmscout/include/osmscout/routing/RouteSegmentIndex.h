@@ -0,0 +1,166 @@
+#ifndef OSMSCOUT_ROUTESEGMENTINDEX_H
+#define OSMSCOUT_ROUTESEGMENTINDEX_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2017  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <osmscout/private/CoreImportExport.h>
+
+#include <osmscout/GeoCoord.h>
+#include <osmscout/ObjectRef.h>
+#include <osmscout/Point.h>
+#include <osmscout/TypeConfig.h>
+#include <osmscout/Types.h>
+
+#include <osmscout/routing/RouteNode.h>
+#include <osmscout/routing/RoutingProfile.h>
+
+#include <osmscout/util/FileScanner.h>
+#include <osmscout/util/FileWriter.h>
+#include <osmscout/util/GeoBox.h>
+
+#include <osmscout/system/Compiler.h>
+
+namespace osmscout {
+
+  /**
+   * \ingroup Routing
+   *
+   * Result of a nearest segment query on the RouteSegmentIndex
+   */
+  struct OSMSCOUT_API RouteSegmentMatch
+  {
+    ObjectFileRef object;     //!< The routable way
+    size_t        segment;    //!< Index of the first node of the closest segment of the way
+    size_t        nodeIndex;  //!< Index of the node of the segment closer to the projection
+    GeoCoord      projection; //!< Closest point on the segment
+    double        distance;   //!< Distance (in degrees, see DistanceToSegment()) to the projection
+  };
+
+  /**
+   * \ingroup Routing
+   *
+   * Grid of all segments of the routable ways of one router. Each cell of the
+   * grid holds the segments crossing it. The ways are stored with their type, the
+   * vehicles that can route on them (flags of RouteNode::Path) and their
+   * coordinates, so that the closest routable segment to a coordinate can be found
+   * without loading ways or scanning other indexes.
+   *
+   * The index is generated by the import (see ImportParameter::SetRouteSegmentIndex())
+   * and completely held in memory.
+   */
+  class OSMSCOUT_API RouteSegmentIndex CLASS_FINAL
+  {
+  private:
+    struct Segment
+    {
+      uint32_t way;  //!< Index of the way
+      uint32_t node; //!< Index of the first node of the segment in the way
+    };
+
+  private:
+    uint32_t                       cellsPerDegree; //!< Resolution of the grid
+    std::vector<FileOffset>        wayOffsets;     //!< File offset of the way, ascending
+    std::vector<TypeId>            wayTypes;       //!< Way type id of the way
+    std::vector<uint8_t>           wayFlags;       //!< Vehicles that can route on the way (see RouteNode)
+    std::vector<uint32_t>          wayCoordStart;  //!< Index of the first coordinate of a way, size is way count+1
+    std::vector<GeoCoord>          coords;         //!< Coordinates of all ways
+    std::vector<uint64_t>          cellKeys;       //!< Key (see GetCellKey()) of the non-empty cells, ascending
+    std::vector<uint32_t>          cellStart;      //!< Index of the first segment of a cell, size is cell count+1
+    std::vector<Segment>           segments;       //!< Segments of all cells
+    std::vector<ObjectVariantData> typeVariants;   //!< Object variant per way type id for RoutingProfile::CanUse()
+
+  private:
+    inline uint32_t GetCellX(double lon) const
+    {
+      return std::min((uint32_t)((lon+180.0)*cellsPerDegree),
+                      360*cellsPerDegree-1);
+    }
+
+    inline uint32_t GetCellY(double lat) const
+    {
+      return std::min((uint32_t)((lat+90.0)*cellsPerDegree),
+                      180*cellsPerDegree-1);
+    }
+
+    inline uint64_t GetCellKey(uint32_t x,
+                               uint32_t y) const
+    {
+      return (uint64_t)y*360*cellsPerDegree+x;
+    }
+
+    void CheckCell(uint32_t x,
+                   uint32_t y,
+                   const GeoCoord& coord,
+                   const RoutingProfile& profile,
+                   bool& found,
+                   RouteSegmentMatch& match,
+                   uint32_t& matchWay) const;
+
+  public:
+    RouteSegmentIndex();
+
+    static std::string GetFilename(const std::string& filenamebase);
+
+    void Clear();
+
+    inline bool IsLoaded() const
+    {
+      return !wayOffsets.empty();
+    }
+
+    inline size_t GetWayCount() const
+    {
+      return wayOffsets.size();
+    }
+
+    inline size_t GetSegmentCount() const
+    {
+      return segments.size();
+    }
+
+    void SetCellsPerDegree(uint32_t cellsPerDegree);
+
+    void AddWay(FileOffset offset,
+                TypeId type,
+                uint8_t flags,
+                const std::vector<Point>& nodes);
+
+    void BuildCells();
+
+    void Read(const TypeConfig& typeConfig,
+              FileScanner& scanner);
+    void Write(const TypeConfig& typeConfig,
+               FileWriter& writer) const;
+
+    bool GetClosestSegment(const GeoCoord& coord,
+                           const GeoBox& boundingBox,
+                           const RoutingProfile& profile,
+                           RouteSegmentMatch& match) const;
+  };
+
+  typedef std::shared_ptr<RouteSegmentIndex> RouteSegmentIndexRef;
+}
+
+#endif
@@ -52,6 +52,8 @@ namespace osmscout {
     virtual bool CanUse(const RouteNode& currentNode,
                         const std::vector<ObjectVariantData>& objectVariantData,
                         size_t pathIndex) const = 0;
+    virtual bool CanUse(uint8_t pathFlags,
+                        const ObjectVariantData& objectVariantData) const = 0;
     virtual bool CanUse(const Area& area) const = 0;
     virtual bool CanUse(const Way& way) const = 0;
     virtual bool CanUseForward(const Way& way) const = 0;
@@ -60,12 +62,16 @@ namespace osmscout {
     virtual double GetCosts(const RouteNode& currentNode,
                             const std::vector<ObjectVariantData>& objectVariantData,
                             size_t pathIndex) const = 0;
+    virtual double GetCosts(const ObjectVariantData& objectVariantData,
+                            double distance) const = 0;
     virtual double GetCosts(const Area& area,
                             double distance) const = 0;
     virtual double GetCosts(const Way& way,
                             double distance) const = 0;
     virtual double GetCosts(double distance) const = 0;
 
+    virtual double GetTime(const ObjectVariantData& objectVariantData,
+                           double distance) const = 0;
     virtual double GetTime(const Area& area,
                            double distance) const = 0;
     virtual double GetTime(const Way& way,
@@ -132,11 +138,30 @@ namespace osmscout {
     bool CanUse(const RouteNode& currentNode,
                 const std::vector<ObjectVariantData>& objectVariantData,
                 size_t pathIndex) const;
+    bool CanUse(uint8_t pathFlags,
+                const ObjectVariantData& objectVariantData) const;
     bool CanUse(const Area& area) const;
     bool CanUse(const Way& way) const;
     bool CanUseForward(const Way& way) const;
     bool CanUseBackward(const Way& way) const;
 
+    inline double GetTime(const ObjectVariantData& objectVariantData,
+                          double distance) const
+    {
+      double speed;
+
+      if (objectVariantData.maxSpeed>0) {
+        speed=objectVariantData.maxSpeed;
+      }
+      else {
+        speed=speeds[objectVariantData.type->GetIndex()];
+      }
+
+      speed=std::min(vehicleMaxSpeed,speed);
+
+      return distance/speed;
+    }
+
     inline double GetTime(const Area& area,
                           double distance) const
     {
@@ -184,6 +209,12 @@ namespace osmscout {
       return currentNode.paths[pathIndex].distance;
     }
 
+    inline double GetCosts(const ObjectVariantData& /*objectVariantData*/,
+                           double distance) const
+    {
+      return distance;
+    }
+
     inline double GetCosts(const Area& /*area*/,
                            double distance) const
     {
@@ -218,21 +249,27 @@ namespace osmscout {
                            const std::vector<ObjectVariantData>& objectVariantData,
                            size_t pathIndex) const
     {
-      double speed;
       size_t index=currentNode.paths[pathIndex].objectIndex;
 
-      if (objectVariantData[currentNode.objects[index].objectVariantIndex].maxSpeed>0) {
-        speed=objectVariantData[currentNode.objects[index].objectVariantIndex].maxSpeed;
+      return GetCosts(objectVariantData[currentNode.objects[index].objectVariantIndex],
+                      currentNode.paths[pathIndex].distance);
+    }
+
+    inline double GetCosts(const ObjectVariantData& objectVariantData,
+                           double distance) const
+    {
+      double speed;
+
+      if (objectVariantData.maxSpeed>0) {
+        speed=objectVariantData.maxSpeed;
       }
       else {
-        TypeInfoRef type=objectVariantData[currentNode.objects[index].objectVariantIndex].type;
-
-        speed=speeds[type->GetIndex()];
+        speed=speeds[objectVariantData.type->GetIndex()];
       }
 
       speed=std::min(vehicleMaxSpeed,speed);
 
-      return currentNode.paths[pathIndex].distance/speed;
+      return distance/speed;
     }
 
     inline double GetCosts(const Area& area,
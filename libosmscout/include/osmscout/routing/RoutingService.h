@@ -22,11 +22,13 @@
 
 #include <atomic>
 #include <functional>
+#include <limits>
 #include <list>
 #include <memory>
 #include <set>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include <osmscout/CoreFeatures.h>
 
@@ -112,6 +114,9 @@ namespace osmscout {
   {
   private:
     bool          debugPerformance;
+    bool          inMemoryGraph;
+    bool          landmarks;
+    bool          segmentIndex;
 
   public:
     RouterParameter();
@@ -119,6 +124,18 @@ namespace osmscout {
     void SetDebugPerformance(bool debug);
 
     bool IsDebugPerformance() const;
+
+    void SetInMemoryGraph(bool inMemoryGraph);
+
+    bool IsInMemoryGraph() const;
+
+    void SetLandmarks(bool landmarks);
+
+    bool IsLandmarks() const;
+
+    void SetSegmentIndex(bool segmentIndex);
+
+    bool IsSegmentIndex() const;
   };
 
   /**
@@ -160,14 +177,43 @@ namespace osmscout {
    */
   class OSMSCOUT_API RoutingParameter CLASS_FINAL
   {
+  public:
+    /**
+     * Data structure used for the open list of the search
+     */
+    enum OpenListType {
+      openListSet,       //!< Balanced tree (std::set) with an index of tree iterators
+      openListDAryHeap,  //!< Indexed 4-ary heap
+      openListRadixHeap  //!< Monotone radix heap, cost estimates must be consistent
+    };
+
   private:
     BreakerRef         breaker;
     RoutingProgressRef progress;
+    bool               bidirectional;
+    OpenListType       openListType;
+    size_t             threadCount;
 
   public:
+    RoutingParameter();
+
     void SetBreaker(const BreakerRef& breaker);
     void SetProgress(const RoutingProgressRef& progress);
 
+    /**
+     * If set, the route is calculated by searching from the start and from the
+     * target at the same time until both searches meet. This visits
+     * considerably less route nodes for long routes. Default is false.
+     *
+     * The search from the target needs the incoming paths of the route nodes,
+     * so the in memory route graph is loaded on the first bidirectional query.
+     */
+    void SetBidirectional(bool bidirectional);
+
+    void SetOpenListType(OpenListType openListType);
+
+    void SetThreadCount(size_t threadCount);
+
     inline BreakerRef GetBreaker() const
     {
       return breaker;
@@ -177,6 +223,21 @@ namespace osmscout {
     {
       return progress;
     }
+
+    inline bool IsBidirectional() const
+    {
+      return bidirectional;
+    }
+
+    inline OpenListType GetOpenListType() const
+    {
+      return openListType;
+    }
+
+    inline size_t GetThreadCount() const
+    {
+      return threadCount;
+    }
   };
 
   /**
@@ -232,6 +293,82 @@ namespace osmscout {
     }
   };
 
+  /**
+   * \ingroup Routing
+   *
+   * Result of a many-to-many calculation. Holds the costs, the distance (in km) and
+   * the duration (in hours) of the cheapest route from every source to every target.
+   * Unreachable targets have infinite costs. This object is always returned, in case
+   * of an error it is empty.
+   */
+  class OSMSCOUT_API RoutingMatrixResult CLASS_FINAL
+  {
+  private:
+    size_t              sourceCount;
+    size_t              targetCount;
+    std::vector<double> costs;
+    std::vector<double> distances;
+    std::vector<double> durations;
+
+  public:
+    RoutingMatrixResult();
+
+    void Initialize(size_t sourceCount,
+                    size_t targetCount);
+
+    inline void Set(size_t source,
+                    size_t target,
+                    double cost,
+                    double distance,
+                    double duration)
+    {
+      size_t index=source*targetCount+target;
+
+      costs[index]=cost;
+      distances[index]=distance;
+      durations[index]=duration;
+    }
+
+    inline size_t GetSourceCount() const
+    {
+      return sourceCount;
+    }
+
+    inline size_t GetTargetCount() const
+    {
+      return targetCount;
+    }
+
+    inline bool IsReachable(size_t source,
+                            size_t target) const
+    {
+      return costs[source*targetCount+target]!=std::numeric_limits<double>::infinity();
+    }
+
+    inline double GetCost(size_t source,
+                          size_t target) const
+    {
+      return costs[source*targetCount+target];
+    }
+
+    inline double GetDistance(size_t source,
+                              size_t target) const
+    {
+      return distances[source*targetCount+target];
+    }
+
+    inline double GetDuration(size_t source,
+                              size_t target) const
+    {
+      return durations[source*targetCount+target];
+    }
+
+    inline bool Success() const
+    {
+      return !costs.empty();
+    }
+  };
+
   /**
    * \ingroup Routing
    *
@@ -258,8 +395,11 @@ namespace osmscout {
 
       bool          access;        //!< Flags to signal, if we had access ("access restrictions") to this node
 
+      size_t        openListIndex; //!< Position of the node in the open list, used by heap based open lists
+
       RNode()
-      : nodeOffset()
+      : nodeOffset(),
+        openListIndex(0)
       {
         // no code
       }
@@ -274,7 +414,8 @@ namespace osmscout {
         currentCost(0),
         estimateCost(0),
         overallCost(0),
-        access(true)
+        access(true),
+        openListIndex(0)
       {
         // no code
       }
@@ -290,7 +431,8 @@ namespace osmscout {
         currentCost(0),
         estimateCost(0),
         overallCost(0),
-        access(true)
+        access(true),
+        openListIndex(0)
       {
         // no code
       }
@@ -400,10 +542,181 @@ namespace osmscout {
       }
     };
 
-    typedef std::set<RNodeRef,RNodeCostCompare>           OpenList;
-    typedef std::set<RNodeRef,RNodeCostCompare>::iterator OpenListRef;
+    /**
+     * The open list of the search: the routing nodes that have been reached, but
+     * not yet handled, ordered by their overall costs (ties are resolved by the
+     * route node file offset, see RNodeCostCompare). There is at most one node
+     * per route node file offset.
+     *
+     * There are different implementations, see RoutingParameter::SetOpenListType().
+     */
+    class OSMSCOUT_API OpenList
+    {
+    public:
+      virtual ~OpenList();
+
+      virtual bool IsEmpty() const = 0;
+      virtual size_t GetSize() const = 0;
+
+      /**
+       * Return the node with the lowest costs without removing it
+       */
+      virtual RNodeRef GetTop() const = 0;
+
+      /**
+       * Remove and return the node with the lowest costs
+       */
+      virtual RNodeRef Pop() = 0;
+
+      /**
+       * Add the node. If there already is a node with the same file offset, the
+       * node with the lower current costs is kept.
+       */
+      virtual void Push(const RNodeRef& node) = 0;
+
+      /**
+       * Change the costs of the given node, which must be part of the open list
+       */
+      virtual void UpdateCosts(const RNodeRef& node,
+                               double currentCost,
+                               double estimateCost,
+                               double overallCost) = 0;
+
+      /**
+       * Return the node with the given file offset or an empty reference
+       */
+      virtual RNodeRef Find(const DBFileOffset& offset) const = 0;
+
+      virtual void GetNodes(std::vector<RNodeRef>& nodes) const = 0;
+
+      /**
+       * Remove all nodes, keeping the allocated memory for reuse
+       */
+      virtual void Clear() = 0;
+    };
+
+    typedef std::shared_ptr<OpenList> OpenListRef;
+
+    /**
+     * OpenList using a std::set and a hash map of set iterators
+     */
+    class OSMSCOUT_API SetOpenList CLASS_FINAL : public OpenList
+    {
+    private:
+      typedef std::set<RNodeRef,RNodeCostCompare> NodeSet;
+
+    private:
+      NodeSet                                           nodes;
+      std::unordered_map<DBFileOffset,NodeSet::iterator> index;
+
+    public:
+      bool IsEmpty() const override;
+      size_t GetSize() const override;
+      RNodeRef GetTop() const override;
+      RNodeRef Pop() override;
+      void Push(const RNodeRef& node) override;
+      void UpdateCosts(const RNodeRef& node,
+                       double currentCost,
+                       double estimateCost,
+                       double overallCost) override;
+      RNodeRef Find(const DBFileOffset& offset) const override;
+      void GetNodes(std::vector<RNodeRef>& nodes) const override;
+      void Clear() override;
+    };
+
+    /**
+     * OpenList using an indexed 4-ary min heap. The heap holds the sort key of
+     * each node, so sifting does not need to access the nodes except for
+     * updating RNode::openListIndex.
+     */
+    class OSMSCOUT_API DAryHeapOpenList CLASS_FINAL : public OpenList
+    {
+    private:
+      struct Entry
+      {
+        double       overallCost;
+        DBFileOffset nodeOffset;
+        RNode*       node;
+
+        inline bool operator<(const Entry& other) const
+        {
+          if (overallCost==other.overallCost) {
+            return nodeOffset<other.nodeOffset;
+          }
+
+          return overallCost<other.overallCost;
+        }
+      };
+
+    private:
+      std::vector<Entry>                         heap;
+      std::unordered_map<DBFileOffset,RNodeRef>  index; //!< Owns the nodes in the heap
+
+    private:
+      void Place(const Entry& entry,
+                 size_t position);
+      void SiftUp(size_t position);
+      void SiftDown(size_t position);
+      void Remove(size_t position);
+
+    public:
+      bool IsEmpty() const override;
+      size_t GetSize() const override;
+      RNodeRef GetTop() const override;
+      RNodeRef Pop() override;
+      void Push(const RNodeRef& node) override;
+      void UpdateCosts(const RNodeRef& node,
+                       double currentCost,
+                       double estimateCost,
+                       double overallCost) override;
+      RNodeRef Find(const DBFileOffset& offset) const override;
+      void GetNodes(std::vector<RNodeRef>& nodes) const override;
+      void Clear() override;
+    };
+
+    /**
+     * OpenList using a radix heap on the bit pattern of the overall costs.
+     *
+     * The radix heap requires that no node is added with costs lower than
+     * the costs of the last node taken from the list, which holds for
+     * consistent cost estimates. Nodes violating this are handled as if they had
+     * the costs of the last node taken.
+     */
+    class OSMSCOUT_API RadixHeapOpenList CLASS_FINAL : public OpenList
+    {
+    private:
+      static const size_t bucketCount=65;
+
+    private:
+      std::vector<RNode*>                        buckets[bucketCount];
+      uint64_t                                   last;  //!< Key of the last minimum
+      size_t                                     size;
+      std::unordered_map<DBFileOffset,RNodeRef>  index; //!< Owns the nodes in the buckets
+
+    private:
+      static uint64_t GetKey(double cost);
+      size_t GetBucket(const RNode& node) const;
+      void Insert(RNode* node);
+      void Remove(RNode* node);
+      void Normalize();
+
+    public:
+      RadixHeapOpenList();
+
+      bool IsEmpty() const override;
+      size_t GetSize() const override;
+      RNodeRef GetTop() const override;
+      RNodeRef Pop() override;
+      void Push(const RNodeRef& node) override;
+      void UpdateCosts(const RNodeRef& node,
+                       double currentCost,
+                       double estimateCost,
+                       double overallCost) override;
+      RNodeRef Find(const DBFileOffset& offset) const override;
+      void GetNodes(std::vector<RNodeRef>& nodes) const override;
+      void Clear() override;
+    };
 
-    typedef std::unordered_map<DBFileOffset,OpenListRef>  OpenMap;
     typedef std::unordered_set<VNode,ClosedNodeHasher>    ClosedSet;
 
   public:
@@ -419,6 +732,8 @@ namespace osmscout {
     static std::string GetData2Filename(const std::string& filenamebase);
     static std::string GetIndexFilename(const std::string& filenamebase);
 
+    static OpenListRef CreateOpenList(const RoutingParameter& parameter);
+
   public:
     RoutingService();
     virtual ~RoutingService();
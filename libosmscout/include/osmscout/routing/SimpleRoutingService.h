@@ -23,10 +23,13 @@
 #include <atomic>
 #include <functional>
 #include <list>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include <osmscout/CoreFeatures.h>
 
@@ -43,8 +46,11 @@
 
 // Routing
 #include <osmscout/Intersection.h>
+#include <osmscout/routing/Landmarks.h>
 #include <osmscout/routing/Route.h>
 #include <osmscout/routing/RouteData.h>
+#include <osmscout/routing/RouteGraph.h>
+#include <osmscout/routing/RouteSegmentIndex.h>
 #include <osmscout/routing/RoutingProfile.h>
 #include <osmscout/routing/RoutingService.h>
 #include <osmscout/routing/AbstractRoutingService.h>
@@ -63,16 +69,135 @@ namespace osmscout {
    * The RoutingService implements functionality in the context of routing.
    * The following functions are available:
    * - Calculation of a route from a start node to a target node
+   * - Calculation of a batch of routes in parallel
    * - Transformation of the resulting route to a Way
    * - Transformation of the resulting route to a simple list of points
    * - Transformation of the resulting route to a routing description with is the base
    * for further transformations to a textual or visual description of the route
    * - Returning the closest routeable node to  given geolocation
+   *
+   * After Open() routes may be calculated concurrently from multiple threads using
+   * the same instance. Each running query takes its search state from a pool, so
+   * the memory of the open list and the closed sets is reused between queries.
    */
   class OSMSCOUT_API SimpleRoutingService: public AbstractRoutingService<RoutingProfile>
   {
+  public:
+    /**
+     * Start and target of one route of a batch, see CalculateRoutes()
+     */
+    struct Request
+    {
+      RoutePosition start;
+      RoutePosition target;
+    };
+
+    /**
+     * Tree of the cheapest routes to one target from all paths of the route graph
+     * that reach the target within the cost limit of the tree, see
+     * CalculateTargetTree() and Reroute(). Paths are addressed by their index in the
+     * route graph, only paths within the cost limit are stored. The tree is only
+     * valid for the profile it was calculated for.
+     */
+    struct TargetTree
+    {
+      static const uint32_t NO_PATH; //!< Next path of a path ending at the target
+
+      /**
+       * Costs of a path of the tree and the path to take after it
+       */
+      struct PathLabel
+      {
+        double   cost; //!< Costs from entering the path to the target
+        uint32_t next; //!< Path to take after the path, NO_PATH if the path ends at the target
+      };
+
+      RoutePosition                           target;         //!< The target of all routes
+      GeoCoord                                targetCoord;    //!< Coordinate of the target
+      uint32_t                                targetNodes[2]; //!< Route nodes next to the target, RouteGraph::INVALID_NODE if unused
+      size_t                                  pathCount;      //!< Number of paths of the route graph the tree was calculated on
+      double                                  costLimit;      //!< Maximum costs of a path of the tree
+      std::unordered_map<uint32_t,PathLabel>  paths;          //!< The paths reaching the target within the cost limit
+
+      inline bool IsTargetNode(uint32_t node) const
+      {
+        return node==targetNodes[0] ||
+               node==targetNodes[1];
+      }
+    };
+
+    typedef std::shared_ptr<TargetTree> TargetTreeRef;
+
+  protected:
+    /**
+     * A route node next to a source or target position of a matrix calculation
+     * together with the costs, distance and duration between the position and the
+     * route node
+     */
+    struct MatrixAnchor
+    {
+      size_t   position; //!< Index of the source or target position
+      uint32_t node;     //!< Index of the route node in the route graph
+      double   cost;
+      double   distance;
+      double   duration;
+    };
+
+    /**
+     * State of a route node during a matrix search. Like GraphSearchNode, but
+     * without an estimate and with the distance and duration of the labels.
+     */
+    struct MatrixSearchNode
+    {
+      double        cost;      //!< Cost of the open label
+      double        distance;  //!< Distance of the open label
+      double        duration;  //!< Duration of the open label
+      uint32_t      prev;      //!< Previous node of the open label
+      ObjectFileRef object;    //!< Object used to reach the node by the open label
+      bool          access;    //!< Access state of the open label
+      bool          open;      //!< The node has an open label
+      bool          closed[2]; //!< Closed with access restriction ([0]) or without ([1])
+    };
+
+    /**
+     * Search state of one matrix worker thread, reset between sources using
+     * the list of touched nodes
+     */
+    struct MatrixSearch
+    {
+      std::vector<MatrixSearchNode>  nodes;
+      std::vector<uint32_t>          touched;
+      std::vector<GraphSearchEntry>  heap;    //!< Binary min heap of (cost, node), may contain outdated entries
+
+      void Init(size_t nodeCount);
+
+      /**
+       * Remember the node for resetting, must be called before the node gets
+       * its first label
+       */
+      inline void Touch(uint32_t node)
+      {
+        if (!nodes[node].open &&
+            !nodes[node].closed[0] &&
+            !nodes[node].closed[1]) {
+          touched.push_back(node);
+        }
+      }
+    };
+
+    /**
+     * The targets of a matrix calculation, grouped into buckets by the route nodes
+     * next to the targets. Shared read-only by all matrix worker threads.
+     */
+    struct MatrixTargets
+    {
+      std::vector<MatrixAnchor> anchors;     //!< Target anchors, sorted by route node
+      std::vector<bool>         bucketNodes; //!< Route node has a non-empty bucket
+      size_t                    bucketCount; //!< Number of route nodes with a bucket
+      std::vector<GeoCoord>     coords;      //!< Coordinates of the target positions
+    };
 
-  private:
+  protected:
     DatabaseRef                          database;              //!< Database object, holding all index and data files
     std::string                          filenamebase;          //!< Common base name for all router files
     AccessFeatureValueReader             accessReader;          //!< Read access information from objects
@@ -82,7 +207,16 @@ namespace osmscout {
 
     IndexedDataFile<Id,RouteNode>        routeNodeDataFile;     //!< Cached access to the 'route.dat' file
     IndexedDataFile<Id,Intersection>     junctionDataFile;      //!< Cached access to the 'junctions.dat' file
+    std::mutex                           junctionDataFileMutex; //!< Mutex to make lazy initialisation of the junction DataFile thread-safe
     ObjectVariantDataFile                objectVariantDataFile; //!< DataFile class for loading object variant data
+    bool                                 inMemoryGraph;         //!< Load the routing graph into memory on Open()
+    RouteGraph                           routeGraph;            //!< The in memory routing graph, if inMemoryGraph is set
+    std::mutex                           routeGraphMutex;       //!< Mutex to make lazy loading of the route graph thread-safe
+    bool                                 useLandmarks;          //!< Use the landmarks of the vehicle for the estimate
+    std::map<Vehicle,LandmarksRef>       landmarks;             //!< Landmarks per vehicle, NULL if there are none
+    std::mutex                           landmarksMutex;        //!< Mutex to make lazy loading of the landmarks thread-safe
+    bool                                 useSegmentIndex;       //!< Load the segment index of the routable ways on Open()
+    RouteSegmentIndex                    segmentIndex;          //!< The segment index, if useSegmentIndex is set and the index exists
 
   protected:
     virtual Vehicle GetVehicle(const RoutingProfile& profile);
@@ -110,6 +244,25 @@ namespace osmscout {
                             const WayRef &way,
                             double wayLength);
 
+    virtual bool CanUse(const RoutingProfile& profile,
+                        const DatabaseId database,
+                        const RouteGraph& graph,
+                        uint32_t path);
+
+    virtual double GetCosts(const RoutingProfile& profile,
+                            const DatabaseId database,
+                            const RouteGraph& graph,
+                            uint32_t path);
+
+    virtual const RouteGraph* GetRouteGraph(const DatabaseId database);
+
+    bool LoadRouteGraph();
+
+    bool LoadSegmentIndex();
+
+    virtual const Landmarks* GetLandmarks(const RoutingProfile& profile,
+                                          const DatabaseId database);
+
     virtual double GetEstimateCosts(const RoutingProfile& profile,
                                     const DatabaseId database,
                                     double targetDistance);
@@ -151,18 +304,37 @@ namespace osmscout {
     virtual std::vector<DBFileOffset> GetNodeTwins(const RoutingProfile& state,
                                                    const DatabaseId database,
                                                    const Id id);
+
+    bool GetMatrixAnchors(const RoutingProfile& profile,
+                          const RoutePosition& position,
+                          size_t positionIndex,
+                          bool isSource,
+                          GeoCoord& coord,
+                          std::vector<MatrixAnchor>& anchors);
+
+    void CalculateMatrixRow(const RoutingProfile& profile,
+                            const MatrixTargets& targets,
+                            size_t source,
+                            const RoutePosition& sourcePosition,
+                            const std::vector<MatrixAnchor>& sourceAnchors,
+                            const GeoCoord& sourceCoord,
+                            MatrixSearch& search,
+                            RoutingMatrixResult& result);
+
   public:
     SimpleRoutingService(const DatabaseRef& database,
                          const RouterParameter& parameter,
                          const std::string& filenamebase);
     virtual ~SimpleRoutingService();
 
-    bool Open();
+    virtual bool Open();
     bool IsOpen() const;
-    void Close();
+    virtual void Close();
 
     TypeConfigRef GetTypeConfig() const;
 
+    virtual const RouteGraph* RequireRouteGraph(const DatabaseId database);
+
     /**
      * Calculate a route
      *
@@ -189,10 +361,34 @@ namespace osmscout {
                                  double radius,
                                  const RoutingParameter& parameter);
 
+    std::vector<RoutingResult> CalculateRoutes(RoutingProfile& profile,
+                                               const std::vector<Request>& requests,
+                                               const RoutingParameter& parameter);
+
+    TargetTreeRef CalculateTargetTree(RoutingProfile& profile,
+                                      const RoutePosition& target,
+                                      double maxDistance,
+                                      const RoutingParameter& parameter);
+
+    RoutingResult Reroute(RoutingProfile& profile,
+                          const RoutePosition& start,
+                          const TargetTree& tree,
+                          const RoutingParameter& parameter);
+
+    RoutingMatrixResult CalculateMatrix(const RoutingProfile& profile,
+                                        const std::vector<RoutePosition>& sources,
+                                        const std::vector<RoutePosition>& targets,
+                                        const RoutingParameter& parameter);
+
     RoutePosition GetClosestRoutableNode(const GeoCoord& coord,
                                          const RoutingProfile& profile,
                                          double& radius) const;
 
+    bool GetClosestRoutableSegment(const GeoCoord& coord,
+                                   const RoutingProfile& profile,
+                                   double radius,
+                                   RouteSegmentMatch& match) const;
+
     void DumpStatistics();
   };
 
@@ -35,4 +35,14 @@
  */
 #define unused(x) ((void)(x))
 
+/**
+ * Hint the processor to load the cache line containing the given address
+ * in advance. Does nothing for compilers without support.
+ */
+#if defined(__GNUC__) || defined(__clang__)
+  #define OSMSCOUT_PREFETCH(address) __builtin_prefetch(address)
+#else
+  #define OSMSCOUT_PREFETCH(address) ((void)(address))
+#endif
+
 #endif
@@ -20,6 +20,8 @@
   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
 */
 
+#include <cstring>
+
 #include <osmscout/CoreFeatures.h>
 
 #include <osmscout/system/Math.h>
@@ -418,5 +420,61 @@ inline double atanh_sin_pd(double x, double y, double& res_x, double& res_y){
   return x;
 }
 
+//load 4 little endian, signed deltas of 1, 2 or 4 bytes and sign extend them to 32 bit
+inline v2di load_deltas_epi32(const uint8_t* deltas, size_t bytes){
+  if (bytes==1) {
+    int32_t packed;
+    memcpy(&packed, deltas, 4);
+    v2di x = _mm_cvtsi32_si128(packed);
+    //move each byte to the highest byte of its 32 bit lane, then shift back with sign
+    x = _mm_unpacklo_epi8(x, x);
+    x = _mm_unpacklo_epi16(x, x);
+    return _mm_srai_epi32(x, 24);
+  }
+  else if (bytes==2) {
+    v2di x = _mm_loadl_epi64(reinterpret_cast<const v2di*>(deltas));
+    x = _mm_unpacklo_epi16(x, x);
+    return _mm_srai_epi32(x, 16);
+  }
+
+  return _mm_loadu_si128(reinterpret_cast<const v2di*>(deltas));
+}
+
+//inclusive prefix sum of the 4 32 bit lanes, plus the value in all lanes of carry
+inline v2di prefix_sum_epi32(v2di x, v2di carry){
+  x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+  x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+  return _mm_add_epi32(x, carry);
+}
+
+//decode a column of little endian, signed deltas of 1, 2 or 4 bytes, 4 deltas per iteration.
+//value is the raw value before the first delta, coords[i] gets value_i/conversionFactor-offset
+//for each raw value. Returns the number of decoded deltas, which is count rounded down
+//to a multiple of 4, value returns the last decoded raw value.
+//Raw coordinate values use 27 bit, so signed 32 bit arithmetic and conversion is safe.
+inline size_t decode_delta_column_pd(const uint8_t* deltas, size_t bytes, size_t count,
+                                     uint32_t& value, double conversionFactor, double offset,
+                                     double* coords){
+  v2di carry = _mm_set1_epi32(static_cast<int32_t>(value));
+  v2df factor = _mm_set1_pd(conversionFactor);
+  v2df off = _mm_set1_pd(offset);
+  size_t i = 0;
+
+  for (; i+4 <= count; i += 4) {
+    v2di x = prefix_sum_epi32(load_deltas_epi32(deltas+i*bytes, bytes), carry);
+    v2df low = _mm_sub_pd(_mm_div_pd(_mm_cvtepi32_pd(x), factor), off);
+    v2df high = _mm_sub_pd(_mm_div_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(x, _MM_SHUFFLE(3, 2, 3, 2))), factor), off);
+
+    _mm_storeu_pd(coords+i, low);
+    _mm_storeu_pd(coords+i+2, high);
+
+    carry = _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3));
+  }
+
+  value = static_cast<uint32_t>(_mm_cvtsi128_si32(carry));
+
+  return i;
+}
+
 }
 #endif
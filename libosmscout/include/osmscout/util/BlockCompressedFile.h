@@ -0,0 +1,180 @@
+#ifndef OSMSCOUT_UTIL_BLOCKCOMPRESSEDFILE_H
+#define OSMSCOUT_UTIL_BLOCKCOMPRESSEDFILE_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2017  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <osmscout/private/CoreImportExport.h>
+
+#include <osmscout/Types.h>
+
+#include <osmscout/util/Cache.h>
+#include <osmscout/util/CacheManager.h>
+
+#include <osmscout/system/Compiler.h>
+
+namespace osmscout {
+
+  /**
+   * \ingroup File
+   *
+   * Thread-safe CLOCK cache of inflated blocks of one block compressed file, limited
+   * by the memory of the cached blocks.
+   *
+   * All readers of the same file (e.g. the scanner pool of a DataFile) can share one
+   * instance, so every block is only inflated and held in memory once. The cache can be
+   * registered with a CacheManager.
+   */
+  class OSMSCOUT_API BlockCompressedFileCache CLASS_FINAL : private CacheManager::Client
+  {
+  public:
+    typedef std::shared_ptr<const std::vector<char>> BlockRef;
+
+  private:
+    typedef Cache<size_t,BlockRef> BlockCache;
+
+  private:
+    mutable std::mutex mutex;        //!< Mutex to secure multi-thread access to the cache
+    BlockCache         cache;        //!< Inflated blocks by block index
+    CacheManagerRef    cacheManager; //!< Optional cache manager
+
+  private:
+    size_t TrimCache(size_t memory) override;
+
+  public:
+    explicit BlockCompressedFileCache(size_t cacheMemory);
+    ~BlockCompressedFileCache() override;
+
+    void SetCacheManager(const CacheManagerRef& cacheManager);
+
+    bool GetBlock(size_t index,
+                  BlockRef& block);
+    void StoreBlock(size_t index,
+                    const BlockRef& block);
+    void Flush();
+
+    size_t GetMemory() const;
+  };
+
+  typedef std::shared_ptr<BlockCompressedFileCache> BlockCompressedFileCacheRef;
+
+  /**
+   * \ingroup File
+   *
+   * Random access reader for block compressed files.
+   *
+   * A block compressed file holds the content of an ordinary data file split into
+   * blocks of a fixed (uncompressed) size, each block compressed independently. It has
+   * the following layout (all numbers in little endian byte order):
+   *
+   * * 8 bytes magic ("OSMSBCF1")
+   * * uint32_t uncompressed block size
+   * * uint64_t uncompressed file size
+   * * uint32_t number of blocks
+   * * number of blocks+1 uint64_t file offsets of the compressed blocks, the last
+   *   entry is the end of the last block
+   * * the compressed blocks
+   *
+   * Offsets passed to Read() are offsets into the uncompressed data, so indexes pointing
+   * into the original file stay valid. Blocks are inflated on demand and held in a
+   * BlockCompressedFileCache, that might be shared with other readers of the same file.
+   *
+   * The reader does not own the file handle and changes its position.
+   */
+  class OSMSCOUT_API BlockCompressedFileReader CLASS_FINAL
+  {
+  public:
+    static const char   MAGIC[8];
+    static const size_t DEFAULT_BLOCK_SIZE;
+    static const size_t MAX_BLOCK_SIZE;
+    static const size_t DEFAULT_CACHE_MEMORY;
+
+  private:
+    std::string                        filename;            //!< Filename, for error messages
+    std::FILE                          *file;               //!< The file handle, not owned
+    size_t                             blockSize;           //!< Uncompressed size of a block
+    FileOffset                         size;                //!< Uncompressed size of the file
+    std::vector<FileOffset>            blockOffsets;        //!< File offsets of the compressed blocks (plus end offset)
+    BlockCompressedFileCacheRef        blockCache;          //!< Cache of inflated blocks, possibly shared with other readers
+    std::vector<char>                  compressedBuffer;    //!< Temporary buffer for reading compressed blocks
+    size_t                             currentBlockIndex;   //!< Index of the block last returned by GetBlock()
+    BlockCompressedFileCache::BlockRef currentBlock;        //!< Block last returned by GetBlock(), or empty
+    size_t                             inflatedBlocks;      //!< Number of blocks inflated by this reader, for statistics
+    FileOffset                         compressedBytesRead; //!< Number of compressed bytes read, for statistics
+
+  private:
+    const std::vector<char>& GetBlock(size_t index);
+
+  public:
+    BlockCompressedFileReader(const std::string& filename,
+                              std::FILE* file,
+                              const BlockCompressedFileCacheRef& blockCache);
+
+    static bool IsBlockCompressed(std::FILE* file);
+    static bool IsValidBlockSize(size_t blockSize);
+
+    void Open();
+
+    size_t Read(FileOffset pos,
+                void* data,
+                size_t bytes);
+
+    /**
+     * Returns the size of the uncompressed data
+     */
+    inline FileOffset GetSize() const
+    {
+      return size;
+    }
+
+    inline size_t GetBlockSize() const
+    {
+      return blockSize;
+    }
+
+    inline size_t GetBlockCount() const
+    {
+      return blockOffsets.size()-1;
+    }
+
+    inline size_t GetInflatedBlocks() const
+    {
+      return inflatedBlocks;
+    }
+
+    inline FileOffset GetCompressedBytesRead() const
+    {
+      return compressedBytesRead;
+    }
+  };
+
+  extern OSMSCOUT_API bool IsBlockCompressionSupported();
+
+  extern OSMSCOUT_API void CompressFileInBlocks(const std::string& sourceFilename,
+                                                const std::string& destinationFilename,
+                                                size_t blockSize=BlockCompressedFileReader::DEFAULT_BLOCK_SIZE);
+}
+
+#endif
@@ -23,7 +23,6 @@
 #include <osmscout/CoreFeatures.h>
 
 #include <limits>
-#include <list>
 #include <unordered_map>
 #include <vector>
 
@@ -37,7 +36,7 @@ namespace osmscout {
 
   /**
    * \ingroup Util
-   * Generic FIFO cache implementation with O(n log n) semantic.
+   * Generic cache implementation with CLOCK replacement semantic.
    *
    * Template parameter class K holds the key value (must be a numerical value),
    * parameter class V holds the data class that is to be cached,
@@ -45,19 +44,27 @@ namespace osmscout {
    * default is PageId.
    *
    * * The cache is not threadsafe.
-   * * It uses a std::vector<std::list>> as a hash table for data lookup
-   * * It uses an std::list for implementing FIFO characteristics.
+   * * It uses a std::unordered_map for fast (O(1)) detection, if an object is
+   *   already in the cache.
+   * * Entries are stored in one contiguous array of slots. Instead of reordering
+   *   entries on every access (LRU), an access only sets the reference bit of the
+   *   slot. On eviction a clock hand sweeps over the slots, clearing the reference bits,
+   *   and evicts the first entry that was not referenced since the last sweep.
    *
-   * Implementation details: If std::unordered_map ist available we use this
-   * for fast detection (O(1)) if an object is already in the cast. If it is not
-   * available, we use a vector as a hashtable via the key value with list
-   * as entry type for hash code conflict handling.
+   * The size of the cache can be limited by the number of entries and by the
+   * memory used by the cached values. The memory of an individual value has to be passed
+   * by the caller on insertion (or defaults to sizeof(V)), so that cheap and expensive objects
+   * are weighted differently. A cache that should only be limited by memory passes
+   * Cache::NO_SIZE_LIMIT as maximum number of entries.
    *
+   * For statistics the cache counts the number of hits and misses.
    */
   template <class K, class V, class IK = PageId>
   class Cache
   {
   public:
+    static const size_t NO_SIZE_LIMIT=std::numeric_limits<size_t>::max(); //!< Maximum number of entries for caches only limited by memory
+
     /**
       An individual entry in the cache.
       */
@@ -66,6 +73,13 @@ namespace osmscout {
       K key;
       V value;
 
+      CacheEntry()
+      : key(),
+        value()
+      {
+        // no code
+      }
+
       CacheEntry(const CacheEntry& entry)
       : key(entry.key),
         value(entry.value)
@@ -86,12 +100,14 @@ namespace osmscout {
       {
         // no code
       }
+
+      CacheEntry& operator=(const CacheEntry& other) = default;
     };
 
     /**
       ValueSizer returns the size (in bytes) of an individual cache value.
-      An implementation of ValueSizer has to be passed in the constructor of the cache
-      to implement the GetSize() method.
+      An implementation of ValueSizer can be passed to GetMemory() to
+      calculate the memory of the cache by actually visiting all values.
       */
     class ValueSizer
     {
@@ -101,16 +117,46 @@ namespace osmscout {
       virtual size_t GetSize(const V& value) const = 0;
     };
 
-    typedef std::list<CacheEntry>                              OrderList;
-    typedef typename OrderList::iterator                       CacheRef;
-    typedef std::unordered_map<K,typename OrderList::iterator> Map;
+    /**
+     * Reference to a cache entry. The reference is only valid until the next
+     * call to SetEntry(), SetMaxSize(), SetMaxMemory() or Flush().
+     */
+    typedef CacheEntry*                      CacheRef;
+    typedef std::unordered_map<K,size_t>     Map;
+
+  private:
+    /**
+     * A slot in the contiguous entry storage
+     */
+    struct Slot
+    {
+      CacheEntry entry;      //!< The cached entry
+      size_t     memory;     //!< Memory of the cached value (in bytes)
+      bool       used;       //!< true, if the slot holds an entry
+      bool       referenced; //!< true, if the slot was accessed since the last sweep of the clock hand
+
+      Slot()
+      : memory(0),
+        used(false),
+        referenced(false)
+      {
+        // no code
+      }
+    };
 
   private:
-    size_t    size;
-    size_t    maxSize;
-    OrderList order;
-    Map       map;
-    CacheRef  previousEntry;
+    size_t              size;          //!< Number of entries in the cache
+    size_t              maxSize;       //!< Maximum number of entries
+    size_t              memory;        //!< Memory of all cached values
+    size_t              maxMemory;     //!< Maximum memory of all cached values, 0 for no limit
+    std::vector<Slot>   slots;         //!< Contiguous entry storage
+    std::vector<size_t> freeSlots;     //!< Indexes of currently unused slots
+    size_t              hand;          //!< Current position of the clock hand
+    Map                 map;           //!< Map of key to slot index
+    CacheEntry          inactiveEntry; //!< Returned by SetEntry() if the cache is not active
+
+    size_t              hits;          //!< Number of successful lookups
+    size_t              misses;        //!< Number of unsuccessful lookups
 
   private:
 
@@ -119,37 +165,92 @@ namespace osmscout {
       return key - std::numeric_limits<K>::min();
     }
 
+    inline bool IsFull(size_t additionalMemory) const
+    {
+      return size+1>maxSize ||
+             (maxMemory>0 && memory+additionalMemory>maxMemory);
+    }
+
     /**
-      Clear the cache deleting the oldest cache entries
-      until it has the given max size.
-      */
-    void StripCache()
+     * Remove the entry in the given slot
+     */
+    void RemoveSlot(size_t index)
     {
-      while (size>maxSize) {
-        // Remove oldest entry from cache...
+      Slot& slot=slots[index];
 
-        // Get oldest entry an dremove it from the map
-        map.erase(map.find(order.back().key));
+      map.erase(slot.entry.key);
 
-        // Remove it from order list
-        order.pop_back();
+      slot.entry.value=V();
+      slot.used=false;
+      slot.referenced=false;
 
-        previousEntry=order.end();
+      memory-=slot.memory;
+      slot.memory=0;
+
+      freeSlots.push_back(index);
+
+      size--;
+    }
+
+    /**
+     * Move the clock hand forward until a slot is found that was not referenced since the last
+     * sweep and remove its entry.
+     */
+    void EvictEntry()
+    {
+      assert(size>0);
 
-        size--;
+      while (true) {
+        if (hand>=slots.size()) {
+          hand=0;
+        }
+
+        Slot& slot=slots[hand];
+
+        if (slot.used) {
+          if (!slot.referenced) {
+            RemoveSlot(hand);
+            hand++;
+            return;
+          }
+
+          slot.referenced=false;
+        }
+
+        hand++;
+      }
+    }
+
+    /**
+      Clear the cache evicting entries until it fits the given
+      limits.
+      */
+    void StripCache()
+    {
+      while (size>maxSize ||
+             (maxMemory>0 && memory>maxMemory)) {
+        EvictEntry();
       }
     }
 
   public:
     /**
-     Create a new cache object with the given max size.
+     Create a new cache object with the given max number of entries and
+     the given maximum memory (0 for no memory limit).
       */
-    Cache(size_t maxSize)
+    explicit Cache(size_t maxSize,
+                   size_t maxMemory=0)
      : size(0),
-       maxSize(maxSize)
+       maxSize(maxSize),
+       memory(0),
+       maxMemory(maxMemory),
+       hand(0),
+       hits(0),
+       misses(0)
     {
-      map.reserve(maxSize);
-      previousEntry=order.end();
+      if (maxSize!=NO_SIZE_LIMIT) {
+        map.reserve(maxSize);
+      }
     }
 
     /**
@@ -167,8 +268,8 @@ namespace osmscout {
       returned and the reference will be untouched.
 
       If there is a value with the given key, reference will return
-      a reference to the value and the value will moved to the
-      front position of the cache to assure FIFO behaviour.
+      a reference to the value and the value will be marked as recently
+      referenced.
       */
     bool GetEntry(const K& key,
                   CacheRef& reference)
@@ -177,74 +278,112 @@ namespace osmscout {
         return false;
       }
 
-      if (previousEntry!=order.end() &&
-          previousEntry->key==key) {
-        reference=previousEntry;
-        return true;
-      }
-
-      typename Map::iterator iter=map.find(key);
+      typename Map::const_iterator iter=map.find(key);
 
-      if (iter!=map.end()) {
-        // Move key/value to the start of the order list
-        order.splice(order.begin(),order,iter->second);
-
-        // Update the map with the new iterator into the order list
-        iter->second=order.begin();
+      if (iter==map.end()) {
+        misses++;
+        return false;
+      }
 
-        reference=order.begin();
-        previousEntry=reference;
+      Slot& slot=slots[iter->second];
 
-        return true;
-      }
+      slot.referenced=true;
+      reference=&slot.entry;
+      hits++;
 
-      return false;
+      return true;
     }
 
     /**
       Set or update the cache with the given value for the given key.
 
-      If the key is not available in the cache the value will be added
-      to the front of the cache (FIFO semantic) else the value will be updated
-      (also moving it to the front of the cache (FIFO again).
+      If the key is not available in the cache the value will be added,
+      possibly evicting other entries to stay within the size limits, else
+      the value will be updated.
+
+      The passed memory is the (estimated) memory in bytes used by the
+      value.
       */
-    typename Cache::CacheRef SetEntry(const CacheEntry& entry)
+    CacheRef SetEntry(const CacheEntry& entry,
+                      size_t valueMemory)
     {
-      if (!IsActive()) {
-        order.clear();
-
-        order.push_front(entry);
+      if (!IsActive() ||
+          (maxMemory>0 && valueMemory>maxMemory)) {
+        inactiveEntry=entry;
 
-        return order.begin();
+        return &inactiveEntry;
       }
 
-      typename Map::iterator iter=map.find(entry.key);
+      typename Map::const_iterator iter=map.find(entry.key);
 
       if (iter!=map.end()) {
-        // Move key/value to the start of the order list
-        order.splice(order.begin(),order,iter->second);
+        Slot& slot=slots[iter->second];
 
-        // Update the map with the new iterator into the order list
-        iter->second=order.begin();
+        slot.entry.value=entry.value;
+        slot.referenced=true;
 
-        order.front().value=entry.value;
-      }
-      else {
-        // Place key/value to the start of the order list
-        order.push_front(entry);
-        size++;
-        // Update the map with the new iterator into the order list
-        map[entry.key]=order.begin();
+        memory-=slot.memory;
+        slot.memory=valueMemory;
+        memory+=valueMemory;
 
         StripCache();
+
+        // Our own entry might have been evicted in the unlikely case that all other entries are smaller
+        iter=map.find(entry.key);
+
+        if (iter==map.end()) {
+          inactiveEntry=entry;
+
+          return &inactiveEntry;
+        }
+
+        return &slots[iter->second].entry;
+      }
+
+      while (size>0 &&
+             IsFull(valueMemory)) {
+        EvictEntry();
+      }
+
+      size_t index;
+
+      if (!freeSlots.empty()) {
+        index=freeSlots.back();
+        freeSlots.pop_back();
       }
+      else {
+        index=slots.size();
+        slots.push_back(Slot());
+      }
+
+      Slot& slot=slots[index];
+
+      slot.entry=entry;
+      slot.memory=valueMemory;
+      slot.used=true;
+      slot.referenced=false;
 
-      return order.begin();
+      map[entry.key]=index;
+
+      size++;
+      memory+=valueMemory;
+
+      return &slot.entry;
+    }
+
+    /**
+      Set or update the cache with the given value for the given key,
+      assuming that the value uses sizeof(V) bytes.
+      */
+    CacheRef SetEntry(const CacheEntry& entry)
+    {
+      return SetEntry(entry,
+                      sizeof(V));
     }
 
     /**
-      Set a new cache max size, possible striping the oldest entries
-      from cache if the new size is smaller than the old one.
+      Set a new cache max size, possibly evicting entries
+      from the cache if the new size is smaller than the old one.
       */
     void SetMaxSize(size_t maxSize)
     {
@@ -252,7 +391,9 @@ namespace osmscout {
 
       StripCache();
 
-      map.reserve(maxSize);
+      if (maxSize!=NO_SIZE_LIMIT) {
+        map.reserve(maxSize);
+      }
     }
 
     /**
@@ -263,14 +404,57 @@ namespace osmscout {
       return maxSize;
     }
 
+    /**
+      Set a new maximum memory for the cached values (0 for no limit),
+      possibly evicting entries from the cache if the new limit is smaller
+      than the old one.
+      */
+    void SetMaxMemory(size_t maxMemory)
+    {
+      this->maxMemory=maxMemory;
+
+      StripCache();
+    }
+
+    /**
+     * Returns the maximum memory of the cached values, 0 if there is no limit
+     */
+    size_t GetMaxMemory() const
+    {
+      return maxMemory;
+    }
+
+    /**
+      Evict entries until at least the given memory was freed or the cache
+      is empty. Returns the memory actually freed.
+      */
+    size_t Trim(size_t memory)
+    {
+      size_t freed=0;
+
+      while (size>0 &&
+             freed<memory) {
+        size_t currentMemory=this->memory;
+
+        EvictEntry();
+
+        freed+=currentMemory-this->memory;
+      }
+
+      return freed;
+    }
+
     /**
       Completely flush the cache removing all entries from it.
       */
     void Flush()
     {
-      order.clear();
+      slots.clear();
+      freeSlots.clear();
       map.clear();
+      hand=0;
       size=0;
+      memory=0;
     }
 
     /**
@@ -281,31 +465,68 @@ namespace osmscout {
       return size;
     }
 
+    /**
+      Returns the memory of all currently cached values as passed on insertion.
+      */
+    size_t GetMemory() const
+    {
+      return memory;
+    }
+
+    /**
+      Returns the memory of the cache, including its internal data structures, by
+      visiting all cached values.
+      */
     size_t GetMemory(const ValueSizer& sizer) const
     {
       size_t memory=0;
 
       // Size of map
-      memory+=map.size()*sizeof(CacheRef);
+      memory+=map.size()*(sizeof(K)+sizeof(size_t));
 
-      // Size of list
-      memory+=size*sizeof(CacheEntry);
+      // Size of slots
+      memory+=slots.capacity()*sizeof(Slot);
+      memory+=freeSlots.capacity()*sizeof(size_t);
 
-      for (typename std::list<CacheEntry>::const_iterator entry=order.begin();
-           entry!=order.end();
-           ++entry) {
-        memory+=sizer.GetSize(entry->value);
+      for (const auto& slot : slots) {
+        if (slot.used) {
+          memory+=sizer.GetSize(slot.entry.value);
+        }
       }
 
       return memory;
     }
 
     /**
-      Dump some cache statistics to std::cout.
+      Returns the number of successful lookups since creation of the cache
+      or the last call to ResetStatistics()
+      */
+    size_t GetHits() const
+    {
+      return hits;
+    }
+
+    /**
+      Returns the number of unsuccessful lookups since creation of the cache
+      or the last call to ResetStatistics()
+      */
+    size_t GetMisses() const
+    {
+      return misses;
+    }
+
+    void ResetStatistics()
+    {
+      hits=0;
+      misses=0;
+    }
+
+    /**
+      Dump some cache statistics to the debug log.
       */
     void DumpStatistics(const char* cacheName, const ValueSizer& sizer)
     {
-      log.Debug() << cacheName << " entries: " << size << ", memory " << GetMemory(sizer);
+      log.Debug() << cacheName << " entries: " << size << ", memory " << GetMemory(sizer) << ", hits " << hits << ", misses " << misses;
     }
   };
 }
@@ -0,0 +1,127 @@
+#ifndef OSMSCOUT_UTIL_CACHEMANAGER_H
+#define OSMSCOUT_UTIL_CACHEMANAGER_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2017  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/CoreFeatures.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <osmscout/private/CoreImportExport.h>
+
+#include <osmscout/system/Compiler.h>
+
+namespace osmscout {
+
+  /**
+   * \ingroup Util
+   *
+   * The cache manager enforces one common memory budget for any number of caches,
+   * for example the data file and index caches of multiple Database instances.
+   *
+   * Caches register themselves as clients of the manager and report every change of
+   * their memory. If the overall memory exceeds the budget, the manager asks the clients to
+   * free memory, starting with the client that was accessed least recently. As a result
+   * caches of idle databases give their memory back to the caches of the databases
+   * currently in use.
+   *
+   * To share a cache manager between multiple databases pass the same instance
+   * to all DatabaseParameter objects.
+   *
+   * All methods are thread-safe. Clients must not call the cache manager while holding a lock
+   * that they also acquire in Client::TrimCache().
+   */
+  class OSMSCOUT_API CacheManager CLASS_FINAL
+  {
+  public:
+    /**
+     * Interface to be implemented by caches managed by the cache manager.
+     */
+    class OSMSCOUT_API Client
+    {
+      friend class CacheManager;
+
+    private:
+      mutable std::atomic<uint64_t> lastAccess; //!< Value of the access clock of the manager on last access
+
+    public:
+      Client();
+      virtual ~Client() = default;
+
+      /**
+       * Evict cached entries until at least the given memory was freed or the
+       * cache is empty.
+       *
+       * @param memory
+       *    Memory to free in bytes
+       * @return
+       *    Memory actually freed in bytes
+       */
+      virtual size_t TrimCache(size_t memory) = 0;
+    };
+
+  private:
+    size_t                maxMemory;   //!< The memory budget in bytes
+    std::atomic<size_t>   memory;      //!< Memory currently used by all clients
+    std::atomic<uint64_t> accessClock; //!< Logical clock, increased on every allocation
+    std::mutex            mutex;       //!< Mutex to secure the list of clients and trimming
+    std::vector<Client*>  clients;     //!< The registered clients
+
+  private:
+    void TrimClients();
+
+  public:
+    explicit CacheManager(size_t maxMemory);
+
+    void Register(Client& client);
+    void Unregister(Client& client);
+
+    /**
+     * Mark the client as accessed
+     */
+    inline void Touch(const Client& client)
+    {
+      client.lastAccess.store(accessClock.load(std::memory_order_relaxed),
+                              std::memory_order_relaxed);
+    }
+
+    void Allocate(const Client& client,
+                  size_t memory);
+    void Free(size_t memory);
+
+    inline size_t GetMemory() const
+    {
+      return memory;
+    }
+
+    inline size_t GetMaxMemory() const
+    {
+      return maxMemory;
+    }
+  };
+
+  typedef std::shared_ptr<CacheManager> CacheManagerRef;
+}
+
+#endif
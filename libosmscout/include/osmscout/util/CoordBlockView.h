@@ -0,0 +1,294 @@
+#ifndef OSMSCOUT_UTIL_COORDBLOCKVIEW_H
+#define OSMSCOUT_UTIL_COORDBLOCKVIEW_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2017  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+#include <osmscout/private/CoreImportExport.h>
+
+#include <osmscout/GeoCoord.h>
+#include <osmscout/Point.h>
+
+#include <osmscout/util/GeoBox.h>
+
+#include <osmscout/system/Compiler.h>
+
+namespace osmscout {
+
+  /**
+   * \ingroup File
+   *
+   * Read-only view onto a delta encoded block of coordinates as written by
+   * FileWriter::Write(const std::vector<Point>&,bool).
+   *
+   * The view does not decode the coordinates on read. Instead it references the
+   * encoded deltas directly in the memory mapped file (or, if the file is not memory
+   * mapped, in an internal buffer that gets reused between reads). Coordinates are decoded
+   * on the fly while iterating. Both the interleaved and the columnar encoding of
+   * coordinate blocks are supported.
+   *
+   * If the view references memory mapped data it is only valid as long as the
+   * FileScanner it was read from is open.
+   *
+   * Node serials are skipped on read and are not available from the view.
+   */
+  class OSMSCOUT_API CoordBlockView CLASS_FINAL
+  {
+  public:
+    /**
+     * Forward iterator over the decoded coordinates of the block
+     */
+    class Iterator CLASS_FINAL
+    {
+    public:
+      typedef std::input_iterator_tag iterator_category;
+      typedef GeoCoord                value_type;
+      typedef std::ptrdiff_t          difference_type;
+      typedef const GeoCoord*         pointer;
+      typedef GeoCoord                reference;
+
+    private:
+      const uint8_t* latDelta;     //!< Pointer to the next encoded latitude delta
+      const uint8_t* lonDelta;     //!< Pointer to the next encoded longitude delta
+      size_t         latBytes;     //!< Number of bytes of one encoded latitude delta
+      size_t         lonBytes;     //!< Number of bytes of one encoded longitude delta
+      size_t         stride;       //!< Distance between two deltas in the interleaved encoding, 0 for columnar encoding
+      size_t         remaining;    //!< Number of coordinates remaining, including the current one
+      uint32_t       latValue;     //!< Current encoded latitude
+      uint32_t       lonValue;     //!< Current encoded longitude
+
+    private:
+      inline void Advance()
+      {
+        latValue+=DecodeDelta(latDelta,latBytes);
+        lonValue+=DecodeDelta(lonDelta,lonBytes);
+
+        if (stride!=0) {
+          latDelta+=stride;
+          lonDelta+=stride;
+        }
+        else {
+          latDelta+=latBytes;
+          lonDelta+=lonBytes;
+        }
+      }
+
+    public:
+      inline Iterator()
+      : latDelta(NULL),
+        lonDelta(NULL),
+        latBytes(0),
+        lonBytes(0),
+        stride(0),
+        remaining(0),
+        latValue(0),
+        lonValue(0)
+      {
+        // no code
+      }
+
+      inline Iterator(const uint8_t* latDelta,
+                      const uint8_t* lonDelta,
+                      size_t latBytes,
+                      size_t lonBytes,
+                      size_t stride,
+                      size_t remaining,
+                      uint32_t latValue,
+                      uint32_t lonValue)
+      : latDelta(latDelta),
+        lonDelta(lonDelta),
+        latBytes(latBytes),
+        lonBytes(lonBytes),
+        stride(stride),
+        remaining(remaining),
+        latValue(latValue),
+        lonValue(lonValue)
+      {
+        // no code
+      }
+
+      inline GeoCoord operator*() const
+      {
+        return GeoCoord(latValue/latConversionFactor-90.0,
+                        lonValue/lonConversionFactor-180.0);
+      }
+
+      inline Iterator& operator++()
+      {
+        remaining--;
+
+        if (remaining>0) {
+          Advance();
+        }
+
+        return *this;
+      }
+
+      inline bool operator==(const Iterator& other) const
+      {
+        return remaining==other.remaining;
+      }
+
+      inline bool operator!=(const Iterator& other) const
+      {
+        return remaining!=other.remaining;
+      }
+    };
+
+  private:
+    size_t               nodeCount;    //!< Number of coordinates in the block
+    size_t               latBytes;     //!< Number of bytes of one encoded latitude delta
+    size_t               lonBytes;     //!< Number of bytes of one encoded longitude delta
+    bool                 columnar;     //!< All latitude deltas are stored before all longitude deltas
+    uint32_t             firstLat;     //!< Encoded latitude of the first coordinate
+    uint32_t             firstLon;     //!< Encoded longitude of the first coordinate
+    const uint8_t*       mappedDeltas; //!< Pointer to the deltas in memory mapped data, or NULL
+    std::vector<uint8_t> buffer;       //!< Copy of the deltas, if the data is not memory mapped
+
+  public:
+    /**
+     * Decode a little endian, signed delta of the given number of bytes (1 to 4)
+     */
+    static inline int32_t DecodeDelta(const uint8_t* delta,
+                                      size_t bytes)
+    {
+      switch (bytes) {
+      case 1:
+        return (int8_t)delta[0];
+      case 2:
+        return (int16_t)(delta[0] | (delta[1] << 8));
+      case 3: {
+        uint32_t uDelta=delta[0] | (delta[1] << 8) | (delta[2] << 16);
+
+        return (int32_t)((uDelta & 0x800000) ? (uDelta | 0xff000000) : uDelta);
+      }
+      default:
+        return (int32_t)(delta[0] | (delta[1] << 8) | (delta[2] << 16) | ((uint32_t)delta[3] << 24));
+      }
+    }
+
+    inline CoordBlockView()
+    : nodeCount(0),
+      latBytes(0),
+      lonBytes(0),
+      columnar(false),
+      firstLat(0),
+      firstLon(0),
+      mappedDeltas(NULL)
+    {
+      // no code
+    }
+
+    /**
+     * Set the view to the given block. If mappedDeltas is NULL, the caller
+     * must fill the buffer returned by GetBuffer() afterwards.
+     *
+     * If columnar is false, latitude and longitude deltas are interleaved, else all
+     * latitude deltas are stored before all longitude deltas.
+     */
+    inline void Set(size_t nodeCount,
+                    size_t latBytes,
+                    size_t lonBytes,
+                    bool columnar,
+                    uint32_t firstLat,
+                    uint32_t firstLon,
+                    const uint8_t* mappedDeltas)
+    {
+      this->nodeCount=nodeCount;
+      this->latBytes=latBytes;
+      this->lonBytes=lonBytes;
+      this->columnar=columnar;
+      this->firstLat=firstLat;
+      this->firstLon=firstLon;
+      this->mappedDeltas=mappedDeltas;
+    }
+
+    inline void Clear()
+    {
+      nodeCount=0;
+      mappedDeltas=NULL;
+    }
+
+    /**
+     * Return a buffer of the given size to copy the encoded deltas to, if the data is not
+     * memory mapped. The capacity of the buffer is kept between reads.
+     */
+    inline uint8_t* GetBuffer(size_t size)
+    {
+      buffer.resize(size);
+
+      return buffer.data();
+    }
+
+    inline size_t size() const
+    {
+      return nodeCount;
+    }
+
+    inline bool empty() const
+    {
+      return nodeCount==0;
+    }
+
+    inline Iterator begin() const
+    {
+      if (nodeCount==0) {
+        return Iterator();
+      }
+
+      const uint8_t* deltas=mappedDeltas!=NULL ? mappedDeltas : buffer.data();
+
+      if (columnar) {
+        return Iterator(deltas,
+                        deltas+(nodeCount-1)*latBytes,
+                        latBytes,
+                        lonBytes,
+                        0,
+                        nodeCount,
+                        firstLat,
+                        firstLon);
+      }
+
+      return Iterator(deltas,
+                      deltas+latBytes,
+                      latBytes,
+                      lonBytes,
+                      latBytes+lonBytes,
+                      nodeCount,
+                      firstLat,
+                      firstLon);
+    }
+
+    inline Iterator end() const
+    {
+      return Iterator();
+    }
+
+    GeoBox GetBoundingBox() const;
+
+    void Decode(std::vector<GeoCoord>& coords) const;
+    void Decode(std::vector<Point>& points) const;
+  };
+}
+
+#endif
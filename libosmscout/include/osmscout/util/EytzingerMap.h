@@ -0,0 +1,218 @@
+#ifndef OSMSCOUT_UTIL_EYTZINGERMAP_H
+#define OSMSCOUT_UTIL_EYTZINGERMAP_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2017  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <cstddef>
+#include <vector>
+
+#include <osmscout/system/Assert.h>
+#include <osmscout/system/Compiler.h>
+
+namespace osmscout {
+
+  /**
+   * \ingroup Util
+   *
+   * Static, read-only map of sorted keys to values, optimized for lookup speed.
+   *
+   * Keys are stored in one contiguous array in Eytzinger (breadth first binary tree)
+   * order: the children of the entry at index k are at 2k and 2k+1. Lookup is a branch free
+   * descent of the implicit tree. Since the top levels of the tree are stored next to each
+   * other, they stay in the processor cache and the cache lines of the deeper levels are
+   * prefetched a few levels in advance. This is considerably faster than a binary search over
+   * a sorted array for large arrays.
+   *
+   * Values are stored in a separate array in the same order, so that the key array
+   * is as dense as possible.
+   */
+  template<class K, class V>
+  class EytzingerMap CLASS_FINAL
+  {
+  private:
+    std::vector<K> keys;   //!< Keys in Eytzinger order, index 0 is unused
+    std::vector<V> values; //!< Values in Eytzinger order, index 0 is unused
+
+  private:
+    size_t Fill(const std::vector<K>& sortedKeys,
+                const std::vector<V>& sortedValues,
+                size_t sortedIndex,
+                size_t k)
+    {
+      if (k<keys.size()) {
+        sortedIndex=Fill(sortedKeys,sortedValues,sortedIndex,2*k);
+
+        keys[k]=sortedKeys[sortedIndex];
+        values[k]=sortedValues[sortedIndex];
+        sortedIndex++;
+
+        sortedIndex=Fill(sortedKeys,sortedValues,sortedIndex,2*k+1);
+      }
+
+      return sortedIndex;
+    }
+
+    /**
+     * Descend the implicit tree for the given key. The bits of the returned index
+     * describe the path taken, a set bit means a step to the right child, which is
+     * taken if the entry is less or equal to the key.
+     */
+    inline size_t Descend(const K& key) const
+    {
+      // Number of keys per cache line, we prefetch the descendants of the current entry that many levels below
+      const size_t keysPerCacheLine=64/sizeof(K) > 0 ? 64/sizeof(K) : 1;
+      const size_t count=keys.size();
+      const K*     data=keys.data();
+      size_t       k=1;
+
+      while (k<count) {
+        if (k*keysPerCacheLine<count) {
+          OSMSCOUT_PREFETCH(data+k*keysPerCacheLine);
+        }
+
+        // go right if the entry is less or equal to key, else go left
+        k=2*k+(data[k]<=key ? 1 : 0);
+      }
+
+      return k;
+    }
+
+  public:
+    /**
+     * Fill the map with the given keys and values. Keys must be sorted
+     * in ascending order, values[i] is the value of keys[i].
+     */
+    void Assign(const std::vector<K>& sortedKeys,
+                const std::vector<V>& sortedValues)
+    {
+      assert(sortedKeys.size()==sortedValues.size());
+
+      keys.assign(sortedKeys.size()+1,K());
+      values.assign(sortedValues.size()+1,V());
+
+      Fill(sortedKeys,sortedValues,0,1);
+    }
+
+    void Clear()
+    {
+      keys.clear();
+      values.clear();
+    }
+
+    inline size_t size() const
+    {
+      return keys.empty() ? 0 : keys.size()-1;
+    }
+
+    inline bool empty() const
+    {
+      return keys.size()<=1;
+    }
+
+    /**
+     * Find the entry with the largest key that is less or equal to the given key.
+     *
+     * @param key
+     *    The key to look up
+     * @param floorKey
+     *    The key of the found entry
+     * @param value
+     *    The value of the found entry
+     * @return
+     *    true, if an entry was found, false if all keys are larger than the given key
+     */
+    inline bool FindFloor(const K& key,
+                          K& floorKey,
+                          V& value) const
+    {
+      size_t k=Descend(key);
+
+      // The result is the entry where we went right for the last time:
+      // strip all trailing left turns and the right turn itself.
+      while (k!=0 && (k & 1)==0) {
+        k>>=1;
+      }
+
+      k>>=1;
+
+      if (k==0) {
+        return false;
+      }
+
+      floorKey=keys[k];
+      value=values[k];
+
+      return true;
+    }
+
+    /**
+     * Like FindFloor(const K&,K&,V&), but additionally returns the smallest key
+     * that is larger than the given key, if there is one.
+     */
+    inline bool FindFloor(const K& key,
+                          K& floorKey,
+                          V& value,
+                          K& nextKey,
+                          bool& hasNextKey) const
+    {
+      size_t k=Descend(key);
+      size_t next=k;
+
+      // The next key is the entry where we went left for the last time:
+      // strip all trailing right turns and the left turn itself.
+      while ((next & 1)!=0) {
+        next>>=1;
+      }
+
+      next>>=1;
+
+      hasNextKey=next!=0;
+
+      if (hasNextKey) {
+        nextKey=keys[next];
+      }
+
+      while (k!=0 && (k & 1)==0) {
+        k>>=1;
+      }
+
+      k>>=1;
+
+      if (k==0) {
+        return false;
+      }
+
+      floorKey=keys[k];
+      value=values[k];
+
+      return true;
+    }
+
+    /**
+     * Return the memory used by the map
+     */
+    size_t GetMemory() const
+    {
+      return keys.capacity()*sizeof(K)+values.capacity()*sizeof(V);
+    }
+  };
+}
+
+#endif
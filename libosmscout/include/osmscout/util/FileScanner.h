@@ -33,6 +33,8 @@
 #include <osmscout/Point.h>
 #include <osmscout/Types.h>
 
+#include <osmscout/util/BlockCompressedFile.h>
+#include <osmscout/util/CoordBlockView.h>
 #include <osmscout/util/Exception.h>
 #include <osmscout/util/GeoBox.h>
 
@@ -55,6 +57,11 @@ namespace osmscout {
     mapping the complete file into the memory of the process (without
     allocating real memory) resulting in measurable speed increase because of
     exchanging buffered file access with in memory array access.
+
+    FileScanner transparently reads block compressed files (see
+    BlockCompressedFileReader). All offsets are offsets into the uncompressed
+    data then. Memory mapping is not used for block compressed files. Scanners of
+    the same file can share their cache of inflated blocks (see SetBlockCache()).
     */
   class OSMSCOUT_API FileScanner CLASS_FINAL
   {
@@ -75,7 +82,11 @@ namespace osmscout {
     // For mmap usage
     char                 *buffer;        //!< Pointer to the file memory
     FileOffset           size;           //!< Size of the memory/file
-    FileOffset           offset;         //!< Current offset into the file memory
+    FileOffset           offset;         //!< Current offset into the file memory or the uncompressed data
+
+    // For block compressed files
+    BlockCompressedFileReader   *compressedReader; //!< Reader for block compressed files, else NULL
+    BlockCompressedFileCacheRef blockCache;        //!< Optional shared cache of inflated blocks
 
     // For std::vector<GeoCoord> loading
     uint8_t              *byteBuffer;    //!< Temporary buffer for loading of std::vector<GeoCoord>
@@ -90,10 +101,23 @@ namespace osmscout {
     void AssureByteBufferSize(size_t size);
     void FreeBuffer();
 
+    size_t ReadFromFile(void* data,
+                        size_t bytes);
+
+    void ReadCoordBlockHeader(bool readIds,
+                              size_t& nodeCount,
+                              size_t& coordBitSize,
+                              bool& columnar,
+                              bool& hasNodes);
+    void ReadColumnarDeltaBytes(size_t& latBytes,
+                                size_t& lonBytes);
+
   public:
     FileScanner();
     virtual ~FileScanner();
 
+    void SetBlockCache(const BlockCompressedFileCacheRef& blockCache);
+
     void Open(const std::string& filename,
               Mode mode,
               bool useMmap);
@@ -107,6 +131,11 @@ namespace osmscout {
 
     bool IsEOF() const;
 
+    inline bool IsBlockCompressed() const
+    {
+      return compressedReader!=NULL;
+    }
+
     inline  bool HasError() const
     {
       return file==NULL || hasError;
@@ -118,6 +147,9 @@ namespace osmscout {
     void SetPos(FileOffset pos);
     FileOffset GetPos() const;
 
+    void Prefetch(FileOffset pos,
+                  FileOffset length);
+
     void Read(char* buffer, size_t bytes);
 
     void Read(std::string& value);
@@ -157,6 +189,7 @@ namespace osmscout {
                               bool& isSet);
 
     void Read(std::vector<Point>& nodes, bool readIds);
+    void Read(CoordBlockView& coords, bool readIds);
 
     void ReadBox(GeoBox& box);
 
@@ -47,11 +47,17 @@ namespace osmscout {
   class OSMSCOUT_API FileWriter CLASS_FINAL
   {
   private:
-    std::string          filename;    //!< The filename
-    std::FILE            *file;       //!< The low level FILE object
-    bool                 hasError;    //!< Flag for signaling that the stream has errors
-    std::vector<int32_t> deltaBuffer; //!< Temporary storage for deltas for storing of std::vector<GeoCoord>
-    std::vector<uint8_t> byteBuffer;  //!< Temporary data buffer for storing of std::vector<GeoCoord>
+    std::string          filename;       //!< The filename
+    std::FILE            *file;          //!< The low level FILE object
+    bool                 hasError;       //!< Flag for signaling that the stream has errors
+    bool                 columnarCoords; //!< Write coordinate blocks in columnar encoding
+    std::vector<int32_t> deltaBuffer;    //!< Temporary storage for deltas for storing of std::vector<GeoCoord>
+    std::vector<uint8_t> byteBuffer;     //!< Temporary data buffer for storing of std::vector<GeoCoord>
+
+  private:
+    void WriteCoordDeltas(size_t coordBitSize,
+                          size_t latBytes,
+                          size_t lonBytes);
 
   public:
     static const uint64_t MAX_NODES;
@@ -75,6 +81,21 @@ namespace osmscout {
 
     std::string GetFilename() const;
 
+    /**
+     * Write coordinate blocks (see Write(const std::vector<Point>&,bool)) in the
+     * columnar encoding, which can be decoded faster but cannot be read by older versions
+     * of the library.
+     */
+    inline void SetColumnarCoords(bool columnar)
+    {
+      columnarCoords=columnar;
+    }
+
+    inline bool GetColumnarCoords() const
+    {
+      return columnarCoords;
+    }
+
     FileOffset GetPos();
     void SetPos(FileOffset pos);
     void GotoBegin();
@@ -23,6 +23,7 @@
 #include <osmscout/private/CoreImportExport.h>
 
 #include <osmscout/GeoCoord.h>
+#include <osmscout/Point.h>
 
 #include <osmscout/util/GeoBox.h>
 #include <osmscout/util/Magnification.h>
@@ -62,6 +63,16 @@ namespace osmscout {
 
   public:
 
+    /**
+     * Implementation used by the bulk GeoToPixel() transformation
+     */
+    enum BulkKernel
+    {
+      bulkKernelScalar, //!< One point per GeoToPixel() call
+      bulkKernelSSE2,   //!< Two points per call, using the BatchTransformer
+      bulkKernelAVX2    //!< Four points per iteration, using AVX2 and FMA
+    };
+
     /**
      * This class is used to hide internal complexity concerned with batching GeoToPixel calls
      */
@@ -308,6 +319,27 @@ namespace osmscout {
     virtual bool GeoToPixel(const GeoCoord& coord,
                             double& x, double& y) const = 0;
 
+    /**
+     * Converts the given number of points to pixel coordinates. The
+     * coordinates of the i-th point are stored in x[i*stride] and y[i*stride],
+     * so the result can be written into arrays of structs directly.
+     *
+     * Results are the same as calling GeoToPixel() for each point, up to the
+     * precision of the vectorized implementations. The default implementation
+     * uses the BatchTransformer.
+     */
+    virtual void GeoToPixel(const Point* points,
+                            size_t count,
+                            double* x,
+                            double* y,
+                            size_t stride) const;
+
+    /**
+     * Return the implementation the bulk GeoToPixel() uses for this projection
+     * on the current CPU
+     */
+    virtual BulkKernel GetBulkKernel() const;
+
   protected:
     virtual void GeoToPixel(const BatchTransformer& transformData) const = 0;
 
@@ -420,6 +452,14 @@ namespace osmscout {
     bool GeoToPixel(const GeoCoord& coord,
                     double& x, double& y) const;
 
+    void GeoToPixel(const Point* points,
+                    size_t count,
+                    double* x,
+                    double* y,
+                    size_t stride) const;
+
+    BulkKernel GetBulkKernel() const;
+
     bool Move(double horizPixel,
               double vertPixel);
 
@@ -539,6 +579,14 @@ namespace osmscout {
     bool GeoToPixel(const GeoCoord& coord,
                     double& x, double& y) const;
 
+    void GeoToPixel(const Point* points,
+                    size_t count,
+                    double* x,
+                    double* y,
+                    size_t stride) const;
+
+    BulkKernel GetBulkKernel() const;
+
     inline bool IsLinearInterpolationEnabled()
     {
       return useLinearInterpolation;
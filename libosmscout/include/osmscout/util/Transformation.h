@@ -179,6 +179,12 @@ namespace osmscout {
     ~CoordBuffer();
 
     void Reset();
+
+    inline size_t GetPointCount() const
+    {
+      return usedPoints;
+    }
+
     size_t PushCoord(double x, double y);
     bool GenerateParallelWay(size_t orgStart,
                              size_t orgEnd,
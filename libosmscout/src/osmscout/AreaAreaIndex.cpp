@@ -25,6 +25,7 @@
 #include <osmscout/util/Logger.h>
 #include <osmscout/util/StopClock.h>
 
+#include <osmscout/system/Assert.h>
 #include <osmscout/system/Math.h>
 
 //#define ANALYZE_CACHE
@@ -33,10 +34,15 @@ namespace osmscout {
 
   const char* AreaAreaIndex::AREA_AREA_IDX="areaarea.idx";
 
+  /**
+   * The cache of index cells is limited by memory, its budget is the memory
+   * of the given number of index cells.
+   */
   AreaAreaIndex::AreaAreaIndex(size_t cacheSize)
   : maxLevel(0),
     topLevelOffset(0),
-    indexCache(cacheSize)
+    indexCache(cacheSize>0 ? IndexCache::NO_SIZE_LIMIT : 0,
+               cacheSize*IndexCacheValueSizer().GetSize(IndexCell()))
   {
     // no code
   }
@@ -44,6 +50,38 @@ namespace osmscout {
   AreaAreaIndex::~AreaAreaIndex()
   {
     Close();
+
+    if (cacheManager) {
+      cacheManager->Unregister(*this);
+    }
+  }
+
+  /**
+   * Register the index with the given cache manager (or unregister from the current
+   * cache manager, if an empty reference is passed).
+   *
+   * Must be called before the index is opened.
+   */
+  void AreaAreaIndex::SetCacheManager(const CacheManagerRef& cacheManager)
+  {
+    assert(!IsOpen());
+
+    if (this->cacheManager) {
+      this->cacheManager->Unregister(*this);
+    }
+
+    this->cacheManager=cacheManager;
+
+    if (this->cacheManager) {
+      this->cacheManager->Register(*this);
+    }
+  }
+
+  size_t AreaAreaIndex::TrimCache(size_t memory)
+  {
+    std::lock_guard<std::mutex> guard(lookupMutex);
+
+    return indexCache.Trim(memory);
   }
 
   void AreaAreaIndex::Close()
@@ -57,6 +95,19 @@ namespace osmscout {
       log.Error() << e.GetDescription();
       scanner.CloseFailsafe();
     }
+
+    size_t memory;
+
+    {
+      std::lock_guard<std::mutex> guard(lookupMutex);
+
+      memory=indexCache.GetMemory();
+      indexCache.Flush();
+    }
+
+    if (cacheManager) {
+      cacheManager->Free(memory);
+    }
   }
 
   bool AreaAreaIndex::GetIndexCell(uint32_t level,
@@ -65,20 +116,22 @@ namespace osmscout {
                                    FileOffset &dataOffset) const
   {
     if (level<maxLevel) {
-      std::lock_guard<std::mutex> guard(lookupMutex);
-      IndexCache::CacheRef        cacheRef;
+      std::unique_lock<std::mutex> guard(lookupMutex);
+      IndexCache::CacheRef         cacheRef;
 
 #if defined(ANALYZE_CACHE)
-      if (indexCache.GetSize()==indexCache.GetMaxSize()) {
-        log.Warn() << "areaarea.index cache of " << indexCache.GetSize() << "/" << indexCache.GetMaxSize()<< " is too small";
+      if (indexCache.GetMemory()+IndexCacheValueSizer().GetSize(IndexCell())>indexCache.GetMaxMemory()) {
+        log.Warn() << "areaarea.index cache of " << indexCache.GetMemory() << "/" << indexCache.GetMaxMemory()<< " bytes is too small";
         indexCache.DumpStatistics("areaarea.idx",IndexCacheValueSizer());
       }
 #endif
 
       if (!indexCache.GetEntry(offset,cacheRef)) {
         IndexCache::CacheEntry cacheEntry(offset);
+        size_t                 memoryBefore=indexCache.GetMemory();
 
-        cacheRef=indexCache.SetEntry(cacheEntry);
+        cacheRef=indexCache.SetEntry(cacheEntry,
+                                     IndexCacheValueSizer().GetSize(cacheEntry.value));
 
         scanner.SetPos(offset);
 
@@ -98,9 +151,28 @@ namespace osmscout {
         cacheRef->value.data=scanner.GetPos();
 
         indexCell=cacheRef->value;
+
+        size_t memoryAfter=indexCache.GetMemory();
+
+        guard.unlock();
+
+        // Must be called without holding the lock, since the cache manager might trim us
+        if (cacheManager) {
+          if (memoryAfter>=memoryBefore) {
+            cacheManager->Allocate(*this,
+                                   memoryAfter-memoryBefore);
+          }
+          else {
+            cacheManager->Free(memoryBefore-memoryAfter);
+          }
+        }
       }
       else {
         indexCell=cacheRef->value;
+
+        if (cacheManager) {
+          cacheManager->Touch(*this);
+        }
       }
     }
     else {
@@ -24,8 +24,9 @@ namespace osmscout {
   const char* AreaDataFile::AREAS_DAT="areas.dat";
   const char* AreaDataFile::AREAS_IDMAP="areas.idmap";
 
-  AreaDataFile::AreaDataFile(size_t cacheSize)
-  : DataFile<Area>(AREAS_DAT, cacheSize)
+  AreaDataFile::AreaDataFile(size_t cacheSize,
+                             size_t cacheMemory)
+  : DataFile<Area>(AREAS_DAT, cacheSize,cacheMemory)
   {
     // no code
   }
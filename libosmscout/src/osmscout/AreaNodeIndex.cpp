@@ -62,11 +62,50 @@ namespace osmscout {
   {
   }
 
-  AreaNodeIndex::AreaNodeIndex()
+  AreaNodeIndex::AreaNodeIndex(size_t cacheMemory)
+  : cellCache(cacheMemory>0 ? CellCache::NO_SIZE_LIMIT : 0,
+              cacheMemory)
   {
     // no code
   }
 
+  AreaNodeIndex::~AreaNodeIndex()
+  {
+    Close();
+
+    if (cacheManager) {
+      cacheManager->Unregister(*this);
+    }
+  }
+
+  /**
+   * Register the index with the given cache manager (or unregister from the current
+   * cache manager, if an empty reference is passed).
+   *
+   * Must be called before the index is opened.
+   */
+  void AreaNodeIndex::SetCacheManager(const CacheManagerRef& cacheManager)
+  {
+    assert(!IsOpen());
+
+    if (this->cacheManager) {
+      this->cacheManager->Unregister(*this);
+    }
+
+    this->cacheManager=cacheManager;
+
+    if (this->cacheManager) {
+      this->cacheManager->Register(*this);
+    }
+  }
+
+  size_t AreaNodeIndex::TrimCache(size_t memory)
+  {
+    std::lock_guard<std::mutex> guard(lookupMutex);
+
+    return cellCache.Trim(memory);
+  }
+
   void AreaNodeIndex::Close()
   {
     try {
@@ -78,6 +117,19 @@ namespace osmscout {
       log.Error() << e.GetDescription();
       scanner.CloseFailsafe();
     }
+
+    size_t memory;
+
+    {
+      std::lock_guard<std::mutex> guard(lookupMutex);
+
+      memory=cellCache.GetMemory();
+      cellCache.Flush();
+    }
+
+    if (cacheManager) {
+      cacheManager->Free(memory);
+    }
   }
 
   bool AreaNodeIndex::Open(const std::string& path)
@@ -159,14 +211,15 @@ namespace osmscout {
     minyc=std::max(minyc,typeData.cellYStart);
     maxyc=std::min(maxyc,typeData.cellYEnd);
 
-    FileOffset dataOffset=typeData.GetDataOffset();
+    FileOffset              dataOffset=typeData.GetDataOffset();
+    std::vector<FileOffset> cellDataOffsets;
 
     // For each row
     for (size_t y=minyc; y<=maxyc; y++) {
-      std::lock_guard<std::mutex> guard(lookupMutex);
-      FileOffset                  initialCellDataOffset=0;
-      size_t                      cellDataOffsetCount=0;
-      FileOffset                  cellIndexOffset=typeData.GetCellOffset(minxc,y);
+      std::unique_lock<std::mutex> guard(lookupMutex);
+      FileOffset                   cellIndexOffset=typeData.GetCellOffset(minxc,y);
+
+      cellDataOffsets.clear();
 
       scanner.SetPos(cellIndexOffset);
 
@@ -184,29 +237,42 @@ namespace osmscout {
         // We added +1 during import and now substract it again
         cellDataOffset--;
 
-        if (initialCellDataOffset==0) {
-          initialCellDataOffset=dataOffset+cellDataOffset;
-        }
-
-        cellDataOffsetCount++;
+        cellDataOffsets.push_back(dataOffset+cellDataOffset);
       }
 
-      if (cellDataOffsetCount==0) {
+      // We did not find any cells in the current row
+      if (cellDataOffsets.empty()) {
         continue;
       }
 
-      assert(initialCellDataOffset>=cellIndexOffset);
+      // The first data entry must be positioned behind the bitmap
+      assert(cellDataOffsets.front()>=cellIndexOffset);
+
+      std::vector<CellCache::CacheEntry> readCells;
+      size_t                             memoryBefore=cellCache.GetMemory();
 
-      scanner.SetPos(initialCellDataOffset);
+      // For each data cell (in range) in row found
+      for (const auto cellDataOffset : cellDataOffsets) {
+        CellCache::CacheRef cacheRef;
 
-      // For each data cell in row found
-      for (size_t i=0; i<cellDataOffsetCount; i++) {
-        uint32_t   dataCount;
-        FileOffset lastOffset=0;
+        if (cellCache.GetEntry(cellDataOffset,cacheRef)) {
+          offsets.insert(offsets.end(),cacheRef->value.begin(),cacheRef->value.end());
+          continue;
+        }
+
+        CellCache::CacheEntry cell(cellDataOffset);
+        uint32_t              dataCount;
+        FileOffset            lastOffset=0;
 
+        // Cells of a row are stored one after another
+        if (scanner.GetPos()!=cellDataOffset) {
+          scanner.SetPos(cellDataOffset);
+        }
 
         scanner.ReadNumber(dataCount);
 
+        cell.value.reserve(dataCount);
+
         for (size_t d=0; d<dataCount; d++) {
           FileOffset objectOffset;
 
@@ -214,10 +280,41 @@ namespace osmscout {
 
           objectOffset+=lastOffset;
 
-          offsets.push_back(objectOffset);
+          cell.value.push_back(objectOffset);
 
           lastOffset=objectOffset;
         }
+
+        offsets.insert(offsets.end(),cell.value.begin(),cell.value.end());
+
+        if (cellCache.IsActive()) {
+          readCells.push_back(cell);
+        }
+      }
+
+      // Only cache the cells after the complete row was read successfully,
+      // so that the memory reported to the cache manager stays consistent
+      for (const auto& cell : readCells) {
+        cellCache.SetEntry(cell,
+                           CellCacheValueSizer().GetSize(cell.value));
+      }
+
+      size_t memoryAfter=cellCache.GetMemory();
+
+      guard.unlock();
+
+      // Must be called without holding the lock, since the cache manager might trim us
+      if (cacheManager) {
+        if (memoryAfter>memoryBefore) {
+          cacheManager->Allocate(*this,
+                                 memoryAfter-memoryBefore);
+        }
+        else if (memoryAfter<memoryBefore) {
+          cacheManager->Free(memoryBefore-memoryAfter);
+        }
+        else {
+          cacheManager->Touch(*this);
+        }
       }
     }
 
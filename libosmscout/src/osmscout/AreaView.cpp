@@ -0,0 +1,93 @@
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2017  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/AreaView.h>
+
+namespace osmscout {
+
+  /**
+   * Read the area from the current position of the given FileScanner. Any previous
+   * content of the view is replaced. The format is the same as read by Area::Read().
+   *
+   * @throws IOException
+   */
+  void AreaView::Read(const TypeConfig& typeConfig,
+                      FileScanner& scanner)
+  {
+    TypeId   ringType;
+    bool     multipleRings;
+    bool     hasMaster;
+    uint32_t count=1;
+
+    fileOffset=scanner.GetPos();
+
+    scanner.ReadTypeId(ringType,
+                       typeConfig.GetAreaTypeIdBytes());
+
+    TypeInfoRef type=typeConfig.GetAreaTypeInfo(ringType);
+
+    if (rings.empty()) {
+      rings.resize(1);
+    }
+
+    rings[0].featureValueBuffer.Reset(type);
+    rings[0].featureValueBuffer.Read(scanner,
+                                     multipleRings,
+                                     hasMaster);
+
+    if (multipleRings) {
+      scanner.ReadNumber(count);
+
+      count++;
+    }
+
+    if (rings.size()<count) {
+      rings.resize(count);
+    }
+
+    ringCount=count;
+
+    rings[0].ring=hasMaster ? Area::masterRingId : Area::outerRingId;
+
+    scanner.Read(rings[0].coords,
+                 type->CanRoute());
+
+    for (size_t i=1; i<ringCount; i++) {
+      Ring& ring=rings[i];
+
+      scanner.ReadTypeId(ringType,
+                         typeConfig.GetAreaTypeIdBytes());
+
+      type=typeConfig.GetAreaTypeInfo(ringType);
+
+      ring.featureValueBuffer.Reset(type);
+
+      if (type->GetAreaId()!=typeIgnore) {
+        ring.featureValueBuffer.Read(scanner);
+      }
+
+      scanner.Read(ring.ring);
+      scanner.Read(ring.coords,
+                   type->GetAreaId()!=typeIgnore &&
+                   type->CanRoute());
+    }
+
+    nextFileOffset=scanner.GetPos();
+  }
+}
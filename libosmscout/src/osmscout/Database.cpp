@@ -20,6 +20,7 @@
 #include <osmscout/Database.h>
 
 #include <algorithm>
+#include <functional>
 
 #if _OPENMP
 #include <omp.h>
@@ -36,9 +37,15 @@ namespace osmscout {
 
   DatabaseParameter::DatabaseParameter()
   : areaAreaIndexCacheSize(5000),
+    areaNodeIndexCacheMemory(1024*1024),
+    areaWayIndexCacheMemory(1024*1024),
     nodeDataCacheSize(5000),
     wayDataCacheSize(10000),
     areaDataCacheSize(5000),
+    nodeDataCacheMemory(2*1024*1024),
+    wayDataCacheMemory(8*1024*1024),
+    areaDataCacheMemory(16*1024*1024),
+    cacheManager(NULL),
     routerDataMMap(true),
     nodesDataMMap(true),
     areasDataMMap(true),
@@ -52,6 +59,16 @@ namespace osmscout {
     this->areaAreaIndexCacheSize=areaAreaIndexCacheSize;
   }
 
+  void DatabaseParameter::SetAreaNodeIndexCacheMemory(unsigned long memory)
+  {
+    this->areaNodeIndexCacheMemory=memory;
+  }
+
+  void DatabaseParameter::SetAreaWayIndexCacheMemory(unsigned long memory)
+  {
+    this->areaWayIndexCacheMemory=memory;
+  }
+
   void DatabaseParameter::SetNodeDataCacheSize(unsigned long size)
   {
     this->nodeDataCacheSize=size;
@@ -67,6 +84,26 @@ namespace osmscout {
     this->areaDataCacheSize=size;
   }
 
+  void DatabaseParameter::SetNodeDataCacheMemory(unsigned long memory)
+  {
+    this->nodeDataCacheMemory=memory;
+  }
+
+  void DatabaseParameter::SetWayDataCacheMemory(unsigned long memory)
+  {
+    this->wayDataCacheMemory=memory;
+  }
+
+  void DatabaseParameter::SetAreaDataCacheMemory(unsigned long memory)
+  {
+    this->areaDataCacheMemory=memory;
+  }
+
+  void DatabaseParameter::SetCacheManager(const CacheManagerRef& cacheManager)
+  {
+    this->cacheManager=cacheManager;
+  }
+
   void DatabaseParameter::SetRouterDataMMap(bool mmap)
   {
     routerDataMMap=mmap;
@@ -92,6 +129,16 @@ namespace osmscout {
     return areaAreaIndexCacheSize;
   }
 
+  unsigned long DatabaseParameter::GetAreaNodeIndexCacheMemory() const
+  {
+    return areaNodeIndexCacheMemory;
+  }
+
+  unsigned long DatabaseParameter::GetAreaWayIndexCacheMemory() const
+  {
+    return areaWayIndexCacheMemory;
+  }
+
   unsigned long DatabaseParameter::GetNodeDataCacheSize() const
   {
     return nodeDataCacheSize;
@@ -107,6 +154,26 @@ namespace osmscout {
     return areaDataCacheSize;
   }
 
+  unsigned long DatabaseParameter::GetNodeDataCacheMemory() const
+  {
+    return nodeDataCacheMemory;
+  }
+
+  unsigned long DatabaseParameter::GetWayDataCacheMemory() const
+  {
+    return wayDataCacheMemory;
+  }
+
+  unsigned long DatabaseParameter::GetAreaDataCacheMemory() const
+  {
+    return areaDataCacheMemory;
+  }
+
+  CacheManagerRef DatabaseParameter::GetCacheManager() const
+  {
+    return cacheManager;
+  }
+
   bool DatabaseParameter::GetRouterDataMMap() const
   {
     return routerDataMMap;
@@ -168,6 +235,8 @@ namespace osmscout {
 
   void Database::Close()
   {
+    StopPrefetching();
+
     boundingBoxDataFile=NULL;
 
     if (nodeDataFile &&
@@ -272,7 +341,10 @@ namespace osmscout {
     }
 
     if (!nodeDataFile) {
-      nodeDataFile=std::make_shared<NodeDataFile>(parameter.GetNodeDataCacheSize());
+      nodeDataFile=std::make_shared<NodeDataFile>(parameter.GetNodeDataCacheSize(),
+                                                  parameter.GetNodeDataCacheMemory());
+
+      nodeDataFile->SetCacheManager(parameter.GetCacheManager());
     }
 
     if (!nodeDataFile->IsOpen()) {
@@ -302,7 +374,10 @@ namespace osmscout {
     }
 
     if (!areaDataFile) {
-      areaDataFile=std::make_shared<AreaDataFile>(parameter.GetAreaDataCacheSize());
+      areaDataFile=std::make_shared<AreaDataFile>(parameter.GetAreaDataCacheSize(),
+                                                  parameter.GetAreaDataCacheMemory());
+
+      areaDataFile->SetCacheManager(parameter.GetCacheManager());
     }
 
     if (!areaDataFile->IsOpen()) {
@@ -332,7 +407,10 @@ namespace osmscout {
     }
 
     if (!wayDataFile) {
-      wayDataFile=std::make_shared<WayDataFile>(parameter.GetWayDataCacheSize());
+      wayDataFile=std::make_shared<WayDataFile>(parameter.GetWayDataCacheSize(),
+                                                parameter.GetWayDataCacheMemory());
+
+      wayDataFile->SetCacheManager(parameter.GetCacheManager());
     }
 
     if (!wayDataFile->IsOpen()) {
@@ -362,7 +440,9 @@ namespace osmscout {
     }
 
     if (!areaNodeIndex) {
-      areaNodeIndex=std::make_shared<AreaNodeIndex>();
+      areaNodeIndex=std::make_shared<AreaNodeIndex>(parameter.GetAreaNodeIndexCacheMemory());
+
+      areaNodeIndex->SetCacheManager(parameter.GetCacheManager());
 
       StopClock timer;
 
@@ -392,6 +472,8 @@ namespace osmscout {
     if (!areaAreaIndex) {
       areaAreaIndex=std::make_shared<AreaAreaIndex>(parameter.GetAreaAreaIndexCacheSize());
 
+      areaAreaIndex->SetCacheManager(parameter.GetCacheManager());
+
       StopClock timer;
 
       if (!areaAreaIndex->Open(path)) {
@@ -418,7 +500,9 @@ namespace osmscout {
     }
 
     if (!areaWayIndex) {
-      areaWayIndex=std::make_shared<AreaWayIndex>();
+      areaWayIndex=std::make_shared<AreaWayIndex>(parameter.GetAreaWayIndexCacheMemory());
+
+      areaWayIndex->SetCacheManager(parameter.GetCacheManager());
 
       StopClock timer;
 
@@ -562,6 +646,304 @@ namespace osmscout {
     return true;
   }
 
+  /**
+   * Process prefetch requests until the queue gets stopped
+   */
+  void Database::PrefetchWorkerLoop(PrefetchQueueRef queue) const
+  {
+    std::packaged_task<bool()> task;
+
+    while (queue->PopTask(task)) {
+      task();
+    }
+  }
+
+  /**
+   * Abort all pending prefetch requests and stop the prefetch worker
+   */
+  void Database::StopPrefetching()
+  {
+    std::lock_guard<std::mutex> lock(prefetchMutex);
+
+    if (!prefetchQueue) {
+      return;
+    }
+
+    prefetchBreaker.Break();
+    prefetchQueue->Stop();
+    prefetchThread.join();
+
+    prefetchQueue=NULL;
+  }
+
+  /**
+   * Load all objects of the given types in the given area to warm up
+   * the index and data file caches. The data itself is dropped.
+   */
+  bool Database::PrefetchData(const GeoBox& boundingBox,
+                              const Magnification& magnification,
+                              const TypeInfoSet& types,
+                              const BreakerRef& breaker) const
+  {
+    auto isAborted=[this,&breaker]() {
+      return prefetchBreaker.IsAborted() ||
+             (breaker && breaker->IsAborted());
+    };
+
+    if (!IsOpen() ||
+        isAborted()) {
+      return false;
+    }
+
+    TypeInfoSet nodeTypes;
+    TypeInfoSet wayTypes;
+    TypeInfoSet areaTypes;
+
+    for (const auto& type : types) {
+      if (type->CanBeNode()) {
+        nodeTypes.Set(type);
+      }
+
+      if (type->CanBeWay()) {
+        wayTypes.Set(type);
+      }
+
+      if (type->CanBeArea()) {
+        areaTypes.Set(type);
+      }
+    }
+
+    StopClock time;
+
+    if (!areaTypes.Empty()) {
+      OptimizeAreasLowZoomRef optimizeAreasLowZoom=GetOptimizeAreasLowZoom();
+
+      if (optimizeAreasLowZoom &&
+          optimizeAreasLowZoom->HasOptimizations(magnification.GetMagnification())) {
+        TypeInfoSet optimizedAreaTypes;
+
+        optimizeAreasLowZoom->GetTypes(magnification,
+                                       areaTypes,
+                                       optimizedAreaTypes);
+
+        areaTypes.Remove(optimizedAreaTypes);
+
+        if (!optimizedAreaTypes.Empty()) {
+          std::vector<AreaRef> areas;
+          TypeInfoSet          loadedAreaTypes;
+
+          if (!optimizeAreasLowZoom->GetAreas(boundingBox,
+                                              magnification,
+                                              optimizedAreaTypes,
+                                              areas,
+                                              loadedAreaTypes)) {
+            return false;
+          }
+        }
+      }
+    }
+
+    if (isAborted()) {
+      return false;
+    }
+
+    if (!areaTypes.Empty()) {
+      AreaAreaIndexRef areaAreaIndex=GetAreaAreaIndex();
+
+      if (!areaAreaIndex) {
+        return false;
+      }
+
+      std::vector<DataBlockSpan> spans;
+      TypeInfoSet                loadedAreaTypes;
+
+      // Same maximum area level as the default of MapService
+      if (!areaAreaIndex->GetAreasInArea(*typeConfig,
+                                         boundingBox,
+                                         magnification.GetLevel()+4,
+                                         areaTypes,
+                                         spans,
+                                         loadedAreaTypes)) {
+        return false;
+      }
+
+      if (isAborted()) {
+        return false;
+      }
+
+      std::sort(spans.begin(),spans.end());
+
+      std::vector<AreaRef> areas;
+
+      if (!GetAreasByBlockSpans(spans,
+                                areas)) {
+        return false;
+      }
+    }
+
+    if (isAborted()) {
+      return false;
+    }
+
+    if (!wayTypes.Empty()) {
+      OptimizeWaysLowZoomRef optimizeWaysLowZoom=GetOptimizeWaysLowZoom();
+
+      if (optimizeWaysLowZoom &&
+          optimizeWaysLowZoom->HasOptimizations(magnification.GetMagnification())) {
+        TypeInfoSet optimizedWayTypes;
+
+        optimizeWaysLowZoom->GetTypes(magnification,
+                                      wayTypes,
+                                      optimizedWayTypes);
+
+        wayTypes.Remove(optimizedWayTypes);
+
+        if (!optimizedWayTypes.Empty()) {
+          std::vector<WayRef> ways;
+          TypeInfoSet         loadedWayTypes;
+
+          if (!optimizeWaysLowZoom->GetWays(boundingBox,
+                                            magnification,
+                                            optimizedWayTypes,
+                                            ways,
+                                            loadedWayTypes)) {
+            return false;
+          }
+        }
+      }
+    }
+
+    if (isAborted()) {
+      return false;
+    }
+
+    if (!wayTypes.Empty()) {
+      AreaWayIndexRef areaWayIndex=GetAreaWayIndex();
+
+      if (!areaWayIndex) {
+        return false;
+      }
+
+      std::vector<FileOffset> offsets;
+      TypeInfoSet             loadedWayTypes;
+
+      if (!areaWayIndex->GetOffsets(boundingBox,
+                                    wayTypes,
+                                    offsets,
+                                    loadedWayTypes)) {
+        return false;
+      }
+
+      if (isAborted()) {
+        return false;
+      }
+
+      std::sort(offsets.begin(),offsets.end());
+
+      std::vector<WayRef> ways;
+
+      if (!GetWaysByOffset(offsets,
+                           ways)) {
+        return false;
+      }
+    }
+
+    if (isAborted()) {
+      return false;
+    }
+
+    if (!nodeTypes.Empty()) {
+      AreaNodeIndexRef areaNodeIndex=GetAreaNodeIndex();
+
+      if (!areaNodeIndex) {
+        return false;
+      }
+
+      std::vector<FileOffset> offsets;
+      TypeInfoSet             loadedNodeTypes;
+
+      if (!areaNodeIndex->GetOffsets(boundingBox,
+                                     nodeTypes,
+                                     offsets,
+                                     loadedNodeTypes)) {
+        return false;
+      }
+
+      if (isAborted()) {
+        return false;
+      }
+
+      std::sort(offsets.begin(),offsets.end());
+
+      std::vector<NodeRef> nodes;
+
+      if (!GetNodesByOffset(offsets,
+                            boundingBox,
+                            nodes)) {
+        return false;
+      }
+    }
+
+    time.Stop();
+
+    log.Debug() << "Prefetching " << boundingBox.GetDisplayText() << " took " << time.ResultString();
+
+    return !isAborted();
+  }
+
+  /**
+   * Asynchronously load all index entries and objects of the given types in the given area
+   * (like MapService does for the given magnification), so that following requests for the
+   * same area are served from the caches.
+   *
+   * Requests are processed one after another by a background worker thread in the order
+   * of their submission. A request can be cancelled using the given breaker. On Close()
+   * all pending requests are cancelled.
+   *
+   * @param boundingBox
+   *    The area to prefetch
+   * @param magnification
+   *    The magnification the area will be displayed with
+   * @param types
+   *    The node, way and area types to prefetch
+   * @param breaker
+   *    Optional breaker to cancel the request
+   * @return
+   *    A future, returning true, if the request was completely processed
+   */
+  std::future<bool> Database::Prefetch(const GeoBox& boundingBox,
+                                       const Magnification& magnification,
+                                       const TypeInfoSet& types,
+                                       const BreakerRef& breaker) const
+  {
+    std::packaged_task<bool()> task(std::bind(&Database::PrefetchData,this,
+                                              boundingBox,
+                                              magnification,
+                                              types,
+                                              breaker));
+
+    std::future<bool> future=task.get_future();
+
+    std::lock_guard<std::mutex> lock(prefetchMutex);
+
+    if (!IsOpen()) {
+      task();
+
+      return future;
+    }
+
+    if (!prefetchQueue) {
+      prefetchBreaker.Reset();
+      prefetchQueue=std::make_shared<WorkQueue<bool>>();
+      prefetchThread=std::thread(&Database::PrefetchWorkerLoop,this,
+                                 prefetchQueue);
+    }
+
+    prefetchQueue->PushTask(task);
+
+    return future;
+  }
+
   bool Database::GetNodeByOffset(const FileOffset& offset,
                                  NodeRef& node) const
   {
@@ -938,6 +1320,18 @@ namespace osmscout {
 
   void Database::DumpStatistics()
   {
+    if (nodeDataFile) {
+      nodeDataFile->DumpStatistics();
+    }
+
+    if (areaDataFile) {
+      areaDataFile->DumpStatistics();
+    }
+
+    if (wayDataFile) {
+      wayDataFile->DumpStatistics();
+    }
+
     if (areaAreaIndex) {
       areaAreaIndex->DumpStatistics();
     }
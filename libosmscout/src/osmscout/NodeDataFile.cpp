@@ -24,8 +24,9 @@ namespace osmscout {
   const char* NodeDataFile::NODES_DAT="nodes.dat";
   const char* NodeDataFile::NODES_IDMAP="nodes.idmap";
 
-  NodeDataFile::NodeDataFile(size_t cacheSize)
-  : DataFile<Node>(NODES_DAT,cacheSize)
+  NodeDataFile::NodeDataFile(size_t cacheSize,
+                             size_t cacheMemory)
+  : DataFile<Node>(NODES_DAT,cacheSize,cacheMemory)
   {
     // no code
   }
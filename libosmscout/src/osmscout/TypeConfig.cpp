@@ -224,6 +224,16 @@ namespace osmscout {
     featureValueBuffer=NULL; // buffer is allocated on first usage
   }
 
+  void FeatureValueBuffer::Reset(const TypeInfoRef& type)
+  {
+    if (this->type==type) {
+      ClearFeatureValues();
+    }
+    else {
+      SetType(type);
+    }
+  }
+
   void FeatureValueBuffer::DeleteData()
   {
     if (featureValueBuffer!=NULL) {
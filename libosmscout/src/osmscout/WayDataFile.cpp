@@ -24,8 +24,9 @@ namespace osmscout {
   const char* WayDataFile::WAYS_DAT="ways.dat";
   const char* WayDataFile::WAYS_IDMAP="ways.idmap";
 
-  WayDataFile::WayDataFile(size_t cacheSize)
-  : DataFile<Way>(WAYS_DAT,cacheSize)
+  WayDataFile::WayDataFile(size_t cacheSize,
+                           size_t cacheMemory)
+  : DataFile<Way>(WAYS_DAT,cacheSize,cacheMemory)
   {
     // no code
   }
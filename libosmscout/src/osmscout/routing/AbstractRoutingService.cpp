@@ -50,6 +50,39 @@ namespace osmscout {
   {
   }
 
+  /**
+   * Take an idle search state from the scratch pool or create a new one, if the
+   * pool is empty
+   */
+  template <class RoutingState>
+  typename AbstractRoutingService<RoutingState>::SearchScratchRef AbstractRoutingService<RoutingState>::AcquireSearchScratch()
+  {
+    {
+      std::lock_guard<std::mutex> lock(scratchPoolMutex);
+
+      if (!scratchPool.empty()) {
+        SearchScratchRef scratch=std::move(scratchPool.back());
+
+        scratchPool.pop_back();
+
+        return scratch;
+      }
+    }
+
+    return SearchScratchRef(new SearchScratch());
+  }
+
+  /**
+   * Return the search state to the scratch pool for reuse by the next query
+   */
+  template <class RoutingState>
+  void AbstractRoutingService<RoutingState>::ReleaseSearchScratch(SearchScratchRef&& scratch)
+  {
+    std::lock_guard<std::mutex> lock(scratchPoolMutex);
+
+    scratchPool.push_back(std::move(scratch));
+  }
+
   template <class RoutingState>
   void AbstractRoutingService<RoutingState>::ResolveRNodeChainToList(DBFileOffset finalRouteNode,
                                                                      const ClosedSet& closedSet,
@@ -536,7 +569,6 @@ namespace osmscout {
                                                                   RNodeRef &current,
                                                                   RouteNodeRef &currentRouteNode,
                                                                   OpenList &openList,
-                                                                  OpenMap &openMap,
                                                                   const ClosedSet &closedSet,
                                                                   const ClosedSet &closedRestrictedSet)
   {
@@ -552,24 +584,20 @@ namespace osmscout {
 #endif
         continue;
       }
-      OpenMap::iterator twinIt=openMap.find(twin);
-      if (twinIt!=openMap.end()){
-        RNodeRef rn=(*twinIt->second);
+      RNodeRef rn=openList.Find(twin);
+      if (rn){
         if (rn->currentCost > current->currentCost){
           // this is cheaper path to twin
 
           rn->prev=current->nodeOffset;
           //rn->object=node->objects.begin()->object, /*TODO: how to find correct way from other DB?*/
 
-          rn->currentCost=current->currentCost;
-          rn->estimateCost=current->estimateCost;
-          rn->overallCost=current->overallCost;
           rn->access=current->access;
 
-          openList.erase(twinIt->second);
-
-          std::pair<OpenListRef,bool> insertResult=openList.insert(rn);
-          twinIt->second=insertResult.first;
+          openList.UpdateCosts(rn,
+                               current->currentCost,
+                               current->estimateCost,
+                               current->overallCost);
 
 #if defined(DEBUG_ROUTING)
           std::cout << "Better transition from " << rn->prev << " to " << rn->nodeOffset << std::endl;
@@ -591,8 +619,7 @@ namespace osmscout {
         rn->overallCost=current->overallCost;
         rn->access=current->access;
 
-        std::pair<OpenListRef,bool> insertResult=openList.insert(rn);
-        openMap[rn->nodeOffset]=insertResult.first;
+        openList.Push(rn);
 
 #if defined(DEBUG_ROUTING)
         std::cout << "Transition from " << rn->prev << " to " << rn->nodeOffset << std::endl;
@@ -607,7 +634,6 @@ namespace osmscout {
                                                        RNodeRef &current,
                                                        RouteNodeRef &currentRouteNode,
                                                        OpenList &openList,
-                                                       OpenMap &openMap,
                                                        ClosedSet &closedSet,
                                                        ClosedSet &closedRestrictedSet,
                                                        RoutingResult &result,
@@ -617,7 +643,10 @@ namespace osmscout {
                                                        size_t &nodesIgnoredCount,
                                                        double &currentMaxDistance,
                                                        const double &overallDistance,
-                                                       const double &costLimit)
+                                                       const double &costLimit,
+                                                       const LandmarkEstimate &targetEstimate,
+                                                       const GeoCoord *startCoord,
+                                                       const LandmarkEstimate &startEstimate)
   {
     DatabaseId dbId=current->nodeOffset.database;
     size_t i=0;
@@ -704,18 +733,18 @@ namespace osmscout {
 
       double currentCost=current->currentCost+GetCosts(state,dbId,*currentRouteNode,i);
 
-      OpenMap::iterator openEntry=openMap.find(DBFileOffset(current->nodeOffset.database,
-                                                            path.offset));
+      RNodeRef openNode=openList.Find(DBFileOffset(current->nodeOffset.database,
+                                                   path.offset));
 
       // Check, if we already have a cheaper path to the new node. If yes, do not put the new path
       // into the open list
-      if (openEntry!=openMap.end() &&
-          (*openEntry->second)->currentCost<=currentCost) {
+      if (openNode &&
+          openNode->currentCost<=currentCost) {
 #if defined(DEBUG_ROUTING)
         std::cout << "  Skipping route";
         std::cout << " to " << dbId << " / " << path.offset;
         std::cout << " (" << currentRouteNode->objects[path.objectIndex].object.GetName() << ")";
-        std::cout << " => cheaper route exists " << currentCost << "<=>" << (*openEntry->second)->object.GetName() << " " << (*openEntry->second)->node->GetId() << " " << (*openEntry->second)->currentCost << std::endl;
+        std::cout << " => cheaper route exists " << currentCost << "<=>" << openNode->object.GetName() << " " << openNode->node->GetId() << " " << openNode->currentCost << std::endl;
 #endif
         i++;
 
@@ -724,8 +753,8 @@ namespace osmscout {
 
       RouteNodeRef nextNode;
 
-      if (openEntry!=openMap.end()) {
-        nextNode=(*openEntry->second)->node;
+      if (openNode) {
+        nextNode=openNode->node;
       }
       else if (!GetRouteNodeByOffset(DBFileOffset(current->nodeOffset.database,
                                                   path.offset),
@@ -741,7 +770,10 @@ namespace osmscout {
       result.SetCurrentMaxDistance(currentMaxDistance);
 
       // Estimate costs for the rest of the distance to the target
-      double estimateCost=GetEstimateCosts(state,dbId,distanceToTarget);
+      double estimateCost=GetEstimateCosts(state,
+                                           dbId,
+                                           targetEstimate.GetDistance(path.offset,
+                                                                      distanceToTarget));
       double overallCost=currentCost+estimateCost;
 
       if (overallCost>costLimit) {
@@ -758,31 +790,36 @@ namespace osmscout {
         continue;
       }
 
+      // The bidirectional search uses half of the difference of the estimates to the
+      // target and to the start as potential (see CalculateRouteBidirectional())
+      if (startCoord!=NULL) {
+        estimateCost=(estimateCost-GetEstimateCosts(state,
+                                                     dbId,
+                                                     startEstimate.GetDistance(path.offset,
+                                                                               GetSphericalDistance(nextNode->GetCoord(),
+                                                                                                    *startCoord))))/2;
+        overallCost=currentCost+estimateCost;
+      }
+
       if (parameter.GetProgress()) {
         parameter.GetProgress()->Progress(currentMaxDistance,overallDistance);
       }
 
       // If we already have the node in the open list, but the new path is cheaper,
       // update the existing entry
-      if (openEntry!=openMap.end()) {
-        RNodeRef node=*openEntry->second;
-
-        node->prev=current->nodeOffset;
-        node->object=currentRouteNode->objects[path.objectIndex].object;
-
-        node->currentCost=currentCost;
-        node->estimateCost=estimateCost;
-        node->overallCost=overallCost;
-        node->access=!currentRouteNode->paths[i].IsRestricted(vehicle);
+      if (openNode) {
+        openNode->prev=current->nodeOffset;
+        openNode->object=currentRouteNode->objects[path.objectIndex].object;
+        openNode->access=!currentRouteNode->paths[i].IsRestricted(vehicle);
 
 #if defined(DEBUG_ROUTING)
-        std::cout << "  Updating route " << current->nodeOffset << " via " << node->object.GetTypeName() << " " << node->object.GetFileOffset() << " " << currentCost << " " << estimateCost << " " << overallCost << " " << currentRouteNode->GetId() << std::endl;
+        std::cout << "  Updating route " << current->nodeOffset << " via " << openNode->object.GetTypeName() << " " << openNode->object.GetFileOffset() << " " << currentCost << " " << estimateCost << " " << overallCost << " " << currentRouteNode->GetId() << std::endl;
 #endif
 
-        openList.erase(openEntry->second);
-
-        std::pair<OpenListRef,bool> insertResult=openList.insert(node);
-        openEntry->second=insertResult.first;
+        openList.UpdateCosts(openNode,
+                             currentCost,
+                             estimateCost,
+                             overallCost);
       }
       else {
         RNodeRef node=std::make_shared<RNode>(DBFileOffset(dbId,path.offset),
@@ -801,8 +838,7 @@ namespace osmscout {
         std::cout << " " << currentCost << " " << estimateCost << " " << overallCost << " " << currentRouteNode->GetId() << std::endl;
 #endif
 
-        std::pair<OpenListRef,bool> insertResult=openList.insert(node);
-        openMap[node->nodeOffset]=insertResult.first;
+        openList.Push(node);
       }
 
       i++;
@@ -811,149 +847,1620 @@ namespace osmscout {
   }
 
   /**
-   * Calculate a route
+   * Expands the current node of the backward search of a bidirectional search.
    *
-   * @param state
-   *    State to use
-   * @param start
-   *    Start of the route
-   * @param target
-   *    Target of teh route
-   * @param progress
-   *    Optional callback for handling routing progress
-   * @param route
-   *    The route object holding the resulting route on success
-   * @return
-   *    True, if the engine was able to find a route, else false
+   * The backward search walks against the path direction. The route node file only holds
+   * the outgoing paths of a route node, so the route nodes having a path to the current
+   * route node are taken from the incoming paths of the given node of the route graph.
+   * The cheapest usable path of such a route node to the current route node defines
+   * the costs.
    */
   template <class RoutingState>
-  RoutingResult AbstractRoutingService<RoutingState>::CalculateRoute(RoutingState& state,
-                                                                     const RoutePosition& start,
-                                                                     const RoutePosition& target,
-                                                                     const RoutingParameter& parameter)
+  bool AbstractRoutingService<RoutingState>::WalkPathsBackward(const RoutingState &state,
+                                                               RNodeRef &current,
+                                                               RouteNodeRef &currentRouteNode,
+                                                               const RouteGraph& graph,
+                                                               uint32_t graphNode,
+                                                               BidirectionalSearch& search,
+                                                               RoutingResult &result,
+                                                               const RoutingParameter& parameter,
+                                                               const GeoCoord &startCoord,
+                                                               const GeoCoord &targetCoord,
+                                                               const Vehicle &vehicle,
+                                                               size_t &nodesIgnoredCount,
+                                                               double &currentMaxDistance,
+                                                               const double &overallDistance,
+                                                               const double &costLimit,
+                                                               const LandmarkEstimate &startEstimate,
+                                                               const LandmarkEstimate &targetEstimate)
   {
-    RoutingResult            result;
-    Vehicle                  vehicle=GetVehicle(state);
-    RouteNodeRef             startForwardRouteNode;
-    RouteNodeRef             startBackwardRouteNode;
-    RNodeRef                 startForwardNode;
-    RNodeRef                 startBackwardNode;
+    DatabaseId dbId=current->nodeOffset.database;
 
-    GeoCoord                 startCoord;
-    GeoCoord                 targetCoord;
+    for (uint32_t i=graph.GetFirstIncomingPath(graphNode); i<graph.GetLastIncomingPath(graphNode); i++) {
+      uint32_t             incomingPath=graph.GetIncomingPath(i);
+      DBFileOffset         prevOffset(dbId,graph.GetNodeOffset(graph.GetPathSource(incomingPath)));
+      const ObjectFileRef& object=graph.GetPathObject(incomingPath);
 
-    RouteNodeRef             targetForwardRouteNode;
-    RouteNodeRef             targetBackwardRouteNode;
+      if (prevOffset==current->prev) {
+#if defined(DEBUG_ROUTING)
+        std::cout << "  Skipping route";
+        std::cout << " from " << prevOffset;
+        std::cout << " (" << object.GetTypeName() << " " << object.GetFileOffset() << ")";
+        std::cout << " => back to the last node visited" << std::endl;
+#endif
+        nodesIgnoredCount++;
 
-    // Sorted list (smallest cost first) of ways to check (we are using a std::set)
-    OpenList                 openList;
-    // Map routing nodes by id
-    OpenMap                  openMap;
+        continue;
+      }
 
-    // Restricted way (access=destination) is a way that may be used just
-    // in case when target is on this way. Some routing nodes may be accessed
-    // from two different ways - one without any access restriction (closedSet)
-    // and second with restriction (closedRestrictedSet)
-    ClosedSet                closedSet;
-    ClosedSet                closedRestrictedSet;
+      // In contrast to the forward search, a node handled without access is cheaper and
+      // less constrained than any later visit of the node with access (access here
+      // means that the way to the target already contains an unrestricted path). So
+      // such visits are not required and a node reached with access is handled only once
+      bool closedWithAccess=search.closedSet.find(VNode(prevOffset))!=search.closedSet.end();
 
-    size_t                   nodesLoadedCount=0;
-    size_t                   nodesIgnoredCount=0;
-    size_t                   maxOpenList=0;
-    size_t                   maxClosedSet=0;
+      if (search.closedRestrictedSet.find(VNode(prevOffset))!=search.closedRestrictedSet.end() ||
+          (current->access && closedWithAccess)) {
+#if defined(DEBUG_ROUTING)
+        std::cout << "  Skipping route";
+        std::cout << " from " << prevOffset;
+        std::cout << " (" << object.GetTypeName() << " " << object.GetFileOffset() << ")";
+        std::cout << " => already calculated" << std::endl;
+#endif
+        continue;
+      }
 
-    openMap.reserve(10000);
-    closedSet.reserve(300000);
-    closedRestrictedSet.reserve(10000);
+      RNodeRef     openNode=search.openList->Find(prevOffset);
+      RouteNodeRef prevNode;
 
-    if (!GetTargetNodes(state,
-                        target,
-                        targetCoord,
-                        targetForwardRouteNode,
-                        targetBackwardRouteNode)) {
-      return result;
-    }
+      if (openNode) {
+        prevNode=openNode->node;
+      }
+      else if (!GetRouteNodeByOffset(prevOffset,
+                                     prevNode)) {
+        log.Error() << "Cannot load route node with id " << prevOffset.offset;
+        return false;
+      }
 
-    if (!GetStartNodes(state,
-                       start,
-                       startCoord,
-                       targetCoord,
-                       startForwardRouteNode,
-                       startBackwardRouteNode,
-                       startForwardNode,
-                       startBackwardNode)) {
-      return result;
-    }
+      // Find the cheapest usable path from the previous route node to the current route node
+      size_t pathIndex=prevNode->paths.size();
+      double pathCost=0.0;
+
+      for (size_t i=0; i<prevNode->paths.size(); i++) {
+        const RouteNode::Path& prevPath=prevNode->paths[i];
+
+        if (prevPath.offset!=currentRouteNode->GetFileOffset() ||
+            prevNode->objects[prevPath.objectIndex].object!=object) {
+          continue;
+        }
+
+        // A route cannot move from a restricted path back to an unrestricted path
+        if (current->access &&
+            prevPath.IsRestricted(vehicle)) {
+          continue;
+        }
+
+        if (closedWithAccess &&
+            !prevPath.IsRestricted(vehicle)) {
+          continue;
+        }
+
+        if (!CanUse(state,
+                    dbId,
+                    *prevNode,
+                    i)) {
+          continue;
+        }
+
+        double cost=GetCosts(state,dbId,*prevNode,i);
+
+        if (pathIndex==prevNode->paths.size() ||
+            cost<pathCost) {
+          pathIndex=i;
+          pathCost=cost;
+        }
+      }
 
+      if (pathIndex==prevNode->paths.size()) {
 #if defined(DEBUG_ROUTING)
-    if (startForwardNode) {
-      std::cout << "StartForwardNode:   " << start.GetObjectFileRef().GetName() << " " << startForwardRouteNode->GetId() << " "
-                << startForwardNode->currentCost << " " << startForwardNode->estimateCost << " " << startForwardNode->overallCost
-                << std::endl;
-    }
-    if (startBackwardNode) {
-      std::cout << "StartBackwardNode:  " << start.GetObjectFileRef().GetName() << " " << startBackwardRouteNode->GetId() << " "
-                << startBackwardNode->currentCost << " " << startBackwardNode->estimateCost << " " << startBackwardNode->overallCost
-                << std::endl;
-    }
-    if (targetForwardRouteNode) {
-      std::cout << "TargetForwardNode:  " << target.GetObjectFileRef().GetName() << " " << targetForwardRouteNode->GetId() << std::endl;
-    }
-    if (startBackwardNode) {
-      std::cout << "TargetBackwardNode: " << target.GetObjectFileRef().GetName() << " " << targetBackwardRouteNode->GetId() << std::endl;
-    }
+        std::cout << "  Skipping route";
+        std::cout << " from " << prevOffset;
+        std::cout << " (" << object.GetTypeName() << " " << object.GetFileOffset() << ")";
+        std::cout << " => Cannot be used"<< std::endl;
 #endif
+        nodesIgnoredCount++;
 
-    if (parameter.GetBreaker() &&
-        parameter.GetBreaker()->IsAborted()) {
-      return result;
-    }
+        continue;
+      }
 
-    if (startForwardNode) {
-      std::pair<OpenListRef,bool> insertResult=openList.insert(startForwardNode);
+      if (!currentRouteNode->excludes.empty()) {
+        bool canTurnedInto=true;
 
-      openMap[startForwardNode->nodeOffset]=insertResult.first;
-    }
+        for (const auto& exclude : currentRouteNode->excludes) {
+          if (exclude.source==object &&
+              currentRouteNode->objects[exclude.targetIndex].object==current->object) {
+#if defined(DEBUG_ROUTING)
+            std::cout << "  Skipping route";
+            std::cout << " from " << prevOffset;
+            std::cout << " (" << object.GetName() << ")";
+            std::cout << " => turn not allowed" << std::endl;
+#endif
+            canTurnedInto=false;
+            break;
+          }
+        }
 
-    if (startBackwardNode) {
-      std::pair<OpenListRef,bool> insertResult=openList.insert(startBackwardNode);
+        if (!canTurnedInto) {
+          nodesIgnoredCount++;
+
+          continue;
+        }
+      }
+
+      double currentCost=current->currentCost+pathCost;
+
+      // Check, if we already have a cheaper path from the previous node. If yes, do not put the new path
+      // into the open list
+      if (openNode &&
+          openNode->currentCost<=currentCost) {
+#if defined(DEBUG_ROUTING)
+        std::cout << "  Skipping route";
+        std::cout << " from " << prevOffset;
+        std::cout << " (" << object.GetName() << ")";
+        std::cout << " => cheaper route exists" << std::endl;
+#endif
+        continue;
+      }
+
+      double distanceToStart=GetSphericalDistance(prevNode->GetCoord(),
+                                                  startCoord);
+
+      currentMaxDistance=std::max(currentMaxDistance,overallDistance-distanceToStart);
+      result.SetCurrentMaxDistance(currentMaxDistance);
+
+      // Estimate costs for the rest of the distance to the start
+      double estimateCost=GetEstimateCosts(state,
+                                           dbId,
+                                           startEstimate.GetDistance(prevOffset.offset,
+                                                                     distanceToStart));
+      double overallCost=currentCost+estimateCost;
+
+      if (overallCost>costLimit) {
+#if defined(DEBUG_ROUTING)
+        std::cout << "  Skipping route";
+        std::cout << " from " << prevOffset;
+        std::cout << " (" << object.GetTypeName() << " " << object.GetFileOffset() << ")";
+        std::cout << " => cost limit reached (" << overallCost << ">" << costLimit << ")" << std::endl;
+#endif
+        nodesIgnoredCount++;
+
+        continue;
+      }
+
+      // Use half of the difference of the estimates to the start and to the target as
+      // potential (see CalculateRouteBidirectional())
+      estimateCost=(estimateCost-GetEstimateCosts(state,
+                                                  dbId,
+                                                  targetEstimate.GetDistance(prevOffset.offset,
+                                                                             GetSphericalDistance(prevNode->GetCoord(),
+                                                                                                  targetCoord))))/2;
+      overallCost=currentCost+estimateCost;
+
+      if (parameter.GetProgress()) {
+        parameter.GetProgress()->Progress(currentMaxDistance,overallDistance);
+      }
+
+      // If we already have the node in the open list, but the new path is cheaper,
+      // update the existing entry
+      if (openNode) {
+        openNode->prev=current->nodeOffset;
+        openNode->object=object;
+        openNode->access=!prevNode->paths[pathIndex].IsRestricted(vehicle);
+
+#if defined(DEBUG_ROUTING)
+        std::cout << "  Updating route " << prevOffset << " via " << openNode->object.GetTypeName() << " " << openNode->object.GetFileOffset() << " " << currentCost << " " << estimateCost << " " << overallCost << std::endl;
+#endif
 
-      openMap[startBackwardNode->nodeOffset]=insertResult.first;
+        search.openList->UpdateCosts(openNode,
+                                     currentCost,
+                                     estimateCost,
+                                     overallCost);
+      }
+      else {
+        RNodeRef node=std::make_shared<RNode>(prevOffset,
+                                              prevNode,
+                                              object,
+                                              current->nodeOffset);
+
+        node->currentCost=currentCost;
+        node->estimateCost=estimateCost;
+        node->overallCost=overallCost;
+        node->access=!prevNode->paths[pathIndex].IsRestricted(vehicle);
+
+#if defined(DEBUG_ROUTING)
+        std::cout << "  Inserting route from " << prevOffset;
+        std::cout <<  " (" << node->object.GetTypeName() << " " << node->object.GetFileOffset() << ")";
+        std::cout << " " << currentCost << " " << estimateCost << " " << overallCost << std::endl;
+#endif
+
+        search.openList->Push(node);
+      }
     }
 
+    return true;
+  }
 
-    double currentMaxDistance=0.0;
-    double overallDistance=GetSphericalDistance(startCoord,
-                                                targetCoord);
-    double overallCost=GetEstimateCosts(state,start.GetDatabaseId(),overallDistance);
-    double costLimit=GetCostLimit(state,start.GetDatabaseId(),overallDistance);
+  /**
+   * Checks all combinations of labels of the forward and the backward search at the given
+   * route node and updates the meeting, if a cheaper valid route passes the route node.
+   *
+   * @return
+   *    false in case of technical errors, else true
+   */
+  template <class RoutingState>
+  bool AbstractRoutingService<RoutingState>::CheckBidirectionalMeeting(const DBFileOffset& offset,
+                                                                       const BidirectionalSearch& forward,
+                                                                       const BidirectionalSearch& backward,
+                                                                       BidirectionalMeeting& meeting,
+                                                                       bool& met)
+  {
+    auto collectLabels=[&offset](const BidirectionalSearch& search,
+                                 std::vector<RNodeRef>& labels) {
+      RNodeRef openNode=search.openList->Find(offset);
 
-    result.SetOverallDistance(overallDistance);
-    result.SetCurrentMaxDistance(currentMaxDistance);
+      if (openNode) {
+        labels.push_back(openNode);
+      }
 
-    StopClock    clock;
-    RNodeRef     current;
-    RouteNodeRef currentRouteNode;
-    DatabaseId   dbId;
-    bool         targetForwardFound=targetForwardRouteNode ? false : true;
-    bool         targetBackwardFound=targetBackwardRouteNode ? false : true;
-    RNodeRef     targetForwardFinalNode;
-    RNodeRef     targetBackwardFinalNode;
+      SettledMap::const_iterator settledEntry=search.settled.find(offset);
 
-    do {
-      //
-      // Take entry from open list with lowest cost
-      //
+      if (settledEntry!=search.settled.end()) {
+        labels.push_back(settledEntry->second);
+      }
 
-      if (parameter.GetBreaker() &&
-          parameter.GetBreaker()->IsAborted()) {
-        return result;
+      settledEntry=search.settledRestricted.find(offset);
+
+      if (settledEntry!=search.settledRestricted.end()) {
+        labels.push_back(settledEntry->second);
       }
+    };
+
+    std::vector<RNodeRef> forwardLabels;
+    std::vector<RNodeRef> backwardLabels;
+
+    collectLabels(forward,forwardLabels);
 
-      current=*openList.begin();
+    if (forwardLabels.empty()) {
+      return true;
+    }
+
+    collectLabels(backward,backwardLabels);
+
+    RouteNodeRef routeNode;
+
+    for (const auto& forwardLabel : forwardLabels) {
+      for (const auto& backwardLabel : backwardLabels) {
+        // A route cannot move from a restricted path back to an unrestricted path
+        if (!forwardLabel->access &&
+            backwardLabel->access) {
+          continue;
+        }
+
+        double cost=forwardLabel->currentCost+backwardLabel->currentCost;
+
+        if (met &&
+            cost>=meeting.cost) {
+          continue;
+        }
+
+        // Turning back to the last node visited
+        if (forwardLabel->prev.IsValid() &&
+            forwardLabel->prev==backwardLabel->prev) {
+          continue;
+        }
+
+        if (forwardLabel->object.Valid() &&
+            backwardLabel->object.Valid()) {
+          if (!routeNode &&
+              !GetRouteNodeByOffset(offset,
+                                    routeNode)) {
+            log.Error() << "Cannot load route node with id " << offset.offset;
+            return false;
+          }
+
+          bool canTurnedInto=true;
+
+          for (const auto& exclude : routeNode->excludes) {
+            if (exclude.source==forwardLabel->object &&
+                routeNode->objects[exclude.targetIndex].object==backwardLabel->object) {
+              canTurnedInto=false;
+              break;
+            }
+          }
+
+          if (!canTurnedInto) {
+            continue;
+          }
+        }
+
+#if defined(DEBUG_ROUTING)
+        std::cout << "Searches meet at " << offset << " " << cost << std::endl;
+#endif
+
+        meeting.node=offset;
+        meeting.forwardPrev=forwardLabel->prev;
+        meeting.forwardObject=forwardLabel->object;
+        meeting.backwardNext=backwardLabel->prev;
+        meeting.backwardObject=backwardLabel->object;
+        meeting.backwardAccess=backwardLabel->access;
+        meeting.cost=cost;
+
+        met=true;
+      }
+    }
+
+    return true;
+  }
+
+  /**
+   * Appends the route from the meeting node to the target, as found by the backward
+   * search, to the given list.
+   */
+  template <class RoutingState>
+  void AbstractRoutingService<RoutingState>::ResolveBackwardRNodeChainToList(const BidirectionalMeeting& meeting,
+                                                                             const ClosedSet& closedSet,
+                                                                             const ClosedSet& closedRestrictedSet,
+                                                                             std::list<VNode>& nodes)
+  {
+    DBFileOffset  current=meeting.node;
+    DBFileOffset  next=meeting.backwardNext;
+    ObjectFileRef object=meeting.backwardObject;
+    bool          restricted=!meeting.backwardAccess;
+
+    while (next.IsValid()) {
+#if defined(DEBUG_ROUTING)
+      std::cout << "Chain item " << current << " -> " << next << std::endl;
+#endif
+      nodes.push_back(VNode(next,
+                            object,
+                            current));
+
+      ClosedSet::const_iterator entry;
+      if (!restricted){
+        entry=closedSet.find(VNode(next));
+        if (entry==closedSet.end()){
+          entry=closedRestrictedSet.find(VNode(next));
+          assert(entry!=closedRestrictedSet.end());
+          restricted=true;
+        }
+      }else{
+        entry=closedRestrictedSet.find(VNode(next));
+        if (entry==closedRestrictedSet.end()){
+          entry=closedSet.find(VNode(next));
+          assert(entry!=closedSet.end());
+          restricted=false;
+        }
+      }
+
+      current=next;
+      next=entry->previousNode;
+      object=entry->object;
+    }
+  }
+
+  /**
+   * Calculate a route using a bidirectional A* search. One search starts at the start
+   * route nodes, the other one walks the paths backward starting at the target route
+   * nodes.
+   *
+   * To keep the potentials of both searches consistent with each other, the forward
+   * search uses half of the difference of the estimated costs to the target and to
+   * the start as potential and the backward search the negated value. The searches
+   * stop as soon as the sum of the smallest overall costs of both open lists is not
+   * less than the costs of the cheapest route found, where both searches meet.
+   *
+   * @param state
+   *    State to use
+   * @param start
+   *    Start of the route
+   * @param target
+   *    Target of the route
+   * @param parameter
+   *    Optional callbacks for handling routing progress and break requests
+   * @param scratch
+   *    Search state to use
+   * @return
+   *    The result, holding the route on success
+   */
+  template <class RoutingState>
+  RoutingResult AbstractRoutingService<RoutingState>::CalculateRouteBidirectional(RoutingState& state,
+                                                                                  const RoutePosition& start,
+                                                                                  const RoutePosition& target,
+                                                                                  const RoutingParameter& parameter,
+                                                                                  SearchScratch& scratch)
+  {
+    RoutingResult        result;
+    Vehicle              vehicle=GetVehicle(state);
+    RouteNodeRef         startForwardRouteNode;
+    RouteNodeRef         startBackwardRouteNode;
+    RNodeRef             startForwardNode;
+    RNodeRef             startBackwardNode;
+
+    GeoCoord             startCoord;
+    GeoCoord             targetCoord;
+
+    RouteNodeRef         targetForwardRouteNode;
+    RouteNodeRef         targetBackwardRouteNode;
+
+    LandmarkEstimate     startEstimate;
+    LandmarkEstimate     targetEstimate;
+
+    BidirectionalSearch& forward=scratch.forward;
+    BidirectionalSearch& backward=scratch.backward;
+    BidirectionalMeeting meeting;
+    bool                 met=false;
+
+    size_t               nodesLoadedCount=0;
+    size_t               nodesIgnoredCount=0;
+    size_t               maxOpenList=0;
+    size_t               maxClosedSet=0;
+
+    for (BidirectionalSearch* search : {&forward,&backward}) {
+      scratch.PrepareOpenList(search->openList,
+                              parameter);
+      SearchScratch::PrepareClosedSet(search->closedSet,
+                                      100000);
+      SearchScratch::PrepareClosedSet(search->closedRestrictedSet,
+                                      10000);
+      search->settled.clear();
+      search->settledRestricted.clear();
+    }
+
+    if (!GetTargetNodes(state,
+                        target,
+                        targetCoord,
+                        targetForwardRouteNode,
+                        targetBackwardRouteNode)) {
+      return result;
+    }
+
+    if (!GetStartNodes(state,
+                       start,
+                       startCoord,
+                       targetCoord,
+                       startForwardRouteNode,
+                       startBackwardRouteNode,
+                       startForwardNode,
+                       startBackwardNode)) {
+      return result;
+    }
+
+    if (parameter.GetBreaker() &&
+        parameter.GetBreaker()->IsAborted()) {
+      return result;
+    }
+
+    if (start.GetDatabaseId()==target.GetDatabaseId()) {
+      InitializeLandmarkEstimate(state,
+                                 start.GetDatabaseId(),
+                                 startForwardRouteNode,
+                                 startBackwardRouteNode,
+                                 startEstimate);
+      InitializeLandmarkEstimate(state,
+                                 target.GetDatabaseId(),
+                                 targetForwardRouteNode,
+                                 targetBackwardRouteNode,
+                                 targetEstimate);
+    }
+
+    for (const auto& node : {startForwardNode,startBackwardNode}) {
+      if (!node) {
+        continue;
+      }
+
+      ApplyLandmarkEstimate(state,
+                            targetEstimate,
+                            node);
+
+      node->estimateCost=(node->estimateCost-GetEstimateCosts(state,
+                                                              start.GetDatabaseId(),
+                                                              startEstimate.GetDistance(node->nodeOffset.offset,
+                                                                                        GetSphericalDistance(node->node->GetCoord(),
+                                                                                                             startCoord))))/2;
+      node->overallCost=node->currentCost+node->estimateCost;
+
+      forward.openList->Push(node);
+    }
+
+    for (const auto& targetRouteNode : {targetForwardRouteNode,targetBackwardRouteNode}) {
+      if (!targetRouteNode) {
+        continue;
+      }
+
+      DBFileOffset targetOffset(target.GetDatabaseId(),
+                                targetRouteNode->GetFileOffset());
+
+      if (backward.openList->Find(targetOffset)) {
+        continue;
+      }
+
+      RNodeRef node=std::make_shared<RNode>(targetOffset,
+                                            targetRouteNode,
+                                            ObjectFileRef());
+
+      node->currentCost=0.0;
+      node->estimateCost=(GetEstimateCosts(state,
+                                           target.GetDatabaseId(),
+                                           startEstimate.GetDistance(targetOffset.offset,
+                                                                     GetSphericalDistance(targetRouteNode->GetCoord(),
+                                                                                          startCoord)))-
+                          GetEstimateCosts(state,
+                                           target.GetDatabaseId(),
+                                           targetEstimate.GetDistance(targetOffset.offset,
+                                                                      GetSphericalDistance(targetRouteNode->GetCoord(),
+                                                                                           targetCoord))))/2;
+      node->overallCost=node->estimateCost;
+      // The route may end with paths with access restrictions
+      node->access=false;
+
+      backward.openList->Push(node);
+    }
+
+    double currentMaxDistance=0.0;
+    double overallDistance=GetSphericalDistance(startCoord,
+                                                targetCoord);
+    double overallCost=GetEstimateCosts(state,start.GetDatabaseId(),overallDistance);
+    double costLimit=GetCostLimit(state,start.GetDatabaseId(),overallDistance);
+
+    result.SetOverallDistance(overallDistance);
+    result.SetCurrentMaxDistance(currentMaxDistance);
+
+    StopClock    clock;
+    RNodeRef     current;
+    RouteNodeRef currentRouteNode;
+    DatabaseId   dbId;
+
+    while (!forward.openList->IsEmpty() &&
+           !backward.openList->IsEmpty()) {
+      if (parameter.GetBreaker() &&
+          parameter.GetBreaker()->IsAborted()) {
+        return result;
+      }
+
+      if (met &&
+          forward.openList->GetTop()->overallCost+backward.openList->GetTop()->overallCost>=meeting.cost) {
+#if defined(DEBUG_ROUTING)
+        std::cout << "No cheaper route possible, stopping" << std::endl;
+#endif
+        break;
+      }
+
+      //
+      // Take entry with lowest cost from the open list of the search with less open nodes
+      //
+
+      bool                 isForward=forward.openList->GetSize()<=backward.openList->GetSize();
+      BidirectionalSearch& search=isForward ? forward : backward;
+
+      current=search.openList->Pop();
+
+      currentRouteNode=current->node;
+      dbId=current->nodeOffset.database;
+
+      nodesLoadedCount++;
+
+#if defined(DEBUG_ROUTING)
+      std::cout << "Analysing " << (isForward ? "follower" : "predecessor") << " of node " << dbId << " / " << currentRouteNode->GetFileOffset();
+      std::cout << " (" << current->object.GetName() << "["  << currentRouteNode->GetId() << "]" << ")";
+      std::cout << " " << current->currentCost << " " << current->estimateCost << " " << current->overallCost << std::endl;
+#endif
+
+      //
+      // If the other search has already handled the node, the cheapest route via the node
+      // is known (see CheckBidirectionalMeeting() below) and there is no need to walk on
+      //
+
+      const BidirectionalSearch& other=isForward ? backward : forward;
+      bool                       expand=true;
+
+      if (currentRouteNode->excludes.empty()) {
+        for (const SettledMap* settled : {&other.settled,&other.settledRestricted}) {
+          SettledMap::const_iterator entry=settled->find(current->nodeOffset);
+
+          if (entry==settled->end()) {
+            continue;
+          }
+
+          const RNodeRef& forwardLabel=isForward ? current : entry->second;
+          const RNodeRef& backwardLabel=isForward ? entry->second : current;
+
+          if ((forwardLabel->access || !backwardLabel->access) &&
+              (!forwardLabel->prev.IsValid() || forwardLabel->prev!=backwardLabel->prev)) {
+            expand=false;
+          }
+        }
+      }
+
+      // The backward search takes the incoming paths of the route node from the route graph
+      const RouteGraph* graph=NULL;
+      uint32_t          graphNode=RouteGraph::INVALID_NODE;
+
+      if (!isForward) {
+        graph=RequireRouteGraph(dbId);
+
+        if (graph==NULL) {
+          log.Error() << "Bidirectional search requires the route graph of database " << dbId;
+          return result;
+        }
+
+        graphNode=graph->GetNode(currentRouteNode->GetFileOffset());
+
+        if (graphNode==RouteGraph::INVALID_NODE) {
+          log.Error() << "Cannot find route node " << dbId << " / " << currentRouteNode->GetFileOffset() << " in route graph";
+          return result;
+        }
+      }
+
+      if (!expand) {
+        nodesIgnoredCount++;
+      }
+      else if (isForward) {
+        if (!WalkPaths(state,
+                       current,
+                       currentRouteNode,
+                       *forward.openList,
+                       forward.closedSet,
+                       forward.closedRestrictedSet,
+                       result,
+                       parameter,
+                       targetCoord,
+                       vehicle,
+                       nodesIgnoredCount,
+                       currentMaxDistance,
+                       overallDistance,
+                       costLimit,
+                       targetEstimate,
+                       &startCoord,
+                       startEstimate)) {
+          log.Error() << "Failed to walk paths from " << dbId << " / " << currentRouteNode->GetFileOffset();
+          return result;
+        }
+      }
+      else if (!WalkPathsBackward(state,
+                                  current,
+                                  currentRouteNode,
+                                  *graph,
+                                  graphNode,
+                                  backward,
+                                  result,
+                                  parameter,
+                                  startCoord,
+                                  targetCoord,
+                                  vehicle,
+                                  nodesIgnoredCount,
+                                  currentMaxDistance,
+                                  overallDistance,
+                                  costLimit,
+                                  startEstimate,
+                                  targetEstimate)) {
+        log.Error() << "Failed to walk paths backward from " << dbId << " / " << currentRouteNode->GetFileOffset();
+        return result;
+      }
+
+      if (expand &&
+          !WalkToOtherDatabases(state,
+                                current,
+                                currentRouteNode,
+                                *search.openList,
+                                search.closedSet,
+                                search.closedRestrictedSet)) {
+        log.Error() << "Failed to walk to other databases from " << dbId << " / " << currentRouteNode->GetFileOffset();
+        return result;
+      }
+
+      //
+      // Add current node to close map
+      //
+
+      if (current->access) {
+        search.closedSet.insert(VNode(current->nodeOffset,
+                                      current->object,
+                                      current->prev));
+        search.settled.insert(std::make_pair(current->nodeOffset,current));
+      }
+      else {
+        search.closedRestrictedSet.insert(VNode(current->nodeOffset,
+                                                current->object,
+                                                current->prev));
+        search.settledRestricted.insert(std::make_pair(current->nodeOffset,current));
+      }
+
+      current->node=NULL;
+
+      //
+      // Check, if the searches meet at the current node or at one of the nodes just reached
+      //
+
+      if (!CheckBidirectionalMeeting(current->nodeOffset,
+                                     forward,
+                                     backward,
+                                     meeting,
+                                     met)) {
+        return result;
+      }
+
+      if (isForward) {
+        for (const auto& path : currentRouteNode->paths) {
+          if (!CheckBidirectionalMeeting(DBFileOffset(dbId,path.offset),
+                                         forward,
+                                         backward,
+                                         meeting,
+                                         met)) {
+            return result;
+          }
+        }
+      }
+      else {
+        for (uint32_t i=graph->GetFirstIncomingPath(graphNode); i<graph->GetLastIncomingPath(graphNode); i++) {
+          if (!CheckBidirectionalMeeting(DBFileOffset(dbId,graph->GetNodeOffset(graph->GetPathSource(graph->GetIncomingPath(i)))),
+                                         forward,
+                                         backward,
+                                         meeting,
+                                         met)) {
+            return result;
+          }
+        }
+      }
+
+      for (const auto& twin : GetNodeTwins(state,
+                                           dbId,
+                                           currentRouteNode->GetId())) {
+        if (!CheckBidirectionalMeeting(twin,
+                                       forward,
+                                       backward,
+                                       meeting,
+                                       met)) {
+          return result;
+        }
+      }
+
+      maxOpenList=std::max(maxOpenList,forward.openList->GetSize()+backward.openList->GetSize());
+      maxClosedSet=std::max(maxClosedSet,
+                            forward.closedSet.size()+forward.closedRestrictedSet.size()+
+                            backward.closedSet.size()+backward.closedRestrictedSet.size());
+    }
+
+    clock.Stop();
+
+    if (debugPerformance) {
+      std::cout << "Time:                " << clock << std::endl;
+
+      std::cout << "Air-line distance:   " << std::fixed << std::setprecision(1) << overallDistance << "km" << std::endl;
+      std::cout << "Minimum cost:        " << overallCost << std::endl;
+      if (met) {
+        std::cout << "Actual cost:         " << meeting.cost << std::endl;
+      }
+      std::cout << "Cost limit:          " << costLimit << std::endl;
+      std::cout << "Route nodes loaded:  " << nodesLoadedCount << std::endl;
+      std::cout << "Route nodes ignored: " << nodesIgnoredCount << std::endl;
+      std::cout << "Max. OpenList size:  " << maxOpenList << std::endl;
+      std::cout << "Max. ClosedSet size: " << maxClosedSet << std::endl;
+    }
+
+    if (!met) {
+      log.Warn() << "No route found!";
+
+      return result;
+    }
+
+    if (parameter.GetBreaker() &&
+      parameter.GetBreaker()->IsAborted()) {
+      return result;
+    }
+
+    std::list<VNode> nodes;
+
+    if (meeting.forwardPrev.IsValid()) {
+      ResolveRNodeChainToList(meeting.forwardPrev,
+                              forward.closedSet,
+                              forward.closedRestrictedSet,
+                              nodes);
+    }
+
+    nodes.push_back(VNode(meeting.node,
+                          meeting.forwardObject,
+                          meeting.forwardPrev));
+
+    ResolveBackwardRNodeChainToList(meeting,
+                                    backward.closedSet,
+                                    backward.closedRestrictedSet,
+                                    nodes);
+
+#if defined(DEBUG_ROUTING)
+    std::cout << "VNode List:" << std::endl;
+    for (const auto& node : nodes) {
+      std::cout << node.object.GetName() << " " << node.currentNode.database << "/" << node.currentNode.offset << std::endl;
+    }
+#endif
+
+    if (!ResolveRNodesToRouteData(state,
+                                  nodes,
+                                  start,
+                                  target,
+                                  result.GetRoute())) {
+      return result;
+    }
+
+    ResolveRouteDataJunctions(result.GetRoute());
+
+    return result;
+  }
+
+  template <class RoutingState>
+  const RouteGraph* AbstractRoutingService<RoutingState>::GetRouteGraph(const DatabaseId /*database*/)
+  {
+    return NULL;
+  }
+
+  /**
+   * Return the in memory routing graph of the given database, loading it if it is not
+   * loaded yet. Used by searches that need the incoming paths of route nodes, like the
+   * backward search of the bidirectional search. Returns NULL, if there is no such graph.
+   */
+  template <class RoutingState>
+  const RouteGraph* AbstractRoutingService<RoutingState>::RequireRouteGraph(const DatabaseId /*database*/)
+  {
+    return NULL;
+  }
+
+  /**
+   * Return the landmarks of the routing graph of the given database or NULL, if
+   * there are none. Landmarks are only used, if start and target are part of the
+   * same database.
+   */
+  template <class RoutingState>
+  const Landmarks* AbstractRoutingService<RoutingState>::GetLandmarks(const RoutingState& /*state*/,
+                                                                      const DatabaseId /*database*/)
+  {
+    return NULL;
+  }
+
+  /**
+   * Initialize the landmark estimate for the distance to the given route nodes
+   * next to the start or the target of the route. The estimate stays inactive
+   * if there are no landmarks.
+   */
+  template <class RoutingState>
+  void AbstractRoutingService<RoutingState>::InitializeLandmarkEstimate(const RoutingState& state,
+                                                                        const DatabaseId database,
+                                                                        const RouteNodeRef& forwardRouteNode,
+                                                                        const RouteNodeRef& backwardRouteNode,
+                                                                        LandmarkEstimate& estimate)
+  {
+    estimate.Initialize(GetLandmarks(state,
+                                     database));
+
+    for (const auto& routeNode : {forwardRouteNode,backwardRouteNode}) {
+      if (routeNode) {
+        estimate.AddEnd(routeNode->GetFileOffset());
+      }
+    }
+  }
+
+  /**
+   * Raise the estimated costs of the given start node to the landmark estimate,
+   * GetRNode() only uses the spherical distance.
+   */
+  template <class RoutingState>
+  void AbstractRoutingService<RoutingState>::ApplyLandmarkEstimate(const RoutingState& state,
+                                                                   const LandmarkEstimate& targetEstimate,
+                                                                   const RNodeRef& node)
+  {
+    if (!node ||
+        !targetEstimate.IsActive()) {
+      return;
+    }
+
+    node->estimateCost=std::max(node->estimateCost,
+                                GetEstimateCosts(state,
+                                                 node->nodeOffset.database,
+                                                 targetEstimate.GetDistance(node->nodeOffset.offset,
+                                                                            0.0)));
+    node->overallCost=node->currentCost+node->estimateCost;
+  }
+
+  /**
+   * Build the list of VNodes from the start to the given final node from the
+   * closed labels of the last graph search. Follows the same rules as
+   * ResolveRNodeChainToList().
+   */
+  template <class RoutingState>
+  void AbstractRoutingService<RoutingState>::ResolveGraphChainToList(const RouteGraph& graph,
+                                                                     const GraphSearch& graphSearch,
+                                                                     DatabaseId database,
+                                                                     uint32_t finalNode,
+                                                                     std::list<VNode>& nodes)
+  {
+    uint32_t current=finalNode;
+    size_t   state=1;
+
+    if (!graphSearch.nodes[current].closed[1]) {
+      assert(graphSearch.nodes[current].closed[0]);
+      state=0;
+    }
+
+    while (true) {
+      const GraphSearchNode& node=graphSearch.nodes[current];
+      uint32_t              prev=node.closedPrev[state];
+
+      if (prev==RouteGraph::INVALID_NODE) {
+        nodes.push_back(VNode(DBFileOffset(database,graph.GetNodeOffset(current)),
+                              node.closedObject[state],
+                              DBFileOffset()));
+        break;
+      }
+
+      nodes.push_back(VNode(DBFileOffset(database,graph.GetNodeOffset(current)),
+                            node.closedObject[state],
+                            DBFileOffset(database,graph.GetNodeOffset(prev))));
+
+      if (state==1) {
+        if (!graphSearch.nodes[prev].closed[1]) {
+          assert(graphSearch.nodes[prev].closed[0]);
+          state=0;
+        }
+      }
+      else {
+        if (!graphSearch.nodes[prev].closed[0]) {
+          assert(graphSearch.nodes[prev].closed[1]);
+          state=1;
+        }
+      }
+
+      current=prev;
+    }
+
+    std::reverse(nodes.begin(),nodes.end());
+  }
+
+  /**
+   * Calculate a route using the A* search of CalculateRoute() on the in memory
+   * routing graph of a database (see RouterParameter::SetInMemoryGraph()).
+   *
+   * Start and target must be in the same database. Only the route nodes next to
+   * start and target are loaded from file, all other route nodes are taken from
+   * the graph. Node state is held in arrays indexed by the graph node index and
+   * the open list is a binary heap, so the search itself does not allocate memory
+   * per visited route node. The search follows exactly the rules of
+   * WalkPaths() and thus results in the same route.
+   *
+   * @param state
+   *    State to use
+   * @param graph
+   *    The routing graph of the database of start and target
+   * @param start
+   *    Start of the route
+   * @param target
+   *    Target of the route
+   * @param parameter
+   *    Optional callbacks for handling routing progress and break requests
+   * @param scratch
+   *    Search state to use
+   * @return
+   *    The result, holding the route on success
+   */
+  template <class RoutingState>
+  RoutingResult AbstractRoutingService<RoutingState>::CalculateRouteInGraph(RoutingState& state,
+                                                                            const RouteGraph& graph,
+                                                                            const RoutePosition& start,
+                                                                            const RoutePosition& target,
+                                                                            const RoutingParameter& parameter,
+                                                                            SearchScratch& scratch)
+  {
+    RoutingResult result;
+    Vehicle       vehicle=GetVehicle(state);
+    DatabaseId    dbId=start.GetDatabaseId();
+    RouteNodeRef  startForwardRouteNode;
+    RouteNodeRef  startBackwardRouteNode;
+    RNodeRef      startForwardNode;
+    RNodeRef      startBackwardNode;
+
+    GeoCoord      startCoord;
+    GeoCoord      targetCoord;
+
+    RouteNodeRef  targetForwardRouteNode;
+    RouteNodeRef  targetBackwardRouteNode;
+
+    LandmarkEstimate targetEstimate;
+
+    size_t        nodesLoadedCount=0;
+    size_t        nodesIgnoredCount=0;
+    size_t        maxOpenList=0;
+    size_t        maxClosedSet=0;
+    size_t        openCount=0;
+    size_t        closedCount=0;
+
+    GraphSearch&                   graphSearch=scratch.graphSearch;
+    std::vector<GraphSearchNode>&  nodes=graphSearch.nodes;
+    std::vector<GraphSearchEntry>& heap=graphSearch.heap;
+
+    if (!GetTargetNodes(state,
+                        target,
+                        targetCoord,
+                        targetForwardRouteNode,
+                        targetBackwardRouteNode)) {
+      return result;
+    }
+
+    if (!GetStartNodes(state,
+                       start,
+                       startCoord,
+                       targetCoord,
+                       startForwardRouteNode,
+                       startBackwardRouteNode,
+                       startForwardNode,
+                       startBackwardNode)) {
+      return result;
+    }
+
+    if (parameter.GetBreaker() &&
+        parameter.GetBreaker()->IsAborted()) {
+      return result;
+    }
+
+    uint32_t targetForwardNode=RouteGraph::INVALID_NODE;
+    uint32_t targetBackwardNode=RouteGraph::INVALID_NODE;
+
+    if (targetForwardRouteNode) {
+      targetForwardNode=graph.GetNode(targetForwardRouteNode->GetFileOffset());
+
+      if (targetForwardNode==RouteGraph::INVALID_NODE) {
+        log.Error() << "Cannot find route node " << targetForwardRouteNode->GetFileOffset() << " in route graph";
+        return result;
+      }
+    }
+
+    if (targetBackwardRouteNode) {
+      targetBackwardNode=graph.GetNode(targetBackwardRouteNode->GetFileOffset());
+
+      if (targetBackwardNode==RouteGraph::INVALID_NODE) {
+        log.Error() << "Cannot find route node " << targetBackwardRouteNode->GetFileOffset() << " in route graph";
+        return result;
+      }
+    }
+
+    InitializeLandmarkEstimate(state,
+                               dbId,
+                               targetForwardRouteNode,
+                               targetBackwardRouteNode,
+                               targetEstimate);
+
+    // If the landmarks belong to the same route node file, the nodes of both share the same index
+    bool landmarkNodes=targetEstimate.IsActive() &&
+                       targetEstimate.GetLandmarks()->GetNodeCount()==graph.GetNodeCount();
+
+    graphSearch.Init(graph.GetNodeCount());
+
+    for (const RNodeRef& startNode : {startForwardNode,startBackwardNode}) {
+      if (!startNode) {
+        continue;
+      }
+
+      ApplyLandmarkEstimate(state,
+                            targetEstimate,
+                            startNode);
+
+      uint32_t node=graph.GetNode(startNode->nodeOffset.offset);
+
+      if (node==RouteGraph::INVALID_NODE) {
+        log.Error() << "Cannot find route node " << startNode->nodeOffset.offset << " in route graph";
+        return result;
+      }
+
+      if (nodes[node].open &&
+          nodes[node].currentCost<=startNode->currentCost) {
+        continue;
+      }
+
+      graphSearch.Touch(node);
+
+      if (!nodes[node].open) {
+        openCount++;
+      }
+
+      nodes[node].currentCost=startNode->currentCost;
+      nodes[node].overallCost=startNode->overallCost;
+      nodes[node].prev=RouteGraph::INVALID_NODE;
+      nodes[node].object=startNode->object;
+      nodes[node].access=startNode->access;
+      nodes[node].open=true;
+
+      heap.push_back(GraphSearchEntry(startNode->overallCost,node));
+      std::push_heap(heap.begin(),heap.end(),std::greater<GraphSearchEntry>());
+    }
+
+    if (heap.empty()) {
+      return result;
+    }
+
+    double currentMaxDistance=0.0;
+    double overallDistance=GetSphericalDistance(startCoord,
+                                                targetCoord);
+    double overallCost=GetEstimateCosts(state,dbId,overallDistance);
+    double costLimit=GetCostLimit(state,dbId,overallDistance);
+
+    result.SetOverallDistance(overallDistance);
+    result.SetCurrentMaxDistance(currentMaxDistance);
+
+    StopClock       clock;
+    uint32_t        current=RouteGraph::INVALID_NODE;
+    GraphSearchNode currentLabel;
+    bool            targetForwardFound=targetForwardRouteNode ? false : true;
+    bool            targetBackwardFound=targetBackwardRouteNode ? false : true;
+    uint32_t        targetForwardFinalNode=RouteGraph::INVALID_NODE;
+    uint32_t        targetBackwardFinalNode=RouteGraph::INVALID_NODE;
+    double          targetForwardFinalCost=0.0;
+    double          targetBackwardFinalCost=0.0;
+
+    do {
+      //
+      // Take entry from open list with lowest cost
+      //
+
+      if (parameter.GetBreaker() &&
+          parameter.GetBreaker()->IsAborted()) {
+        return result;
+      }
+
+      current=heap.front().second;
+
+      std::pop_heap(heap.begin(),heap.end(),std::greater<GraphSearchEntry>());
+      heap.pop_back();
+
+      // The label may change while walking the paths, so we work on a copy
+      currentLabel=nodes[current];
+
+      nodes[current].open=false;
+      openCount--;
+
+      nodesLoadedCount++;
+
+      for (uint32_t path=graph.GetFirstPath(current); path<graph.GetLastPath(current); path++) {
+        uint32_t next=graph.GetPathTarget(path);
+
+        if (next==currentLabel.prev) {
+          nodesIgnoredCount++;
+          continue;
+        }
+
+        bool pathAccess=!graph.IsPathRestricted(path,vehicle);
+
+        if (!currentLabel.access &&
+            pathAccess) {
+          nodesIgnoredCount++;
+          continue;
+        }
+
+        if (!CanUse(state,
+                    dbId,
+                    graph,
+                    path)) {
+          nodesIgnoredCount++;
+          continue;
+        }
+
+        if (nodes[next].closed[currentLabel.access ? 1 : 0]) {
+          continue;
+        }
+
+        if (graph.IsExcluded(current,
+                             currentLabel.object,
+                             path)) {
+          nodesIgnoredCount++;
+          continue;
+        }
+
+        double currentCost=currentLabel.currentCost+GetCosts(state,dbId,graph,path);
+
+        // Check, if we already have a cheaper path to the new node
+        if (nodes[next].open &&
+            nodes[next].currentCost<=currentCost) {
+          continue;
+        }
+
+        double distanceToTarget=GetSphericalDistance(graph.GetNodeCoord(next),
+                                                     targetCoord);
+
+        currentMaxDistance=std::max(currentMaxDistance,overallDistance-distanceToTarget);
+        result.SetCurrentMaxDistance(currentMaxDistance);
+
+        if (landmarkNodes) {
+          distanceToTarget=targetEstimate.GetNodeDistance(next,
+                                                          distanceToTarget);
+        }
+        else if (targetEstimate.IsActive()) {
+          distanceToTarget=targetEstimate.GetDistance(graph.GetNodeOffset(next),
+                                                      distanceToTarget);
+        }
+
+        // Estimate costs for the rest of the distance to the target
+        double estimateCost=GetEstimateCosts(state,dbId,distanceToTarget);
+        double nextOverallCost=currentCost+estimateCost;
+
+        if (nextOverallCost>costLimit) {
+          nodesIgnoredCount++;
+          continue;
+        }
+
+        if (parameter.GetProgress()) {
+          parameter.GetProgress()->Progress(currentMaxDistance,overallDistance);
+        }
+
+        graphSearch.Touch(next);
+
+        if (!nodes[next].open) {
+          openCount++;
+        }
+
+        // A cheaper label replaces the open label, its old heap entry becomes outdated
+        nodes[next].currentCost=currentCost;
+        nodes[next].overallCost=nextOverallCost;
+        nodes[next].prev=current;
+        nodes[next].object=graph.GetPathObject(path);
+        nodes[next].access=pathAccess;
+        nodes[next].open=true;
+
+        heap.push_back(GraphSearchEntry(nextOverallCost,next));
+        std::push_heap(heap.begin(),heap.end(),std::greater<GraphSearchEntry>());
+      }
+
+      //
+      // Add current node to closed set
+      //
+
+      size_t accessIndex=currentLabel.access ? 1 : 0;
+
+      if (!nodes[current].closed[accessIndex]) {
+        nodes[current].closed[accessIndex]=true;
+        nodes[current].closedPrev[accessIndex]=currentLabel.prev;
+        nodes[current].closedObject[accessIndex]=currentLabel.object;
+        closedCount++;
+      }
+
+      maxOpenList=std::max(maxOpenList,openCount);
+      maxClosedSet=std::max(maxClosedSet,closedCount);
+
+      if (!targetForwardFound) {
+        targetForwardFound=current==targetForwardNode;
+        if (targetForwardFound) {
+          targetForwardFinalNode=current;
+          targetForwardFinalCost=currentLabel.currentCost;
+        }
+      }
+
+      if (!targetBackwardFound) {
+        targetBackwardFound=current==targetBackwardNode;
+        if (targetBackwardFound) {
+          targetBackwardFinalNode=current;
+          targetBackwardFinalCost=currentLabel.currentCost;
+        }
+      }
+
+      // Drop outdated heap entries
+      while (!heap.empty() &&
+             (!nodes[heap.front().second].open ||
+              nodes[heap.front().second].overallCost!=heap.front().first)) {
+        std::pop_heap(heap.begin(),heap.end(),std::greater<GraphSearchEntry>());
+        heap.pop_back();
+      }
+    } while (!heap.empty() && !(targetForwardFound && targetBackwardFound));
+
+    // If we have keep the last node open because of access violations, add it
+    // after routing is done
+    if (!nodes[current].closed[1]) {
+      nodes[current].closed[1]=true;
+      nodes[current].closedPrev[1]=currentLabel.prev;
+      nodes[current].closedObject[1]=currentLabel.object;
+    }
+
+    uint32_t targetFinalNode=RouteGraph::INVALID_NODE;
+    double   targetFinalCost=0.0;
+
+    if (targetBackwardFinalNode!=RouteGraph::INVALID_NODE &&
+        targetForwardFinalNode!=RouteGraph::INVALID_NODE) {
+      if (targetForwardFinalCost<=targetBackwardFinalCost) {
+        targetFinalNode=targetForwardFinalNode;
+        targetFinalCost=targetForwardFinalCost;
+      }
+      else {
+        targetFinalNode=targetBackwardFinalNode;
+        targetFinalCost=targetBackwardFinalCost;
+      }
+    }
+    else if (targetBackwardFinalNode!=RouteGraph::INVALID_NODE) {
+      targetFinalNode=targetBackwardFinalNode;
+      targetFinalCost=targetBackwardFinalCost;
+    }
+    else if (targetForwardFinalNode!=RouteGraph::INVALID_NODE) {
+      targetFinalNode=targetForwardFinalNode;
+      targetFinalCost=targetForwardFinalCost;
+    }
+
+    clock.Stop();
+
+    if (debugPerformance) {
+      std::cout << "From:                ";
+      if (startBackwardRouteNode) {
+        std::cout << startBackwardRouteNode->GetCoord().GetDisplayText();
+      }
+      else {
+        std::cout << startForwardRouteNode->GetCoord().GetDisplayText();
+      }
+      std::cout << " " << start.GetObjectFileRef().GetName() << std::endl;
+
+      std::cout << "To:                  ";
+      if (targetBackwardRouteNode) {
+        std::cout << targetBackwardRouteNode->GetCoord().GetDisplayText();
+      }
+      else {
+        std::cout << targetForwardRouteNode->GetCoord().GetDisplayText();
+      }
+      std::cout << " " << target.GetObjectFileRef().GetName() << std::endl;
+
+      std::cout << "Time:                " << clock << std::endl;
+
+      std::cout << "Air-line distance:   " << std::fixed << std::setprecision(1) << overallDistance << "km" << std::endl;
+      std::cout << "Minimum cost:        " << overallCost << std::endl;
+      if (targetFinalNode!=RouteGraph::INVALID_NODE) {
+        std::cout << "Actual cost:         " << targetFinalCost << std::endl;
+      }
+      std::cout << "Cost limit:          " << costLimit << std::endl;
+      std::cout << "Route nodes loaded:  " << nodesLoadedCount << std::endl;
+      std::cout << "Route nodes ignored: " << nodesIgnoredCount << std::endl;
+      std::cout << "Max. OpenList size:  " << maxOpenList << std::endl;
+      std::cout << "Max. ClosedSet size: " << maxClosedSet << std::endl;
+    }
+
+    if (targetFinalNode==RouteGraph::INVALID_NODE) {
+      log.Warn() << "No route found!";
+
+      return result;
+    }
+
+    if (parameter.GetBreaker() &&
+      parameter.GetBreaker()->IsAborted()) {
+      return result;
+    }
+
+    std::list<VNode> routeNodes;
+
+    ResolveGraphChainToList(graph,
+                            graphSearch,
+                            dbId,
+                            targetFinalNode,
+                            routeNodes);
+
+    if (!ResolveRNodesToRouteData(state,
+                                  routeNodes,
+                                  start,
+                                  target,
+                                  result.GetRoute())) {
+      return result;
+    }
+
+    ResolveRouteDataJunctions(result.GetRoute());
+
+    return result;
+  }
+
+  /**
+   * Calculate a route
+   *
+   * @param state
+   *    State to use
+   * @param start
+   *    Start of the route
+   * @param target
+   *    Target of teh route
+   * @param progress
+   *    Optional callback for handling routing progress
+   * @param route
+   *    The route object holding the resulting route on success
+   * @return
+   *    True, if the engine was able to find a route, else false
+   */
+  template <class RoutingState>
+  RoutingResult AbstractRoutingService<RoutingState>::CalculateRoute(RoutingState& state,
+                                                                     const RoutePosition& start,
+                                                                     const RoutePosition& target,
+                                                                     const RoutingParameter& parameter)
+  {
+    SearchScratchLease scratch(*this);
+
+    return CalculateRoute(state,
+                          start,
+                          target,
+                          parameter,
+                          scratch.Get());
+  }
+
+  /**
+   * Calculate a route using the given search state. Concurrent calls
+   * must use different search states.
+   *
+   * @param state
+   *    State to use
+   * @param start
+   *    Start of the route
+   * @param target
+   *    Target of the route
+   * @param parameter
+   *    Optional callbacks for handling routing progress and break requests
+   * @param scratch
+   *    Search state to use
+   * @return
+   *    The result, holding the route on success
+   */
+  template <class RoutingState>
+  RoutingResult AbstractRoutingService<RoutingState>::CalculateRoute(RoutingState& state,
+                                                                     const RoutePosition& start,
+                                                                     const RoutePosition& target,
+                                                                     const RoutingParameter& parameter,
+                                                                     SearchScratch& scratch)
+  {
+    if (parameter.IsBidirectional()) {
+      return CalculateRouteBidirectional(state,
+                                         start,
+                                         target,
+                                         parameter,
+                                         scratch);
+    }
+
+    const RouteGraph* graph=GetRouteGraph(start.GetDatabaseId());
+
+    if (graph!=NULL &&
+        start.GetDatabaseId()==target.GetDatabaseId()) {
+      return CalculateRouteInGraph(state,
+                                   *graph,
+                                   start,
+                                   target,
+                                   parameter,
+                                   scratch);
+    }
+
+    RoutingResult            result;
+    Vehicle                  vehicle=GetVehicle(state);
+    RouteNodeRef             startForwardRouteNode;
+    RouteNodeRef             startBackwardRouteNode;
+    RNodeRef                 startForwardNode;
+    RNodeRef                 startBackwardNode;
+
+    GeoCoord                 startCoord;
+    GeoCoord                 targetCoord;
+
+    RouteNodeRef             targetForwardRouteNode;
+    RouteNodeRef             targetBackwardRouteNode;
+
+    // Only the estimate for the target is used, the start estimate stays inactive
+    LandmarkEstimate         startEstimate;
+    LandmarkEstimate         targetEstimate;
+
+    // Sorted list (smallest cost first) of ways to check
+    OpenListRef              openList=scratch.PrepareOpenList(scratch.openList,
+                                                              parameter);
+
+    // Restricted way (access=destination) is a way that may be used just
+    // in case when target is on this way. Some routing nodes may be accessed
+    // from two different ways - one without any access restriction (closedSet)
+    // and second with restriction (closedRestrictedSet)
+    ClosedSet&               closedSet=scratch.closedSet;
+    ClosedSet&               closedRestrictedSet=scratch.closedRestrictedSet;
+
+    size_t                   nodesLoadedCount=0;
+    size_t                   nodesIgnoredCount=0;
+    size_t                   maxOpenList=0;
+    size_t                   maxClosedSet=0;
+
+    SearchScratch::PrepareClosedSet(closedSet,
+                                    300000);
+    SearchScratch::PrepareClosedSet(closedRestrictedSet,
+                                    10000);
+
+    if (!GetTargetNodes(state,
+                        target,
+                        targetCoord,
+                        targetForwardRouteNode,
+                        targetBackwardRouteNode)) {
+      return result;
+    }
+
+    if (!GetStartNodes(state,
+                       start,
+                       startCoord,
+                       targetCoord,
+                       startForwardRouteNode,
+                       startBackwardRouteNode,
+                       startForwardNode,
+                       startBackwardNode)) {
+      return result;
+    }
+
+#if defined(DEBUG_ROUTING)
+    if (startForwardNode) {
+      std::cout << "StartForwardNode:   " << start.GetObjectFileRef().GetName() << " " << startForwardRouteNode->GetId() << " "
+                << startForwardNode->currentCost << " " << startForwardNode->estimateCost << " " << startForwardNode->overallCost
+                << std::endl;
+    }
+    if (startBackwardNode) {
+      std::cout << "StartBackwardNode:  " << start.GetObjectFileRef().GetName() << " " << startBackwardRouteNode->GetId() << " "
+                << startBackwardNode->currentCost << " " << startBackwardNode->estimateCost << " " << startBackwardNode->overallCost
+                << std::endl;
+    }
+    if (targetForwardRouteNode) {
+      std::cout << "TargetForwardNode:  " << target.GetObjectFileRef().GetName() << " " << targetForwardRouteNode->GetId() << std::endl;
+    }
+    if (startBackwardNode) {
+      std::cout << "TargetBackwardNode: " << target.GetObjectFileRef().GetName() << " " << targetBackwardRouteNode->GetId() << std::endl;
+    }
+#endif
+
+    if (parameter.GetBreaker() &&
+        parameter.GetBreaker()->IsAborted()) {
+      return result;
+    }
+
+    if (start.GetDatabaseId()==target.GetDatabaseId()) {
+      InitializeLandmarkEstimate(state,
+                                 target.GetDatabaseId(),
+                                 targetForwardRouteNode,
+                                 targetBackwardRouteNode,
+                                 targetEstimate);
+      ApplyLandmarkEstimate(state,
+                            targetEstimate,
+                            startForwardNode);
+      ApplyLandmarkEstimate(state,
+                            targetEstimate,
+                            startBackwardNode);
+    }
+
+    if (startForwardNode) {
+      openList->Push(startForwardNode);
+    }
+
+    if (startBackwardNode) {
+      openList->Push(startBackwardNode);
+    }
+
+
+    double currentMaxDistance=0.0;
+    double overallDistance=GetSphericalDistance(startCoord,
+                                                targetCoord);
+    double overallCost=GetEstimateCosts(state,start.GetDatabaseId(),overallDistance);
+    double costLimit=GetCostLimit(state,start.GetDatabaseId(),overallDistance);
+
+    result.SetOverallDistance(overallDistance);
+    result.SetCurrentMaxDistance(currentMaxDistance);
+
+    StopClock    clock;
+    RNodeRef     current;
+    RouteNodeRef currentRouteNode;
+    DatabaseId   dbId;
+    bool         targetForwardFound=targetForwardRouteNode ? false : true;
+    bool         targetBackwardFound=targetBackwardRouteNode ? false : true;
+    RNodeRef     targetForwardFinalNode;
+    RNodeRef     targetBackwardFinalNode;
+
+    do {
+      //
+      // Take entry from open list with lowest cost
+      //
+
+      if (parameter.GetBreaker() &&
+          parameter.GetBreaker()->IsAborted()) {
+        return result;
+      }
 
-      openMap.erase(current->nodeOffset);
-      openList.erase(openList.begin());
+      current=openList->Pop();
 
       currentRouteNode=current->node;
       dbId=current->nodeOffset.database;
@@ -971,8 +2478,7 @@ namespace osmscout {
       if (!WalkPaths(state,
                      current,
                      currentRouteNode,
-                     openList,
-                     openMap,
+                     *openList,
                      closedSet,
                      closedRestrictedSet,
                      result,
@@ -982,7 +2488,10 @@ namespace osmscout {
                      nodesIgnoredCount,
                      currentMaxDistance,
                      overallDistance,
-                     costLimit)){
+                     costLimit,
+                     targetEstimate,
+                     NULL,
+                     startEstimate)){
 
         log.Error() << "Failed to walk paths from " << dbId << " / " << currentRouteNode->GetFileOffset();
         return result;
@@ -990,14 +2499,13 @@ namespace osmscout {
 
       //
       // Add current node twins (nodes from another databases with same Id)
-      // to openList/openMap or update it
+      // to openList or update it
       //
 
       if (!WalkToOtherDatabases(state,
                                   current,
                                   currentRouteNode,
-                                  openList,
-                                  openMap,
+                                  *openList,
                                   closedSet,
                                   closedRestrictedSet)){
 
@@ -1024,11 +2532,11 @@ namespace osmscout {
 
       current->node=NULL;
 
-      maxOpenList=std::max(maxOpenList,openMap.size());
+      maxOpenList=std::max(maxOpenList,openList->GetSize());
       maxClosedSet=std::max(maxClosedSet,closedSet.size()+closedRestrictedSet.size());
 
 #if defined(DEBUG_ROUTING)
-      if (openList.empty()) {
+      if (openList->IsEmpty()) {
         std::cout << "No more alternatives, stopping" << std::endl;
       }
 
@@ -1061,7 +2569,7 @@ namespace osmscout {
         }
       }
 
-    } while (!openList.empty() && !(targetForwardFound && targetBackwardFound));
+    } while (!openList->IsEmpty() && !(targetForwardFound && targetBackwardFound));
 
     // If we have keep the last node open because of access violations, add it
     // after routing is done
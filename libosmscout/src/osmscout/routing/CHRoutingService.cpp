@@ -0,0 +1,561 @@
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2017  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/routing/CHRoutingService.h>
+
+#include <algorithm>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <queue>
+
+#include <osmscout/util/File.h>
+#include <osmscout/util/Geometry.h>
+#include <osmscout/util/Logger.h>
+#include <osmscout/util/StopClock.h>
+
+namespace osmscout {
+
+  void CHRoutingService::Search::Init(size_t nodeCount)
+  {
+    SearchNode node;
+
+    node.cost=std::numeric_limits<double>::infinity();
+    node.previous=ContractionHierarchy::INVALID_NODE;
+    node.settled=false;
+
+    nodes.assign(nodeCount,node);
+    touched.clear();
+  }
+
+  void CHRoutingService::Search::Reset()
+  {
+    for (const auto node : touched) {
+      nodes[node].cost=std::numeric_limits<double>::infinity();
+      nodes[node].previous=ContractionHierarchy::INVALID_NODE;
+      nodes[node].settled=false;
+    }
+
+    touched.clear();
+  }
+
+  void CHRoutingService::Search::Touch(uint32_t node,
+                                       double cost,
+                                       uint32_t previous)
+  {
+    if (nodes[node].cost==std::numeric_limits<double>::infinity()) {
+      touched.push_back(node);
+    }
+
+    nodes[node].cost=cost;
+    nodes[node].previous=previous;
+  }
+
+  /**
+   * Create a new instance of the routing service.
+   *
+   * @param database
+   *    A valid reference to a database instance
+   * @param parameter
+   *    An instance to the parameter object holding further paramterization
+   * @param filenamebase
+   *    Base name of the router files
+   * @param vehicle
+   *    The vehicle to load the contraction hierarchy for
+   */
+  CHRoutingService::CHRoutingService(const DatabaseRef& database,
+                                     const RouterParameter& parameter,
+                                     const std::string& filenamebase,
+                                     Vehicle vehicle)
+   : SimpleRoutingService(database,
+                          parameter,
+                          filenamebase),
+     filenamebase(filenamebase),
+     vehicle(vehicle),
+     hierarchyLoaded(false)
+  {
+    // no code
+  }
+
+  /**
+   * Opens the routing service and loads the contraction hierarchy. If there is
+   * no hierarchy for the vehicle, all routes are calculated by the
+   * SimpleRoutingService A* search.
+   *
+   * @return
+   *    false on error, else true
+   */
+  bool CHRoutingService::Open()
+  {
+    if (!SimpleRoutingService::Open()) {
+      return false;
+    }
+
+    std::string filename=AppendFileToDir(database->GetPath(),
+                                         ContractionHierarchy::GetFilename(filenamebase,
+                                                                           vehicle));
+
+    hierarchyLoaded=false;
+
+    if (!ExistsInFilesystem(filename)) {
+      log.Warn() << "No contraction hierarchy '" << filename << "', falling back to A* routing";
+      return true;
+    }
+
+    StopClock   timer;
+    FileScanner scanner;
+
+    try {
+      scanner.Open(filename,
+                   FileScanner::Sequential,
+                   true);
+
+      hierarchy.Read(scanner);
+
+      scanner.Close();
+    }
+    catch (IOException& e) {
+      log.Error() << e.GetDescription();
+      scanner.CloseFailsafe();
+      hierarchy.Clear();
+      return false;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(searchPoolMutex);
+
+      searchPool.clear();
+    }
+
+    hierarchyLoaded=true;
+
+    timer.Stop();
+
+    log.Debug() << "Opening ContractionHierarchy: " << timer.ResultString();
+
+    return true;
+  }
+
+  void CHRoutingService::Close()
+  {
+    hierarchy.Clear();
+
+    {
+      std::lock_guard<std::mutex> lock(searchPoolMutex);
+
+      searchPool.clear();
+    }
+
+    hierarchyLoaded=false;
+
+    SimpleRoutingService::Close();
+  }
+
+  /**
+   * Take an idle search state from the search pool or create a new one, if the
+   * pool is empty
+   */
+  CHRoutingService::SearchPairRef CHRoutingService::AcquireSearch()
+  {
+    {
+      std::lock_guard<std::mutex> lock(searchPoolMutex);
+
+      if (!searchPool.empty()) {
+        SearchPairRef search=std::move(searchPool.back());
+
+        searchPool.pop_back();
+
+        return search;
+      }
+    }
+
+    SearchPairRef search(new SearchPair());
+
+    search->forward.Init(hierarchy.GetNodeCount());
+    search->backward.Init(hierarchy.GetNodeCount());
+
+    return search;
+  }
+
+  /**
+   * Return the search state to the search pool for reuse by the next query
+   */
+  void CHRoutingService::ReleaseSearch(SearchPairRef&& search)
+  {
+    std::lock_guard<std::mutex> lock(searchPoolMutex);
+
+    searchPool.push_back(std::move(search));
+  }
+
+  /**
+   * Append the path of the hierarchy edge between the given nodes, with shortcuts
+   * recursively replaced by the edges they span, to the given path.
+   */
+  bool CHRoutingService::UnpackEdge(uint32_t from,
+                                    uint32_t to,
+                                    std::list<PathEntry>& path) const
+  {
+    // An edge is stored at its lower ranked node
+    const ContractionHierarchy::Edge* edge=hierarchy.FindForwardEdge(from,to);
+
+    if (edge==NULL) {
+      edge=hierarchy.FindBackwardEdge(to,from);
+    }
+
+    if (edge==NULL) {
+      log.Error() << "Cannot find hierarchy edge from " << from << " to " << to;
+      return false;
+    }
+
+    if (edge->IsShortcut()) {
+      uint32_t middle=edge->middle;
+
+      return UnpackEdge(from,middle,path) &&
+             UnpackEdge(middle,to,path);
+    }
+
+    PathEntry entry;
+
+    entry.node=to;
+    entry.object=edge->object;
+
+    path.push_back(entry);
+
+    return true;
+  }
+
+  /**
+   * Return false, if the path takes a turn forbidden by a turn restriction
+   */
+  bool CHRoutingService::CheckExcludes(const std::list<PathEntry>& path)
+  {
+    for (auto entry=path.begin(); entry!=path.end(); ++entry) {
+      auto next=entry;
+
+      ++next;
+
+      if (next==path.end()) {
+        break;
+      }
+
+      if (!hierarchy.HasExcludes(entry->node)) {
+        continue;
+      }
+
+      RouteNodeRef routeNode;
+
+      if (!GetRouteNodeByOffset(DBFileOffset(0,hierarchy.GetNodeOffset(entry->node)),
+                                routeNode)) {
+        return false;
+      }
+
+      for (const auto& exclude : routeNode->excludes) {
+        if (exclude.source==entry->object &&
+            routeNode->objects[exclude.targetIndex].object==next->object) {
+          return false;
+        }
+      }
+    }
+
+    return true;
+  }
+
+  /**
+   * Calculate a route using the contraction hierarchy
+   *
+   * @param profile
+   *    Profile to use
+   * @param start
+   *    Start of the route
+   * @param target
+   *    Target of the route
+   * @param parameter
+   *    A RoutingParamater object
+   * @return
+   *    A RoutingResult object
+   */
+  RoutingResult CHRoutingService::CalculateRoute(RoutingProfile& profile,
+                                                 const RoutePosition& start,
+                                                 const RoutePosition& target,
+                                                 const RoutingParameter& parameter)
+  {
+    if (!hierarchyLoaded ||
+        profile.GetVehicle()!=vehicle) {
+      return SimpleRoutingService::CalculateRoute(profile,start,target,parameter);
+    }
+
+    typedef std::pair<double,uint32_t> QueueEntry;
+    typedef std::priority_queue<QueueEntry,std::vector<QueueEntry>,std::greater<QueueEntry>> Queue;
+
+    RoutingResult result;
+    RouteNodeRef  startForwardRouteNode;
+    RouteNodeRef  startBackwardRouteNode;
+    RNodeRef      startForwardNode;
+    RNodeRef      startBackwardNode;
+    GeoCoord      startCoord;
+    GeoCoord      targetCoord;
+    RouteNodeRef  targetForwardRouteNode;
+    RouteNodeRef  targetBackwardRouteNode;
+    DatabaseId    dbId=start.GetDatabaseId();
+
+    if (!GetTargetNodes(profile,
+                        target,
+                        targetCoord,
+                        targetForwardRouteNode,
+                        targetBackwardRouteNode)) {
+      return result;
+    }
+
+    if (!GetStartNodes(profile,
+                       start,
+                       startCoord,
+                       targetCoord,
+                       startForwardRouteNode,
+                       startBackwardRouteNode,
+                       startForwardNode,
+                       startBackwardNode)) {
+      return result;
+    }
+
+    result.SetOverallDistance(GetSphericalDistance(startCoord,
+                                                   targetCoord));
+
+    StopClock   clock;
+    Queue       forwardQueue;
+    Queue       backwardQueue;
+    SearchLease searchLease(*this);
+    Search&     forwardSearch=searchLease.Get().forward;
+    Search&     backwardSearch=searchLease.Get().backward;
+
+    forwardSearch.Reset();
+    backwardSearch.Reset();
+
+    for (const auto& startNode : {startForwardNode,startBackwardNode}) {
+      if (!startNode) {
+        continue;
+      }
+
+      uint32_t node=hierarchy.GetNode(startNode->nodeOffset.offset);
+
+      if (node!=ContractionHierarchy::INVALID_NODE &&
+          startNode->currentCost<forwardSearch.nodes[node].cost) {
+        forwardSearch.Touch(node,
+                            startNode->currentCost,
+                            ContractionHierarchy::INVALID_NODE);
+        forwardQueue.push(QueueEntry(startNode->currentCost,node));
+      }
+    }
+
+    for (const auto& targetNode : {targetForwardRouteNode,targetBackwardRouteNode}) {
+      if (!targetNode) {
+        continue;
+      }
+
+      uint32_t node=hierarchy.GetNode(targetNode->GetFileOffset());
+
+      if (node!=ContractionHierarchy::INVALID_NODE) {
+        backwardSearch.Touch(node,
+                             0.0,
+                             ContractionHierarchy::INVALID_NODE);
+        backwardQueue.push(QueueEntry(0.0,node));
+      }
+    }
+
+    double   bestCost=std::numeric_limits<double>::infinity();
+    uint32_t meetingNode=ContractionHierarchy::INVALID_NODE;
+    size_t   nodesSettledCount=0;
+    size_t   nodesStalledCount=0;
+
+    while (!forwardQueue.empty() ||
+           !backwardQueue.empty()) {
+      if (parameter.GetBreaker() &&
+          parameter.GetBreaker()->IsAborted()) {
+        return result;
+      }
+
+      double forwardMin=forwardQueue.empty() ? std::numeric_limits<double>::infinity() : forwardQueue.top().first;
+      double backwardMin=backwardQueue.empty() ? std::numeric_limits<double>::infinity() : backwardQueue.top().first;
+
+      // Neither direction can improve the best path found so far
+      if (std::min(forwardMin,backwardMin)>=bestCost) {
+        break;
+      }
+
+      bool    forward=forwardMin<=backwardMin;
+      Queue&  queue=forward ? forwardQueue : backwardQueue;
+      Search& search=forward ? forwardSearch : backwardSearch;
+      Search& otherSearch=forward ? backwardSearch : forwardSearch;
+
+      QueueEntry entry=queue.top();
+      uint32_t   node=entry.second;
+
+      queue.pop();
+
+      SearchNode& current=search.nodes[node];
+
+      if (current.settled ||
+          entry.first>current.cost) {
+        continue;
+      }
+
+      current.settled=true;
+      nodesSettledCount++;
+
+      if (otherSearch.nodes[node].cost<std::numeric_limits<double>::infinity() &&
+          current.cost+otherSearch.nodes[node].cost<bestCost) {
+        bestCost=current.cost+otherSearch.nodes[node].cost;
+        meetingNode=node;
+      }
+
+      // Stall on demand: the node can be reached cheaper via a higher ranked node,
+      // so it cannot be part of the shortest path in this direction
+      const ContractionHierarchy::Edge* edge=forward ? hierarchy.BackwardEdgesBegin(node) : hierarchy.ForwardEdgesBegin(node);
+      const ContractionHierarchy::Edge* edgeEnd=forward ? hierarchy.BackwardEdgesEnd(node) : hierarchy.ForwardEdgesEnd(node);
+      bool                              stalled=false;
+
+      for (; edge!=edgeEnd; ++edge) {
+        if (search.nodes[edge->target].cost+edge->cost<current.cost) {
+          stalled=true;
+          break;
+        }
+      }
+
+      if (stalled) {
+        nodesStalledCount++;
+        continue;
+      }
+
+      edge=forward ? hierarchy.ForwardEdgesBegin(node) : hierarchy.BackwardEdgesBegin(node);
+      edgeEnd=forward ? hierarchy.ForwardEdgesEnd(node) : hierarchy.BackwardEdgesEnd(node);
+
+      for (; edge!=edgeEnd; ++edge) {
+        double cost=current.cost+edge->cost;
+
+        if (cost<search.nodes[edge->target].cost) {
+          search.Touch(edge->target,
+                       cost,
+                       node);
+          queue.push(QueueEntry(cost,edge->target));
+        }
+      }
+    }
+
+    if (meetingNode==ContractionHierarchy::INVALID_NODE) {
+      log.Debug() << "No route found in contraction hierarchy, falling back to A* routing";
+      return SimpleRoutingService::CalculateRoute(profile,start,target,parameter);
+    }
+
+    //
+    // Collect the hierarchy nodes from the start via the meeting node to the target
+    //
+
+    std::vector<uint32_t> hierarchyNodes;
+
+    for (uint32_t node=meetingNode;
+         node!=ContractionHierarchy::INVALID_NODE;
+         node=forwardSearch.nodes[node].previous) {
+      hierarchyNodes.push_back(node);
+    }
+
+    std::reverse(hierarchyNodes.begin(),
+                 hierarchyNodes.end());
+
+    for (uint32_t node=backwardSearch.nodes[meetingNode].previous;
+         node!=ContractionHierarchy::INVALID_NODE;
+         node=backwardSearch.nodes[node].previous) {
+      hierarchyNodes.push_back(node);
+    }
+
+    //
+    // Unpack shortcuts
+    //
+
+    std::list<PathEntry> path;
+    PathEntry            startEntry;
+
+    startEntry.node=hierarchyNodes.front();
+
+    if (startForwardNode &&
+        startForwardNode->nodeOffset.offset==hierarchy.GetNodeOffset(startEntry.node)) {
+      startEntry.object=startForwardNode->object;
+    }
+    else {
+      startEntry.object=startBackwardNode->object;
+    }
+
+    path.push_back(startEntry);
+
+    for (size_t i=1; i<hierarchyNodes.size(); i++) {
+      if (!UnpackEdge(hierarchyNodes[i-1],
+                      hierarchyNodes[i],
+                      path)) {
+        return result;
+      }
+    }
+
+    clock.Stop();
+
+    if (debugPerformance) {
+      std::cout << "CH time:             " << clock << std::endl;
+      std::cout << "Air-line distance:   " << std::fixed << std::setprecision(1) << result.GetOverallDistance() << "km" << std::endl;
+      std::cout << "Actual cost:         " << bestCost << std::endl;
+      std::cout << "Nodes settled:       " << nodesSettledCount << std::endl;
+      std::cout << "Nodes stalled:       " << nodesStalledCount << std::endl;
+      std::cout << "Route nodes:         " << path.size() << std::endl;
+    }
+
+    if (!CheckExcludes(path)) {
+      log.Debug() << "Route in contraction hierarchy violates turn restriction, falling back to A* routing";
+      return SimpleRoutingService::CalculateRoute(profile,start,target,parameter);
+    }
+
+    if (parameter.GetBreaker() &&
+        parameter.GetBreaker()->IsAborted()) {
+      return result;
+    }
+
+    std::list<VNode> nodes;
+    DBFileOffset     previous;
+
+    for (const auto& entry : path) {
+      DBFileOffset current(dbId,hierarchy.GetNodeOffset(entry.node));
+
+      nodes.push_back(VNode(current,
+                            entry.object,
+                            previous));
+
+      previous=current;
+    }
+
+    result.SetCurrentMaxDistance(result.GetOverallDistance());
+
+    if (!ResolveRNodesToRouteData(profile,
+                                  nodes,
+                                  start,
+                                  target,
+                                  result.GetRoute())) {
+      return result;
+    }
+
+    ResolveRouteDataJunctions(result.GetRoute());
+
+    return result;
+  }
+}
@@ -0,0 +1,272 @@
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2017  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/routing/ContractionHierarchy.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace osmscout {
+
+  const uint32_t ContractionHierarchy::INVALID_NODE=std::numeric_limits<uint32_t>::max();
+
+  /**
+   * Costs are stored as fixed point numbers with this resolution
+   */
+  static const double COST_FACTOR=10000000.0;
+
+  ContractionHierarchy::ContractionHierarchy()
+  {
+    Clear();
+  }
+
+  /**
+   * Returns the filename of the contraction hierarchy for the given router and vehicle
+   */
+  std::string ContractionHierarchy::GetFilename(const std::string& filenamebase,
+                                                Vehicle vehicle)
+  {
+    switch (vehicle) {
+    case vehicleFoot:
+      return filenamebase+"_foot.ch";
+    case vehicleBicycle:
+      return filenamebase+"_bicycle.ch";
+    case vehicleCar:
+      return filenamebase+"_car.ch";
+    }
+
+    return filenamebase+".ch";
+  }
+
+  void ContractionHierarchy::Clear()
+  {
+    nodeOffsets.clear();
+    nodeFlags.clear();
+    forwardEdgeStart.assign(1,0);
+    forwardEdges.clear();
+    backwardEdgeStart.assign(1,0);
+    backwardEdges.clear();
+  }
+
+  /**
+   * Start a new node. Nodes must be added in ascending file offset order, the
+   * edges of the node are added afterwards, followed by a call to FinishNode().
+   */
+  void ContractionHierarchy::AddNode(FileOffset nodeOffset,
+                                     uint8_t flags)
+  {
+    nodeOffsets.push_back(nodeOffset);
+    nodeFlags.push_back(flags);
+  }
+
+  void ContractionHierarchy::AddForwardEdge(const Edge& edge)
+  {
+    forwardEdges.push_back(edge);
+  }
+
+  void ContractionHierarchy::AddBackwardEdge(const Edge& edge)
+  {
+    backwardEdges.push_back(edge);
+  }
+
+  void ContractionHierarchy::FinishNode()
+  {
+    forwardEdgeStart.push_back((uint32_t)forwardEdges.size());
+    backwardEdgeStart.push_back((uint32_t)backwardEdges.size());
+  }
+
+  /**
+   * Return the index of the node with the given route node file offset or
+   * INVALID_NODE, if the route node is not part of the hierarchy.
+   */
+  uint32_t ContractionHierarchy::GetNode(FileOffset nodeOffset) const
+  {
+    auto entry=std::lower_bound(nodeOffsets.begin(),
+                                nodeOffsets.end(),
+                                nodeOffset);
+
+    if (entry==nodeOffsets.end() ||
+        *entry!=nodeOffset) {
+      return INVALID_NODE;
+    }
+
+    return (uint32_t)(entry-nodeOffsets.begin());
+  }
+
+  /**
+   * Return the cheapest forward edge from the given node to the given target,
+   * or NULL if there is none.
+   */
+  const ContractionHierarchy::Edge* ContractionHierarchy::FindForwardEdge(uint32_t node,
+                                                                          uint32_t target) const
+  {
+    const Edge* result=NULL;
+
+    for (const Edge* edge=ForwardEdgesBegin(node); edge!=ForwardEdgesEnd(node); ++edge) {
+      if (edge->target==target &&
+          (result==NULL || edge->cost<result->cost)) {
+        result=edge;
+      }
+    }
+
+    return result;
+  }
+
+  /**
+   * Return the cheapest backward edge of the given node coming from the given target,
+   * or NULL if there is none.
+   */
+  const ContractionHierarchy::Edge* ContractionHierarchy::FindBackwardEdge(uint32_t node,
+                                                                           uint32_t target) const
+  {
+    const Edge* result=NULL;
+
+    for (const Edge* edge=BackwardEdgesBegin(node); edge!=BackwardEdgesEnd(node); ++edge) {
+      if (edge->target==target &&
+          (result==NULL || edge->cost<result->cost)) {
+        result=edge;
+      }
+    }
+
+    return result;
+  }
+
+  static void ReadEdges(FileScanner& scanner,
+                        std::vector<uint32_t>& edgeStart,
+                        std::vector<ContractionHierarchy::Edge>& edges,
+                        uint32_t nodeCount)
+  {
+    edgeStart.resize(nodeCount+1);
+    edgeStart[0]=0;
+
+    for (uint32_t n=0; n<nodeCount; n++) {
+      uint32_t edgeCount;
+
+      scanner.ReadNumber(edgeCount);
+
+      for (uint32_t e=0; e<edgeCount; e++) {
+        ContractionHierarchy::Edge edge;
+        uint32_t                   middle;
+        uint64_t                   cost;
+
+        scanner.ReadNumber(edge.target);
+        scanner.ReadNumber(middle);
+        scanner.ReadNumber(cost);
+
+        edge.cost=cost/COST_FACTOR;
+
+        if (middle==0) {
+          edge.middle=ContractionHierarchy::INVALID_NODE;
+          scanner.Read(edge.object);
+        }
+        else {
+          edge.middle=middle-1;
+        }
+
+        edges.push_back(edge);
+      }
+
+      edgeStart[n+1]=(uint32_t)edges.size();
+    }
+  }
+
+  static void WriteEdges(FileWriter& writer,
+                         const std::vector<uint32_t>& edgeStart,
+                         const std::vector<ContractionHierarchy::Edge>& edges)
+  {
+    for (size_t n=0; n+1<edgeStart.size(); n++) {
+      writer.WriteNumber(edgeStart[n+1]-edgeStart[n]);
+
+      for (uint32_t e=edgeStart[n]; e<edgeStart[n+1]; e++) {
+        const ContractionHierarchy::Edge& edge=edges[e];
+
+        writer.WriteNumber(edge.target);
+        writer.WriteNumber(edge.IsShortcut() ? edge.middle+1 : (uint32_t)0);
+        writer.WriteNumber((uint64_t)floor(edge.cost*COST_FACTOR+0.5));
+
+        if (!edge.IsShortcut()) {
+          writer.Write(edge.object);
+        }
+      }
+    }
+  }
+
+  /**
+   * Read the hierarchy from the given FileScanner
+   *
+   * @throws IOException
+   */
+  void ContractionHierarchy::Read(FileScanner& scanner)
+  {
+    uint32_t   nodeCount;
+    FileOffset previousOffset=0;
+
+    Clear();
+
+    scanner.Read(nodeCount);
+
+    nodeOffsets.resize(nodeCount);
+    nodeFlags.resize(nodeCount);
+
+    for (uint32_t n=0; n<nodeCount; n++) {
+      FileOffset offsetDelta;
+
+      scanner.ReadNumber(offsetDelta);
+      scanner.Read(nodeFlags[n]);
+
+      nodeOffsets[n]=previousOffset+offsetDelta;
+      previousOffset=nodeOffsets[n];
+    }
+
+    ReadEdges(scanner,
+              forwardEdgeStart,
+              forwardEdges,
+              nodeCount);
+    ReadEdges(scanner,
+              backwardEdgeStart,
+              backwardEdges,
+              nodeCount);
+  }
+
+  /**
+   * Write the hierarchy to the given FileWriter
+   *
+   * @throws IOException
+   */
+  void ContractionHierarchy::Write(FileWriter& writer) const
+  {
+    FileOffset previousOffset=0;
+
+    writer.Write((uint32_t)nodeOffsets.size());
+
+    for (size_t n=0; n<nodeOffsets.size(); n++) {
+      writer.WriteNumber(nodeOffsets[n]-previousOffset);
+      writer.Write(nodeFlags[n]);
+
+      previousOffset=nodeOffsets[n];
+    }
+
+    WriteEdges(writer,
+               forwardEdgeStart,
+               forwardEdges);
+    WriteEdges(writer,
+               backwardEdgeStart,
+               backwardEdges);
+  }
+}
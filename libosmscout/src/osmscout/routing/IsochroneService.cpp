@@ -0,0 +1,572 @@
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2017  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/routing/IsochroneService.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <unordered_map>
+
+#include <osmscout/system/Math.h>
+
+#include <osmscout/util/Geometry.h>
+#include <osmscout/util/Logger.h>
+#include <osmscout/util/StopClock.h>
+
+namespace osmscout {
+
+  /**
+   * Maximum number of grid cells used for calculating the outline, the cell size
+   * is increased if required
+   */
+  static const size_t MAX_POLYGON_CELLS=16*1024*1024;
+
+  const size_t IsochroneParameter::DEFAULT_MAX_NODES=1000000;
+
+  IsochroneParameter::IsochroneParameter()
+  : maxNodes(DEFAULT_MAX_NODES),
+    polygon(false),
+    polygonCellSize(0.1)
+  {
+    // no code
+  }
+
+  void IsochroneParameter::SetBreaker(const BreakerRef& breaker)
+  {
+    this->breaker=breaker;
+  }
+
+  void IsochroneParameter::SetMaxNodes(size_t maxNodes)
+  {
+    this->maxNodes=maxNodes;
+  }
+
+  void IsochroneParameter::SetPolygon(bool polygon)
+  {
+    this->polygon=polygon;
+  }
+
+  void IsochroneParameter::SetPolygonCellSize(double cellSize)
+  {
+    this->polygonCellSize=cellSize;
+  }
+
+  IsochroneResult::IsochroneResult()
+  : complete(true)
+  {
+    // no code
+  }
+
+  IsochroneService::IsochroneService(const DatabaseRef& database,
+                                     const RouterParameter& parameter,
+                                     const std::string& filenamebase)
+  : SimpleRoutingService(database,
+                         parameter,
+                         filenamebase)
+  {
+    // no code
+  }
+
+  /**
+   * Calculate the outline of the area covered by the given segments of the
+   * search tree.
+   *
+   * The segments are rasterized into a grid of cells of the given size. Cells
+   * only touching at a corner are connected and holes are filled, so that the
+   * covered cells form one simple region. Its boundary is traced along the
+   * cell borders.
+   */
+  void IsochroneService::CalculatePolygon(const std::vector<Segment>& segments,
+                                          double cellSize,
+                                          std::vector<GeoCoord>& polygon) const
+  {
+    polygon.clear();
+
+    if (segments.empty()) {
+      return;
+    }
+
+    double minLat=std::numeric_limits<double>::max();
+    double maxLat=-std::numeric_limits<double>::max();
+    double minLon=std::numeric_limits<double>::max();
+    double maxLon=-std::numeric_limits<double>::max();
+
+    for (const auto& segment : segments) {
+      for (const GeoCoord& coord : {segment.first,segment.second}) {
+        minLat=std::min(minLat,coord.GetLat());
+        maxLat=std::max(maxLat,coord.GetLat());
+        minLon=std::min(minLon,coord.GetLon());
+        maxLon=std::max(maxLon,coord.GetLon());
+      }
+    }
+
+    // One degree of latitude is about 111.2 km
+    double latStep=cellSize/111.2;
+    double lonStep=latStep/std::max(cos((minLat+maxLat)/2*M_PI/180),0.01);
+    size_t width;
+    size_t height;
+
+    while (true) {
+      // One empty cell of margin at each side
+      width=(size_t)((maxLon-minLon)/lonStep)+3;
+      height=(size_t)((maxLat-minLat)/latStep)+3;
+
+      if (width*height<=MAX_POLYGON_CELLS) {
+        break;
+      }
+
+      latStep*=2;
+      lonStep*=2;
+    }
+
+    std::vector<bool> cells(width*height,false);
+
+    for (const auto& segment : segments) {
+      double latDelta=segment.second.GetLat()-segment.first.GetLat();
+      double lonDelta=segment.second.GetLon()-segment.first.GetLon();
+      size_t steps=(size_t)ceil(2*std::max(std::abs(latDelta)/latStep,
+                                           std::abs(lonDelta)/lonStep));
+
+      // Step at most half a cell, so that consecutive points are in neighbouring cells
+      for (size_t step=0; step<=steps; step++) {
+        double fraction=steps>0 ? step/(double)steps : 0.0;
+        size_t x=(size_t)((segment.first.GetLon()+fraction*lonDelta-minLon)/lonStep)+1;
+        size_t y=(size_t)((segment.first.GetLat()+fraction*latDelta-minLat)/latStep)+1;
+
+        cells[y*width+x]=true;
+      }
+    }
+
+    bool changed=true;
+
+    while (changed) {
+      changed=false;
+
+      // Connect cells only touching at a corner
+      for (size_t y=0; y+1<height; y++) {
+        for (size_t x=0; x+1<width; x++) {
+          bool lowerLeft=cells[y*width+x];
+          bool lowerRight=cells[y*width+x+1];
+          bool upperLeft=cells[(y+1)*width+x];
+          bool upperRight=cells[(y+1)*width+x+1];
+
+          if (lowerLeft && upperRight && !lowerRight && !upperLeft) {
+            cells[y*width+x+1]=true;
+            changed=true;
+          }
+          else if (lowerRight && upperLeft && !lowerLeft && !upperRight) {
+            cells[y*width+x]=true;
+            changed=true;
+          }
+        }
+      }
+
+      // Fill all cells not reachable from the border
+      std::vector<bool>   outside(width*height,false);
+      std::vector<size_t> stack;
+
+      for (size_t x=0; x<width; x++) {
+        stack.push_back(x);
+        stack.push_back((height-1)*width+x);
+      }
+
+      for (size_t y=0; y<height; y++) {
+        stack.push_back(y*width);
+        stack.push_back(y*width+width-1);
+      }
+
+      while (!stack.empty()) {
+        size_t cell=stack.back();
+
+        stack.pop_back();
+
+        if (cells[cell] ||
+            outside[cell]) {
+          continue;
+        }
+
+        outside[cell]=true;
+
+        size_t x=cell%width;
+        size_t y=cell/width;
+
+        if (x>0) {
+          stack.push_back(cell-1);
+        }
+
+        if (x+1<width) {
+          stack.push_back(cell+1);
+        }
+
+        if (y>0) {
+          stack.push_back(cell-width);
+        }
+
+        if (y+1<height) {
+          stack.push_back(cell+width);
+        }
+      }
+
+      for (size_t cell=0; cell<cells.size(); cell++) {
+        if (!cells[cell] &&
+            !outside[cell]) {
+          cells[cell]=true;
+          changed=true;
+        }
+      }
+    }
+
+    // Boundary edges between covered and uncovered cells, directed so that the
+    // covered cell is on the left. Corners are numbered row by row.
+    std::unordered_map<size_t,size_t> nextCorner;
+    size_t                            cornerWidth=width+1;
+    size_t                            startCorner=std::numeric_limits<size_t>::max();
+
+    for (size_t y=1; y+1<height; y++) {
+      for (size_t x=1; x+1<width; x++) {
+        if (!cells[y*width+x]) {
+          continue;
+        }
+
+        size_t lowerLeft=y*cornerWidth+x;
+        size_t lowerRight=lowerLeft+1;
+        size_t upperLeft=lowerLeft+cornerWidth;
+        size_t upperRight=upperLeft+1;
+
+        if (!cells[(y-1)*width+x]) {
+          nextCorner[lowerLeft]=lowerRight;
+          startCorner=std::min(startCorner,lowerLeft);
+        }
+
+        if (!cells[y*width+x+1]) {
+          nextCorner[lowerRight]=upperRight;
+        }
+
+        if (!cells[(y+1)*width+x]) {
+          nextCorner[upperRight]=upperLeft;
+        }
+
+        if (!cells[y*width+x-1]) {
+          nextCorner[upperLeft]=lowerLeft;
+        }
+      }
+    }
+
+    if (nextCorner.empty()) {
+      return;
+    }
+
+    std::vector<size_t> corners;
+    size_t              corner=startCorner;
+
+    do {
+      corners.push_back(corner);
+
+      auto next=nextCorner.find(corner);
+
+      if (next==nextCorner.end() ||
+          corners.size()>nextCorner.size()) {
+        log.Error() << "Cannot trace outline of isochrone";
+        return;
+      }
+
+      corner=next->second;
+    } while (corner!=startCorner);
+
+    // Only keep corners where the direction of the outline changes
+    for (size_t i=0; i<corners.size(); i++) {
+      size_t prev=corners[(i+corners.size()-1)%corners.size()];
+      size_t current=corners[i];
+      size_t next=corners[(i+1)%corners.size()];
+
+      if (current-prev==next-current) {
+        continue;
+      }
+
+      polygon.push_back(GeoCoord(minLat+((double)(current/cornerWidth)-1)*latStep,
+                                 minLon+((double)(current%cornerWidth)-1)*lonStep));
+    }
+  }
+
+  /**
+   * Calculate all route nodes reachable from the given start position with costs
+   * not exceeding maxCost.
+   *
+   * The costs are in the units of the routing profile, for a FastestPathRoutingProfile
+   * they are in hours.
+   *
+   * @param profile
+   *    Profile to use
+   * @param start
+   *    Start position
+   * @param maxCost
+   *    Maximum costs of the routes to the reached route nodes
+   * @param parameter
+   *    Optional breaker, node limit and polygon calculation
+   * @return
+   *    The reached route nodes, empty on error or if aborted
+   */
+  IsochroneResult IsochroneService::CalculateIsochrone(const RoutingProfile& profile,
+                                                       const RoutePosition& start,
+                                                       double maxCost,
+                                                       const IsochroneParameter& parameter)
+  {
+    typedef std::pair<double,FileOffset> QueueEntry;
+
+    IsochroneResult                                result;
+    Vehicle                                        vehicle=profile.GetVehicle();
+    DatabaseId                                     dbId=start.GetDatabaseId();
+    const std::vector<ObjectVariantData>&          objectVariants=objectVariantDataFile.GetData();
+    GeoCoord                                       startCoord;
+    RouteNodeRef                                   forwardRouteNode;
+    RouteNodeRef                                   backwardRouteNode;
+    RNodeRef                                       forwardRNode;
+    RNodeRef                                       backwardRNode;
+    WayRef                                         way;
+
+    // There is no target, the cost estimate of the returned RNodes is not used
+    if (!GetStartNodes(profile,
+                       start,
+                       startCoord,
+                       startCoord,
+                       forwardRouteNode,
+                       backwardRouteNode,
+                       forwardRNode,
+                       backwardRNode)) {
+      return result;
+    }
+
+    if (!GetWayByOffset(DBFileOffset(dbId,
+                                     start.GetObjectFileRef().GetFileOffset()),
+                        way)) {
+      log.Error() << "Cannot get start way!";
+      return result;
+    }
+
+    StopClock                                      clock;
+    std::unordered_map<FileOffset,Label>           open;
+    std::unordered_map<FileOffset,ClosedNode>      closed;
+    std::priority_queue<QueueEntry,
+                        std::vector<QueueEntry>,
+                        std::greater<QueueEntry>>  queue;    //!< May contain outdated entries
+    std::vector<IsochroneNode>&                    nodes=result.GetNodes();
+    std::vector<Segment>                           segments;
+
+    for (const RNodeRef& startNode : {forwardRNode,backwardRNode}) {
+      if (!startNode ||
+          startNode->currentCost>maxCost) {
+        continue;
+      }
+
+      auto entry=open.find(startNode->nodeOffset.offset);
+
+      if (entry!=open.end() &&
+          entry->second.cost<=startNode->currentCost) {
+        continue;
+      }
+
+      Label label;
+
+      label.cost=startNode->currentCost;
+      label.distance=GetSphericalDistance(startCoord,
+                                          startNode->node->GetCoord());
+      label.duration=profile.GetTime(*way,label.distance);
+      label.prev=0;
+      label.object=start.GetObjectFileRef();
+      label.access=true;
+      label.parent=std::numeric_limits<size_t>::max();
+
+      open[startNode->nodeOffset.offset]=label;
+      queue.push(QueueEntry(label.cost,startNode->nodeOffset.offset));
+
+      if (parameter.IsPolygon()) {
+        segments.push_back(Segment(startCoord,startNode->node->GetCoord()));
+      }
+    }
+
+    while (!queue.empty()) {
+      if (parameter.GetBreaker() &&
+          parameter.GetBreaker()->IsAborted()) {
+        return IsochroneResult();
+      }
+
+      QueueEntry entry=queue.top();
+
+      queue.pop();
+
+      auto openEntry=open.find(entry.second);
+
+      if (openEntry==open.end() ||
+          openEntry->second.cost!=entry.first) {
+        // Outdated queue entry
+        continue;
+      }
+
+      FileOffset   currentOffset=entry.second;
+      Label        current=openEntry->second;
+      RouteNodeRef currentRouteNode;
+
+      open.erase(openEntry);
+
+      if (!GetRouteNodeByOffset(DBFileOffset(dbId,currentOffset),
+                                currentRouteNode)) {
+        log.Error() << "Cannot load route node with offset " << currentOffset;
+        return IsochroneResult();
+      }
+
+      auto    closedEntry=closed.find(currentOffset);
+      uint8_t accessBit=current.access ? 2 : 1;
+      size_t  currentIndex;
+
+      if (closedEntry==closed.end()) {
+        // Only the first label closed at a route node is the cheapest one
+        currentIndex=nodes.size();
+
+        nodes.push_back(IsochroneNode{currentRouteNode->GetId(),
+                                      currentRouteNode->GetCoord(),
+                                      current.cost,
+                                      current.distance,
+                                      current.duration});
+
+        closed[currentOffset]=ClosedNode{currentIndex,accessBit};
+
+        if (parameter.IsPolygon() &&
+            current.parent!=std::numeric_limits<size_t>::max()) {
+          segments.push_back(Segment(nodes[current.parent].coord,
+                                     currentRouteNode->GetCoord()));
+        }
+      }
+      else if ((closedEntry->second.state & accessBit)!=0) {
+        continue;
+      }
+      else {
+        currentIndex=closedEntry->second.index;
+        closedEntry->second.state|=accessBit;
+      }
+
+      if (parameter.GetMaxNodes()>0 &&
+          nodes.size()>=parameter.GetMaxNodes()) {
+        result.SetComplete(false);
+        break;
+      }
+
+      for (size_t i=0; i<currentRouteNode->paths.size(); i++) {
+        const RouteNode::Path& path=currentRouteNode->paths[i];
+
+        if (path.offset==current.prev) {
+          continue;
+        }
+
+        if (!current.access &&
+            !path.IsRestricted(vehicle)) {
+          continue;
+        }
+
+        if (!CanUse(profile,
+                    dbId,
+                    *currentRouteNode,
+                    i)) {
+          continue;
+        }
+
+        auto nextClosed=closed.find(path.offset);
+
+        if (nextClosed!=closed.end() &&
+            (nextClosed->second.state & accessBit)!=0) {
+          continue;
+        }
+
+        bool excluded=false;
+
+        for (const auto& exclude : currentRouteNode->excludes) {
+          if (exclude.source==current.object &&
+              currentRouteNode->objects[exclude.targetIndex].object==currentRouteNode->objects[path.objectIndex].object) {
+            excluded=true;
+            break;
+          }
+        }
+
+        if (excluded) {
+          continue;
+        }
+
+        double pathCost=GetCosts(profile,dbId,*currentRouteNode,i);
+        double cost=current.cost+pathCost;
+
+        if (cost>maxCost) {
+          // Add the part of the path within the budget to the outline
+          RouteNodeRef nextRouteNode;
+
+          if (parameter.IsPolygon() &&
+              pathCost>0.0 &&
+              GetRouteNodeByOffset(DBFileOffset(dbId,path.offset),
+                                   nextRouteNode)) {
+            double   fraction=(maxCost-current.cost)/pathCost;
+            GeoCoord from=currentRouteNode->GetCoord();
+            GeoCoord to=nextRouteNode->GetCoord();
+
+            segments.push_back(Segment(from,
+                                       GeoCoord(from.GetLat()+fraction*(to.GetLat()-from.GetLat()),
+                                                from.GetLon()+fraction*(to.GetLon()-from.GetLon()))));
+          }
+
+          continue;
+        }
+
+        auto nextEntry=open.find(path.offset);
+
+        // Check, if we already have a cheaper path to the new node
+        if (nextEntry!=open.end() &&
+            nextEntry->second.cost<=cost) {
+          continue;
+        }
+
+        Label& next=open[path.offset];
+
+        next.cost=cost;
+        next.distance=current.distance+path.distance;
+        next.duration=current.duration+profile.GetTime(objectVariants[currentRouteNode->objects[path.objectIndex].objectVariantIndex],
+                                                       path.distance);
+        next.prev=currentOffset;
+        next.object=currentRouteNode->objects[path.objectIndex].object;
+        next.access=!path.IsRestricted(vehicle);
+        next.parent=currentIndex;
+
+        queue.push(QueueEntry(cost,path.offset));
+      }
+    }
+
+    if (parameter.IsPolygon()) {
+      CalculatePolygon(segments,
+                       parameter.GetPolygonCellSize(),
+                       result.GetPolygon());
+    }
+
+    clock.Stop();
+
+    if (debugPerformance) {
+      log.Info() << "Isochrone: " << clock.ResultString() << ", " << nodes.size() << " route nodes reached, " << closed.size() << " closed";
+    }
+
+    return result;
+  }
+}
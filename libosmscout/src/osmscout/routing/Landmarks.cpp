@@ -0,0 +1,245 @@
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2017  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/routing/Landmarks.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace osmscout {
+
+  const uint32_t Landmarks::INVALID_NODE=std::numeric_limits<uint32_t>::max();
+  const uint32_t Landmarks::UNREACHABLE=std::numeric_limits<uint32_t>::max();
+
+  Landmarks::Landmarks()
+  {
+    // no code
+  }
+
+  /**
+   * Returns the filename of the landmarks for the given router and vehicle
+   */
+  std::string Landmarks::GetFilename(const std::string& filenamebase,
+                                     Vehicle vehicle)
+  {
+    switch (vehicle) {
+    case vehicleFoot:
+      return filenamebase+"_foot.landmarks";
+    case vehicleBicycle:
+      return filenamebase+"_bicycle.landmarks";
+    case vehicleCar:
+      return filenamebase+"_car.landmarks";
+    }
+
+    return filenamebase+".landmarks";
+  }
+
+  void Landmarks::Clear()
+  {
+    nodeOffsets.clear();
+    landmarkOffsets.clear();
+    distances.clear();
+  }
+
+  /**
+   * Prepare for the given route nodes (in ascending file offset order) and number of
+   * landmarks. All distances are UNREACHABLE until set by SetLandmark().
+   */
+  void Landmarks::Initialize(const std::vector<FileOffset>& nodeOffsets,
+                             size_t landmarkCount)
+  {
+    this->nodeOffsets=nodeOffsets;
+    landmarkOffsets.assign(landmarkCount,0);
+    distances.assign(nodeOffsets.size()*landmarkCount,UNREACHABLE);
+  }
+
+  /**
+   * Set the given node as landmark with the given distances (in km) of all
+   * nodes to it. Nodes not connected to the landmark have an infinite distance.
+   */
+  void Landmarks::SetLandmark(size_t landmark,
+                              uint32_t node,
+                              const std::vector<double>& nodeDistances)
+  {
+    const size_t landmarkCount=landmarkOffsets.size();
+
+    landmarkOffsets[landmark]=nodeOffsets[node];
+
+    for (size_t n=0; n<nodeDistances.size(); n++) {
+      double distance=floor(nodeDistances[n]*100000.0);
+
+      if (std::isinf(nodeDistances[n]) ||
+          distance>=UNREACHABLE) {
+        distances[n*landmarkCount+landmark]=UNREACHABLE;
+      }
+      else {
+        distances[n*landmarkCount+landmark]=(uint32_t)distance;
+      }
+    }
+  }
+
+  /**
+   * Return the index of the node with the given route node file offset or
+   * INVALID_NODE, if the route node is unknown.
+   */
+  uint32_t Landmarks::GetNode(FileOffset nodeOffset) const
+  {
+    auto entry=std::lower_bound(nodeOffsets.begin(),
+                                nodeOffsets.end(),
+                                nodeOffset);
+
+    if (entry==nodeOffsets.end() ||
+        *entry!=nodeOffset) {
+      return INVALID_NODE;
+    }
+
+    return (uint32_t)(entry-nodeOffsets.begin());
+  }
+
+  /**
+   * Read the landmarks from the given FileScanner
+   *
+   * @throws IOException
+   */
+  void Landmarks::Read(FileScanner& scanner)
+  {
+    uint32_t   nodeCount;
+    uint32_t   landmarkCount;
+    FileOffset previousOffset=0;
+
+    Clear();
+
+    scanner.Read(nodeCount);
+    scanner.Read(landmarkCount);
+
+    nodeOffsets.resize(nodeCount);
+
+    for (uint32_t n=0; n<nodeCount; n++) {
+      FileOffset offsetDelta;
+
+      scanner.ReadNumber(offsetDelta);
+
+      nodeOffsets[n]=previousOffset+offsetDelta;
+      previousOffset=nodeOffsets[n];
+    }
+
+    landmarkOffsets.resize(landmarkCount);
+
+    for (uint32_t l=0; l<landmarkCount; l++) {
+      scanner.ReadFileOffset(landmarkOffsets[l]);
+    }
+
+    distances.resize((size_t)nodeCount*landmarkCount);
+
+    // Distances are stored incremented by one, so that UNREACHABLE becomes 0
+    for (auto& distance : distances) {
+      uint32_t value;
+
+      scanner.ReadNumber(value);
+
+      distance=value-1;
+    }
+  }
+
+  /**
+   * Write the landmarks to the given FileWriter
+   *
+   * @throws IOException
+   */
+  void Landmarks::Write(FileWriter& writer) const
+  {
+    FileOffset previousOffset=0;
+
+    writer.Write((uint32_t)nodeOffsets.size());
+    writer.Write((uint32_t)landmarkOffsets.size());
+
+    for (const auto offset : nodeOffsets) {
+      writer.WriteNumber(offset-previousOffset);
+
+      previousOffset=offset;
+    }
+
+    for (const auto offset : landmarkOffsets) {
+      writer.WriteFileOffset(offset);
+    }
+
+    for (const auto distance : distances) {
+      writer.WriteNumber((uint32_t)(distance+1));
+    }
+  }
+
+  LandmarkEstimate::LandmarkEstimate()
+  : landmarks(NULL),
+    endCount(0)
+  {
+    // no code
+  }
+
+  /**
+   * Use the given landmarks, which may be NULL, and forget all ends
+   */
+  void LandmarkEstimate::Initialize(const Landmarks* landmarks)
+  {
+    this->landmarks=landmarks;
+    endCount=0;
+  }
+
+  /**
+   * Add a route node next to the end of the route. If the route node is not
+   * part of the landmarks, the estimate is disabled.
+   */
+  void LandmarkEstimate::AddEnd(FileOffset nodeOffset)
+  {
+    if (landmarks==NULL) {
+      return;
+    }
+
+    uint32_t node=landmarks->GetNode(nodeOffset);
+
+    if (node==Landmarks::INVALID_NODE ||
+        endCount>=2) {
+      landmarks=NULL;
+      endCount=0;
+      return;
+    }
+
+    ends[endCount]=node;
+    endCount++;
+  }
+
+  /**
+   * Like GetNodeDistance(), for the route node with the given file offset
+   */
+  double LandmarkEstimate::GetDistance(FileOffset nodeOffset,
+                                       double sphericalDistance) const
+  {
+    if (!IsActive()) {
+      return sphericalDistance;
+    }
+
+    uint32_t node=landmarks->GetNode(nodeOffset);
+
+    if (node==Landmarks::INVALID_NODE) {
+      return sphericalDistance;
+    }
+
+    return GetNodeDistance(node,
+                           sphericalDistance);
+  }
+}
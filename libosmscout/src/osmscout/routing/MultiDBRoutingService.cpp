@@ -43,11 +43,13 @@ namespace osmscout {
      routeNodeDataFile(RoutingService::GetDataFilename(osmscout::RoutingService::DEFAULT_FILENAME_BASE),
                        RoutingService::GetIndexFilename(osmscout::RoutingService::DEFAULT_FILENAME_BASE),
                        /*indexCacheSize*/ 12000,
-                       /*dataCacheSize*/ 1000),
+                       /*dataCacheSize*/ 1000,
+                       /*dataCacheMemory*/ 1024*1024),
      junctionDataFile(RoutingService::FILENAME_INTERSECTIONS_DAT,
                       RoutingService::FILENAME_INTERSECTIONS_IDX,
                       /*indexCacheSize*/ 10000,
-                      /*dataCacheSize*/ 1000)
+                      /*dataCacheSize*/ 1000,
+                      /*dataCacheMemory*/ 256*1024)
   {
   }
 
@@ -62,6 +64,10 @@ namespace osmscout {
                                                     RoutingService::GetData2Filename(osmscout::RoutingService::DEFAULT_FILENAME_BASE)))){
       return false;
     }
+
+    routeNodeDataFile.SetCacheManager(database->GetCacheManager());
+    junctionDataFile.SetCacheManager(database->GetCacheManager());
+
     if (!routeNodeDataFile.Open(database->GetTypeConfig(),
                                 database->GetPath(),
                                 true,
@@ -219,6 +225,30 @@ namespace osmscout {
     return state.GetProfile(database)->GetCosts(*way,wayLength);
   }
 
+  double MultiDBRoutingService::GetCosts(const MultiDBRoutingState& state,
+                                         const DatabaseId database,
+                                         const RouteGraph& graph,
+                                         uint32_t path)
+  {
+    return state.GetProfile(database)->GetCosts(routerFiles[database]->objectVariantDataFile.GetData()[graph.GetPathVariant(path)],
+                                                graph.GetPathDistance(path));
+  }
+
+  /**
+   * Return the in memory routing graph of the given database, as loaded by the
+   * router of the database on demand
+   */
+  const RouteGraph* MultiDBRoutingService::RequireRouteGraph(const DatabaseId database)
+  {
+    auto service=services.find(database);
+
+    if (service==services.end()) {
+      return NULL;
+    }
+
+    return service->second->RequireRouteGraph(database);
+  }
+
   double MultiDBRoutingService::GetEstimateCosts(const MultiDBRoutingState& state,
                                                  const DatabaseId database,
                                                  double targetDistance)
@@ -434,6 +464,17 @@ namespace osmscout {
     return profile->CanUse(routeNode,dataFiles->objectVariantDataFile.GetData(),pathIndex);
   }
 
+  bool MultiDBRoutingService::CanUse(const MultiDBRoutingState& /*state*/,
+                                     const DatabaseId database,
+                                     const RouteGraph& graph,
+                                     uint32_t path)
+  {
+    RoutingProfileRef profile=profiles[database];
+    RouterDBFilesRef dataFiles=routerFiles[database];
+    return profile->CanUse(graph.GetPathFlags(path),
+                           dataFiles->objectVariantDataFile.GetData()[graph.GetPathVariant(path)]);
+  }
+
   bool MultiDBRoutingService::GetRouteNodesByOffset(const std::set<DBFileOffset> &routeNodeOffsets,
                                                     std::unordered_map<DBFileOffset,RouteNodeRef> &routeNodeMap)
   {
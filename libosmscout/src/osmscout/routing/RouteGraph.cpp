@@ -0,0 +1,194 @@
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2017  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/routing/RouteGraph.h>
+
+#include <algorithm>
+
+#include <osmscout/util/FileScanner.h>
+#include <osmscout/util/Logger.h>
+#include <osmscout/util/StopClock.h>
+
+#include <osmscout/system/Assert.h>
+
+namespace osmscout {
+
+  const uint32_t RouteGraph::INVALID_NODE=std::numeric_limits<uint32_t>::max();
+
+  RouteGraph::RouteGraph()
+  {
+    Clear();
+  }
+
+  /**
+   * Remove all data and free the memory
+   */
+  void RouteGraph::Clear()
+  {
+    std::vector<FileOffset>().swap(nodeOffsets);
+    std::vector<GeoCoord>().swap(nodeCoords);
+    std::vector<uint32_t>(1,0).swap(pathStart);
+    std::vector<uint32_t>().swap(pathSources);
+    std::vector<uint32_t>().swap(pathTargets);
+    std::vector<double>().swap(pathDistances);
+    std::vector<uint32_t>().swap(pathObjects);
+    std::vector<uint16_t>().swap(pathVariants);
+    std::vector<uint8_t>().swap(pathFlags);
+    std::vector<ObjectFileRef>().swap(objects);
+    std::vector<uint32_t>(1,0).swap(excludeStart);
+    std::vector<ObjectFileRef>().swap(excludeSources);
+    std::vector<uint32_t>().swap(excludeTargets);
+    std::vector<uint32_t>(1,0).swap(incomingStart);
+    std::vector<uint32_t>().swap(incomingPaths);
+  }
+
+  /**
+   * Load the complete routing graph from the given route node data file.
+   *
+   * @return
+   *    false on error, else true
+   */
+  bool RouteGraph::Load(const TypeConfig& typeConfig,
+                        const std::string& filename)
+  {
+    FileScanner             scanner;
+    StopClock               timer;
+    std::vector<FileOffset> pathTargetOffsets;
+
+    Clear();
+
+    try {
+      uint32_t  nodeCount;
+      RouteNode routeNode;
+
+      scanner.Open(filename,
+                   FileScanner::Sequential,
+                   true);
+
+      scanner.Read(nodeCount);
+
+      nodeOffsets.reserve(nodeCount);
+      nodeCoords.reserve(nodeCount);
+      pathStart.reserve(nodeCount+1);
+      excludeStart.reserve(nodeCount+1);
+
+      for (uint32_t n=0; n<nodeCount; n++) {
+        routeNode.Read(typeConfig,
+                       scanner);
+
+        uint32_t firstObject=(uint32_t)objects.size();
+
+        nodeOffsets.push_back(routeNode.GetFileOffset());
+        nodeCoords.push_back(routeNode.GetCoord());
+
+        for (const auto& object : routeNode.objects) {
+          objects.push_back(object.object);
+        }
+
+        for (const auto& path : routeNode.paths) {
+          pathSources.push_back(n);
+          pathTargetOffsets.push_back(path.offset);
+          pathDistances.push_back(path.distance);
+          pathObjects.push_back(firstObject+path.objectIndex);
+          pathVariants.push_back(routeNode.objects[path.objectIndex].objectVariantIndex);
+          pathFlags.push_back(path.flags);
+        }
+
+        for (const auto& exclude : routeNode.excludes) {
+          excludeSources.push_back(exclude.source);
+          excludeTargets.push_back(firstObject+exclude.targetIndex);
+        }
+
+        pathStart.push_back((uint32_t)pathTargetOffsets.size());
+        excludeStart.push_back((uint32_t)excludeSources.size());
+      }
+
+      scanner.Close();
+    }
+    catch (IOException& e) {
+      log.Error() << e.GetDescription();
+      scanner.CloseFailsafe();
+      Clear();
+      return false;
+    }
+
+    // Route nodes are written in file order, so they are sorted by their offset
+    assert(std::is_sorted(nodeOffsets.begin(),nodeOffsets.end()));
+
+    pathTargets.reserve(pathTargetOffsets.size());
+
+    for (FileOffset offset : pathTargetOffsets) {
+      uint32_t target=GetNode(offset);
+
+      if (target==INVALID_NODE) {
+        log.Error() << "Cannot resolve route node at offset " << offset << " in '" << filename << "'";
+        Clear();
+        return false;
+      }
+
+      pathTargets.push_back(target);
+    }
+
+    // Reverse adjacency, paths sorted by their target node (counting sort)
+    uint32_t nodeCount=(uint32_t)nodeOffsets.size();
+    uint32_t pathCount=(uint32_t)pathTargets.size();
+
+    incomingStart.assign(nodeCount+1,0);
+    incomingPaths.resize(pathCount);
+
+    for (uint32_t path=0; path<pathCount; path++) {
+      incomingStart[pathTargets[path]+1]++;
+    }
+
+    for (uint32_t node=0; node<nodeCount; node++) {
+      incomingStart[node+1]+=incomingStart[node];
+    }
+
+    std::vector<uint32_t> incomingEnd(incomingStart.begin(),
+                                      incomingStart.end()-1);
+
+    for (uint32_t path=0; path<pathCount; path++) {
+      incomingPaths[incomingEnd[pathTargets[path]]++]=path;
+    }
+
+    timer.Stop();
+
+    log.Debug() << "Loading route graph '" << filename << "' (" << nodeOffsets.size() << " nodes, " << pathTargets.size() << " paths): " << timer.ResultString();
+
+    return true;
+  }
+
+  /**
+   * Return the index of the node with the given route node file offset or
+   * INVALID_NODE, if there is no such node.
+   */
+  uint32_t RouteGraph::GetNode(FileOffset nodeOffset) const
+  {
+    auto entry=std::lower_bound(nodeOffsets.begin(),
+                                nodeOffsets.end(),
+                                nodeOffset);
+
+    if (entry==nodeOffsets.end() ||
+        *entry!=nodeOffset) {
+      return INVALID_NODE;
+    }
+
+    return (uint32_t)(entry-nodeOffsets.begin());
+  }
+}
@@ -0,0 +1,419 @@
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2017  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/routing/RouteSegmentIndex.h>
+
+#include <algorithm>
+#include <utility>
+
+#include <osmscout/util/Geometry.h>
+
+namespace osmscout {
+
+  RouteSegmentIndex::RouteSegmentIndex()
+  : cellsPerDegree(1)
+  {
+    // no code
+  }
+
+  /**
+   * Returns the filename of the segment index for the given router
+   */
+  std::string RouteSegmentIndex::GetFilename(const std::string& filenamebase)
+  {
+    return filenamebase+"_segments.idx";
+  }
+
+  void RouteSegmentIndex::Clear()
+  {
+    std::vector<FileOffset>().swap(wayOffsets);
+    std::vector<TypeId>().swap(wayTypes);
+    std::vector<uint8_t>().swap(wayFlags);
+    std::vector<uint32_t>().swap(wayCoordStart);
+    std::vector<GeoCoord>().swap(coords);
+    std::vector<uint64_t>().swap(cellKeys);
+    std::vector<uint32_t>().swap(cellStart);
+    std::vector<Segment>().swap(segments);
+    std::vector<ObjectVariantData>().swap(typeVariants);
+  }
+
+  /**
+   * Set the number of grid cells per degree of latitude and longitude. Must be
+   * called before BuildCells().
+   */
+  void RouteSegmentIndex::SetCellsPerDegree(uint32_t cellsPerDegree)
+  {
+    this->cellsPerDegree=std::max(cellsPerDegree,(uint32_t)1);
+  }
+
+  /**
+   * Add a way. Ways must be added in ascending file offset order.
+   */
+  void RouteSegmentIndex::AddWay(FileOffset offset,
+                                 TypeId type,
+                                 uint8_t flags,
+                                 const std::vector<Point>& nodes)
+  {
+    if (wayCoordStart.empty()) {
+      wayCoordStart.push_back(0);
+    }
+
+    wayOffsets.push_back(offset);
+    wayTypes.push_back(type);
+    wayFlags.push_back(flags);
+
+    for (const auto& node : nodes) {
+      coords.push_back(node.GetCoord());
+    }
+
+    wayCoordStart.push_back((uint32_t)coords.size());
+  }
+
+  /**
+   * Assign the segments of all ways added to the grid cells overlapping the
+   * bounding box of the segment
+   */
+  void RouteSegmentIndex::BuildCells()
+  {
+    std::vector<std::pair<uint64_t,Segment>> entries;
+
+    for (uint32_t w=0; w<wayOffsets.size(); w++) {
+      for (uint32_t c=wayCoordStart[w]; c+1<wayCoordStart[w+1]; c++) {
+        uint32_t minX=GetCellX(std::min(coords[c].GetLon(),coords[c+1].GetLon()));
+        uint32_t maxX=GetCellX(std::max(coords[c].GetLon(),coords[c+1].GetLon()));
+        uint32_t minY=GetCellY(std::min(coords[c].GetLat(),coords[c+1].GetLat()));
+        uint32_t maxY=GetCellY(std::max(coords[c].GetLat(),coords[c+1].GetLat()));
+        Segment  segment;
+
+        segment.way=w;
+        segment.node=c-wayCoordStart[w];
+
+        for (uint32_t y=minY; y<=maxY; y++) {
+          for (uint32_t x=minX; x<=maxX; x++) {
+            entries.push_back(std::make_pair(GetCellKey(x,y),segment));
+          }
+        }
+      }
+    }
+
+    // Entries are created in way order, a stable sort keeps this order within a cell
+    std::stable_sort(entries.begin(),
+                     entries.end(),
+                     [](const std::pair<uint64_t,Segment>& a,
+                        const std::pair<uint64_t,Segment>& b) {
+                       return a.first<b.first;
+                     });
+
+    cellKeys.clear();
+    cellStart.clear();
+    segments.clear();
+    segments.reserve(entries.size());
+
+    for (const auto& entry : entries) {
+      if (cellKeys.empty() ||
+          cellKeys.back()!=entry.first) {
+        cellKeys.push_back(entry.first);
+        cellStart.push_back((uint32_t)segments.size());
+      }
+
+      segments.push_back(entry.second);
+    }
+
+    cellStart.push_back((uint32_t)segments.size());
+  }
+
+  /**
+   * Read the index from the given FileScanner
+   *
+   * @throws IOException
+   */
+  void RouteSegmentIndex::Read(const TypeConfig& typeConfig,
+                               FileScanner& scanner)
+  {
+    uint32_t   wayCount;
+    uint32_t   cellCount;
+    FileOffset previousOffset=0;
+
+    Clear();
+
+    scanner.Read(cellsPerDegree);
+    scanner.Read(wayCount);
+
+    wayOffsets.resize(wayCount);
+    wayTypes.resize(wayCount);
+    wayFlags.resize(wayCount);
+    wayCoordStart.resize(wayCount+1);
+    wayCoordStart[0]=0;
+
+    for (uint32_t w=0; w<wayCount; w++) {
+      FileOffset offsetDelta;
+      uint32_t   coordCount;
+
+      scanner.ReadNumber(offsetDelta);
+      scanner.ReadTypeId(wayTypes[w],
+                         typeConfig.GetWayTypeIdBytes());
+      scanner.Read(wayFlags[w]);
+      scanner.ReadNumber(coordCount);
+
+      wayOffsets[w]=previousOffset+offsetDelta;
+      previousOffset=wayOffsets[w];
+
+      for (uint32_t c=0; c<coordCount; c++) {
+        GeoCoord coord;
+
+        scanner.ReadCoord(coord);
+        coords.push_back(coord);
+      }
+
+      wayCoordStart[w+1]=(uint32_t)coords.size();
+    }
+
+    scanner.Read(cellCount);
+
+    cellKeys.resize(cellCount);
+    cellStart.resize(cellCount+1);
+    cellStart[0]=0;
+
+    uint64_t previousKey=0;
+
+    for (uint32_t cell=0; cell<cellCount; cell++) {
+      uint64_t keyDelta;
+      uint32_t segmentCount;
+      uint32_t previousWay=0;
+
+      scanner.ReadNumber(keyDelta);
+      scanner.ReadNumber(segmentCount);
+
+      cellKeys[cell]=previousKey+keyDelta;
+      previousKey=cellKeys[cell];
+
+      for (uint32_t s=0; s<segmentCount; s++) {
+        uint32_t wayDelta;
+        Segment  segment;
+
+        scanner.ReadNumber(wayDelta);
+        scanner.ReadNumber(segment.node);
+
+        segment.way=previousWay+wayDelta;
+        previousWay=segment.way;
+
+        segments.push_back(segment);
+      }
+
+      cellStart[cell+1]=(uint32_t)segments.size();
+    }
+
+    // Way type ids start with 1
+    typeVariants.resize(typeConfig.GetWayTypes().size()+1);
+
+    for (const auto& type : typeConfig.GetWayTypes()) {
+      typeVariants[type->GetWayId()].type=type;
+      typeVariants[type->GetWayId()].maxSpeed=0;
+      typeVariants[type->GetWayId()].grade=1;
+    }
+  }
+
+  /**
+   * Write the index to the given FileWriter. BuildCells() must have been
+   * called before.
+   *
+   * @throws IOException
+   */
+  void RouteSegmentIndex::Write(const TypeConfig& typeConfig,
+                                FileWriter& writer) const
+  {
+    FileOffset previousOffset=0;
+
+    writer.Write(cellsPerDegree);
+    writer.Write((uint32_t)wayOffsets.size());
+
+    for (uint32_t w=0; w<wayOffsets.size(); w++) {
+      writer.WriteNumber(wayOffsets[w]-previousOffset);
+      writer.WriteTypeId(wayTypes[w],
+                         typeConfig.GetWayTypeIdBytes());
+      writer.Write(wayFlags[w]);
+      writer.WriteNumber(wayCoordStart[w+1]-wayCoordStart[w]);
+
+      for (uint32_t c=wayCoordStart[w]; c<wayCoordStart[w+1]; c++) {
+        writer.WriteCoord(coords[c]);
+      }
+
+      previousOffset=wayOffsets[w];
+    }
+
+    writer.Write((uint32_t)cellKeys.size());
+
+    uint64_t previousKey=0;
+
+    for (size_t cell=0; cell<cellKeys.size(); cell++) {
+      uint32_t previousWay=0;
+
+      writer.WriteNumber(cellKeys[cell]-previousKey);
+      writer.WriteNumber(cellStart[cell+1]-cellStart[cell]);
+
+      for (uint32_t s=cellStart[cell]; s<cellStart[cell+1]; s++) {
+        writer.WriteNumber(segments[s].way-previousWay);
+        writer.WriteNumber(segments[s].node);
+
+        previousWay=segments[s].way;
+      }
+
+      previousKey=cellKeys[cell];
+    }
+  }
+
+  /**
+   * Check all segments of the given cell and update the match, if a segment usable
+   * by the profile is closer than the current match. Of segments with the same
+   * distance the segment of the way with the lower file offset and then the lower
+   * segment index wins, which is the same segment a scan of the ways in file
+   * offset order would find.
+   */
+  void RouteSegmentIndex::CheckCell(uint32_t x,
+                                    uint32_t y,
+                                    const GeoCoord& coord,
+                                    const RoutingProfile& profile,
+                                    bool& found,
+                                    RouteSegmentMatch& match,
+                                    uint32_t& matchWay) const
+  {
+    auto cell=std::lower_bound(cellKeys.begin(),
+                               cellKeys.end(),
+                               GetCellKey(x,y));
+
+    if (cell==cellKeys.end() ||
+        *cell!=GetCellKey(x,y)) {
+      return;
+    }
+
+    size_t cellIndex=cell-cellKeys.begin();
+
+    for (uint32_t s=cellStart[cellIndex]; s<cellStart[cellIndex+1]; s++) {
+      const Segment& segment=segments[s];
+
+      if (found &&
+          segment.way==matchWay &&
+          segment.node==match.segment) {
+        continue;
+      }
+
+      if (!profile.CanUse(wayFlags[segment.way],
+                          typeVariants[wayTypes[segment.way]])) {
+        continue;
+      }
+
+      const GeoCoord& a=coords[wayCoordStart[segment.way]+segment.node];
+      const GeoCoord& b=coords[wayCoordStart[segment.way]+segment.node+1];
+      double          r,qx,qy;
+      double          distance=DistanceToSegment(coord.GetLon(),coord.GetLat(),
+                                                 a.GetLon(),a.GetLat(),
+                                                 b.GetLon(),b.GetLat(),
+                                                 r,qx,qy);
+
+      if (found) {
+        if (distance>match.distance) {
+          continue;
+        }
+
+        if (distance==match.distance &&
+            (segment.way>matchWay ||
+             (segment.way==matchWay && segment.node>match.segment))) {
+          continue;
+        }
+      }
+
+      found=true;
+      matchWay=segment.way;
+      match.object.Set(wayOffsets[segment.way],refWay);
+      match.segment=segment.node;
+      match.nodeIndex=r<0.5 ? segment.node : segment.node+1;
+      match.projection.Set(qy,qx);
+      match.distance=distance;
+    }
+  }
+
+  /**
+   * Find the segment usable by the given profile closest to the given coordinate.
+   * Only segments crossing a grid cell overlapping the given bounding box are
+   * considered. Cells are visited in rings around the cell of the coordinate, the
+   * search stops as soon as no unvisited cell can hold a closer segment.
+   *
+   * @return
+   *    true, if a segment was found, else false
+   */
+  bool RouteSegmentIndex::GetClosestSegment(const GeoCoord& coord,
+                                            const GeoBox& boundingBox,
+                                            const RoutingProfile& profile,
+                                            RouteSegmentMatch& match) const
+  {
+    if (cellKeys.empty()) {
+      return false;
+    }
+
+    uint32_t minX=GetCellX(boundingBox.GetMinLon());
+    uint32_t maxX=GetCellX(boundingBox.GetMaxLon());
+    uint32_t minY=GetCellY(boundingBox.GetMinLat());
+    uint32_t maxY=GetCellY(boundingBox.GetMaxLat());
+    uint32_t centerX=std::min(std::max(GetCellX(coord.GetLon()),minX),maxX);
+    uint32_t centerY=std::min(std::max(GetCellY(coord.GetLat()),minY),maxY);
+    uint32_t maxRing=std::max(std::max(centerX-minX,maxX-centerX),
+                              std::max(centerY-minY,maxY-centerY));
+    double   cellSize=1.0/cellsPerDegree;
+    bool     found=false;
+    uint32_t matchWay=0;
+
+    for (uint32_t ring=0; ring<=maxRing; ring++) {
+      // Segments in cells of this ring are at least ring-1 cells away
+      if (found &&
+          ring>0 &&
+          match.distance<(ring-1)*cellSize) {
+        break;
+      }
+
+      int64_t top=(int64_t)centerY+ring;
+      int64_t bottom=(int64_t)centerY-ring;
+      int64_t left=(int64_t)centerX-ring;
+      int64_t right=(int64_t)centerX+ring;
+
+      for (int64_t y=std::max(bottom,(int64_t)minY); y<=std::min(top,(int64_t)maxY); y++) {
+        bool borderRow=y==top || y==bottom;
+
+        for (int64_t x=std::max(left,(int64_t)minX); x<=std::min(right,(int64_t)maxX); x++) {
+          if (!borderRow &&
+              x!=left &&
+              x!=right) {
+            // Skip the inner cells visited by previous rings
+            x=right-1;
+            continue;
+          }
+
+          CheckCell((uint32_t)x,
+                    (uint32_t)y,
+                    coord,
+                    profile,
+                    found,
+                    match,
+                    matchWay);
+        }
+      }
+    }
+
+    return found;
+  }
+}
@@ -194,15 +194,20 @@ namespace osmscout {
                                       const std::vector<ObjectVariantData>& objectVariantData,
                                       size_t pathIndex) const
   {
-    if (!(currentNode.paths[pathIndex].flags & vehicleRouteNodeBit)) {
-      return false;
-    }
+    size_t index=currentNode.paths[pathIndex].objectIndex;
 
+    return CanUse(currentNode.paths[pathIndex].flags,
+                  objectVariantData[currentNode.objects[index].objectVariantIndex]);
+  }
 
-    size_t      index=currentNode.paths[pathIndex].objectIndex;
-    TypeInfoRef type=objectVariantData[currentNode.objects[index].objectVariantIndex].type;
+  bool AbstractRoutingProfile::CanUse(uint8_t pathFlags,
+                                      const ObjectVariantData& objectVariantData) const
+  {
+    if (!(pathFlags & vehicleRouteNodeBit)) {
+      return false;
+    }
 
-    size_t typeIndex=type->GetIndex();
+    size_t typeIndex=objectVariantData.type->GetIndex();
 
     return typeIndex<speeds.size() && speeds[typeIndex]>0.0;
   }
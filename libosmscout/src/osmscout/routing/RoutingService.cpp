@@ -19,6 +19,11 @@
 
 #include <osmscout/routing/RoutingService.h>
 
+#include <algorithm>
+#include <cstring>
+
+#include <osmscout/system/Assert.h>
+
 namespace osmscout {
 
   RoutePosition::RoutePosition()
@@ -38,7 +43,10 @@ namespace osmscout {
   }
 
   RouterParameter::RouterParameter()
-  : debugPerformance(false)
+  : debugPerformance(false),
+    inMemoryGraph(false),
+    landmarks(false),
+    segmentIndex(false)
   {
     // no code
   }
@@ -53,11 +61,67 @@ namespace osmscout {
     return debugPerformance;
   }
 
+  /**
+   * If set, the routing graph of the database ('route.dat') is completely loaded
+   * into memory (see RouteGraph) on Open() and used for calculating routes. This
+   * costs memory and startup time, but avoids loading route nodes from file while
+   * routing.
+   */
+  void RouterParameter::SetInMemoryGraph(bool inMemoryGraph)
+  {
+    this->inMemoryGraph=inMemoryGraph;
+  }
+
+  bool RouterParameter::IsInMemoryGraph() const
+  {
+    return inMemoryGraph;
+  }
+
+  /**
+   * If set, the landmark distance tables generated by the import (see
+   * ImportParameter::SetLandmarkCount()) are loaded on first use for the vehicle
+   * of the routing profile and improve the estimate of the A* search. Without
+   * a landmark file for the vehicle routing works as before.
+   */
+  void RouterParameter::SetLandmarks(bool landmarks)
+  {
+    this->landmarks=landmarks;
+  }
+
+  bool RouterParameter::IsLandmarks() const
+  {
+    return landmarks;
+  }
+
+  /**
+   * If set, the index of the segments of all routable ways generated by the import
+   * (see ImportParameter::SetRouteSegmentIndex()) is loaded on Open() and used for
+   * finding the closest routable node without loading ways. Without the index file
+   * the ways are loaded as before.
+   */
+  void RouterParameter::SetSegmentIndex(bool segmentIndex)
+  {
+    this->segmentIndex=segmentIndex;
+  }
+
+  bool RouterParameter::IsSegmentIndex() const
+  {
+    return segmentIndex;
+  }
+
   RoutingProgress::~RoutingProgress()
   {
     // no code
   }
 
+  RoutingParameter::RoutingParameter()
+  : bidirectional(false),
+    openListType(openListDAryHeap),
+    threadCount(0)
+  {
+    // no code
+  }
+
   void RoutingParameter::SetBreaker(const BreakerRef& breaker)
   {
     this->breaker=breaker;
@@ -68,6 +132,32 @@ namespace osmscout {
     this->progress=progress;
   }
 
+  void RoutingParameter::SetBidirectional(bool bidirectional)
+  {
+    this->bidirectional=bidirectional;
+  }
+
+  /**
+   * Set the data structure for the open list of the search. The set and the
+   * 4-ary heap result in the same routes, the heap is faster and the default.
+   * The radix heap is faster for large searches, but requires consistent cost
+   * estimates to deliver optimal routes.
+   */
+  void RoutingParameter::SetOpenListType(OpenListType openListType)
+  {
+    this->openListType=openListType;
+  }
+
+  /**
+   * Set the number of threads used by calculations that work on multiple independent
+   * searches (see SimpleRoutingService::CalculateMatrix()). 0, the default, uses one
+   * thread per hardware thread.
+   */
+  void RoutingParameter::SetThreadCount(size_t threadCount)
+  {
+    this->threadCount=threadCount;
+  }
+
   RoutingResult::RoutingResult()
   : currentMaxDistance(0.0),
     overallDistance(0.0)
@@ -75,6 +165,507 @@ namespace osmscout {
     // no code
   }
 
+  RoutingMatrixResult::RoutingMatrixResult()
+  : sourceCount(0),
+    targetCount(0)
+  {
+    // no code
+  }
+
+  /**
+   * Resize the matrix for the given number of sources and targets and mark all
+   * targets as unreachable
+   */
+  void RoutingMatrixResult::Initialize(size_t sourceCount,
+                                       size_t targetCount)
+  {
+    this->sourceCount=sourceCount;
+    this->targetCount=targetCount;
+
+    costs.assign(sourceCount*targetCount,std::numeric_limits<double>::infinity());
+    distances.assign(sourceCount*targetCount,0.0);
+    durations.assign(sourceCount*targetCount,0.0);
+  }
+
+  RoutingService::OpenList::~OpenList()
+  {
+    // no code
+  }
+
+  bool RoutingService::SetOpenList::IsEmpty() const
+  {
+    return nodes.empty();
+  }
+
+  size_t RoutingService::SetOpenList::GetSize() const
+  {
+    return nodes.size();
+  }
+
+  RoutingService::RNodeRef RoutingService::SetOpenList::GetTop() const
+  {
+    return *nodes.begin();
+  }
+
+  RoutingService::RNodeRef RoutingService::SetOpenList::Pop()
+  {
+    RNodeRef node=*nodes.begin();
+
+    index.erase(node->nodeOffset);
+    nodes.erase(nodes.begin());
+
+    return node;
+  }
+
+  void RoutingService::SetOpenList::Push(const RNodeRef& node)
+  {
+    auto entry=index.find(node->nodeOffset);
+
+    if (entry!=index.end()) {
+      if ((*entry->second)->currentCost<=node->currentCost) {
+        return;
+      }
+
+      nodes.erase(entry->second);
+      entry->second=nodes.insert(node).first;
+    }
+    else {
+      index[node->nodeOffset]=nodes.insert(node).first;
+    }
+  }
+
+  void RoutingService::SetOpenList::UpdateCosts(const RNodeRef& node,
+                                                double currentCost,
+                                                double estimateCost,
+                                                double overallCost)
+  {
+    auto entry=index.find(node->nodeOffset);
+
+    assert(entry!=index.end());
+
+    nodes.erase(entry->second);
+
+    node->currentCost=currentCost;
+    node->estimateCost=estimateCost;
+    node->overallCost=overallCost;
+
+    entry->second=nodes.insert(node).first;
+  }
+
+  RoutingService::RNodeRef RoutingService::SetOpenList::Find(const DBFileOffset& offset) const
+  {
+    auto entry=index.find(offset);
+
+    if (entry==index.end()) {
+      return NULL;
+    }
+
+    return *entry->second;
+  }
+
+  void RoutingService::SetOpenList::GetNodes(std::vector<RNodeRef>& nodes) const
+  {
+    nodes.assign(this->nodes.begin(),
+                 this->nodes.end());
+  }
+
+  void RoutingService::SetOpenList::Clear()
+  {
+    nodes.clear();
+    index.clear();
+  }
+
+  static const size_t DARY_HEAP_ARITY=4;
+
+  /**
+   * Store the entry at the given position of the heap
+   */
+  void RoutingService::DAryHeapOpenList::Place(const Entry& entry,
+                                               size_t position)
+  {
+    heap[position]=entry;
+    entry.node->openListIndex=position;
+  }
+
+  void RoutingService::DAryHeapOpenList::SiftUp(size_t position)
+  {
+    Entry entry=heap[position];
+
+    while (position>0) {
+      size_t parent=(position-1)/DARY_HEAP_ARITY;
+
+      if (!(entry<heap[parent])) {
+        break;
+      }
+
+      Place(heap[parent],
+            position);
+      position=parent;
+    }
+
+    Place(entry,
+          position);
+  }
+
+  void RoutingService::DAryHeapOpenList::SiftDown(size_t position)
+  {
+    Entry entry=heap[position];
+
+    while (true) {
+      size_t firstChild=position*DARY_HEAP_ARITY+1;
+
+      if (firstChild>=heap.size()) {
+        break;
+      }
+
+      size_t lastChild=std::min(firstChild+DARY_HEAP_ARITY,heap.size());
+      size_t minChild=firstChild;
+
+      for (size_t child=firstChild+1; child<lastChild; child++) {
+        if (heap[child]<heap[minChild]) {
+          minChild=child;
+        }
+      }
+
+      if (!(heap[minChild]<entry)) {
+        break;
+      }
+
+      Place(heap[minChild],
+            position);
+      position=minChild;
+    }
+
+    Place(entry,
+          position);
+  }
+
+  /**
+   * Remove the entry at the given position from the heap
+   */
+  void RoutingService::DAryHeapOpenList::Remove(size_t position)
+  {
+    Entry lastEntry=heap.back();
+
+    heap.pop_back();
+
+    if (position<heap.size()) {
+      Place(lastEntry,
+            position);
+      SiftUp(position);
+      SiftDown(lastEntry.node->openListIndex);
+    }
+  }
+
+  bool RoutingService::DAryHeapOpenList::IsEmpty() const
+  {
+    return heap.empty();
+  }
+
+  size_t RoutingService::DAryHeapOpenList::GetSize() const
+  {
+    return heap.size();
+  }
+
+  RoutingService::RNodeRef RoutingService::DAryHeapOpenList::GetTop() const
+  {
+    return index.find(heap.front().nodeOffset)->second;
+  }
+
+  RoutingService::RNodeRef RoutingService::DAryHeapOpenList::Pop()
+  {
+    auto     entry=index.find(heap.front().nodeOffset);
+    RNodeRef node=entry->second;
+
+    index.erase(entry);
+    Remove(0);
+
+    return node;
+  }
+
+  void RoutingService::DAryHeapOpenList::Push(const RNodeRef& node)
+  {
+    auto result=index.insert(std::make_pair(node->nodeOffset,node));
+
+    if (!result.second) {
+      if (result.first->second->currentCost<=node->currentCost) {
+        return;
+      }
+
+      Remove(result.first->second->openListIndex);
+      result.first->second=node;
+    }
+
+    Entry entry;
+
+    entry.overallCost=node->overallCost;
+    entry.nodeOffset=node->nodeOffset;
+    entry.node=node.get();
+
+    heap.push_back(entry);
+    node->openListIndex=heap.size()-1;
+
+    SiftUp(heap.size()-1);
+  }
+
+  void RoutingService::DAryHeapOpenList::UpdateCosts(const RNodeRef& node,
+                                                     double currentCost,
+                                                     double estimateCost,
+                                                     double overallCost)
+  {
+    size_t position=node->openListIndex;
+
+    assert(heap[position].node==node.get());
+
+    node->currentCost=currentCost;
+    node->estimateCost=estimateCost;
+    node->overallCost=overallCost;
+
+    heap[position].overallCost=overallCost;
+
+    SiftUp(position);
+    SiftDown(node->openListIndex);
+  }
+
+  RoutingService::RNodeRef RoutingService::DAryHeapOpenList::Find(const DBFileOffset& offset) const
+  {
+    auto entry=index.find(offset);
+
+    if (entry==index.end()) {
+      return NULL;
+    }
+
+    return entry->second;
+  }
+
+  void RoutingService::DAryHeapOpenList::GetNodes(std::vector<RNodeRef>& nodes) const
+  {
+    nodes.clear();
+    nodes.reserve(heap.size());
+
+    for (const auto& entry : heap) {
+      nodes.push_back(index.find(entry.nodeOffset)->second);
+    }
+  }
+
+  void RoutingService::DAryHeapOpenList::Clear()
+  {
+    heap.clear();
+    index.clear();
+  }
+
+  RoutingService::RadixHeapOpenList::RadixHeapOpenList()
+  : last(0),
+    size(0)
+  {
+    // no code
+  }
+
+  /**
+   * Map the costs to an unsigned integer with the same ordering
+   */
+  uint64_t RoutingService::RadixHeapOpenList::GetKey(double cost)
+  {
+    uint64_t key;
+
+    static_assert(sizeof(key)==sizeof(cost),"double is expected to have 64 bit");
+
+    memcpy(&key,&cost,sizeof(key));
+
+    if (key & 0x8000000000000000ull) {
+      return ~key;
+    }
+
+    return key | 0x8000000000000000ull;
+  }
+
+  /**
+   * Bucket 0 holds the nodes with the key of the last minimum, bucket i>0
+   * the nodes whose key differs from it first in bit i-1
+   */
+  size_t RoutingService::RadixHeapOpenList::GetBucket(const RNode& node) const
+  {
+    uint64_t key=GetKey(node.overallCost);
+
+    if (key<=last) {
+      return 0;
+    }
+
+    uint64_t diff=key ^ last;
+    size_t   bucket=0;
+
+    while (diff>=0x100) {
+      diff>>=8;
+      bucket+=8;
+    }
+
+    while (diff!=0) {
+      diff>>=1;
+      bucket++;
+    }
+
+    return bucket;
+  }
+
+  void RoutingService::RadixHeapOpenList::Insert(RNode* node)
+  {
+    std::vector<RNode*>& bucket=buckets[GetBucket(*node)];
+
+    node->openListIndex=bucket.size();
+    bucket.push_back(node);
+  }
+
+  void RoutingService::RadixHeapOpenList::Remove(RNode* node)
+  {
+    std::vector<RNode*>& bucket=buckets[GetBucket(*node)];
+    size_t               position=node->openListIndex;
+
+    assert(bucket[position]==node);
+
+    bucket[position]=bucket.back();
+    bucket[position]->openListIndex=position;
+    bucket.pop_back();
+  }
+
+  /**
+   * Make sure, that bucket 0 is not empty if there are nodes in the list, by
+   * redistributing the first non empty bucket using its minimum as new last
+   * minimum
+   */
+  void RoutingService::RadixHeapOpenList::Normalize()
+  {
+    if (size==0 ||
+        !buckets[0].empty()) {
+      return;
+    }
+
+    size_t b=1;
+
+    while (buckets[b].empty()) {
+      b++;
+    }
+
+    std::vector<RNode*> nodes;
+
+    nodes.swap(buckets[b]);
+
+    last=GetKey(nodes.front()->overallCost);
+
+    for (const auto node : nodes) {
+      last=std::min(last,GetKey(node->overallCost));
+    }
+
+    for (const auto node : nodes) {
+      Insert(node);
+    }
+  }
+
+  bool RoutingService::RadixHeapOpenList::IsEmpty() const
+  {
+    return size==0;
+  }
+
+  size_t RoutingService::RadixHeapOpenList::GetSize() const
+  {
+    return size;
+  }
+
+  RoutingService::RNodeRef RoutingService::RadixHeapOpenList::GetTop() const
+  {
+    const RNode* top=buckets[0].front();
+
+    // Resolve ties like the other open lists
+    for (const auto node : buckets[0]) {
+      if (node->overallCost<top->overallCost ||
+          (node->overallCost==top->overallCost && node->nodeOffset<top->nodeOffset)) {
+        top=node;
+      }
+    }
+
+    return index.find(top->nodeOffset)->second;
+  }
+
+  RoutingService::RNodeRef RoutingService::RadixHeapOpenList::Pop()
+  {
+    RNodeRef node=GetTop();
+
+    Remove(node.get());
+    index.erase(node->nodeOffset);
+    size--;
+
+    Normalize();
+
+    return node;
+  }
+
+  void RoutingService::RadixHeapOpenList::Push(const RNodeRef& node)
+  {
+    auto result=index.insert(std::make_pair(node->nodeOffset,node));
+
+    if (!result.second) {
+      if (result.first->second->currentCost<=node->currentCost) {
+        return;
+      }
+
+      Remove(result.first->second.get());
+      result.first->second=node;
+      size--;
+    }
+
+    Insert(node.get());
+    size++;
+
+    Normalize();
+  }
+
+  void RoutingService::RadixHeapOpenList::UpdateCosts(const RNodeRef& node,
+                                                      double currentCost,
+                                                      double estimateCost,
+                                                      double overallCost)
+  {
+    Remove(node.get());
+
+    node->currentCost=currentCost;
+    node->estimateCost=estimateCost;
+    node->overallCost=overallCost;
+
+    Insert(node.get());
+
+    Normalize();
+  }
+
+  RoutingService::RNodeRef RoutingService::RadixHeapOpenList::Find(const DBFileOffset& offset) const
+  {
+    auto entry=index.find(offset);
+
+    if (entry==index.end()) {
+      return NULL;
+    }
+
+    return entry->second;
+  }
+
+  void RoutingService::RadixHeapOpenList::GetNodes(std::vector<RNodeRef>& nodes) const
+  {
+    nodes.clear();
+    nodes.reserve(size);
+
+    for (const auto& entry : index) {
+      nodes.push_back(entry.second);
+    }
+  }
+
+  void RoutingService::RadixHeapOpenList::Clear()
+  {
+    for (auto& bucket : buckets) {
+      bucket.clear();
+    }
+
+    index.clear();
+    last=0;
+    size=0;
+  }
+
   std::string RoutingService::GetDataFilename(const std::string& filenamebase)
   {
     return filenamebase+".dat";
@@ -90,6 +681,23 @@ namespace osmscout {
     return filenamebase+".idx";
   }
 
+  /**
+   * Create the open list as selected by the routing parameter
+   */
+  RoutingService::OpenListRef RoutingService::CreateOpenList(const RoutingParameter& parameter)
+  {
+    switch (parameter.GetOpenListType()) {
+    case RoutingParameter::openListSet:
+      return std::make_shared<SetOpenList>();
+    case RoutingParameter::openListRadixHeap:
+      return std::make_shared<RadixHeapOpenList>();
+    case RoutingParameter::openListDAryHeap:
+      break;
+    }
+
+    return std::make_shared<DAryHeapOpenList>();
+  }
+
   const char* const RoutingService::FILENAME_INTERSECTIONS_DAT   = "intersections.dat";
   const char* const RoutingService::FILENAME_INTERSECTIONS_IDX   = "intersections.idx";
 
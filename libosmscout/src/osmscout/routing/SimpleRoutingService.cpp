@@ -19,7 +19,9 @@
 
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <algorithm>
+#include <thread>
 
 #include <osmscout/system/Assert.h>
 
@@ -37,6 +39,21 @@
 
 namespace osmscout {
 
+  /**
+   * Number of worker threads to use for the given number of independent jobs
+   */
+  static size_t GetWorkerCount(const RoutingParameter& parameter,
+                               size_t jobCount)
+  {
+    size_t threadCount=parameter.GetThreadCount();
+
+    if (threadCount==0) {
+      threadCount=std::max(std::thread::hardware_concurrency(),1u);
+    }
+
+    return std::max(std::min(threadCount,jobCount),(size_t)1);
+  }
+
   /**
    * Create a new instance of the routing service.
    *
@@ -56,13 +73,21 @@ namespace osmscout {
      routeNodeDataFile(GetDataFilename(filenamebase),
                        GetIndexFilename(filenamebase),
                        /*indexCacheSize*/ 12000,
-                       /*dataCacheSize*/ 1000),
+                       /*dataCacheSize*/ 1000,
+                       /*dataCacheMemory*/ 1024*1024),
      junctionDataFile(RoutingService::FILENAME_INTERSECTIONS_DAT,
                       RoutingService::FILENAME_INTERSECTIONS_IDX,
                       /*indexCacheSize*/ 10000,
-                      /*dataCacheSize*/ 1000)
+                      /*dataCacheSize*/ 1000,
+                      /*dataCacheMemory*/ 256*1024),
+     inMemoryGraph(parameter.IsInMemoryGraph()),
+     useLandmarks(parameter.IsLandmarks()),
+     useSegmentIndex(parameter.IsSegmentIndex())
   {
     assert(database);
+
+    routeNodeDataFile.SetCacheManager(database->GetCacheManager());
+    junctionDataFile.SetCacheManager(database->GetCacheManager());
   }
 
   SimpleRoutingService::~SimpleRoutingService()
@@ -126,6 +151,177 @@ namespace osmscout {
     return profile.GetCosts(*way,wayLength);
   }
 
+  bool SimpleRoutingService::CanUse(const RoutingProfile& profile,
+                                    const DatabaseId /*database*/,
+                                    const RouteGraph& graph,
+                                    uint32_t path)
+  {
+    return profile.CanUse(graph.GetPathFlags(path),
+                          objectVariantDataFile.GetData()[graph.GetPathVariant(path)]);
+  }
+
+  double SimpleRoutingService::GetCosts(const RoutingProfile& profile,
+                                        const DatabaseId /*database*/,
+                                        const RouteGraph& graph,
+                                        uint32_t path)
+  {
+    return profile.GetCosts(objectVariantDataFile.GetData()[graph.GetPathVariant(path)],
+                            graph.GetPathDistance(path));
+  }
+
+  const RouteGraph* SimpleRoutingService::GetRouteGraph(const DatabaseId /*database*/)
+  {
+    std::lock_guard<std::mutex> guard(routeGraphMutex);
+
+    if (routeGraph.IsLoaded()) {
+      return &routeGraph;
+    }
+
+    return NULL;
+  }
+
+  /**
+   * Return the in memory routing graph, loading it if it is not loaded yet. Returns
+   * NULL on error.
+   */
+  const RouteGraph* SimpleRoutingService::RequireRouteGraph(const DatabaseId /*database*/)
+  {
+    if (!LoadRouteGraph()) {
+      return NULL;
+    }
+
+    return &routeGraph;
+  }
+
+  /**
+   * Load the in memory routing graph, if not already loaded
+   *
+   * @return
+   *    false on error, else true
+   */
+  bool SimpleRoutingService::LoadRouteGraph()
+  {
+    std::lock_guard<std::mutex> guard(routeGraphMutex);
+
+    if (routeGraph.IsLoaded()) {
+      return true;
+    }
+
+    if (!routeGraph.Load(*database->GetTypeConfig(),
+                         AppendFileToDir(path,
+                                         GetDataFilename(filenamebase)))) {
+      log.Error() << "Cannot load route graph from '" << path << "'!";
+      return false;
+    }
+
+    return true;
+  }
+
+  /**
+   * Load the segment index of the routable ways, if it was generated by the
+   * import. A missing index is not an error.
+   */
+  bool SimpleRoutingService::LoadSegmentIndex()
+  {
+    std::string filename=AppendFileToDir(path,
+                                         RouteSegmentIndex::GetFilename(filenamebase));
+
+    if (!ExistsInFilesystem(filename)) {
+      log.Warn() << "No segment index '" << filename << "', loading ways for closest routable node lookup";
+      return true;
+    }
+
+    StopClock   timer;
+    FileScanner scanner;
+
+    try {
+      scanner.Open(filename,
+                   FileScanner::Sequential,
+                   true);
+
+      segmentIndex.Read(*database->GetTypeConfig(),
+                        scanner);
+
+      scanner.Close();
+    }
+    catch (IOException& e) {
+      log.Error() << e.GetDescription();
+      scanner.CloseFailsafe();
+      segmentIndex.Clear();
+      return false;
+    }
+
+    timer.Stop();
+
+    log.Debug() << "Opening RouteSegmentIndex: " << timer.ResultString();
+
+    return true;
+  }
+
+  /**
+   * Return the landmarks for the vehicle of the given profile. They are loaded
+   * on first use, if enabled (see RouterParameter::SetLandmarks()) and generated
+   * by the import.
+   */
+  const Landmarks* SimpleRoutingService::GetLandmarks(const RoutingProfile& profile,
+                                                      const DatabaseId /*database*/)
+  {
+    if (!useLandmarks) {
+      return NULL;
+    }
+
+    std::lock_guard<std::mutex> guard(landmarksMutex);
+    Vehicle                     vehicle=profile.GetVehicle();
+    auto                        entry=landmarks.find(vehicle);
+
+    if (entry!=landmarks.end()) {
+      return entry->second.get();
+    }
+
+    std::string filename=AppendFileToDir(path,
+                                         Landmarks::GetFilename(filenamebase,
+                                                                vehicle));
+
+    // An unavailable landmark file is remembered, too
+    LandmarksRef& vehicleLandmarks=landmarks[vehicle];
+
+    if (!ExistsInFilesystem(filename)) {
+      log.Warn() << "No landmarks '" << filename << "', using spherical distance estimate";
+      return NULL;
+    }
+
+    StopClock    timer;
+    FileScanner  scanner;
+    LandmarksRef newLandmarks=std::make_shared<Landmarks>();
+
+    try {
+      scanner.Open(filename,
+                   FileScanner::Sequential,
+                   true);
+
+      newLandmarks->Read(scanner);
+
+      scanner.Close();
+    }
+    catch (IOException& e) {
+      log.Error() << e.GetDescription();
+      scanner.CloseFailsafe();
+      return NULL;
+    }
+
+    if (!newLandmarks->IsLoaded()) {
+      return NULL;
+    }
+
+    vehicleLandmarks=newLandmarks;
+
+    timer.Stop();
+
+    log.Debug() << "Opening Landmarks: " << timer.ResultString();
+
+    return vehicleLandmarks.get();
+  }
+
   double SimpleRoutingService::GetEstimateCosts(const RoutingProfile& profile,
                                                 const DatabaseId /*database*/,
                                                 double targetDistance)
@@ -216,6 +412,16 @@ namespace osmscout {
       return false;
     }
 
+    if (inMemoryGraph &&
+        !LoadRouteGraph()) {
+      return false;
+    }
+
+    if (useSegmentIndex &&
+        !LoadSegmentIndex()) {
+      return false;
+    }
+
     isOpen=true;
 
     return true;
@@ -239,6 +445,28 @@ namespace osmscout {
   {
     routeNodeDataFile.Close();
 
+    {
+      std::lock_guard<std::mutex> guard(junctionDataFileMutex);
+
+      if (junctionDataFile.IsOpen()) {
+        junctionDataFile.Close();
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> guard(routeGraphMutex);
+
+      routeGraph.Clear();
+    }
+
+    {
+      std::lock_guard<std::mutex> guard(landmarksMutex);
+
+      landmarks.clear();
+    }
+
+    segmentIndex.Clear();
+
     isOpen=false;
   }
 
@@ -363,19 +591,23 @@ namespace osmscout {
       }
     }
 
-    if (!junctionDataFile.IsOpen()) {
-      StopClock timer;
+    {
+      std::lock_guard<std::mutex> guard(junctionDataFileMutex);
 
-      if (!junctionDataFile.Open(database->GetTypeConfig(),
-                                 path,
-                                 false,
-                                 false)) {
-        return false;
-      }
+      if (!junctionDataFile.IsOpen()) {
+        StopClock timer;
+
+        if (!junctionDataFile.Open(database->GetTypeConfig(),
+                                   path,
+                                   false,
+                                   false)) {
+          return false;
+        }
 
-      timer.Stop();
+        timer.Stop();
 
-      log.Debug() << "Opening JunctionDataFile: " << timer.ResultString();
+        log.Debug() << "Opening JunctionDataFile: " << timer.ResultString();
+      }
     }
 
     std::vector<JunctionRef> junctions;
@@ -404,7 +636,7 @@ namespace osmscout {
       }
     }
 
-    return junctionDataFile.Close();
+    return true;
   }
 
   std::vector<DBFileOffset> SimpleRoutingService::GetNodeTwins(const RoutingProfile& /*state*/,
@@ -483,6 +715,863 @@ namespace osmscout {
     return result;
   }
 
+  void SimpleRoutingService::MatrixSearch::Init(size_t nodeCount)
+  {
+    if (nodes.size()!=nodeCount) {
+      MatrixSearchNode initial;
+
+      initial.open=false;
+      initial.closed[0]=false;
+      initial.closed[1]=false;
+
+      nodes.assign(nodeCount,initial);
+    }
+    else {
+      for (uint32_t node : touched) {
+        nodes[node].open=false;
+        nodes[node].closed[0]=false;
+        nodes[node].closed[1]=false;
+      }
+    }
+
+    touched.clear();
+    heap.clear();
+  }
+
+  /**
+   * Return the route nodes next to a source or target position of a matrix
+   * calculation together with the costs, distance and duration between the position
+   * and the route node. Like for the start of CalculateRoute() these are calculated
+   * based on the spherical distance.
+   *
+   * @return
+   *    True, if at least one route node was found, else false
+   */
+  bool SimpleRoutingService::GetMatrixAnchors(const RoutingProfile& profile,
+                                              const RoutePosition& position,
+                                              size_t positionIndex,
+                                              bool isSource,
+                                              GeoCoord& coord,
+                                              std::vector<MatrixAnchor>& anchors)
+  {
+    RouteNodeRef forwardRouteNode;
+    RouteNodeRef backwardRouteNode;
+
+    if (isSource) {
+      RNodeRef forwardRNode;
+      RNodeRef backwardRNode;
+
+      // There is no target, the cost estimate of the returned RNodes is not used
+      if (!GetStartNodes(profile,
+                         position,
+                         coord,
+                         coord,
+                         forwardRouteNode,
+                         backwardRouteNode,
+                         forwardRNode,
+                         backwardRNode)) {
+        return false;
+      }
+    }
+    else if (!GetTargetNodes(profile,
+                             position,
+                             coord,
+                             forwardRouteNode,
+                             backwardRouteNode)) {
+      return false;
+    }
+
+    WayRef way;
+
+    if (!GetWayByOffset(DBFileOffset(position.GetDatabaseId(),
+                                     position.GetObjectFileRef().GetFileOffset()),
+                        way)) {
+      log.Error() << "Cannot get way " << position.GetObjectFileRef().GetName();
+      return false;
+    }
+
+    std::vector<MatrixAnchor> positionAnchors;
+
+    for (const RouteNodeRef& routeNode : {forwardRouteNode,backwardRouteNode}) {
+      if (!routeNode) {
+        continue;
+      }
+
+      MatrixAnchor anchor;
+
+      anchor.position=positionIndex;
+      anchor.node=routeGraph.GetNode(routeNode->GetFileOffset());
+
+      if (anchor.node==RouteGraph::INVALID_NODE) {
+        log.Error() << "Cannot find route node " << routeNode->GetFileOffset() << " in route graph";
+        return false;
+      }
+
+      anchor.distance=GetSphericalDistance(coord,
+                                           routeGraph.GetNodeCoord(anchor.node));
+      anchor.cost=profile.GetCosts(*way,anchor.distance);
+      anchor.duration=profile.GetTime(*way,anchor.distance);
+
+      positionAnchors.push_back(anchor);
+    }
+
+    anchors.insert(anchors.end(),
+                   positionAnchors.begin(),
+                   positionAnchors.end());
+
+    return true;
+  }
+
+  /**
+   * Calculate the costs from one source to all targets of a matrix calculation
+   * using a one-to-many Dijkstra search on the route graph. Each time a route node
+   * with a bucket is settled, all targets of the bucket are updated. The search stops
+   * as soon as all buckets are settled or the cost limit for the most distant target
+   * is reached. The search follows the rules of CalculateRouteInGraph() regarding
+   * access restrictions, u-turns and turn restrictions.
+   *
+   * Only reads shared state, so it can be called from multiple threads in parallel
+   * as long as each thread uses its own MatrixSearch.
+   */
+  void SimpleRoutingService::CalculateMatrixRow(const RoutingProfile& profile,
+                                                const MatrixTargets& targets,
+                                                size_t source,
+                                                const RoutePosition& sourcePosition,
+                                                const std::vector<MatrixAnchor>& sourceAnchors,
+                                                const GeoCoord& sourceCoord,
+                                                MatrixSearch& search,
+                                                RoutingMatrixResult& result)
+  {
+    const std::vector<ObjectVariantData>& objectVariants=objectVariantDataFile.GetData();
+    Vehicle                               vehicle=profile.GetVehicle();
+    DatabaseId                            dbId=sourcePosition.GetDatabaseId();
+    std::vector<MatrixSearchNode>&        nodes=search.nodes;
+    std::vector<GraphSearchEntry>&        heap=search.heap;
+    double                                maxDistance=0.0;
+
+    for (size_t target=0; target<targets.coords.size(); target++) {
+      if (targets.coords[target]==sourceCoord) {
+        result.Set(source,target,0.0,0.0,0.0);
+      }
+
+      maxDistance=std::max(maxDistance,GetSphericalDistance(sourceCoord,
+                                                            targets.coords[target]));
+    }
+
+    double costLimit=GetCostLimit(profile,dbId,maxDistance);
+
+    search.Init(routeGraph.GetNodeCount());
+
+    for (const auto& anchor : sourceAnchors) {
+      MatrixSearchNode& node=nodes[anchor.node];
+
+      if (node.open &&
+          node.cost<=anchor.cost) {
+        continue;
+      }
+
+      search.Touch(anchor.node);
+
+      node.cost=anchor.cost;
+      node.distance=anchor.distance;
+      node.duration=anchor.duration;
+      node.prev=RouteGraph::INVALID_NODE;
+      node.object=sourcePosition.GetObjectFileRef();
+      node.access=true;
+      node.open=true;
+
+      heap.push_back(GraphSearchEntry(anchor.cost,anchor.node));
+      std::push_heap(heap.begin(),heap.end(),std::greater<GraphSearchEntry>());
+    }
+
+    size_t           bucketsLeft=targets.bucketCount;
+    MatrixSearchNode currentLabel;
+
+    while (!heap.empty() &&
+           bucketsLeft>0) {
+      GraphSearchEntry entry=heap.front();
+      uint32_t         current=entry.second;
+
+      std::pop_heap(heap.begin(),heap.end(),std::greater<GraphSearchEntry>());
+      heap.pop_back();
+
+      if (!nodes[current].open ||
+          nodes[current].cost!=entry.first) {
+        // Outdated heap entry
+        continue;
+      }
+
+      // The label may change while walking the paths, so we work on a copy
+      currentLabel=nodes[current];
+
+      nodes[current].open=false;
+
+      for (uint32_t path=routeGraph.GetFirstPath(current); path<routeGraph.GetLastPath(current); path++) {
+        uint32_t next=routeGraph.GetPathTarget(path);
+
+        if (next==currentLabel.prev) {
+          continue;
+        }
+
+        bool pathAccess=!routeGraph.IsPathRestricted(path,vehicle);
+
+        if (!currentLabel.access &&
+            pathAccess) {
+          continue;
+        }
+
+        if (!CanUse(profile,
+                    dbId,
+                    routeGraph,
+                    path)) {
+          continue;
+        }
+
+        if (nodes[next].closed[currentLabel.access ? 1 : 0]) {
+          continue;
+        }
+
+        if (routeGraph.IsExcluded(current,
+                                  currentLabel.object,
+                                  path)) {
+          continue;
+        }
+
+        double cost=currentLabel.cost+GetCosts(profile,dbId,routeGraph,path);
+
+        if (cost>costLimit) {
+          continue;
+        }
+
+        // Check, if we already have a cheaper path to the new node
+        if (nodes[next].open &&
+            nodes[next].cost<=cost) {
+          continue;
+        }
+
+        double pathDistance=routeGraph.GetPathDistance(path);
+
+        search.Touch(next);
+
+        nodes[next].cost=cost;
+        nodes[next].distance=currentLabel.distance+pathDistance;
+        nodes[next].duration=currentLabel.duration+profile.GetTime(objectVariants[routeGraph.GetPathVariant(path)],
+                                                                   pathDistance);
+        nodes[next].prev=current;
+        nodes[next].object=routeGraph.GetPathObject(path);
+        nodes[next].access=pathAccess;
+        nodes[next].open=true;
+
+        heap.push_back(GraphSearchEntry(cost,next));
+        std::push_heap(heap.begin(),heap.end(),std::greater<GraphSearchEntry>());
+      }
+
+      size_t accessIndex=currentLabel.access ? 1 : 0;
+
+      if (nodes[current].closed[accessIndex]) {
+        continue;
+      }
+
+      nodes[current].closed[accessIndex]=true;
+
+      // Only the first label settled at a route node is the cheapest one
+      if (!targets.bucketNodes[current] ||
+          nodes[current].closed[1-accessIndex]) {
+        continue;
+      }
+
+      bucketsLeft--;
+
+      MatrixAnchor key;
+
+      key.node=current;
+
+      auto bucket=std::equal_range(targets.anchors.begin(),
+                                   targets.anchors.end(),
+                                   key,
+                                   [](const MatrixAnchor& a,
+                                      const MatrixAnchor& b) {
+                                     return a.node<b.node;
+                                   });
+
+      for (auto anchor=bucket.first; anchor!=bucket.second; ++anchor) {
+        double cost=currentLabel.cost+anchor->cost;
+
+        if (cost<result.GetCost(source,anchor->position)) {
+          result.Set(source,
+                     anchor->position,
+                     cost,
+                     currentLabel.distance+anchor->distance,
+                     currentLabel.duration+anchor->duration);
+        }
+      }
+    }
+  }
+
+  /**
+   * Calculate the routes of a batch of requests in parallel on
+   * RoutingParameter::GetThreadCount() worker threads. The requests are handed
+   * out one by one, so a worker finished with a short route continues with the
+   * next pending request. The search state of the routes is taken from the pool of
+   * the service, so at most one search state per worker is allocated and then
+   * reused for the following routes.
+   *
+   * @param profile
+   *    Profile to use for all routes
+   * @param requests
+   *    Start and target of the routes
+   * @param parameter
+   *    Optional breaker and number of threads
+   * @return
+   *    One result per request, in the order of the requests. If no route
+   *    was found or the calculation was aborted, the result holds no route.
+   */
+  std::vector<RoutingResult> SimpleRoutingService::CalculateRoutes(RoutingProfile& profile,
+                                                                   const std::vector<Request>& requests,
+                                                                   const RoutingParameter& parameter)
+  {
+    StopClock                  clock;
+    std::vector<RoutingResult> results(requests.size());
+    size_t                     threadCount=GetWorkerCount(parameter,
+                                                          requests.size());
+    std::atomic<size_t>        nextRequest(0);
+
+    auto worker=[&]() {
+      size_t request;
+
+      while ((request=nextRequest++)<requests.size()) {
+        if (parameter.GetBreaker() &&
+            parameter.GetBreaker()->IsAborted()) {
+          return;
+        }
+
+        results[request]=CalculateRoute(profile,
+                                        requests[request].start,
+                                        requests[request].target,
+                                        parameter);
+      }
+    };
+
+    std::vector<std::thread> threads;
+
+    for (size_t i=1; i<threadCount; i++) {
+      threads.push_back(std::thread(worker));
+    }
+
+    worker();
+
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    clock.Stop();
+
+    if (debugPerformance) {
+      log.Info() << "Routes " << requests.size() << ": " << clock.ResultString() << " using " << threadCount << " thread(s)";
+    }
+
+    return results;
+  }
+
+  const uint32_t SimpleRoutingService::TargetTree::NO_PATH=std::numeric_limits<uint32_t>::max();
+
+  /**
+   * Calculate the cheapest routes to the given target from all paths of the route
+   * graph within the cost limit of a route of the given length (see GetCostLimit()),
+   * to be used for fast re-routing to the same target by Reroute().
+   *
+   * The search is a backward Dijkstra search on the paths (not on the route nodes)
+   * of the in memory route graph, so that turn restrictions, u-turns and access
+   * restrictions are evaluated exactly like by the forward search of
+   * CalculateRouteInGraph(). It stops at the cost limit and only stores the paths
+   * it reaches, so the size of the tree depends on maxDistance and not on the size
+   * of the route graph. If the route graph has not been loaded on Open() (see
+   * RouterParameter::SetInMemoryGraph()), it is loaded now.
+   *
+   * The progress callback of the parameter is not called, the breaker is checked
+   * regularly.
+   *
+   * @param profile
+   *    Profile to use
+   * @param target
+   *    Target of the routes
+   * @param maxDistance
+   *    Distance (in km) of the farthest start the tree should cover, for example the
+   *    length of the previous route
+   * @param parameter
+   *    Optional breaker
+   * @return
+   *    The tree, NULL on error or if aborted
+   */
+  SimpleRoutingService::TargetTreeRef SimpleRoutingService::CalculateTargetTree(RoutingProfile& profile,
+                                                                                const RoutePosition& target,
+                                                                                double maxDistance,
+                                                                                const RoutingParameter& parameter)
+  {
+    if (!LoadRouteGraph()) {
+      return NULL;
+    }
+
+    StopClock     clock;
+    DatabaseId    dbId=target.GetDatabaseId();
+    Vehicle       vehicle=profile.GetVehicle();
+    TargetTreeRef tree=std::make_shared<TargetTree>();
+    RouteNodeRef  targetForwardRouteNode;
+    RouteNodeRef  targetBackwardRouteNode;
+
+    if (!GetTargetNodes(profile,
+                        target,
+                        tree->targetCoord,
+                        targetForwardRouteNode,
+                        targetBackwardRouteNode)) {
+      return NULL;
+    }
+
+    tree->target=target;
+    tree->pathCount=routeGraph.GetPathCount();
+    tree->costLimit=GetCostLimit(profile,
+                                 dbId,
+                                 maxDistance);
+
+    size_t index=0;
+
+    for (const RouteNodeRef& routeNode : {targetForwardRouteNode,targetBackwardRouteNode}) {
+      tree->targetNodes[index]=RouteGraph::INVALID_NODE;
+
+      if (routeNode) {
+        tree->targetNodes[index]=routeGraph.GetNode(routeNode->GetFileOffset());
+
+        if (tree->targetNodes[index]==RouteGraph::INVALID_NODE) {
+          log.Error() << "Cannot find route node " << routeNode->GetFileOffset() << " in route graph";
+          return NULL;
+        }
+      }
+
+      index++;
+    }
+
+    // Paths reached but not yet settled, settled paths are moved to the tree
+    std::unordered_map<uint32_t,TargetTree::PathLabel> open;
+    std::vector<GraphSearchEntry>                      heap;
+
+    // Paths reaching the target are the roots of the tree
+    for (uint32_t targetNode : tree->targetNodes) {
+      if (targetNode==RouteGraph::INVALID_NODE) {
+        continue;
+      }
+
+      for (uint32_t i=routeGraph.GetFirstIncomingPath(targetNode); i<routeGraph.GetLastIncomingPath(targetNode); i++) {
+        uint32_t path=routeGraph.GetIncomingPath(i);
+
+        if (!CanUse(profile,
+                    dbId,
+                    routeGraph,
+                    path)) {
+          continue;
+        }
+
+        double cost=GetCosts(profile,dbId,routeGraph,path);
+        auto   label=open.find(path);
+
+        if (label==open.end() ||
+            cost<label->second.cost) {
+          open[path]=TargetTree::PathLabel{cost,TargetTree::NO_PATH};
+          heap.push_back(GraphSearchEntry(cost,path));
+          std::push_heap(heap.begin(),heap.end(),std::greater<GraphSearchEntry>());
+        }
+      }
+    }
+
+    while (!heap.empty()) {
+      GraphSearchEntry entry=heap.front();
+      uint32_t         current=entry.second;
+
+      std::pop_heap(heap.begin(),heap.end(),std::greater<GraphSearchEntry>());
+      heap.pop_back();
+
+      auto currentLabel=open.find(current);
+
+      if (currentLabel==open.end() ||
+          currentLabel->second.cost!=entry.first) {
+        // Outdated heap entry
+        continue;
+      }
+
+      if (entry.first>tree->costLimit) {
+        break;
+      }
+
+      tree->paths.insert(*currentLabel);
+      open.erase(currentLabel);
+
+      if (tree->paths.size()%100000==0 &&
+          parameter.GetBreaker() &&
+          parameter.GetBreaker()->IsAborted()) {
+        return NULL;
+      }
+
+      uint32_t node=routeGraph.GetPathSource(current);
+
+      // A route reaching a target node ends there
+      if (tree->IsTargetNode(node)) {
+        continue;
+      }
+
+      bool currentAccess=!routeGraph.IsPathRestricted(current,vehicle);
+
+      for (uint32_t i=routeGraph.GetFirstIncomingPath(node); i<routeGraph.GetLastIncomingPath(node); i++) {
+        uint32_t prev=routeGraph.GetIncomingPath(i);
+
+        if (tree->paths.find(prev)!=tree->paths.end()) {
+          continue;
+        }
+
+        // No u-turn
+        if (routeGraph.GetPathTarget(current)==routeGraph.GetPathSource(prev)) {
+          continue;
+        }
+
+        // A route entering a restricted path cannot leave the restricted area
+        if (routeGraph.IsPathRestricted(prev,vehicle) &&
+            currentAccess) {
+          continue;
+        }
+
+        if (!CanUse(profile,
+                    dbId,
+                    routeGraph,
+                    prev)) {
+          continue;
+        }
+
+        if (routeGraph.IsExcluded(node,
+                                  routeGraph.GetPathObject(prev),
+                                  current)) {
+          continue;
+        }
+
+        double cost=entry.first+GetCosts(profile,dbId,routeGraph,prev);
+        auto   label=open.find(prev);
+
+        if (label==open.end() ||
+            cost<label->second.cost) {
+          open[prev]=TargetTree::PathLabel{cost,current};
+          heap.push_back(GraphSearchEntry(cost,prev));
+          std::push_heap(heap.begin(),heap.end(),std::greater<GraphSearchEntry>());
+        }
+      }
+    }
+
+    clock.Stop();
+
+    if (debugPerformance) {
+      log.Info() << "Target tree " << tree->paths.size() << " of " << tree->pathCount << " path(s): " << clock.ResultString();
+    }
+
+    return tree;
+  }
+
+  /**
+   * Calculate a route from the given start to the target of the given tree (see
+   * CalculateTargetTree()), for example after leaving the previous route to the
+   * target. Only the start way is loaded from file, the route itself is looked up
+   * in the tree. If the start is outside of the cost limit of the tree, so that the
+   * tree cannot prove the route to be the cheapest one, the route is calculated by
+   * CalculateRoute() instead.
+   *
+   * @param profile
+   *    Profile to use, must be the profile the tree was calculated with
+   * @param start
+   *    Start of the route
+   * @param tree
+   *    Tree of the routes to the target
+   * @param parameter
+   *    Optional breaker
+   * @return
+   *    The result, holding the route on success
+   */
+  RoutingResult SimpleRoutingService::Reroute(RoutingProfile& profile,
+                                              const RoutePosition& start,
+                                              const TargetTree& tree,
+                                              const RoutingParameter& parameter)
+  {
+    RoutingResult result;
+    DatabaseId    dbId=start.GetDatabaseId();
+    GeoCoord      startCoord;
+    RouteNodeRef  startForwardRouteNode;
+    RouteNodeRef  startBackwardRouteNode;
+    RNodeRef      startForwardNode;
+    RNodeRef      startBackwardNode;
+
+    if (!LoadRouteGraph()) {
+      return result;
+    }
+
+    if (tree.pathCount!=routeGraph.GetPathCount()) {
+      log.Error() << "Target tree does not match the route graph";
+      return result;
+    }
+
+    if (!GetStartNodes(profile,
+                       start,
+                       startCoord,
+                       tree.targetCoord,
+                       startForwardRouteNode,
+                       startBackwardRouteNode,
+                       startForwardNode,
+                       startBackwardNode)) {
+      return result;
+    }
+
+    if (parameter.GetBreaker() &&
+        parameter.GetBreaker()->IsAborted()) {
+      return result;
+    }
+
+    RNodeRef startNode;
+    uint32_t startGraphNode=RouteGraph::INVALID_NODE;
+    uint32_t firstPath=TargetTree::NO_PATH;
+    double   bestCost=std::numeric_limits<double>::infinity();
+    double   minStartCost=std::numeric_limits<double>::infinity();
+
+    for (const RNodeRef& node : {startForwardNode,startBackwardNode}) {
+      if (!node) {
+        continue;
+      }
+
+      minStartCost=std::min(minStartCost,node->currentCost);
+
+      uint32_t graphNode=routeGraph.GetNode(node->nodeOffset.offset);
+
+      if (graphNode==RouteGraph::INVALID_NODE) {
+        log.Error() << "Cannot find route node " << node->nodeOffset.offset << " in route graph";
+        return result;
+      }
+
+      if (tree.IsTargetNode(graphNode)) {
+        if (node->currentCost<bestCost) {
+          bestCost=node->currentCost;
+          startNode=node;
+          startGraphNode=graphNode;
+          firstPath=TargetTree::NO_PATH;
+        }
+
+        continue;
+      }
+
+      for (uint32_t path=routeGraph.GetFirstPath(graphNode); path<routeGraph.GetLastPath(graphNode); path++) {
+        if (!node->access &&
+            !routeGraph.IsPathRestricted(path,profile.GetVehicle())) {
+          continue;
+        }
+
+        if (routeGraph.IsExcluded(graphNode,
+                                  node->object,
+                                  path)) {
+          continue;
+        }
+
+        auto label=tree.paths.find(path);
+
+        if (label==tree.paths.end()) {
+          continue;
+        }
+
+        double cost=node->currentCost+label->second.cost;
+
+        if (cost<bestCost) {
+          bestCost=cost;
+          startNode=node;
+          startGraphNode=graphNode;
+          firstPath=path;
+        }
+      }
+    }
+
+    // Every path not in the tree costs more than the cost limit, so a route using
+    // one of them would cost more than minStartCost+costLimit
+    if (!startNode ||
+        bestCost>minStartCost+tree.costLimit) {
+      if (debugPerformance) {
+        log.Info() << "Start is outside of the target tree, calculating the route";
+      }
+
+      return CalculateRoute(profile,
+                            start,
+                            tree.target,
+                            parameter);
+    }
+
+    result.SetOverallDistance(GetSphericalDistance(startCoord,
+                                                   tree.targetCoord));
+    result.SetCurrentMaxDistance(result.GetOverallDistance());
+
+    std::list<VNode> routeNodes;
+
+    routeNodes.push_back(VNode(DBFileOffset(dbId,routeGraph.GetNodeOffset(startGraphNode)),
+                               startNode->object,
+                               DBFileOffset()));
+
+    for (uint32_t path=firstPath; path!=TargetTree::NO_PATH; path=tree.paths.find(path)->second.next) {
+      routeNodes.push_back(VNode(DBFileOffset(dbId,routeGraph.GetNodeOffset(routeGraph.GetPathTarget(path))),
+                                 routeGraph.GetPathObject(path),
+                                 routeNodes.back().currentNode));
+    }
+
+    if (debugPerformance) {
+      log.Info() << "Reroute cost " << bestCost << ", " << routeNodes.size() << " route node(s)";
+    }
+
+    if (!ResolveRNodesToRouteData(profile,
+                                  routeNodes,
+                                  start,
+                                  tree.target,
+                                  result.GetRoute())) {
+      return result;
+    }
+
+    ResolveRouteDataJunctions(result.GetRoute());
+
+    return result;
+  }
+
+  /**
+   * Calculate the costs, the distance and the duration of the cheapest routes from
+   * each source to each target.
+   *
+   * Instead of calculating each route on its own, one bucket based one-to-many
+   * search is done per source on the in memory route graph, the route nodes next
+   * to the targets are only resolved once and no route description is built. The
+   * sources are distributed over RoutingParameter::GetThreadCount() threads. If
+   * the route graph has not been loaded on Open() (see
+   * RouterParameter::SetInMemoryGraph()), it is loaded now.
+   *
+   * The progress callback of the parameter is not called, the breaker is checked
+   * before each source.
+   *
+   * @param profile
+   *    Profile to use
+   * @param sources
+   *    Start positions
+   * @param targets
+   *    Target positions
+   * @param parameter
+   *    Optional breaker and number of threads
+   * @return
+   *    The matrix with one row per source and one column per target, empty on
+   *    error or if aborted
+   */
+  RoutingMatrixResult SimpleRoutingService::CalculateMatrix(const RoutingProfile& profile,
+                                                            const std::vector<RoutePosition>& sources,
+                                                            const std::vector<RoutePosition>& targets,
+                                                            const RoutingParameter& parameter)
+  {
+    RoutingMatrixResult result;
+
+    if (!LoadRouteGraph()) {
+      return result;
+    }
+
+    StopClock                              clock;
+    MatrixTargets                          matrixTargets;
+    std::vector<std::vector<MatrixAnchor>> sourceAnchors(sources.size());
+    std::vector<GeoCoord>                  sourceCoords(sources.size());
+
+    result.Initialize(sources.size(),
+                      targets.size());
+
+    // Anchors of positions that are not routable stay empty, their rows and
+    // columns stay unreachable
+    for (size_t source=0; source<sources.size(); source++) {
+      GetMatrixAnchors(profile,
+                       sources[source],
+                       source,
+                       true,
+                       sourceCoords[source],
+                       sourceAnchors[source]);
+    }
+
+    matrixTargets.coords.resize(targets.size());
+
+    for (size_t target=0; target<targets.size(); target++) {
+      GetMatrixAnchors(profile,
+                       targets[target],
+                       target,
+                       false,
+                       matrixTargets.coords[target],
+                       matrixTargets.anchors);
+    }
+
+    std::sort(matrixTargets.anchors.begin(),
+              matrixTargets.anchors.end(),
+              [](const MatrixAnchor& a,
+                 const MatrixAnchor& b) {
+                return a.node<b.node;
+              });
+
+    matrixTargets.bucketNodes.assign(routeGraph.GetNodeCount(),false);
+    matrixTargets.bucketCount=0;
+
+    for (const auto& anchor : matrixTargets.anchors) {
+      if (!matrixTargets.bucketNodes[anchor.node]) {
+        matrixTargets.bucketNodes[anchor.node]=true;
+        matrixTargets.bucketCount++;
+      }
+    }
+
+    size_t threadCount=GetWorkerCount(parameter,
+                                      sources.size());
+
+    std::atomic<size_t> nextSource(0);
+    std::atomic<bool>   aborted(false);
+
+    auto worker=[&]() {
+      MatrixSearch search;
+      size_t       source;
+
+      while ((source=nextSource++)<sources.size()) {
+        if (parameter.GetBreaker() &&
+            parameter.GetBreaker()->IsAborted()) {
+          aborted=true;
+          return;
+        }
+
+        CalculateMatrixRow(profile,
+                           matrixTargets,
+                           source,
+                           sources[source],
+                           sourceAnchors[source],
+                           sourceCoords[source],
+                           search,
+                           result);
+      }
+    };
+
+    std::vector<std::thread> threads;
+
+    for (size_t i=1; i<threadCount; i++) {
+      threads.push_back(std::thread(worker));
+    }
+
+    worker();
+
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    clock.Stop();
+
+    if (aborted) {
+      return RoutingMatrixResult();
+    }
+
+    if (debugPerformance) {
+      log.Info() << "Matrix " << sources.size() << "x" << targets.size() << ": " << clock.ResultString() << " using " << threadCount << " thread(s)";
+    }
+
+    return result;
+  }
+
   void SimpleRoutingService::DumpStatistics()
   {
     if (database) {
@@ -513,6 +1602,24 @@ namespace osmscout {
                                                              const RoutingProfile& profile,
                                                              double& radius) const
   {
+    if (segmentIndex.IsLoaded()) {
+      RoutePosition     position;
+      RouteSegmentMatch match;
+
+      if (GetClosestRoutableSegment(coord,
+                                    profile,
+                                    radius,
+                                    match)) {
+        position=RoutePosition(match.object,match.nodeIndex,/*database*/0);
+        radius=match.distance;
+      }
+      else {
+        radius=std::numeric_limits<double>::max();
+      }
+
+      return position;
+    }
+
     TypeConfigRef    typeConfig=database->GetTypeConfig();
     AreaAreaIndexRef areaAreaIndex=database->GetAreaAreaIndex();
     AreaWayIndexRef  areaWayIndex=database->GetAreaWayIndex();
@@ -639,4 +1746,37 @@ namespace osmscout {
     radius = minDistance;
     return position;
   }
+
+  /**
+   * Return the closest segment of a routable way to the given position together
+   * with the projection of the position onto the segment. Uses the segment index
+   * of the routable ways (see RouterParameter::SetSegmentIndex()) and so does not
+   * load any ways.
+   *
+   * @param coord
+   *    coordinate of the search center
+   * @param profile
+   *    Routing profile to use. It defines Vehicle to use
+   * @param radius
+   *    The maximum radius to search in from the search center in meter
+   * @param match
+   *    The closest segment on success
+   * @return
+   *    true, if a segment was found, false if there is no segment index or no
+   *    routable segment within the radius
+   */
+  bool SimpleRoutingService::GetClosestRoutableSegment(const GeoCoord& coord,
+                                                       const RoutingProfile& profile,
+                                                       double radius,
+                                                       RouteSegmentMatch& match) const
+  {
+    if (!segmentIndex.IsLoaded()) {
+      return false;
+    }
+
+    return segmentIndex.GetClosestSegment(coord,
+                                          GeoBox::BoxByCenterAndRadius(coord,radius),
+                                          profile,
+                                          match);
+  }
 }
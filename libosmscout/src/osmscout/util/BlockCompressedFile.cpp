@@ -0,0 +1,504 @@
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2017  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/util/BlockCompressedFile.h>
+
+#include <osmscout/private/Config.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#if defined(HAVE_LIB_ZLIB)
+  #include <zlib.h>
+#endif
+
+#include <osmscout/util/Exception.h>
+#include <osmscout/util/File.h>
+#include <osmscout/util/FileScanner.h>
+#include <osmscout/util/FileWriter.h>
+#include <osmscout/util/Number.h>
+#include <osmscout/util/String.h>
+
+#include <osmscout/system/Assert.h>
+
+namespace osmscout {
+
+  const char   BlockCompressedFileReader::MAGIC[8]={'O','S','M','S','B','C','F','1'};
+  const size_t BlockCompressedFileReader::DEFAULT_BLOCK_SIZE=64*1024;
+  const size_t BlockCompressedFileReader::MAX_BLOCK_SIZE=std::numeric_limits<uint32_t>::max();
+  const size_t BlockCompressedFileReader::DEFAULT_CACHE_MEMORY=4*1024*1024;
+
+  static const size_t HEADER_SIZE=8+4+8+4;
+
+  static bool SeekFile(std::FILE* file,
+                       FileOffset pos)
+  {
+#if defined(HAVE_FSEEKO)
+    return fseeko(file,(off_t)pos,SEEK_SET)==0;
+#elif defined(HAVE__FSEEKI64)
+    return _fseeki64(file,(__int64)pos,SEEK_SET)==0;
+#else
+    return fseek(file,(long)pos,SEEK_SET)==0;
+#endif
+  }
+
+  static uint64_t DecodeNumber(const unsigned char* buffer,
+                               size_t bytes)
+  {
+    uint64_t number=0;
+
+    for (size_t i=0; i<bytes; i++) {
+      number|=((uint64_t)buffer[i]) << (i*8);
+    }
+
+    return number;
+  }
+
+  BlockCompressedFileCache::BlockCompressedFileCache(size_t cacheMemory)
+  : cache(cacheMemory>0 ? BlockCache::NO_SIZE_LIMIT : 0,
+          cacheMemory)
+  {
+    // no code
+  }
+
+  BlockCompressedFileCache::~BlockCompressedFileCache()
+  {
+    Flush();
+
+    if (cacheManager) {
+      cacheManager->Unregister(*this);
+    }
+  }
+
+  /**
+   * Register the cache with the given cache manager (or unregister from the current
+   * cache manager, if an empty reference is passed).
+   *
+   * Method is NOT thread-safe and must be called while the cache is empty.
+   */
+  void BlockCompressedFileCache::SetCacheManager(const CacheManagerRef& cacheManager)
+  {
+    assert(GetMemory()==0);
+
+    if (this->cacheManager) {
+      this->cacheManager->Unregister(*this);
+    }
+
+    this->cacheManager=cacheManager;
+
+    if (this->cacheManager) {
+      this->cacheManager->Register(*this);
+    }
+  }
+
+  size_t BlockCompressedFileCache::TrimCache(size_t memory)
+  {
+    std::lock_guard<std::mutex> guard(mutex);
+
+    return cache.Trim(memory);
+  }
+
+  /**
+   * Lookup the inflated block with the given index. Returns false, if the block
+   * is not cached.
+   *
+   * Method is thread-safe.
+   */
+  bool BlockCompressedFileCache::GetBlock(size_t index,
+                                          BlockRef& block)
+  {
+    bool found;
+
+    {
+      std::lock_guard<std::mutex> guard(mutex);
+      BlockCache::CacheRef        cacheRef;
+
+      found=cache.GetEntry(index,cacheRef);
+
+      if (found) {
+        block=cacheRef->value;
+      }
+    }
+
+    if (found &&
+        cacheManager) {
+      cacheManager->Touch(*this);
+    }
+
+    return found;
+  }
+
+  /**
+   * Store the inflated block with the given index, possibly evicting other blocks.
+   *
+   * Method is thread-safe.
+   */
+  void BlockCompressedFileCache::StoreBlock(size_t index,
+                                            const BlockRef& block)
+  {
+    size_t memoryBefore;
+    size_t memoryAfter;
+
+    {
+      std::lock_guard<std::mutex> guard(mutex);
+
+      memoryBefore=cache.GetMemory();
+      cache.SetEntry(BlockCache::CacheEntry(index,block),
+                     sizeof(std::vector<char>)+block->capacity());
+      memoryAfter=cache.GetMemory();
+    }
+
+    // Must be called without holding the lock, since the cache manager might trim us
+    if (cacheManager) {
+      if (memoryAfter>memoryBefore) {
+        cacheManager->Allocate(*this,
+                               memoryAfter-memoryBefore);
+      }
+      else if (memoryAfter<memoryBefore) {
+        cacheManager->Free(memoryBefore-memoryAfter);
+      }
+    }
+  }
+
+  /**
+   * Remove all blocks from the cache.
+   *
+   * Method is thread-safe.
+   */
+  void BlockCompressedFileCache::Flush()
+  {
+    size_t memory;
+
+    {
+      std::lock_guard<std::mutex> guard(mutex);
+
+      memory=cache.GetMemory();
+      cache.Flush();
+    }
+
+    if (cacheManager) {
+      cacheManager->Free(memory);
+    }
+  }
+
+  /**
+   * Return the memory of all cached blocks.
+   *
+   * Method is thread-safe.
+   */
+  size_t BlockCompressedFileCache::GetMemory() const
+  {
+    std::lock_guard<std::mutex> guard(mutex);
+
+    return cache.GetMemory();
+  }
+
+  /**
+   * Create a reader for the given file. If no block cache is passed the reader uses
+   * a private cache of DEFAULT_CACHE_MEMORY bytes.
+   */
+  BlockCompressedFileReader::BlockCompressedFileReader(const std::string& filename,
+                                                       std::FILE* file,
+                                                       const BlockCompressedFileCacheRef& blockCache)
+  : filename(filename),
+    file(file),
+    blockSize(0),
+    size(0),
+    blockCache(blockCache),
+    currentBlockIndex(0),
+    inflatedBlocks(0),
+    compressedBytesRead(0)
+  {
+    if (!this->blockCache) {
+      this->blockCache=std::make_shared<BlockCompressedFileCache>(DEFAULT_CACHE_MEMORY);
+    }
+  }
+
+  /**
+   * Check if the file starts with the magic of a block compressed file. Sets
+   * the file position back to the start of the file.
+   */
+  bool BlockCompressedFileReader::IsBlockCompressed(std::FILE* file)
+  {
+    char magic[sizeof(MAGIC)];
+    bool result=fread(magic,1,sizeof(MAGIC),file)==sizeof(MAGIC) &&
+                memcmp(magic,MAGIC,sizeof(MAGIC))==0;
+
+    clearerr(file);
+    SeekFile(file,0);
+
+    return result;
+  }
+
+  /**
+   * Returns true, if the given block size can be stored in the file header. Blocks
+   * must not be empty and the header stores the block size in 32 bit.
+   */
+  bool BlockCompressedFileReader::IsValidBlockSize(size_t blockSize)
+  {
+    return blockSize>0 &&
+           blockSize<=MAX_BLOCK_SIZE;
+  }
+
+  /**
+   * Read the header and the block offset table
+   *
+   * throws IOException on error
+   */
+  void BlockCompressedFileReader::Open()
+  {
+#if defined(HAVE_LIB_ZLIB)
+    unsigned char header[HEADER_SIZE];
+
+    if (!SeekFile(file,0) ||
+        fread(header,1,HEADER_SIZE,file)!=HEADER_SIZE ||
+        memcmp(header,MAGIC,sizeof(MAGIC))!=0) {
+      throw IOException(filename,"Cannot read block compressed file header");
+    }
+
+    blockSize=(size_t)DecodeNumber(&header[8],4);
+    size=(FileOffset)DecodeNumber(&header[12],8);
+
+    size_t blockCount=(size_t)DecodeNumber(&header[20],4);
+
+    if (blockSize==0 ||
+        blockCount!=(size+blockSize-1)/blockSize) {
+      throw IOException(filename,"Cannot read block compressed file header","Inconsistent block count");
+    }
+
+    std::vector<unsigned char> offsetBuffer((blockCount+1)*8);
+
+    if (fread(offsetBuffer.data(),1,offsetBuffer.size(),file)!=offsetBuffer.size()) {
+      throw IOException(filename,"Cannot read block offset table");
+    }
+
+    blockOffsets.resize(blockCount+1);
+
+    for (size_t i=0; i<=blockCount; i++) {
+      blockOffsets[i]=(FileOffset)DecodeNumber(&offsetBuffer[i*8],8);
+
+      if (i>0 && blockOffsets[i]<blockOffsets[i-1]) {
+        throw IOException(filename,"Cannot read block offset table","Block offsets not ascending");
+      }
+    }
+#else
+    throw IOException(filename,"Cannot open block compressed file","Library was built without zlib support");
+#endif
+  }
+
+  /**
+   * Return the inflated content of the block with the given index, either from
+   * the cache or by reading and inflating it.
+   *
+   * The returned reference is only valid until the next call.
+   *
+   * throws IOException on error
+   */
+  const std::vector<char>& BlockCompressedFileReader::GetBlock(size_t index)
+  {
+    // Fast path for consecutive reads from the same block. The reader holds a
+    // reference to the block, so it stays valid even if the cache evicts it.
+    if (currentBlock &&
+        currentBlockIndex==index) {
+      return *currentBlock;
+    }
+
+    currentBlock.reset();
+
+    if (blockCache->GetBlock(index,currentBlock)) {
+      currentBlockIndex=index;
+
+      return *currentBlock;
+    }
+
+#if defined(HAVE_LIB_ZLIB)
+    size_t compressedSize=(size_t)(blockOffsets[index+1]-blockOffsets[index]);
+    size_t uncompressedSize=(size_t)std::min((FileOffset)blockSize,
+                                             size-index*(FileOffset)blockSize);
+
+    compressedBuffer.resize(compressedSize);
+
+    if (!SeekFile(file,blockOffsets[index]) ||
+        fread(compressedBuffer.data(),1,compressedSize,file)!=compressedSize) {
+      throw IOException(filename,"Cannot read compressed block "+NumberToString(index));
+    }
+
+    uLongf                             inflatedSize=(uLongf)uncompressedSize;
+    std::shared_ptr<std::vector<char>> block=std::make_shared<std::vector<char>>(uncompressedSize);
+
+    // Inflated outside of the lock of the cache, so that other readers of the file
+    // are not blocked. The block is only cached after successful inflation.
+    if (uncompress((Bytef*)block->data(),
+                   &inflatedSize,
+                   (const Bytef*)compressedBuffer.data(),
+                   (uLong)compressedSize)!=Z_OK ||
+        inflatedSize!=uncompressedSize) {
+      throw IOException(filename,"Cannot inflate block "+NumberToString(index));
+    }
+
+    blockCache->StoreBlock(index,
+                           block);
+
+    inflatedBlocks++;
+    compressedBytesRead+=compressedSize;
+
+    currentBlockIndex=index;
+    currentBlock=block;
+
+    return *currentBlock;
+#else
+    throw IOException(filename,"Cannot inflate block "+NumberToString(index),"Library was built without zlib support");
+#endif
+  }
+
+  /**
+   * Copy up to the given number of bytes starting at the given offset into the
+   * uncompressed data to data. Returns the number of bytes copied, which is
+   * less than requested only at the end of the file.
+   *
+   * throws IOException on error
+   */
+  size_t BlockCompressedFileReader::Read(FileOffset pos,
+                                         void* data,
+                                         size_t bytes)
+  {
+    char   *target=static_cast<char*>(data);
+    size_t copied=0;
+
+    while (copied<bytes &&
+           pos<size) {
+      size_t                   index=(size_t)(pos/blockSize);
+      size_t                   blockOffset=(size_t)(pos%blockSize);
+      const std::vector<char>& block=GetBlock(index);
+      size_t                   count=std::min(bytes-copied,
+                                              block.size()-blockOffset);
+
+      memcpy(target+copied,
+             block.data()+blockOffset,
+             count);
+
+      copied+=count;
+      pos+=count;
+    }
+
+    return copied;
+  }
+
+  /**
+   * Returns true, if the library was built with support for block compressed files
+   */
+  bool IsBlockCompressionSupported()
+  {
+#if defined(HAVE_LIB_ZLIB)
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  /**
+   * Write a block compressed copy of the given source file. Both filenames must be different.
+   *
+   * throws IOException on error
+   */
+  void CompressFileInBlocks(const std::string& sourceFilename,
+                            const std::string& destinationFilename,
+                            size_t blockSize)
+  {
+#if defined(HAVE_LIB_ZLIB)
+    if (!BlockCompressedFileReader::IsValidBlockSize(blockSize)) {
+      throw IOException(destinationFilename,"Cannot write block compressed file","Invalid block size "+NumberToString(blockSize));
+    }
+
+    FileScanner scanner;
+    FileWriter  writer;
+
+    try {
+      FileOffset size=GetFileSize(sourceFilename);
+      size_t     blockCount=(size_t)((size+blockSize-1)/blockSize);
+
+      std::vector<FileOffset> blockOffsets;
+      std::vector<char>       block(blockSize);
+      std::vector<char>       compressedBlock(compressBound((uLong)blockSize));
+
+      blockOffsets.reserve(blockCount+1);
+
+      scanner.Open(sourceFilename,
+                   FileScanner::Sequential,
+                   false);
+
+      writer.Open(destinationFilename);
+
+      writer.Write(BlockCompressedFileReader::MAGIC,
+                   sizeof(BlockCompressedFileReader::MAGIC));
+      writer.Write((uint32_t)blockSize);
+      writer.Write((uint64_t)size);
+      writer.Write((uint32_t)blockCount);
+
+      FileOffset offsetTableOffset=writer.GetPos();
+
+      // Placeholder for the block offset table
+      for (size_t i=0; i<=blockCount; i++) {
+        writer.Write((uint64_t)0);
+      }
+
+      for (size_t i=0; i<blockCount; i++) {
+        size_t uncompressedSize=(size_t)std::min((FileOffset)blockSize,
+                                                 size-i*(FileOffset)blockSize);
+        uLongf compressedSize=(uLongf)compressedBlock.size();
+
+        scanner.Read(block.data(),
+                     uncompressedSize);
+
+        if (compress2((Bytef*)compressedBlock.data(),
+                      &compressedSize,
+                      (const Bytef*)block.data(),
+                      (uLong)uncompressedSize,
+                      Z_BEST_COMPRESSION)!=Z_OK) {
+          throw IOException(destinationFilename,"Cannot compress block "+NumberToString(i));
+        }
+
+        blockOffsets.push_back(writer.GetPos());
+
+        writer.Write(compressedBlock.data(),
+                     (size_t)compressedSize);
+      }
+
+      blockOffsets.push_back(writer.GetPos());
+
+      writer.SetPos(offsetTableOffset);
+
+      for (const auto offset : blockOffsets) {
+        writer.Write((uint64_t)offset);
+      }
+
+      scanner.Close();
+      writer.Close();
+    }
+    catch (IOException& /*e*/) {
+      scanner.CloseFailsafe();
+      writer.CloseFailsafe();
+      throw;
+    }
+#else
+    throw IOException(destinationFilename,"Cannot write block compressed file","Library was built without zlib support");
+#endif
+  }
+}
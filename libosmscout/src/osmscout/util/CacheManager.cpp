@@ -0,0 +1,123 @@
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2017  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/util/CacheManager.h>
+
+#include <algorithm>
+
+namespace osmscout {
+
+  CacheManager::Client::Client()
+  : lastAccess(0)
+  {
+    // no code
+  }
+
+  CacheManager::CacheManager(size_t maxMemory)
+  : maxMemory(maxMemory),
+    memory(0),
+    accessClock(0)
+  {
+    // no code
+  }
+
+  /**
+   * Register the client with the cache manager. From now on the client
+   * might get trimmed.
+   */
+  void CacheManager::Register(Client& client)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    client.lastAccess=accessClock.load();
+    clients.push_back(&client);
+  }
+
+  /**
+   * Unregister the client. The client must have freed all its memory
+   * before (see Free()).
+   */
+  void CacheManager::Unregister(Client& client)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    clients.erase(std::remove(clients.begin(),
+                              clients.end(),
+                              &client),
+                  clients.end());
+  }
+
+  /**
+   * Trim the least recently accessed clients until the overall memory
+   * is within the budget again.
+   *
+   * Must be called with the mutex locked.
+   */
+  void CacheManager::TrimClients()
+  {
+    std::vector<Client*> candidates(clients);
+
+    std::sort(candidates.begin(),
+              candidates.end(),
+              [](const Client* a, const Client* b) {
+                return a->lastAccess.load(std::memory_order_relaxed)<b->lastAccess.load(std::memory_order_relaxed);
+              });
+
+    for (Client* client : candidates) {
+      size_t currentMemory=memory;
+
+      if (currentMemory<=maxMemory) {
+        return;
+      }
+
+      Free(client->TrimCache(currentMemory-maxMemory));
+    }
+  }
+
+  /**
+   * Report that the client allocated the given memory. If the budget is exceeded
+   * as a result, the least recently accessed clients (possibly including the given client)
+   * are trimmed.
+   */
+  void CacheManager::Allocate(const Client& client,
+                              size_t memory)
+  {
+    client.lastAccess.store(++accessClock,
+                            std::memory_order_relaxed);
+
+    if ((this->memory+=memory)<=maxMemory) {
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Another thread might have trimmed already
+    if (this->memory>maxMemory) {
+      TrimClients();
+    }
+  }
+
+  /**
+   * Report that a client freed the given memory.
+   */
+  void CacheManager::Free(size_t memory)
+  {
+    this->memory-=memory;
+  }
+}
@@ -0,0 +1,82 @@
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2017  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/util/CoordBlockView.h>
+
+#include <algorithm>
+
+namespace osmscout {
+
+  /**
+   * Return the bounding box of all coordinates in the block
+   */
+  GeoBox CoordBlockView::GetBoundingBox() const
+  {
+    if (nodeCount==0) {
+      return GeoBox();
+    }
+
+    double minLat=90.0;
+    double maxLat=-90.0;
+    double minLon=180.0;
+    double maxLon=-180.0;
+
+    for (const auto coord : *this) {
+      minLat=std::min(minLat,coord.GetLat());
+      maxLat=std::max(maxLat,coord.GetLat());
+      minLon=std::min(minLon,coord.GetLon());
+      maxLon=std::max(maxLon,coord.GetLon());
+    }
+
+    return GeoBox(GeoCoord(minLat,minLon),
+                  GeoCoord(maxLat,maxLon));
+  }
+
+  /**
+   * Decode all coordinates of the block into the given vector. The vector is
+   * resized to the number of coordinates.
+   */
+  void CoordBlockView::Decode(std::vector<GeoCoord>& coords) const
+  {
+    coords.resize(nodeCount);
+
+    size_t idx=0;
+
+    for (const auto coord : *this) {
+      coords[idx]=coord;
+      idx++;
+    }
+  }
+
+  /**
+   * Decode all coordinates of the block into the given vector. The vector is
+   * resized to the number of coordinates. Serials of the points are reset to 0.
+   */
+  void CoordBlockView::Decode(std::vector<Point>& points) const
+  {
+    points.resize(nodeCount);
+
+    size_t idx=0;
+
+    for (const auto coord : *this) {
+      points[idx].Set(0,coord);
+      idx++;
+    }
+  }
+}
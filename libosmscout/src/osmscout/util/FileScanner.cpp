@@ -52,14 +52,59 @@
 #include <osmscout/util/Number.h>
 #include <osmscout/util/String.h>
 
+#if defined(OSMSCOUT_HAVE_SSE2)
+#include <osmscout/system/SSEMath.h>
+#endif
+
 namespace osmscout {
 
+  /**
+   * Number of coordinates decoded in one go from a columnar coordinate block
+   */
+  static const size_t COLUMNAR_DECODE_CHUNK_SIZE=64;
+
+  /**
+   * Decode a column of count little endian, signed deltas with the given number of bytes
+   * each and convert the resulting raw values to degrees.
+   *
+   * value is the raw value before the first delta and returns the raw value
+   * after the last delta.
+   */
+  static inline void DecodeDeltaColumn(const uint8_t* deltas,
+                                       size_t bytes,
+                                       size_t count,
+                                       uint32_t& value,
+                                       double conversionFactor,
+                                       double offset,
+                                       double* coords)
+  {
+    size_t i=0;
+
+#if defined(OSMSCOUT_HAVE_SSE2)
+    i=decode_delta_column_pd(deltas,
+                             bytes,
+                             count,
+                             value,
+                             conversionFactor,
+                             offset,
+                             coords);
+#endif
+
+    for (; i<count; i++) {
+      value+=CoordBlockView::DecodeDelta(&deltas[i*bytes],
+                                         bytes);
+
+      coords[i]=value/conversionFactor-offset;
+    }
+  }
+
   FileScanner::FileScanner()
    : file(NULL),
      hasError(true),
      buffer(NULL),
      size(0),
      offset(0),
+     compressedReader(NULL),
      byteBuffer(NULL),
      byteBufferSize(0)
 #if defined(_WIN32)
@@ -114,6 +159,47 @@ namespace osmscout {
 #endif
   }
 
+  /**
+   * Read the given number of bytes at the current position, either from the file or,
+   * for block compressed files, from the uncompressed data. Returns the number of
+   * bytes read, a number smaller than requested signals an error.
+   */
+  inline size_t FileScanner::ReadFromFile(void* data,
+                                          size_t bytes)
+  {
+    if (compressedReader!=NULL) {
+      try {
+        size_t bytesRead=compressedReader->Read(offset,
+                                                data,
+                                                bytes);
+
+        offset+=bytesRead;
+
+        return bytesRead;
+      }
+      catch (IOException& e) {
+        log.Error() << e.GetDescription();
+        return 0;
+      }
+    }
+
+    return fread(data,1,bytes,file);
+  }
+
+  /**
+   * Set the cache for inflated blocks to be used, if the file is block compressed.
+   * Scanners of the same file can share one cache. If no cache is set, every scanner
+   * of a block compressed file uses its own private cache.
+   *
+   * Must be called before the file is opened.
+   */
+  void FileScanner::SetBlockCache(const BlockCompressedFileCacheRef& blockCache)
+  {
+    assert(!IsOpen());
+
+    this->blockCache=blockCache;
+  }
+
   void FileScanner::Open(const std::string& filename,
                          Mode mode,
                          bool useMmap)
@@ -190,6 +276,20 @@ namespace osmscout {
     }
 #endif
 
+    if (BlockCompressedFileReader::IsBlockCompressed(file)) {
+      compressedReader=new BlockCompressedFileReader(filename,
+                                                     file,
+                                                     blockCache);
+
+      compressedReader->Open();
+
+      this->size=compressedReader->GetSize();
+      offset=0;
+      hasError=false;
+
+      return;
+    }
+
 #if defined(HAVE_POSIX_FADVISE)
     if (mode==FastRandom) {
       if (posix_fadvise(fileno(file),0,size,POSIX_FADV_WILLNEED)<0) {
@@ -286,6 +386,8 @@ namespace osmscout {
     }
 
     FreeBuffer();
+    delete compressedReader;
+    compressedReader=NULL;
 
     if (fclose(file)!=0) {
       file=NULL;
@@ -309,6 +411,8 @@ namespace osmscout {
     }
 
     FreeBuffer();
+    delete compressedReader;
+    compressedReader=NULL;
 
     fclose(file);
 
@@ -331,6 +435,10 @@ namespace osmscout {
     }
 #endif
 
+    if (compressedReader!=NULL) {
+      return offset>=size;
+    }
+
     return feof(file)!=0;
   }
 
@@ -373,6 +481,17 @@ namespace osmscout {
     }
 #endif
 
+    if (compressedReader!=NULL) {
+      if (pos>size) {
+        hasError=true;
+        throw IOException(filename,"Cannot set position in file to "+NumberToString(pos),"Position beyond file end");
+      }
+
+      offset=pos;
+
+      return;
+    }
+
     clearerr(file);
 
 #if defined(HAVE_FSEEKO)
@@ -388,6 +507,51 @@ namespace osmscout {
     }
   }
 
+  /**
+   * Hint the operating system, that the given range of the file will be read soon,
+   * so that it can start reading the data in the background. Does not change the
+   * current position. This is only a hint, failures are silently ignored.
+   */
+  void FileScanner::Prefetch(FileOffset pos,
+                             FileOffset length)
+  {
+    if (HasError() ||
+        pos>=size ||
+        length==0) {
+      return;
+    }
+
+    if (pos+length>size) {
+      length=size-pos;
+    }
+
+    // Compressed blocks get inflated on access
+    if (compressedReader!=NULL) {
+      return;
+    }
+
+#if defined(HAVE_MMAP) && defined(HAVE_POSIX_MADVISE)
+    if (buffer!=NULL) {
+      static const FileOffset pageSize=(FileOffset)sysconf(_SC_PAGESIZE);
+
+      FileOffset alignedPos=pos-pos%pageSize;
+
+      posix_madvise(&buffer[alignedPos],
+                    (size_t)(length+pos-alignedPos),
+                    POSIX_MADV_WILLNEED);
+
+      return;
+    }
+#endif
+
+#if defined(HAVE_POSIX_FADVISE)
+    posix_fadvise(fileno(file),
+                  (off_t)pos,
+                  (off_t)length,
+                  POSIX_FADV_WILLNEED);
+#endif
+  }
+
   /**
    * Returns the current position of the reading cursor in relation to the begining of the file
    *
@@ -405,6 +569,10 @@ namespace osmscout {
     }
 #endif
 
+    if (compressedReader!=NULL) {
+      return offset;
+    }
+
 #if defined(HAVE_FSEEKO)
     off_t filepos=ftello(file);
 
@@ -456,7 +624,7 @@ namespace osmscout {
     }
 #endif
 
-    hasError=fread(buffer,1,bytes,file)!=bytes;
+    hasError=ReadFromFile(buffer,bytes)!=bytes;
 
     if (hasError) {
       throw IOException(filename,"Cannot read byte array");
@@ -500,7 +668,7 @@ namespace osmscout {
 
     char character;
 
-    hasError=fread(&character,1,1,file)!=1;
+    hasError=ReadFromFile(&character,1)!=1;
 
     if (hasError) {
       throw IOException(filename,"Cannot read string");
@@ -509,7 +677,7 @@ namespace osmscout {
     while (character!='\0') {
       value.append(1,character);
 
-      hasError=fread(&character,1,1,file)!=1;
+      hasError=ReadFromFile(&character,1)!=1;
 
       if (hasError) {
         throw IOException(filename,"Cannot read string");
@@ -540,7 +708,7 @@ namespace osmscout {
 
     char value;
 
-    hasError=fread(&value,1,1,file)!=1;
+    hasError=ReadFromFile(&value,1)!=1;
 
     if (hasError) {
       throw IOException(filename,"Cannot read bool");
@@ -572,7 +740,7 @@ namespace osmscout {
     }
 #endif
 
-    hasError=fread(&number,1,1,file)!=1;
+    hasError=ReadFromFile(&number,1)!=1;
 
     if (hasError) {
       throw IOException(filename,"Cannot read int8_t");
@@ -614,7 +782,7 @@ namespace osmscout {
 
     unsigned char buffer[2];
 
-    hasError=fread(&buffer,1,2,file)!=2;
+    hasError=ReadFromFile(&buffer,2)!=2;
 
     if (hasError) {
       throw IOException(filename,"Cannot read int16_t");
@@ -678,7 +846,7 @@ namespace osmscout {
 
     unsigned char buffer[4];
 
-    hasError=fread(&buffer,1,4,file)!=4;
+    hasError=ReadFromFile(&buffer,4)!=4;
 
     if (hasError) {
       throw IOException(filename,"Cannot read int32_t");
@@ -772,7 +940,7 @@ namespace osmscout {
 
     unsigned char buffer[8];
 
-    hasError=fread(&buffer,1,8,file)!=8;
+    hasError=ReadFromFile(&buffer,8)!=8;
 
     if (hasError) {
       throw IOException(filename,"Cannot read int64_t");
@@ -844,7 +1012,7 @@ namespace osmscout {
     }
 #endif
 
-    hasError=fread(&number,1,1,file)!=1;
+    hasError=ReadFromFile(&number,1)!=1;
 
     if (hasError) {
       throw IOException(filename,"Cannot read uint8_t");
@@ -886,7 +1054,7 @@ namespace osmscout {
 
     unsigned char buffer[2];
 
-    hasError=fread(&buffer,1,2,file)!=2;
+    hasError=ReadFromFile(&buffer,2)!=2;
 
     if (hasError) {
       throw IOException(filename,"Cannot read int16_t");
@@ -950,7 +1118,7 @@ namespace osmscout {
 
     unsigned char buffer[4];
 
-    hasError=fread(&buffer,1,4,file)!=4;
+    hasError=ReadFromFile(&buffer,4)!=4;
 
     if (hasError) {
       throw IOException(filename,"Cannot read int32_t");
@@ -1044,7 +1212,7 @@ namespace osmscout {
 
     unsigned char buffer[8];
 
-    hasError=fread(&buffer,1,8,file)!=8;
+    hasError=ReadFromFile(&buffer,8)!=8;
 
     if (hasError) {
       throw IOException(filename,"Cannot read int64_t");
@@ -1131,7 +1299,7 @@ namespace osmscout {
 
     unsigned char buffer[2];
 
-    hasError=fread(&buffer,1,bytes,file)!=bytes;
+    hasError=ReadFromFile(&buffer,bytes)!=bytes;
 
     if (hasError) {
       throw IOException(filename,"Cannot read size limited uint16_t");
@@ -1204,7 +1372,7 @@ namespace osmscout {
 
     unsigned char buffer[4];
 
-    hasError=fread(&buffer,1,bytes,file)!=bytes;
+    hasError=ReadFromFile(&buffer,bytes)!=bytes;
 
     if (hasError) {
       throw IOException(filename,"Cannot read size limited uint32_t");
@@ -1319,7 +1487,7 @@ namespace osmscout {
 
     unsigned char buffer[8];
 
-    hasError=fread(&buffer,1,bytes,file)!=bytes;
+    hasError=ReadFromFile(&buffer,bytes)!=bytes;
 
     if (hasError) {
       throw IOException(filename,"Cannot read size limited uint64_t");
@@ -1458,7 +1626,7 @@ namespace osmscout {
 
     unsigned char buffer[8];
 
-    hasError=fread(&buffer,1,8,file)!=8;
+    hasError=ReadFromFile(&buffer,8)!=8;
 
     if (hasError) {
       throw IOException(filename,"Cannot read file offset");
@@ -1589,7 +1757,7 @@ namespace osmscout {
 
     unsigned char buffer[8];
 
-    hasError=fread(&buffer,1,bytes,file)!=bytes;
+    hasError=ReadFromFile(&buffer,bytes)!=bytes;
 
     if (hasError) {
       throw IOException(filename,"Cannot read file offset");
@@ -1677,7 +1845,7 @@ namespace osmscout {
 
     char buffer;
 
-    if (fread(&buffer,1,1,file)!=1) {
+    if (ReadFromFile(&buffer,1)!=1) {
       hasError=true;
       throw IOException(filename,"Cannot read int16_t number");
     }
@@ -1696,7 +1864,7 @@ namespace osmscout {
 
       while ((buffer & 0x80)!=0) {
 
-        if (fread(&buffer,1,1,file)!=1) {
+        if (ReadFromFile(&buffer,1)!=1) {
           hasError=true;
           throw IOException(filename,"Cannot read int16_t number");
         }
@@ -1717,7 +1885,7 @@ namespace osmscout {
 
       while ((buffer & 0x80)!=0) {
 
-        if (fread(&buffer,1,1,file)!=1) {
+        if (ReadFromFile(&buffer,1)!=1) {
           hasError=true;
           throw IOException(filename,"Cannot read int16_t number");
         }
@@ -1757,7 +1925,7 @@ namespace osmscout {
 
     char buffer;
 
-    if (fread(&buffer,1,1,file)!=1) {
+    if (ReadFromFile(&buffer,1)!=1) {
       hasError=true;
       throw IOException(filename,"Cannot read int32_t number");
     }
@@ -1777,7 +1945,7 @@ namespace osmscout {
 
       while ((buffer & 0x80)!=0) {
 
-        if (fread(&buffer,1,1,file)!=1) {
+        if (ReadFromFile(&buffer,1)!=1) {
           hasError=true;
           throw IOException(filename,"Cannot read int32_t number");
         }
@@ -1798,7 +1966,7 @@ namespace osmscout {
 
       while ((buffer & 0x80)!=0) {
 
-        if (fread(&buffer,1,1,file)!=1) {
+        if (ReadFromFile(&buffer,1)!=1) {
           hasError=true;
           throw IOException(filename,"Cannot read int32_t number");
         }
@@ -1838,7 +2006,7 @@ namespace osmscout {
 
     char buffer;
 
-    if (fread(&buffer,1,1,file)!=1) {
+    if (ReadFromFile(&buffer,1)!=1) {
       hasError=true;
       throw IOException(filename,"Cannot read int64_t number");
     }
@@ -1857,7 +2025,7 @@ namespace osmscout {
 
       while ((buffer & 0x80)!=0) {
 
-        if (fread(&buffer,1,1,file)!=1) {
+        if (ReadFromFile(&buffer,1)!=1) {
           hasError=true;
           throw IOException(filename,"Cannot read int64_t number");
         }
@@ -1878,7 +2046,7 @@ namespace osmscout {
 
       while ((buffer & 0x80)!=0) {
 
-        if (fread(&buffer,1,1,file)!=1) {
+        if (ReadFromFile(&buffer,1)!=1) {
           hasError=true;
           throw IOException(filename,"Cannot read int64_t number");
         }
@@ -1923,7 +2091,7 @@ namespace osmscout {
 
     char buffer;
 
-    if (fread(&buffer,1,1,file)!=1) {
+    if (ReadFromFile(&buffer,1)!=1) {
       hasError=true;
       throw IOException(filename,"Cannot read uint16_t number");
     }
@@ -1937,7 +2105,7 @@ namespace osmscout {
         return;
       }
 
-      if (fread(&buffer,1,1,file)!=1) {
+      if (ReadFromFile(&buffer,1)!=1) {
         hasError=true;
         throw IOException(filename,"Cannot read uint16_t number");
       }
@@ -1976,7 +2144,7 @@ namespace osmscout {
 
     char buffer;
 
-    if (fread(&buffer,1,1,file)!=1) {
+    if (ReadFromFile(&buffer,1)!=1) {
       hasError=true;
       throw IOException(filename,"Cannot read uint32_t number");
     }
@@ -1990,7 +2158,7 @@ namespace osmscout {
         return;
       }
 
-      if (fread(&buffer,1,1,file)!=1) {
+      if (ReadFromFile(&buffer,1)!=1) {
         hasError=true;
         throw IOException(filename,"Cannot read uint32_t number");
       }
@@ -2029,7 +2197,7 @@ namespace osmscout {
 
     char buffer;
 
-    if (fread(&buffer,1,1,file)!=1) {
+    if (ReadFromFile(&buffer,1)!=1) {
       hasError=true;
       throw IOException(filename,"Cannot read uint64_t number");
     }
@@ -2043,7 +2211,7 @@ namespace osmscout {
         return;
       }
 
-      if (fread(&buffer,1,1,file)!=1) {
+      if (ReadFromFile(&buffer,1)!=1) {
         hasError=true;
         throw IOException(filename,"Cannot read uint64_t number");
       }
@@ -2092,7 +2260,7 @@ namespace osmscout {
 
     unsigned char buffer[coordByteSize];
 
-    hasError=fread(&buffer,1,coordByteSize,file)!=coordByteSize;
+    hasError=ReadFromFile(&buffer,coordByteSize)!=coordByteSize;
 
     if (hasError) {
       throw IOException(filename,"Cannot read coordinate");
@@ -2160,7 +2328,7 @@ namespace osmscout {
 
     unsigned char buffer[coordByteSize];
 
-    hasError=fread(&buffer,1,coordByteSize,file)!=coordByteSize;
+    hasError=ReadFromFile(&buffer,coordByteSize)!=coordByteSize;
 
     if (hasError) {
       throw IOException(filename,"Cannot read coordinate");
@@ -2187,34 +2355,61 @@ namespace osmscout {
     }
   }
 
-  void FileScanner::Read(std::vector<Point>& nodes,bool readIds)
+  /**
+   * Read the header of a coordinate block as written by FileWriter::Write(const std::vector<Point>&,bool).
+   *
+   * @param readIds
+   *    Block was written including node serials
+   * @param nodeCount
+   *    Number of coordinates in the block, 0 for an empty block
+   * @param coordBitSize
+   *    Number of bits used to encode one pair of interleaved coordinate deltas,
+   *    0 for the columnar encoding
+   * @param columnar
+   *    The block uses the columnar encoding (see ReadColumnarDeltaBytes())
+   * @param hasNodes
+   *    The block contains node serials after the coordinates
+   *
+   * throws IOException on error
+   */
+  void FileScanner::ReadCoordBlockHeader(bool readIds,
+                                         size_t& nodeCount,
+                                         size_t& coordBitSize,
+                                         bool& columnar,
+                                         bool& hasNodes)
   {
-    size_t  coordBitSize;
     uint8_t sizeByte;
 
     Read(sizeByte);
 
     // Fast exit for empty arrays
     if (sizeByte==0) {
+      nodeCount=0;
+      coordBitSize=0;
+      columnar=false;
+      hasNodes=false;
       return;
     }
 
-    bool   hasNodes;
-    size_t nodeCount;
+    columnar=false;
+
+    if ((sizeByte & 0x03) == 0) {
+      coordBitSize=16;
+    }
+    else if ((sizeByte & 0x03) == 1) {
+      coordBitSize=32;
+    }
+    else if ((sizeByte & 0x03) == 2) {
+      coordBitSize=48;
+    }
+    else {
+      coordBitSize=0;
+      columnar=true;
+    }
 
     if (readIds) {
       hasNodes=(sizeByte & 0x04)!=0;
 
-      if ((sizeByte & 0x03) == 0) {
-        coordBitSize=16;
-      }
-      else if ((sizeByte & 0x03) == 1) {
-        coordBitSize=32;
-      }
-      else {
-        coordBitSize=48;
-      }
-
       nodeCount=(sizeByte & 0x78) >> 3;
 
       if ((sizeByte & 0x80) != 0) {
@@ -2238,16 +2433,6 @@ namespace osmscout {
     else {
       hasNodes=false;
 
-      if ((sizeByte & 0x03) == 0) {
-        coordBitSize=16;
-      }
-      else if ((sizeByte & 0x03) == 1) {
-        coordBitSize=32;
-      }
-      else {
-        coordBitSize=48;
-      }
-
       nodeCount=(sizeByte & 0x7c) >> 2;
 
       if ((sizeByte & 0x80) != 0) {
@@ -2268,12 +2453,52 @@ namespace osmscout {
         }
       }
     }
+  }
 
-    nodes.resize(nodeCount);
+  /**
+   * Read the number of bytes of one latitude and one longitude delta of
+   * a coordinate block in columnar encoding. In the columnar encoding all latitude deltas
+   * are stored before all longitude deltas, each column with its own fixed number
+   * of bytes (1, 2 or 4) per delta.
+   *
+   * throws IOException on error
+   */
+  void FileScanner::ReadColumnarDeltaBytes(size_t& latBytes,
+                                           size_t& lonBytes)
+  {
+    uint8_t bytes;
+
+    Read(bytes);
+
+    latBytes=bytes & 0x0f;
+    lonBytes=bytes >> 4;
+
+    if ((latBytes!=1 && latBytes!=2 && latBytes!=4) ||
+        (lonBytes!=1 && lonBytes!=2 && lonBytes!=4)) {
+      hasError=true;
+      throw IOException(filename,"Cannot read coordinates","Invalid columnar delta size");
+    }
+  }
 
-    size_t byteBufferSize=(nodeCount-1)*coordBitSize/8;
+  void FileScanner::Read(std::vector<Point>& nodes,bool readIds)
+  {
+    size_t coordBitSize;
+    bool   columnar;
+    bool   hasNodes;
+    size_t nodeCount;
 
-    AssureByteBufferSize(byteBufferSize);
+    ReadCoordBlockHeader(readIds,
+                         nodeCount,
+                         coordBitSize,
+                         columnar,
+                         hasNodes);
+
+    // Fast exit for empty arrays
+    if (nodeCount==0) {
+      return;
+    }
+
+    nodes.resize(nodeCount);
 
     GeoCoord firstCoord;
 
@@ -2284,87 +2509,139 @@ namespace osmscout {
     uint32_t latValue=(uint32_t)round((nodes[0].GetLat()+90.0)*latConversionFactor);
     uint32_t lonValue=(uint32_t)round((nodes[0].GetLon()+180.0)*lonConversionFactor);
 
-    Read((char*)byteBuffer,byteBufferSize);
+    if (columnar) {
+      if (nodeCount>1) {
+        size_t latBytes;
+        size_t lonBytes;
+
+        ReadColumnarDeltaBytes(latBytes,
+                               lonBytes);
+
+        size_t deltaCount=nodeCount-1;
+        size_t byteBufferSize=deltaCount*(latBytes+lonBytes);
+
+        AssureByteBufferSize(byteBufferSize);
+
+        Read((char*)byteBuffer,byteBufferSize);
+
+        const uint8_t* latDeltas=byteBuffer;
+        const uint8_t* lonDeltas=byteBuffer+deltaCount*latBytes;
+        double         lats[COLUMNAR_DECODE_CHUNK_SIZE];
+        double         lons[COLUMNAR_DECODE_CHUNK_SIZE];
+
+        for (size_t start=0; start<deltaCount; start+=COLUMNAR_DECODE_CHUNK_SIZE) {
+          size_t count=std::min(COLUMNAR_DECODE_CHUNK_SIZE,
+                                deltaCount-start);
+
+          DecodeDeltaColumn(&latDeltas[start*latBytes],
+                            latBytes,
+                            count,
+                            latValue,
+                            latConversionFactor,
+                            90.0,
+                            lats);
+          DecodeDeltaColumn(&lonDeltas[start*lonBytes],
+                            lonBytes,
+                            count,
+                            lonValue,
+                            lonConversionFactor,
+                            180.0,
+                            lons);
+
+          for (size_t i=0; i<count; i++) {
+            nodes[start+i+1].SetCoord(GeoCoord(lats[i],
+                                               lons[i]));
+          }
+        }
+      }
+    }
+    else {
+      size_t byteBufferSize=(nodeCount-1)*coordBitSize/8;
 
-    if (coordBitSize==16) {
-      size_t currentCoordPos=1;
+      AssureByteBufferSize(byteBufferSize);
 
-      for (size_t i=0; i<byteBufferSize; i+=2) {
-        int32_t latDelta=(int8_t)byteBuffer[i];
-        int32_t lonDelta=(int8_t)byteBuffer[i+1];
+      Read((char*)byteBuffer,byteBufferSize);
 
-        latValue+=latDelta;
-        lonValue+=lonDelta;
+      if (coordBitSize==16) {
+        size_t currentCoordPos=1;
 
-        nodes[currentCoordPos].SetCoord(GeoCoord(latValue/latConversionFactor-90.0,
-                                                 lonValue/lonConversionFactor-180.0));
+        for (size_t i=0; i<byteBufferSize; i+=2) {
+          int32_t latDelta=(int8_t)byteBuffer[i];
+          int32_t lonDelta=(int8_t)byteBuffer[i+1];
 
-        currentCoordPos++;
-      }
-    }
-    else if (coordBitSize==32) {
-      size_t currentCoordPos=1;
+          latValue+=latDelta;
+          lonValue+=lonDelta;
 
-      for (size_t i=0; i<byteBufferSize; i+=4) {
-        uint32_t latUDelta=byteBuffer[i+0] | (byteBuffer[i+1]<<8);
-        uint32_t lonUDelta=byteBuffer[i+2] | (byteBuffer[i+3]<<8);
-        int32_t  latDelta;
-        int32_t  lonDelta;
+          nodes[currentCoordPos].SetCoord(GeoCoord(latValue/latConversionFactor-90.0,
+                                                   lonValue/lonConversionFactor-180.0));
 
-        if (latUDelta & 0x8000) {
-          latDelta=(int32_t)(latUDelta | 0xffff0000);
-        }
-        else {
-          latDelta=(int32_t)latUDelta;
+          currentCoordPos++;
         }
+      }
+      else if (coordBitSize==32) {
+        size_t currentCoordPos=1;
 
-        latValue+=latDelta;
+        for (size_t i=0; i<byteBufferSize; i+=4) {
+          uint32_t latUDelta=byteBuffer[i+0] | (byteBuffer[i+1]<<8);
+          uint32_t lonUDelta=byteBuffer[i+2] | (byteBuffer[i+3]<<8);
+          int32_t  latDelta;
+          int32_t  lonDelta;
 
-        if (lonUDelta & 0x8000) {
-          lonDelta=(int32_t)(lonUDelta | 0xffff0000);
-        }
-        else {
-          lonDelta=(int32_t)lonUDelta;
-        }
+          if (latUDelta & 0x8000) {
+            latDelta=(int32_t)(latUDelta | 0xffff0000);
+          }
+          else {
+            latDelta=(int32_t)latUDelta;
+          }
 
-        lonValue+=lonDelta;
+          latValue+=latDelta;
 
-        nodes[currentCoordPos].SetCoord(GeoCoord(latValue/latConversionFactor-90.0,
-                                                 lonValue/lonConversionFactor-180.0));
-        currentCoordPos++;
-      }
-    }
-    else {
-      size_t currentCoordPos=1;
+          if (lonUDelta & 0x8000) {
+            lonDelta=(int32_t)(lonUDelta | 0xffff0000);
+          }
+          else {
+            lonDelta=(int32_t)lonUDelta;
+          }
 
-      for (size_t i=0; i<byteBufferSize; i+=6) {
-        uint32_t latUDelta=(byteBuffer[i+0]) | (byteBuffer[i+1]<<8) | (byteBuffer[i+2]<<16);
-        uint32_t lonUDelta=(byteBuffer[i+3]) | (byteBuffer[i+4]<<8) | (byteBuffer[i+5]<<16);
-        int32_t  latDelta;
-        int32_t  lonDelta;
+          lonValue+=lonDelta;
 
-        if (latUDelta & 0x800000) {
-          latDelta=(int32_t)(latUDelta | 0xff000000);
-        }
-        else {
-          latDelta=(int32_t)latUDelta;
+          nodes[currentCoordPos].SetCoord(GeoCoord(latValue/latConversionFactor-90.0,
+                                                   lonValue/lonConversionFactor-180.0));
+          currentCoordPos++;
         }
+      }
+      else {
+        size_t currentCoordPos=1;
 
-        latValue+=latDelta;
+        for (size_t i=0; i<byteBufferSize; i+=6) {
+          uint32_t latUDelta=(byteBuffer[i+0]) | (byteBuffer[i+1]<<8) | (byteBuffer[i+2]<<16);
+          uint32_t lonUDelta=(byteBuffer[i+3]) | (byteBuffer[i+4]<<8) | (byteBuffer[i+5]<<16);
+          int32_t  latDelta;
+          int32_t  lonDelta;
 
-        if (lonUDelta & 0x800000) {
-          lonDelta=(int32_t)(lonUDelta | 0xff000000);
-        }
-        else {
-          lonDelta=(int32_t)lonUDelta;
-        }
+          if (latUDelta & 0x800000) {
+            latDelta=(int32_t)(latUDelta | 0xff000000);
+          }
+          else {
+            latDelta=(int32_t)latUDelta;
+          }
+
+          latValue+=latDelta;
+
+          if (lonUDelta & 0x800000) {
+            lonDelta=(int32_t)(lonUDelta | 0xff000000);
+          }
+          else {
+            lonDelta=(int32_t)lonUDelta;
+          }
 
-        lonValue+=lonDelta;
+          lonValue+=lonDelta;
 
-        nodes[currentCoordPos].SetCoord(GeoCoord(latValue/latConversionFactor-90.0,
-                                                 lonValue/lonConversionFactor-180.0));
+          nodes[currentCoordPos].SetCoord(GeoCoord(latValue/latConversionFactor-90.0,
+                                                   lonValue/lonConversionFactor-180.0));
 
-        currentCoordPos++;
+          currentCoordPos++;
+        }
       }
     }
 
@@ -2402,6 +2679,104 @@ namespace osmscout {
     }
   }
 
+  /**
+   * Read a coordinate block as written by FileWriter::Write(const std::vector<Point>&,bool)
+   * without decoding the coordinates. If the file is memory mapped, the view references
+   * the encoded data in the mapped memory, else the encoded data is copied into the buffer
+   * of the view. Node serials are skipped.
+   *
+   * throws IOException on error
+   */
+  void FileScanner::Read(CoordBlockView& coords, bool readIds)
+  {
+    size_t coordBitSize;
+    bool   columnar;
+    bool   hasNodes;
+    size_t nodeCount;
+
+    ReadCoordBlockHeader(readIds,
+                         nodeCount,
+                         coordBitSize,
+                         columnar,
+                         hasNodes);
+
+    if (nodeCount==0) {
+      coords.Clear();
+      return;
+    }
+
+    GeoCoord firstCoord;
+
+    ReadCoord(firstCoord);
+
+    uint32_t latValue=(uint32_t)round((firstCoord.GetLat()+90.0)*latConversionFactor);
+    uint32_t lonValue=(uint32_t)round((firstCoord.GetLon()+180.0)*lonConversionFactor);
+    size_t   latBytes=coordBitSize/16;
+    size_t   lonBytes=coordBitSize/16;
+
+    if (columnar &&
+        nodeCount>1) {
+      ReadColumnarDeltaBytes(latBytes,
+                             lonBytes);
+    }
+
+    size_t deltaBufferSize=(nodeCount-1)*(latBytes+lonBytes);
+
+#if defined(HAVE_MMAP) || defined(_WIN32)
+    if (buffer!=NULL) {
+      if (deltaBufferSize>0 && offset+(FileOffset)deltaBufferSize-1>=size) {
+        hasError=true;
+        throw IOException(filename,"Cannot read coordinates","Cannot read beyond end of file");
+      }
+
+      coords.Set(nodeCount,
+                 latBytes,
+                 lonBytes,
+                 columnar,
+                 latValue,
+                 lonValue,
+                 (const uint8_t*)&buffer[offset]);
+
+      offset+=deltaBufferSize;
+    }
+    else
+#endif
+    {
+      coords.Set(nodeCount,
+                 latBytes,
+                 lonBytes,
+                 columnar,
+                 latValue,
+                 lonValue,
+                 NULL);
+
+      if (deltaBufferSize>0) {
+        Read((char*)coords.GetBuffer(deltaBufferSize),
+             deltaBufferSize);
+      }
+    }
+
+    if (hasNodes) {
+      size_t idCurrent=0;
+
+      while (idCurrent<nodeCount) {
+        uint8_t bitset;
+
+        Read(bitset);
+
+        for (size_t i=0; i<8 && idCurrent<nodeCount; i++) {
+          if (bitset & (1 << i)) {
+            uint8_t serial;
+
+            Read(serial);
+          }
+
+          idCurrent++;
+        }
+      }
+    }
+  }
+
   void FileScanner::ReadBox(GeoBox& box)
   {
     if (HasError()) {
@@ -41,7 +41,8 @@ namespace osmscout {
 
   FileWriter::FileWriter()
    : file(NULL),
-     hasError(true)
+     hasError(true),
+     columnarCoords(false)
   {
     // no code
   }
@@ -776,6 +777,96 @@ namespace osmscout {
     }
   }
 
+  /**
+   * Write the deltas of a coordinate block (as collected in deltaBuffer) in
+   * the encoding selected by the given sizes.
+   */
+  void FileWriter::WriteCoordDeltas(size_t coordBitSize,
+                                    size_t latBytes,
+                                    size_t lonBytes)
+  {
+    if (columnarCoords) {
+      // All latitude deltas followed by all longitude deltas,
+      // each column with a fixed number of bytes per delta
+
+      if (!deltaBuffer.empty()) {
+        uint8_t deltaBytes=(uint8_t)(latBytes | (lonBytes << 4));
+
+        Write(deltaBytes);
+
+        byteBuffer.resize((deltaBuffer.size()/2)*(latBytes+lonBytes));
+
+        size_t byteBufferPos=0;
+
+        for (size_t i=0; i<deltaBuffer.size(); i+=2) {
+          for (size_t b=0; b<latBytes; b++) {
+            byteBuffer[byteBufferPos]=(deltaBuffer[i] >> (b*8)) & 0xff;
+            ++byteBufferPos;
+          }
+        }
+
+        for (size_t i=1; i<deltaBuffer.size(); i+=2) {
+          for (size_t b=0; b<lonBytes; b++) {
+            byteBuffer[byteBufferPos]=(deltaBuffer[i] >> (b*8)) & 0xff;
+            ++byteBufferPos;
+          }
+        }
+      }
+      else {
+        byteBuffer.clear();
+      }
+    }
+    else {
+      size_t bytesNeeded=(deltaBuffer.size()/2)*coordBitSize/8; // all coordinates in the same encoding
+
+      byteBuffer.resize(bytesNeeded);
+
+      if (coordBitSize==16) {
+        size_t byteBufferPos=0;
+
+        for (size_t i=0; i<deltaBuffer.size(); i++) {
+          byteBuffer[byteBufferPos]=deltaBuffer[i];
+          byteBufferPos++;
+        }
+      }
+      else if (coordBitSize==32) {
+        size_t byteBufferPos=0;
+
+        for (size_t i=0; i<deltaBuffer.size(); i++) {
+          byteBuffer[byteBufferPos]=deltaBuffer[i] & 0xff;
+          ++byteBufferPos;
+
+          byteBuffer[byteBufferPos]=(deltaBuffer[i] >> 8);
+          ++byteBufferPos;
+        }
+      }
+      else {
+        size_t byteBufferPos=0;
+        for (size_t i=0; i<deltaBuffer.size(); i+=2) {
+          byteBuffer[byteBufferPos]=deltaBuffer[i] & 0xff;
+          ++byteBufferPos;
+
+          byteBuffer[byteBufferPos]=(deltaBuffer[i] >> 8) & 0xff;
+          ++byteBufferPos;
+
+          byteBuffer[byteBufferPos]=deltaBuffer[i] >> 16;
+          ++byteBufferPos;
+
+          byteBuffer[byteBufferPos]=deltaBuffer[i+1] & 0xff;
+          ++byteBufferPos;
+
+          byteBuffer[byteBufferPos]=(deltaBuffer[i+1] >> 8) & 0xff;
+          ++byteBufferPos;
+
+          byteBuffer[byteBufferPos]=deltaBuffer[i+1] >> 16;
+          ++byteBufferPos;
+        }
+      }
+    }
+
+    Write((char*)byteBuffer.data(),byteBuffer.size());
+  }
+
   void FileWriter::Write(const std::vector<GeoCoord>& nodes)
   {
     // Quick exit for empty vector arrays
@@ -802,6 +893,8 @@ namespace osmscout {
     uint32_t lastLon=(uint32_t)round((nodes[0].GetLon()+180.0)*lonConversionFactor);
     size_t   deltaBufferPos=0;
     size_t   coordBitSize=16;
+    size_t   latBytes=1;  // Bytes per latitude delta in columnar encoding
+    size_t   lonBytes=1;  // Bytes per longitude delta in columnar encoding
 
     for (size_t i=1; i<nodesSize; i++) {
       uint32_t currentLat=(uint32_t)round((nodes[i].GetLat()+90.0)*latConversionFactor);
@@ -816,9 +909,11 @@ namespace osmscout {
       }
       else if (latDelta>=-32768 && latDelta<=32767) {
         coordBitSize=std::max(coordBitSize,(size_t)32); // 2* 16 bit
+        latBytes=std::max(latBytes,(size_t)2);
       }
       else if (latDelta>=-8388608 && latDelta<=8388608) {
         coordBitSize=std::max(coordBitSize,(size_t)48); // 2 * 24 bit
+        latBytes=4;
       }
       else {
         throw IOException(filename,"Cannot write coordinate","Delta between coordinates too big");
@@ -836,9 +931,11 @@ namespace osmscout {
       }
       else if (lonDelta>=-32768 && lonDelta<=32767) {
         coordBitSize=std::max(coordBitSize,(size_t)32); // 2* 16 bit
+        lonBytes=std::max(lonBytes,(size_t)2);
       }
       else if (lonDelta>=-8388608 && lonDelta<=8388608) {
         coordBitSize=std::max(coordBitSize,(size_t)48); // 2 * 24 bit
+        lonBytes=4;
       }
       else {
         throw IOException(filename,"Cannot write coordinate","Delta between coordinates too big");
@@ -851,17 +948,19 @@ namespace osmscout {
       lastLon=currentLon;
     }
 
-    size_t bytesNeeded=(nodesSize-1)*coordBitSize/8; // all coordinates in the same encoding
-
     //
     // Write starting length / signal bit section
     //
 
-    // We use the first two bits to signal encoding size for coordinates
+    // We use the first two bits to signal encoding size for coordinates,
+    // or the columnar encoding
 
     uint8_t coordSizeFlags;
 
-    if (coordBitSize==16) {
+    if (columnarCoords) {
+      coordSizeFlags=0x03;
+    }
+    else if (coordBitSize==16) {
       coordSizeFlags=0x00;
     }
     else if (coordBitSize==32) {
@@ -920,51 +1019,9 @@ namespace osmscout {
 
     WriteCoord(nodes[0]);
 
-    byteBuffer.resize(bytesNeeded);
-
-    if (coordBitSize==16) {
-      size_t byteBufferPos=0;
-
-      for (size_t i=0; i<deltaBuffer.size(); i++) {
-        byteBuffer[byteBufferPos]=deltaBuffer[i];
-        byteBufferPos++;
-      }
-    }
-    else if (coordBitSize==32) {
-      size_t byteBufferPos=0;
-
-      for (size_t i=0; i<deltaBuffer.size(); i++) {
-        byteBuffer[byteBufferPos]=deltaBuffer[i] & 0xff;
-        ++byteBufferPos;
-
-        byteBuffer[byteBufferPos]=(deltaBuffer[i] >> 8);
-        ++byteBufferPos;
-      }
-    }
-    else {
-      size_t byteBufferPos=0;
-      for (size_t i=0; i<deltaBuffer.size(); i+=2) {
-        byteBuffer[byteBufferPos]=deltaBuffer[i] & 0xff;
-        ++byteBufferPos;
-
-        byteBuffer[byteBufferPos]=(deltaBuffer[i] >> 8) & 0xff;
-        ++byteBufferPos;
-
-        byteBuffer[byteBufferPos]=deltaBuffer[i] >> 16;
-        ++byteBufferPos;
-
-        byteBuffer[byteBufferPos]=deltaBuffer[i+1] & 0xff;
-        ++byteBufferPos;
-
-        byteBuffer[byteBufferPos]=(deltaBuffer[i+1] >> 8) & 0xff;
-        ++byteBufferPos;
-
-        byteBuffer[byteBufferPos]=deltaBuffer[i+1] >> 16;
-        ++byteBufferPos;
-      }
-    }
-
-    Write((char*)byteBuffer.data(),byteBuffer.size());
+    WriteCoordDeltas(coordBitSize,
+                     latBytes,
+                     lonBytes);
   }
 
   void FileWriter::Write(const std::vector<Point>& nodes, bool writeIds)
@@ -993,6 +1050,8 @@ namespace osmscout {
     uint32_t lastLon=(uint32_t)round((nodes[0].GetLon()+180.0)*lonConversionFactor);
     size_t   deltaBufferPos=0;
     size_t   coordBitSize=16;
+    size_t   latBytes=1;  // Bytes per latitude delta in columnar encoding
+    size_t   lonBytes=1;  // Bytes per longitude delta in columnar encoding
 
     for (size_t i=1; i<nodesSize; i++) {
       uint32_t currentLat=(uint32_t)round((nodes[i].GetLat()+90.0)*latConversionFactor);
@@ -1007,9 +1066,11 @@ namespace osmscout {
       }
       else if (latDelta>=-32768 && latDelta<=32767) {
         coordBitSize=std::max(coordBitSize,(size_t)32); // 2* 16 bit
+        latBytes=std::max(latBytes,(size_t)2);
       }
       else if (latDelta>=-8388608 && latDelta<=8388608) {
         coordBitSize=std::max(coordBitSize,(size_t)48); // 2 * 24 bit
+        latBytes=4;
       }
       else {
         throw IOException(filename,"Cannot write coordinate","Delta between coordinates too big");
@@ -1027,9 +1088,11 @@ namespace osmscout {
       }
       else if (lonDelta>=-32768 && lonDelta<=32767) {
         coordBitSize=std::max(coordBitSize,(size_t)32); // 2* 16 bit
+        lonBytes=std::max(lonBytes,(size_t)2);
       }
       else if (lonDelta>=-8388608 && lonDelta<=8388608) {
         coordBitSize=std::max(coordBitSize,(size_t)48); // 2 * 24 bit
+        lonBytes=4;
       }
       else {
         throw IOException(filename,"Cannot write coordinate","Delta between coordinates too big");
@@ -1042,8 +1105,6 @@ namespace osmscout {
       lastLon=currentLon;
     }
 
-    size_t bytesNeeded=(nodesSize-1)*coordBitSize/8; // all coordinates in the same encoding
-
     //
     // do we need to store node ids?
     //
@@ -1063,11 +1124,15 @@ namespace osmscout {
     // Write starting length / signal bit section
     //
 
-    // We use the first two bits to signal encoding size for coordinates
+    // We use the first two bits to signal encoding size for coordinates,
+    // or the columnar encoding
 
     uint8_t coordSizeFlags;
 
-    if (coordBitSize==16) {
+    if (columnarCoords) {
+      coordSizeFlags=0x03;
+    }
+    else if (coordBitSize==16) {
       coordSizeFlags=0x00;
     }
     else if (coordBitSize==32) {
@@ -1173,51 +1238,9 @@ namespace osmscout {
 
     WriteCoord(nodes[0].GetCoord());
 
-    byteBuffer.resize(bytesNeeded);
-
-    if (coordBitSize==16) {
-      size_t byteBufferPos=0;
-
-      for (size_t i=0; i<deltaBuffer.size(); i++) {
-        byteBuffer[byteBufferPos]=deltaBuffer[i];
-        byteBufferPos++;
-      }
-    }
-    else if (coordBitSize==32) {
-      size_t byteBufferPos=0;
-
-      for (size_t i=0; i<deltaBuffer.size(); i++) {
-        byteBuffer[byteBufferPos]=deltaBuffer[i] & 0xff;
-        ++byteBufferPos;
-
-        byteBuffer[byteBufferPos]=(deltaBuffer[i] >> 8);
-        ++byteBufferPos;
-      }
-    }
-    else {
-      size_t byteBufferPos=0;
-      for (size_t i=0; i<deltaBuffer.size(); i+=2) {
-        byteBuffer[byteBufferPos]=deltaBuffer[i] & 0xff;
-        ++byteBufferPos;
-
-        byteBuffer[byteBufferPos]=(deltaBuffer[i] >> 8) & 0xff;
-        ++byteBufferPos;
-
-        byteBuffer[byteBufferPos]=deltaBuffer[i] >> 16;
-        ++byteBufferPos;
-
-        byteBuffer[byteBufferPos]=deltaBuffer[i+1] & 0xff;
-        ++byteBufferPos;
-
-        byteBuffer[byteBufferPos]=(deltaBuffer[i+1] >> 8) & 0xff;
-        ++byteBufferPos;
-
-        byteBuffer[byteBufferPos]=deltaBuffer[i+1] >> 16;
-        ++byteBufferPos;
-      }
-    }
-
-    Write((char*)byteBuffer.data(),byteBuffer.size());
+    WriteCoordDeltas(coordBitSize,
+                     latBytes,
+                     lonBytes);
 
     if (hasNodes) {
       size_t idCurrent=0;
@@ -28,6 +28,12 @@
 #include <osmscout/system/SSEMath.h>
 #endif
 
+// Bulk transformation using AVX2 and FMA, selected at runtime
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define OSMSCOUT_PROJECTION_AVX2
+#include <immintrin.h>
+#endif
+
 #include <osmscout/util/Tiling.h>
 
 namespace osmscout {
@@ -59,6 +65,188 @@ namespace osmscout {
 
   static const double gradtorad=2*M_PI/360;
 
+  /**
+   * Parameter of a bulk transformation of geo coordinates to pixels:
+   *
+   *   x'=lon*lonScale-lonShift
+   *   y'=F(lat)*latScale-latShift, with F(lat)=atanh(sin(lat*gradtorad)) or lat
+   *   (x',y') optionally rotated
+   *   x=xOffset+x', y=yOffset-y'
+   */
+  struct BatchTransformation
+  {
+    double lonScale;
+    double lonShift;
+    bool   linear;    //!< F(lat)=lat
+    double latScale;
+    double latShift;
+    bool   rotate;
+    double rotateSin;
+    double rotateCos;
+    double xOffset;
+    double yOffset;
+  };
+
+#if defined(OSMSCOUT_PROJECTION_AVX2)
+
+#define OSMSCOUT_AVX2_TARGET __attribute__((target("avx2,fma")))
+
+  static bool DetectAVX2()
+  {
+    __builtin_cpu_init();
+
+    return __builtin_cpu_supports("avx2") &&
+           __builtin_cpu_supports("fma");
+  }
+
+  /**
+   * Return true, if the CPU supports AVX2 and FMA
+   */
+  static bool HasAVX2()
+  {
+    static const bool hasAVX2=DetectAVX2();
+
+    return hasAVX2;
+  }
+
+  // Same approximations as in SSEMath, see there for details
+  static const double avx2SineCoeff[] = {
+    -1.666666666666581208932767360735836413787e-1,
+     8.333333333262878969283334152712679345090e-3,
+    -1.984126982009420841621862535256836970687e-4,
+     2.755731607700772351872307094572902723297e-6,
+    -2.505185149701259571358956642584298321640e-8,
+     1.604730119668575379135607736724374349864e-10,
+    -7.364646450221048096686073152326538711869e-13
+  };
+
+  static const double avx2LogInv132=log(1/1.32);
+  static const double avx2LogInv174=log(1/1.74);
+  static const double avx2Log2=log(2.0);
+
+  /**
+   * Calculate atanh(sin(x)) for 4 values, only valid for x in [-Pi/2,Pi/2]
+   */
+  OSMSCOUT_AVX2_TARGET static inline __m256d AtanhSinAVX2(__m256d x)
+  {
+    const __m256d one=_mm256_set1_pd(1.0);
+
+    // sin(x)=x+x^3*P(x^2)
+    __m256d xx=_mm256_mul_pd(x,x);
+    __m256d y=_mm256_set1_pd(avx2SineCoeff[6]);
+
+    for (int i=5; i>=0; i--) {
+      y=_mm256_fmadd_pd(y,xx,_mm256_set1_pd(avx2SineCoeff[i]));
+    }
+
+    __m256d sine=_mm256_fmadd_pd(_mm256_mul_pd(y,xx),x,x);
+
+    // atanh(sin)=log((1+sin)/(1-sin))/2
+    __m256d value=_mm256_div_pd(_mm256_add_pd(one,sine),
+                                _mm256_sub_pd(one,sine));
+
+    // value=mantissa*2^exponent with mantissa in [0.5,1[
+    __m256i bits=_mm256_castpd_si256(value);
+    __m256i exponentBits=_mm256_srli_epi64(_mm256_and_si256(bits,
+                                                            _mm256_set1_epi64x(0x7FF0000000000000ll)),
+                                           52);
+    // Integer to double conversion by adding the integer to the mantissa of 2^52
+    __m256d exponent=_mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(exponentBits,
+                                                                       _mm256_set1_epi64x(0x4330000000000000ll))),
+                                   _mm256_set1_pd(4503599627370496.0+1022.0));
+    __m256d mantissa=_mm256_castsi256_pd(_mm256_or_si256(_mm256_and_si256(bits,
+                                                                          _mm256_set1_epi64x(0x000FFFFFFFFFFFFFll)),
+                                                         _mm256_set1_epi64x(0x3FE0000000000000ll)));
+
+    // Scale the mantissa to be near 1
+    __m256d mask=_mm256_cmp_pd(mantissa,_mm256_set1_pd(0.87),_CMP_LT_OQ);
+    __m256d ex=_mm256_and_pd(mask,_mm256_set1_pd(avx2LogInv132));
+    __m256d v=_mm256_blendv_pd(mantissa,_mm256_mul_pd(mantissa,_mm256_set1_pd(1.32)),mask);
+
+    mask=_mm256_cmp_pd(mantissa,_mm256_set1_pd(0.66),_CMP_LT_OQ);
+    ex=_mm256_blendv_pd(ex,_mm256_set1_pd(avx2LogInv174),mask);
+    v=_mm256_blendv_pd(v,_mm256_mul_pd(mantissa,_mm256_set1_pd(1.74)),mask);
+
+    // log(v)=2*(term+term^3/3+term^5/5+...) with term=(v-1)/(v+1)
+    __m256d term=_mm256_div_pd(_mm256_sub_pd(v,one),
+                               _mm256_add_pd(v,one));
+    __m256d termSquared=_mm256_mul_pd(term,term);
+    __m256d res=_mm256_fmadd_pd(_mm256_set1_pd(1/9.0),termSquared,_mm256_set1_pd(1/7.0));
+
+    res=_mm256_fmadd_pd(res,termSquared,_mm256_set1_pd(1/5.0));
+    res=_mm256_fmadd_pd(res,termSquared,_mm256_set1_pd(1/3.0));
+    res=_mm256_fmadd_pd(_mm256_mul_pd(res,term),termSquared,term);
+
+    __m256d logValue=_mm256_fmadd_pd(exponent,
+                                     _mm256_set1_pd(avx2Log2),
+                                     _mm256_fmadd_pd(_mm256_set1_pd(2.0),res,ex));
+
+    return _mm256_mul_pd(_mm256_set1_pd(0.5),logValue);
+  }
+
+  /**
+   * Transform points in groups of 4, returns the number of points transformed,
+   * which is count rounded down to a multiple of 4
+   */
+  OSMSCOUT_AVX2_TARGET static size_t GeoToPixelAVX2(const BatchTransformation& transformation,
+                                                    const Point* points,
+                                                    size_t count,
+                                                    double* x,
+                                                    double* y,
+                                                    size_t stride)
+  {
+    const __m256d lonScale=_mm256_set1_pd(transformation.lonScale);
+    const __m256d lonShift=_mm256_set1_pd(transformation.lonShift);
+    const __m256d latScale=_mm256_set1_pd(transformation.latScale);
+    const __m256d latShift=_mm256_set1_pd(transformation.latShift);
+    const __m256d rotateSin=_mm256_set1_pd(transformation.rotateSin);
+    const __m256d rotateCos=_mm256_set1_pd(transformation.rotateCos);
+    const __m256d xOffset=_mm256_set1_pd(transformation.xOffset);
+    const __m256d yOffset=_mm256_set1_pd(transformation.yOffset);
+    const __m256d gradtoradV=_mm256_set1_pd(gradtorad);
+    double        xResult[4];
+    double        yResult[4];
+    size_t        i=0;
+
+    for (; i+4<=count; i+=4) {
+      __m256d lon=_mm256_setr_pd(points[i].GetLon(),
+                                 points[i+1].GetLon(),
+                                 points[i+2].GetLon(),
+                                 points[i+3].GetLon());
+      __m256d lat=_mm256_setr_pd(points[i].GetLat(),
+                                 points[i+1].GetLat(),
+                                 points[i+2].GetLat(),
+                                 points[i+3].GetLat());
+
+      if (!transformation.linear) {
+        lat=AtanhSinAVX2(_mm256_mul_pd(lat,gradtoradV));
+      }
+
+      __m256d xv=_mm256_fmsub_pd(lon,lonScale,lonShift);
+      __m256d yv=_mm256_fmsub_pd(lat,latScale,latShift);
+
+      if (transformation.rotate) {
+        __m256d xn=_mm256_fmsub_pd(xv,rotateCos,_mm256_mul_pd(yv,rotateSin));
+        __m256d yn=_mm256_fmadd_pd(xv,rotateSin,_mm256_mul_pd(yv,rotateCos));
+
+        xv=xn;
+        yv=yn;
+      }
+
+      _mm256_storeu_pd(xResult,_mm256_add_pd(xOffset,xv));
+      _mm256_storeu_pd(yResult,_mm256_sub_pd(yOffset,yv));
+
+      for (size_t j=0; j<4; j++) {
+        x[(i+j)*stride]=xResult[j];
+        y[(i+j)*stride]=yResult[j];
+      }
+    }
+
+    return i;
+  }
+
+#endif
+
   Projection::Projection()
   : lon(0),
     lat(0),
@@ -78,6 +266,33 @@ namespace osmscout {
     // no code
   }
 
+  void Projection::GeoToPixel(const Point* points,
+                              size_t count,
+                              double* x,
+                              double* y,
+                              size_t stride) const
+  {
+    BatchTransformer batchTransformer(*this);
+
+    for (size_t i=0; i<count; i++) {
+      batchTransformer.GeoToPixel(points[i].GetLon(),
+                                  points[i].GetLat(),
+                                  x[i*stride],
+                                  y[i*stride]);
+    }
+  }
+
+  Projection::BulkKernel Projection::GetBulkKernel() const
+  {
+#ifdef OSMSCOUT_HAVE_SSE2
+    if (CanBatch()) {
+      return bulkKernelSSE2;
+    }
+#endif
+
+    return bulkKernelScalar;
+  }
+
   MercatorProjection::MercatorProjection()
   : valid(false),
     latOffset(0.0),
@@ -266,6 +481,67 @@ namespace osmscout {
     return IsValidFor(coord);
   }
 
+  void MercatorProjection::GeoToPixel(const Point* points,
+                                      size_t count,
+                                      double* x,
+                                      double* y,
+                                      size_t stride) const
+  {
+    assert(valid);
+
+    size_t transformed=0;
+
+#if defined(OSMSCOUT_PROJECTION_AVX2)
+    if (GetBulkKernel()==bulkKernelAVX2) {
+      BatchTransformation transformation;
+
+      transformation.lonScale=scaleGradtorad;
+      transformation.lonShift=this->lon*scaleGradtorad;
+      transformation.linear=useLinearInterpolation;
+
+      if (useLinearInterpolation) {
+        transformation.latScale=scaledLatDeriv;
+        transformation.latShift=this->lat*scaledLatDeriv;
+      }
+      else {
+        transformation.latScale=scale;
+        transformation.latShift=latOffset*scale;
+      }
+
+      transformation.rotate=angle!=0.0;
+      transformation.rotateSin=angleNegSin;
+      transformation.rotateCos=angleNegCos;
+      transformation.xOffset=(double)(width/2);
+      transformation.yOffset=(double)(height/2);
+
+      transformed=GeoToPixelAVX2(transformation,
+                                 points,
+                                 count,
+                                 x,
+                                 y,
+                                 stride);
+    }
+#endif
+
+    // Remaining points and CPUs without AVX2
+    Projection::GeoToPixel(points+transformed,
+                           count-transformed,
+                           x+transformed*stride,
+                           y+transformed*stride,
+                           stride);
+  }
+
+  Projection::BulkKernel MercatorProjection::GetBulkKernel() const
+  {
+#if defined(OSMSCOUT_PROJECTION_AVX2)
+    if (HasAVX2()) {
+      return bulkKernelAVX2;
+    }
+#endif
+
+    return Projection::GetBulkKernel();
+  }
+
   void MercatorProjection::GeoToPixel(const BatchTransformer& /*transformData*/) const
   {
     assert(false); //should not be called
@@ -463,4 +739,69 @@ namespace osmscout {
 
   #endif
 
+  void TileProjection::GeoToPixel(const Point* points,
+                                  size_t count,
+                                  double* x,
+                                  double* y,
+                                  size_t stride) const
+  {
+    size_t transformed=0;
+
+#if defined(OSMSCOUT_PROJECTION_AVX2)
+    if (GetBulkKernel()==bulkKernelAVX2) {
+      BatchTransformation transformation;
+
+      transformation.lonScale=scaleGradtorad;
+      transformation.lonShift=lonOffset;
+
+#ifdef OSMSCOUT_HAVE_SSE2
+      // Like GeoToPixel(), the SSE2 implementation does not interpolate
+      transformation.linear=false;
+#else
+      transformation.linear=useLinearInterpolation;
+#endif
+
+      if (transformation.linear) {
+        transformation.latScale=scaledLatDeriv;
+        transformation.latShift=this->lat*scaledLatDeriv;
+        transformation.yOffset=(double)(height/2);
+      }
+      else {
+        transformation.latScale=scale;
+        transformation.latShift=latOffset;
+        transformation.yOffset=(double)height;
+      }
+
+      transformation.rotate=false;
+      transformation.rotateSin=0.0;
+      transformation.rotateCos=1.0;
+      transformation.xOffset=0.0;
+
+      transformed=GeoToPixelAVX2(transformation,
+                                 points,
+                                 count,
+                                 x,
+                                 y,
+                                 stride);
+    }
+#endif
+
+    // Remaining points and CPUs without AVX2
+    Projection::GeoToPixel(points+transformed,
+                           count-transformed,
+                           x+transformed*stride,
+                           y+transformed*stride,
+                           stride);
+  }
+
+  Projection::BulkKernel TileProjection::GetBulkKernel() const
+  {
+#if defined(OSMSCOUT_PROJECTION_AVX2)
+    if (HasAVX2()) {
+      return bulkKernelAVX2;
+    }
+#endif
+
+    return Projection::GetBulkKernel();
+  }
 }
@@ -317,18 +317,23 @@ namespace osmscout {
   void TransPolygon::TransformGeoToPixel(const Projection& projection,
                                          const std::vector<Point>& nodes)
   {
-    Projection::BatchTransformer batchTransformer(projection);
+    static_assert(sizeof(TransPoint)%sizeof(double)==0,
+                  "TransPoint must be addressable in units of double");
 
     if (!nodes.empty()) {
       start=0;
       length=nodes.size();
       end=length-1;
 
+      // Transform all nodes at once, writing directly into the TransPoints. Without
+      // a vectorized kernel the projection uses the BatchTransformer, see GetBulkKernel()
+      projection.GeoToPixel(nodes.data(),
+                            nodes.size(),
+                            &points[0].x,
+                            &points[0].y,
+                            sizeof(TransPoint)/sizeof(double));
+
       for (size_t i=start; i<=end; i++) {
-         batchTransformer.GeoToPixel(nodes[i].GetLon(),
-                                     nodes[i].GetLat(),
-                                     points[i].x,
-                                     points[i].y);
         points[i].draw=true;
       }
     }